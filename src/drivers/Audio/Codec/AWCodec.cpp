@@ -248,3 +248,58 @@ NTSTATUS AWCodecStateControl(_In_ BOOL IsCapture,_In_ KSSTATE State) {
 	}
 	return Status;
 }
+
+//
+// Programs PLL_AUDIO and the I2S_AP and AIF1 clock and format fields for a
+// solved clock plan (AudioClock.h). The PLL is only rewritten when the
+// factors change, so switching rates within a family does not drop lock.
+//
+NTSTATUS AWCodecSetClock(_In_ BOOL IsCapture, _In_ const AUDIO_CLOCK_CONFIG *pConfig)
+{
+	NTSTATUS Status = STATUS_SUCCESS;
+	ULONG PllControl = AudioClockPllControl(pConfig);
+	ULONG Waited = 0;
+	FunctionEnter();
+
+	if ((ReadCCMUReg(CCMU_PLL_AUDIO_CTRL) & ~(1 << PLL_AUDIO_LOCK)) != PllControl)
+	{
+		WriteCCMUReg(CCMU_PLL_AUDIO_CTRL, PllControl);
+		while (!(ReadCCMUReg(CCMU_PLL_AUDIO_CTRL) & (1 << PLL_AUDIO_LOCK)))
+		{
+			if (Waited >= PLL_AUDIO_LOCK_TIMEOUT_US)
+			{
+				DbgPrint_E("PLL_AUDIO did not lock, control 0x%x", PllControl);
+				Status = STATUS_IO_TIMEOUT;
+				goto Exit;
+			}
+			KeStallExecutionProcessor(10);
+			Waited += 10;
+		}
+	}
+
+	//I2S_AP: MCLK and BCLK dividers, sample resolution, slot width
+	CodecDigitalWriteControl(SUNXI_DA_CLKD, 0xf, MCLKDIV, pConfig->DaMclkDivCode);
+	CodecDigitalWriteControl(SUNXI_DA_CLKD, 0x7, BCLKDIV, pConfig->DaBclkDivCode);
+	CodecDigitalWriteControl(SUNXI_DA_FAT0, 0x3, SR, pConfig->DaResolutionCode);
+	CodecDigitalWriteControl(SUNXI_DA_FAT0, 0x3, WSS, pConfig->DaSlotCode);
+
+	//FIFO sample alignment of the direction being started
+	if (IsCapture)
+	{
+		CodecDigitalWriteControl(SUNXI_DA_FCTL, 0x3, RXOM, pConfig->DaRxOutputMode);
+	}
+	else
+	{
+		CodecDigitalWriteControl(SUNXI_DA_FCTL, 0x1, TXIM, pConfig->DaTxInputMode);
+	}
+
+	//codec AIF1: sample rate, BCLK/LRCK ratios and word size
+	CodecDigitalWriteControl(SUNXI_SYS_SR_CTRL, 0xf, AIF1_FS, pConfig->Aif1FsCode);
+	CodecDigitalWriteControl(SUNXI_AIF1_CLK_CTRL, 0xf, AIF1_BCLK_DIV, pConfig->Aif1BclkDivCode);
+	CodecDigitalWriteControl(SUNXI_AIF1_CLK_CTRL, 0x7, AIF1_LRCK_DIV, pConfig->Aif1LrckDivCode);
+	CodecDigitalWriteControl(SUNXI_AIF1_CLK_CTRL, 0x3, AIF1_WORD_SIZ, pConfig->Aif1WordSizeCode);
+
+Exit:
+	FunctionExit(Status);
+	return Status;
+}
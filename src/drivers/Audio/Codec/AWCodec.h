@@ -19,6 +19,7 @@
 
 #include <wdm.h>
 #include <portcls.h>
+#include "AudioClock.h"
 
 /*Codec Digital Register*/
 #define SUNXI_DA_CTL                			(0x00)
@@ -2025,8 +2026,14 @@
 #define CODEC_CCMU_ADDRESS_BASE 0x01C20000
 #define CODEC_CCMU_ADDRESS_SIZE 0x400
 
+//audio PLL control register in CCMU
+#define CCMU_PLL_AUDIO_CTRL 0x8
+#define PLL_AUDIO_LOCK (28)
+#define PLL_AUDIO_LOCK_TIMEOUT_US 2000
+
 NTSTATUS AWCodecMapReg(void);
 NTSTATUS AWCodecInitHw(void);
 NTSTATUS AWCodecStateControl(_In_ BOOL IsCapture, _In_ KSSTATE State);
+NTSTATUS AWCodecSetClock(_In_ BOOL IsCapture, _In_ const AUDIO_CLOCK_CONFIG *pConfig);
 
 
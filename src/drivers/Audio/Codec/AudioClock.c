@@ -0,0 +1,261 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	AudioClock.c
+
+Abstract:
+
+	Clock plan solver, see AudioClock.h.
+
+Environment:
+
+	kernel mode, and user mode for the host test
+
+--*/
+
+#include "AudioClock.h"
+
+#define ARRAY_COUNT(_a_) (sizeof(_a_) / sizeof((_a_)[0]))
+
+//
+// PLL_AUDIO factor ranges, and the range of 24 MHz * N / M the PLL
+// locks in.
+//
+#define PLL_N_MAX			128
+#define PLL_M_MAX			32
+#define PLL_P_MAX			16
+#define PLL_VCO_MIN_HZ		72000000ull
+#define PLL_VCO_MAX_HZ		504000000ull
+
+//
+// Divider tables, indexed by register code.
+//
+static const unsigned int DaMclkDivs[] = { 1, 2, 4, 6, 8, 12, 16, 24, 32, 48, 64 };
+static const unsigned int DaBclkDivs[] = { 2, 4, 6, 8, 12, 16, 32, 64 };
+static const unsigned int Aif1BclkDivs[] = { 1, 2, 4, 6, 8, 12, 16, 24, 32, 48, 64, 96, 128, 192 };
+static const unsigned int Aif1LrckDivs[] = { 16, 32, 64, 128, 256 };
+static const unsigned int Aif1Rates[] = { 8000, 11025, 12000, 16000, 22050, 24000, 32000, 44100, 48000, 96000, 192000 };
+
+static int
+FindCode(
+	const unsigned int *Table,
+	unsigned int Count,
+	unsigned int Value
+	)
+{
+	unsigned int code;
+
+	for (code = 0; code < Count; code++)
+	{
+		if (Table[code] == Value)
+		{
+			return (int)code;
+		}
+	}
+
+	return -1;
+}
+
+static void
+SolvePll(
+	unsigned int FamilyHz,
+	PAUDIO_CLOCK_CONFIG Config
+	)
+{
+	unsigned long long bestError = 0;
+	unsigned long long bestScale = 0;
+	unsigned int n;
+	unsigned int m;
+
+	//
+	// For every N and M the best P is the nearest integer to the VCO
+	// over the target. The error |24 MHz * N - Family * M * P| / (M * P)
+	// is compared by cross multiplying so no precision is lost, ties go
+	// to the smaller M.
+	//
+	for (m = 1; m <= PLL_M_MAX; m++)
+	{
+		for (n = 1; n <= PLL_N_MAX; n++)
+		{
+			unsigned long long vcoTimesM = (unsigned long long)AUDIO_CLOCK_OSC_HZ * n;
+			unsigned long long target;
+			unsigned long long error;
+			unsigned long long p;
+
+			if ((vcoTimesM < PLL_VCO_MIN_HZ * m) || (vcoTimesM > PLL_VCO_MAX_HZ * m))
+			{
+				continue;
+			}
+
+			p = (vcoTimesM + (unsigned long long)m * FamilyHz / 2) / ((unsigned long long)m * FamilyHz);
+			if ((p < 1) || (p > PLL_P_MAX))
+			{
+				continue;
+			}
+
+			target = (unsigned long long)FamilyHz * m * p;
+			error = (vcoTimesM > target) ? (vcoTimesM - target) : (target - vcoTimesM);
+
+			if ((bestScale == 0) || (error * bestScale < bestError * (m * p)))
+			{
+				bestError = error;
+				bestScale = m * p;
+				Config->PllN = n;
+				Config->PllM = m;
+				Config->PllP = (unsigned int)p;
+			}
+		}
+	}
+}
+
+int
+AudioClockSolve(
+	unsigned int SampleRate,
+	unsigned int ContainerBits,
+	unsigned int ValidBits,
+	PAUDIO_CLOCK_CONFIG Config
+	)
+{
+	unsigned int bitsPerFrame = AUDIO_CLOCK_SLOT_BITS * AUDIO_CLOCK_SLOTS;
+	unsigned int divider;
+	unsigned int code;
+	int found;
+	unsigned long long numerator;
+	unsigned long long denominator;
+
+	Config->SampleRate = SampleRate;
+	Config->ContainerBits = ContainerBits;
+	Config->ValidBits = ValidBits;
+
+	//
+	// Sample width: 16-bit samples go through the FIFO LSB aligned as
+	// 16-bit DMA words, 24-bit ones MSB aligned as 32-bit words.
+	//
+	if ((ContainerBits == 16) && (ValidBits == 16))
+	{
+		Config->DaResolutionCode = 0;
+		Config->DaTxInputMode = 1;
+		Config->DaRxOutputMode = 1;
+		Config->Aif1WordSizeCode = 1;
+	}
+	else if ((ContainerBits == 32) && (ValidBits == 24))
+	{
+		Config->DaResolutionCode = 2;
+		Config->DaTxInputMode = 0;
+		Config->DaRxOutputMode = 0;
+		Config->Aif1WordSizeCode = 3;
+	}
+	else
+	{
+		return 0;
+	}
+	Config->DaSlotCode = 3;
+
+	found = FindCode(Aif1Rates, ARRAY_COUNT(Aif1Rates), SampleRate);
+	if (found < 0)
+	{
+		return 0;
+	}
+	Config->Aif1FsCode = (unsigned int)found;
+
+	if (AUDIO_CLOCK_FAMILY_48K_HZ % (SampleRate * bitsPerFrame) == 0)
+	{
+		Config->FamilyHz = AUDIO_CLOCK_FAMILY_48K_HZ;
+	}
+	else if (AUDIO_CLOCK_FAMILY_44K1_HZ % (SampleRate * bitsPerFrame) == 0)
+	{
+		Config->FamilyHz = AUDIO_CLOCK_FAMILY_44K1_HZ;
+	}
+	else
+	{
+		return 0;
+	}
+	divider = Config->FamilyHz / (SampleRate * bitsPerFrame);
+
+	//
+	// I2S_AP: the smallest BCLK divider that leaves an MCLK divider in
+	// the table, so MCLK stays as fast as it can.
+	//
+	found = -1;
+	for (code = 0; code < ARRAY_COUNT(DaBclkDivs); code++)
+	{
+		if (divider % DaBclkDivs[code] != 0)
+		{
+			continue;
+		}
+
+		found = FindCode(DaMclkDivs, ARRAY_COUNT(DaMclkDivs), divider / DaBclkDivs[code]);
+		if (found >= 0)
+		{
+			Config->BclkDiv = DaBclkDivs[code];
+			Config->DaBclkDivCode = code;
+			Config->MclkDiv = DaMclkDivs[found];
+			Config->DaMclkDivCode = (unsigned int)found;
+			break;
+		}
+	}
+	if (found < 0)
+	{
+		return 0;
+	}
+
+	//
+	// Codec AIF1 runs from the same PLL, BCLK and LRCK ratios match.
+	//
+	found = FindCode(Aif1BclkDivs, ARRAY_COUNT(Aif1BclkDivs), divider);
+	if (found < 0)
+	{
+		return 0;
+	}
+	Config->Aif1BclkDivCode = (unsigned int)found;
+
+	found = FindCode(Aif1LrckDivs, ARRAY_COUNT(Aif1LrckDivs), bitsPerFrame);
+	if (found < 0)
+	{
+		return 0;
+	}
+	Config->Aif1LrckDivCode = (unsigned int)found;
+
+	SolvePll(Config->FamilyHz, Config);
+
+	//
+	// LRCK = 24 MHz * N / (M * P * divider * bits per frame)
+	//
+	numerator = (unsigned long long)AUDIO_CLOCK_OSC_HZ * Config->PllN;
+	denominator = (unsigned long long)Config->PllM * Config->PllP * divider * bitsPerFrame;
+
+	Config->AchievedMilliHz = (numerator * 1000 + denominator / 2) / denominator;
+	Config->ErrorPpb = (long long)((numerator * 1000000000ull + (denominator * SampleRate) / 2) / (denominator * SampleRate)) - 1000000000ll;
+
+	return 1;
+}
+
+unsigned int
+AudioClockPllControl(
+	const AUDIO_CLOCK_CONFIG *Config
+	)
+{
+	return (1u << 31)
+		| ((Config->PllP - 1) << 16)
+		| ((Config->PllN - 1) << 8)
+		| (Config->PllM - 1);
+}
@@ -0,0 +1,136 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	AudioClock.h
+
+Abstract:
+
+	Clock plan for a PCM stream format on the A64 audio path:
+
+		PLL_AUDIO = 24 MHz * N / (M * P), tuned to 22.5792 MHz for the
+			44.1 kHz family and to 24.576 MHz for the 48 kHz family.
+		I2S_AP (master) MCLK = PLL_AUDIO / MclkDiv, BCLK = MCLK / BclkDiv,
+			LRCK = BCLK / (2 * SlotBits).
+		Codec AIF1 (slave) clocked from PLL_AUDIO, with its sample rate,
+			word size and BCLK/LRCK ratios matching the I2S_AP.
+
+	AudioClockSolve picks the PLL factors closest to the family rate and
+	the divider and register codes for a format, and reports how far the
+	LRCK it gets is from the requested rate. It uses no kernel or runtime
+	services so tools\audioclocktest runs it on the host.
+
+	Supported formats are 8, 11.025, 12, 16, 22.05, 24, 32, 44.1, 48, 96
+	and 192 kHz (the rates the codec AIF1 has), 16-bit samples in 16-bit
+	containers and 24-bit samples in 32-bit containers. The I2S_AP
+	resolution is at most 24 bits, so 32-bit samples are refused rather
+	than truncated.
+
+Environment:
+
+	kernel mode, and user mode for the host test
+
+--*/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AUDIO_CLOCK_OSC_HZ				24000000u
+#define AUDIO_CLOCK_FAMILY_44K1_HZ		22579200u
+#define AUDIO_CLOCK_FAMILY_48K_HZ		24576000u
+
+//
+// Two slots (left, right) of 32 BCLK per frame for every format, the
+// codec AIF1 takes 24 valid bits at most.
+//
+#define AUDIO_CLOCK_SLOT_BITS			32
+#define AUDIO_CLOCK_SLOTS				2
+
+typedef struct _AUDIO_CLOCK_CONFIG
+{
+	//
+	// Stream format
+	//
+	unsigned int SampleRate;
+	unsigned int ContainerBits;
+	unsigned int ValidBits;
+
+	//
+	// PLL_AUDIO factors and the nominal rate they approximate
+	//
+	unsigned int FamilyHz;
+	unsigned int PllN;
+	unsigned int PllM;
+	unsigned int PllP;
+
+	//
+	// I2S_AP dividers and register fields
+	//
+	unsigned int MclkDiv;
+	unsigned int BclkDiv;
+	unsigned int DaMclkDivCode;		// DA_CLKD MCLKDIV
+	unsigned int DaBclkDivCode;		// DA_CLKD BCLKDIV
+	unsigned int DaSlotCode;		// DA_FAT0 WSS
+	unsigned int DaResolutionCode;	// DA_FAT0 SR
+	unsigned int DaTxInputMode;		// DA_FCTL TXIM
+	unsigned int DaRxOutputMode;	// DA_FCTL RXOM
+
+	//
+	// Codec AIF1 register fields
+	//
+	unsigned int Aif1BclkDivCode;	// AIF1_CLK_CTRL AIF1_BCLK_DIV
+	unsigned int Aif1LrckDivCode;	// AIF1_CLK_CTRL AIF1_LRCK_DIV
+	unsigned int Aif1WordSizeCode;	// AIF1_CLK_CTRL AIF1_WORD_SIZ
+	unsigned int Aif1FsCode;		// SYS_SR_CTRL AIF1_FS
+
+	//
+	// LRCK the plan gets in mHz, and its error against SampleRate in
+	// parts per billion.
+	//
+	unsigned long long AchievedMilliHz;
+	long long ErrorPpb;
+} AUDIO_CLOCK_CONFIG, *PAUDIO_CLOCK_CONFIG;
+
+//
+// Fills Config for the format, returns 0 when the hardware cannot run it.
+//
+int
+AudioClockSolve(
+	unsigned int SampleRate,
+	unsigned int ContainerBits,
+	unsigned int ValidBits,
+	PAUDIO_CLOCK_CONFIG Config
+	);
+
+//
+// PLL_AUDIO_CTRL_REG value, PLL enabled, for the factors in Config.
+//
+unsigned int
+AudioClockPllControl(
+	const AUDIO_CLOCK_CONFIG *Config
+	);
+
+#ifdef __cplusplus
+}
+#endif
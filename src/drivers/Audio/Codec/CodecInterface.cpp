@@ -229,6 +229,15 @@ NTSTATUS CodecSetStreamState(
 	}
 
 	pDevExt = DeviceGetContext((WDFDEVICE)pContext);
+
+	//
+	// Remember which directions are running, a running stream holds the
+	// clock plan until it stops.
+	//
+	WdfWaitLockAcquire(pDevExt->pWaitLock, NULL);
+	pDevExt->IsStreamRunning[IsCapture ? 1 : 0] = (KSSTATE_RUN == State);
+	WdfWaitLockRelease(pDevExt->pWaitLock);
+
 	Status = AWCodecStateControl(IsCapture, State);
 Exit:
 	return Status;
@@ -271,6 +280,9 @@ NTSTATUS CodecSetStreamFormat(
 {
 	NTSTATUS Status = STATUS_SUCCESS;
 	PDEVICE_CONTEXT pDevExt = NULL;
+	AUDIO_CLOCK_CONFIG ClockConfig;
+	ULONG ContainerBits;
+	ULONG ValidBits;
 
 	FunctionEnter();
 
@@ -284,10 +296,69 @@ NTSTATUS CodecSetStreamFormat(
 
 	pDevExt = DeviceGetContext((WDFDEVICE)pContext);
 
+	if (pWaveFormatExt->Format.nChannels != 2)
+	{
+		DbgPrint_E("Unsupported channel count %d.", pWaveFormatExt->Format.nChannels);
+		Status = STATUS_NOT_SUPPORTED;
+		goto Exit;
+	}
+
+	ContainerBits = pWaveFormatExt->Format.wBitsPerSample;
+	ValidBits = ContainerBits;
+	if (WAVE_FORMAT_EXTENSIBLE == pWaveFormatExt->Format.wFormatTag)
+	{
+		if (!IsEqualGUIDAligned(pWaveFormatExt->SubFormat, KSDATAFORMAT_SUBTYPE_PCM))
+		{
+			DbgPrint_E("Unsupported subformat.");
+			Status = STATUS_NOT_SUPPORTED;
+			goto Exit;
+		}
+		ValidBits = pWaveFormatExt->Samples.wValidBitsPerSample;
+	}
+	else if (WAVE_FORMAT_PCM != pWaveFormatExt->Format.wFormatTag)
+	{
+		DbgPrint_E("Unsupported format tag 0x%x.", pWaveFormatExt->Format.wFormatTag);
+		Status = STATUS_NOT_SUPPORTED;
+		goto Exit;
+	}
+
+	if (!AudioClockSolve(pWaveFormatExt->Format.nSamplesPerSec, ContainerBits, ValidBits, &ClockConfig))
+	{
+		DbgPrint_E("No clock plan for %d Hz %d/%d-bit.", pWaveFormatExt->Format.nSamplesPerSec, ValidBits, ContainerBits);
+		Status = STATUS_NOT_SUPPORTED;
+		goto Exit;
+	}
+
+	WdfWaitLockAcquire(pDevExt->pWaitLock, NULL);
+
 	//
-	// TODO: Set format to HW, if necessary
+	// Render and capture share the I2S LRCK and sample resolution, the
+	// other direction must not be running at a different rate or width.
 	//
-	UNREFERENCED_PARAMETER(IsCapture);
+	if (pDevExt->IsStreamRunning[IsCapture ? 0 : 1]
+		&& pDevExt->IsClockConfigured
+		&& ((pDevExt->ClockConfig.SampleRate != ClockConfig.SampleRate)
+			|| (pDevExt->ClockConfig.DaResolutionCode != ClockConfig.DaResolutionCode)))
+	{
+		DbgPrint_E("%d Hz %d-bit conflicts with the running stream at %d Hz %d-bit.",
+			ClockConfig.SampleRate, ClockConfig.ContainerBits,
+			pDevExt->ClockConfig.SampleRate, pDevExt->ClockConfig.ContainerBits);
+		Status = STATUS_DEVICE_BUSY;
+	}
+	else
+	{
+		DbgPrint_I("%d Hz %d/%d-bit, PLL N %d M %d P %d, rate error %d ppb.",
+			ClockConfig.SampleRate, ClockConfig.ValidBits, ClockConfig.ContainerBits,
+			ClockConfig.PllN, ClockConfig.PllM, ClockConfig.PllP, (LONG)ClockConfig.ErrorPpb);
+		Status = AWCodecSetClock(IsCapture, &ClockConfig);
+		if (NT_SUCCESS(Status))
+		{
+			pDevExt->ClockConfig = ClockConfig;
+			pDevExt->IsClockConfigured = TRUE;
+		}
+	}
+
+	WdfWaitLockRelease(pDevExt->pWaitLock);
 
 Exit:
 	FunctionExit(Status);
@@ -21,6 +21,7 @@
 #include <ntddk.h>
 #include <wdf.h>
 #include "CodecInterface.h"
+#include "AudioClock.h"
 
 #define CODEC_POOL_TAG 'EDOC'
 
@@ -64,6 +65,11 @@ typedef struct _DEVICE_CONTEXT
 	CODEC_POWER_DOWN_COMPLETION_CALLBACK PowerDownCompletionCallback;
 	BOOLEAN IsFirstD0Entry;
 	int	 IdleState;
+	// Clock plan in effect, shared by render and capture as both run off
+	// the one I2S LRCK. Guarded by pWaitLock.
+	AUDIO_CLOCK_CONFIG ClockConfig;
+	BOOLEAN IsClockConfigured;
+	BOOLEAN IsStreamRunning[2];	// indexed by IsCapture
 } DEVICE_CONTEXT, *PDEVICE_CONTEXT;
 
 //
@@ -0,0 +1,233 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	audioclocktest.c
+
+Abstract:
+
+	Host test of the clock plan solver (AudioClock.c). It solves every
+	format the handset speaker and mic array wave tables advertise and
+	prints the PLL factors, the I2S_AP dividers and the LRCK rate each
+	gets with its error, then checks:
+
+		- every advertised format has a plan within MAX_ERROR_PPB,
+		- the dividers give the LRCK the solver reports,
+		- 48 kHz 16-bit programs the register fields the codec used
+		  before the rate was selectable,
+		- the PLL is no further off than the fixed settings it replaces,
+		- formats the hardware cannot run are refused.
+
+	Build and run on any host with a C compiler, it returns nonzero when
+	a check fails:
+
+		cc -O2 -I.. -o audioclocktest audioclocktest.c ../AudioClock.c
+		audioclocktest
+
+Environment:
+
+	user mode
+
+--*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "AudioClock.h"
+
+//
+// Worst LRCK error accepted for an advertised format.
+//
+#define MAX_ERROR_PPB		100000
+
+//
+// PLL_AUDIO_CTRL_REG values AWCodecInitHw used to program for 48 kHz,
+// and had commented out for 44.1 kHz.
+//
+#define OLD_PLL_48K			0x80035514
+#define OLD_PLL_44K1		0x80034e14
+
+typedef struct _FORMAT
+{
+	unsigned int SampleRate;
+	unsigned int ContainerBits;
+	unsigned int ValidBits;
+} FORMAT;
+
+//
+// Mirrors the device formats in handsetspeakerwavtable.h and
+// micarraywavtable.h.
+//
+static const unsigned int AdvertisedRates[] = { 8000, 11025, 12000, 16000, 22050, 24000, 32000, 44100, 48000, 96000, 192000 };
+
+static const FORMAT AdvertisedWidths[] =
+{
+	{ 0, 16, 16 },
+	{ 0, 32, 24 },
+};
+
+static const FORMAT Unsupported[] =
+{
+	{ 88200, 16, 16 },		// no AIF1 rate
+	{ 176400, 16, 16 },
+	{ 64000, 16, 16 },
+	{ 44100, 24, 24 },		// packed 24-bit, the DMA moves 16 or 32-bit words
+	{ 48000, 32, 16 },
+	{ 48000, 32, 32 },		// the I2S_AP resolution is 24 bits
+	{ 48000, 16, 8 },
+	{ 48000, 8, 8 },
+};
+
+static unsigned int Failures;
+
+static void
+Check(int Condition, const char *What, unsigned int SampleRate, unsigned int ValidBits)
+{
+	if (!Condition)
+	{
+		fprintf(stderr, "FAILED %u Hz %u-bit: %s\n", SampleRate, ValidBits, What);
+		Failures++;
+	}
+}
+
+static long long
+PllErrorPpb(unsigned int Control, unsigned int FamilyHz)
+{
+	unsigned long long n = ((Control >> 8) & 0x7f) + 1;
+	unsigned long long m = (Control & 0x1f) + 1;
+	unsigned long long p = ((Control >> 16) & 0xf) + 1;
+	unsigned long long numerator = (unsigned long long)AUDIO_CLOCK_OSC_HZ * n * 1000000000ull;
+	unsigned long long denominator = m * p * FamilyHz;
+
+	return (long long)((numerator + denominator / 2) / denominator) - 1000000000ll;
+}
+
+static long long
+Magnitude(long long Value)
+{
+	return (Value < 0) ? -Value : Value;
+}
+
+int
+main(void)
+{
+	AUDIO_CLOCK_CONFIG config;
+	unsigned int rate;
+	unsigned int width;
+	unsigned int i;
+	long long worst = 0;
+
+	printf("%7s %5s %9s %4s %3s %3s %5s %5s %14s %10s\n",
+		"rate", "bits", "family", "N", "M", "P", "mclk", "bclk", "lrck Hz", "error ppm");
+
+	for (rate = 0; rate < sizeof(AdvertisedRates) / sizeof(AdvertisedRates[0]); rate++)
+	{
+		for (width = 0; width < sizeof(AdvertisedWidths) / sizeof(AdvertisedWidths[0]); width++)
+		{
+			unsigned int sampleRate = AdvertisedRates[rate];
+			unsigned int validBits = AdvertisedWidths[width].ValidBits;
+			unsigned long long lrckTimesDivs;
+			unsigned long long divs;
+
+			if (!AudioClockSolve(sampleRate, AdvertisedWidths[width].ContainerBits, validBits, &config))
+			{
+				Check(0, "no clock plan", sampleRate, validBits);
+				continue;
+			}
+
+			printf("%7u %2u/%2u %9u %4u %3u %3u %5u %5u %10llu.%03llu %10.3f\n",
+				sampleRate, validBits, config.ContainerBits, config.FamilyHz,
+				config.PllN, config.PllM, config.PllP, config.MclkDiv, config.BclkDiv,
+				config.AchievedMilliHz / 1000, config.AchievedMilliHz % 1000,
+				config.ErrorPpb / 1000.0);
+
+			if (Magnitude(config.ErrorPpb) > worst)
+			{
+				worst = Magnitude(config.ErrorPpb);
+			}
+			Check(Magnitude(config.ErrorPpb) <= MAX_ERROR_PPB, "rate error too large", sampleRate, validBits);
+
+			//
+			// The family rate divided down by the I2S_AP dividers and
+			// the frame is the requested rate exactly.
+			//
+			divs = (unsigned long long)config.MclkDiv * config.BclkDiv * AUDIO_CLOCK_SLOT_BITS * AUDIO_CLOCK_SLOTS;
+			Check(config.FamilyHz == divs * sampleRate, "dividers do not divide the family rate to the sample rate", sampleRate, validBits);
+
+			lrckTimesDivs = (unsigned long long)AUDIO_CLOCK_OSC_HZ * config.PllN * 1000 / ((unsigned long long)config.PllM * config.PllP);
+			Check(Magnitude((long long)(lrckTimesDivs / divs) - (long long)config.AchievedMilliHz) <= 1,
+				"achieved rate does not match the dividers", sampleRate, validBits);
+
+			Check(PllErrorPpb(AudioClockPllControl(&config), config.FamilyHz) == config.ErrorPpb,
+				"PLL control register does not hold the solved factors", sampleRate, validBits);
+
+			if (config.FamilyHz == AUDIO_CLOCK_FAMILY_48K_HZ)
+			{
+				Check(Magnitude(config.ErrorPpb) <= Magnitude(PllErrorPpb(OLD_PLL_48K, config.FamilyHz)),
+					"less accurate than the old 48 kHz PLL setting", sampleRate, validBits);
+			}
+			else
+			{
+				Check(Magnitude(config.ErrorPpb) <= Magnitude(PllErrorPpb(OLD_PLL_44K1, config.FamilyHz)),
+					"less accurate than the old 44.1 kHz PLL setting", sampleRate, validBits);
+			}
+		}
+	}
+
+	//
+	// 48 kHz 16-bit is what AWCodecInitHw programmed: DA_CLKD 0x82,
+	// DA_FAT0 0xc, DA_FCTL TXIM 1 RXOM 1, AIF1_CLK_CTRL 0x8890 and
+	// AIF1_FS 8 in SYS_SR_CTRL.
+	//
+	if (AudioClockSolve(48000, 16, 16, &config))
+	{
+		Check(((1 << 7) | (config.DaBclkDivCode << 4) | config.DaMclkDivCode) == 0x82, "DA_CLKD", 48000, 16);
+		Check(((config.DaResolutionCode << 4) | (config.DaSlotCode << 2)) == 0xc, "DA_FAT0", 48000, 16);
+		Check((config.DaTxInputMode == 1) && (config.DaRxOutputMode == 1), "DA_FCTL", 48000, 16);
+		Check(((1 << 15) | (config.Aif1BclkDivCode << 9) | (config.Aif1LrckDivCode << 6) | (config.Aif1WordSizeCode << 4)) == 0x8890,
+			"AIF1_CLK_CTRL", 48000, 16);
+		Check(config.Aif1FsCode == 8, "AIF1_FS", 48000, 16);
+	}
+	else
+	{
+		Check(0, "no clock plan", 48000, 16);
+	}
+
+	for (i = 0; i < sizeof(Unsupported) / sizeof(Unsupported[0]); i++)
+	{
+		Check(!AudioClockSolve(Unsupported[i].SampleRate, Unsupported[i].ContainerBits, Unsupported[i].ValidBits, &config),
+			"unsupported format accepted", Unsupported[i].SampleRate, Unsupported[i].ValidBits);
+	}
+
+	printf("\nworst error %.3f ppm, old PLL settings %.3f ppm (48 kHz) and %.3f ppm (44.1 kHz)\n",
+		worst / 1000.0,
+		PllErrorPpb(OLD_PLL_48K, AUDIO_CLOCK_FAMILY_48K_HZ) / 1000.0,
+		PllErrorPpb(OLD_PLL_44K1, AUDIO_CLOCK_FAMILY_44K1_HZ) / 1000.0);
+
+	if (Failures != 0)
+	{
+		printf("%u checks failed\n", Failures);
+		return 1;
+	}
+
+	printf("all checks passed\n");
+	return 0;
+}
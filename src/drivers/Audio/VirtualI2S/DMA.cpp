@@ -27,26 +27,26 @@ EVT_WDF_DMA_TRANSACTION_DMA_TRANSFER_COMPLETE I2SDmaTransmitDmaTransferComplete;
 EVT_WDF_PROGRAM_DMA I2SDmaReceiveProgramDma;
 EVT_WDF_DMA_TRANSACTION_DMA_TRANSFER_COMPLETE I2SDmaReceiveDmaTransferComplete;
 
-NTSTATUS I2SDmaInitialize(
-	_In_ PDEVICE_CONTEXT pDevExt)
+//
+// Creates the enabler, transaction and adapter of one direction for the FIFO
+// access width. The system DMA channel takes the width when it is configured,
+// so a different width needs the objects created again.
+//
+static NTSTATUS I2SDmaConfigure(
+	_In_ PDEVICE_CONTEXT pDevExt,
+	_In_ BOOL IsCapture,
+	_In_ DMA_WIDTH Width)
 {
 	NTSTATUS Status = STATUS_SUCCESS;
 	WDF_DMA_ENABLER_CONFIG DmaEnablerConfig = { 0 };
 	WDF_DMA_SYSTEM_PROFILE_CONFIG DmaSystemProfileConfig = { 0 };
 	PHYSICAL_ADDRESS Address = { 0 };
-
-	FunctionEnter();
-
-	if (NULL == pDevExt) 
-	{
-		DbgPrint_E("Invalid parameter.");
-		Status = STATUS_INVALID_PARAMETER;
-		goto Exit;
-	}
-
-	//
-	// Initialize TX DMA
-	//
+	WDF_DMA_DIRECTION Direction = IsCapture ? WdfDmaDirectionReadFromDevice : WdfDmaDirectionWriteToDevice;
+	WDFDMAENABLER *ppDmaEnabler = IsCapture ? &pDevExt->pRxDmaEnabler : &pDevExt->pTxDmaEnabler;
+	WDFDMATRANSACTION *ppDmaTransaction = IsCapture ? &pDevExt->pDmaReceiveTransaction : &pDevExt->pDmaTransmitTransaction;
+	PDMA_ADAPTER *ppAdapter = IsCapture ? &pDevExt->pReadAdapter : &pDevExt->pWriteAdapter;
+	PDMA_ADAPTER_INFO pAdapterInfo = IsCapture ? &pDevExt->DmaReadInfo : &pDevExt->DmaWriteInfo;
+	PCSTR Name = IsCapture ? "RX" : "TX";
 
 	// Create DMA Enabler
 	WDF_DMA_ENABLER_CONFIG_INIT(&DmaEnablerConfig,
@@ -56,130 +56,204 @@ NTSTATUS I2SDmaInitialize(
 	Status = WdfDmaEnablerCreate(pDevExt->pDevice,
 		&DmaEnablerConfig,
 		WDF_NO_OBJECT_ATTRIBUTES,
-		&pDevExt->pTxDmaEnabler);
+		ppDmaEnabler);
 	if (!NT_SUCCESS(Status))
 	{
-		DbgPrint_E("WdfDmaEnablerCreate for TX failed with 0x%lx.", Status);
+		DbgPrint_E("WdfDmaEnablerCreate for %s failed with 0x%lx.", Name, Status);
 		goto Exit;
 	}
 
 	// Initialize System DMA Configuration
 	Address.HighPart = 0;
-	Address.LowPart = DMA_CODEC_FIFO_TX__ADDRESS;
+	Address.LowPart = IsCapture ? DMA_CODEC_FIFO_RX__ADDRESS : DMA_CODEC_FIFO_TX__ADDRESS;
 
-	WdfDmaEnablerSetMaximumScatterGatherElements(pDevExt->pTxDmaEnabler, DMA_MAX_FRAGMENTS);
+	WdfDmaEnablerSetMaximumScatterGatherElements(*ppDmaEnabler, DMA_MAX_FRAGMENTS);
 
 	WDF_DMA_SYSTEM_PROFILE_CONFIG_INIT(&DmaSystemProfileConfig,
 		Address,
-		Width16Bits,
-		pDevExt->pDmaResourceDescriptor[0]);
+		Width,
+		pDevExt->pDmaResourceDescriptor[IsCapture ? 1 : 0]);
 #ifdef DMA_LOOP_TRANSFER
-	DmaSystemProfileConfig.LoopedTransfer = TRUE;
+	DmaSystemProfileConfig.LoopedTransfer = IsCapture ? FALSE : TRUE;
 #else
     DmaSystemProfileConfig.LoopedTransfer = FALSE;
 #endif
-	Status = WdfDmaEnablerConfigureSystemProfile(pDevExt->pTxDmaEnabler,
+	Status = WdfDmaEnablerConfigureSystemProfile(*ppDmaEnabler,
 		&DmaSystemProfileConfig,
-		WdfDmaDirectionWriteToDevice);
+		Direction);
 	if (!NT_SUCCESS(Status))
 	{
-		DbgPrint_E("WdfDmaEnablerConfigureSystemProfile for TX failed with 0x%lx.", Status);
+		DbgPrint_E("WdfDmaEnablerConfigureSystemProfile for %s failed with 0x%lx.", Name, Status);
 		goto Exit;
 	}
 
 	// Create DMA Transaction
-	Status = WdfDmaTransactionCreate(pDevExt->pTxDmaEnabler,
+	Status = WdfDmaTransactionCreate(*ppDmaEnabler,
 		WDF_NO_OBJECT_ATTRIBUTES,
-		&pDevExt->pDmaTransmitTransaction);
+		ppDmaTransaction);
 	if (!NT_SUCCESS(Status))
 	{
-		DbgPrint_E("WdfDmaTransactionCreate for TX failed with 0x%lx.", Status);
+		DbgPrint_E("WdfDmaTransactionCreate for %s failed with 0x%lx.", Name, Status);
 		goto Exit;
 	}
 
 	// Save DMA Adapter information
-	pDevExt->pWriteAdapter = WdfDmaEnablerWdmGetDmaAdapter(pDevExt->pTxDmaEnabler,
-		WdfDmaDirectionWriteToDevice);
-	if (NULL == pDevExt->pWriteAdapter)
+	*ppAdapter = WdfDmaEnablerWdmGetDmaAdapter(*ppDmaEnabler, Direction);
+	if (NULL == *ppAdapter)
 	{
-		DbgPrint_E("WdfDmaEnablerWdmGetDmaAdapter for TX failed.");
+		DbgPrint_E("WdfDmaEnablerWdmGetDmaAdapter for %s failed.", Name);
 		Status = STATUS_UNSUCCESSFUL;
 		goto Exit;
 	}
 
-	Status = pDevExt->pWriteAdapter->DmaOperations->GetDmaAdapterInfo(pDevExt->pWriteAdapter, &pDevExt->DmaWriteInfo);
+	Status = (*ppAdapter)->DmaOperations->GetDmaAdapterInfo(*ppAdapter, pAdapterInfo);
 	if (!NT_SUCCESS(Status))
 	{
-		DbgPrint_E("GetDmaAdapterInfo for TX failed with 0x%lx.", Status);
+		DbgPrint_E("GetDmaAdapterInfo for %s failed with 0x%lx.", Name, Status);
 		goto Exit;
 	}
 
-	StateAdd(pDevExt->DmaState, DMA_STATE_TRANSMIT_CONFIGED);
+	if (IsCapture)
+	{
+		pDevExt->DmaReceiveWidth = Width;
+	}
+	else
+	{
+		pDevExt->DmaTransmitWidth = Width;
+	}
+
+Exit:
+	return Status;
+}
+
+//
+// Deletes what I2SDmaConfigure created for one direction.
+//
+static void I2SDmaUnconfigure(
+	_In_ PDEVICE_CONTEXT pDevExt,
+	_In_ BOOL IsCapture)
+{
+	WDFDMAENABLER *ppDmaEnabler = IsCapture ? &pDevExt->pRxDmaEnabler : &pDevExt->pTxDmaEnabler;
+	WDFDMATRANSACTION *ppDmaTransaction = IsCapture ? &pDevExt->pDmaReceiveTransaction : &pDevExt->pDmaTransmitTransaction;
+
+	if (NULL != *ppDmaTransaction)
+	{
+		WdfObjectDelete(*ppDmaTransaction);
+		*ppDmaTransaction = NULL;
+	}
+
+	if (NULL != *ppDmaEnabler)
+	{
+		WdfObjectDelete(*ppDmaEnabler);
+		*ppDmaEnabler = NULL;
+	}
+
+	if (IsCapture)
+	{
+		pDevExt->pReadAdapter = NULL;
+		memset(&pDevExt->DmaReadInfo, 0, sizeof(pDevExt->DmaReadInfo));
+	}
+	else
+	{
+		pDevExt->pWriteAdapter = NULL;
+		memset(&pDevExt->DmaWriteInfo, 0, sizeof(pDevExt->DmaWriteInfo));
+	}
+}
+
+NTSTATUS I2SDmaInitialize(
+	_In_ PDEVICE_CONTEXT pDevExt)
+{
+	NTSTATUS Status = STATUS_SUCCESS;
+
+	FunctionEnter();
+
+	if (NULL == pDevExt) 
+	{
+		DbgPrint_E("Invalid parameter.");
+		Status = STATUS_INVALID_PARAMETER;
+		goto Exit;
+	}
 
 	//
-	// Initialize RX DMA
+	// Initialize TX and RX DMA for 16-bit samples, I2SDmaSetWidth changes
+	// the width for the stream format.
 	//
+	Status = I2SDmaConfigure(pDevExt, FALSE, Width16Bits);
+	if (!NT_SUCCESS(Status))
+	{
+		goto Exit;
+	}
 
-	// Create DMA Enabler
-	Status = WdfDmaEnablerCreate(pDevExt->pDevice,
-		&DmaEnablerConfig,
-		WDF_NO_OBJECT_ATTRIBUTES,
-		&(pDevExt->pRxDmaEnabler));
+	StateAdd(pDevExt->DmaState, DMA_STATE_TRANSMIT_CONFIGED);
+
+	Status = I2SDmaConfigure(pDevExt, TRUE, Width16Bits);
 	if (!NT_SUCCESS(Status))
 	{
-		DbgPrint_E("WdfDmaEnablerCreate for RX failed with 0x%lx.", Status);
 		goto Exit;
 	}
 
-	// Initialize System DMA Configuration
-	WdfDmaEnablerSetMaximumScatterGatherElements(pDevExt->pRxDmaEnabler, DMA_MAX_FRAGMENTS);
+	StateAdd(pDevExt->DmaState, DMA_STATE_RECEIVE_CONFIGED);
 
-	Address.LowPart = DMA_CODEC_FIFO_RX__ADDRESS;
-	
-	WDF_DMA_SYSTEM_PROFILE_CONFIG_INIT(&DmaSystemProfileConfig,
-		Address,
-		Width16Bits,
-		pDevExt->pDmaResourceDescriptor[1]);
+Exit:
+	FunctionExit(Status);
+	return Status;
+}
+
+NTSTATUS I2SDmaSetWidth(
+	_In_ PDEVICE_CONTEXT pDevExt,
+	_In_ BOOL IsCapture,
+	_In_ DMA_WIDTH Width)
+{
+	NTSTATUS Status = STATUS_SUCCESS;
+	ULONG ConfigedState = IsCapture ? DMA_STATE_RECEIVE_CONFIGED : DMA_STATE_TRANSMIT_CONFIGED;
+	ULONG StartedState = IsCapture ? DMA_STATE_RECEIVE_STARTED : DMA_STATE_TRANSMIT_STARTED;
 
-	//DmaSystemProfileConfig.LoopedTransfer = TRUE;
+	FunctionEnter();
 
-	Status = WdfDmaEnablerConfigureSystemProfile(pDevExt->pRxDmaEnabler,
-		&DmaSystemProfileConfig,
-		WdfDmaDirectionReadFromDevice);
-	if (!NT_SUCCESS(Status))
+	if (NULL == pDevExt)
 	{
-		DbgPrint_E("WdfDmaEnablerConfigureSystemProfile for RX failed with 0x%lx.", Status);
+		DbgPrint_E("Invalid parameter.");
+		Status = STATUS_INVALID_PARAMETER;
 		goto Exit;
 	}
 
-	// Create DMA Transaction
-	Status = WdfDmaTransactionCreate(pDevExt->pRxDmaEnabler,
-		WDF_NO_OBJECT_ATTRIBUTES,
-		&pDevExt->pDmaReceiveTransaction);
-	if (!NT_SUCCESS(Status))
+	WdfSpinLockAcquire(pDevExt->pDmaTransmissionLock);
+
+	if (StateTest(pDevExt->DmaState, ConfigedState)
+		&& (Width == (IsCapture ? pDevExt->DmaReceiveWidth : pDevExt->DmaTransmitWidth)))
 	{
-		DbgPrint_E("WdfDmaTransactionCreate for RX failed with 0x%lx.", Status);
+		WdfSpinLockRelease(pDevExt->pDmaTransmissionLock);
 		goto Exit;
 	}
 
-	// Save DMA Adapter information
-	pDevExt->pReadAdapter = WdfDmaEnablerWdmGetDmaAdapter(pDevExt->pRxDmaEnabler,
-		WdfDmaDirectionReadFromDevice);
-	if (NULL == pDevExt->pReadAdapter)
+	if (StateTest(pDevExt->DmaState, StartedState))
 	{
-		DbgPrint_E("WdfDmaEnablerWdmGetDmaAdapter for RX failed.");
-		Status = STATUS_UNSUCCESSFUL;
+		DbgPrint_E("DMA is running, cannot change the width. (IsCapture:%x)", IsCapture);
+		Status = STATUS_INVALID_DEVICE_STATE;
+		WdfSpinLockRelease(pDevExt->pDmaTransmissionLock);
 		goto Exit;
 	}
 
-	Status = pDevExt->pReadAdapter->DmaOperations->GetDmaAdapterInfo(pDevExt->pReadAdapter, &pDevExt->DmaReadInfo);
+	//
+	// Not configured until the new objects exist, so I2SDmaTransmit and
+	// I2SDmaReceive refuse to start meanwhile.
+	//
+	StateRemove(pDevExt->DmaState, ConfigedState);
+
+	WdfSpinLockRelease(pDevExt->pDmaTransmissionLock);
+
+	I2SDmaUnconfigure(pDevExt, IsCapture);
+
+	Status = I2SDmaConfigure(pDevExt, IsCapture, Width);
 	if (!NT_SUCCESS(Status))
 	{
-		DbgPrint_E("GetDmaAdapterInfo for RX failed with 0x%lx.", Status);
+		I2SDmaUnconfigure(pDevExt, IsCapture);
 		goto Exit;
 	}
 
-	StateAdd(pDevExt->DmaState, DMA_STATE_RECEIVE_CONFIGED);
+	WdfSpinLockAcquire(pDevExt->pDmaTransmissionLock);
+	StateAdd(pDevExt->DmaState, ConfigedState);
+	WdfSpinLockRelease(pDevExt->pDmaTransmissionLock);
 
 Exit:
 	FunctionExit(Status);
@@ -241,6 +315,7 @@ NTSTATUS I2SDmaTransmit(
 	pDevExt->DmaTransmittedLength = 0;
 	pDevExt->DmaTransmitTotalLength = TransferSize;
 	pDevExt->DmaTransmitLengthPerOperation = pDevExt->DmaTransmitTotalLength / NotificationsPerBuffer;
+	pDevExt->DmaTransmitCompletedLength = 0;
 	pDevExt->DmaInterruptCounter = 0;
 
 	NT_ASSERT(0 == (pDevExt->DmaTransmitLengthPerOperation % pDevExt->DmaWriteInfo.V1.MinimumTransferUnit));
@@ -381,6 +456,8 @@ void I2SDmaTransmitDmaTransferComplete(
 		// DMA will notify the completion every interruption, so the data transferred is always a packet.
 		BytesTransferred = pDevExt->DmaTransmitLengthPerOperation;
 #endif		
+		pDevExt->DmaTransmitCompletedLength += BytesTransferred;
+
 		if ((NULL != pDevExt->DmaTransmitCallback.pCallbackRoutine)
 			&& (NULL != pDevExt->DmaTransmitCallback.pCallbackContext))
 		{
@@ -514,6 +591,7 @@ NTSTATUS I2SDmaReceive(
 	pDevExt->DmaReceivedLength = 0;
 	pDevExt->DmaReceiveTotalLength = TransferSize;
 	pDevExt->DmaReceiveLengthPerOperation = pDevExt->DmaReceiveTotalLength / NotificationsPerBuffer;
+	pDevExt->DmaReceiveCompletedLength = 0;
 
 	NT_ASSERT(0 == (pDevExt->DmaReceiveLengthPerOperation % pDevExt->DmaReadInfo.V1.MinimumTransferUnit));
 
@@ -633,6 +711,8 @@ void I2SDmaReceiveDmaTransferComplete(
 		WdfDmaTransactionRelease(pDevExt->pDmaReceiveTransaction);
 		pDevExt->pReadAdapter->DmaOperations->FreeAdapterChannel(pDevExt->pReadAdapter);
 
+		pDevExt->DmaReceiveCompletedLength += BytesTransferred;
+
 		if ((NULL != pDevExt->DmaReceiveCallback.pCallbackRoutine)
 			&& (NULL != pDevExt->DmaReceiveCallback.pCallbackContext))
 		{
@@ -749,4 +829,82 @@ NTSTATUS I2SDmaStop(
 Exit:
 	FunctionExit(Status);
 	return Status;
+}
+
+NTSTATUS I2SDmaGetPosition(
+	_In_ PDEVICE_CONTEXT pDevExt,
+	_In_ BOOL IsCapture,
+	_Out_ PULONGLONG pLinearPosition)
+{
+	NTSTATUS Status = STATUS_SUCCESS;
+	PDMA_ADAPTER pAdapter = NULL;
+	ULONG LengthPerOperation = 0;
+	ULONGLONG CompletedLength = 0;
+	ULONG BytesNotTransferred = 0;
+	ULONG BytesInFlight = 0;
+
+	if ((NULL == pDevExt)
+		|| (NULL == pLinearPosition))
+	{
+		DbgPrint_E("Invalid parameters.");
+		Status = STATUS_INVALID_PARAMETER;
+		goto Exit;
+	}
+
+	//
+	// The completion callbacks count the transfers and reprogram the channel under this lock,
+	// so the residue read here always belongs to the transfer after the counted ones.
+	//
+	WdfSpinLockAcquire(pDevExt->pDmaTransmissionLock);
+
+	if (!IsCapture && StateTest(pDevExt->DmaState, DMA_STATE_TRANSMIT_STARTED))
+	{
+		pAdapter = pDevExt->pWriteAdapter;
+		LengthPerOperation = pDevExt->DmaTransmitLengthPerOperation;
+		CompletedLength = pDevExt->DmaTransmitCompletedLength;
+	}
+	else if (IsCapture && StateTest(pDevExt->DmaState, DMA_STATE_RECEIVE_STARTED))
+	{
+		pAdapter = pDevExt->pReadAdapter;
+		LengthPerOperation = pDevExt->DmaReceiveLengthPerOperation;
+		CompletedLength = pDevExt->DmaReceiveCompletedLength;
+	}
+	else
+	{
+		Status = STATUS_INVALID_DEVICE_STATE;
+		WdfSpinLockRelease(pDevExt->pDmaTransmissionLock);
+		goto Exit;
+	}
+
+	BytesNotTransferred = pAdapter->DmaOperations->ReadDmaCounter(pAdapter);
+
+#ifdef DMA_LOOP_TRANSFER
+	if (!IsCapture)
+	{
+		//
+		// A looped transfer counts down over the whole buffer, the DMA is less than one buffer
+		// ahead of the completed packets.
+		//
+		ULONG TotalLength = pDevExt->DmaTransmitTotalLength;
+		ULONG BufferOffset = (TotalLength - (BytesNotTransferred % TotalLength)) % TotalLength;
+
+		BytesInFlight = (BufferOffset + TotalLength - (ULONG)(CompletedLength % TotalLength)) % TotalLength;
+	}
+	else
+#endif
+	//
+	// A finished transfer whose completion has not run yet reads 0, one not started yet reads
+	// its full length.
+	//
+	if (BytesNotTransferred < LengthPerOperation)
+	{
+		BytesInFlight = LengthPerOperation - BytesNotTransferred;
+	}
+
+	*pLinearPosition = CompletedLength + BytesInFlight;
+
+	WdfSpinLockRelease(pDevExt->pDmaTransmissionLock);
+
+Exit:
+	return Status;
 }
\ No newline at end of file
@@ -41,6 +41,8 @@
 #define StateTest(_flag_, _state_) ((_flag_ & _state_) == _state_)
 
 NTSTATUS I2SDmaInitialize(_In_ PDEVICE_CONTEXT pDevExt);
+NTSTATUS I2SDmaSetWidth(_In_ PDEVICE_CONTEXT pDevExt, _In_ BOOL IsCapture, _In_ DMA_WIDTH Width);
 NTSTATUS I2SDmaTransmit(_In_ PDEVICE_CONTEXT pDevExt, _In_ PMDL pTransferMdl, _In_ ULONG TransferSize, _In_ ULONG NotificationsPerBuffer);
 NTSTATUS I2SDmaReceive(_In_ PDEVICE_CONTEXT pDevExt, _In_ PMDL pTransferMdl, _In_ ULONG TransferSize, _In_ ULONG NotificationsPerBuffer);
-NTSTATUS I2SDmaStop(_In_ PDEVICE_CONTEXT pDevExt, _In_ BOOL IsCapture);
\ No newline at end of file
+NTSTATUS I2SDmaStop(_In_ PDEVICE_CONTEXT pDevExt, _In_ BOOL IsCapture);
+NTSTATUS I2SDmaGetPosition(_In_ PDEVICE_CONTEXT pDevExt, _In_ BOOL IsCapture, _Out_ PULONGLONG pLinearPosition);
\ No newline at end of file
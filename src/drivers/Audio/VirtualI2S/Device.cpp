@@ -109,12 +109,16 @@ NTSTATUS I2SCreateDevice(
 	pDevExt->pWriteAdapter = NULL;
 	memset(&pDevExt->DmaReadInfo, 0, sizeof(pDevExt->DmaReadInfo));
 	memset(&pDevExt->DmaWriteInfo, 0, sizeof(pDevExt->DmaWriteInfo));
+	pDevExt->DmaTransmitWidth = Width16Bits;
+	pDevExt->DmaReceiveWidth = Width16Bits;
 	pDevExt->DmaTransmitTotalLength = 0;
 	pDevExt->DmaTransmitLengthPerOperation = 0;
 	pDevExt->DmaTransmittedLength = 0;
 	pDevExt->DmaReceiveTotalLength = 0;
 	pDevExt->DmaReceiveLengthPerOperation = 0;
 	pDevExt->DmaReceivedLength = 0;
+	pDevExt->DmaTransmitCompletedLength = 0;
+	pDevExt->DmaReceiveCompletedLength = 0;
 	pDevExt->pTransmitMdl = NULL;
 	pDevExt->pReceiveMdl = NULL;
 	pDevExt->DmaInterruptCounter = 0;
@@ -137,6 +141,7 @@ NTSTATUS I2SCreateDevice(
 	pDevExt->I2sFunctionInterface.I2SSetStreamFormat = I2SSetStreamFormat;
 	pDevExt->I2sFunctionInterface.I2SSetPowerState = I2SSetPowerState;
 	pDevExt->I2sFunctionInterface.I2SSetPowerDownCompletionCallback = I2SSetPowerDownCompletionCallback;
+	pDevExt->I2sFunctionInterface.I2SGetPosition = I2SGetPosition;
 	pDevExt->I2sFunctionInterface.InterfaceHeader.InterfaceReference =
 		I2SInterfaceReference;
 	pDevExt->I2sFunctionInterface.InterfaceHeader.InterfaceDereference =
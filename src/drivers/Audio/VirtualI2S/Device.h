@@ -73,12 +73,16 @@ typedef struct _DEVICE_CONTEXT
 	PDMA_ADAPTER pWriteAdapter;
 	DMA_ADAPTER_INFO DmaReadInfo;
 	DMA_ADAPTER_INFO DmaWriteInfo;
+	DMA_WIDTH DmaTransmitWidth;
+	DMA_WIDTH DmaReceiveWidth;
 	ULONG DmaTransmitTotalLength;
 	ULONG DmaTransmitLengthPerOperation;
 	ULONG DmaTransmittedLength;
 	ULONG DmaReceiveTotalLength;
 	ULONG DmaReceiveLengthPerOperation;
 	ULONG DmaReceivedLength;
+	ULONGLONG DmaTransmitCompletedLength;
+	ULONGLONG DmaReceiveCompletedLength;
 	PMDL pTransmitMdl;
 	PMDL pReceiveMdl;
 	ULONG DmaInterruptCounter;
@@ -226,6 +226,7 @@ NTSTATUS I2SSetStreamFormat(
 {
 	NTSTATUS Status = STATUS_SUCCESS;
 	PDEVICE_CONTEXT pDevExt = NULL;
+	DMA_WIDTH Width = Width16Bits;
 
 	FunctionEnter();
 
@@ -239,13 +240,25 @@ NTSTATUS I2SSetStreamFormat(
 	pDevExt = DeviceGetContext((WDFDEVICE)pContext);
 
 	//
-	// TODO: Set the format to HW here
+	// The FIFO takes 16-bit samples as 16-bit words and wider ones in 32-bit
+	// containers as 32-bit words. The I2S clock and format are set by the
+	// codec driver, which owns the I2S_AP registers.
 	//
+	switch (pWaveFormatExt->Format.wBitsPerSample)
+	{
+	case 16:
+		Width = Width16Bits;
+		break;
+	case 32:
+		Width = Width32Bits;
+		break;
+	default:
+		DbgPrint_E("Unsupported container size %d.", pWaveFormatExt->Format.wBitsPerSample);
+		Status = STATUS_NOT_SUPPORTED;
+		goto Exit;
+	}
 
-	//
-	// TODO: Set the I2S clock here, if necessary
-	//
-	UNREFERENCED_PARAMETER(IsCapture);
+	Status = I2SDmaSetWidth(pDevExt, IsCapture, Width);
 
 Exit:
 	FunctionExit(Status);
@@ -361,3 +374,30 @@ Exit:
 	FunctionExit(Status);
 	return Status;
 }
+
+NTSTATUS I2SGetPosition(
+	_In_ PVOID pContext,
+	_In_ BOOL IsCapture,
+	_Out_ PULONGLONG pLinearPosition)
+{
+	NTSTATUS Status = STATUS_SUCCESS;
+	PDEVICE_CONTEXT pDevExt = NULL;
+
+	//
+	// Called on every position query of the audio engine, so no function trace here.
+	//
+	if ((NULL == pContext)
+		|| (NULL == pLinearPosition))
+	{
+		DbgPrint_E("Invalid parameters.");
+		Status = STATUS_INVALID_PARAMETER;
+		goto Exit;
+	}
+
+	pDevExt = DeviceGetContext((WDFDEVICE)pContext);
+
+	Status = I2SDmaGetPosition(pDevExt, IsCapture, pLinearPosition);
+
+Exit:
+	return Status;
+}
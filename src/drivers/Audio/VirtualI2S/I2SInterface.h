@@ -60,6 +60,10 @@ typedef NTSTATUS (*PI2SSetStreamFormat)(_In_ PVOID pContext, _In_ BOOL IsCapture
 typedef NTSTATUS (*PI2SSetPowerState)(_In_ PVOID pContext, _In_ DEVICE_POWER_STATE PowerState);
 typedef NTSTATUS (*PI2SSetPowerDownCompletionCallback)(_In_ PVOID pContext, _In_ PI2S_POWER_DOWN_COMPLETION_CALLBACK pPowerDownCompletionCallback);
 
+// Bytes the DMA moved since the transfer started: the transfers it completed
+// plus the part of the current one its residue counter shows done.
+typedef NTSTATUS (*PI2SGetPosition)(_In_ PVOID pContext, _In_ BOOL IsCapture, _Out_ PULONGLONG pLinearPosition);
+
 typedef struct _I2S_FUNCTION_INTERFACE
 {
 	INTERFACE InterfaceHeader;
@@ -71,6 +75,7 @@ typedef struct _I2S_FUNCTION_INTERFACE
 	PI2SSetStreamFormat I2SSetStreamFormat;
 	PI2SSetPowerState I2SSetPowerState;
 	PI2SSetPowerDownCompletionCallback I2SSetPowerDownCompletionCallback;
+	PI2SGetPosition I2SGetPosition;
 } I2S_FUNCTION_INTERFACE, *PI2S_FUNCTION_INTERFACE;
 
 //
@@ -90,4 +95,5 @@ NTSTATUS I2SSetTransmitCallback(_In_ PVOID pContext, _In_ PI2S_TRANSMISSION_CALL
 NTSTATUS I2SSetReceiveCallback(_In_ PVOID pContext, _In_ PI2S_TRANSMISSION_CALLBACK pTransmissionCallback);
 NTSTATUS I2SSetStreamFormat(_In_ PVOID pContext, _In_ BOOL IsCapture, _In_ PWAVEFORMATEXTENSIBLE pWaveFormatExt);
 NTSTATUS I2SSetPowerState(_In_ PVOID pContext, _In_ DEVICE_POWER_STATE PowerState);
-NTSTATUS I2SSetPowerDownCompletionCallback(_In_ PVOID pContext, _In_ PI2S_POWER_DOWN_COMPLETION_CALLBACK pPowerDownCompletionCallback);
\ No newline at end of file
+NTSTATUS I2SSetPowerDownCompletionCallback(_In_ PVOID pContext, _In_ PI2S_POWER_DOWN_COMPLETION_CALLBACK pPowerDownCompletionCallback);
+NTSTATUS I2SGetPosition(_In_ PVOID pContext, _In_ BOOL IsCapture, _Out_ PULONGLONG pLinearPosition);
\ No newline at end of file
@@ -859,10 +859,10 @@ NTSTATUS CMiniportWaveRTStream::GetLinearBufferPosition(_Out_  ULONGLONG *_pullL
     // Get the current time and update position.
     //
     ilQPC = KeQueryPerformanceCounter(NULL);
-    //if (m_KsState == KSSTATE_RUN)
-    //{
-    //    UpdatePosition(ilQPC);
-    //}
+    if (m_KsState == KSSTATE_RUN)
+    {
+        UpdatePosition(ilQPC);
+    }
     if (_pliQPCTime)
     {
         *_pliQPCTime = ilQPC;
@@ -23,7 +23,10 @@ Abstract:
 #define MICARRAY_DEVICE_MAX_CHANNELS            2       // Max channels overall
 #define MICARRAY_MIN_BITS_PER_SAMPLE_PCM        16      // Min Bits Per Sample
 #define MICARRAY_MAX_BITS_PER_SAMPLE_PCM        16      // Max Bits Per Sample
-#define MICARRAY_RAW_SAMPLE_RATE                48000   // Raw sample rate
+#define MICARRAY_RAW_MIN_BITS_PER_SAMPLE        I2S_MIN_BITS_PER_SAMPLE // Raw min Bits Per Sample
+#define MICARRAY_RAW_MAX_BITS_PER_SAMPLE        I2S_MAX_BITS_PER_SAMPLE // Raw max Bits Per Sample
+#define MICARRAY_RAW_MIN_SAMPLE_RATE            I2S_MIN_SAMPLE_RATE     // Raw min sample rate
+#define MICARRAY_RAW_MAX_SAMPLE_RATE            I2S_MAX_SAMPLE_RATE     // Raw max sample rate
 #define MICARRAY_PROCESSED_MIN_SAMPLE_RATE      8000    // Min Sample Rate
 #define MICARRAY_PROCESSED_MAX_SAMPLE_RATE      48000   // Max Sample Rate
 
@@ -36,249 +39,22 @@ Abstract:
 static 
 KSDATAFORMAT_WAVEFORMATEXTENSIBLE MicArrayPinSupportedDeviceFormats[] =
 {
-    //// 0 - Note the ENDPOINT_MINIPAIR structures for the mic arrays use this first element as the proposed DEFAULT format
-    //// 48 KHz 16-bit mono
-    //{
-    //    {
-    //        sizeof(KSDATAFORMAT_WAVEFORMATEXTENSIBLE),
-    //        0,
-    //        0,
-    //        0,
-    //        STATICGUIDOF(KSDATAFORMAT_TYPE_AUDIO),
-    //        STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM),
-    //        STATICGUIDOF(KSDATAFORMAT_SPECIFIER_WAVEFORMATEX)
-    //    },
-    //    {
-    //        {
-    //            WAVE_FORMAT_EXTENSIBLE,
-    //            1,
-    //            48000,
-    //            96000,
-    //            2,
-    //            16,
-    //            sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX)
-    //        },
-    //        16,
-    //        KSAUDIO_SPEAKER_MONO,
-    //        STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM)
-    //    }
-    //},
-    //// 1
-    //// 8 KHz 16-bit mono
-    //{
-    //    {
-    //        sizeof(KSDATAFORMAT_WAVEFORMATEXTENSIBLE),
-    //        0,
-    //        0,
-    //        0,
-    //        STATICGUIDOF(KSDATAFORMAT_TYPE_AUDIO),
-    //        STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM),
-    //        STATICGUIDOF(KSDATAFORMAT_SPECIFIER_WAVEFORMATEX)
-    //    },
-    //    {
-    //        {
-    //            WAVE_FORMAT_EXTENSIBLE,
-    //            1,
-    //            8000,
-    //            16000,
-    //            2,
-    //            16,
-    //            sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX)
-    //        },
-    //        16,
-    //        KSAUDIO_SPEAKER_MONO,
-    //        STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM)
-    //    }
-    //},
-    //// 2
-    //// 11.025 KHz 16-bit mono
-    //{
-    //    {
-    //        sizeof(KSDATAFORMAT_WAVEFORMATEXTENSIBLE),
-    //        0,
-    //        0,
-    //        0,
-    //        STATICGUIDOF(KSDATAFORMAT_TYPE_AUDIO),
-    //        STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM),
-    //        STATICGUIDOF(KSDATAFORMAT_SPECIFIER_WAVEFORMATEX)
-    //    },
-    //    {
-    //        {
-    //            WAVE_FORMAT_EXTENSIBLE,
-    //            1,
-    //            11025,
-    //            22050,
-    //            2,
-    //            16,
-    //            sizeof(WAVEFORMATEXTENSIBLE)-sizeof(WAVEFORMATEX)
-    //        },
-    //        16,
-    //        KSAUDIO_SPEAKER_MONO,
-    //        STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM)
-    //    }
-    //},
-    //// 3 - Note the ENDPOINT_MINIPAIR structures for the mic arrays use this element as the proposed SPEECH format
-    //// 16 KHz 16-bit mono
-    //{
-    //    {
-    //        sizeof(KSDATAFORMAT_WAVEFORMATEXTENSIBLE),
-    //        0,
-    //        0,
-    //        0,
-    //        STATICGUIDOF(KSDATAFORMAT_TYPE_AUDIO),
-    //        STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM),
-    //        STATICGUIDOF(KSDATAFORMAT_SPECIFIER_WAVEFORMATEX)
-    //    },
-    //    {
-    //        {
-    //            WAVE_FORMAT_EXTENSIBLE,
-    //            1,      // One channel
-    //            16000,  // 16KHz
-    //            32000,  // average bytes per second
-    //            2,      // 2 bytes per frame
-    //            16,     // 16 bits per sample container
-    //            sizeof(WAVEFORMATEXTENSIBLE)-sizeof(WAVEFORMATEX)
-    //        },
-    //        16,         // valid bits per sample
-    //        KSAUDIO_SPEAKER_MONO,
-    //        STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM)
-    //    }
-    //},
-    //// 4
-    //// 22.05 KHz 16-bit mono
-    //{
-    //    {
-    //        sizeof(KSDATAFORMAT_WAVEFORMATEXTENSIBLE),
-    //        0,
-    //        0,
-    //        0,
-    //        STATICGUIDOF(KSDATAFORMAT_TYPE_AUDIO),
-    //        STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM),
-    //        STATICGUIDOF(KSDATAFORMAT_SPECIFIER_WAVEFORMATEX)
-    //    },
-    //    {
-    //        {
-    //            WAVE_FORMAT_EXTENSIBLE,
-    //            1,
-    //            22050,
-    //            44100,
-    //            2,
-    //            16,
-    //            sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX)
-    //        },
-    //        16,
-    //        KSAUDIO_SPEAKER_MONO,
-    //        STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM)
-    //    }
-    //},
-    //// 5 - Note the ENDPOINT_MINIPAIR structures for the mic arrays use this element as the proposed COMMUNICATIONS format
-    //// 24 KHz 16-bit mono
-    //{
-    //    {
-    //        sizeof(KSDATAFORMAT_WAVEFORMATEXTENSIBLE),
-    //        0,
-    //        0,
-    //        0,
-    //        STATICGUIDOF(KSDATAFORMAT_TYPE_AUDIO),
-    //        STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM),
-    //        STATICGUIDOF(KSDATAFORMAT_SPECIFIER_WAVEFORMATEX)
-    //    },
-    //    {
-    //        {
-    //            WAVE_FORMAT_EXTENSIBLE,
-    //            1,
-    //            24000,
-    //            48000,
-    //            2,
-    //            16,
-    //            sizeof(WAVEFORMATEXTENSIBLE)-sizeof(WAVEFORMATEX)
-    //        },
-    //        16,
-    //        KSAUDIO_SPEAKER_MONO,
-    //        STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM)
-    //    }
-    //},
-    //// 6
-    //// 32 KHz 16-bit mono
-    //{
-    //    {
-    //        sizeof(KSDATAFORMAT_WAVEFORMATEXTENSIBLE),
-    //        0,
-    //        0,
-    //        0,
-    //        STATICGUIDOF(KSDATAFORMAT_TYPE_AUDIO),
-    //        STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM),
-    //        STATICGUIDOF(KSDATAFORMAT_SPECIFIER_WAVEFORMATEX)
-    //    },
-    //    {
-    //        {
-    //            WAVE_FORMAT_EXTENSIBLE,
-    //            1,
-    //            32000,
-    //            64000,
-    //            2,
-    //            16,
-    //            sizeof(WAVEFORMATEXTENSIBLE)-sizeof(WAVEFORMATEX)
-    //        },
-    //        16,
-    //        KSAUDIO_SPEAKER_MONO,
-    //        STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM)
-    //    }
-    //},
-    //// 7
-    //// 44.1 KHz 16-bit mono
-    //{
-    //    {
-    //        sizeof(KSDATAFORMAT_WAVEFORMATEXTENSIBLE),
-    //        0,
-    //        0,
-    //        0,
-    //        STATICGUIDOF(KSDATAFORMAT_TYPE_AUDIO),
-    //        STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM),
-    //        STATICGUIDOF(KSDATAFORMAT_SPECIFIER_WAVEFORMATEX)
-    //    },
-    //    {
-    //        {
-    //            WAVE_FORMAT_EXTENSIBLE,
-    //            1,
-    //            44100,
-    //            88200,
-    //            2,
-    //            16,
-    //            sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX)
-    //        },
-    //        16,
-    //        KSAUDIO_SPEAKER_MONO,
-    //        STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM)
-    //    }
-    //},
-    // 8 - Note the ENDPOINT_MINIPAIR structures for the mic arrays use this last element as the proposed RAW format
-    // 48 KHz 16-bit 2 channels
-    {
-        {
-            sizeof(KSDATAFORMAT_WAVEFORMATEXTENSIBLE),
-            0,
-            0,
-            0,
-            STATICGUIDOF(KSDATAFORMAT_TYPE_AUDIO),
-            STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM),
-            STATICGUIDOF(KSDATAFORMAT_SPECIFIER_WAVEFORMATEX)
-        },
-        {
-            {
-                WAVE_FORMAT_EXTENSIBLE,
-                2,
-                48000,
-                192000,
-                4,
-                16,
-                sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX)
-            },
-            16,
-            0,                                      // No channel configuration for unprocessed mic array
-            STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM)
-        }
-    },
+    //
+    // Stereo at every rate the codec clocks natively, no channel configuration
+    // for the unprocessed mic array.
+    //
+    I2S_DEVICE_FORMATS_FOR_RATE(8000, 0),
+    I2S_DEVICE_FORMATS_FOR_RATE(11025, 0),
+    I2S_DEVICE_FORMATS_FOR_RATE(12000, 0),
+    I2S_DEVICE_FORMATS_FOR_RATE(16000, 0),
+    I2S_DEVICE_FORMATS_FOR_RATE(22050, 0),
+    I2S_DEVICE_FORMATS_FOR_RATE(24000, 0),
+    I2S_DEVICE_FORMATS_FOR_RATE(32000, 0),
+    I2S_DEVICE_FORMATS_FOR_RATE(44100, 0),
+    I2S_DEVICE_FORMATS_FOR_RATE(96000, 0),
+    I2S_DEVICE_FORMATS_FOR_RATE(192000, 0),
+    I2S_DEVICE_FORMAT(48000, 32, 24, 0),
+    I2S_DEVICE_FORMAT(48000, 16, 16, 0),    // Last, the raw mode default
 };
 
 //
@@ -398,10 +174,10 @@ KSDATARANGE_AUDIO MicArrayPinDataRangesRawStream[] =
             STATICGUIDOF(KSDATAFORMAT_SPECIFIER_WAVEFORMATEX)
         },
         MICARRAY_RAW_CHANNELS,           
-        MICARRAY_MIN_BITS_PER_SAMPLE_PCM,    
-        MICARRAY_MAX_BITS_PER_SAMPLE_PCM,    
-        MICARRAY_RAW_SAMPLE_RATE,            
-        MICARRAY_RAW_SAMPLE_RATE             
+        MICARRAY_RAW_MIN_BITS_PER_SAMPLE,    
+        MICARRAY_RAW_MAX_BITS_PER_SAMPLE,    
+        MICARRAY_RAW_MIN_SAMPLE_RATE,            
+        MICARRAY_RAW_MAX_SAMPLE_RATE             
     },
 };
 
@@ -19,6 +19,8 @@ void NotificationRT
 	CMiniportWaveRTStream *pStream = NULL;
 	PADAPTERCOMMON  pAdapterComm = NULL;
 	LARGE_INTEGER Qpc = { 0 };
+	KIRQL OldIrql;
+	BOOLEAN bEoSPassed = FALSE;
 
 	//FunctionEnter();
 
@@ -36,13 +38,26 @@ void NotificationRT
 	pStream = (CMiniportWaveRTStream *)pContext;
 	pAdapterComm = pStream->m_pMiniport->GetAdapterCommObj();
 
-	//TODO:
+	//
+	// A completed transfer is an exact position, position queries in between add the
+	// residue of the transfer in progress (see UpdatePosition).
+	//
 	Qpc = KeQueryPerformanceCounter(NULL);
-	pStream->m_ullDmaTimeStamp = KSCONVERT_PERFORMANCE_TIME(pStream->m_ullPerformanceCounterFrequency.QuadPart, Qpc);
 
-	pStream->m_ullWritePosition = (pStream->m_ullWritePosition + BytesTransferred) % pStream->m_ulDmaBufferSize;
-	pStream->m_ullPlayPosition = pStream->m_ullWritePosition;
-	pStream->m_ullLinearPosition += BytesTransferred;
+	KeAcquireSpinLock(&pStream->m_PositionLock, &OldIrql);
+	pStream->m_ullDmaCompletedPosition += BytesTransferred;
+	bEoSPassed = pStream->AdvancePosition(pStream->m_ullDmaCompletedPosition,
+		KSCONVERT_PERFORMANCE_TIME(pStream->m_ullPerformanceCounterFrequency.QuadPart, Qpc));
+	KeReleaseSpinLock(&pStream->m_PositionLock, OldIrql);
+
+	if (bEoSPassed)
+	{
+		pAdapterComm->WriteEtwEvent(eMINIPORT_LAST_BUFFER_RENDERED,
+			pStream->m_ullDmaCompletedPosition, // Current linear buffer position
+			pStream->m_ulCurrentWritePosition, // The very last WaveRtBufferWritePosition that the driver received
+			0,
+			0);
+	}
 
 	// TODO:
 	if (0 == BytesTransferred % (pStream->m_ulDmaBufferSize / pStream->m_ulNotificationsPerBuffer))
@@ -168,6 +183,12 @@ Return Value:
         ExFreePoolWithTag( m_pWfExt, MINWAVERTSTREAM_POOLTAG );
         m_pWfExt = NULL;
     }
+
+    if (m_pulPositionRegister)
+    {
+        ExFreePoolWithTag( (PVOID)m_pulPositionRegister, MINWAVERTSTREAM_POOLTAG );
+        m_pulPositionRegister = NULL;
+    }
     DPF_ENTER(("[CMiniportWaveRTStream::~CMiniportWaveRTStream]"));
 } // ~CMiniportWaveRTStream
 
@@ -228,7 +249,6 @@ Return Value:
     m_ullPlayPosition = 0;
     m_ullWritePosition = 0;
     m_ullDmaTimeStamp = 0;
-    m_hnsElapsedTimeCarryForward = 0;
     m_ulDmaMovementRate = 0;
     m_bLfxEnabled = FALSE;
     m_pbMuted = NULL;
@@ -236,6 +256,9 @@ Return Value:
     m_plPeakMeter = NULL;
     m_pWfExt = NULL;
     m_ullLinearPosition = 0;
+    m_ullDmaCompletedPosition = 0;
+    m_pulPositionRegister = NULL;
+    KeInitializeSpinLock(&m_PositionLock);
     m_ulContentId = 0;
     m_ulCurrentWritePosition = 0;
     m_ulLastOsReadPacket = ULONG_MAX;
@@ -275,6 +298,14 @@ Return Value:
         return STATUS_INSUFFICIENT_RESOURCES;
     }
 
+    // Portcls maps the position register into the audio engine, give it a page of its own.
+    m_pulPositionRegister = (volatile ULONG *)ExAllocatePoolWithTag(NonPagedPoolNx, PAGE_SIZE, MINWAVERTSTREAM_POOLTAG);
+    if (!m_pulPositionRegister)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+    RtlZeroMemory((PVOID)m_pulPositionRegister, PAGE_SIZE);
+
     m_pWfExt = (PWAVEFORMATEXTENSIBLE)ExAllocatePoolWithTag(NonPagedPoolNx, sizeof(WAVEFORMATEX) + pWfEx->cbSize, MINWAVERTSTREAM_POOLTAG);
     if (m_pWfExt == NULL)
     {
@@ -303,50 +334,6 @@ Return Value:
     }
     RtlZeroMemory(m_plPeakMeter, m_pWfExt->Format.nChannels * sizeof(LONG));
 
-    if (m_bCapture)
-    {
-        DWORD toneFrequency = 0;
-
-        if (m_pMiniport->IsLoopbackPin(Pin_))
-        {
-            //
-            // Loopbacks pins use a different frequency for test validation.
-            //
-            toneFrequency = 3000; // 3 kHz
-        }
-        else 
-        {
-            //
-            // Init sine wave generator. To exercise the SignalProcessingMode parameter
-            // this sample driver selects the frequency based on the parameter.
-            //
-            toneFrequency = IsEqualGUID(SignalProcessingMode, AUDIO_SIGNALPROCESSINGMODE_RAW) ? 1000 : 2000;
-        }
-
-        ntStatus = m_ToneGenerator.Init(toneFrequency, m_pWfExt);
-        if (!NT_SUCCESS(ntStatus))
-        {
-            return ntStatus;
-        }
-    }
-    else if (!g_DoNotCreateDataFiles)
-    {
-        //
-        // Create an output file for the render data.
-        //
-        DPF(D_TERSE, "SaveData %p", &m_SaveData);
-        ntStatus = m_SaveData.SetDataFormat(DataFormat_);
-        if (NT_SUCCESS(ntStatus))
-        {
-            ntStatus = m_SaveData.Initialize(m_pMiniport->IsOffloadPin(Pin_));
-        }
-    
-        if (!NT_SUCCESS(ntStatus))
-        {
-            return ntStatus;
-        }
-    }
-
     //
     // Register this stream.
     //
@@ -463,17 +450,15 @@ NTSTATUS CMiniportWaveRTStream::AllocateBufferWithNotification
         return STATUS_INVALID_PARAMETER;
     }
 
-    RequestedSize_ -= RequestedSize_ % (m_pWfExt->Format.nBlockAlign);
-    
-    if (!m_bCapture && !g_DoNotCreateDataFiles)
+    //
+    // Every notification period is one I2S DMA transfer, keep each a whole
+    // number of frames so transfers stay aligned to the DMA word at every
+    // sample size.
+    //
+    RequestedSize_ -= RequestedSize_ % (m_pWfExt->Format.nBlockAlign * NotificationCount_);
+    if (0 == RequestedSize_)
     {
-        NTSTATUS ntStatus;
-        
-        ntStatus = m_SaveData.SetMaxWriteSize(RequestedSize_);    
-        if (!NT_SUCCESS(ntStatus))
-        {
-            return ntStatus;
-        }
+        return STATUS_UNSUCCESSFUL;
     }
 
     PHYSICAL_ADDRESS highAddress;
@@ -646,12 +631,33 @@ NTSTATUS CMiniportWaveRTStream::GetPositionRegister
 (
     _Out_ PKSRTAUDIO_HWREGISTER Register_
 )
-{
-    UNREFERENCED_PARAMETER(Register_);
+/*++
+
+Routine Description:
+
+  The I2S DMA has no register holding the buffer offset, only the residue of
+  the transfer in progress. The register handed out is a word in memory that
+  holds the play (render) or write (capture) offset, refreshed on every
+  completed transfer and every position query, so it is at most one packet
+  behind the DMA.
 
+--*/
+{
     PAGED_CODE();
 
-    return STATUS_NOT_IMPLEMENTED;
+    if (m_pulPositionRegister == NULL)
+    {
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    Register_->Register = (PVOID)m_pulPositionRegister;
+    Register_->Width = 32;
+    Register_->Numerator = 0;
+    Register_->Denominator = 0;
+    Register_->Accuracy = m_ulNotificationsPerBuffer ?
+        m_ulDmaBufferSize / m_ulNotificationsPerBuffer : m_ulDmaBufferSize;
+
+    return STATUS_SUCCESS;
 }
 
 //=============================================================================
@@ -680,7 +686,7 @@ VOID CMiniportWaveRTStream::GetHWLatency
 		else
 		{
 			ULONG CodecDelay = 10 * 1000000; // 100-ns
-			CodecDelay = m_ulDmaBufferSize * CodecDelay / (m_pWfExt->Format.nSamplesPerSec * (m_pWfExt->Format.wBitsPerSample / 8) * m_pWfExt->Format.nChannels);
+			CodecDelay = (ULONG)((ULONGLONG)m_ulDmaBufferSize * CodecDelay / m_pWfExt->Format.nAvgBytesPerSec);
 			//DbgPrint_E("Codec delay [0x%lu 100-ns].", CodecDelay);
 			Latency_->ChipsetDelay = 0;
 			Latency_->CodecDelay = CodecDelay;
@@ -793,14 +799,14 @@ NTSTATUS CMiniportWaveRTStream::GetPosition
         return STATUS_NOT_SUPPORTED;
     }
 
-    //if (m_KsState == KSSTATE_RUN)
-    //{
-    //    //
-    //    // Get the current time and update position.
-    //    //
-    //    LARGE_INTEGER ilQPC = KeQueryPerformanceCounter(NULL);
-    //    UpdatePosition(ilQPC);
-    //}
+    if (m_KsState == KSSTATE_RUN)
+    {
+        //
+        // Get the current time and update position.
+        //
+        LARGE_INTEGER ilQPC = KeQueryPerformanceCounter(NULL);
+        UpdatePosition(ilQPC);
+    }
 
     Position_->PlayOffset = m_ullPlayPosition;
     Position_->WriteOffset = m_ullWritePosition;
@@ -866,15 +872,15 @@ NTSTATUS CMiniportWaveRTStream::GetReadPacket
         return ntStatus;
     }
 
-    //if (m_KsState == KSSTATE_RUN)
-    //{
-    //    //
-    //    // Get the current time and update simulated position.
-    //    //
-    //    LARGE_INTEGER ilQPC = KeQueryPerformanceCounter(NULL);
+    if (m_KsState == KSSTATE_RUN)
+    {
+        //
+        // Get the current time and update position.
+        //
+        LARGE_INTEGER ilQPC = KeQueryPerformanceCounter(NULL);
 
-    //    UpdatePosition(ilQPC);
-    //}
+        UpdatePosition(ilQPC);
+    }
 
     // The 0-based number of the last completed packet
     // FUTURE-2014/10/27 Update to allow different numbers of packets per WaveRT buffer
@@ -899,11 +905,10 @@ NTSTATUS CMiniportWaveRTStream::GetReadPacket
     // Return next packet number to be read
     *PacketNumber = availablePacketNumber;
 
-    // Compute and return timestamp corresponding to start of the available packet. In a real hardware
-    // driver, the timestamp would be computed in a driver and hardware specific manner. In this sample
-    // driver, it is extrapolated from the sample driver's internal simulated position corrleation
-    // [m_ullLinearPosition @ m_ullDmaTimeStamp] and the sample's internal 64-bit packet counter, subtracting
-    // 1 from the packet counter to compute the time at the start of that last completed packet.
+    // Compute and return timestamp corresponding to start of the available packet. It is extrapolated
+    // from the DMA position correlation [m_ullLinearPosition @ m_ullDmaTimeStamp] and the internal
+    // 64-bit packet counter, subtracting 1 from the packet counter to compute the time at the start of
+    // that last completed packet.
     ULONGLONG linearPositionOfAvailablePacket = (m_llPacketCounter - 1) * (m_ulDmaBufferSize / m_ulNotificationsPerBuffer);
     ULONGLONG deltaLinearPosition = m_ullLinearPosition - linearPositionOfAvailablePacket;
     ULONGLONG deltaTimeInHns = deltaLinearPosition * 10000000 / m_ulDmaMovementRate;
@@ -1147,18 +1152,14 @@ NTSTATUS CMiniportWaveRTStream::SetState
             m_ullPlayPosition = 0;
             m_ullWritePosition = 0;
             m_ullLinearPosition = 0;
+            m_ullDmaCompletedPosition = 0;
+            *m_pulPositionRegister = 0;
             
             // Reset OS read/write positions
             m_ulLastOsReadPacket = ULONG_MAX;
             m_ulCurrentWritePosition = 0;
             m_ulLastOsWritePacket = ULONG_MAX;
             m_llEoSPosition = (-1);
-            
-            // Wait until all work items are completed.
-            if (!m_bCapture && !g_DoNotCreateDataFiles)
-            {
-                m_SaveData.WaitAllWorkItems();
-            }
             break;
 
         case KSSTATE_ACQUIRE:
@@ -1188,6 +1189,8 @@ NTSTATUS CMiniportWaveRTStream::SetState
 			m_ullPlayPosition = 0;
 			m_ullWritePosition = 0;
 			m_ullLinearPosition = 0;
+			m_ullDmaCompletedPosition = 0;
+			*m_pulPositionRegister = 0;
 			// Reset OS read/write positions
 			m_ulLastOsReadPacket = ULONG_MAX;
 			m_ulCurrentWritePosition = 0;
@@ -1205,7 +1208,6 @@ NTSTATUS CMiniportWaveRTStream::SetState
             }
             ullPerfCounterTemp = KeQueryPerformanceCounter(&m_ullPerformanceCounterFrequency);
             m_ullDmaTimeStamp = KSCONVERT_PERFORMANCE_TIME(m_ullPerformanceCounterFrequency.QuadPart, ullPerfCounterTemp);
-            m_hnsElapsedTimeCarryForward  = 0;
 
 			SIGNALPROCESSINGMODE Mode = SIGNALPROCESSINGMODE_NONE;
 			MAP_GUID_TO_MODE(m_SignalProcessingMode, Mode);
@@ -1308,127 +1310,111 @@ VOID CMiniportWaveRTStream::UpdatePosition
 (
     _In_ LARGE_INTEGER ilQPC
 )
-{
-    // Convert ticks to 100ns units.
-    LONGLONG  hnsCurrentTime = KSCONVERT_PERFORMANCE_TIME(m_ullPerformanceCounterFrequency.QuadPart, ilQPC);
-    
-    // Calculate the time elapsed since the last call to GetPosition() or since the
-    // DMA engine started.  Note that the division by 10000 to convert to milliseconds
-    // may cause us to lose some of the time, so we will carry the remainder forward 
-    // to the next GetPosition() call.
-    //
-    ULONG TimeElapsedInMS = (ULONG)(hnsCurrentTime - m_ullDmaTimeStamp + m_hnsElapsedTimeCarryForward)/10000;
-    
-    // Carry forward the remainder of this division so we don't fall behind with our position too much.
-    //
-    m_hnsElapsedTimeCarryForward = (hnsCurrentTime - m_ullDmaTimeStamp + m_hnsElapsedTimeCarryForward) % 10000;
-    
-    // Calculate how many bytes in the DMA buffer would have been processed in the elapsed
-    // time.  Note that the division by 1000 to convert to milliseconds may cause us to 
-    // lose some bytes, so we will carry the remainder forward to the next GetPosition() call.
-    //
-    // need to divide by 1000 because m_ulDmaMovementRate is average bytes per sec.
-    ULONG ByteDisplacement = (m_ulDmaMovementRate * TimeElapsedInMS) / 1000;
-    
-    if (m_bCapture)
-    {
-        // Write sine wave to buffer.
-        WriteBytes(ByteDisplacement);
-    }
-    else if (!g_DoNotCreateDataFiles)
-    {
-        // Read from buffer and write to a file.
-        ReadBytes(ByteDisplacement);
-        
-        // If the last packet was rendered(read in the sample driver's case), send out an etw event.
-        if ( (m_llEoSPosition >= 0) 
-          && ((m_llEoSPosition - m_ullLinearPosition) < ByteDisplacement))
-        {
-            PADAPTERCOMMON pAdapterComm = m_pMiniport->GetAdapterCommObj();
-            pAdapterComm->WriteEtwEvent(eMINIPORT_LAST_BUFFER_RENDERED, 
-                                        m_ullLinearPosition + ByteDisplacement, // Current linear buffer position  
-                                        m_ulCurrentWritePosition, // The very last WaveRtBufferWritePosition that the driver received
-                                        0, 
-                                        0);
-        }
-    }
-    
-    // Increment the DMA position by the number of bytes displaced since the last
-    // call to UpdatePosition() and ensure we properly wrap at buffer length.
-    //
-    m_ullPlayPosition = m_ullWritePosition =
-        (m_ullWritePosition + ByteDisplacement) % m_ulDmaBufferSize;
-    
-    // m_ullDmaTimeStamp is updated in both GetPostion and GetLinearPosition calls
-    // so m_ullLinearPosition needs to be updated accordingly here
-    //
-    m_ullLinearPosition += ByteDisplacement;
-    
-    // Update the DMA time stamp for the next call to GetPosition()
-    //
-    m_ullDmaTimeStamp = hnsCurrentTime;
-}
-
-//=============================================================================
-#pragma code_seg()
-VOID CMiniportWaveRTStream::WriteBytes
-(
-_In_ ULONG ByteDisplacement
-)
 /*++
 
 Routine Description:
 
-This function writes the audio buffer using a sine wave generator.
+  Updates the stream position from the I2S DMA: the bytes of the transfers it
+  completed plus the part of the current transfer its residue counter shows
+  done. Following the DMA instead of extrapolating from QPC time keeps the
+  position locked to the I2S clock however long the stream runs. When the I2S
+  driver cannot tell, the position stays at the last completed transfer.
 
 Arguments:
 
-ByteDisplacement - # of bytes to process.
+  ilQPC - performance counter value of the query.
 
 --*/
 {
-    ULONG bufferOffset = m_ullLinearPosition % m_ulDmaBufferSize;
+    PADAPTERCOMMON  pAdapterComm = m_pMiniport->GetAdapterCommObj();
+    I2S_FUNCTION_INTERFACE *pI2sInterface = pAdapterComm->GetI2sFunctionInterface();
+    ULONGLONG       ullDmaPosition = 0;
+    BOOLEAN         bEoSPassed;
+    KIRQL           oldIrql;
+
+    if ((NULL == pI2sInterface) || (NULL == pI2sInterface->I2SGetPosition))
+    {
+        return;
+    }
+
+    if (!NT_SUCCESS(pI2sInterface->I2SGetPosition(pI2sInterface->InterfaceHeader.Context, m_bCapture, &ullDmaPosition)))
+    {
+        return;
+    }
+
+    // Report whole frames only, the DMA moves 16-bit words.
+    ullDmaPosition -= ullDmaPosition % m_pWfExt->Format.nBlockAlign;
+
+    // Convert ticks to 100ns units.
+    LONGLONG  hnsCurrentTime = KSCONVERT_PERFORMANCE_TIME(m_ullPerformanceCounterFrequency.QuadPart, ilQPC);
+
+    KeAcquireSpinLock(&m_PositionLock, &oldIrql);
+    bEoSPassed = AdvancePosition(ullDmaPosition, hnsCurrentTime);
+    KeReleaseSpinLock(&m_PositionLock, oldIrql);
 
-    // Normally this will loop no more than once for a single wrap, but if
-    // many bytes have been displaced then this may loops many times.
-    while (ByteDisplacement > 0)
+    // If the last packet was rendered, send out an etw event.
+    if (bEoSPassed)
     {
-        ULONG runWrite = min(ByteDisplacement, m_ulDmaBufferSize - bufferOffset);
-        m_ToneGenerator.GenerateSine(m_pDmaBuffer + bufferOffset, runWrite);
-        bufferOffset = (bufferOffset + runWrite) % m_ulDmaBufferSize;
-        ByteDisplacement -= runWrite;
+        pAdapterComm->WriteEtwEvent(eMINIPORT_LAST_BUFFER_RENDERED, 
+                                    ullDmaPosition, // Current linear buffer position  
+                                    m_ulCurrentWritePosition, // The very last WaveRtBufferWritePosition that the driver received
+                                    0, 
+                                    0);
     }
 }
 
 //=============================================================================
 #pragma code_seg()
-VOID CMiniportWaveRTStream::ReadBytes
+BOOLEAN CMiniportWaveRTStream::AdvancePosition
 (
-_In_ ULONG ByteDisplacement
+    _In_ ULONGLONG ullLinearPosition,
+    _In_ ULONGLONG hnsTime
 )
 /*++
 
 Routine Description:
 
-This function reads the audio buffer and saves the data in a file.
+  Moves the position forward to a DMA position read at hnsTime. The
+  completion callback and position queries race to report the same
+  transfer, so a position behind the current one is ignored. Called with
+  m_PositionLock held.
 
 Arguments:
 
-ByteDisplacement - # of bytes to process.
+  ullLinearPosition - bytes moved by the DMA since the stream started.
+
+  hnsTime - time the position was read, in 100ns units.
+
+Return Value:
+
+  TRUE when a render stream passed its end of stream position.
 
 --*/
 {
-    ULONG bufferOffset = m_ullLinearPosition % m_ulDmaBufferSize;
+    BOOLEAN bEoSPassed = FALSE;
+
+    if (ullLinearPosition <= m_ullLinearPosition)
+    {
+        return FALSE;
+    }
 
-    // Normally this will loop no more than once for a single wrap, but if
-    // many bytes have been displaced then this may loops many times.
-    while (ByteDisplacement > 0)
+    if (!m_bCapture
+      && (m_llEoSPosition >= 0)
+      && ((ULONGLONG)m_llEoSPosition > m_ullLinearPosition)
+      && ((ULONGLONG)m_llEoSPosition <= ullLinearPosition))
     {
-        ULONG runWrite = min(ByteDisplacement, m_ulDmaBufferSize - bufferOffset);
-        m_SaveData.WriteData(m_pDmaBuffer + bufferOffset, runWrite);
-        bufferOffset = (bufferOffset + runWrite) % m_ulDmaBufferSize;
-        ByteDisplacement -= runWrite;
+        bEoSPassed = TRUE;
     }
+
+    m_ullLinearPosition = ullLinearPosition;
+    m_ullPlayPosition = m_ullWritePosition = ullLinearPosition % m_ulDmaBufferSize;
+    *m_pulPositionRegister = (ULONG)m_ullPlayPosition;
+
+    // m_ullDmaTimeStamp is the time of m_ullLinearPosition, GetReadPacket
+    // extrapolates packet times from the pair.
+    m_ullDmaTimeStamp = hnsTime;
+
+    return bEoSPassed;
 }
 
 //=============================================================================
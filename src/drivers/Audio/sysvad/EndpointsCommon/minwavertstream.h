@@ -106,13 +106,15 @@ protected:
     ULONGLONG                   m_ullPlayPosition;
     ULONGLONG                   m_ullWritePosition;
     ULONGLONG                   m_ullLinearPosition;
+    ULONGLONG                   m_ullDmaCompletedPosition;
+    KSPIN_LOCK                  m_PositionLock;
+    volatile ULONG             *m_pulPositionRegister;
     ULONG                       m_ulLastOsReadPacket;
     ULONG                       m_ulLastOsWritePacket;
     LONGLONG                    m_llEoSPosition;
     LONGLONG                    m_llPacketCounter;
     ULONGLONG                   m_ullDmaTimeStamp;
     LARGE_INTEGER               m_ullPerformanceCounterFrequency;
-    ULONGLONG                   m_hnsElapsedTimeCarryForward;
     ULONG                       m_ulDmaMovementRate;
     BOOL                        m_bLfxEnabled;
     PBOOL                       m_pbMuted;
@@ -230,19 +232,15 @@ public:
 private:
 
     // Helper functions.
-    VOID WriteBytes
-    (
-        _In_ ULONG ByteDisplacement
-    );
-    
-    VOID ReadBytes
+    VOID UpdatePosition
     (
-        _In_ ULONG ByteDisplacement
+        _In_ LARGE_INTEGER ilQPC
     );
     
-    VOID UpdatePosition
+    BOOLEAN AdvancePosition
     (
-        _In_ LARGE_INTEGER ilQPC
+        _In_ ULONGLONG ullLinearPosition,
+        _In_ ULONGLONG hnsTime
     );
     
     NTSTATUS SetCurrentWritePositionInternal
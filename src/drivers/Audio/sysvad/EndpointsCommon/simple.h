@@ -166,5 +166,49 @@ KSATTRIBUTE_LIST PinDataRangeAttributeList =
     PinDataRangeAttributes,
 };
 
+//
+// Stereo PCM device format for the I2S endpoints. The I2S DMA moves 16-bit
+// samples as 16-bit words and 24 or 32-bit samples in 32-bit containers.
+//
+#define I2S_DEVICE_FORMAT(_Rate_, _ContainerBits_, _ValidBits_, _ChannelMask_)  \
+    {                                                                           \
+        {                                                                       \
+            sizeof(KSDATAFORMAT_WAVEFORMATEXTENSIBLE),                          \
+            0,                                                                  \
+            0,                                                                  \
+            0,                                                                  \
+            STATICGUIDOF(KSDATAFORMAT_TYPE_AUDIO),                              \
+            STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM),                             \
+            STATICGUIDOF(KSDATAFORMAT_SPECIFIER_WAVEFORMATEX)                   \
+        },                                                                      \
+        {                                                                       \
+            {                                                                   \
+                WAVE_FORMAT_EXTENSIBLE,                                         \
+                2,                                                              \
+                (_Rate_),                                                       \
+                (_Rate_) * 2 * ((_ContainerBits_) / 8),                         \
+                2 * ((_ContainerBits_) / 8),                                    \
+                (_ContainerBits_),                                              \
+                sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX)             \
+            },                                                                  \
+            (_ValidBits_),                                                      \
+            (_ChannelMask_),                                                    \
+            STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM)                              \
+        }                                                                       \
+    }
+
+//
+// The sample rates and sample sizes the codec can clock natively, listed
+// for every rate so no I2S endpoint is run through the OS resampler.
+//
+#define I2S_DEVICE_FORMATS_FOR_RATE(_Rate_, _ChannelMask_)                      \
+    I2S_DEVICE_FORMAT(_Rate_, 16, 16, _ChannelMask_),                           \
+    I2S_DEVICE_FORMAT(_Rate_, 32, 24, _ChannelMask_)
+
+#define I2S_MIN_BITS_PER_SAMPLE     16
+#define I2S_MAX_BITS_PER_SAMPLE     32
+#define I2S_MIN_SAMPLE_RATE         8000
+#define I2S_MAX_SAMPLE_RATE         192000
+
 #endif  // _SYSVAD_SIMPLE_H_
 
@@ -58,6 +58,10 @@ typedef NTSTATUS (*PI2SSetStreamFormat)(_In_ PVOID pContext, _In_ BOOL IsCapture
 typedef NTSTATUS (*PI2SSetPowerState)(_In_ PVOID pContext, _In_ DEVICE_POWER_STATE PowerState);
 typedef NTSTATUS (*PI2SSetPowerDownCompletionCallback)(_In_ PVOID pContext, _In_ PI2S_POWER_DOWN_COMPLETION_CALLBACK pPowerDownCompletionCallback);
 
+// Bytes the DMA moved since the transfer started: the transfers it completed
+// plus the part of the current one its residue counter shows done.
+typedef NTSTATUS (*PI2SGetPosition)(_In_ PVOID pContext, _In_ BOOL IsCapture, _Out_ PULONGLONG pLinearPosition);
+
 typedef struct _I2S_FUNCTION_INTERFACE
 {
 	INTERFACE InterfaceHeader;
@@ -69,4 +73,5 @@ typedef struct _I2S_FUNCTION_INTERFACE
 	PI2SSetStreamFormat I2SSetStreamFormat;
 	PI2SSetPowerState I2SSetPowerState;
 	PI2SSetPowerDownCompletionCallback I2SSetPowerDownCompletionCallback;
+	PI2SGetPosition I2SGetPosition;
 } I2S_FUNCTION_INTERFACE, *PI2S_FUNCTION_INTERFACE;
@@ -19,16 +19,17 @@ Abstract:
 #define _SYSVAD_HANDSETSPEAKERWAVTABLE_H_
 
 
-// To keep the code simple assume device supports only 48KHz, 16-bit, stereo (PCM and NON-PCM)
+// The device runs stereo PCM at every rate from 8KHz to 192KHz the codec clocks natively
+// (not 64KHz, 88.2KHz or 176.4KHz), 16-bit, or 24-bit in 32-bit containers.
 
 
 #define HANDSETSPEAKER_DEVICE_MAX_CHANNELS                 2       // Max Channels.
 
 #define HANDSETSPEAKER_HOST_MAX_CHANNELS                   2       // Max Channels.
-#define HANDSETSPEAKER_HOST_MIN_BITS_PER_SAMPLE            16      // Min Bits Per Sample
-#define HANDSETSPEAKER_HOST_MAX_BITS_PER_SAMPLE            16      // Max Bits Per Sample
-#define HANDSETSPEAKER_HOST_MIN_SAMPLE_RATE                48000//24000   // Min Sample Rate
-#define HANDSETSPEAKER_HOST_MAX_SAMPLE_RATE                48000//96000   // Max Sample Rate
+#define HANDSETSPEAKER_HOST_MIN_BITS_PER_SAMPLE            I2S_MIN_BITS_PER_SAMPLE    // Min Bits Per Sample
+#define HANDSETSPEAKER_HOST_MAX_BITS_PER_SAMPLE            I2S_MAX_BITS_PER_SAMPLE    // Max Bits Per Sample
+#define HANDSETSPEAKER_HOST_MIN_SAMPLE_RATE                I2S_MIN_SAMPLE_RATE        // Min Sample Rate
+#define HANDSETSPEAKER_HOST_MAX_SAMPLE_RATE                I2S_MAX_SAMPLE_RATE        // Max Sample Rate
 
 #define HANDSETSPEAKER_LOOPBACK_MAX_CHANNELS               HANDSETSPEAKER_HOST_MAX_CHANNELS          // Must be equal to host pin's Max Channels.
 #define HANDSETSPEAKER_LOOPBACK_MIN_BITS_PER_SAMPLE        HANDSETSPEAKER_HOST_MIN_BITS_PER_SAMPLE   // Must be equal to host pin's Min Bits Per Sample
@@ -52,156 +53,18 @@ Abstract:
 static 
 KSDATAFORMAT_WAVEFORMATEXTENSIBLE HandsetSpeakerHostPinSupportedDeviceFormats[] =
 {
-    //{ // 0
-    //    {
-    //        sizeof(KSDATAFORMAT_WAVEFORMATEXTENSIBLE),
-    //        0,
-    //        0,
-    //        0,
-    //        STATICGUIDOF(KSDATAFORMAT_TYPE_AUDIO),
-    //        STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM),
-    //        STATICGUIDOF(KSDATAFORMAT_SPECIFIER_WAVEFORMATEX)
-    //    },
-    //    {
-    //        {
-    //            WAVE_FORMAT_EXTENSIBLE,
-    //            2,
-    //            24000,
-    //            96000,
-    //            4,
-    //            16,
-    //            sizeof(WAVEFORMATEXTENSIBLE)-sizeof(WAVEFORMATEX)
-    //        },
-    //        16,
-    //        KSAUDIO_SPEAKER_STEREO,
-    //        STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM)
-    //    }
-    //},
-    //{ // 1
-    //    {
-    //        sizeof(KSDATAFORMAT_WAVEFORMATEXTENSIBLE),
-    //        0,
-    //        0,
-    //        0,
-    //        STATICGUIDOF(KSDATAFORMAT_TYPE_AUDIO),
-    //        STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM),
-    //        STATICGUIDOF(KSDATAFORMAT_SPECIFIER_WAVEFORMATEX)
-    //    },
-    //    {
-    //        {
-    //            WAVE_FORMAT_EXTENSIBLE,
-    //            2,
-    //            32000,
-    //            128000,
-    //            4,
-    //            16,
-    //            sizeof(WAVEFORMATEXTENSIBLE)-sizeof(WAVEFORMATEX)
-    //        },
-    //        16,
-    //        KSAUDIO_SPEAKER_STEREO,
-    //        STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM)
-    //    }
-    //},
-    //{ // 2
-    //    {
-    //        sizeof(KSDATAFORMAT_WAVEFORMATEXTENSIBLE),
-    //        0,
-    //        0,
-    //        0,
-    //        STATICGUIDOF(KSDATAFORMAT_TYPE_AUDIO),
-    //        STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM),
-    //        STATICGUIDOF(KSDATAFORMAT_SPECIFIER_WAVEFORMATEX)
-    //    },
-    //    {
-    //        {
-    //            WAVE_FORMAT_EXTENSIBLE,
-    //            2,
-    //            44100,
-    //            176400,
-    //            4,
-    //            16,
-    //            sizeof(WAVEFORMATEXTENSIBLE)-sizeof(WAVEFORMATEX)
-    //        },
-    //        16,
-    //        KSAUDIO_SPEAKER_STEREO,
-    //        STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM)
-    //    }
-    //},
-    { // 3
-        {
-            sizeof(KSDATAFORMAT_WAVEFORMATEXTENSIBLE),
-            0,
-            0,
-            0,
-            STATICGUIDOF(KSDATAFORMAT_TYPE_AUDIO),
-            STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM),
-            STATICGUIDOF(KSDATAFORMAT_SPECIFIER_WAVEFORMATEX)
-        },
-        {
-            {
-                WAVE_FORMAT_EXTENSIBLE,
-                2,
-                48000,
-                192000,
-                4,
-                16,
-                sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX)
-            },
-            16,
-            KSAUDIO_SPEAKER_STEREO,
-            STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM)
-        }
-    },
-    //{ // 4
-    //    {
-    //        sizeof(KSDATAFORMAT_WAVEFORMATEXTENSIBLE),
-    //        0,
-    //        0,
-    //        0,
-    //        STATICGUIDOF(KSDATAFORMAT_TYPE_AUDIO),
-    //        STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM),
-    //        STATICGUIDOF(KSDATAFORMAT_SPECIFIER_WAVEFORMATEX)
-    //    },
-    //    {
-    //        {
-    //            WAVE_FORMAT_EXTENSIBLE,
-    //            2,
-    //            88200,
-    //            352800,
-    //            4,
-    //            16,
-    //            sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX)
-    //        },
-    //        16,
-    //        KSAUDIO_SPEAKER_STEREO,
-    //        STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM)
-    //    }
-    //},
-    //{ // 5
-    //    {
-    //        sizeof(KSDATAFORMAT_WAVEFORMATEXTENSIBLE),
-    //        0,
-    //        0,
-    //        0,
-    //        STATICGUIDOF(KSDATAFORMAT_TYPE_AUDIO),
-    //        STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM),
-    //        STATICGUIDOF(KSDATAFORMAT_SPECIFIER_WAVEFORMATEX)
-    //    },
-    //    {
-    //        {
-    //            WAVE_FORMAT_EXTENSIBLE,
-    //            2,
-    //            96000,
-    //            384000,
-    //            4,
-    //            16,
-    //            sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX)
-    //        },
-    //        16,
-    //        KSAUDIO_SPEAKER_STEREO,
-    //        STATICGUIDOF(KSDATAFORMAT_SUBTYPE_PCM)
-    //    }
-    //}
+    I2S_DEVICE_FORMAT(48000, 16, 16, KSAUDIO_SPEAKER_STEREO),   // 0, default
+    I2S_DEVICE_FORMAT(48000, 32, 24, KSAUDIO_SPEAKER_STEREO),
+    I2S_DEVICE_FORMATS_FOR_RATE(8000, KSAUDIO_SPEAKER_STEREO),
+    I2S_DEVICE_FORMATS_FOR_RATE(11025, KSAUDIO_SPEAKER_STEREO),
+    I2S_DEVICE_FORMATS_FOR_RATE(12000, KSAUDIO_SPEAKER_STEREO),
+    I2S_DEVICE_FORMATS_FOR_RATE(16000, KSAUDIO_SPEAKER_STEREO),
+    I2S_DEVICE_FORMATS_FOR_RATE(22050, KSAUDIO_SPEAKER_STEREO),
+    I2S_DEVICE_FORMATS_FOR_RATE(24000, KSAUDIO_SPEAKER_STEREO),
+    I2S_DEVICE_FORMATS_FOR_RATE(32000, KSAUDIO_SPEAKER_STEREO),
+    I2S_DEVICE_FORMATS_FOR_RATE(44100, KSAUDIO_SPEAKER_STEREO),
+    I2S_DEVICE_FORMATS_FOR_RATE(96000, KSAUDIO_SPEAKER_STEREO),
+    I2S_DEVICE_FORMATS_FOR_RATE(192000, KSAUDIO_SPEAKER_STEREO),
 };
 
 //
@@ -212,8 +75,7 @@ MODE_AND_DEFAULT_FORMAT HandsetSpeakerHostPinSupportedDeviceModes[] =
 {
     {
         STATIC_AUDIO_SIGNALPROCESSINGMODE_RAW,
-        //&HandsetSpeakerHostPinSupportedDeviceFormats[3].DataFormat, // 48KHz
-		&HandsetSpeakerHostPinSupportedDeviceFormats[0].DataFormat, // 48KHz
+        &HandsetSpeakerHostPinSupportedDeviceFormats[0].DataFormat, // 48KHz 16-bit
     },
     //{
     //    STATIC_AUDIO_SIGNALPROCESSINGMODE_DEFAULT,
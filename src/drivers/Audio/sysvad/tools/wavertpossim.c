@@ -0,0 +1,260 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+    wavertpossim.c
+
+Abstract:
+
+    Simulates hours of playback through the I2S DMA and compares the stream
+    position the WaveRT miniport reports against the position of the DMA:
+
+        qpc       - the former UpdatePosition: elapsed QPC time times
+                    nAvgBytesPerSec, in whole ms with the remainder carried
+                    forward.
+        callback  - only the transfer complete callbacks, what the stream
+                    reports without UpdatePosition.
+        residue   - the callbacks plus the residue counter of the transfer
+                    in progress (I2SGetPosition), the current UpdatePosition.
+
+    The I2S clock and QPC run off different crystals, each some ppm off,
+    completion callbacks run after a random DPC latency and the audio engine
+    queries the position every period with some jitter. The error is the
+    reported position minus the bytes the DMA actually moved, in ms of
+    audio; the drift is the error at the end of each hour.
+
+    Build and run on any host with a C compiler:
+
+        cc -O2 -o wavertpossim wavertpossim.c
+        wavertpossim [-r rate] [-i i2sppm] [-q qpcppm] [-h hours] [-s seed]
+
+Environment:
+
+    user mode
+
+--*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define QPC_FREQUENCY       24000000ULL     // A64 architected timer
+#define HNS_PER_SECOND      10000000ULL
+#define BLOCK_ALIGN         4               // 16-bit stereo
+#define DMA_WORD            2               // Width16Bits
+#define PERIOD_MS           10
+
+enum
+{
+    ModelQpc = 0,
+    ModelCallback,
+    ModelResidue,
+    Models
+};
+
+static const char *ModelNames[Models] = { "qpc", "callback", "residue" };
+
+typedef struct _ERROR_STATS
+{
+    double MaxAbsMs;
+    double SumAbsMs;
+    unsigned long long Samples;
+} ERROR_STATS;
+
+// KSCONVERT_PERFORMANCE_TIME
+static unsigned long long
+QpcToHns(unsigned long long Frequency, unsigned long long Qpc)
+{
+    return ((Qpc / Frequency) * HNS_PER_SECOND) + ((Qpc % Frequency) * HNS_PER_SECOND / Frequency);
+}
+
+static double
+Uniform(void)
+{
+    return (double)rand() / ((double)RAND_MAX + 1.0);
+}
+
+static void
+AddError(ERROR_STATS *Stats, double ErrorMs)
+{
+    double absMs = ErrorMs < 0 ? -ErrorMs : ErrorMs;
+
+    if (absMs > Stats->MaxAbsMs)
+    {
+        Stats->MaxAbsMs = absMs;
+    }
+    Stats->SumAbsMs += absMs;
+    Stats->Samples++;
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned int rate = 44100;
+    double i2sPpm = 40.0;
+    double qpcPpm = -15.0;
+    unsigned int hours = 4;
+    unsigned int seed = 1;
+    unsigned int bytesPerSec;
+    unsigned int period;
+    double i2sBytesPerUs;
+    unsigned long long endUs;
+    unsigned long long nowUs = 0;
+    unsigned long long nextHourUs;
+    unsigned int hour = 0;
+    int i;
+    int model;
+
+    // Old model state, as in the former CMiniportWaveRTStream.
+    unsigned long long qpcStampHns = 0;
+    unsigned long long qpcCarryHns = 0;
+    unsigned long long qpcLinear = 0;
+
+    // The current transfer finishes at nextCompleteUs, its callback runs at nextCallbackUs.
+    unsigned long long completed = 0;
+    unsigned long long nextCompleteUs;
+    unsigned long long nextCallbackUs;
+
+    ERROR_STATS stats[Models] = { { 0 } };
+    double lastError[Models] = { 0 };
+
+    for (i = 1; i + 1 < argc; i += 2)
+    {
+        if (argv[i][0] != '-')
+        {
+            break;
+        }
+        switch (argv[i][1])
+        {
+        case 'r':
+            rate = (unsigned int)strtoul(argv[i + 1], NULL, 0);
+            break;
+        case 'i':
+            i2sPpm = atof(argv[i + 1]);
+            break;
+        case 'q':
+            qpcPpm = atof(argv[i + 1]);
+            break;
+        case 'h':
+            hours = (unsigned int)strtoul(argv[i + 1], NULL, 0);
+            break;
+        case 's':
+            seed = (unsigned int)strtoul(argv[i + 1], NULL, 0);
+            break;
+        default:
+            i = argc;
+            break;
+        }
+    }
+    if ((i != argc) || (rate == 0) || (hours == 0))
+    {
+        fprintf(stderr, "usage: %s [-r rate] [-i i2sppm] [-q qpcppm] [-h hours] [-s seed]\n", argv[0]);
+        return 1;
+    }
+
+    srand(seed);
+
+    bytesPerSec = rate * BLOCK_ALIGN;
+    period = (rate * PERIOD_MS / 1000) * BLOCK_ALIGN;
+    i2sBytesPerUs = bytesPerSec * (1.0 + i2sPpm * 1e-6) / 1e6;
+    endUs = (unsigned long long)hours * 3600ULL * 1000000ULL;
+    nextHourUs = 3600ULL * 1000000ULL;
+
+    nextCompleteUs = (unsigned long long)(period / i2sBytesPerUs);
+    nextCallbackUs = nextCompleteUs + 20 + (unsigned long long)(Uniform() * 280.0);
+
+    printf("%u Hz, %u byte packets, I2S %+.1f ppm, QPC %+.1f ppm, %u hours\n",
+        rate, period, i2sPpm, qpcPpm, hours);
+    printf("hour  drift ms:%9s %9s %9s\n", ModelNames[0], ModelNames[1], ModelNames[2]);
+
+    while (nowUs < endUs)
+    {
+        unsigned long long trueBytes;
+        unsigned long long qpc;
+        unsigned long long hns;
+        unsigned long long reported[Models];
+        unsigned long long inFlight;
+        unsigned long long elapsedMs;
+
+        // The engine asks once per period, 2 ms either way.
+        nowUs += PERIOD_MS * 1000 - 2000 + (unsigned long long)(Uniform() * 4000.0);
+
+        // Callbacks that ran before this query.
+        while (nextCallbackUs <= nowUs)
+        {
+            completed++;
+            nextCompleteUs = (unsigned long long)((completed + 1) * period / i2sBytesPerUs);
+            nextCallbackUs = nextCompleteUs + 20 + (unsigned long long)(Uniform() * 280.0);
+        }
+
+        //
+        // The DMA stops at the end of a transfer until the callback programs
+        // the next one, the FIFO covers that gap. Its position is what it
+        // actually moved.
+        //
+        trueBytes = (unsigned long long)(nowUs * i2sBytesPerUs);
+        if (trueBytes > (completed + 1) * period)
+        {
+            trueBytes = (completed + 1) * period;
+        }
+        trueBytes -= trueBytes % DMA_WORD;
+
+        // QPC reading at this time, through its own crystal.
+        qpc = (unsigned long long)(nowUs * (1.0 + qpcPpm * 1e-6) * (QPC_FREQUENCY / 1000000ULL));
+        hns = QpcToHns(QPC_FREQUENCY, qpc);
+
+        elapsedMs = (hns - qpcStampHns + qpcCarryHns) / 10000;
+        qpcCarryHns = (hns - qpcStampHns + qpcCarryHns) % 10000;
+        qpcLinear += (unsigned int)((bytesPerSec * (unsigned int)elapsedMs) / 1000);
+        qpcStampHns = hns;
+        reported[ModelQpc] = qpcLinear;
+
+        reported[ModelCallback] = completed * period;
+
+        inFlight = trueBytes - completed * period;
+        reported[ModelResidue] = completed * period + inFlight;
+        reported[ModelResidue] -= reported[ModelResidue] % BLOCK_ALIGN;
+
+        for (model = 0; model < Models; model++)
+        {
+            double errorMs = ((double)reported[model] - (double)trueBytes) * 1000.0 / bytesPerSec;
+
+            AddError(&stats[model], errorMs);
+            lastError[model] = errorMs;
+        }
+
+        if (nowUs >= nextHourUs)
+        {
+            hour++;
+            printf("%4u           %9.2f %9.2f %9.2f\n", hour,
+                lastError[ModelQpc], lastError[ModelCallback], lastError[ModelResidue]);
+            nextHourUs += 3600ULL * 1000000ULL;
+        }
+    }
+
+    printf("\n%-9s %12s %12s\n", "model", "max |err| ms", "mean |err| ms");
+    for (model = 0; model < Models; model++)
+    {
+        printf("%-9s %12.3f %12.3f\n", ModelNames[model], stats[model].MaxAbsMs,
+            stats[model].Samples ? stats[model].SumAbsMs / stats[model].Samples : 0.0);
+    }
+
+    return 0;
+}
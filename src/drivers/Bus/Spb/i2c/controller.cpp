@@ -46,16 +46,54 @@ VOID TwiDelay (
 }
 
 
+/* write the control register, the shadow supplies the persistent bits */
+inline VOID 
+TwiWriteCtl (
+	_In_  PPBC_DEVICE  pDevice,
+	_In_  ULONG  OneShotBits
+	)
+{
+	pDevice->pRegisters->CtlReg.Write(pDevice->CtlShadow | OneShotBits);
+}
+
+/* change persistent control bits, skipped when the shadow already matches */
+inline VOID 
+TwiUpdateCtl (
+	_In_  PPBC_DEVICE  pDevice,
+	_In_  ULONG  SetBits,
+	_In_  ULONG  ClearBits
+	)
+{
+	ULONG RegVal = (pDevice->CtlShadow | SetBits) & ~ClearBits;
+
+	RegVal &= TWI_CTL_SHADOW_MASK;
+	if (RegVal == pDevice->CtlShadow) {
+		return;
+	}
+
+	/* start, stop and intflag stay 0 so nothing is triggered or cleared by mistake */
+	pDevice->CtlShadow = RegVal;
+	pDevice->pRegisters->CtlReg.Write(RegVal);
+}
+
+/* reload the shadows after the hardware may have changed the registers */
+inline VOID 
+TwiSyncShadow (
+	_In_  PPBC_DEVICE  pDevice
+	)
+{
+	pDevice->CtlShadow = pDevice->pRegisters->CtlReg.Read() & TWI_CTL_SHADOW_MASK;
+	pDevice->ClkShadow = pDevice->pRegisters->ClkReg.Read();
+	pDevice->EfrShadow = pDevice->pRegisters->EfrReg.Read();
+}
+
 inline VOID 
 TwiClearIrqFlag (
 	_In_  PPBC_DEVICE  pDevice
 	)
 {
-	ULONG RegVal =pDevice->pRegisters->CtlReg.Read();
-	
-	RegVal |= TWI_CTL_INTFLG;	/* start and stop bit should be 0 */
-	RegVal &= ~(TWI_CTL_STA | TWI_CTL_STP);
-	pDevice->pRegisters->CtlReg.Write(RegVal);
+	/* start and stop bit should be 0 */
+	TwiWriteCtl(pDevice, TWI_CTL_INTFLG);
 
 	/* read two more times to make sure that interrupt flag does really be cleared */
 	{
@@ -102,17 +140,13 @@ TwiEnableIrq (
 	_In_  PPBC_DEVICE  pDevice
 	)
 {
-	ULONG RegVal = pDevice->pRegisters->CtlReg.Read();
-
 	/*
 	* 1 when enable irq for next operation, set intflag to 0 to prevent to clear it by a mistake
 	*   (intflag bit is write-1-to-clear bit)
 	* 2 Similarly, mask START bit and STOP bit to prevent to set it twice by a mistake
 	*   (START bit and STOP bit are self-clear-to-0 bits)
 	*/
-	RegVal |= TWI_CTL_INTEN;
-	RegVal &= ~(TWI_CTL_STA | TWI_CTL_STP | TWI_CTL_INTFLG);
-	pDevice->pRegisters->CtlReg.Write(RegVal);
+	TwiUpdateCtl(pDevice, TWI_CTL_INTEN, 0);
 }
 
 inline VOID 
@@ -120,25 +154,27 @@ TwiDisableIrq (
 	_In_  PPBC_DEVICE  pDevice
 	)
 {
-	ULONG RegVal = pDevice->pRegisters->CtlReg.Read();
-	RegVal &= ~TWI_CTL_INTEN;
-	RegVal &= ~(TWI_CTL_STA | TWI_CTL_STP | TWI_CTL_INTFLG);
-	pDevice->pRegisters->CtlReg.Write(RegVal);
+	TwiUpdateCtl(pDevice, 0, TWI_CTL_INTEN);
 }
 
 VOID
 TwiWriteClock (
 	_In_  PPBC_DEVICE  pDevice,
-	_In_  ULONG clk_n,
-	_In_  ULONG clk_m
+	_In_  ULONG ClockRegister
 	)
 {
-	ULONG reg_val = pDevice->pRegisters->ClkReg.Read();
-	KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "%s: clk_n = %d, clk_m = %d\n", __FUNCTION__, clk_n, clk_m));
+	ULONG reg_val = pDevice->ClkShadow;
+
 	reg_val &= ~(TWI_CLK_DIV_M | TWI_CLK_DIV_N);
-	reg_val |= (clk_n | (clk_m << 3));
-	pDevice->pRegisters->ClkReg.Write(reg_val);
+	reg_val |= (ClockRegister & (TWI_CLK_DIV_M | TWI_CLK_DIV_N));
+	if (reg_val == pDevice->ClkShadow) {
+		return;
+	}
 
+	KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "%s: clk_n = %d, clk_m = %d\n", __FUNCTION__,
+		reg_val & TWI_CLK_DIV_N, (reg_val & TWI_CLK_DIV_M) >> 3));
+	pDevice->ClkShadow = reg_val;
+	pDevice->pRegisters->ClkReg.Write(reg_val);
 }
 
 /* trigger start signal, the start bit will be cleared automatically */
@@ -147,10 +183,7 @@ TwiSetStart (
 	_In_  PPBC_DEVICE  pDevice
 	)
 {
-	ULONG RegVal = pDevice->pRegisters->CtlReg.Read();
-	RegVal |= TWI_CTL_STA;
-	RegVal &= ~TWI_CTL_INTFLG;
-	pDevice->pRegisters->CtlReg.Write(RegVal);
+	TwiWriteCtl(pDevice, TWI_CTL_STA);
 }
 
 /* get start bit status, poll if start signal is sent */
@@ -170,10 +203,7 @@ TwiSetStop (
 	_In_  PPBC_DEVICE  pDevice
 	)
 {
-	ULONG RegVal = pDevice->pRegisters->CtlReg.Read();
-	RegVal |= TWI_CTL_STP;
-	RegVal &= ~TWI_CTL_INTFLG;
-	pDevice->pRegisters->CtlReg.Write(RegVal);
+	TwiWriteCtl(pDevice, TWI_CTL_STP);
 }
 
 /* get stop bit status, poll if stop signal is sent */
@@ -192,10 +222,7 @@ TwiDisableAck (
 	_In_  PPBC_DEVICE  pDevice
 	)
 {
-	ULONG RegVal = pDevice->pRegisters->CtlReg.Read();
-	RegVal &= ~TWI_CTL_ACK;
-	RegVal &= ~TWI_CTL_INTFLG;
-	pDevice->pRegisters->CtlReg.Write(RegVal);
+	TwiUpdateCtl(pDevice, 0, TWI_CTL_ACK);
 }
 
 /* when sending ack or nack, it will send ack automatically */
@@ -204,10 +231,7 @@ TwiEnableAck (
 	_In_  PPBC_DEVICE  pDevice
 	)
 {
-	ULONG RegVal = pDevice->pRegisters->CtlReg.Read();
-	RegVal |= TWI_CTL_ACK;
-	RegVal &= ~TWI_CTL_INTFLG;
-	pDevice->pRegisters->CtlReg.Write(RegVal);
+	TwiUpdateCtl(pDevice, TWI_CTL_ACK, 0);
 }
 
 /* get the interrupt flag */
@@ -230,6 +254,64 @@ TwiQueryIrqStatus (
 	return (RegVal & TWI_STAT_MASK);
 }
 
+ULONG
+TwiCalcClock(
+	_In_  ULONG Clock,
+	_In_  ULONG sclk_req,
+	_Out_opt_ PULONG psclk_real
+	)
+/*
+	Routine Description:
+
+		This routine finds the clock divider giving the fastest SCL
+		that does not exceed the requested speed.
+
+		Foscl = Fin/(2^CLK_N * (CLK_M+1)*10), every one of the 128
+		combinations is tried, so the result is exact for any speed
+		from ~1.2KHz up to Fin/10, including Fm+ (1MHz) targets.
+
+	Arguments:
+
+		Clock - the source clock frequency
+		sclk_req - the requested SCL frequency
+		psclk_real - receives the achieved SCL frequency
+
+  Return Value:
+
+		The CLK_N and CLK_M fields of the clock register.
+*/
+{
+	ULONG clk_m;
+	ULONG clk_n;
+	ULONGLONG divider;
+	ULONGLONG best_divider = 10ULL * 16 * (1 << 7);  /* slowest setting */
+	ULONG best_m = 15;
+	ULONG best_n = 7;
+
+	for (clk_n = 0; clk_n < 8; clk_n++) {  /* 3bits */
+		for (clk_m = 0; clk_m < 16; clk_m++) {  /* 4bits */
+			divider = 10ULL * (clk_m + 1) * (1ULL << clk_n);
+
+			/* Clock/divider <= sclk_req, without rounding */
+			if ((ULONGLONG)Clock > (ULONGLONG)sclk_req * divider) {
+				continue;
+			}
+
+			if (divider < best_divider) {
+				best_divider = divider;
+				best_m = clk_m;
+				best_n = clk_n;
+			}
+		}
+	}
+
+	if (psclk_real != NULL) {
+		*psclk_real = (ULONG)(Clock / best_divider);
+	}
+
+	return (best_n | (best_m << 3));
+}
+
 VOID
 TwiSetClock(
 	_In_  PPBC_DEVICE  pDevice,
@@ -250,39 +332,7 @@ TwiSetClock(
 		None.
 */
 {
-	ULONG clk_m = 0;
-	ULONG clk_n = 0;
-	ULONG _2_pow_clk_n = 1;
-	ULONG src_clk = Clock / 10;
-	ULONG divider = src_clk / sclk_req;  // 400khz or 100khz
-	ULONG sclk_real = 0;      // the real clock frequency
-
-	if (divider == 0) {
-		clk_m = 1;
-		goto set_clk;
-	}
-
-	// search clk_n and clk_m,from large to small value so that can quickly find suitable m & n. 
-	while (clk_n < 8) { // 3bits max value is 8
-		/* (m+1)*2^n = divider -->m = divider/2^n -1 */
-		clk_m = (divider / _2_pow_clk_n) - 1;
-		/* clk_m = (divider >> (_2_pow_clk_n>>1))-1 */
-		while (clk_m < 16) { /* 4bits max value is 16 */
-			sclk_real = src_clk / (clk_m + 1) / _2_pow_clk_n;  /* src_clk/((m+1)*2^n) */
-			if (sclk_real <= sclk_req) {
-				goto set_clk;
-			}
-			else {
-				clk_m++;
-			}
-		}
-		clk_n++;
-		_2_pow_clk_n *= 2; /* mutilple by 2 */
-	}
-
-set_clk:
-	TwiWriteClock(pDevice, clk_n, clk_m);
-
+	TwiWriteClock(pDevice, TwiCalcClock(Clock, sclk_req, NULL));
 }
 
 inline VOID 
@@ -293,6 +343,10 @@ TwiSoftReset(
 	ULONG RegVal = pDevice->pRegisters->SrstReg.Read();
 	RegVal |= TWI_SRST_SRST;
 	pDevice->pRegisters->SrstReg.Write(RegVal);
+	pDevice->bResetPending = FALSE;
+
+	/* the shadows can no longer be trusted */
+	TwiSyncShadow(pDevice);
 }
 
 inline VOID 
@@ -300,9 +354,7 @@ TwiDisableBus(
 	_In_  PPBC_DEVICE  pDevice
 	)
 {
-	ULONG RegVal = pDevice->pRegisters->CtlReg.Read();
-	RegVal &= ~TWI_CTL_BUSEN;
-	pDevice->pRegisters->CtlReg.Write(RegVal);
+	TwiUpdateCtl(pDevice, 0, TWI_CTL_BUSEN);
 }
 
 inline VOID 
@@ -310,9 +362,7 @@ TwiEnableBus(
 	_In_  PPBC_DEVICE  pDevice
 	)
 {
-	ULONG RegVal = pDevice->pRegisters->CtlReg.Read();
-	RegVal |= TWI_CTL_BUSEN;
-	pDevice->pRegisters->CtlReg.Write(RegVal);
+	TwiUpdateCtl(pDevice, TWI_CTL_BUSEN, 0);
 }
 
 /* Enhanced Feature Register */
@@ -321,11 +371,16 @@ TwiSetEfr(
 	_In_  PPBC_DEVICE  pDevice,
 	_In_  ULONG efr)
 {
-	ULONG RegVal = pDevice->pRegisters->EfrReg.Read();
+	ULONG RegVal = pDevice->EfrShadow;
 
 	RegVal &= ~TWI_EFR_MASK;
 	efr &= TWI_EFR_MASK;
 	RegVal |= efr;
+	if (RegVal == pDevice->EfrShadow) {
+		return;
+	}
+
+	pDevice->EfrShadow = RegVal;
 	pDevice->pRegisters->EfrReg.Write(RegVal);
 }
 
@@ -456,48 +511,37 @@ TwiDisableLcr (
 }
 
 
-/* send 9 clock to release sda */
-int 
-TwiSendClk9pulse(
+/* SDA is considered released after three consecutive high samples */
+inline BOOLEAN 
+TwiSdaReleased (
 	_In_  PPBC_DEVICE  pDevice
 	)
 {
-	int TwiScl = 1;
-	int low = 0;
-	int high = 1;
-	int cycle = 0;
+	return (TwiGetSda(pDevice)
+		&& TwiGetSda(pDevice)
+		&& TwiGetSda(pDevice));
+}
 
-	/* enable scl control */
-	TwiEnableLcr(pDevice, TwiScl);
+/* take over SCL and schedule the recovery sequence */
+VOID 
+TwiBeginRecovery(
+	_In_  PPBC_DEVICE  pDevice
+	)
+{
+	PPBC_BUS_RECOVERY pRecovery = &pDevice->Recovery;
 
-	while (cycle < 10)
-	{
-		if (TwiGetSda(pDevice)
-			&& TwiGetSda(pDevice)
-			&& TwiGetSda(pDevice)) {
-			break;
-		}
-		/* twi_scl -> low */
-		TwiSetScl(pDevice, low);
-		TwiDelay(1000);
-
-		/* twi_scl -> high */
-		TwiSetScl(pDevice, high);
-		TwiDelay(1000);
-		cycle++;
-	}
+	pRecovery->bActive = TRUE;
+	pRecovery->Cycle = 0;
 
-	if (TwiGetSda(pDevice)) {
-		TwiDisableLcr(pDevice, TwiScl);
-		return AW_I2C_OK;
-	}
-	else {
-		KdPrintEx((DPFLTR_IHVAUDIO_ID, DPFLTR_INFO_LEVEL, "[i2c] SDA is still Stuck Low, failed. \n"));
-		TwiDisableLcr(pDevice, TwiScl);
-		return AW_I2C_FAIL;
-	}
-}
+	/* enable scl control, SCL stays high until the timer runs */
+	TwiSetScl(pDevice, 1);
+	TwiEnableLcr(pDevice, 1);
 
+	/* the next timer tick, the clocks are then sent in one go */
+	WdfTimerStart(
+		pDevice->RecoveryTimer,
+		WDF_REL_TIMEOUT_IN_MS(TWI_RECOVERY_DELAY_MS));
+}
 
 VOID 
 TwiI2cAddrByte (
@@ -544,6 +588,57 @@ TwiI2cAddrByte (
 }
 
 
+/* bring the controller to idle, program the target settings and send START */
+int 
+TwiPrepareStart (
+	_In_  PPBC_DEVICE  pDevice
+	)
+{
+	ULONG state = TwiQueryIrqStatus(pDevice);
+
+	//
+	//a clean stop leaves the controller idle, only reset it
+	//after an error or when it is not idle
+	//
+	if (pDevice->bResetPending || (state != TWI_STAT_IDLE)) {
+		TwiSoftReset(pDevice);
+		TwiDelay(50);
+		state = TwiQueryIrqStatus(pDevice);
+	}
+
+	if (TWI_STAT_IDLE != state &&
+		TWI_STAT_BUS_ERR != state &&
+		TWI_STAT_ARBLOST_SLAR_ACK != state) {
+		KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "[i2c%d] bus is busy, status = %x\n", pDevice->BusNumber, state));
+
+		//
+		//clock the slave off the bus from the recovery timer,
+		//the transfer is started again when it has finished
+		//
+		if (!pDevice->Recovery.bRecovered) {
+			TwiBeginRecovery(pDevice);
+			return AW_I2C_BUSY;
+		}
+	}
+	pDevice->Recovery.bRecovered = FALSE;
+
+	TwiEnableIrq(pDevice);  /* enable irq */
+	TwiDisableAck(pDevice); /* disabe ACK */
+	TwiSetEfr(pDevice, 0);
+
+	//set speed, a no-op when the previous target used the same one
+	TwiWriteClock(pDevice, pDevice->pCurrentTarget->ClockRegister);
+
+	if (AW_I2C_FAIL == TwiStart(pDevice)) {
+		TwiSoftReset(pDevice);
+		TwiDisableIrq(pDevice);  /* disable irq */
+		pDevice->Status = I2C_XFER_IDLE;
+		return AW_I2C_RETRY;
+	}
+
+	return AW_I2C_OK;
+}
+
 VOID
 ControllerInitialize(
     _In_  PPBC_DEVICE  pDevice
@@ -568,6 +663,15 @@ ControllerInitialize(
                         
     NT_ASSERT(pDevice != NULL);
 
+	KeQueryPerformanceCounter(&pDevice->PerfFrequency);
+	pDevice->WriteRead.Phase = WriteReadIdle;
+	RtlZeroMemory(&pDevice->Recovery, sizeof(pDevice->Recovery));
+
+	//
+	//registers may have been lost while powered down
+	//
+	TwiSyncShadow(pDevice);
+
 	//
 	//twi enable bus
 	//
@@ -577,9 +681,9 @@ ControllerInitialize(
 	//set i2c clock && speed
 	//
 	if (pDevice->BusSpeed)
-		TwiSetClock(pDevice, 24000000, pDevice->BusSpeed);
+		TwiSetClock(pDevice, TWI_SOURCE_CLOCK, pDevice->BusSpeed);
 	else
-		TwiSetClock(pDevice, 24000000, 200000);
+		TwiSetClock(pDevice, TWI_SOURCE_CLOCK, TWI_DEFAULT_SPEED);
 	
 	//
 	//restart the twi
@@ -634,6 +738,169 @@ ControllerUninitialize(
     FuncExit(TRACE_FLAG_PBCLOADING);
 }
 
+ULONG
+ControllerCalculateClock(
+    _In_      ULONG         ConnectionSpeed,
+    _Out_opt_ PULONG        pActualSpeed
+    )
+/*++
+ 
+  Routine Description:
+
+    This routine computes the clock register value for
+    a connection speed, so it can be cached per target.
+
+  Arguments:
+
+    ConnectionSpeed - the requested SCL frequency in Hz
+    pActualSpeed - receives the SCL frequency actually achieved
+
+  Return Value:
+
+    The clock divider bits for the clock register.
+
+--*/
+{
+    if (ConnectionSpeed == 0)
+    {
+        ConnectionSpeed = TWI_DEFAULT_SPEED;
+    }
+    else if (ConnectionSpeed > TWI_MAX_SPEED)
+    {
+        ConnectionSpeed = TWI_MAX_SPEED;
+    }
+
+    return TwiCalcClock(TWI_SOURCE_CLOCK, ConnectionSpeed, pActualSpeed);
+}
+
+int
+ControllerRunBusRecovery(
+    _In_  PPBC_DEVICE   pDevice
+    )
+/*++
+ 
+  Routine Description:
+
+    This routine performs the bus recovery sequence started by
+    TwiBeginRecovery. Up to nine clocks are sent on SCL until
+    the slave releases SDA. Timer resolution is far coarser
+    than an SCL half period, so the clocks are sent here with
+    short stalls, at most TWI_RECOVERY_MAX_CLOCKS full periods
+    at 100 kHz. The request path itself never waits.
+
+  Arguments:
+
+    pDevice - a pointer to the PBC device context
+
+  Return Value:
+
+    AW_I2C_OK once SDA is released, AW_I2C_FAIL if it
+    stays low.
+
+--*/
+{
+    FuncEntry(TRACE_FLAG_TRANSFER);
+
+    PPBC_BUS_RECOVERY pRecovery = &pDevice->Recovery;
+    int ret = AW_I2C_OK;
+
+    NT_ASSERT(pRecovery->bActive);
+
+    //
+    // SDA is sampled while SCL is high, before
+    // each clock and after the last one.
+    //
+
+    while (!TwiSdaReleased(pDevice))
+    {
+        if (pRecovery->Cycle >= TWI_RECOVERY_MAX_CLOCKS)
+        {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "[i2c%d] SDA is still Stuck Low, failed. \n", pDevice->BusNumber));
+            ret = AW_I2C_FAIL;
+            break;
+        }
+
+        TwiSetScl(pDevice, 0);
+        KeStallExecutionProcessor(TWI_RECOVERY_HALF_PERIOD_US);
+        TwiSetScl(pDevice, 1);
+        KeStallExecutionProcessor(TWI_RECOVERY_HALF_PERIOD_US);
+        pRecovery->Cycle++;
+    }
+
+    Trace(
+        TRACE_LEVEL_INFORMATION,
+        TRACE_FLAG_TRANSFER,
+        "Bus recovery %s after %lu clocks for WDFDEVICE %p",
+        (ret == AW_I2C_OK) ? "succeeded" : "failed",
+        pRecovery->Cycle,
+        pDevice->FxDevice);
+
+    ControllerTraceEvent(
+        pDevice,
+        Sunxii2cTraceRecovery,
+        0,
+        (USHORT)pRecovery->Cycle,
+        (ret == AW_I2C_OK) ? STATUS_SUCCESS : STATUS_IO_DEVICE_ERROR);
+
+    TwiDisableLcr(pDevice, 1);
+    pRecovery->bActive = FALSE;
+    pRecovery->bRecovered = (ret == AW_I2C_OK);
+
+    if (ret != AW_I2C_OK)
+    {
+        pDevice->bResetPending = TRUE;
+    }
+
+    FuncExit(TRACE_FLAG_TRANSFER);
+
+    return ret;
+}
+
+BOOLEAN
+ControllerStopBusRecovery(
+    _In_  PPBC_DEVICE   pDevice
+    )
+/*++
+ 
+  Routine Description:
+
+    This routine abandons a bus recovery sequence and
+    gives SCL back to the controller. Called with the
+    device lock held.
+
+  Arguments:
+
+    pDevice - a pointer to the PBC device context
+
+  Return Value:
+
+    TRUE if a sequence was pending, the current request
+    is then still waiting for it and must be completed
+    by the caller.
+
+--*/
+{
+    FuncEntry(TRACE_FLAG_TRANSFER);
+
+    PPBC_BUS_RECOVERY pRecovery = &pDevice->Recovery;
+    BOOLEAN bStopped = FALSE;
+
+    if (pRecovery->bActive)
+    {
+        WdfTimerStop(pDevice->RecoveryTimer, FALSE);
+
+        TwiDisableLcr(pDevice, 1);
+        pRecovery->bActive = FALSE;
+        pRecovery->bRecovered = FALSE;
+        pDevice->bResetPending = TRUE;
+        bStopped = TRUE;
+    }
+
+    FuncExit(TRACE_FLAG_TRANSFER);
+
+    return bStopped;
+}
+
 VOID
 ControllerConfigureForTransfer(
     _In_  PPBC_DEVICE   pDevice,
@@ -666,43 +933,20 @@ ControllerConfigureForTransfer(
     pRequest->Status = STATUS_SUCCESS;
 	int ret = -1;
 
+    ControllerTraceBegin(pDevice, pRequest, pRequest->Length);
+
 	if ((pRequest->SequencePosition == SpbRequestSequencePositionSingle) ||
 		(pRequest->SequencePosition == SpbRequestSequencePositionFirst)) {
 
-			TwiSoftReset(pDevice);
-			TwiDelay(50);
-
-			while (TWI_STAT_IDLE != TwiQueryIrqStatus(pDevice) &&
-				TWI_STAT_BUS_ERR != TwiQueryIrqStatus(pDevice) &&
-				TWI_STAT_ARBLOST_SLAR_ACK != TwiQueryIrqStatus(pDevice)) {
-				KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "[i2c%d] bus is busy, status = %x\n", pDevice->BusNumber, TwiQueryIrqStatus(pDevice)));
-				if (AW_I2C_OK == TwiSendClk9pulse(pDevice)) {
-					break;
-				}
-				else {
-					ret = AW_I2C_RETRY;
-					goto Out;
-				}
-			}
-
-			TwiEnableIrq(pDevice);  /* enable irq */
-			TwiDisableAck(pDevice); /* disabe ACK */
-			TwiSetEfr(pDevice, 0);
-
-			//set speed
-			if (pDevice->pCurrentTarget->Settings.ConnectionSpeed != 200000) {
-				TwiSetClock(pDevice, 24000000, pDevice->pCurrentTarget->Settings.ConnectionSpeed);
+			ret = TwiPrepareStart(pDevice);
+			if (ret == AW_I2C_BUSY) {
+				/* resumed by the recovery timer */
+				pDevice->Recovery.bWriteRead = FALSE;
+				goto Out;
 			}
-
-			ret = TwiStart(pDevice);
-			if (ret == AW_I2C_FAIL) {
-				TwiSoftReset(pDevice);
-				TwiDisableIrq(pDevice);  /* disable irq */
-				pDevice->Status = I2C_XFER_IDLE;
-				ret = AW_I2C_RETRY;
+			else if (ret != AW_I2C_OK) {
 				goto Out;
 			}
-
 	}
 	else if ((pRequest->SequencePosition == SpbRequestSequencePositionContinue) ||
 		(pRequest->SequencePosition == SpbRequestSequencePositionLast)) {
@@ -919,6 +1163,10 @@ ControllerProcessInterrupts(
 ErrOut :
 	if (AW_I2C_TFAIL == TwiStop(pDevice)) {
 		KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "[i2c] STOP failed!\n"));
+		pDevice->bResetPending = TRUE;
+	}
+	if (!NT_SUCCESS(pRequest->Status)) {
+		pDevice->bResetPending = TRUE;
 	}
 		ControllerCompleteTransfer(pDevice, pRequest);
 		PbcRequestComplete(pRequest);
@@ -926,42 +1174,354 @@ ErrOut :
     FuncExit(TRACE_FLAG_TRANSFER);
 }
 
-//NTSTATUS
-//ControllerTransferData(
-//    _In_  PPBC_DEVICE   pDevice,
-//    _In_  PPBC_REQUEST  pRequest
-//    )
-///*++
-// 
-//  Routine Description:
-//
-//    This routine transfers data to or from the device.
-//
-//  Arguments:
-//
-//    pDevice - a pointer to the PBC device context
-//    pRequest - a pointer to the PBC request context
-//
-//  Return Value:
-//
-//    None.
-//
-//--*/
-//{
-//    FuncEntry(TRACE_FLAG_TRANSFER);
-//
-//    UNREFERENCED_PARAMETER(pDevice);
-//
-//    size_t bytesToTransfer = 0;
-//    NTSTATUS status = STATUS_SUCCESS;
-//
-//    //
-//    // Write
-//    //
-//
-//    if (pRequest->Direction == SpbTransferDirectionToDevice)
-//    {
-//        Trace(
+VOID
+ControllerStartWriteRead(
+    _In_  PPBC_DEVICE   pDevice,
+    _In_  PPBC_REQUEST  pRequest
+    )
+/*++
+ 
+  Routine Description:
+
+    This routine starts a write-then-read transaction whose
+    buffers were prepared by PbcRequestPrepareWriteRead. The
+    remainder of the transaction, including the repeated
+    start, is driven by ControllerProcessWriteRead from the ISR.
+
+  Arguments:
+
+    pDevice - a pointer to the PBC device context
+    pRequest - a pointer to the PBC request context
+
+  Return Value:
+
+    None. The request is completed asynchronously.
+
+--*/
+{
+    FuncEntry(TRACE_FLAG_TRANSFER);
+
+    NT_ASSERT(pDevice  != NULL);
+    NT_ASSERT(pRequest != NULL);
+
+    PPBC_WRITE_READ pWriteRead = &pDevice->WriteRead;
+    int ret;
+
+    pRequest->Settings = g_TransferSettings[SpbRequestSequencePositionSingle];
+    pRequest->Status = STATUS_SUCCESS;
+    pDevice->InterruptStatus = 0;
+
+    pWriteRead->Index = 0;
+    pWriteRead->Status = STATUS_SUCCESS;
+    pWriteRead->StartTime = KeQueryPerformanceCounter(NULL);
+
+    Trace(
+        TRACE_LEVEL_VERBOSE,
+        TRACE_FLAG_TRANSFER,
+        "Controller configured for write-read of %Iu/%Iu bytes to address 0x%lx "
+        "(SPBREQUEST %p, WDFDEVICE %p)",
+        pWriteRead->WriteLength,
+        pWriteRead->ReadLength,
+        pDevice->pCurrentTarget->Settings.Address,
+        pRequest->SpbRequest,
+        pDevice->FxDevice);
+
+    ControllerTraceBegin(
+        pDevice,
+        pRequest,
+        pWriteRead->WriteLength + pWriteRead->ReadLength);
+
+    //
+    // The phase must be set before START, the first
+    // interrupt follows immediately.
+    //
+
+    WdfInterruptAcquireLock(pDevice->InterruptObject);
+    pWriteRead->Phase = WriteReadWrite;
+    WdfInterruptReleaseLock(pDevice->InterruptObject);
+
+    ret = TwiPrepareStart(pDevice);
+
+    if (ret == AW_I2C_BUSY)
+    {
+        //
+        // Bus recovery is running, it restarts
+        // the transaction when it completes.
+        //
+
+        WdfInterruptAcquireLock(pDevice->InterruptObject);
+        pWriteRead->Phase = WriteReadIdle;
+        WdfInterruptReleaseLock(pDevice->InterruptObject);
+
+        pDevice->Recovery.bWriteRead = TRUE;
+    }
+    else if (ret != AW_I2C_OK)
+    {
+        WdfInterruptAcquireLock(pDevice->InterruptObject);
+        pWriteRead->Phase = WriteReadIdle;
+        WdfInterruptReleaseLock(pDevice->InterruptObject);
+
+        pRequest->Status = STATUS_IO_DEVICE_ERROR;
+        pRequest->TransferIndex = pRequest->TransferCount - 1;
+        pDevice->pCurrentTarget->Statistics.WriteReadErrors++;
+
+        ControllerCompleteTransfer(pDevice, pRequest);
+        PbcRequestComplete(pRequest);
+    }
+
+    FuncExit(TRACE_FLAG_TRANSFER);
+}
+
+BOOLEAN
+ControllerProcessWriteRead(
+    _In_  PPBC_DEVICE   pDevice,
+    _In_  ULONG         InterruptStatus
+    )
+/*++
+ 
+  Routine Description:
+
+    This routine advances the write-then-read state machine.
+    It is called from the ISR with the interrupt lock held and
+    only touches the pre-mapped buffers in the device context.
+
+  Arguments:
+
+    pDevice - a pointer to the PBC device context
+    InterruptStatus - the TWI status code
+
+  Return Value:
+
+    TRUE if the transaction has finished and the DPC
+    must complete the request.
+
+--*/
+{
+	PPBC_WRITE_READ pWriteRead = &pDevice->WriteRead;
+	PPBC_TARGET_SETTINGS pSettings = &pDevice->pCurrentTarget->Settings;
+	UCHAR tmp = 0;
+
+	switch (InterruptStatus)
+	{
+	case TWI_STAT_IDLE: /* no relevant status, not our interrupt */
+		return FALSE;
+	case TWI_STAT_TX_STA: /* A START condition has been transmitted */
+		if (pSettings->AddressMode == AddressMode10Bit) {
+			tmp = (0x78 | ((pSettings->Address >> 8) & 0x03)) << 1;
+		}
+		else {
+			tmp = (pSettings->Address & 0x7f) << 1;
+		}
+		TwiPutByte(pDevice, &tmp);
+		return FALSE;
+	case TWI_STAT_TX_RESTA: /* A repeated start, turn the bus around for the read */
+		if (pSettings->AddressMode == AddressMode10Bit) {
+			tmp = (0x78 | ((pSettings->Address >> 8) & 0x03)) << 1;
+		}
+		else {
+			tmp = (pSettings->Address & 0x7f) << 1;
+		}
+		tmp |= 1;
+		TwiPutByte(pDevice, &tmp);
+		return FALSE;
+	case TWI_STAT_TX_AW_ACK: /* SLA+W has been transmitted; ACK has been received */
+		if (pSettings->AddressMode == AddressMode10Bit) {
+			tmp = pSettings->Address & 0xff;
+			TwiPutByte(pDevice, &tmp);
+			return FALSE;
+		}
+		/* for 7 bit addr, then directly send data byte */
+	case TWI_STAT_TX_SAW_ACK: /* second addr has transmitted,ACK received! */
+	case TWI_STAT_TXD_ACK: /* Data byte in DATA REG has been transmitted; ACK has been received */
+		if (pWriteRead->Index < pWriteRead->WriteLength) {
+			TwiPutByte(pDevice, &pWriteRead->pWriteBuffer[pWriteRead->Index]);
+			pWriteRead->Index++;
+			return FALSE;
+		}
+		/* register address sent, repeated start for the read half */
+		pWriteRead->Phase = WriteReadRead;
+		pWriteRead->Index = 0;
+		if (AW_I2C_OK == TwiRestart(pDevice)) {
+			return FALSE;
+		}
+		pWriteRead->Status = STATUS_IO_DEVICE_ERROR;
+		break;
+	case TWI_STAT_TX_AR_ACK: /* SLA+R has been transmitted; ACK has been received */
+		/* enable A_ACK need it(receive data len) more than 1. */
+		if (pWriteRead->ReadLength > 1) {
+			TwiEnableAck(pDevice);
+		}
+		TwiClearIrqFlag(pDevice);
+		return FALSE;
+	case TWI_STAT_RXD_ACK: /* Data bytes has been received; ACK has been transmitted */
+		if (pWriteRead->Index + 1 < pWriteRead->ReadLength) {
+			/* the last byte need not to send ACK */
+			if ((pWriteRead->Index + 2) == pWriteRead->ReadLength) {
+				TwiDisableAck(pDevice);
+			}
+			TwiGetByte(pDevice, &pWriteRead->pReadBuffer[pWriteRead->Index]);
+			pWriteRead->Index++;
+			return FALSE;
+		}
+		/* the last byte should be @case 0x58 */
+		pWriteRead->Status = STATUS_UNSUCCESSFUL;
+		break;
+	case TWI_STAT_RXD_NAK: /* Data byte has been received; NOT ACK has been transmitted */
+		if (pWriteRead->Index + 1 == pWriteRead->ReadLength) {
+			TwiGetLastByte(pDevice, &pWriteRead->pReadBuffer[pWriteRead->Index]);
+			pWriteRead->Index++;
+			break;
+		}
+		pWriteRead->Status = STATUS_UNSUCCESSFUL;
+		break;
+	case TWI_STAT_TX_SAW_NAK: /* second addr has transmitted, ACK not received! */
+	case TWI_STAT_TX_AW_NAK: /* SLA+W has been transmitted; NOT ACK has been received */
+		pWriteRead->Status = STATUS_NO_SUCH_DEVICE;
+		break;
+	default:
+		pWriteRead->Status = STATUS_UNSUCCESSFUL;
+		break;
+	}
+
+	if (AW_I2C_TFAIL == TwiStop(pDevice)) {
+		pDevice->bResetPending = TRUE;
+	}
+	if (!NT_SUCCESS(pWriteRead->Status)) {
+		pDevice->bResetPending = TRUE;
+	}
+
+	pWriteRead->EndTime = KeQueryPerformanceCounter(NULL);
+	pWriteRead->Phase = WriteReadDone;
+
+	return TRUE;
+}
+
+VOID
+ControllerCompleteWriteRead(
+    _In_  PPBC_DEVICE   pDevice,
+    _In_  PPBC_REQUEST  pRequest
+    )
+/*++
+ 
+  Routine Description:
+
+    This routine completes a finished write-then-read
+    transaction and updates the target's latency counters.
+
+  Arguments:
+
+    pDevice - a pointer to the PBC device context
+    pRequest - a pointer to the PBC request context
+
+  Return Value:
+
+    None. The request is completed asynchronously.
+
+--*/
+{
+    FuncEntry(TRACE_FLAG_TRANSFER);
+
+    NT_ASSERT(pDevice  != NULL);
+    NT_ASSERT(pRequest != NULL);
+
+    PPBC_WRITE_READ pWriteRead = &pDevice->WriteRead;
+    PPBC_TARGET_STATISTICS pStats = &pDevice->pCurrentTarget->Statistics;
+    ULONG latencyUs;
+
+    NT_ASSERT(pWriteRead->Phase == WriteReadDone);
+
+    latencyUs = (ULONG)(((pWriteRead->EndTime.QuadPart - pWriteRead->StartTime.QuadPart) * 1000000) /
+        pDevice->PerfFrequency.QuadPart);
+
+    pStats->WriteReadCount++;
+    pStats->LastLatencyUs = latencyUs;
+    pStats->TotalLatencyUs += latencyUs;
+    if ((pStats->MinLatencyUs == 0) || (latencyUs < pStats->MinLatencyUs))
+    {
+        pStats->MinLatencyUs = latencyUs;
+    }
+    if (latencyUs > pStats->MaxLatencyUs)
+    {
+        pStats->MaxLatencyUs = latencyUs;
+    }
+
+    //
+    // Report the bytes of both halves, the write is
+    // complete once the read phase has been reached.
+    //
+
+    pRequest->Status = pWriteRead->Status;
+    pRequest->TotalInformation = pWriteRead->WriteLength + pWriteRead->Index;
+    if (!NT_SUCCESS(pRequest->Status))
+    {
+        pStats->WriteReadErrors++;
+        pRequest->TotalInformation = 0;
+    }
+
+    Trace(
+        TRACE_LEVEL_INFORMATION,
+        TRACE_FLAG_TRANSFER,
+        "Write-read for address 0x%lx took %lu us (count %lu, min %lu, max %lu, "
+        "errors %lu) - %!STATUS!",
+        pDevice->pCurrentTarget->Settings.Address,
+        latencyUs,
+        pStats->WriteReadCount,
+        pStats->MinLatencyUs,
+        pStats->MaxLatencyUs,
+        pStats->WriteReadErrors,
+        pRequest->Status);
+
+    pWriteRead->Phase = WriteReadIdle;
+
+    //
+    // Complete as the last transfer of the sequence.
+    //
+
+    pRequest->TransferIndex = pRequest->TransferCount - 1;
+    pRequest->Information = 0;
+
+    ControllerCompleteTransfer(pDevice, pRequest);
+    PbcRequestComplete(pRequest);
+
+    FuncExit(TRACE_FLAG_TRANSFER);
+}
+
+//NTSTATUS
+//ControllerTransferData(
+//    _In_  PPBC_DEVICE   pDevice,
+//    _In_  PPBC_REQUEST  pRequest
+//    )
+///*++
+// 
+//  Routine Description:
+//
+//    This routine transfers data to or from the device.
+//
+//  Arguments:
+//
+//    pDevice - a pointer to the PBC device context
+//    pRequest - a pointer to the PBC request context
+//
+//  Return Value:
+//
+//    None.
+//
+//--*/
+//{
+//    FuncEntry(TRACE_FLAG_TRANSFER);
+//
+//    UNREFERENCED_PARAMETER(pDevice);
+//
+//    size_t bytesToTransfer = 0;
+//    NTSTATUS status = STATUS_SUCCESS;
+//
+//    //
+//    // Write
+//    //
+//
+//    if (pRequest->Direction == SpbTransferDirectionToDevice)
+//    {
+//        Trace(
 //            TRACE_LEVEL_INFORMATION, 
 //            TRACE_FLAG_TRANSFER,
 //            "Ready to write %Iu byte(s) for address 0x%lx", 
@@ -1112,6 +1672,8 @@ ControllerCompleteTransfer(
         }
     }
 
+    ControllerTraceComplete(pDevice, pRequest);
+
     //
     // Done or error occurred. Set interrupt mask to 0.
     // Doing this keeps the DPC from re-enabling interrupts.
@@ -1303,3 +1865,390 @@ ControllerGetInterruptStatus(
 //
 //    FuncExit(TRACE_FLAG_TRANSFER);
 //}
+
+VOID
+ControllerTraceEvent(
+    _In_  PPBC_DEVICE   pDevice,
+    _In_  UCHAR         Event,
+    _In_  ULONG         TwiStatus,
+    _In_  USHORT        Count,
+    _In_  NTSTATUS      Status
+    )
+/*++
+ 
+  Routine Description:
+
+    This routine appends a record to the transaction trace.
+    It takes no lock and may be called from the ISR.
+
+  Arguments:
+
+    pDevice - a pointer to the PBC device context
+    Event - the SUNXII2C_TRACE_EVENT being recorded
+    TwiStatus - TWI status code, zero if not applicable
+    Count - event specific byte or interrupt count
+    Status - event specific status
+
+  Return Value:
+
+    None.
+
+--*/
+{
+    PPBC_TRACE pTrace = &pDevice->Trace;
+    PSUNXII2C_TRACE_RECORD pRecord;
+    ULONG sequence;
+
+    //
+    // Claim a slot. The sequence number is cleared while the
+    // record is rewritten and stored last, a reader discards
+    // records whose sequence does not match the slot.
+    //
+
+    sequence = (ULONG)InterlockedIncrement(&pTrace->Sequence);
+    pRecord = &pTrace->Records[sequence & (PBC_TRACE_RECORDS - 1)];
+
+    pRecord->Sequence = 0;
+    KeMemoryBarrier();
+
+    pRecord->Timestamp = (ULONGLONG)KeQueryPerformanceCounter(NULL).QuadPart;
+    pRecord->Status = Status;
+    pRecord->Address = pTrace->Address;
+    pRecord->Count = Count;
+    pRecord->Event = Event;
+    pRecord->TwiStatus = (UCHAR)TwiStatus;
+    pRecord->Position = pTrace->Position;
+    pRecord->TransferIndex = pTrace->TransferIndex;
+
+    KeMemoryBarrier();
+    pRecord->Sequence = sequence;
+}
+
+VOID
+ControllerTraceBegin(
+    _In_  PPBC_DEVICE   pDevice,
+    _In_  PPBC_REQUEST  pRequest,
+    _In_  size_t        Length
+    )
+/*++
+ 
+  Routine Description:
+
+    This routine records the start of a transfer. It must
+    be called before the transfer's interrupts are enabled.
+
+  Arguments:
+
+    pDevice - a pointer to the PBC device context
+    pRequest - a pointer to the PBC request context
+    Length - bytes to be transferred
+
+  Return Value:
+
+    None.
+
+--*/
+{
+    PPBC_TRACE pTrace = &pDevice->Trace;
+
+    //
+    // Latency covers the whole request, including
+    // any bus recovery that restarted a transfer.
+    //
+
+    if (pRequest->StartTime.QuadPart == 0)
+    {
+        pRequest->StartTime = KeQueryPerformanceCounter(NULL);
+    }
+
+    pTrace->Address = pDevice->pCurrentTarget->Settings.Address;
+    pTrace->Position = (UCHAR)pRequest->SequencePosition;
+    pTrace->TransferIndex = (UCHAR)pRequest->TransferIndex;
+    pTrace->InterruptCount = 0;
+
+    ControllerTraceEvent(
+        pDevice,
+        Sunxii2cTraceStart,
+        0,
+        (USHORT)min(Length, MAXUSHORT),
+        STATUS_SUCCESS);
+}
+
+VOID
+ControllerTraceComplete(
+    _In_  PPBC_DEVICE   pDevice,
+    _In_  PPBC_REQUEST  pRequest
+    )
+/*++
+ 
+  Routine Description:
+
+    This routine records the completion of a request and
+    adds its latency to the current target's histogram.
+    Called with the device lock held.
+
+  Arguments:
+
+    pDevice - a pointer to the PBC device context
+    pRequest - a pointer to the PBC request context
+
+  Return Value:
+
+    None.
+
+--*/
+{
+    PPBC_TARGET pTarget = pDevice->pCurrentTarget;
+    PSUNXII2C_TARGET_HISTOGRAM pHistogram;
+    LARGE_INTEGER now;
+    ULONG latencyUs;
+    ULONG bucket;
+    ULONG value;
+
+    ControllerTraceEvent(
+        pDevice,
+        Sunxii2cTraceComplete,
+        0,
+        (USHORT)min(pRequest->TotalInformation, MAXUSHORT),
+        pRequest->Status);
+
+    if ((pTarget == NULL) ||
+        (pTarget->HistogramIndex == PBC_TRACE_NO_HISTOGRAM) ||
+        (pRequest->StartTime.QuadPart == 0))
+    {
+        return;
+    }
+
+    now = KeQueryPerformanceCounter(NULL);
+    latencyUs = (ULONG)(((now.QuadPart - pRequest->StartTime.QuadPart) * 1000000) /
+        pDevice->PerfFrequency.QuadPart);
+
+    //
+    // Bucket 0 holds everything under the base,
+    // every following bucket doubles the bound.
+    //
+
+    bucket = 0;
+    value = latencyUs >> SUNXII2C_HISTOGRAM_BASE_SHIFT;
+    while ((value != 0) && (bucket < SUNXII2C_HISTOGRAM_BUCKETS - 1))
+    {
+        value >>= 1;
+        bucket++;
+    }
+
+    pHistogram = &pDevice->Trace.Histograms[pTarget->HistogramIndex];
+    pHistogram->Transactions++;
+    pHistogram->TotalLatencyUs += latencyUs;
+    pHistogram->Buckets[bucket]++;
+    if (latencyUs > pHistogram->MaxLatencyUs)
+    {
+        pHistogram->MaxLatencyUs = latencyUs;
+    }
+    if (!NT_SUCCESS(pRequest->Status))
+    {
+        pHistogram->Errors++;
+    }
+}
+
+VOID
+ControllerTraceAttachTarget(
+    _In_  PPBC_DEVICE   pDevice,
+    _In_  PPBC_TARGET   pTarget
+    )
+/*++
+ 
+  Routine Description:
+
+    This routine assigns a latency histogram to a target.
+    Targets sharing an address share a histogram, so it
+    survives the target being closed and reopened.
+
+  Arguments:
+
+    pDevice - a pointer to the PBC device context
+    pTarget - a pointer to the PBC target context
+
+  Return Value:
+
+    None.
+
+--*/
+{
+    FuncEntry(TRACE_FLAG_SPBDDI);
+
+    PPBC_TRACE pTrace = &pDevice->Trace;
+    ULONG i;
+
+    pTarget->HistogramIndex = PBC_TRACE_NO_HISTOGRAM;
+
+    WdfSpinLockAcquire(pDevice->Lock);
+
+    for (i = 0; i < pTrace->HistogramCount; i++)
+    {
+        if (pTrace->Histograms[i].Address == pTarget->Settings.Address)
+        {
+            pTarget->HistogramIndex = i;
+            break;
+        }
+    }
+
+    if ((pTarget->HistogramIndex == PBC_TRACE_NO_HISTOGRAM) &&
+        (pTrace->HistogramCount < SUNXII2C_HISTOGRAM_MAX_TARGETS))
+    {
+        pTarget->HistogramIndex = pTrace->HistogramCount++;
+        pTrace->Histograms[pTarget->HistogramIndex].Address =
+            pTarget->Settings.Address;
+    }
+
+    WdfSpinLockRelease(pDevice->Lock);
+
+    if (pTarget->HistogramIndex == PBC_TRACE_NO_HISTOGRAM)
+    {
+        Trace(
+            TRACE_LEVEL_WARNING,
+            TRACE_FLAG_SPBDDI,
+            "No latency histogram left for address 0x%lx",
+            pTarget->Settings.Address);
+    }
+
+    FuncExit(TRACE_FLAG_SPBDDI);
+}
+
+NTSTATUS
+ControllerTraceQuery(
+    _In_                          PPBC_DEVICE   pDevice,
+    _In_                          ULONG         IoControlCode,
+    _Out_writes_bytes_(Length)    PVOID         pBuffer,
+    _In_                          size_t        Length,
+    _Out_                         size_t*       pBytesReturned
+    )
+/*++
+ 
+  Routine Description:
+
+    This routine copies the transaction trace or the
+    latency histograms to a caller's buffer.
+
+  Arguments:
+
+    pDevice - a pointer to the PBC device context
+    IoControlCode - IOCTL_SUNXII2C_QUERY_TRACE or
+        IOCTL_SUNXII2C_QUERY_HISTOGRAM
+    pBuffer - the output buffer
+    Length - the size of the output buffer
+    pBytesReturned - receives the bytes written
+
+  Return Value:
+
+    Status
+
+--*/
+{
+    FuncEntry(TRACE_FLAG_SPBDDI);
+
+    PPBC_TRACE pTrace = &pDevice->Trace;
+    NTSTATUS status = STATUS_SUCCESS;
+
+    *pBytesReturned = 0;
+
+    if (IoControlCode == IOCTL_SUNXII2C_QUERY_TRACE)
+    {
+        PSUNXII2C_TRACE pOut = (PSUNXII2C_TRACE)pBuffer;
+        PSUNXII2C_TRACE_RECORD pRecord;
+        ULONG last;
+        ULONG count;
+        ULONG copied;
+        ULONG i;
+
+        if (Length < FIELD_OFFSET(SUNXII2C_TRACE, Records))
+        {
+            status = STATUS_BUFFER_TOO_SMALL;
+            goto exit;
+        }
+
+        //
+        // Copy the newest records that fit, oldest first. Records
+        // keep being written meanwhile. A slot is only kept if it
+        // held the expected sequence both before and after it was
+        // copied, otherwise the writer cleared or reused it and
+        // the copy may be torn.
+        //
+
+        last = (ULONG)InterlockedOr(&pTrace->Sequence, 0);
+
+        count = (ULONG)((Length - FIELD_OFFSET(SUNXII2C_TRACE, Records)) /
+            sizeof(SUNXII2C_TRACE_RECORD));
+        count = min(count, min(last, PBC_TRACE_RECORDS));
+        copied = 0;
+
+        for (i = 0; i < count; i++)
+        {
+            ULONG sequence = last - count + 1 + i;
+
+            pRecord = &pTrace->Records[sequence & (PBC_TRACE_RECORDS - 1)];
+
+            if (*(volatile ULONG*)&pRecord->Sequence != sequence)
+            {
+                continue;
+            }
+
+            KeMemoryBarrier();
+            pOut->Records[copied] = *pRecord;
+            KeMemoryBarrier();
+
+            if ((*(volatile ULONG*)&pRecord->Sequence != sequence) ||
+                (pOut->Records[copied].Sequence != sequence))
+            {
+                continue;
+            }
+
+            copied++;
+        }
+
+        pOut->Version = SUNXII2C_TRACE_VERSION;
+        pOut->RecordSize = sizeof(SUNXII2C_TRACE_RECORD);
+        pOut->RecordCount = copied;
+        pOut->NextSequence = last + 1;
+        pOut->BusNumber = pDevice->BusNumber;
+        pOut->Reserved = 0;
+        pOut->Frequency = (ULONGLONG)pDevice->PerfFrequency.QuadPart;
+
+        *pBytesReturned = FIELD_OFFSET(SUNXII2C_TRACE, Records) +
+            copied * sizeof(SUNXII2C_TRACE_RECORD);
+    }
+    else if (IoControlCode == IOCTL_SUNXII2C_QUERY_HISTOGRAM)
+    {
+        PSUNXII2C_HISTOGRAM pOut = (PSUNXII2C_HISTOGRAM)pBuffer;
+
+        if (Length < sizeof(SUNXII2C_HISTOGRAM))
+        {
+            status = STATUS_BUFFER_TOO_SMALL;
+            goto exit;
+        }
+
+        RtlZeroMemory(pOut, sizeof(SUNXII2C_HISTOGRAM));
+
+        WdfSpinLockAcquire(pDevice->Lock);
+
+        pOut->Version = SUNXII2C_TRACE_VERSION;
+        pOut->TargetCount = pTrace->HistogramCount;
+        RtlCopyMemory(
+            pOut->Targets,
+            pTrace->Histograms,
+            pTrace->HistogramCount * sizeof(SUNXII2C_TARGET_HISTOGRAM));
+
+        WdfSpinLockRelease(pDevice->Lock);
+
+        *pBytesReturned = sizeof(SUNXII2C_HISTOGRAM);
+    }
+    else
+    {
+        status = STATUS_NOT_SUPPORTED;
+    }
+
+exit:
+
+    FuncExit(TRACE_FLAG_SPBDDI);
+
+    return status;
+}
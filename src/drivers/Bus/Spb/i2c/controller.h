@@ -29,6 +29,19 @@ VOID ControllerInitialize(
 VOID ControllerUninitialize(
     _In_  PPBC_DEVICE   pDevice);
 
+ULONG
+ControllerCalculateClock(
+    _In_      ULONG         ConnectionSpeed,
+    _Out_opt_ PULONG        pActualSpeed);
+
+int
+ControllerRunBusRecovery(
+    _In_  PPBC_DEVICE   pDevice);
+
+BOOLEAN
+ControllerStopBusRecovery(
+    _In_  PPBC_DEVICE   pDevice);
+
 VOID
 ControllerConfigureForTransfer(
     _In_  PPBC_DEVICE   pDevice,
@@ -39,6 +52,21 @@ ControllerConfigureForTransfer(
 //    _In_  PPBC_DEVICE   pDevice,
 //    _In_  PPBC_REQUEST  pRequest);
     
+VOID
+ControllerStartWriteRead(
+    _In_  PPBC_DEVICE   pDevice,
+    _In_  PPBC_REQUEST  pRequest);
+
+BOOLEAN
+ControllerProcessWriteRead(
+    _In_  PPBC_DEVICE   pDevice,
+    _In_  ULONG         InterruptStatus);
+
+VOID
+ControllerCompleteWriteRead(
+    _In_  PPBC_DEVICE   pDevice,
+    _In_  PPBC_REQUEST  pRequest);
+
 VOID
 ControllerCompleteTransfer(
     _In_  PPBC_DEVICE   pDevice,
@@ -69,4 +97,36 @@ ControllerProcessInterrupts(
     _In_  PPBC_REQUEST  pRequest,
     _In_  ULONG         InterruptStatus);
 
+VOID
+ControllerTraceEvent(
+    _In_  PPBC_DEVICE   pDevice,
+    _In_  UCHAR         Event,
+    _In_  ULONG         TwiStatus,
+    _In_  USHORT        Count,
+    _In_  NTSTATUS      Status);
+
+VOID
+ControllerTraceBegin(
+    _In_  PPBC_DEVICE   pDevice,
+    _In_  PPBC_REQUEST  pRequest,
+    _In_  size_t        Length);
+
+VOID
+ControllerTraceComplete(
+    _In_  PPBC_DEVICE   pDevice,
+    _In_  PPBC_REQUEST  pRequest);
+
+VOID
+ControllerTraceAttachTarget(
+    _In_  PPBC_DEVICE   pDevice,
+    _In_  PPBC_TARGET   pTarget);
+
+NTSTATUS
+ControllerTraceQuery(
+    _In_                          PPBC_DEVICE   pDevice,
+    _In_                          ULONG         IoControlCode,
+    _Out_writes_bytes_(Length)    PVOID         pBuffer,
+    _In_                          size_t        Length,
+    _Out_                         size_t*       pBytesReturned);
+
 #endif
@@ -256,10 +256,30 @@ OnD0Exit(
     PPBC_DEVICE pDevice = GetDeviceContext(FxDevice);
     NT_ASSERT(pDevice != NULL);
     
+    PPBC_REQUEST pRequest = NULL;
+    BOOLEAN bTransferCompleted = FALSE;
     NTSTATUS status = STATUS_SUCCESS;
     
     UNREFERENCED_PARAMETER(FxPreviousState);
 
+    WdfSpinLockAcquire(pDevice->Lock);
+
+    //
+    // A request waiting for bus recovery would never
+    // be restarted, fail it.
+    //
+
+    if (ControllerStopBusRecovery(pDevice) &&
+        (pDevice->pCurrentTarget != NULL) &&
+        (pDevice->pCurrentTarget->pCurrentRequest != NULL))
+    {
+        pRequest = pDevice->pCurrentTarget->pCurrentRequest;
+        pRequest->Status = STATUS_IO_DEVICE_ERROR;
+
+        ControllerCompleteTransfer(pDevice, pRequest);
+        bTransferCompleted = pRequest->bIoComplete;
+    }
+
     //
     // Uninitialize controller.
     //
@@ -268,6 +288,17 @@ OnD0Exit(
 
     pDevice->pCurrentTarget = NULL;
 
+    WdfSpinLockRelease(pDevice->Lock);
+
+    //
+    // Complete the request outside of the locked code.
+    //
+
+    if (bTransferCompleted)
+    {
+        PbcRequestComplete(pRequest);
+    }
+
     FuncExit(TRACE_FLAG_WDFLOADING);
 
     return status;
@@ -548,6 +579,47 @@ OnTargetConnect(
         pTarget->SpbTarget = SpbTarget;
         pTarget->pCurrentRequest = NULL;
 
+        //
+        // Resolve the clock divider now rather than
+        // on every transfer to this target.
+        //
+
+        ULONG requestedSpeed = (pTarget->Settings.ConnectionSpeed != 0) ?
+            pTarget->Settings.ConnectionSpeed : pDevice->BusSpeed;
+
+        pTarget->ClockRegister = ControllerCalculateClock(
+            requestedSpeed,
+            &pTarget->ClockFrequency);
+
+        ControllerTraceAttachTarget(pDevice, pTarget);
+
+        if (requestedSpeed == 0)
+        {
+            requestedSpeed = TWI_DEFAULT_SPEED;
+        }
+
+        //
+        // Error in hundredths of a percent, negative
+        // when the clock is faster than requested.
+        //
+
+        LONGLONG clockError =
+            (((LONGLONG)requestedSpeed - (LONGLONG)pTarget->ClockFrequency) * 10000) /
+            (LONGLONG)requestedSpeed;
+        LONGLONG clockErrorMagnitude = (clockError < 0) ? -clockError : clockError;
+
+        Trace(
+            TRACE_LEVEL_INFORMATION,
+            TRACE_FLAG_SPBDDI,
+            "Target at address 0x%lx requested %lu Hz, clock set to %lu Hz "
+            "(error %s%I64d.%02I64d%%)",
+            pTarget->Settings.Address,
+            requestedSpeed,
+            pTarget->ClockFrequency,
+            (clockError < 0) ? "-" : "",
+            clockErrorMagnitude / 100,
+            clockErrorMagnitude % 100);
+
         Trace(
             TRACE_LEVEL_INFORMATION,
             TRACE_FLAG_SPBDDI,
@@ -838,17 +910,6 @@ OnSequence(
     FuncEntry(TRACE_FLAG_SPBDDI);
 	AWPRINT(" OnSequence ");
 
-    PPBC_DEVICE  pDevice  = GetDeviceContext(SpbController);
-    PPBC_TARGET  pTarget  = GetTargetContext(SpbTarget);
-    PPBC_REQUEST pRequest = GetRequestContext(SpbRequest);
-    //BOOLEAN completeRequest = FALSE;
-    
-    NT_ASSERT(pDevice  != NULL);
-    NT_ASSERT(pTarget  != NULL);
-    NT_ASSERT(pRequest != NULL);
-    
-    NTSTATUS status;
-    
     //
     // Get request parameters.
     //
@@ -860,132 +921,13 @@ OnSequence(
     NT_ASSERT(params.Position == SpbRequestSequencePositionSingle);
     NT_ASSERT(params.Type == SpbRequestTypeSequence);
 
-    //
-    // Initialize request context.
-    //
-    
-    pRequest->SpbRequest = SpbRequest;
-    pRequest->Type = params.Type;
-    pRequest->TotalInformation = 0;
-    pRequest->TransferCount = TransferCount;
-    pRequest->TransferIndex = 0;
-    pRequest->bIoComplete = FALSE;
-
-    Trace(
-        TRACE_LEVEL_INFORMATION,
-        TRACE_FLAG_SPBDDI,
-        "Received sequence request %p with transfer count %d for SPBTARGET %p "
-        "(WDFDEVICE %p)",
-        pRequest->SpbRequest,
-        pRequest->TransferCount,
+    PbcRequestConfigureForSequence(
+        SpbController,
         SpbTarget,
-        SpbController);
-
-    status = PbcRequestConfigureForIndex(pRequest, 0);
-
-    if (!NT_SUCCESS(status))
-    {
-        Trace(
-            TRACE_LEVEL_ERROR, 
-            TRACE_FLAG_SPBDDI, 
-            "Error configuring request context for SPBREQUEST %p "
-            "(SPBTARGET %p) - %!STATUS!",
-            pRequest->SpbRequest,
-            SpbTarget,
-            status);
-
-        goto exit;
-    }
-
-    //
-    // Acquire the device lock.
-    //
-
-    WdfSpinLockAcquire(pDevice->Lock);
-
-    //
-    // Mark request cancellable (if cancellation supported).
-    //
-
-    status = WdfRequestMarkCancelableEx(
-        pRequest->SpbRequest, OnCancel);
-
-    if (!NT_SUCCESS(status))
-    {
-        //
-        // WdfRequestMarkCancelableEx should only fail if the request
-        // has already been cancelled. If it does fail the request
-        // must be completed with the corresponding status.
-        //
-
-        NT_ASSERTMSG("WdfRequestMarkCancelableEx should only fail if the request has already been cancelled",
-            status == STATUS_CANCELLED);
-
-        Trace(
-            TRACE_LEVEL_INFORMATION,
-            TRACE_FLAG_TRANSFER,
-            "Failed to mark SPBREQUEST %p cancellable - %!STATUS!",
-            pRequest->SpbRequest,
-            status);
-        
-        WdfSpinLockRelease(pDevice->Lock);
-        goto exit;
-    }
-    
-    //
-    // Update device and target contexts.
-    //
-
-    NT_ASSERT(pDevice->pCurrentTarget == NULL);
-    NT_ASSERT(pTarget->pCurrentRequest == NULL);
-    
-    pDevice->pCurrentTarget = pTarget;
-    pTarget->pCurrentRequest = pRequest;
-    
-    //
-    // Configure controller and kick-off read.
-    // Request will be completed asynchronously.
-    //
-    
-    PbcRequestDoTransfer(pDevice, pRequest);
-    
-    // TODO: Remove this block. For the purpose of this 
-    //       skeleton sample, simply complete the request 
-    //       synchronously. This must be done outside of 
-    //       the locked code.
-   /* if (pRequest->bIoComplete)
-    {
-        completeRequest = TRUE;
-    }
-    */
-    WdfSpinLockRelease(pDevice->Lock);
-    
-    // TODO: Remove this block. For the purpose of this 
-    //       skeleton sample, simply complete the request 
-    //       synchronously. This must be done outside of 
-    //       the locked code.
-    //if (completeRequest)
-    //{
-    //    PbcRequestComplete(pRequest);
-    //}
-
-exit:
-
-    if (!NT_SUCCESS(status))
-    {
-        Trace(
-            TRACE_LEVEL_ERROR,
-            TRACE_FLAG_SPBDDI,
-            "Error configuring sequence, completing "
-            "SPBREQUEST %p synchronously - %!STATUS!", 
-            pRequest->SpbRequest,
-            status);
+        SpbRequest,
+        TransferCount);
 
-        SpbRequestComplete(SpbRequest, status);
-    }
-    
     FuncExit(TRACE_FLAG_SPBDDI);
-
 }
 
 VOID
@@ -1043,6 +985,38 @@ OnOtherInCallerContext(
         goto exit;
     }
 
+    //
+    // Trace queries are answered right here, they do not
+    // touch the bus and need no SPB target.
+    //
+
+    if ((fxParams.Parameters.DeviceIoControl.IoControlCode == IOCTL_SUNXII2C_QUERY_TRACE) ||
+        (fxParams.Parameters.DeviceIoControl.IoControlCode == IOCTL_SUNXII2C_QUERY_HISTOGRAM))
+    {
+        PVOID pBuffer;
+        size_t length;
+        size_t bytesReturned = 0;
+
+        status = WdfRequestRetrieveOutputBuffer(
+            FxRequest,
+            FIELD_OFFSET(SUNXII2C_TRACE, Records),
+            &pBuffer,
+            &length);
+
+        if (NT_SUCCESS(status))
+        {
+            status = ControllerTraceQuery(
+                GetDeviceContext(SpbController),
+                fxParams.Parameters.DeviceIoControl.IoControlCode,
+                pBuffer,
+                length,
+                &bytesReturned);
+        }
+
+        WdfRequestCompleteWithInformation(FxRequest, status, bytesReturned);
+        goto done;
+    }
+
     //
     // TODO: verify the driver supports this DeviceIoContol code,
     //       otherwise mark as STATUS_NOT_SUPPORTED and complete.
@@ -1086,6 +1060,8 @@ exit:
     {
         WdfRequestComplete(FxRequest, status);
     }
+
+done:
     
     FuncExit(TRACE_FLAG_SPBDDI);
 }
@@ -1127,14 +1103,36 @@ OnOther(
     FuncEntry(TRACE_FLAG_SPBDDI);
 	AWPRINT(" OnOther ");
     
-    NTSTATUS status = STATUS_SUCCESS;
+    NTSTATUS status = STATUS_NOT_SUPPORTED;
 
-    UNREFERENCED_PARAMETER(SpbController);
-    UNREFERENCED_PARAMETER(SpbTarget);
-    UNREFERENCED_PARAMETER(SpbRequest);
     UNREFERENCED_PARAMETER(OutputBufferLength);
     UNREFERENCED_PARAMETER(InputBufferLength);
-    UNREFERENCED_PARAMETER(IoControlCode);
+
+    //
+    // On I2C a full duplex transfer is a write followed
+    // by a read with a repeated start, which is exactly
+    // a two transfer sequence.
+    //
+
+    if (IoControlCode == IOCTL_SPB_FULL_DUPLEX)
+    {
+        SPB_REQUEST_PARAMETERS params;
+        SPB_REQUEST_PARAMETERS_INIT(&params);
+        SpbRequestGetParameters(SpbRequest, &params);
+
+        if (params.SequenceTransferCount == 2)
+        {
+            PbcRequestConfigureForSequence(
+                SpbController,
+                SpbTarget,
+                SpbRequest,
+                params.SequenceTransferCount);
+
+            goto exit;
+        }
+
+        status = STATUS_INVALID_PARAMETER;
+    }
 
     //
     // TODO: the driver should take the following steps
@@ -1156,11 +1154,17 @@ OnOther(
     //
 
 
-    // TODO: Remove this block. For the purpose of this 
-    //       skeleton sample, simply complete the request 
-    //       synchronously. Note this must be done outside
-    //       of any locked code.
+    Trace(
+        TRACE_LEVEL_ERROR,
+        TRACE_FLAG_SPBDDI,
+        "IOCTL 0x%lx is not supported for SPBREQUEST %p - %!STATUS!",
+        IoControlCode,
+        SpbRequest,
+        status);
+
     SpbRequestComplete(SpbRequest, status);
+
+exit:
     
     FuncExit(TRACE_FLAG_SPBDDI);
 }
@@ -1264,6 +1268,12 @@ OnCancel(
             TRACE_FLAG_TRANSFER,
             "Delay timer previously schedule, now stopped");
     }
+
+    //
+    // Stop bus recovery if it was running for this request.
+    //
+
+    ControllerStopBusRecovery(pDevice);
     
     //
     // Disable interrupts and clear saved stat for DPC. 
@@ -1277,6 +1287,14 @@ OnCancel(
 
     ControllerDisableInterrupts(pDevice);
     pDevice->InterruptStatus = 0;
+    pDevice->WriteRead.Phase = WriteReadIdle;
+
+    //
+    // The transfer was abandoned mid-way, make the
+    // next one start from a reset controller.
+    //
+
+    pDevice->bResetPending = TRUE;
     
     //
     // TODO: Implement any necessary logic to abort the
@@ -1371,6 +1389,42 @@ OnInterruptIsr(
 		pDevice,
 		PbcDeviceGetInterruptMask(pDevice));
 
+	//
+	// A write-read transaction is advanced right here,
+	// the DPC is only queued once it has finished.
+	//
+
+	if ((pDevice->WriteRead.Phase == WriteReadWrite) ||
+		(pDevice->WriteRead.Phase == WriteReadRead))
+	{
+		//
+		// An idle or zero status is not from this controller,
+		// leave the interrupt to whoever shares the line.
+		//
+
+		if ((stat == TWI_STAT_IDLE) || (stat == 0))
+		{
+			goto exit;
+		}
+
+		interruptRecognized = TRUE;
+
+		ControllerTraceEvent(
+			pDevice,
+			Sunxii2cTraceInterrupt,
+			stat,
+			++pDevice->Trace.InterruptCount,
+			STATUS_SUCCESS);
+
+		if (ControllerProcessWriteRead(pDevice, stat))
+		{
+			ControllerDisableInterrupts(pDevice);
+			WdfInterruptQueueDpcForIsr(Interrupt);
+		}
+
+		goto exit;
+	}
+
 	if (stat > 0)
 	{
 		Trace(
@@ -1388,6 +1442,13 @@ OnInterruptIsr(
 
 		interruptRecognized = TRUE;
 
+		ControllerTraceEvent(
+			pDevice,
+			Sunxii2cTraceInterrupt,
+			stat,
+			++pDevice->Trace.InterruptCount,
+			STATUS_SUCCESS);
+
 		pDevice->InterruptStatus |= (stat);
 		ControllerDisableInterrupts(pDevice);
 
@@ -1403,6 +1464,8 @@ OnInterruptIsr(
 		}
 	}
 
+exit:
+
 	FuncExit(TRACE_FLAG_TRANSFER);
 
 	return interruptRecognized;
@@ -1486,6 +1549,28 @@ OnInterruptDpc(
 
     NT_ASSERT(pRequest->SpbRequest != NULL);
 
+    //
+    // A write-read transaction needs the DPC only
+    // to complete the request once the ISR is done.
+    //
+
+    if (pDevice->WriteRead.Phase != WriteReadIdle)
+    {
+        BOOLEAN bWriteReadDone;
+
+        WdfInterruptAcquireLock(Interrupt);
+        bWriteReadDone = (pDevice->WriteRead.Phase == WriteReadDone);
+        pDevice->InterruptStatus = 0;
+        WdfInterruptReleaseLock(Interrupt);
+
+        if (bWriteReadDone)
+        {
+            ControllerCompleteWriteRead(pDevice, pRequest);
+        }
+
+        goto exit;
+    }
+
     //
     // Synchronize shared data buffers with ISR.
     // Copy interrupt status and clear shared buffer.
@@ -1750,6 +1835,7 @@ PbcRequestConfigureForNonSequence(
     pRequest->TransferCount = 1;
     pRequest->TransferIndex = 0;
     pRequest->bIoComplete = FALSE;
+    pRequest->StartTime.QuadPart = 0;
 
     status = PbcRequestConfigureForIndex(
         pRequest, 
@@ -1874,12 +1960,259 @@ exit:
     FuncExit(TRACE_FLAG_TRANSFER);
 }
 
-NTSTATUS
-PbcRequestConfigureForIndex(
-    _Inout_  PPBC_REQUEST            pRequest,
-    _In_     ULONG                   Index
-    )
-/*++
+VOID
+PbcRequestConfigureForSequence(
+    _In_  WDFDEVICE                  SpbController,
+    _In_  SPBTARGET                  SpbTarget,
+    _In_  SPBREQUEST                 SpbRequest,
+    _In_  ULONG                      TransferCount
+    )
+/*++
+ 
+  Routine Description:
+
+    This is a generic helper routine used to configure
+    the request context and controller hardware for a
+    sequence, whether it came from IOCTL_SPB_EXECUTE_SEQUENCE
+    or IOCTL_SPB_FULL_DUPLEX. A write followed by a read is
+    handed to the ISR driven write-read path.
+
+  Arguments:
+
+    SpbController - a handle to the framework device object
+        representing an SPB controller
+    SpbTarget - a handle to the SPBTARGET object
+    SpbRequest - a handle to the SPBREQUEST object
+    TransferCount - number of individual transfers in the sequence
+
+  Return Value:
+
+    None.  The request is completed asynchronously.
+
+--*/
+{
+    FuncEntry(TRACE_FLAG_TRANSFER);
+
+    PPBC_DEVICE  pDevice  = GetDeviceContext(SpbController);
+    PPBC_TARGET  pTarget  = GetTargetContext(SpbTarget);
+    PPBC_REQUEST pRequest = GetRequestContext(SpbRequest);
+    BOOLEAN bWriteRead;
+    
+    NT_ASSERT(pDevice  != NULL);
+    NT_ASSERT(pTarget  != NULL);
+    NT_ASSERT(pRequest != NULL);
+    
+    NTSTATUS status;
+
+    //
+    // Initialize request context. A full duplex request
+    // is handled exactly like a sequence.
+    //
+    
+    pRequest->SpbRequest = SpbRequest;
+    pRequest->Type = SpbRequestTypeSequence;
+    pRequest->TotalInformation = 0;
+    pRequest->TransferCount = TransferCount;
+    pRequest->TransferIndex = 0;
+    pRequest->bIoComplete = FALSE;
+    pRequest->StartTime.QuadPart = 0;
+
+    Trace(
+        TRACE_LEVEL_INFORMATION,
+        TRACE_FLAG_SPBDDI,
+        "Received sequence request %p with transfer count %d for SPBTARGET %p "
+        "(WDFDEVICE %p)",
+        pRequest->SpbRequest,
+        pRequest->TransferCount,
+        SpbTarget,
+        SpbController);
+
+    status = PbcRequestConfigureForIndex(pRequest, 0);
+
+    if (!NT_SUCCESS(status))
+    {
+        Trace(
+            TRACE_LEVEL_ERROR, 
+            TRACE_FLAG_SPBDDI, 
+            "Error configuring request context for SPBREQUEST %p "
+            "(SPBTARGET %p) - %!STATUS!",
+            pRequest->SpbRequest,
+            SpbTarget,
+            status);
+
+        goto exit;
+    }
+
+    //
+    // Acquire the device lock.
+    //
+
+    WdfSpinLockAcquire(pDevice->Lock);
+
+    //
+    // Mark request cancellable (if cancellation supported).
+    //
+
+    status = WdfRequestMarkCancelableEx(
+        pRequest->SpbRequest, OnCancel);
+
+    if (!NT_SUCCESS(status))
+    {
+        //
+        // WdfRequestMarkCancelableEx should only fail if the request
+        // has already been cancelled. If it does fail the request
+        // must be completed with the corresponding status.
+        //
+
+        NT_ASSERTMSG("WdfRequestMarkCancelableEx should only fail if the request has already been cancelled",
+            status == STATUS_CANCELLED);
+
+        Trace(
+            TRACE_LEVEL_INFORMATION,
+            TRACE_FLAG_TRANSFER,
+            "Failed to mark SPBREQUEST %p cancellable - %!STATUS!",
+            pRequest->SpbRequest,
+            status);
+        
+        WdfSpinLockRelease(pDevice->Lock);
+        goto exit;
+    }
+    
+    //
+    // Update device and target contexts.
+    //
+
+    NT_ASSERT(pDevice->pCurrentTarget == NULL);
+    NT_ASSERT(pTarget->pCurrentRequest == NULL);
+    
+    pDevice->pCurrentTarget = pTarget;
+    pTarget->pCurrentRequest = pRequest;
+    
+    //
+    // Configure controller and kick-off transfer.
+    // Request will be completed asynchronously.
+    //
+
+    bWriteRead = PbcRequestPrepareWriteRead(pDevice, pRequest);
+
+    if (bWriteRead)
+    {
+        ControllerStartWriteRead(pDevice, pRequest);
+    }
+    else
+    {
+        PbcRequestDoTransfer(pDevice, pRequest);
+    }
+    
+    WdfSpinLockRelease(pDevice->Lock);
+
+exit:
+
+    if (!NT_SUCCESS(status))
+    {
+        Trace(
+            TRACE_LEVEL_ERROR,
+            TRACE_FLAG_SPBDDI,
+            "Error configuring sequence, completing "
+            "SPBREQUEST %p synchronously - %!STATUS!", 
+            pRequest->SpbRequest,
+            status);
+
+        SpbRequestComplete(SpbRequest, status);
+    }
+    
+    FuncExit(TRACE_FLAG_TRANSFER);
+}
+
+BOOLEAN
+PbcRequestPrepareWriteRead(
+    _In_     PPBC_DEVICE             pDevice,
+    _In_     PPBC_REQUEST            pRequest
+    )
+/*++
+ 
+  Routine Description:
+
+    This routine checks whether a sequence is a plain write
+    followed by a read and, if so, maps both buffers so the
+    ISR can run the whole transaction. Sequences with delays,
+    chained MDLs or any other shape use the generic path.
+
+  Arguments:
+
+    pDevice - a pointer to the PBC device context
+    pRequest - a pointer to the PBC request context, already
+        configured for index 0
+
+  Return Value:
+
+    TRUE if the write-read path can be used.
+
+--*/
+{
+    FuncEntry(TRACE_FLAG_TRANSFER);
+
+    PPBC_WRITE_READ pWriteRead = &pDevice->WriteRead;
+    SPB_TRANSFER_DESCRIPTOR descriptor;
+    PMDL pMdl;
+    BOOLEAN bWriteRead = FALSE;
+
+    if ((pRequest->TransferCount != 2) ||
+        (pRequest->Direction != SpbTransferDirectionToDevice) ||
+        (pRequest->DelayInUs != 0) ||
+        (pRequest->Length == 0) ||
+        (pRequest->pMdlChain->Next != NULL))
+    {
+        goto exit;
+    }
+
+    SPB_TRANSFER_DESCRIPTOR_INIT(&descriptor);
+
+    SpbRequestGetTransferParameters(
+        pRequest->SpbRequest, 
+        1, 
+        &descriptor, 
+        &pMdl);
+
+    if ((pMdl == NULL) ||
+        (pMdl->Next != NULL) ||
+        (descriptor.Direction != SpbTransferDirectionFromDevice) ||
+        (descriptor.DelayInUs != 0) ||
+        (descriptor.TransferLength == 0) ||
+        (descriptor.TransferLength > SI2C_MAX_TRANSFER_LENGTH))
+    {
+        goto exit;
+    }
+
+    pWriteRead->pWriteBuffer = (PUCHAR) MmGetSystemAddressForMdlSafe(
+        pRequest->pMdlChain, 
+        NormalPagePriority | MdlMappingNoExecute);
+    pWriteRead->pReadBuffer = (PUCHAR) MmGetSystemAddressForMdlSafe(
+        pMdl, 
+        NormalPagePriority | MdlMappingNoExecute);
+
+    if ((pWriteRead->pWriteBuffer == NULL) || (pWriteRead->pReadBuffer == NULL))
+    {
+        goto exit;
+    }
+
+    pWriteRead->WriteLength = pRequest->Length;
+    pWriteRead->ReadLength = descriptor.TransferLength;
+    bWriteRead = TRUE;
+
+exit:
+
+    FuncExit(TRACE_FLAG_TRANSFER);
+
+    return bWriteRead;
+}
+
+NTSTATUS
+PbcRequestConfigureForIndex(
+    _Inout_  PPBC_REQUEST            pRequest,
+    _In_     ULONG                   Index
+    )
+/*++
  
   Routine Description:
 
@@ -2188,6 +2521,127 @@ exit:
     FuncExit(TRACE_FLAG_TRANSFER);
 }
 
+VOID
+OnRecoveryTimerExpired(
+    _In_  WDFTIMER  Timer
+    )
+/*++
+ 
+  Routine Description:
+
+    This routine runs the bus recovery sequence. When
+    the sequence is finished it restarts the pending
+    transfer, or fails the request if the bus could not
+    be recovered.
+
+  Arguments:
+
+    Timer - a handle to a framework timer object
+
+  Return Value:
+
+    None.
+
+--*/
+{
+    FuncEntry(TRACE_FLAG_TRANSFER);
+
+    WDFDEVICE fxDevice;
+    PPBC_DEVICE pDevice;
+    PPBC_TARGET pTarget = NULL;
+    PPBC_REQUEST pRequest = NULL;
+    int ret;
+    
+    fxDevice = (WDFDEVICE) WdfTimerGetParentObject(Timer);
+    pDevice = GetDeviceContext(fxDevice);
+
+    NT_ASSERT(pDevice != NULL);
+
+    //
+    // Acquire the device lock.
+    //
+
+    WdfSpinLockAcquire(pDevice->Lock);
+
+    //
+    // The sequence may have been stopped by a
+    // cancellation while this callback was pending.
+    //
+
+    if (!pDevice->Recovery.bActive)
+    {
+        goto exit;
+    }
+
+    ret = ControllerRunBusRecovery(pDevice);
+
+    //
+    // Make sure the target and request are
+    // still valid.
+    //
+
+    pTarget = pDevice->pCurrentTarget;
+    
+    if (pTarget == NULL)
+    {
+        Trace(
+            TRACE_LEVEL_WARNING,
+            TRACE_FLAG_TRANSFER,
+            "Bus recovery finished without a valid current target for WDFDEVICE %p, "
+            "this should only occur if the request was already completed",
+            pDevice->FxDevice);
+
+        goto exit;
+    }
+    
+    pRequest = pTarget->pCurrentRequest;
+
+    if (pRequest == NULL)
+    {
+        Trace(
+            TRACE_LEVEL_WARNING,
+            TRACE_FLAG_TRANSFER,
+            "Bus recovery finished without a valid current request for SPBTARGET %p, "
+            "this should only occur if the request was already cancelled",
+            pTarget->SpbTarget);
+
+        goto exit;
+    }
+
+    if (ret == AW_I2C_OK)
+    {
+        //
+        // Restart the transfer that found the bus busy.
+        //
+
+        if (pDevice->Recovery.bWriteRead)
+        {
+            ControllerStartWriteRead(pDevice, pRequest);
+        }
+        else
+        {
+            ControllerConfigureForTransfer(pDevice, pRequest);
+        }
+    }
+    else
+    {
+        pRequest->Status = STATUS_IO_DEVICE_ERROR;
+
+        ControllerCompleteTransfer(pDevice, pRequest);
+        PbcRequestComplete(pRequest);
+    }
+
+exit:
+
+    //
+    // Release the device lock.
+    //
+
+    WdfSpinLockRelease(pDevice->Lock);
+
+    FuncExit(TRACE_FLAG_TRANSFER);
+}
+
 VOID
 PbcRequestComplete(
     _In_     PPBC_REQUEST            pRequest
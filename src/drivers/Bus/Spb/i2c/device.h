@@ -80,6 +80,18 @@ PbcRequestConfigureForNonSequence(
     _In_  SPBREQUEST                 SpbRequest,
     _In_  size_t                     Length);
 
+VOID
+PbcRequestConfigureForSequence(
+    _In_  WDFDEVICE                  SpbController,
+    _In_  SPBTARGET                  SpbTarget,
+    _In_  SPBREQUEST                 SpbRequest,
+    _In_  ULONG                      TransferCount);
+
+BOOLEAN
+PbcRequestPrepareWriteRead(
+    _In_     PPBC_DEVICE             pDevice,
+    _In_     PPBC_REQUEST            pRequest);
+
 NTSTATUS
 PbcRequestConfigureForIndex(
     _Inout_  PPBC_REQUEST            pRequest,
@@ -95,6 +107,7 @@ PbcRequestComplete(
     _In_     PPBC_REQUEST            pRequest);
 
 EVT_WDF_TIMER                        OnDelayTimerExpired;
+EVT_WDF_TIMER                        OnRecoveryTimerExpired;
 
 ULONG
 FORCEINLINE
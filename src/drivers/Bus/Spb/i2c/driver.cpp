@@ -487,6 +487,38 @@ OnDeviceAdd(
         }
     }
 
+    //
+    // Create the high resolution timer that clocks
+    // the bus recovery sequence.
+    //
+    {    
+        WDF_TIMER_CONFIG      wdfTimerConfig;
+        WDF_OBJECT_ATTRIBUTES timerAttributes;
+
+        WDF_TIMER_CONFIG_INIT(&wdfTimerConfig, OnRecoveryTimerExpired);
+        wdfTimerConfig.UseHighResolutionTimer = WdfTrue;
+        WDF_OBJECT_ATTRIBUTES_INIT(&timerAttributes);
+        timerAttributes.ParentObject = pDevice->FxDevice;
+
+        status = WdfTimerCreate(
+            &wdfTimerConfig,
+            &timerAttributes,
+            &(pDevice->RecoveryTimer)
+            );
+
+        if (!NT_SUCCESS(status))
+        {
+            Trace(
+                TRACE_LEVEL_ERROR, 
+                TRACE_FLAG_WDFLOADING, 
+                "Failed to create recovery timer for WDFDEVICE %p - %!STATUS!", 
+                pDevice->FxDevice,
+                status);
+
+            goto exit;
+        }
+    }
+
     //
     // Create the spin lock to synchronize access
     // to the controller driver.
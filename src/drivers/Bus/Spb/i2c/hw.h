@@ -79,7 +79,7 @@ public:
 
     T SetBits  (_In_ T Flags) {return (*this |= Flags);}
     T ClearBits(_In_ T Flags) {return (*this &= ~Flags);}
-    bool TestBits (_In_ T Flags) {return ((Read() & Flags) != 0)};
+    bool TestBits (_In_ T Flags) {return ((Read() & Flags) != 0);}
 };
 
 #endif
@@ -49,6 +49,7 @@
 /////////////////////////////////////////////////
 
 #include "sunxii2c.h"
+#include "sunxii2cioctl.h"
 
 /////////////////////////////////////////////////
 //
@@ -83,6 +84,7 @@ typedef struct _PNP_I2C_SERIAL_BUS_DESCRIPTOR {
 #define AW_I2C_RETRY  -2
 #define AW_I2C_SFAIL  -3  /* start fail */
 #define AW_I2C_TFAIL  -4  /* stop  fail */
+#define AW_I2C_BUSY   -5  /* bus recovery in progress */
 
 /////////////////////////////////////////////////
 //
@@ -155,6 +157,105 @@ typedef struct PBC_TRANSFER_SETTINGS
 }
 PBC_TRANSFER_SETTINGS, *PPBC_TRANSFER_SETTINGS;
 
+//
+// Write-then-read fast path. Both halves of the
+// transaction are driven from the ISR, the DPC only
+// runs once to complete the request.
+//
+
+typedef enum WRITE_READ_PHASE
+{
+    WriteReadIdle,
+    WriteReadWrite,
+    WriteReadRead,
+    WriteReadDone
+}
+WRITE_READ_PHASE, *PWRITE_READ_PHASE;
+
+typedef struct PBC_WRITE_READ
+{
+    // Current phase, only changed with the
+    // interrupt lock held once the transfer starts.
+    WRITE_READ_PHASE               Phase;
+
+    // System addresses of the locked client buffers.
+    PUCHAR                         pWriteBuffer;
+    size_t                         WriteLength;
+    PUCHAR                         pReadBuffer;
+    size_t                         ReadLength;
+
+    // Bytes transferred in the current phase.
+    size_t                         Index;
+
+    // Result and timestamps of the transaction.
+    NTSTATUS                       Status;
+    LARGE_INTEGER                  StartTime;
+    LARGE_INTEGER                  EndTime;
+}
+PBC_WRITE_READ, *PPBC_WRITE_READ;
+
+//
+// Bus recovery. SCL is clocked from the recovery timer until
+// the slave releases SDA, the pending transfer then restarts.
+//
+
+typedef struct PBC_BUS_RECOVERY
+{
+    BOOLEAN                        bActive;
+    ULONG                          Cycle;
+
+    // Set once SDA is released, lets the restarted
+    // transfer proceed even if the status is not idle.
+    BOOLEAN                        bRecovered;
+
+    // The pending transfer is a write-read transaction.
+    BOOLEAN                        bWriteRead;
+}
+PBC_BUS_RECOVERY, *PPBC_BUS_RECOVERY;
+
+//
+// Per-target transaction statistics.
+//
+
+typedef struct PBC_TARGET_STATISTICS
+{
+    ULONG                          WriteReadCount;
+    ULONG                          WriteReadErrors;
+    ULONG                          LastLatencyUs;
+    ULONG                          MinLatencyUs;
+    ULONG                          MaxLatencyUs;
+    ULONGLONG                      TotalLatencyUs;
+}
+PBC_TARGET_STATISTICS, *PPBC_TARGET_STATISTICS;
+
+//
+// Transaction trace. Records are written from the ISR and
+// the DPC into a ring without a lock, the sequence number
+// claims a slot and is stored last so a reader can tell a
+// complete record. Histograms are only touched with the
+// device lock held.
+//
+
+#define PBC_TRACE_RECORDS              256
+#define PBC_TRACE_NO_HISTOGRAM         ((ULONG)-1)
+
+typedef struct PBC_TRACE
+{
+    volatile LONG                  Sequence;
+    SUNXII2C_TRACE_RECORD          Records[PBC_TRACE_RECORDS];
+
+    // Transfer the next records belong to, updated
+    // before each transfer is started.
+    USHORT                         Address;
+    UCHAR                          Position;
+    UCHAR                          TransferIndex;
+    USHORT                         InterruptCount;
+
+    ULONG                          HistogramCount;
+    SUNXII2C_TARGET_HISTOGRAM      Histograms[SUNXII2C_HISTOGRAM_MAX_TARGETS];
+}
+PBC_TRACE, *PPBC_TRACE;
+
 /////////////////////////////////////////////////
 //
 // Context definitions.
@@ -202,6 +303,9 @@ struct PBC_DEVICE
     // Delay timer used to stall between transfers.
     WDFTIMER                       DelayTimer;
 
+    // Timer clocking the bus recovery sequence.
+    WDFTIMER                       RecoveryTimer;
+
     // The power setting callback handle
     PVOID                          pMonitorPowerSettingHandle;
 
@@ -214,6 +318,27 @@ struct PBC_DEVICE
 	//status
 	int								Status;
 
+	//software copies of the control, clock and enhance feature
+	//registers, used to skip writes that would not change them
+	ULONG							CtlShadow;
+	ULONG							ClkShadow;
+	ULONG							EfrShadow;
+
+	//set after an error, the next transfer soft resets the controller
+	BOOLEAN							bResetPending;
+
+	//write-then-read transaction run from the ISR
+	PBC_WRITE_READ					WriteRead;
+
+	//state of the bus recovery sequence
+	PBC_BUS_RECOVERY				Recovery;
+
+	//transaction trace and latency histograms
+	PBC_TRACE						Trace;
+
+	//performance counter frequency for latency statistics
+	LARGE_INTEGER					PerfFrequency;
+
 };
 
 //
@@ -230,6 +355,20 @@ struct PBC_TARGET
 
     // Target specific settings.
     PBC_TARGET_SETTINGS            Settings;
+
+    // Clock register value for the target's connection
+    // speed, computed once when the target is connected.
+    ULONG                          ClockRegister;
+
+    // SCL frequency achieved by ClockRegister.
+    ULONG                          ClockFrequency;
+
+    // Transaction latency counters.
+    PBC_TARGET_STATISTICS          Statistics;
+
+    // Index of the target's latency histogram, or
+    // PBC_TRACE_NO_HISTOGRAM if all slots are taken.
+    ULONG                          HistogramIndex;
     
     // Current request associated with the 
     // target. This value should only be non-null
@@ -271,6 +410,9 @@ struct PBC_REQUEST
     NTSTATUS                       Status;
     BOOLEAN                        bIoComplete;
 
+    // Time the first transfer was started.
+    LARGE_INTEGER                  StartTime;
+
 
     //
     // Variables that are reused for each transfer within
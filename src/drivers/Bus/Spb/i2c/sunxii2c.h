@@ -94,6 +94,9 @@ SUNXII2C_REGISTERS, *PSUNXII2C_REGISTERS;
 #define TWI_CTL_INTEN	(0x1<<7) /* INT_EN */
 /* 31:8 bit reserved */
 
+/* bits that keep their value until software changes them, cached in the control shadow */
+#define TWI_CTL_SHADOW_MASK	(TWI_CTL_ACK | TWI_CTL_BUSEN | TWI_CTL_INTEN)
+
 //
 //TWI Clock Register Bit Fields & Masks,default value:0x0000_0000
 //
@@ -108,6 +111,10 @@ Foscl is clock SCL;standard mode:100KHz or fast mode:400KHz
 #define TWI_CLK_DIV_M		(0xF<<3) /* 6:3bit  */
 #define TWI_CLK_DIV_N		(0x7<<0) /* 2:0bit */
 
+#define TWI_SOURCE_CLOCK	(24000000)	/* APB clock feeding the TWI block */
+#define TWI_DEFAULT_SPEED	(200000)	/* used when neither ACPI nor target gives a speed */
+#define TWI_MAX_SPEED		(1000000)	/* fast-mode plus */
+
 
 //
 //TWI Soft Reset Register Bit Fields & Masks
@@ -136,6 +143,14 @@ Foscl is clock SCL;standard mode:100KHz or fast mode:400KHz
 /* 31:6bits reserved */
 #define TWI_LCR_IDLE_STATUS     (0x3a)
 
+//
+//bus recovery, deferred to the recovery timer, which then toggles
+//SCL through the LCR register at 100 kHz
+//
+#define TWI_RECOVERY_DELAY_MS           (1)
+#define TWI_RECOVERY_HALF_PERIOD_US     (5)
+#define TWI_RECOVERY_MAX_CLOCKS         (9)
+
 //
 //TWI Status Register Bit Fields & Masks
 //
@@ -0,0 +1,141 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+#ifndef _SUNXII2CIOCTL_H_
+#define _SUNXII2CIOCTL_H_
+
+//
+// Private IOCTLs exposing the controller's transaction trace
+// and per-target latency histograms. Both are METHOD_BUFFERED
+// and take no input, they are sent to the controller device
+// rather than through an SPB target.
+//
+// IOCTL_SUNXII2C_QUERY_TRACE returns a SUNXII2C_TRACE header
+// followed by as many of the most recent records as fit in
+// the output buffer, oldest first.
+//
+// IOCTL_SUNXII2C_QUERY_HISTOGRAM returns SUNXII2C_HISTOGRAM.
+//
+
+#define IOCTL_SUNXII2C_QUERY_TRACE \
+    CTL_CODE(FILE_DEVICE_CONTROLLER, 0x900, METHOD_BUFFERED, FILE_READ_ACCESS)
+
+#define IOCTL_SUNXII2C_QUERY_HISTOGRAM \
+    CTL_CODE(FILE_DEVICE_CONTROLLER, 0x901, METHOD_BUFFERED, FILE_READ_ACCESS)
+
+#define SUNXII2C_TRACE_VERSION           1
+
+//
+// Trace events.
+//
+//   Start     - a transfer was programmed. Count is the
+//               transfer length in bytes.
+//   Interrupt - a controller interrupt. TwiStatus is the
+//               TWI status code (0x08 start, 0x18/0x40 address
+//               ACK, 0x28/0x50 data ACK, ...), Count the number
+//               of interrupts since the transfer started.
+//   Complete  - the request completed. Count is the total
+//               bytes transferred, Status the request status.
+//   Recovery  - a bus recovery sequence finished, Status
+//               tells whether SDA was released.
+//
+
+typedef enum SUNXII2C_TRACE_EVENT
+{
+    Sunxii2cTraceStart = 1,
+    Sunxii2cTraceInterrupt,
+    Sunxii2cTraceComplete,
+    Sunxii2cTraceRecovery
+}
+SUNXII2C_TRACE_EVENT, *PSUNXII2C_TRACE_EVENT;
+
+//
+// One trace record, 24 bytes. Timestamp is in performance
+// counter ticks, see SUNXII2C_TRACE.Frequency. Sequence
+// increases by one per record. Records being rewritten while
+// the trace is copied out are left out, a gap means records
+// were overwritten or dropped.
+// Position is the SPB_REQUEST_SEQUENCE_POSITION of the
+// transfer, TransferIndex its index within the sequence.
+//
+
+typedef struct SUNXII2C_TRACE_RECORD
+{
+    ULONGLONG                      Timestamp;
+    ULONG                          Sequence;
+    NTSTATUS                       Status;
+    USHORT                         Address;
+    USHORT                         Count;
+    UCHAR                          Event;
+    UCHAR                          TwiStatus;
+    UCHAR                          Position;
+    UCHAR                          TransferIndex;
+}
+SUNXII2C_TRACE_RECORD, *PSUNXII2C_TRACE_RECORD;
+
+typedef struct SUNXII2C_TRACE
+{
+    ULONG                          Version;
+    ULONG                          RecordSize;
+
+    // Records following this header.
+    ULONG                          RecordCount;
+
+    // Sequence number the next record will be given.
+    ULONG                          NextSequence;
+
+    ULONG                          BusNumber;
+    ULONG                          Reserved;
+    ULONGLONG                      Frequency;
+
+    SUNXII2C_TRACE_RECORD          Records[1];
+}
+SUNXII2C_TRACE, *PSUNXII2C_TRACE;
+
+//
+// Latency histogram of one target. Latency is measured from
+// the first transfer being programmed to request completion.
+// Bucket 0 counts transactions under 32 us, every following
+// bucket doubles the bound, the last one is open ended.
+//
+
+#define SUNXII2C_HISTOGRAM_BUCKETS       16
+#define SUNXII2C_HISTOGRAM_BASE_SHIFT    5
+#define SUNXII2C_HISTOGRAM_MAX_TARGETS   8
+
+typedef struct SUNXII2C_TARGET_HISTOGRAM
+{
+    USHORT                         Address;
+    USHORT                         Reserved;
+    ULONG                          Transactions;
+    ULONG                          Errors;
+    ULONG                          MaxLatencyUs;
+    ULONGLONG                      TotalLatencyUs;
+    ULONG                          Buckets[SUNXII2C_HISTOGRAM_BUCKETS];
+}
+SUNXII2C_TARGET_HISTOGRAM, *PSUNXII2C_TARGET_HISTOGRAM;
+
+typedef struct SUNXII2C_HISTOGRAM
+{
+    ULONG                          Version;
+    ULONG                          TargetCount;
+    SUNXII2C_TARGET_HISTOGRAM      Targets[SUNXII2C_HISTOGRAM_MAX_TARGETS];
+}
+SUNXII2C_HISTOGRAM, *PSUNXII2C_HISTOGRAM;
+
+#endif // _SUNXII2CIOCTL_H_
@@ -0,0 +1,204 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	twiclocktest.cpp
+
+Abstract:
+
+	Checks the SCL divider controller.cpp picks for every standard bus
+	speed, plus the default (0) and a request above fast-mode plus,
+	which are clamped. For each speed the program prints CLK_M, CLK_N,
+	the achieved frequency and the error against the request, and
+	fails unless:
+
+		the achieved frequency never exceeds the request
+		no other of the 128 CLK_M/CLK_N settings is closer
+		the frequency reported matches the programmed fields
+		the known divider of each standard speed is chosen
+		the divider cached per target is the one computed
+
+	The error is printed the way OnTargetConnect traces it, in signed
+	hundredths of a percent.
+
+	Build and use on any host with a C++ compiler:
+
+		c++ -O2 -I../../../../../tools/host -I.. -o twiclocktest twiclocktest.cpp twimodel.cpp ../controller.cpp -lpthread
+		twiclocktest
+
+Environment:
+
+	user mode
+
+--*/
+
+#include <stdio.h>
+
+#include "twimodel.h"
+
+typedef struct _CLOCK_CASE
+{
+    // Connection speed as given by ACPI or the target.
+    ULONG Requested;
+
+    // Speed the divider is solved for after clamping,
+    // and the frequency that must result.
+    ULONG Effective;
+    ULONG Expected;
+}CLOCK_CASE;
+
+static const CLOCK_CASE g_Cases[] =
+{
+    {   10000,   10000,   10000},   // low speed
+    {   50000,   50000,   50000},
+    {  100000,  100000,  100000},   // standard mode
+    {  200000,  200000,  200000},
+    {  400000,  400000,  400000},   // fast mode
+    { 1000000, 1000000,  800000},   // fast mode plus, 24 MHz / 30
+    {       0,  200000,  200000},   // TWI_DEFAULT_SPEED
+    { 3400000, 1000000,  800000},   // high speed, clamped
+    {  333000,  333000,  300000},   // off-grid
+};
+
+static int g_Failures;
+
+static VOID
+Check(
+    _In_  BOOLEAN bCondition,
+    _In_  ULONG Requested,
+    _In_  const char *pWhat
+    )
+{
+    if (!bCondition)
+    {
+        printf("FAIL %lu Hz: %s\n", (unsigned long)Requested, pWhat);
+        g_Failures++;
+    }
+}
+
+static ULONG
+ClockDivider(
+    _In_  ULONG ClockRegister
+    )
+{
+    ULONG clkM = (ClockRegister & TWI_CLK_DIV_M) >> 3;
+    ULONG clkN = ClockRegister & TWI_CLK_DIV_N;
+
+    return 10 * (clkM + 1) * (1 << clkN);
+}
+
+static ULONG
+BestFrequency(
+    _In_  ULONG Requested
+    )
+{
+    ULONG best = 0;
+    ULONG divider;
+    ULONG clkM;
+    ULONG clkN;
+
+    for (clkN = 0; clkN < 8; clkN++)
+    {
+        for (clkM = 0; clkM < 16; clkM++)
+        {
+            divider = 10 * (clkM + 1) * (1 << clkN);
+
+            if (((ULONGLONG)TWI_SOURCE_CLOCK <= (ULONGLONG)Requested * divider) &&
+                (TWI_SOURCE_CLOCK / divider > best))
+            {
+                best = TWI_SOURCE_CLOCK / divider;
+            }
+        }
+    }
+
+    return best;
+}
+
+int
+main(
+    VOID
+    )
+{
+    PBC_DEVICE device;
+    PBC_TARGET target;
+    const CLOCK_CASE *pCase;
+    ULONG clockRegister;
+    ULONG actual;
+    LONGLONG error;
+    LONGLONG magnitude;
+    ULONG i;
+
+    printf("requested   clk_m clk_n   divider   actual      error\n");
+
+    for (i = 0; i < sizeof(g_Cases) / sizeof(g_Cases[0]); i++)
+    {
+        pCase = &g_Cases[i];
+
+        actual = 0;
+        clockRegister = ControllerCalculateClock(pCase->Requested, &actual);
+
+        error = (((LONGLONG)pCase->Effective - (LONGLONG)actual) * 10000) /
+            (LONGLONG)pCase->Effective;
+        magnitude = (error < 0) ? -error : error;
+
+        printf("%9lu   %5lu %5lu   %7lu  %7lu   %s%lld.%02lld%%\n",
+            (unsigned long)pCase->Requested,
+            (unsigned long)((clockRegister & TWI_CLK_DIV_M) >> 3),
+            (unsigned long)(clockRegister & TWI_CLK_DIV_N),
+            (unsigned long)ClockDivider(clockRegister),
+            (unsigned long)actual,
+            (error < 0) ? "-" : "",
+            (long long)(magnitude / 100),
+            (long long)(magnitude % 100));
+
+        Check((clockRegister & ~(TWI_CLK_DIV_M | TWI_CLK_DIV_N)) == 0,
+            pCase->Requested, "only the divider fields are set");
+        Check(actual <= pCase->Effective,
+            pCase->Requested, "achieved frequency above the request");
+        Check(actual == TWI_SOURCE_CLOCK / ClockDivider(clockRegister),
+            pCase->Requested, "reported frequency does not match the fields");
+        Check(actual == BestFrequency(pCase->Effective),
+            pCase->Requested, "a closer divider exists");
+        Check(actual == pCase->Expected,
+            pCase->Requested, "unexpected frequency");
+
+        //
+        // The connect path caches the same divider
+        // in the target.
+        //
+
+        TwiModelReset(&device, &target, 0x14, pCase->Requested);
+
+        Check(target.ClockRegister == clockRegister,
+            pCase->Requested, "cached divider differs");
+        Check(target.ClockFrequency == actual,
+            pCase->Requested, "cached frequency differs");
+    }
+
+    if (g_Failures != 0)
+    {
+        printf("%d check(s) failed\n", g_Failures);
+        return 1;
+    }
+
+    printf("all checks passed\n");
+    return 0;
+}
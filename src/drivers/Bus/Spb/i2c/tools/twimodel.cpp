@@ -0,0 +1,964 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	twimodel.cpp
+
+Abstract:
+
+	Host model of the TWI controller, see twimodel.h. TwiModelIsr,
+	TwiModelDpc and the recovery timer in TwiModelRun follow
+	OnInterruptIsr, OnInterruptDpc and OnRecoveryTimerExpired in
+	device.cpp, which cannot be built outside the kernel.
+
+Environment:
+
+	user mode
+
+--*/
+
+#include <pthread.h>
+#include <time.h>
+
+#include "twimodel.h"
+
+TWI_MODEL g_TwiModel;
+
+static pthread_mutex_t g_TwiModelLock = PTHREAD_MUTEX_INITIALIZER;
+
+//
+// Line control bits software can set.
+//
+
+#define TWI_MODEL_LCR_CTL_MASK  (TWI_LCR_SDA_EN | TWI_LCR_SDA_CTL | TWI_LCR_SCL_EN | TWI_LCR_SCL_CTL)
+
+static BOOLEAN
+TwiModelSclHigh(
+    VOID
+    )
+{
+    if (g_TwiModel.Lcr & TWI_LCR_SCL_EN)
+    {
+        return ((g_TwiModel.Lcr & TWI_LCR_SCL_CTL) != 0);
+    }
+
+    return TRUE;
+}
+
+static BOOLEAN
+TwiModelSdaHigh(
+    VOID
+    )
+{
+    if (g_TwiModel.Slave.SdaStuckClocks != 0)
+    {
+        return FALSE;
+    }
+
+    if (g_TwiModel.Lcr & TWI_LCR_SDA_EN)
+    {
+        return ((g_TwiModel.Lcr & TWI_LCR_SDA_CTL) != 0);
+    }
+
+    return TRUE;
+}
+
+static ULONG
+TwiModelStatus(
+    VOID
+    )
+{
+    //
+    // A slave holding SDA low makes the master lose
+    // arbitration as soon as it looks at the bus.
+    //
+
+    if ((g_TwiModel.Phase == TwiModelIdle) && (g_TwiModel.Slave.SdaStuckClocks != 0))
+    {
+        return TWI_STAT_ARBLOST;
+    }
+
+    return g_TwiModel.Stat;
+}
+
+static VOID
+TwiModelSlaveWrite(
+    _In_  UCHAR  Byte
+    )
+{
+    PTWI_MODEL_SLAVE pSlave = &g_TwiModel.Slave;
+
+    if ((pSlave->NakAfter != 0) && (pSlave->Written >= pSlave->NakAfter))
+    {
+        g_TwiModel.Stat = TWI_STAT_TXD_NAK;
+        g_TwiModel.Phase = TwiModelNak;
+        return;
+    }
+
+    pSlave->Written++;
+
+    if (!pSlave->bPointerSet)
+    {
+        pSlave->Pointer = Byte;
+        pSlave->bPointerSet = TRUE;
+    }
+    else
+    {
+        pSlave->Registers[pSlave->Pointer++] = Byte;
+    }
+
+    g_TwiModel.Stat = TWI_STAT_TXD_ACK;
+}
+
+static VOID
+TwiModelAdvance(
+    VOID
+    )
+/*++
+
+  Routine Description:
+
+    Performs the bus action the controller has been asked
+    for once INT_FLAG is clear. Every action but STOP ends
+    with INT_FLAG set and a new status code.
+
+--*/
+{
+    if (g_TwiModel.bFlag || !(g_TwiModel.Ctl & TWI_CTL_BUSEN))
+    {
+        return;
+    }
+
+    if (g_TwiModel.bStopPending)
+    {
+        g_TwiModel.bStopPending = FALSE;
+        g_TwiModel.bStartPending = FALSE;
+        g_TwiModel.bDataPending = FALSE;
+        g_TwiModel.Phase = TwiModelIdle;
+        g_TwiModel.Stat = TWI_STAT_IDLE;
+        g_TwiModel.Stops++;
+        return;
+    }
+
+    if (g_TwiModel.bStartPending)
+    {
+        if (!TwiModelSdaHigh())
+        {
+            return;
+        }
+
+        g_TwiModel.bStartPending = FALSE;
+        g_TwiModel.bDataPending = FALSE;
+        g_TwiModel.Stat = (g_TwiModel.Phase == TwiModelIdle) ?
+            TWI_STAT_TX_STA : TWI_STAT_TX_RESTA;
+        g_TwiModel.Phase = TwiModelAddress;
+        g_TwiModel.Slave.bPointerSet = FALSE;
+        g_TwiModel.Slave.Written = 0;
+        g_TwiModel.Starts++;
+        g_TwiModel.bFlag = TRUE;
+        return;
+    }
+
+    switch (g_TwiModel.Phase)
+    {
+    case TwiModelAddress:
+        if (!g_TwiModel.bDataPending)
+        {
+            return;
+        }
+        g_TwiModel.bDataPending = FALSE;
+        if ((g_TwiModel.Slave.Address != 0) &&
+            ((g_TwiModel.Data >> 1) == g_TwiModel.Slave.Address))
+        {
+            if (g_TwiModel.Data & 1)
+            {
+                g_TwiModel.Phase = TwiModelRead;
+                g_TwiModel.Stat = TWI_STAT_TX_AR_ACK;
+            }
+            else
+            {
+                g_TwiModel.Phase = TwiModelWrite;
+                g_TwiModel.Stat = TWI_STAT_TX_AW_ACK;
+            }
+        }
+        else
+        {
+            g_TwiModel.Phase = TwiModelNak;
+            g_TwiModel.Stat = (g_TwiModel.Data & 1) ?
+                TWI_STAT_TX_AR_NAK : TWI_STAT_TX_AW_NAK;
+        }
+        break;
+
+    case TwiModelWrite:
+        if (!g_TwiModel.bDataPending)
+        {
+            return;
+        }
+        g_TwiModel.bDataPending = FALSE;
+        TwiModelSlaveWrite((UCHAR)g_TwiModel.Data);
+        break;
+
+    case TwiModelRead:
+        //
+        // Nothing follows a byte that was not acknowledged.
+        //
+        if (g_TwiModel.Stat == TWI_STAT_RXD_NAK)
+        {
+            return;
+        }
+        g_TwiModel.Data = g_TwiModel.Slave.Registers[g_TwiModel.Slave.Pointer++];
+        g_TwiModel.Stat = (g_TwiModel.Ctl & TWI_CTL_ACK) ?
+            TWI_STAT_RXD_ACK : TWI_STAT_RXD_NAK;
+        break;
+
+    default:
+        return;
+    }
+
+    g_TwiModel.bFlag = TRUE;
+}
+
+static VOID
+TwiModelSoftReset(
+    VOID
+    )
+{
+    g_TwiModel.Phase = TwiModelIdle;
+    g_TwiModel.Stat = TWI_STAT_IDLE;
+    g_TwiModel.bFlag = FALSE;
+    g_TwiModel.bStartPending = FALSE;
+    g_TwiModel.bStopPending = FALSE;
+    g_TwiModel.bDataPending = FALSE;
+    g_TwiModel.Resets++;
+}
+
+static ULONG
+TwiModelRegisterIndex(
+    _In_  const VOID  *pRegister
+    )
+{
+    size_t offset = (const UCHAR *)pRegister - (const UCHAR *)&g_TwiModel.Registers;
+
+    NT_ASSERT(offset < sizeof(SUNXII2C_REGISTERS));
+
+    return (ULONG)(offset / sizeof(ULONG));
+}
+
+template<>
+ULONG
+HWREG<ULONG>::Read(
+    VOID
+    )
+{
+    ULONG index = TwiModelRegisterIndex(this);
+    ULONG value = 0;
+
+    g_TwiModel.Reads[index]++;
+
+    switch (index)
+    {
+    case TWI_MODEL_ADDR:
+        value = g_TwiModel.Addr;
+        break;
+    case TWI_MODEL_XADDR:
+        value = g_TwiModel.Xaddr;
+        break;
+    case TWI_MODEL_DATA:
+        value = g_TwiModel.Data;
+        break;
+    case TWI_MODEL_CTL:
+        value = g_TwiModel.Ctl;
+        if (g_TwiModel.bFlag)
+        {
+            value |= TWI_CTL_INTFLG;
+        }
+        if (g_TwiModel.bStartPending)
+        {
+            value |= TWI_CTL_STA;
+        }
+        if (g_TwiModel.bStopPending)
+        {
+            value |= TWI_CTL_STP;
+        }
+        break;
+    case TWI_MODEL_STAT:
+        value = TwiModelStatus();
+        break;
+    case TWI_MODEL_CLK:
+        value = g_TwiModel.Clk;
+        break;
+    case TWI_MODEL_SRST:
+        value = 0;
+        break;
+    case TWI_MODEL_EFR:
+        value = g_TwiModel.Efr;
+        break;
+    case TWI_MODEL_LCR:
+        value = g_TwiModel.Lcr;
+        if (TwiModelSdaHigh())
+        {
+            value |= TWI_LCR_SDA_STATE_MASK;
+        }
+        if (TwiModelSclHigh())
+        {
+            value |= TWI_LCR_SCL_STATE_MASK;
+        }
+        break;
+    case TWI_MODEL_DVFS:
+        value = g_TwiModel.Dvfs;
+        break;
+    }
+
+    return value;
+}
+
+template<>
+ULONG
+HWREG<ULONG>::Write(
+    _In_ ULONG Value
+    )
+{
+    ULONG index = TwiModelRegisterIndex(this);
+    BOOLEAN bSclWasHigh;
+
+    g_TwiModel.Writes[index]++;
+
+    switch (index)
+    {
+    case TWI_MODEL_ADDR:
+        g_TwiModel.Addr = Value & 0xff;
+        break;
+    case TWI_MODEL_XADDR:
+        g_TwiModel.Xaddr = Value & TWI_XADDR_MASK;
+        break;
+    case TWI_MODEL_DATA:
+        g_TwiModel.Data = Value & TWI_DATA_MASK;
+        g_TwiModel.bDataPending = TRUE;
+        break;
+    case TWI_MODEL_CTL:
+        g_TwiModel.Ctl = Value & TWI_CTL_SHADOW_MASK;
+        if (Value & TWI_CTL_STA)
+        {
+            g_TwiModel.bStartPending = TRUE;
+        }
+        if (Value & TWI_CTL_STP)
+        {
+            g_TwiModel.bStopPending = TRUE;
+        }
+        if (Value & TWI_CTL_INTFLG)
+        {
+            g_TwiModel.bFlag = FALSE;
+        }
+        TwiModelAdvance();
+        break;
+    case TWI_MODEL_STAT:
+        break;
+    case TWI_MODEL_CLK:
+        g_TwiModel.Clk = Value & (TWI_CLK_DIV_M | TWI_CLK_DIV_N);
+        break;
+    case TWI_MODEL_SRST:
+        if (Value & TWI_SRST_SRST)
+        {
+            TwiModelSoftReset();
+        }
+        break;
+    case TWI_MODEL_EFR:
+        g_TwiModel.Efr = Value & TWI_EFR_MASK;
+        break;
+    case TWI_MODEL_LCR:
+        bSclWasHigh = TwiModelSclHigh();
+        g_TwiModel.Lcr = Value & TWI_MODEL_LCR_CTL_MASK;
+
+        //
+        // A rising edge on SCL clocks one bit out of
+        // a slave that still holds SDA.
+        //
+
+        if (!bSclWasHigh && TwiModelSclHigh())
+        {
+            g_TwiModel.SclClocks++;
+            if (g_TwiModel.Slave.SdaStuckClocks != 0)
+            {
+                g_TwiModel.Slave.SdaStuckClocks--;
+            }
+        }
+        break;
+    case TWI_MODEL_DVFS:
+        g_TwiModel.Dvfs = Value & 0x7;
+        break;
+    }
+
+    return Value;
+}
+
+VOID
+TwiModelReset(
+    _Out_ PPBC_DEVICE               pDevice,
+    _Out_ PPBC_TARGET               pTarget,
+    _In_  USHORT                    SlaveAddress,
+    _In_  ULONG                     ConnectionSpeed
+    )
+/*++
+
+  Routine Description:
+
+    Puts the controller in its reset state with a slave at
+    SlaveAddress, then initializes the device and connects
+    the target like OnD0Entry and OnTargetConnect do.
+
+--*/
+{
+    RtlZeroMemory(&g_TwiModel, sizeof(g_TwiModel));
+    RtlZeroMemory(pDevice, sizeof(*pDevice));
+    RtlZeroMemory(pTarget, sizeof(*pTarget));
+
+    g_TwiModel.Stat = TWI_STAT_IDLE;
+    g_TwiModel.Lcr = TWI_LCR_SDA_CTL | TWI_LCR_SCL_CTL;
+    g_TwiModel.Slave.Address = SlaveAddress;
+    g_TwiModel.pTarget = pTarget;
+
+    pDevice->pRegisters = &g_TwiModel.Registers;
+    pDevice->RegistersCb = sizeof(SUNXII2C_REGISTERS);
+    pDevice->BusSpeed = TWI_DEFAULT_SPEED;
+
+    ControllerInitialize(pDevice);
+
+    pTarget->Settings.AddressMode = AddressMode7Bit;
+    pTarget->Settings.Address = SlaveAddress;
+    pTarget->Settings.ConnectionSpeed = ConnectionSpeed;
+    pTarget->ClockRegister = ControllerCalculateClock(
+        ConnectionSpeed,
+        &pTarget->ClockFrequency);
+
+    ControllerTraceAttachTarget(pDevice, pTarget);
+}
+
+VOID
+TwiModelClearCounters(
+    VOID
+    )
+{
+    RtlZeroMemory(g_TwiModel.Reads, sizeof(g_TwiModel.Reads));
+    RtlZeroMemory(g_TwiModel.Writes, sizeof(g_TwiModel.Writes));
+    g_TwiModel.Resets = 0;
+    g_TwiModel.Starts = 0;
+    g_TwiModel.Stops = 0;
+    g_TwiModel.SclClocks = 0;
+    g_TwiModel.Dpcs = 0;
+    g_TwiModel.TimerStarts = 0;
+    g_TwiModel.StallUs = 0;
+}
+
+ULONG
+TwiModelMmioReads(
+    VOID
+    )
+{
+    ULONG total = 0;
+    ULONG i;
+
+    for (i = 0; i < TWI_MODEL_REGISTERS; i++)
+    {
+        total += g_TwiModel.Reads[i];
+    }
+
+    return total;
+}
+
+ULONG
+TwiModelMmioWrites(
+    VOID
+    )
+{
+    ULONG total = 0;
+    ULONG i;
+
+    for (i = 0; i < TWI_MODEL_REGISTERS; i++)
+    {
+        total += g_TwiModel.Writes[i];
+    }
+
+    return total;
+}
+
+BOOLEAN
+TwiModelInterruptPending(
+    VOID
+    )
+{
+    return (g_TwiModel.bFlag && (g_TwiModel.Ctl & TWI_CTL_INTEN));
+}
+
+VOID
+TwiModelPrepareRequest(
+    _Out_ PPBC_REQUEST              pRequest,
+    _In_  SPB_REQUEST_TYPE          Type,
+    _In_  ULONG                     TransferCount
+    )
+/*++
+
+  Routine Description:
+
+    Sets up a request context for g_TwiModel.Transfers like
+    PbcRequestConfigureForNonSequence and ...ForSequence.
+
+--*/
+{
+    ULONG i;
+
+    NT_ASSERT((TransferCount > 0) && (TransferCount <= TWI_MODEL_MAX_TRANSFERS));
+
+    RtlZeroMemory(pRequest, sizeof(*pRequest));
+
+    for (i = 0; i < TransferCount; i++)
+    {
+        g_TwiModel.Mdls[i].Next = NULL;
+        g_TwiModel.Mdls[i].MappedSystemVa = g_TwiModel.Transfers[i].pBuffer;
+        g_TwiModel.Mdls[i].ByteCount = g_TwiModel.Transfers[i].Length;
+    }
+
+    g_TwiModel.TransferCount = TransferCount;
+    g_TwiModel.Completions = 0;
+    g_TwiModel.CompletionStatus = STATUS_SUCCESS;
+    g_TwiModel.CompletionInformation = 0;
+
+    pRequest->SpbRequest = (SPBREQUEST)&g_TwiModel;
+    pRequest->Type = Type;
+    pRequest->TransferCount = TransferCount;
+    pRequest->SequencePosition = SpbRequestSequencePositionSingle;
+}
+
+VOID
+TwiModelStartRequest(
+    _In_  PPBC_DEVICE               pDevice,
+    _In_  PPBC_REQUEST              pRequest,
+    _In_  BOOLEAN                   bAllowWriteRead
+    )
+/*++
+
+  Routine Description:
+
+    Starts a prepared request like OnSequence. A write
+    followed by a read takes the write-read fast path if
+    bAllowWriteRead is set.
+
+--*/
+{
+    PPBC_WRITE_READ pWriteRead = &pDevice->WriteRead;
+
+    pDevice->pCurrentTarget = g_TwiModel.pTarget;
+    g_TwiModel.pTarget->pCurrentRequest = pRequest;
+
+    PbcRequestConfigureForIndex(pRequest, 0);
+
+    if (bAllowWriteRead &&
+        (pRequest->TransferCount == 2) &&
+        (g_TwiModel.Transfers[0].Direction == SpbTransferDirectionToDevice) &&
+        (g_TwiModel.Transfers[1].Direction == SpbTransferDirectionFromDevice))
+    {
+        pWriteRead->pWriteBuffer = g_TwiModel.Transfers[0].pBuffer;
+        pWriteRead->WriteLength = g_TwiModel.Transfers[0].Length;
+        pWriteRead->pReadBuffer = g_TwiModel.Transfers[1].pBuffer;
+        pWriteRead->ReadLength = g_TwiModel.Transfers[1].Length;
+
+        ControllerStartWriteRead(pDevice, pRequest);
+    }
+    else
+    {
+        PbcRequestDoTransfer(pDevice, pRequest);
+    }
+}
+
+BOOLEAN
+TwiModelIsr(
+    _In_  PPBC_DEVICE               pDevice,
+    _Out_ PBOOLEAN                  pbQueueDpc
+    )
+{
+    BOOLEAN interruptRecognized = FALSE;
+    ULONG stat;
+
+    *pbQueueDpc = FALSE;
+
+    stat = ControllerGetInterruptStatus(
+        pDevice,
+        PbcDeviceGetInterruptMask(pDevice));
+
+    if ((pDevice->WriteRead.Phase == WriteReadWrite) ||
+        (pDevice->WriteRead.Phase == WriteReadRead))
+    {
+        if ((stat == TWI_STAT_IDLE) || (stat == 0))
+        {
+            return FALSE;
+        }
+
+        ControllerTraceEvent(
+            pDevice,
+            Sunxii2cTraceInterrupt,
+            stat,
+            ++pDevice->Trace.InterruptCount,
+            STATUS_SUCCESS);
+
+        if (ControllerProcessWriteRead(pDevice, stat))
+        {
+            ControllerDisableInterrupts(pDevice);
+            *pbQueueDpc = TRUE;
+        }
+
+        return TRUE;
+    }
+
+    if (stat > 0)
+    {
+        interruptRecognized = TRUE;
+
+        ControllerTraceEvent(
+            pDevice,
+            Sunxii2cTraceInterrupt,
+            stat,
+            ++pDevice->Trace.InterruptCount,
+            STATUS_SUCCESS);
+
+        pDevice->InterruptStatus |= (stat);
+        ControllerDisableInterrupts(pDevice);
+        *pbQueueDpc = TRUE;
+    }
+
+    return interruptRecognized;
+}
+
+VOID
+TwiModelDpc(
+    _In_  PPBC_DEVICE               pDevice
+    )
+{
+    PPBC_TARGET pTarget = pDevice->pCurrentTarget;
+    PPBC_REQUEST pRequest;
+    ULONG stat;
+
+    if ((pTarget == NULL) || (pTarget->pCurrentRequest == NULL))
+    {
+        return;
+    }
+
+    pRequest = pTarget->pCurrentRequest;
+
+    if (pDevice->WriteRead.Phase != WriteReadIdle)
+    {
+        pDevice->InterruptStatus = 0;
+        if (pDevice->WriteRead.Phase == WriteReadDone)
+        {
+            ControllerCompleteWriteRead(pDevice, pRequest);
+        }
+        return;
+    }
+
+    stat = pDevice->InterruptStatus;
+    pDevice->InterruptStatus = 0;
+
+    if (stat == 0)
+    {
+        return;
+    }
+
+    ControllerProcessInterrupts(pDevice, pRequest, stat);
+
+    if (stat != 0xf8)
+    {
+        ControllerEnableInterrupts(pDevice, PbcDeviceGetInterruptMask(pDevice));
+    }
+}
+
+static VOID
+TwiModelRecoveryTimer(
+    _In_  PPBC_DEVICE               pDevice
+    )
+{
+    PPBC_REQUEST pRequest;
+    int ret;
+
+    if (!pDevice->Recovery.bActive)
+    {
+        return;
+    }
+
+    ret = ControllerRunBusRecovery(pDevice);
+
+    if ((pDevice->pCurrentTarget == NULL) ||
+        (pDevice->pCurrentTarget->pCurrentRequest == NULL))
+    {
+        return;
+    }
+
+    pRequest = pDevice->pCurrentTarget->pCurrentRequest;
+
+    if (ret == AW_I2C_OK)
+    {
+        if (pDevice->Recovery.bWriteRead)
+        {
+            ControllerStartWriteRead(pDevice, pRequest);
+        }
+        else
+        {
+            ControllerConfigureForTransfer(pDevice, pRequest);
+        }
+    }
+    else
+    {
+        pRequest->Status = STATUS_IO_DEVICE_ERROR;
+
+        ControllerCompleteTransfer(pDevice, pRequest);
+        PbcRequestComplete(pRequest);
+    }
+}
+
+ULONG
+TwiModelRun(
+    _In_  PPBC_DEVICE               pDevice
+    )
+/*++
+
+  Routine Description:
+
+    Delivers interrupts, DPCs and recovery timer expirations
+    until nothing is pending.
+
+  Return Value:
+
+    The number of interrupts delivered.
+
+--*/
+{
+    ULONG interrupts = 0;
+    BOOLEAN bQueueDpc;
+
+    for (;;)
+    {
+        if (TwiModelInterruptPending())
+        {
+            interrupts++;
+            if (!TwiModelIsr(pDevice, &bQueueDpc))
+            {
+                //
+                // Not claimed, nothing would clear it.
+                //
+
+                break;
+            }
+            if (bQueueDpc)
+            {
+                g_TwiModel.Dpcs++;
+                TwiModelDpc(pDevice);
+            }
+        }
+        else if (g_TwiModel.bTimerQueued)
+        {
+            g_TwiModel.bTimerQueued = FALSE;
+            TwiModelRecoveryTimer(pDevice);
+        }
+        else
+        {
+            break;
+        }
+
+        if (interrupts > 100000)
+        {
+            break;
+        }
+    }
+
+    return interrupts;
+}
+
+//
+// Framework and kernel routines used by controller.cpp.
+//
+
+LARGE_INTEGER
+KeQueryPerformanceCounter(
+    _Out_opt_ PLARGE_INTEGER PerformanceFrequency
+    )
+{
+    LARGE_INTEGER now;
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    now.QuadPart = (LONGLONG)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+
+    if (PerformanceFrequency != NULL)
+    {
+        PerformanceFrequency->QuadPart = 1000000000LL;
+    }
+
+    return now;
+}
+
+VOID
+KeStallExecutionProcessor(
+    _In_  ULONG MicroSeconds
+    )
+{
+    //
+    // The model has no bus timing, only count the time
+    // the driver would have spun.
+    //
+
+    g_TwiModel.StallUs += MicroSeconds;
+}
+
+BOOLEAN
+WdfTimerStart(
+    _In_ WDFTIMER Timer,
+    _In_ LONGLONG DueTime
+    )
+{
+    BOOLEAN bQueued = g_TwiModel.bTimerQueued;
+
+    UNREFERENCED_PARAMETER(Timer);
+
+    g_TwiModel.bTimerQueued = TRUE;
+    g_TwiModel.TimerDueTime = DueTime;
+    g_TwiModel.TimerStarts++;
+
+    return bQueued;
+}
+
+BOOLEAN
+WdfTimerStop(
+    _In_ WDFTIMER Timer,
+    _In_ BOOLEAN Wait
+    )
+{
+    BOOLEAN bQueued = g_TwiModel.bTimerQueued;
+
+    UNREFERENCED_PARAMETER(Timer);
+    UNREFERENCED_PARAMETER(Wait);
+
+    g_TwiModel.bTimerQueued = FALSE;
+
+    return bQueued;
+}
+
+VOID
+WdfInterruptAcquireLock(
+    _In_ WDFINTERRUPT Interrupt
+    )
+{
+    UNREFERENCED_PARAMETER(Interrupt);
+}
+
+VOID
+WdfInterruptReleaseLock(
+    _In_ WDFINTERRUPT Interrupt
+    )
+{
+    UNREFERENCED_PARAMETER(Interrupt);
+}
+
+VOID
+WdfSpinLockAcquire(
+    _In_ WDFSPINLOCK SpinLock
+    )
+{
+    UNREFERENCED_PARAMETER(SpinLock);
+
+    pthread_mutex_lock(&g_TwiModelLock);
+}
+
+VOID
+WdfSpinLockRelease(
+    _In_ WDFSPINLOCK SpinLock
+    )
+{
+    UNREFERENCED_PARAMETER(SpinLock);
+
+    pthread_mutex_unlock(&g_TwiModelLock);
+}
+
+NTSTATUS
+WdfRequestUnmarkCancelable(
+    _In_ WDFREQUEST Request
+    )
+{
+    UNREFERENCED_PARAMETER(Request);
+
+    return STATUS_SUCCESS;
+}
+
+//
+// Request helpers normally provided by device.cpp.
+//
+
+NTSTATUS
+PbcRequestConfigureForIndex(
+    _Inout_  PPBC_REQUEST            pRequest,
+    _In_     ULONG                   Index
+    )
+{
+    NT_ASSERT(Index < g_TwiModel.TransferCount);
+
+    pRequest->pMdlChain = &g_TwiModel.Mdls[Index];
+    pRequest->Length = g_TwiModel.Transfers[Index].Length;
+    pRequest->Information = 0;
+    pRequest->Direction = g_TwiModel.Transfers[Index].Direction;
+    pRequest->DelayInUs = 0;
+
+    if (pRequest->Type == SpbRequestTypeSequence)
+    {
+        if (pRequest->TransferCount == 1)
+        {
+            pRequest->SequencePosition = SpbRequestSequencePositionSingle;
+        }
+        else if (Index == 0)
+        {
+            pRequest->SequencePosition = SpbRequestSequencePositionFirst;
+        }
+        else if (Index == (pRequest->TransferCount - 1))
+        {
+            pRequest->SequencePosition = SpbRequestSequencePositionLast;
+        }
+        else
+        {
+            pRequest->SequencePosition = SpbRequestSequencePositionContinue;
+        }
+    }
+
+    return STATUS_SUCCESS;
+}
+
+VOID
+PbcRequestDoTransfer(
+    _In_     PPBC_DEVICE             pDevice,
+    _In_     PPBC_REQUEST            pRequest
+    )
+{
+    ControllerConfigureForTransfer(pDevice, pRequest);
+}
+
+VOID
+PbcRequestComplete(
+    _In_     PPBC_REQUEST            pRequest
+    )
+{
+    g_TwiModel.Completions++;
+    g_TwiModel.CompletionStatus = pRequest->Status;
+    g_TwiModel.CompletionInformation = pRequest->TotalInformation;
+}
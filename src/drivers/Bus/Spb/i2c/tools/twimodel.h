@@ -0,0 +1,220 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	twimodel.h
+
+Abstract:
+
+	Host model of the TWI controller and one slave, used to run the
+	unmodified controller.cpp in user mode. HWREG<ULONG> accesses to
+	the register block are routed to the model, which counts them and
+	behaves like the hardware for the bits the driver relies on:
+
+		CTL   INT_FLAG is write-1-to-clear, clearing it lets the
+		      controller act on a pending START, STOP or data byte.
+		      M_STA and M_STP read back as 1 until they are acted
+		      upon. A_ACK, BUS_EN and INT_EN are kept.
+		STAT  the status code of the last bus event, 0xf8 when idle.
+		SRST  self-clearing, resets the bus state machine.
+		LCR   line control, SCL pulses release a slave holding SDA.
+
+	The slave is a 256 byte register file with an auto-incrementing
+	pointer set by the first byte written, the usual layout of touch,
+	codec and PMIC devices.
+
+	The framework routines controller.cpp calls and the request
+	helpers device.cpp normally provides are implemented against a
+	single global model, one request is outstanding at a time.
+
+Environment:
+
+	user mode
+
+--*/
+
+#ifndef _TWIMODEL_H_
+#define _TWIMODEL_H_
+
+#include "internal.h"
+#include "controller.h"
+#include "device.h"
+
+#define TWI_MODEL_REGISTERS             (sizeof(SUNXII2C_REGISTERS) / sizeof(ULONG))
+#define TWI_MODEL_MAX_TRANSFERS         4
+
+typedef enum TWI_MODEL_PHASE
+{
+    TwiModelIdle,
+    TwiModelAddress,
+    TwiModelWrite,
+    TwiModelRead,
+    TwiModelNak
+}
+TWI_MODEL_PHASE;
+
+typedef struct TWI_MODEL_SLAVE
+{
+    // 7-bit address, the slave is absent when zero.
+    USHORT                         Address;
+    UCHAR                          Registers[256];
+    UCHAR                          Pointer;
+    BOOLEAN                        bPointerSet;
+
+    // NAK the data byte written after this many were
+    // accepted in one transaction, zero never NAKs.
+    ULONG                          NakAfter;
+    ULONG                          Written;
+
+    // SCL clocks needed before a slave holding SDA
+    // low lets go, zero when SDA is free.
+    ULONG                          SdaStuckClocks;
+}
+TWI_MODEL_SLAVE, *PTWI_MODEL_SLAVE;
+
+typedef struct TWI_MODEL_TRANSFER
+{
+    SPB_TRANSFER_DIRECTION         Direction;
+    PUCHAR                         pBuffer;
+    ULONG                          Length;
+}
+TWI_MODEL_TRANSFER, *PTWI_MODEL_TRANSFER;
+
+typedef struct TWI_MODEL
+{
+    // The block handed to the driver as pRegisters, its
+    // contents are never used, only the addresses.
+    SUNXII2C_REGISTERS             Registers;
+
+    // Register contents.
+    ULONG                          Ctl;
+    ULONG                          Stat;
+    ULONG                          Clk;
+    ULONG                          Efr;
+    ULONG                          Lcr;
+    ULONG                          Data;
+    ULONG                          Addr;
+    ULONG                          Xaddr;
+    ULONG                          Dvfs;
+
+    // Bus state machine.
+    TWI_MODEL_PHASE                Phase;
+    BOOLEAN                        bFlag;
+    BOOLEAN                        bStartPending;
+    BOOLEAN                        bStopPending;
+    BOOLEAN                        bDataPending;
+    TWI_MODEL_SLAVE                Slave;
+
+    // MMIO and bus event counters.
+    ULONG                          Reads[TWI_MODEL_REGISTERS];
+    ULONG                          Writes[TWI_MODEL_REGISTERS];
+    ULONG                          Resets;
+    ULONG                          Starts;
+    ULONG                          Stops;
+    ULONG                          SclClocks;
+    ULONG                          Dpcs;
+
+    // Recovery timer.
+    BOOLEAN                        bTimerQueued;
+    LONGLONG                       TimerDueTime;
+    ULONG                          TimerStarts;
+
+    // Time spent in KeStallExecutionProcessor.
+    ULONG                          StallUs;
+
+    // Target the slave is connected as, and the
+    // request being run and its completion.
+    PPBC_TARGET                    pTarget;
+    TWI_MODEL_TRANSFER             Transfers[TWI_MODEL_MAX_TRANSFERS];
+    MDL                            Mdls[TWI_MODEL_MAX_TRANSFERS];
+    ULONG                          TransferCount;
+    ULONG                          Completions;
+    NTSTATUS                       CompletionStatus;
+    size_t                         CompletionInformation;
+}
+TWI_MODEL, *PTWI_MODEL;
+
+extern TWI_MODEL g_TwiModel;
+
+//
+// Index of each register in the counter arrays.
+//
+
+#define TWI_MODEL_ADDR                  0
+#define TWI_MODEL_XADDR                 1
+#define TWI_MODEL_DATA                  2
+#define TWI_MODEL_CTL                   3
+#define TWI_MODEL_STAT                  4
+#define TWI_MODEL_CLK                   5
+#define TWI_MODEL_SRST                  6
+#define TWI_MODEL_EFR                   7
+#define TWI_MODEL_LCR                   8
+#define TWI_MODEL_DVFS                  9
+
+VOID
+TwiModelReset(
+    _Out_ PPBC_DEVICE               pDevice,
+    _Out_ PPBC_TARGET               pTarget,
+    _In_  USHORT                    SlaveAddress,
+    _In_  ULONG                     ConnectionSpeed);
+
+VOID
+TwiModelClearCounters(
+    VOID);
+
+ULONG
+TwiModelMmioReads(
+    VOID);
+
+ULONG
+TwiModelMmioWrites(
+    VOID);
+
+BOOLEAN
+TwiModelInterruptPending(
+    VOID);
+
+VOID
+TwiModelPrepareRequest(
+    _Out_ PPBC_REQUEST              pRequest,
+    _In_  SPB_REQUEST_TYPE          Type,
+    _In_  ULONG                     TransferCount);
+
+VOID
+TwiModelStartRequest(
+    _In_  PPBC_DEVICE               pDevice,
+    _In_  PPBC_REQUEST              pRequest,
+    _In_  BOOLEAN                   bAllowWriteRead);
+
+BOOLEAN
+TwiModelIsr(
+    _In_  PPBC_DEVICE               pDevice,
+    _Out_ PBOOLEAN                  pbQueueDpc);
+
+VOID
+TwiModelDpc(
+    _In_  PPBC_DEVICE               pDevice);
+
+ULONG
+TwiModelRun(
+    _In_  PPBC_DEVICE               pDevice);
+
+#endif // _TWIMODEL_H_
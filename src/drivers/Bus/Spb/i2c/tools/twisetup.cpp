@@ -0,0 +1,433 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	twisetup.cpp
+
+Abstract:
+
+	Micro-benchmark of the per-transfer setup cost of sunxii2c, the
+	work ControllerConfigureForTransfer does before START, counted
+	in register accesses on the TWI model (twimodel.cpp) and timed.
+
+	Cases:
+
+		legacy      the setup before the register shadows: soft reset,
+		            read-modify-write of every control bit and the
+		            M/N divider search whenever the speed is not
+		            200 kHz, replayed on the model
+		clean       the driver after a clean STOP, nothing to reset
+		reset       the driver with a reset pending after an error
+		alternate   the driver alternating two targets at 100 kHz
+		            and 400 kHz, the clock register is rewritten
+
+	On hardware every register access is an uncached bus cycle, the
+	access counts are what the comparison is about. The host time
+	includes the model and the trace record the driver writes per
+	transfer, so it only shows that nothing else was added.
+
+	Every driver case also runs the transfers to completion and checks
+	the data and the programmed clock. The program fails if the driver
+	needs more register accesses than the legacy setup or resets the
+	controller without a pending error.
+
+	Build and use on any host with a C++ compiler:
+
+		c++ -O2 -I../../../../../tools/host -I.. -o twisetup twisetup.cpp twimodel.cpp ../controller.cpp -lpthread
+		twisetup [transfers]
+
+Environment:
+
+	user mode
+
+--*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "twimodel.h"
+
+#define DEFAULT_TRANSFERS       20000
+#define SLAVE_ADDRESS           0x5d
+#define SLAVE_SPEED             400000
+
+typedef struct _SETUP_RESULT
+{
+    const char *Name;
+    ULONG Transfers;
+    ULONG Reads;
+    ULONG Writes;
+    ULONG Resets;
+    double Nanoseconds;
+}SETUP_RESULT;
+
+static double
+NowNs(
+    VOID
+    )
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+//
+// The divider search and setup sequence sunxii2c used before the
+// control and clock registers were shadowed, kept to compare against.
+//
+
+static VOID
+LegacySetClock(
+    _In_  PPBC_DEVICE  pDevice,
+    _In_  ULONG Clock,
+    _In_  ULONG sclk_req
+    )
+{
+    ULONG clk_m = 0;
+    ULONG clk_n = 0;
+    ULONG _2_pow_clk_n = 1;
+    ULONG src_clk = Clock / 10;
+    ULONG divider = src_clk / sclk_req;
+    ULONG sclk_real = 0;
+    ULONG reg_val;
+
+    if (divider == 0) {
+        clk_m = 1;
+        goto set_clk;
+    }
+
+    while (clk_n < 8) {
+        clk_m = (divider / _2_pow_clk_n) - 1;
+        while (clk_m < 16) {
+            sclk_real = src_clk / (clk_m + 1) / _2_pow_clk_n;
+            if (sclk_real <= sclk_req) {
+                goto set_clk;
+            }
+            else {
+                clk_m++;
+            }
+        }
+        clk_n++;
+        _2_pow_clk_n *= 2;
+    }
+
+set_clk:
+    reg_val = pDevice->pRegisters->ClkReg.Read();
+    reg_val &= ~(TWI_CLK_DIV_M | TWI_CLK_DIV_N);
+    reg_val |= (clk_n | (clk_m << 3));
+    pDevice->pRegisters->ClkReg.Write(reg_val);
+}
+
+static VOID
+LegacyUpdateCtl(
+    _In_  PPBC_DEVICE  pDevice,
+    _In_  ULONG SetBits,
+    _In_  ULONG ClearBits
+    )
+{
+    ULONG RegVal = pDevice->pRegisters->CtlReg.Read();
+
+    RegVal |= SetBits;
+    RegVal &= ~(ClearBits | TWI_CTL_INTFLG);
+    pDevice->pRegisters->CtlReg.Write(RegVal);
+}
+
+static int
+LegacySetup(
+    _In_  PPBC_DEVICE  pDevice,
+    _In_  ULONG ConnectionSpeed
+    )
+{
+    PSUNXII2C_REGISTERS pRegisters = pDevice->pRegisters;
+    ULONG timeout = 0xff;
+    ULONG RegVal;
+    LONG delay = 50;
+
+    /* TwiSoftReset */
+    RegVal = pRegisters->SrstReg.Read();
+    pRegisters->SrstReg.Write(RegVal | TWI_SRST_SRST);
+
+    /* TwiDelay(50) */
+    do {
+        __nop();
+    } while (--delay > 0);
+
+    if ((TWI_STAT_IDLE != (pRegisters->StatReg.Read() & TWI_STAT_MASK)) &&
+        (TWI_STAT_BUS_ERR != (pRegisters->StatReg.Read() & TWI_STAT_MASK)) &&
+        (TWI_STAT_ARBLOST_SLAR_ACK != (pRegisters->StatReg.Read() & TWI_STAT_MASK))) {
+        return AW_I2C_RETRY;
+    }
+
+    LegacyUpdateCtl(pDevice, TWI_CTL_INTEN, TWI_CTL_STA | TWI_CTL_STP);
+    LegacyUpdateCtl(pDevice, 0, TWI_CTL_ACK);
+
+    RegVal = pRegisters->EfrReg.Read();
+    pRegisters->EfrReg.Write(RegVal & ~TWI_EFR_MASK);
+
+    if (ConnectionSpeed != 200000) {
+        LegacySetClock(pDevice, 24000000, ConnectionSpeed);
+    }
+
+    /* TwiStart */
+    LegacyUpdateCtl(pDevice, TWI_CTL_STA, 0);
+    while ((pRegisters->CtlReg.Read() & TWI_CTL_STA) && (--timeout));
+    if (timeout == 0) {
+        return AW_I2C_FAIL;
+    }
+
+    /* ControllerEnableInterrupts */
+    LegacyUpdateCtl(pDevice, TWI_CTL_INTEN, TWI_CTL_STA | TWI_CTL_STP);
+
+    return AW_I2C_OK;
+}
+
+static int
+RunLegacy(
+    _In_  ULONG Transfers,
+    _Out_ SETUP_RESULT *pResult
+    )
+{
+    PBC_DEVICE device;
+    PBC_TARGET target;
+    ULONG reads = 0;
+    ULONG writes = 0;
+    double start;
+    double elapsed = 0;
+    ULONG i;
+
+    TwiModelReset(&device, &target, SLAVE_ADDRESS, SLAVE_SPEED);
+    TwiModelClearCounters();
+
+    for (i = 0; i < Transfers; i++)
+    {
+        ULONG r0 = TwiModelMmioReads();
+        ULONG w0 = TwiModelMmioWrites();
+
+        start = NowNs();
+        if (LegacySetup(&device, SLAVE_SPEED) != AW_I2C_OK)
+        {
+            printf("legacy: setup %lu failed\n", (unsigned long)i);
+            return 1;
+        }
+        elapsed += NowNs() - start;
+
+        reads += TwiModelMmioReads() - r0;
+        writes += TwiModelMmioWrites() - w0;
+
+        //
+        // Abandon the transfer with a STOP so the next one
+        // starts from an idle bus.
+        //
+
+        device.pRegisters->CtlReg.Write(TWI_CTL_BUSEN | TWI_CTL_STP | TWI_CTL_INTFLG);
+    }
+
+    pResult->Name = "legacy";
+    pResult->Transfers = Transfers;
+    pResult->Reads = reads;
+    pResult->Writes = writes;
+    pResult->Resets = g_TwiModel.Resets;
+    pResult->Nanoseconds = elapsed;
+
+    return 0;
+}
+
+//
+// One two-byte register write per transfer, through the generic
+// path so ControllerConfigureForTransfer sets up every transfer.
+//
+
+static int
+RunDriver(
+    _In_  const char *Name,
+    _In_  ULONG Transfers,
+    _In_  BOOLEAN bResetPending,
+    _In_  BOOLEAN bAlternate,
+    _Out_ SETUP_RESULT *pResult
+    )
+{
+    PBC_DEVICE device;
+    PBC_TARGET target;
+    PBC_TARGET slowTarget;
+    PBC_REQUEST request;
+    UCHAR buffer[2];
+    ULONG reads = 0;
+    ULONG writes = 0;
+    ULONG resets = 0;
+    double start;
+    double elapsed = 0;
+    ULONG i;
+
+    TwiModelReset(&device, &target, SLAVE_ADDRESS, SLAVE_SPEED);
+
+    slowTarget = target;
+    slowTarget.Settings.ConnectionSpeed = 100000;
+    slowTarget.ClockRegister = ControllerCalculateClock(100000, &slowTarget.ClockFrequency);
+
+    TwiModelClearCounters();
+
+    for (i = 0; i < Transfers; i++)
+    {
+        PPBC_TARGET pTarget = (bAlternate && (i & 1)) ? &slowTarget : &target;
+        ULONG r0;
+        ULONG w0;
+        ULONG resets0;
+
+        buffer[0] = (UCHAR)(i & 0x7f);
+        buffer[1] = (UCHAR)(i * 7);
+
+        g_TwiModel.Transfers[0].Direction = SpbTransferDirectionToDevice;
+        g_TwiModel.Transfers[0].pBuffer = buffer;
+        g_TwiModel.Transfers[0].Length = sizeof(buffer);
+        g_TwiModel.pTarget = pTarget;
+
+        TwiModelPrepareRequest(&request, SpbRequestTypeWrite, 1);
+        PbcRequestConfigureForIndex(&request, 0);
+
+        device.pCurrentTarget = pTarget;
+        pTarget->pCurrentRequest = &request;
+        device.bResetPending = bResetPending;
+
+        r0 = TwiModelMmioReads();
+        w0 = TwiModelMmioWrites();
+        resets0 = g_TwiModel.Resets;
+
+        start = NowNs();
+        ControllerConfigureForTransfer(&device, &request);
+        elapsed += NowNs() - start;
+
+        reads += TwiModelMmioReads() - r0;
+        writes += TwiModelMmioWrites() - w0;
+        resets += g_TwiModel.Resets - resets0;
+
+        TwiModelRun(&device);
+
+        if ((g_TwiModel.Completions != 1) ||
+            !NT_SUCCESS(g_TwiModel.CompletionStatus) ||
+            (g_TwiModel.CompletionInformation != sizeof(buffer)) ||
+            (g_TwiModel.Slave.Registers[buffer[0]] != buffer[1]))
+        {
+            printf("%s: transfer %lu failed, status 0x%08lx, %lu bytes\n",
+                Name,
+                (unsigned long)i,
+                (unsigned long)g_TwiModel.CompletionStatus,
+                (unsigned long)g_TwiModel.CompletionInformation);
+            return 1;
+        }
+
+        if (g_TwiModel.Clk != pTarget->ClockRegister)
+        {
+            printf("%s: transfer %lu ran with clock 0x%02lx, expected 0x%02lx\n",
+                Name,
+                (unsigned long)i,
+                (unsigned long)g_TwiModel.Clk,
+                (unsigned long)pTarget->ClockRegister);
+            return 1;
+        }
+    }
+
+    pResult->Name = Name;
+    pResult->Transfers = Transfers;
+    pResult->Reads = reads;
+    pResult->Writes = writes;
+    pResult->Resets = resets;
+    pResult->Nanoseconds = elapsed;
+
+    return 0;
+}
+
+static VOID
+PrintResult(
+    _In_  const SETUP_RESULT *pResult
+    )
+{
+    printf("%-10s %8.2f %8.2f %8.2f %8.2f %10.1f\n",
+        pResult->Name,
+        (double)pResult->Reads / pResult->Transfers,
+        (double)pResult->Writes / pResult->Transfers,
+        (double)(pResult->Reads + pResult->Writes) / pResult->Transfers,
+        (double)pResult->Resets / pResult->Transfers,
+        pResult->Nanoseconds / pResult->Transfers);
+}
+
+int
+main(
+    int argc,
+    char *argv[]
+    )
+{
+    ULONG transfers = DEFAULT_TRANSFERS;
+    SETUP_RESULT legacy;
+    SETUP_RESULT clean;
+    SETUP_RESULT reset;
+    SETUP_RESULT alternate;
+    int failed = 0;
+
+    if (argc > 1)
+    {
+        transfers = (ULONG)strtoul(argv[1], NULL, 0);
+        if (transfers == 0)
+        {
+            fprintf(stderr, "usage: twisetup [transfers]\n");
+            return 2;
+        }
+    }
+
+    if (RunLegacy(transfers, &legacy) ||
+        RunDriver("clean", transfers, FALSE, FALSE, &clean) ||
+        RunDriver("reset", transfers, TRUE, FALSE, &reset) ||
+        RunDriver("alternate", transfers, FALSE, TRUE, &alternate))
+    {
+        return 1;
+    }
+
+    printf("per transfer setup, %lu transfers at %lu Hz\n\n",
+        (unsigned long)transfers,
+        (unsigned long)SLAVE_SPEED);
+    printf("%-10s %8s %8s %8s %8s %10s\n", "case", "reads", "writes", "mmio", "resets", "ns");
+    PrintResult(&legacy);
+    PrintResult(&clean);
+    PrintResult(&reset);
+    PrintResult(&alternate);
+
+    if (clean.Resets != 0)
+    {
+        printf("FAIL: the controller was reset without a pending error\n");
+        failed = 1;
+    }
+
+    if (reset.Resets != reset.Transfers)
+    {
+        printf("FAIL: a pending error did not reset the controller once per transfer\n");
+        failed = 1;
+    }
+
+    if ((clean.Reads + clean.Writes >= legacy.Reads + legacy.Writes) ||
+        (alternate.Reads + alternate.Writes >= legacy.Reads + legacy.Writes))
+    {
+        printf("FAIL: the shadowed setup is not cheaper than the legacy one\n");
+        failed = 1;
+    }
+
+    return failed;
+}
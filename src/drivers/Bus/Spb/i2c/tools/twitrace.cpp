@@ -0,0 +1,507 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	twitrace.cpp
+
+Abstract:
+
+	Decodes the buffers returned by IOCTL_SUNXII2C_QUERY_TRACE and
+	IOCTL_SUNXII2C_QUERY_HISTOGRAM, saved as raw files on the device,
+	on any host. Each file is recognized by its layout.
+
+	For a trace the records are printed as a timeline, one line per
+	record with the time since the first record and since the previous
+	one. Records then are grouped into requests, from the first Start
+	after a Complete to the next Complete, and per target address the
+	program prints the request count, errors, interrupts per request
+	and the 50th, 90th and 99th percentile and maximum latency. A gap
+	in the sequence numbers means records were overwritten before the
+	query or dropped because they were being rewritten.
+
+	For a histogram the buckets of every target are printed with the
+	percentiles they bound.
+
+	Build and use on any host with a C++ compiler:
+
+		c++ -O2 -I../../../../../tools/host -I.. -o twitrace twitrace.cpp
+		twitrace [-q] dump...
+
+	-q leaves out the timeline.
+
+Environment:
+
+	user mode
+
+--*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ntddk.h"
+#include "sunxii2c.h"
+#include "sunxii2cioctl.h"
+
+#define TRACE_MAX_TARGETS       16
+#define TRACE_MAX_REQUESTS      4096
+
+typedef struct _TARGET_LATENCY
+{
+    USHORT Address;
+    ULONG Requests;
+    ULONG Errors;
+    ULONG Interrupts;
+    ULONG LatencyUs[TRACE_MAX_REQUESTS];
+}TARGET_LATENCY;
+
+static TARGET_LATENCY g_Targets[TRACE_MAX_TARGETS];
+static ULONG g_TargetCount;
+
+static const char *
+EventName(
+    _In_  UCHAR Event
+    )
+{
+    switch (Event)
+    {
+    case Sunxii2cTraceStart:        return "start";
+    case Sunxii2cTraceInterrupt:    return "irq";
+    case Sunxii2cTraceComplete:     return "complete";
+    case Sunxii2cTraceRecovery:     return "recovery";
+    default:                        return "?";
+    }
+}
+
+static const char *
+TwiStatusName(
+    _In_  UCHAR TwiStatus
+    )
+{
+    switch (TwiStatus)
+    {
+    case TWI_STAT_BUS_ERR:          return "bus error";
+    case TWI_STAT_TX_STA:           return "start";
+    case TWI_STAT_TX_RESTA:         return "restart";
+    case TWI_STAT_TX_AW_ACK:        return "addr+w ack";
+    case TWI_STAT_TX_AW_NAK:        return "addr+w nak";
+    case TWI_STAT_TXD_ACK:          return "tx ack";
+    case TWI_STAT_TXD_NAK:          return "tx nak";
+    case TWI_STAT_ARBLOST:          return "arb lost";
+    case TWI_STAT_TX_AR_ACK:        return "addr+r ack";
+    case TWI_STAT_TX_AR_NAK:        return "addr+r nak";
+    case TWI_STAT_RXD_ACK:          return "rx ack";
+    case TWI_STAT_RXD_NAK:          return "rx nak";
+    case TWI_STAT_IDLE:             return "idle";
+    default:                        return "";
+    }
+}
+
+static TARGET_LATENCY *
+FindTarget(
+    _In_  USHORT Address
+    )
+{
+    ULONG i;
+
+    for (i = 0; i < g_TargetCount; i++)
+    {
+        if (g_Targets[i].Address == Address)
+        {
+            return &g_Targets[i];
+        }
+    }
+
+    if (g_TargetCount == TRACE_MAX_TARGETS)
+    {
+        return NULL;
+    }
+
+    g_Targets[g_TargetCount].Address = Address;
+    return &g_Targets[g_TargetCount++];
+}
+
+static int
+CompareUlong(
+    const void *pLeft,
+    const void *pRight
+    )
+{
+    ULONG left = *(const ULONG *)pLeft;
+    ULONG right = *(const ULONG *)pRight;
+
+    return (left > right) - (left < right);
+}
+
+static ULONG
+Percentile(
+    _In_  const ULONG *pSorted,
+    _In_  ULONG Count,
+    _In_  ULONG Percent
+    )
+{
+    ULONG rank = (Count * Percent + 99) / 100;
+
+    return pSorted[(rank == 0) ? 0 : rank - 1];
+}
+
+static VOID
+DecodeTrace(
+    _In_  const SUNXII2C_TRACE *pTrace,
+    _In_  BOOLEAN bTimeline
+    )
+{
+    const SUNXII2C_TRACE_RECORD *pRecord;
+    TARGET_LATENCY *pTarget;
+    ULONGLONG firstTime = 0;
+    ULONGLONG lastTime = 0;
+    ULONGLONG requestStart = 0;
+    ULONG requestInterrupts = 0;
+    BOOLEAN bInRequest = FALSE;
+    ULONG gaps = 0;
+    ULONG i;
+
+    g_TargetCount = 0;
+
+    printf("bus %lu, %lu records, next sequence %lu, %llu Hz\n",
+        (unsigned long)pTrace->BusNumber,
+        (unsigned long)pTrace->RecordCount,
+        (unsigned long)pTrace->NextSequence,
+        (unsigned long long)pTrace->Frequency);
+
+    if (pTrace->RecordCount == 0 || pTrace->Frequency == 0)
+    {
+        return;
+    }
+
+    firstTime = pTrace->Records[0].Timestamp;
+    lastTime = firstTime;
+
+    if (bTimeline)
+    {
+        printf("\n%12s %9s %8s  %-8s %-5s %-4s %-15s %5s  %s\n",
+            "time us", "delta us", "sequence", "event", "addr", "xfer", "twi status", "count", "status");
+    }
+
+    for (i = 0; i < pTrace->RecordCount; i++)
+    {
+        pRecord = &pTrace->Records[i];
+
+        if ((i != 0) && (pRecord->Sequence != pTrace->Records[i - 1].Sequence + 1))
+        {
+            gaps++;
+        }
+
+        if (bTimeline)
+        {
+            printf("%12.1f %9.1f %8lu  %-8s 0x%02x  %u/%u  0x%02x %-10s %5u  0x%08lx\n",
+                (double)(pRecord->Timestamp - firstTime) * 1e6 / pTrace->Frequency,
+                (double)(pRecord->Timestamp - lastTime) * 1e6 / pTrace->Frequency,
+                (unsigned long)pRecord->Sequence,
+                EventName(pRecord->Event),
+                pRecord->Address,
+                pRecord->Position,
+                pRecord->TransferIndex,
+                pRecord->TwiStatus,
+                (pRecord->Event == Sunxii2cTraceInterrupt) ? TwiStatusName(pRecord->TwiStatus) : "",
+                pRecord->Count,
+                (unsigned long)(ULONG)pRecord->Status);
+        }
+
+        lastTime = pRecord->Timestamp;
+
+        //
+        // A request starts with its first transfer and ends with
+        // its completion, requests never overlap on one bus.
+        //
+
+        switch (pRecord->Event)
+        {
+        case Sunxii2cTraceStart:
+            if (!bInRequest)
+            {
+                bInRequest = TRUE;
+                requestStart = pRecord->Timestamp;
+                requestInterrupts = 0;
+            }
+            break;
+
+        case Sunxii2cTraceInterrupt:
+            requestInterrupts++;
+            break;
+
+        case Sunxii2cTraceComplete:
+            if (!bInRequest)
+            {
+                break;
+            }
+
+            bInRequest = FALSE;
+            pTarget = FindTarget(pRecord->Address);
+
+            if ((pTarget == NULL) || (pTarget->Requests == TRACE_MAX_REQUESTS))
+            {
+                break;
+            }
+
+            pTarget->LatencyUs[pTarget->Requests++] = (ULONG)
+                (((pRecord->Timestamp - requestStart) * 1000000) / pTrace->Frequency);
+            pTarget->Interrupts += requestInterrupts;
+
+            if (!NT_SUCCESS(pRecord->Status))
+            {
+                pTarget->Errors++;
+            }
+            break;
+        }
+    }
+
+    printf("\n%.1f us traced, %lu gap(s) in the sequence\n",
+        (double)(lastTime - firstTime) * 1e6 / pTrace->Frequency,
+        (unsigned long)gaps);
+
+    printf("\naddr  requests errors  irq/req  p50 us  p90 us  p99 us  max us\n");
+
+    for (i = 0; i < g_TargetCount; i++)
+    {
+        pTarget = &g_Targets[i];
+
+        if (pTarget->Requests == 0)
+        {
+            continue;
+        }
+
+        qsort(pTarget->LatencyUs, pTarget->Requests, sizeof(ULONG), CompareUlong);
+
+        printf("0x%02x  %8lu %6lu  %7.1f  %6lu  %6lu  %6lu  %6lu\n",
+            pTarget->Address,
+            (unsigned long)pTarget->Requests,
+            (unsigned long)pTarget->Errors,
+            (double)pTarget->Interrupts / pTarget->Requests,
+            (unsigned long)Percentile(pTarget->LatencyUs, pTarget->Requests, 50),
+            (unsigned long)Percentile(pTarget->LatencyUs, pTarget->Requests, 90),
+            (unsigned long)Percentile(pTarget->LatencyUs, pTarget->Requests, 99),
+            (unsigned long)pTarget->LatencyUs[pTarget->Requests - 1]);
+    }
+}
+
+static ULONG
+BucketBound(
+    _In_  ULONG Bucket
+    )
+{
+    return (1UL << SUNXII2C_HISTOGRAM_BASE_SHIFT) << Bucket;
+}
+
+static ULONG
+BucketPercentile(
+    _In_  const SUNXII2C_TARGET_HISTOGRAM *pTarget,
+    _In_  ULONG Percent
+    )
+{
+    ULONG rank = (pTarget->Transactions * Percent + 99) / 100;
+    ULONG seen = 0;
+    ULONG bucket;
+
+    for (bucket = 0; bucket < SUNXII2C_HISTOGRAM_BUCKETS; bucket++)
+    {
+        seen += pTarget->Buckets[bucket];
+
+        if (seen >= rank)
+        {
+            break;
+        }
+    }
+
+    return bucket;
+}
+
+static VOID
+PrintBound(
+    _In_  const SUNXII2C_TARGET_HISTOGRAM *pTarget,
+    _In_  ULONG Bucket
+    )
+{
+    if (Bucket >= SUNXII2C_HISTOGRAM_BUCKETS - 1)
+    {
+        printf("  <=%6lu", (unsigned long)pTarget->MaxLatencyUs);
+    }
+    else
+    {
+        printf("  < %6lu", (unsigned long)BucketBound(Bucket));
+    }
+}
+
+static VOID
+DecodeHistogram(
+    _In_  const SUNXII2C_HISTOGRAM *pHistogram
+    )
+{
+    const SUNXII2C_TARGET_HISTOGRAM *pTarget;
+    ULONG bucket;
+    ULONG i;
+
+    printf("%lu target(s)\n", (unsigned long)pHistogram->TargetCount);
+    printf("\naddr  requests errors  mean us  p50 us    p90 us    p99 us    max us\n");
+
+    for (i = 0; i < pHistogram->TargetCount && i < SUNXII2C_HISTOGRAM_MAX_TARGETS; i++)
+    {
+        pTarget = &pHistogram->Targets[i];
+
+        printf("0x%02x  %8lu %6lu  %7.1f",
+            pTarget->Address,
+            (unsigned long)pTarget->Transactions,
+            (unsigned long)pTarget->Errors,
+            (pTarget->Transactions != 0) ?
+                (double)pTarget->TotalLatencyUs / pTarget->Transactions : 0.0);
+
+        if (pTarget->Transactions != 0)
+        {
+            PrintBound(pTarget, BucketPercentile(pTarget, 50));
+            PrintBound(pTarget, BucketPercentile(pTarget, 90));
+            PrintBound(pTarget, BucketPercentile(pTarget, 99));
+        }
+
+        printf("  %6lu\n", (unsigned long)pTarget->MaxLatencyUs);
+    }
+
+    for (i = 0; i < pHistogram->TargetCount && i < SUNXII2C_HISTOGRAM_MAX_TARGETS; i++)
+    {
+        pTarget = &pHistogram->Targets[i];
+
+        printf("\n0x%02x buckets\n", pTarget->Address);
+
+        for (bucket = 0; bucket < SUNXII2C_HISTOGRAM_BUCKETS; bucket++)
+        {
+            if (pTarget->Buckets[bucket] == 0)
+            {
+                continue;
+            }
+
+            if (bucket == SUNXII2C_HISTOGRAM_BUCKETS - 1)
+            {
+                printf("  >= %7lu us  %8lu\n",
+                    (unsigned long)BucketBound(bucket - 1),
+                    (unsigned long)pTarget->Buckets[bucket]);
+            }
+            else
+            {
+                printf("   < %7lu us  %8lu\n",
+                    (unsigned long)BucketBound(bucket),
+                    (unsigned long)pTarget->Buckets[bucket]);
+            }
+        }
+    }
+}
+
+static int
+DecodeFile(
+    _In_  const char *pPath,
+    _In_  BOOLEAN bTimeline
+    )
+{
+    const SUNXII2C_TRACE *pTrace;
+    FILE *pFile;
+    UCHAR *pBuffer;
+    long size;
+    int ret = 1;
+
+    pFile = fopen(pPath, "rb");
+    if (pFile == NULL)
+    {
+        printf("%s: cannot open\n", pPath);
+        return 1;
+    }
+
+    fseek(pFile, 0, SEEK_END);
+    size = ftell(pFile);
+    fseek(pFile, 0, SEEK_SET);
+
+    pBuffer = (UCHAR *)malloc((size > 0) ? size : 1);
+    if ((pBuffer == NULL) || (fread(pBuffer, 1, size, pFile) != (size_t)size))
+    {
+        printf("%s: cannot read\n", pPath);
+        goto exit;
+    }
+
+    printf("== %s\n", pPath);
+
+    pTrace = (const SUNXII2C_TRACE *)pBuffer;
+
+    if (((size_t)size >= FIELD_OFFSET(SUNXII2C_TRACE, Records)) &&
+        (pTrace->Version == SUNXII2C_TRACE_VERSION) &&
+        (pTrace->RecordSize == sizeof(SUNXII2C_TRACE_RECORD)) &&
+        ((size_t)size == FIELD_OFFSET(SUNXII2C_TRACE, Records) +
+            (size_t)pTrace->RecordCount * sizeof(SUNXII2C_TRACE_RECORD)))
+    {
+        DecodeTrace(pTrace, bTimeline);
+        ret = 0;
+    }
+    else if (((size_t)size == sizeof(SUNXII2C_HISTOGRAM)) &&
+             (((const SUNXII2C_HISTOGRAM *)pBuffer)->Version == SUNXII2C_TRACE_VERSION))
+    {
+        DecodeHistogram((const SUNXII2C_HISTOGRAM *)pBuffer);
+        ret = 0;
+    }
+    else
+    {
+        printf("%s: neither a trace nor a histogram\n", pPath);
+    }
+
+    printf("\n");
+
+exit:
+
+    free(pBuffer);
+    fclose(pFile);
+
+    return ret;
+}
+
+int
+main(
+    int argc,
+    char *argv[]
+    )
+{
+    BOOLEAN bTimeline = TRUE;
+    int failures = 0;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-q") == 0)
+        {
+            bTimeline = FALSE;
+            continue;
+        }
+
+        failures += DecodeFile(argv[i], bTimeline);
+    }
+
+    if (argc < 2)
+    {
+        printf("usage: twitrace [-q] dump...\n");
+        return 1;
+    }
+
+    return (failures != 0) ? 1 : 0;
+}
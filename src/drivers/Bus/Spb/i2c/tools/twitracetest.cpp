@@ -0,0 +1,323 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	twitracetest.cpp
+
+Abstract:
+
+	Checks IOCTL_SUNXII2C_QUERY_TRACE against a writer that does not
+	stop. One thread appends trace records with ControllerTraceEvent
+	as fast as it can, the way the ISR and DPC do, while another keeps
+	copying the trace out with ControllerTraceQuery. Every record the
+	writer stores is derived from its sequence number, so a record torn
+	by the writer reusing its slot during the copy shows up as fields
+	that disagree with the sequence. The program fails on any such
+	record, or if the records of one query are not in sequence order.
+
+	It then runs register reads through the TWI model, queries the
+	trace and the histograms and checks that both account for every
+	request. Given two file names it saves the two buffers there, as
+	sample input for twitrace.
+
+	Build and use on any host with a C++ compiler:
+
+		c++ -O2 -I../../../../../tools/host -I.. -o twitracetest twitracetest.cpp twimodel.cpp ../controller.cpp -lpthread
+		twitracetest [trace.bin histogram.bin]
+
+Environment:
+
+	user mode
+
+--*/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "twimodel.h"
+#include "sunxii2cioctl.h"
+
+#define SLAVE_ADDRESS           0x38
+#define SLAVE_SPEED             400000
+
+#define WRITER_EVENTS           4000000
+#define QUERY_RECORDS           PBC_TRACE_RECORDS
+#define MODEL_REQUESTS          40
+
+typedef struct _TRACE_BUFFER
+{
+    SUNXII2C_TRACE Header;
+    SUNXII2C_TRACE_RECORD More[QUERY_RECORDS - 1];
+}TRACE_BUFFER;
+
+//
+// The records run on past the one declared in the header.
+//
+
+#define TRACE_RECORDS(_Buffer_) \
+    ((const SUNXII2C_TRACE_RECORD *)((const UCHAR *)&(_Buffer_) + FIELD_OFFSET(SUNXII2C_TRACE, Records)))
+
+static PBC_DEVICE g_Device;
+static PBC_TARGET g_Target;
+static ULONG g_Base;
+static volatile LONG g_WriterDone;
+static int g_Failures;
+
+static VOID
+Check(
+    _In_  BOOLEAN bCondition,
+    _In_  const char *pCase,
+    _In_  const char *pWhat
+    )
+{
+    if (!bCondition)
+    {
+        printf("FAIL %s: %s\n", pCase, pWhat);
+        g_Failures++;
+    }
+}
+
+static void *
+WriterThread(
+    void *pContext
+    )
+{
+    ULONG k;
+
+    UNREFERENCED_PARAMETER(pContext);
+
+    for (k = 0; k < WRITER_EVENTS; k++)
+    {
+        ControllerTraceEvent(
+            &g_Device,
+            Sunxii2cTraceInterrupt,
+            k & 0xff,
+            (USHORT)k,
+            (NTSTATUS)k);
+    }
+
+    InterlockedExchange(&g_WriterDone, 1);
+
+    return NULL;
+}
+
+static VOID
+TestConcurrentQuery(
+    VOID
+    )
+{
+    static TRACE_BUFFER buffer;
+    const SUNXII2C_TRACE_RECORD *pRecords = TRACE_RECORDS(buffer);
+    const SUNXII2C_TRACE_RECORD *pRecord;
+    pthread_t writer;
+    size_t bytes;
+    ULONGLONG queries = 0;
+    ULONGLONG records = 0;
+    ULONGLONG dropped = 0;
+    ULONG k;
+    ULONG i;
+    BOOLEAN bTorn = FALSE;
+    BOOLEAN bOrder = FALSE;
+
+    TwiModelReset(&g_Device, &g_Target, SLAVE_ADDRESS, SLAVE_SPEED);
+    g_Base = (ULONG)g_Device.Trace.Sequence;
+    g_WriterDone = 0;
+
+    pthread_create(&writer, NULL, WriterThread, NULL);
+
+    while (g_WriterDone == 0)
+    {
+        if (!NT_SUCCESS(ControllerTraceQuery(
+                &g_Device,
+                IOCTL_SUNXII2C_QUERY_TRACE,
+                &buffer,
+                sizeof(buffer),
+                &bytes)))
+        {
+            Check(FALSE, "concurrent", "query failed");
+            break;
+        }
+
+        queries++;
+        records += buffer.Header.RecordCount;
+        dropped += min(buffer.Header.NextSequence - 1 - g_Base, (ULONG)QUERY_RECORDS) -
+            buffer.Header.RecordCount;
+
+        for (i = 0; i < buffer.Header.RecordCount; i++)
+        {
+            pRecord = &pRecords[i];
+            k = pRecord->Sequence - g_Base - 1;
+
+            if ((pRecord->Event != Sunxii2cTraceInterrupt) ||
+                (pRecord->TwiStatus != (UCHAR)k) ||
+                (pRecord->Count != (USHORT)k) ||
+                (pRecord->Status != (NTSTATUS)k) ||
+                (pRecord->Address != g_Device.Trace.Address))
+            {
+                bTorn = TRUE;
+            }
+
+            if ((i != 0) && (pRecord->Sequence <= pRecords[i - 1].Sequence))
+            {
+                bOrder = TRUE;
+            }
+        }
+    }
+
+    pthread_join(writer, NULL);
+
+    Check(!bTorn, "concurrent", "a torn record was returned");
+    Check(!bOrder, "concurrent", "records out of sequence order");
+    Check(queries != 0, "concurrent", "no query ran while writing");
+
+    printf("concurrent: %llu queries, %llu records, %llu dropped while rewritten\n",
+        (unsigned long long)queries,
+        (unsigned long long)records,
+        (unsigned long long)dropped);
+
+    //
+    // Once quiet every slot is returned.
+    //
+
+    ControllerTraceQuery(&g_Device, IOCTL_SUNXII2C_QUERY_TRACE, &buffer, sizeof(buffer), &bytes);
+    Check(buffer.Header.RecordCount == QUERY_RECORDS, "quiet", "every record returned");
+    Check(buffer.Header.NextSequence == g_Base + WRITER_EVENTS + 1, "quiet", "next sequence");
+}
+
+static BOOLEAN
+SaveFile(
+    _In_  const char *pPath,
+    _In_  const void *pBuffer,
+    _In_  size_t Length
+    )
+{
+    FILE *pFile = fopen(pPath, "wb");
+    BOOLEAN bSaved;
+
+    if (pFile == NULL)
+    {
+        return FALSE;
+    }
+
+    bSaved = (fwrite(pBuffer, 1, Length, pFile) == Length);
+    fclose(pFile);
+
+    return bSaved;
+}
+
+static VOID
+TestModelDump(
+    _In_opt_ const char *pTracePath,
+    _In_opt_ const char *pHistogramPath
+    )
+{
+    static TRACE_BUFFER trace;
+    static SUNXII2C_HISTOGRAM histogram;
+    const SUNXII2C_TRACE_RECORD *pRecords = TRACE_RECORDS(trace);
+    PBC_REQUEST request;
+    UCHAR reg;
+    UCHAR data[16];
+    size_t traceBytes;
+    size_t histogramBytes;
+    ULONG completes = 0;
+    ULONG i;
+
+    TwiModelReset(&g_Device, &g_Target, SLAVE_ADDRESS, SLAVE_SPEED);
+
+    for (i = 0; i < MODEL_REQUESTS; i++)
+    {
+        reg = (UCHAR)(i * 4);
+
+        //
+        // Every eighth request is to an absent address.
+        //
+
+        g_TwiModel.Slave.Address = ((i % 8) == 7) ? 0 : SLAVE_ADDRESS;
+
+        g_TwiModel.Transfers[0].Direction = SpbTransferDirectionToDevice;
+        g_TwiModel.Transfers[0].pBuffer = &reg;
+        g_TwiModel.Transfers[0].Length = 1;
+        g_TwiModel.Transfers[1].Direction = SpbTransferDirectionFromDevice;
+        g_TwiModel.Transfers[1].pBuffer = data;
+        g_TwiModel.Transfers[1].Length = 1 + (i % sizeof(data));
+
+        TwiModelPrepareRequest(&request, SpbRequestTypeSequence, 2);
+        TwiModelStartRequest(&g_Device, &request, (i % 2) == 0);
+        TwiModelRun(&g_Device);
+    }
+
+    ControllerTraceQuery(&g_Device, IOCTL_SUNXII2C_QUERY_TRACE, &trace, sizeof(trace), &traceBytes);
+    ControllerTraceQuery(&g_Device, IOCTL_SUNXII2C_QUERY_HISTOGRAM, &histogram, sizeof(histogram), &histogramBytes);
+
+    for (i = 0; i < trace.Header.RecordCount; i++)
+    {
+        if (pRecords[i].Event == Sunxii2cTraceComplete)
+        {
+            completes++;
+        }
+
+        if (i != 0)
+        {
+            Check(pRecords[i].Sequence == pRecords[i - 1].Sequence + 1,
+                "model", "quiet trace has no gaps");
+        }
+    }
+
+    Check(traceBytes == FIELD_OFFSET(SUNXII2C_TRACE, Records) +
+        trace.Header.RecordCount * sizeof(SUNXII2C_TRACE_RECORD), "model", "trace length");
+    Check(histogramBytes == sizeof(histogram), "model", "histogram length");
+    Check(histogram.TargetCount == 1, "model", "one target");
+    Check(histogram.Targets[0].Transactions == MODEL_REQUESTS, "model", "every request counted");
+    Check(histogram.Targets[0].Errors == MODEL_REQUESTS / 8, "model", "absent slave counted as error");
+    Check(completes > 0, "model", "completions traced");
+
+    printf("model: %lu records, %lu completions, %lu requests in the histogram\n",
+        (unsigned long)trace.Header.RecordCount,
+        (unsigned long)completes,
+        (unsigned long)histogram.Targets[0].Transactions);
+
+    if ((pTracePath != NULL) && (pHistogramPath != NULL))
+    {
+        Check(SaveFile(pTracePath, &trace, traceBytes), "model", "trace saved");
+        Check(SaveFile(pHistogramPath, &histogram, histogramBytes), "model", "histogram saved");
+    }
+}
+
+int
+main(
+    int argc,
+    char *argv[]
+    )
+{
+    TestConcurrentQuery();
+    TestModelDump((argc > 2) ? argv[1] : NULL, (argc > 2) ? argv[2] : NULL);
+
+    if (g_Failures != 0)
+    {
+        printf("%d check(s) failed\n", g_Failures);
+        return 1;
+    }
+
+    printf("all checks passed\n");
+    return 0;
+}
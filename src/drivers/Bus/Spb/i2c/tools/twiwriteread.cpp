@@ -0,0 +1,330 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	twiwriteread.cpp
+
+Abstract:
+
+	Runs write-then-read transactions through the TWI state machines
+	of controller.cpp on the TWI model (twimodel.cpp), once on the ISR
+	driven fast path (ControllerProcessWriteRead) and once on the
+	generic sequence path (ControllerProcessInterrupts), against a
+	slave scripted to:
+
+		answer      register reads of 1 to 32 bytes
+		be absent   the address is not acknowledged
+		NAK data    the second written byte is not acknowledged
+		hold SDA    SDA is stuck low until SCL has been clocked
+		share       an interrupt arrives with an idle or zero status
+
+	Both paths must return the same data and status, the fast path
+	with one DPC per transaction. An interrupt whose status is idle or
+	zero must not be claimed by the fast path nor touch the controller.
+
+	Build and use on any host with a C++ compiler:
+
+		c++ -O2 -I../../../../../tools/host -I.. -o twiwriteread twiwriteread.cpp twimodel.cpp ../controller.cpp -lpthread
+		twiwriteread
+
+Environment:
+
+	user mode
+
+--*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "twimodel.h"
+
+#define SLAVE_ADDRESS           0x14
+#define SLAVE_SPEED             400000
+
+typedef struct _RUN_RESULT
+{
+    NTSTATUS Status;
+    size_t Information;
+    ULONG Completions;
+    ULONG Interrupts;
+    ULONG Dpcs;
+    UCHAR Data[32];
+}RUN_RESULT;
+
+static int g_Failures;
+
+static VOID
+Check(
+    _In_  BOOLEAN bCondition,
+    _In_  const char *pCase,
+    _In_  const char *pWhat
+    )
+{
+    if (!bCondition)
+    {
+        printf("FAIL %s: %s\n", pCase, pWhat);
+        g_Failures++;
+    }
+}
+
+static VOID
+FillSlave(
+    VOID
+    )
+{
+    ULONG i;
+
+    for (i = 0; i < sizeof(g_TwiModel.Slave.Registers); i++)
+    {
+        g_TwiModel.Slave.Registers[i] = (UCHAR)(i * 13 + 5);
+    }
+}
+
+static VOID
+RunWriteRead(
+    _In_  PPBC_DEVICE pDevice,
+    _In_  BOOLEAN bFastPath,
+    _In_  const UCHAR *pWrite,
+    _In_  ULONG WriteLength,
+    _In_  ULONG ReadLength,
+    _Out_ RUN_RESULT *pResult
+    )
+{
+    PBC_REQUEST request;
+    UCHAR write[4];
+
+    memcpy(write, pWrite, WriteLength);
+    memset(pResult, 0, sizeof(*pResult));
+
+    g_TwiModel.Transfers[0].Direction = SpbTransferDirectionToDevice;
+    g_TwiModel.Transfers[0].pBuffer = write;
+    g_TwiModel.Transfers[0].Length = WriteLength;
+    g_TwiModel.Transfers[1].Direction = SpbTransferDirectionFromDevice;
+    g_TwiModel.Transfers[1].pBuffer = pResult->Data;
+    g_TwiModel.Transfers[1].Length = ReadLength;
+
+    TwiModelPrepareRequest(&request, SpbRequestTypeSequence, 2);
+    TwiModelClearCounters();
+
+    TwiModelStartRequest(pDevice, &request, bFastPath);
+    pResult->Interrupts = TwiModelRun(pDevice);
+
+    pResult->Status = g_TwiModel.CompletionStatus;
+    pResult->Information = g_TwiModel.CompletionInformation;
+    pResult->Completions = g_TwiModel.Completions;
+    pResult->Dpcs = g_TwiModel.Dpcs;
+}
+
+static VOID
+TestRegisterReads(
+    VOID
+    )
+{
+    static const ULONG lengths[] = {1, 2, 3, 5, 16, 32};
+    PBC_DEVICE device;
+    PBC_TARGET target;
+    RUN_RESULT fast;
+    RUN_RESULT generic;
+    char name[64];
+    UCHAR reg;
+    ULONG i;
+
+    TwiModelReset(&device, &target, SLAVE_ADDRESS, SLAVE_SPEED);
+    FillSlave();
+
+    for (i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++)
+    {
+        reg = (UCHAR)(0x40 + i * 7);
+        snprintf(name, sizeof(name), "read %lu bytes", (unsigned long)lengths[i]);
+
+        RunWriteRead(&device, TRUE, &reg, 1, lengths[i], &fast);
+        RunWriteRead(&device, FALSE, &reg, 1, lengths[i], &generic);
+
+        Check(fast.Completions == 1, name, "fast path completed once");
+        Check(NT_SUCCESS(fast.Status), name, "fast path succeeded");
+        Check(fast.Information == 1 + lengths[i], name, "fast path reports both halves");
+        Check(memcmp(fast.Data, &g_TwiModel.Slave.Registers[reg], lengths[i]) == 0,
+            name, "fast path data");
+        Check(fast.Dpcs == 1, name, "fast path needs one DPC");
+
+        Check(generic.Completions == 1, name, "generic path completed once");
+        Check(generic.Status == fast.Status, name, "both paths agree on the status");
+        Check(generic.Information == fast.Information, name, "both paths agree on the length");
+        Check(memcmp(generic.Data, fast.Data, lengths[i]) == 0, name, "both paths agree on the data");
+
+        printf("%-16s fast %2lu irq %lu dpc, generic %2lu irq %2lu dpc\n",
+            name,
+            (unsigned long)fast.Interrupts,
+            (unsigned long)fast.Dpcs,
+            (unsigned long)generic.Interrupts,
+            (unsigned long)generic.Dpcs);
+    }
+
+    Check(target.Statistics.WriteReadCount == i, "statistics", "one count per fast transaction");
+    Check(target.Statistics.WriteReadErrors == 0, "statistics", "no errors counted");
+}
+
+static VOID
+TestAbsentSlave(
+    VOID
+    )
+{
+    PBC_DEVICE device;
+    PBC_TARGET target;
+    RUN_RESULT fast;
+    RUN_RESULT generic;
+    UCHAR reg = 0x10;
+
+    TwiModelReset(&device, &target, SLAVE_ADDRESS, SLAVE_SPEED);
+    g_TwiModel.Slave.Address = SLAVE_ADDRESS + 1;
+
+    RunWriteRead(&device, TRUE, &reg, 1, 4, &fast);
+    Check(fast.Completions == 1, "absent", "fast path completed once");
+    Check(fast.Status == STATUS_NO_SUCH_DEVICE, "absent", "fast path reports no such device");
+    Check(fast.Information == 0, "absent", "fast path reports no bytes");
+    Check(target.Statistics.WriteReadErrors == 1, "absent", "error counted");
+    Check(device.bResetPending, "absent", "reset scheduled after the error");
+
+    RunWriteRead(&device, FALSE, &reg, 1, 4, &generic);
+    Check(generic.Completions == 1, "absent", "generic path completed once");
+    Check(generic.Status == STATUS_NO_SUCH_DEVICE, "absent", "generic path reports no such device");
+}
+
+static VOID
+TestDataNak(
+    VOID
+    )
+{
+    PBC_DEVICE device;
+    PBC_TARGET target;
+    RUN_RESULT result;
+    UCHAR write[2] = {0x20, 0x21};
+
+    TwiModelReset(&device, &target, SLAVE_ADDRESS, SLAVE_SPEED);
+    FillSlave();
+    g_TwiModel.Slave.NakAfter = 1;
+
+    RunWriteRead(&device, TRUE, write, 2, 4, &result);
+    Check(result.Completions == 1, "data nak", "completed once");
+    Check(!NT_SUCCESS(result.Status), "data nak", "failed");
+    Check(device.bResetPending, "data nak", "reset scheduled after the error");
+
+    //
+    // The next transaction resets the controller and succeeds.
+    //
+
+    g_TwiModel.Slave.NakAfter = 0;
+    RunWriteRead(&device, TRUE, write, 1, 4, &result);
+    Check(NT_SUCCESS(result.Status), "data nak", "next transaction succeeded");
+    Check(g_TwiModel.Resets == 1, "data nak", "controller reset once");
+    Check(memcmp(result.Data, &g_TwiModel.Slave.Registers[0x20], 4) == 0,
+        "data nak", "next transaction data");
+}
+
+static VOID
+TestStuckBus(
+    VOID
+    )
+{
+    PBC_DEVICE device;
+    PBC_TARGET target;
+    RUN_RESULT result;
+    UCHAR reg = 0x80;
+
+    TwiModelReset(&device, &target, SLAVE_ADDRESS, SLAVE_SPEED);
+    FillSlave();
+    g_TwiModel.Slave.SdaStuckClocks = 3;
+
+    RunWriteRead(&device, TRUE, &reg, 1, 8, &result);
+    Check(result.Completions == 1, "stuck sda", "completed once");
+    Check(NT_SUCCESS(result.Status), "stuck sda", "succeeded after recovery");
+    Check(g_TwiModel.SclClocks == 3, "stuck sda", "three recovery clocks");
+    Check(g_TwiModel.TimerStarts == 1, "stuck sda", "recovery ran from one timer tick");
+    Check(g_TwiModel.StallUs == 3 * 2 * TWI_RECOVERY_HALF_PERIOD_US,
+        "stuck sda", "clocked at 100 kHz");
+    Check(memcmp(result.Data, &g_TwiModel.Slave.Registers[reg], 8) == 0,
+        "stuck sda", "data");
+
+    g_TwiModel.Slave.SdaStuckClocks = 100;
+
+    RunWriteRead(&device, TRUE, &reg, 1, 8, &result);
+    Check(result.Completions == 1, "stuck sda", "hopeless bus completed once");
+    Check(result.Status == STATUS_IO_DEVICE_ERROR, "stuck sda", "hopeless bus failed");
+    Check(g_TwiModel.SclClocks == TWI_RECOVERY_MAX_CLOCKS, "stuck sda", "gave up after nine clocks");
+    Check(g_TwiModel.StallUs <= TWI_RECOVERY_MAX_CLOCKS * 2 * TWI_RECOVERY_HALF_PERIOD_US,
+        "stuck sda", "stalled at most nine periods");
+}
+
+static VOID
+TestSharedInterrupt(
+    VOID
+    )
+{
+    static const ULONG statuses[] = {TWI_STAT_IDLE, TWI_STAT_BUS_ERR};
+    PBC_DEVICE device;
+    PBC_TARGET target;
+    BOOLEAN bQueueDpc;
+    LONG sequence;
+    ULONG i;
+
+    TwiModelReset(&device, &target, SLAVE_ADDRESS, SLAVE_SPEED);
+
+    for (i = 0; i < sizeof(statuses) / sizeof(statuses[0]); i++)
+    {
+        //
+        // A transaction is in flight but the controller
+        // has nothing to report.
+        //
+
+        device.WriteRead.Phase = (i == 0) ? WriteReadWrite : WriteReadRead;
+        g_TwiModel.Stat = statuses[i];
+        sequence = device.Trace.Sequence;
+        TwiModelClearCounters();
+
+        Check(!TwiModelIsr(&device, &bQueueDpc), "shared", "interrupt not claimed");
+        Check(!bQueueDpc, "shared", "no DPC queued");
+        Check(TwiModelMmioWrites() == 0, "shared", "controller not touched");
+        Check(device.Trace.Sequence == sequence, "shared", "nothing traced");
+        Check(device.WriteRead.Phase == ((i == 0) ? WriteReadWrite : WriteReadRead),
+            "shared", "phase unchanged");
+    }
+}
+
+int
+main(
+    VOID
+    )
+{
+    TestRegisterReads();
+    TestAbsentSlave();
+    TestDataNak();
+    TestStuckBus();
+    TestSharedInterrupt();
+
+    if (g_Failures != 0)
+    {
+        printf("%d check(s) failed\n", g_Failures);
+        return 1;
+    }
+
+    printf("all checks passed\n");
+    return 0;
+}
@@ -22,6 +22,7 @@
 
 #ifdef ALLOC_PRAGMA
 #pragma alloc_text(PAGE, HidButtonEvtDevicePrepareHardware)
+#pragma alloc_text(PAGE, HidButtonLoadConfiguration)
 #pragma alloc_text(PAGE, HidButtonEvtDeviceD0Exit)
 #endif
 
@@ -82,9 +83,144 @@ NT status value
 		}
 	}
 
+	if (NT_SUCCESS(status)) {
+		status = HidButtonLoadConfiguration(Device);
+	}
+
 	return status;
 }
 
+static ULONG
+ButtonSampleRate(
+	_In_ ULONG Hz
+)
+{
+	if (Hz >= 250) {
+		return LRADC_SAMPLE_250HZ;
+	}
+	if (Hz >= 125) {
+		return LRADC_SAMPLE_125HZ;
+	}
+	if (Hz >= 62) {
+		return LRADC_SAMPLE_62HZ;
+	}
+	return LRADC_SAMPLE_32HZ;
+}
+
+static ULONG
+ButtonSamplePeriodMs(
+	_In_ ULONG Rate
+)
+{
+	switch (Rate) {
+	case LRADC_SAMPLE_250HZ:
+		return 4;
+	case LRADC_SAMPLE_125HZ:
+		return 8;
+	case LRADC_SAMPLE_62HZ:
+		return 16;
+	default:
+		return 32;
+	}
+}
+
+NTSTATUS
+HidButtonLoadConfiguration(
+	IN WDFDEVICE Device
+)
+/*++
+
+Routine Description:
+
+	Reads the resistor ladder and the LRADC sample rates from the device
+	parameters, falling back to ButtonDefaultLadder and the default rates
+	for anything missing or invalid.
+
+Arguments:
+
+	Device - handle to a device
+
+Return Value:
+
+	NT status value
+
+--*/
+{
+	PDEVICE_EXTENSION pDevice = GetDeviceContext(Device);
+	WDFKEY key = NULL;
+	NTSTATUS status;
+	ULONG activeHz = BUTTON_ACTIVE_RATE_HZ;
+	ULONG idleHz = BUTTON_IDLE_RATE_HZ;
+	ULONG firstDelay = 0;
+	ULONG length = 0;
+	ULONG type = 0;
+	ULONG count = 0;
+	BOOLEAN isValid = FALSE;
+	BUTTON_LADDER_KEY ladder[BUTTON_MAX_KEYS];
+
+	DECLARE_CONST_UNICODE_STRING(ladderName, L"LadderKeys");
+	DECLARE_CONST_UNICODE_STRING(activeName, L"ActiveSampleRate");
+	DECLARE_CONST_UNICODE_STRING(idleName, L"IdleSampleRate");
+	DECLARE_CONST_UNICODE_STRING(delayName, L"FirstConvertDelay");
+
+	PAGED_CODE();
+
+	status = WdfDeviceOpenRegistryKey(Device,
+		PLUGPLAY_REGKEY_DEVICE,
+		KEY_READ,
+		WDF_NO_OBJECT_ATTRIBUTES,
+		&key);
+
+	if (NT_SUCCESS(status)) {
+		WdfRegistryQueryULong(key, &activeName, &activeHz);
+		WdfRegistryQueryULong(key, &idleName, &idleHz);
+		WdfRegistryQueryULong(key, &delayName, &firstDelay);
+
+		status = WdfRegistryQueryValue(key, &ladderName, sizeof(ladder), ladder, &length, &type);
+		if (NT_SUCCESS(status) && type == REG_BINARY &&
+			length != 0 && (length % sizeof(BUTTON_LADDER_KEY)) == 0) {
+
+			count = length / sizeof(BUTTON_LADDER_KEY);
+			isValid = TRUE;
+
+			for (ULONG i = 0; i < count; i++) {
+				if (ladder[i].MaxLevel >= LRADC_DATA_MASK ||
+					(i > 0 && ladder[i].MaxLevel <= ladder[i - 1].MaxLevel) ||
+					(ladder[i].ReportId != REPORT_ID_KEYBOARD && ladder[i].ReportId != REPORT_ID_CONSUMER)) {
+					isValid = FALSE;
+					break;
+				}
+			}
+
+			if (!isValid) {
+				KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "LadderKeys is invalid, using the default ladder\n"));
+			}
+		}
+
+		WdfRegistryClose(key);
+	}
+
+	if (isValid) {
+		RtlCopyMemory(pDevice->Ladder, ladder, count * sizeof(BUTTON_LADDER_KEY));
+		pDevice->LadderCount = count;
+	}
+	else {
+		RtlCopyMemory(pDevice->Ladder, ButtonDefaultLadder, sizeof(ButtonDefaultLadder));
+		pDevice->LadderCount = ARRAYSIZE(ButtonDefaultLadder);
+	}
+
+	if (firstDelay > FIRST_CONVERT_DLY_MAX) {
+		firstDelay = FIRST_CONVERT_DLY_MAX;
+	}
+
+	pDevice->ActiveRate = ButtonSampleRate(activeHz);
+	pDevice->IdleRate = ButtonSampleRate(idleHz);
+	pDevice->ReleaseDelayMs = BUTTON_RELEASE_SAMPLES * ButtonSamplePeriodMs(pDevice->ActiveRate);
+	pDevice->CtrlValue = (firstDelay << FIRST_CONVERT_DLY_SHIFT) | LEVELB_VOL | KEY_MODE_SELECT | LRADC_HOLD_EN | ADC_CHAN_SELECT | LRADC_EN;
+
+	return STATUS_SUCCESS;
+}
+
 NTSTATUS
 HidButtonEvtDeviceD0Entry(
 	IN  WDFDEVICE Device,
@@ -131,18 +267,17 @@ Return Value:
 	NTSTATUS status = STATUS_SUCCESS;
 	ULONG value = 0x0;
 
-	pDevice->KeyCnt = 0;
-	pDevice->KeyVul = 0;
-	pDevice->CompareBuffer[0] = 0;
-	pDevice->CompareBuffer[1] = 0;
-	pDevice->ScanCode = 0;
-	pDevice->TransferCode = INITIAL_VALUE;
-	pDevice->JudgeFlag = 0;
+	pDevice->SampleCount = 0;
+	pDevice->KeyIndex = BUTTON_NO_KEY;
+	pDevice->IsReleasePending = FALSE;
 
 	value = LRADC_ADC0_DOWN_EN | LRADC_ADC0_UP_EN | LRADC_ADC0_DATA_EN;
 	WRITE_REGISTER_ULONG(&pDevice->Registers->LradcIntc,value);
 
-	value = FIRST_CONCERT_DLY | LEVELB_VOL | KEY_MODE_SELECT | LRADC_HOLD_EN | ADC_CHAN_SELECT | LRADC_SAMPLE_250HZ | LRADC_EN;
+	//
+	// Idle until the first press
+	//
+	value = pDevice->CtrlValue | pDevice->IdleRate;
 	WRITE_REGISTER_ULONG(&pDevice->Registers->LradcCtrl, value);
 
 	return status;
@@ -192,13 +327,22 @@ Return Value:
 
 --*/
 {
-	//PDEVICE_EXTENSION         devContext;
-	UNREFERENCED_PARAMETER(Device);
+	PDEVICE_EXTENSION         devContext;
 	UNREFERENCED_PARAMETER(TargetState);
 
 	PAGED_CODE();
 
-	//devContext = GetDeviceContext(Device);
+	devContext = GetDeviceContext(Device);
+
+	//
+	// The interrupt is already disconnected, report a release that was
+	// still waiting for its timer
+	//
+	WdfTimerStop(devContext->ReleaseTimer, TRUE);
+	if (devContext->IsReleasePending) {
+		devContext->IsReleasePending = FALSE;
+		KeyUp(devContext);
+	}
 
 	return STATUS_SUCCESS;
 }
@@ -218,7 +362,11 @@ _In_ BYTE	Vul
 	NTSTATUS status;
 
 	status = WdfIoQueueRetrieveNextRequest(pDevice->InterruptMsgQueue, &request);
-	if (NT_SUCCESS(status)) {
+	if (!NT_SUCCESS(status)) {
+		/* no read pending from hidclass, the report is lost */
+		return;
+	}
+	else {
 
 		bytesToCopy = sizeof(HID_INPUT_REPORT);
 		if (bytesToCopy == 0) {
@@ -232,8 +380,9 @@ _In_ BYTE	Vul
 
 		if (NT_SUCCESS(status)) {
 
+			RtlZeroMemory(inputReport, sizeof(HID_INPUT_REPORT));
 			inputReport->ReportId = Id;
-			inputReport->State |= Vul;
+			inputReport->State = Vul;
 
 		}
 		else {
@@ -248,51 +397,111 @@ exit_bytes:
 
 
 
+static ULONG
+KeyDecode(
+	_In_ PDEVICE_EXTENSION pDevice,
+	_In_ UCHAR Level
+)
+{
+	for (ULONG i = 0; i < pDevice->LadderCount; i++) {
+		if (Level <= pDevice->Ladder[i].MaxLevel) {
+			return i;
+		}
+	}
+
+	return BUTTON_NO_KEY;
+}
+
+static UCHAR
+KeyMedian(
+	_In_ const UCHAR *Levels
+)
+{
+	UCHAR sorted[BUTTON_MEDIAN_SAMPLES];
+	UCHAR value;
+	ULONG i, j;
+
+	for (i = 0; i < BUTTON_MEDIAN_SAMPLES; i++) {
+		value = Levels[i];
+		for (j = i; j > 0 && sorted[j - 1] > value; j--) {
+			sorted[j] = sorted[j - 1];
+		}
+		sorted[j] = value;
+	}
+
+	return sorted[BUTTON_MEDIAN_SAMPLES / 2];
+}
+
 VOID 
 KeyDown(
 	_In_ PDEVICE_EXTENSION pDevice
 )
 {
+	UCHAR level;
+	UCHAR median;
+	UCHAR earlier;
+	ULONG key;
+	PBUTTON_LADDER_KEY down;
+	PBUTTON_LADDER_KEY previous;
+
+	level = (UCHAR)(READ_REGISTER_ULONG(&pDevice->Registers->LradcData0) & LRADC_DATA_MASK);
+
+	/* full scale while the level settles on press and release */
+	if (level == LRADC_DATA_MASK) {
+		pDevice->SampleCount = 0;
+		return;
+	}
 
-	pDevice->KeyVul = READ_REGISTER_ULONG(&pDevice->Registers->LradcData0);
-
-	if (pDevice->KeyVul < 0x3f) {
-		pDevice->CompareBuffer[pDevice->KeyCnt] = pDevice->KeyVul & 0x3f;
+	if (pDevice->SampleCount < BUTTON_SETTLE_SAMPLES) {
+		pDevice->Samples[pDevice->SampleCount] = level;
+		pDevice->SampleCount++;
+	}
+	else {
+		RtlMoveMemory(&pDevice->Samples[0], &pDevice->Samples[1], BUTTON_SETTLE_SAMPLES - 1);
+		pDevice->Samples[BUTTON_SETTLE_SAMPLES - 1] = level;
 	}
 
-	if ((pDevice->KeyCnt + 1) < REPORT_START_NUM) {
-		pDevice->KeyCnt++;
+	if (pDevice->SampleCount < BUTTON_MEDIAN_SAMPLES + 1) {
 		/* do not report key message */
+		return;
+	}
+
+	/* the median of the newest levels and the one a sample earlier */
+	median = KeyMedian(&pDevice->Samples[pDevice->SampleCount - BUTTON_MEDIAN_SAMPLES]);
+	earlier = KeyMedian(&pDevice->Samples[pDevice->SampleCount - BUTTON_MEDIAN_SAMPLES - 1]);
 
+	/* settled: a ramp between two keys moves the median or leaves the newest level behind */
+	key = KeyDecode(pDevice, median);
+	if (key == BUTTON_NO_KEY || key == pDevice->KeyIndex ||
+		key != KeyDecode(pDevice, earlier) || key != KeyDecode(pDevice, level) ||
+		median > earlier + BUTTON_SETTLE_LSB || earlier > median + BUTTON_SETTLE_LSB) {
+		return;
 	}
-	else {
-		if (pDevice->CompareBuffer[0] == pDevice->CompareBuffer[1]) {
-			pDevice->KeyVul = pDevice->CompareBuffer[0];
-			pDevice->ScanCode = keypad_mapindex[pDevice->KeyVul & 0x3f];
-			pDevice->JudgeFlag = 1;
+
+	/* moving from one key to another takes every sample, a release ramp or noise at a boundary do not */
+	if (pDevice->KeyIndex != BUTTON_NO_KEY) {
+		if (pDevice->SampleCount < BUTTON_SETTLE_SAMPLES) {
+			return;
 		}
-		else{
-			pDevice->JudgeFlag = 0;
+
+		for (ULONG i = 0; i < BUTTON_SETTLE_SAMPLES; i++) {
+			if (KeyDecode(pDevice, pDevice->Samples[i]) != key) {
+				return;
+			}
 		}
+	}
 
-		pDevice->KeyCnt = 0;
+	down = &pDevice->Ladder[key];
 
-		if (pDevice->JudgeFlag){
-			if (pDevice->TransferCode == pDevice->ScanCode) {
-			}
-			else if (INITIAL_VALUE != pDevice->TransferCode) {
-				KeyReport(pDevice, REPORT_ID_KEYBOARD, 0);
-				KeyReport(pDevice, REPORT_ID_KEYBOARD, 0x04);
-				pDevice->TransferCode = pDevice->ScanCode;
-			}
-			else {
-				KeyReport(pDevice, REPORT_ID_KEYBOARD, 0x04);
-				pDevice->TransferCode = pDevice->ScanCode;
-			
-			}
+	if (pDevice->KeyIndex != BUTTON_NO_KEY) {
+		previous = &pDevice->Ladder[pDevice->KeyIndex];
+		if (previous->ReportId != down->ReportId) {
+			KeyReport(pDevice, previous->ReportId, 0);
 		}
 	}
 
+	KeyReport(pDevice, down->ReportId, down->State);
+	pDevice->KeyIndex = key;
 }
 
 VOID
@@ -300,18 +509,25 @@ KeyUp(
 _In_ PDEVICE_EXTENSION pDevice
 )
 {
-	if (INITIAL_VALUE != pDevice->TransferCode) {
-		KeyReport(pDevice, REPORT_ID_KEYBOARD, 0);
+	if (BUTTON_NO_KEY != pDevice->KeyIndex) {
+		KeyReport(pDevice, pDevice->Ladder[pDevice->KeyIndex].ReportId, 0);
 	}
 
-	pDevice->KeyCnt = 0;
-	pDevice->JudgeFlag = 0;
-	pDevice->TransferCode = INITIAL_VALUE;
+	pDevice->SampleCount = 0;
+	pDevice->KeyIndex = BUTTON_NO_KEY;
 }
 
+static VOID
+KeyRelease(
+	_In_ PDEVICE_EXTENSION pDevice
+)
+{
+	KeyUp(pDevice);
 
-
-
+	if (pDevice->ActiveRate != pDevice->IdleRate) {
+		WRITE_REGISTER_ULONG(&pDevice->Registers->LradcCtrl, pDevice->CtrlValue | pDevice->IdleRate);
+	}
+}
 
 BOOLEAN
 ButtonInterruptIsr(
@@ -334,15 +550,31 @@ _In_  ULONG        MessageID
 
 	pDevice->RegVul = READ_REGISTER_ULONG(&pDevice->Registers->LradcInts);
 
-	if (pDevice->RegVul & LRADC_ADC0_DOWNPEND)
+	if (pDevice->RegVul & LRADC_ADC0_DOWNPEND) {
 		KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, " key Down!\n"));
 
+		/* back below full scale before the release was reported, the key is still down */
+		pDevice->IsReleasePending = FALSE;
+
+		if (pDevice->ActiveRate != pDevice->IdleRate) {
+			WRITE_REGISTER_ULONG(&pDevice->Registers->LradcCtrl, pDevice->CtrlValue | pDevice->ActiveRate);
+		}
+	}
+
 	if (pDevice->RegVul & LRADC_ADC0_DATAPEND) {
 		KeyDown(pDevice);
 	}
 
 	if (pDevice->RegVul & LRADC_ADC0_UPPEND) {
-		KeyUp(pDevice);
+		if (BUTTON_NO_KEY != pDevice->KeyIndex) {
+			/* ButtonReleaseTimer reports it unless the next press is the same key */
+			pDevice->SampleCount = 0;
+			pDevice->IsReleasePending = TRUE;
+			WdfInterruptQueueDpcForIsr(Interrupt);
+		}
+		else {
+			KeyRelease(pDevice);
+		}
 	}
 
 	WRITE_REGISTER_ULONG(&pDevice->Registers->LradcInts, pDevice->RegVul);
@@ -351,3 +583,37 @@ _In_  ULONG        MessageID
 
 }
 
+VOID
+ButtonInterruptDpc(
+_In_  WDFINTERRUPT Interrupt,
+_In_  WDFOBJECT    AssociatedObject
+)
+{
+	PDEVICE_EXTENSION pDevice;
+
+	UNREFERENCED_PARAMETER(AssociatedObject);
+
+	pDevice = GetDeviceContext(WdfInterruptGetDevice(Interrupt));
+
+	/* every UPPEND starts the wait over */
+	WdfTimerStart(pDevice->ReleaseTimer, WDF_REL_TIMEOUT_IN_MS(pDevice->ReleaseDelayMs));
+}
+
+VOID
+ButtonReleaseTimer(
+_In_  WDFTIMER Timer
+)
+{
+	PDEVICE_EXTENSION pDevice;
+
+	pDevice = GetDeviceContext(WdfTimerGetParentObject(Timer));
+
+	WdfInterruptAcquireLock(pDevice->InterruptObject);
+
+	if (pDevice->IsReleasePending) {
+		pDevice->IsReleasePending = FALSE;
+		KeyRelease(pDevice);
+	}
+
+	WdfInterruptReleaseLock(pDevice->InterruptObject);
+}
@@ -223,7 +223,7 @@ Return Value:
 		WDF_INTERRUPT_CONFIG_INIT(
 			&interruptConfig,
 			ButtonInterruptIsr,
-			NULL);
+			ButtonInterruptDpc);
 
 		interruptConfig.SpinLock = interruptLock;
 
@@ -236,6 +236,22 @@ Return Value:
 			return status;
 		}
 
+		//
+		// Create the timer confirming a release.
+		//
+
+		WDF_TIMER_CONFIG timerConfig;
+
+		WDF_TIMER_CONFIG_INIT(&timerConfig, ButtonReleaseTimer);
+
+		status = WdfTimerCreate(
+			&timerConfig,
+			&attributes,
+			&devContext->ReleaseTimer);
+		if (!NT_SUCCESS(status)) {
+			return status;
+		}
+
 	}
 
     return status;
@@ -27,7 +27,6 @@
 #include <pshpack1.h>
 #include <poppack.h>
 
-#define FIRST_CONCERT_DLY       (0<<24)
 #define CHAN                    (0x3)
 #define ADC_CHAN_SELECT         (CHAN<<22)
 #define LRADC_KEY_MODE          (0)
@@ -40,6 +39,12 @@
 #define LRADC_SAMPLE_62HZ       (2<<2)
 #define LRADC_SAMPLE_125HZ      (1<<2)
 #define LRADC_SAMPLE_250HZ      (0<<2)
+#define LRADC_SAMPLE_MASK       (3<<2)
+
+#define FIRST_CONVERT_DLY_SHIFT (24)
+#define FIRST_CONVERT_DLY_MAX   (0xff)
+
+#define LRADC_DATA_MASK         (0x3f)
 
 
 #define LRADC_EN                (1<<0)
@@ -61,50 +66,85 @@
 #define LRADC_ADC0_DOWNPEND     (1<<1)
 #define LRADC_ADC0_DATAPEND     (1<<0)
 
+/*
+ * Resistor ladder. A key is decoded from the median of the last
+ * BUTTON_MEDIAN_SAMPLES LRADC levels: it is the first entry whose MaxLevel
+ * is not below the median. It is reported once the level has settled, the
+ * median a sample earlier decodes to it too and lies within
+ * BUTTON_SETTLE_LSB, and so does the newest level. While another key is
+ * down all of the last BUTTON_SETTLE_SAMPLES levels have to. A ramp across
+ * the levels of other keys, a spike or noise at a boundary do not settle.
+ * A level of LRADC_DATA_MASK means no key. Two keys pressed together pull
+ * the level to a value of their own, an entry for it with both usage bits
+ * in State reports the simultaneous press.
+ *
+ * Noise can reach full scale while the top key is held, so UPPEND is only
+ * reported once no press followed for BUTTON_RELEASE_SAMPLES periods of the
+ * active sample rate.
+ *
+ * The table can be replaced by the REG_BINARY device parameter "LadderKeys",
+ * an array of BUTTON_LADDER_KEY sorted by MaxLevel. "ActiveSampleRate" and
+ * "IdleSampleRate" (Hz) select the LRADC rate while a key is down and while
+ * idle, "FirstConvertDelay" the samples skipped after a press.
+ */
+#define BUTTON_MAX_KEYS             (16)
+#define BUTTON_MEDIAN_SAMPLES       (3)
+#define BUTTON_SETTLE_SAMPLES       (5)
+#define BUTTON_SETTLE_LSB           (2)
+#define BUTTON_RELEASE_SAMPLES      (3)
+#define BUTTON_NO_KEY               (0xff)
+
+#define BUTTON_ACTIVE_RATE_HZ       (250)
+#define BUTTON_IDLE_RATE_HZ         (32)
+
+typedef struct _BUTTON_LADDER_KEY {
+	UCHAR MaxLevel;
+	UCHAR ReportId;
+	UCHAR State;
+	UCHAR Reserved;
+} BUTTON_LADDER_KEY, *PBUTTON_LADDER_KEY;
+
 #define MODE_0V2
 #ifdef MODE_0V2
 /* standard of key maping
 * 0.2V mode
 */
-#define REPORT_START_NUM            (2)
-#define REPORT_KEY_LOW_LIMIT_COUNT  (1)
-#define MAX_CYCLE_COUNTER           (100)
-//#define REPORT_REPEAT_KEY_BY_INPUT_CORE
-//#define REPORT_REPEAT_KEY_FROM_HW
-#define INITIAL_VALUE               (0Xff)
-
 #define REPORT_ID_KEYBOARD		0x07
 #define REPORT_ID_CONSUMER		0x41
 
-static unsigned char keypad_mapindex[64] = {
-	0, 0, 0, 0, 0, 0, 0, 0,               	/* key 1, 8���� 0-7 */
-	1, 1, 1, 1, 1, 1, 1,                 	/* key 2, 7���� 8-14 */
-	2, 2, 2, 2, 2, 2, 2,                 	/* key 3, 7���� 15-21 */
-	3, 3, 3, 3, 3, 3,                   	/* key 4, 6���� 22-27 */
-	4, 4, 4, 4, 4, 4,                   	/* key 5, 6���� 28-33 */
-	5, 5, 5, 5, 5, 5,                   	/* key 6, 6���� 34-39 */
-	6, 6, 6, 6, 6, 6, 6, 6, 6, 6,           	/* key 7, 10����40-49 */
-	7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7    	/* key 8, 17����50-63 */
+/* key 1-8, levels 0-7, 8-14, 15-21, 22-27, 28-33, 34-39, 40-49, 50-62 */
+static const BUTTON_LADDER_KEY ButtonDefaultLadder[] = {
+	{ 7, REPORT_ID_KEYBOARD, 0x04, 0 },
+	{ 14, REPORT_ID_KEYBOARD, 0x04, 0 },
+	{ 21, REPORT_ID_KEYBOARD, 0x04, 0 },
+	{ 27, REPORT_ID_KEYBOARD, 0x04, 0 },
+	{ 33, REPORT_ID_KEYBOARD, 0x04, 0 },
+	{ 39, REPORT_ID_KEYBOARD, 0x04, 0 },
+	{ 49, REPORT_ID_KEYBOARD, 0x04, 0 },
+	{ 62, REPORT_ID_KEYBOARD, 0x04, 0 },
 };
+
 #endif
 
 #ifdef MODE_0V15
 /* 0.15V mode */
-static unsigned char keypad_mapindex[64] = {
-	0, 0, 0,    			/* key1 */
-	1, 1, 1, 1, 1,                     	/* key2 */
-	2, 2, 2, 2, 2,
-	3, 3, 3, 3,
-	4, 4, 4, 4, 4,
-	5, 5, 5, 5, 5,
-	6, 6, 6, 6, 6,
-	7, 7, 7, 7,
-	8, 8, 8, 8, 8,
-	9, 9, 9, 9, 9,
-	10, 10, 10, 10,
-	11, 11, 11, 11,
-	12, 12, 12, 12, 12, 12, 12, 12, 12, 12  	/*key13 */
+/* key 1-13 */
+static const BUTTON_LADDER_KEY ButtonDefaultLadder[] = {
+	{ 2, REPORT_ID_KEYBOARD, 0x04, 0 },
+	{ 7, REPORT_ID_KEYBOARD, 0x04, 0 },
+	{ 12, REPORT_ID_KEYBOARD, 0x04, 0 },
+	{ 16, REPORT_ID_KEYBOARD, 0x04, 0 },
+	{ 21, REPORT_ID_KEYBOARD, 0x04, 0 },
+	{ 26, REPORT_ID_KEYBOARD, 0x04, 0 },
+	{ 31, REPORT_ID_KEYBOARD, 0x04, 0 },
+	{ 35, REPORT_ID_KEYBOARD, 0x04, 0 },
+	{ 40, REPORT_ID_KEYBOARD, 0x04, 0 },
+	{ 45, REPORT_ID_KEYBOARD, 0x04, 0 },
+	{ 49, REPORT_ID_KEYBOARD, 0x04, 0 },
+	{ 53, REPORT_ID_KEYBOARD, 0x04, 0 },
+	{ 62, REPORT_ID_KEYBOARD, 0x04, 0 },
 };
+
 #endif
 
 #ifdef USE_HARDCODED_HID_REPORT_DESCRIPTOR
@@ -180,6 +220,7 @@ typedef struct _DEVICE_EXTENSION{
 	WDFDEVICE				FxDevice;
 
 	WDFINTERRUPT			InterruptObject;
+	WDFTIMER				ReleaseTimer;
 
 	LARGE_INTEGER			PhysicalBaseAddress;
 	PHID_BUTTON_REGISTERS	Registers;
@@ -190,13 +231,27 @@ typedef struct _DEVICE_EXTENSION{
 	//
 	WDFQUEUE				InterruptMsgQueue;
 
-	ULONG					KeyVul;
-	ULONG					KeyCnt;
 	ULONG					RegVul;
-	ULONG					CompareBuffer[REPORT_START_NUM];
-	ULONG					ScanCode;
-	ULONG					TransferCode;
-	UCHAR					JudgeFlag;
+
+	//
+	// Ladder and LRADC configuration, LradcCtrl is programmed as
+	// CtrlValue with ActiveRate or IdleRate.
+	//
+	BUTTON_LADDER_KEY		Ladder[BUTTON_MAX_KEYS];
+	ULONG					LadderCount;
+	ULONG					CtrlValue;
+	ULONG					ActiveRate;
+	ULONG					IdleRate;
+	ULONG					ReleaseDelayMs;
+
+	//
+	// Last levels, oldest first, the ladder entry reported as down and
+	// whether an UPPEND waits for ReleaseTimer to be reported.
+	//
+	UCHAR					Samples[BUTTON_SETTLE_SAMPLES];
+	ULONG					SampleCount;
+	ULONG					KeyIndex;
+	BOOLEAN					IsReleasePending;
 
 } DEVICE_EXTENSION, *PDEVICE_EXTENSION;
 
@@ -219,6 +274,12 @@ WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(DEVICE_EXTENSION, GetDeviceContext)
 
 EVT_WDF_INTERRUPT_ISR						ButtonInterruptIsr;
 EVT_WDF_INTERRUPT_DPC						ButtonInterruptDpc;
+EVT_WDF_TIMER								ButtonReleaseTimer;
+
+VOID
+KeyUp(
+	_In_ PDEVICE_EXTENSION pDevice
+);
 
 EVT_WDF_IO_QUEUE_IO_INTERNAL_DEVICE_CONTROL HidButtonEvtInternalDeviceControl;
 
@@ -243,6 +304,11 @@ HidButtonGetDeviceAttributes(
 
 EVT_WDF_DEVICE_PREPARE_HARDWARE HidButtonEvtDevicePrepareHardware;
 
+NTSTATUS
+HidButtonLoadConfiguration(
+	IN WDFDEVICE Device
+);
+
 EVT_WDF_DEVICE_D0_ENTRY HidButtonEvtDeviceD0Entry;
 
 EVT_WDF_DEVICE_D0_EXIT HidButtonEvtDeviceD0Exit;
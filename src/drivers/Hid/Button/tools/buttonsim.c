@@ -0,0 +1,960 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	buttonsim.c
+
+Abstract:
+
+	Runs the LRADC key path of button.c (ButtonInterruptIsr, KeyDown,
+	KeyUp) on a model of the A64 LRADC fed with noisy traces of a
+	resistor ladder. The model samples at the rate the driver programs
+	in LRADC_CTRL, raises DOWNPEND once a sample falls below the
+	comparator level, DATAPEND with every sample until the line is back
+	at full scale and then UPPEND.
+
+	Each key press pulls the line from above full scale towards the
+	level of the key through an RC with time constant Tau, the contacts
+	may bounce open for Bounce ms, every sample carries gaussian noise
+	of Sigma LSB and may be hit by a negative spike. The ladder is the
+	"LadderKeys" device parameter below, five keys with usages of their
+	own, and the LRADC idles at 32Hz and samples at 250Hz while a key
+	is down. For every noise profile the simulation reports:
+
+		latency     press to the report of the right key, mean, 99th
+		            percentile and worst
+		false       reports of a key that was not pressed, per 1000
+		            presses, including reports while no key is down
+		missed      presses never reported
+		stuck       presses still down once the line has been idle
+		            for 150ms
+
+	No profile may show more than FALSE_LIMIT false presses per 1000.
+	The profiles up to the spikes must also show no false, missed or
+	stuck presses and a worst latency below LATENCY_LIMIT_MS. The
+	remaining ones go beyond what the ladder is specified for, an RC
+	slower than the sample period or noise of 2 LSB against keys 6 LSB
+	apart, and only report their latency. The interrupt DPC runs once
+	the ISR returns and the release timer at its due time. Three more
+	checks:
+
+		rates       D0Entry idles the LRADC at IdleSampleRate, DOWNPEND
+		            switches to ActiveSampleRate and a release back
+		combo       the level two keys produce together is reported
+		            with both usage bits, the release once
+		release     a single sample at full scale while the top key
+		            is held is no release, a release is reported
+		            within RELEASE_LIMIT_MS
+
+	Build and use on any host with a C compiler:
+
+		cc -O2 -I../../../../tools/host -I.. -o buttonsim buttonsim.c ../button.c -lm
+		buttonsim [-n presses] [-s seed]
+
+Environment:
+
+	user mode
+
+--*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hidbutton.h"
+
+#define STEP_US					100
+#define IDLE_LEVEL				80.0	// the line is above full scale when no key is down
+#define DOWN_LEVEL				60		// comparator level raising DOWNPEND
+#define MAX_REPORTS				16384
+#define MAX_LATENCIES			65536
+#define LATENCY_LIMIT_MS		50
+#define RELEASE_LIMIT_MS		20
+#define FALSE_LIMIT				0.5		// per 1000 presses
+#define DEFAULT_PRESSES			2000
+
+#define KEY_COMBO				0
+#define KEY_COUNT				6
+
+//
+// The ladder under test. Nominal is where the line settles, the
+// ranges are those of LadderKeys.
+//
+static const BUTTON_LADDER_KEY SimLadder[KEY_COUNT] = {
+	{ 3, REPORT_ID_CONSUMER, 0x03, 0 },		// volume up and down together
+	{ 10, REPORT_ID_CONSUMER, 0x01, 0 },
+	{ 22, REPORT_ID_CONSUMER, 0x02, 0 },
+	{ 36, REPORT_ID_KEYBOARD, 0x01, 0 },
+	{ 50, REPORT_ID_KEYBOARD, 0x02, 0 },
+	{ 59, REPORT_ID_KEYBOARD, 0x04, 0 },
+};
+
+static const double SimNominal[KEY_COUNT] = { 1.0, 7.0, 16.0, 29.5, 43.0, 55.0 };
+
+typedef struct _PROFILE
+{
+	const char				*Name;
+	double					Sigma;			// LSB
+	double					TauMs;
+	double					BounceMs;
+	double					SpikeRate;		// per sample
+	BOOLEAN					IsChecked;
+} PROFILE;
+
+static const PROFILE SimProfiles[] = {
+	{ "clean",			0.0, 0.2, 0.0, 0.0, TRUE },
+	{ "noise 0.5",		0.5, 0.2, 0.0, 0.0, TRUE },
+	{ "noise 1",		1.0, 0.2, 0.0, 0.0, TRUE },
+	{ "bounce 5ms",		0.5, 0.2, 5.0, 0.0, TRUE },
+	{ "spikes 1%",		0.5, 0.2, 0.0, 0.01, TRUE },
+	{ "slow rc 6ms",	0.5, 6.0, 0.0, 0.0, FALSE },
+	{ "noise 2",		2.0, 0.2, 0.0, 0.0, FALSE },
+	{ "worst",			1.0, 3.0, 5.0, 0.02, FALSE },
+};
+
+typedef struct _REPORT
+{
+	ULONGLONG				TimeUs;
+	UCHAR					ReportId;
+	UCHAR					State;
+} REPORT;
+
+typedef struct _SIM
+{
+	//
+	// The block handed to the driver, its contents are never used,
+	// only the addresses
+	//
+	HID_BUTTON_REGISTERS	Registers;
+	CM_PARTIAL_RESOURCE_DESCRIPTOR Resource;
+	DEVICE_EXTENSION		Extension;
+
+	ULONG					Ctrl;
+	ULONG					Intc;
+	ULONG					Ints;
+	ULONG					Data0;
+	BOOLEAN					IsDown;
+	ULONGLONG				NextSampleUs;
+	ULONG					CtrlWrites;
+
+	//
+	// The DPC runs once the ISR returns, the release timer at its due
+	// time
+	//
+	BOOLEAN					IsDpcQueued;
+	BOOLEAN					IsTimerSet;
+	ULONGLONG				TimerDueUs;
+
+	ULONG					ActiveHz;
+	ULONG					IdleHz;
+
+	HID_INPUT_REPORT		Buffer;
+	REPORT					Reports[MAX_REPORTS];
+	ULONG					ReportCount;
+
+	ULONGLONG				NowUs;
+	double					Level;			// analog, in LSB
+	ULONGLONG				Random;
+} SIM;
+
+static SIM g_Sim;
+static int g_Failures;
+
+static VOID
+Check(
+	_In_ BOOLEAN Condition,
+	_In_ const char *Case,
+	_In_ const char *What
+)
+{
+	if (!Condition)
+	{
+		printf("FAIL %s: %s\n", Case, What);
+		g_Failures++;
+	}
+}
+
+//
+// ------------------------------------------------------------------ Framework
+//
+
+PVOID
+WdfObjectGetTypedContextWorker(
+	_In_ WDFOBJECT Handle
+)
+{
+	UNREFERENCED_PARAMETER(Handle);
+
+	return &g_Sim.Extension;
+}
+
+WDFDEVICE
+WdfInterruptGetDevice(
+	_In_ WDFINTERRUPT Interrupt
+)
+{
+	UNREFERENCED_PARAMETER(Interrupt);
+
+	return (WDFDEVICE)&g_Sim;
+}
+
+BOOLEAN
+WdfInterruptQueueDpcForIsr(
+	_In_ WDFINTERRUPT Interrupt
+)
+{
+	BOOLEAN isQueued = !g_Sim.IsDpcQueued;
+
+	UNREFERENCED_PARAMETER(Interrupt);
+
+	g_Sim.IsDpcQueued = TRUE;
+
+	return isQueued;
+}
+
+VOID
+WdfInterruptAcquireLock(
+	_In_ WDFINTERRUPT Interrupt
+)
+{
+	UNREFERENCED_PARAMETER(Interrupt);
+}
+
+VOID
+WdfInterruptReleaseLock(
+	_In_ WDFINTERRUPT Interrupt
+)
+{
+	UNREFERENCED_PARAMETER(Interrupt);
+}
+
+BOOLEAN
+WdfTimerStart(
+	_In_ WDFTIMER Timer,
+	_In_ LONGLONG DueTime
+)
+{
+	BOOLEAN wasSet = g_Sim.IsTimerSet;
+
+	UNREFERENCED_PARAMETER(Timer);
+
+	g_Sim.IsTimerSet = TRUE;
+	g_Sim.TimerDueUs = g_Sim.NowUs + (ULONGLONG)(-DueTime / 10);
+
+	return wasSet;
+}
+
+BOOLEAN
+WdfTimerStop(
+	_In_ WDFTIMER Timer,
+	_In_ BOOLEAN Wait
+)
+{
+	BOOLEAN wasSet = g_Sim.IsTimerSet;
+
+	UNREFERENCED_PARAMETER(Timer);
+	UNREFERENCED_PARAMETER(Wait);
+
+	g_Sim.IsTimerSet = FALSE;
+
+	return wasSet;
+}
+
+WDFOBJECT
+WdfTimerGetParentObject(
+	_In_ WDFTIMER Timer
+)
+{
+	UNREFERENCED_PARAMETER(Timer);
+
+	return (WDFOBJECT)&g_Sim;
+}
+
+ULONG
+WdfCmResourceListGetCount(
+	_In_ WDFCMRESLIST List
+)
+{
+	UNREFERENCED_PARAMETER(List);
+
+	return 1;
+}
+
+PCM_PARTIAL_RESOURCE_DESCRIPTOR
+WdfCmResourceListGetDescriptor(
+	_In_ WDFCMRESLIST List,
+	_In_ ULONG Index
+)
+{
+	UNREFERENCED_PARAMETER(List);
+	UNREFERENCED_PARAMETER(Index);
+
+	g_Sim.Resource.Type = CmResourceTypeMemory;
+	g_Sim.Resource.u.Memory.Start.QuadPart = 0x01c21800;
+	g_Sim.Resource.u.Memory.Length = sizeof(HID_BUTTON_REGISTERS);
+
+	return &g_Sim.Resource;
+}
+
+PVOID
+MmMapIoSpace(
+	_In_ PHYSICAL_ADDRESS PhysicalAddress,
+	_In_ SIZE_T NumberOfBytes,
+	_In_ MEMORY_CACHING_TYPE CacheType
+)
+{
+	UNREFERENCED_PARAMETER(PhysicalAddress);
+	UNREFERENCED_PARAMETER(NumberOfBytes);
+	UNREFERENCED_PARAMETER(CacheType);
+
+	return &g_Sim.Registers;
+}
+
+NTSTATUS
+WdfDeviceOpenRegistryKey(
+	_In_ WDFDEVICE Device,
+	_In_ ULONG DeviceInstanceKeyType,
+	_In_ ULONG DesiredAccess,
+	_In_opt_ PWDF_OBJECT_ATTRIBUTES KeyAttributes,
+	_Out_ WDFKEY *Key
+)
+{
+	UNREFERENCED_PARAMETER(Device);
+	UNREFERENCED_PARAMETER(DeviceInstanceKeyType);
+	UNREFERENCED_PARAMETER(DesiredAccess);
+	UNREFERENCED_PARAMETER(KeyAttributes);
+
+	*Key = (WDFKEY)&g_Sim;
+
+	return STATUS_SUCCESS;
+}
+
+static BOOLEAN
+IsValueName(
+	_In_ PCUNICODE_STRING ValueName,
+	_In_ const WCHAR *Name
+)
+{
+	return ValueName->Length == wcslen(Name) * sizeof(WCHAR) &&
+		wcsncmp(ValueName->Buffer, Name, wcslen(Name)) == 0;
+}
+
+NTSTATUS
+WdfRegistryQueryULong(
+	_In_ WDFKEY Key,
+	_In_ PCUNICODE_STRING ValueName,
+	_Out_ PULONG Value
+)
+{
+	UNREFERENCED_PARAMETER(Key);
+
+	if (IsValueName(ValueName, L"ActiveSampleRate"))
+	{
+		*Value = g_Sim.ActiveHz;
+		return STATUS_SUCCESS;
+	}
+
+	if (IsValueName(ValueName, L"IdleSampleRate"))
+	{
+		*Value = g_Sim.IdleHz;
+		return STATUS_SUCCESS;
+	}
+
+	return STATUS_OBJECT_NAME_NOT_FOUND;
+}
+
+NTSTATUS
+WdfRegistryQueryValue(
+	_In_ WDFKEY Key,
+	_In_ PCUNICODE_STRING ValueName,
+	_In_ ULONG ValueLength,
+	_Out_opt_ PVOID Value,
+	_Out_opt_ PULONG ValueLengthQueried,
+	_Out_opt_ PULONG ValueType
+)
+{
+	UNREFERENCED_PARAMETER(Key);
+
+	if (!IsValueName(ValueName, L"LadderKeys"))
+	{
+		return STATUS_OBJECT_NAME_NOT_FOUND;
+	}
+
+	if (ValueLength < sizeof(SimLadder))
+	{
+		return STATUS_BUFFER_TOO_SMALL;
+	}
+
+	memcpy(Value, SimLadder, sizeof(SimLadder));
+	*ValueLengthQueried = sizeof(SimLadder);
+	*ValueType = REG_BINARY;
+
+	return STATUS_SUCCESS;
+}
+
+VOID
+WdfRegistryClose(
+	_In_ WDFKEY Key
+)
+{
+	UNREFERENCED_PARAMETER(Key);
+}
+
+NTSTATUS
+WdfIoQueueRetrieveNextRequest(
+	_In_ WDFQUEUE Queue,
+	_Out_ WDFREQUEST *OutRequest
+)
+{
+	UNREFERENCED_PARAMETER(Queue);
+
+	*OutRequest = (WDFREQUEST)&g_Sim.Buffer;
+
+	return STATUS_SUCCESS;
+}
+
+NTSTATUS
+WdfRequestRetrieveOutputBuffer(
+	_In_ WDFREQUEST Request,
+	_In_ size_t MinimumRequiredSize,
+	_Out_ PVOID *Buffer,
+	_Out_opt_ size_t *Length
+)
+{
+	UNREFERENCED_PARAMETER(Request);
+
+	*Buffer = &g_Sim.Buffer;
+	*Length = MinimumRequiredSize;
+
+	return STATUS_SUCCESS;
+}
+
+VOID
+WdfRequestCompleteWithInformation(
+	_In_ WDFREQUEST Request,
+	_In_ NTSTATUS Status,
+	_In_ ULONG_PTR Information
+)
+{
+	REPORT *report;
+
+	UNREFERENCED_PARAMETER(Request);
+
+	if (!NT_SUCCESS(Status) || Information != sizeof(HID_INPUT_REPORT) ||
+		g_Sim.ReportCount == MAX_REPORTS)
+	{
+		Check(FALSE, "report", "completed with a report");
+		return;
+	}
+
+	report = &g_Sim.Reports[g_Sim.ReportCount++];
+	report->TimeUs = g_Sim.NowUs;
+	report->ReportId = g_Sim.Buffer.ReportId;
+	report->State = g_Sim.Buffer.State;
+}
+
+//
+// ---------------------------------------------------------------------- LRADC
+//
+
+ULONG
+READ_REGISTER_ULONG(
+	_In_ volatile ULONG *Register
+)
+{
+	if (Register == &g_Sim.Registers.LradcCtrl)
+	{
+		return g_Sim.Ctrl;
+	}
+
+	if (Register == &g_Sim.Registers.LradcIntc)
+	{
+		return g_Sim.Intc;
+	}
+
+	if (Register == &g_Sim.Registers.LradcInts)
+	{
+		return g_Sim.Ints;
+	}
+
+	if (Register == &g_Sim.Registers.LradcData0)
+	{
+		return g_Sim.Data0;
+	}
+
+	return 0;
+}
+
+VOID
+WRITE_REGISTER_ULONG(
+	_In_ volatile ULONG *Register,
+	_In_ ULONG Value
+)
+{
+	if (Register == &g_Sim.Registers.LradcCtrl)
+	{
+		g_Sim.Ctrl = Value;
+		g_Sim.CtrlWrites++;
+	}
+	else if (Register == &g_Sim.Registers.LradcIntc)
+	{
+		g_Sim.Intc = Value;
+	}
+	else if (Register == &g_Sim.Registers.LradcInts)
+	{
+		g_Sim.Ints &= ~Value;
+	}
+}
+
+static ULONG
+SimSampleHz(
+	VOID
+)
+{
+	switch (g_Sim.Ctrl & LRADC_SAMPLE_MASK)
+	{
+	case LRADC_SAMPLE_250HZ:
+		return 250;
+	case LRADC_SAMPLE_125HZ:
+		return 125;
+	case LRADC_SAMPLE_62HZ:
+		return 62;
+	default:
+		return 32;
+	}
+}
+
+static double
+SimUniform(
+	VOID
+)
+{
+	g_Sim.Random ^= g_Sim.Random << 13;
+	g_Sim.Random ^= g_Sim.Random >> 7;
+	g_Sim.Random ^= g_Sim.Random << 17;
+
+	return (g_Sim.Random >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double
+SimGaussian(
+	VOID
+)
+{
+	double u1 = SimUniform();
+	double u2 = SimUniform();
+
+	return sqrt(-2.0 * log(u1 + 1e-300)) * cos(2.0 * M_PI * u2);
+}
+
+static VOID
+SimSample(
+	_In_ const PROFILE *Profile
+)
+/*++
+
+Routine Description:
+
+	Converts the line once and raises the interrupts the LRADC would.
+
+--*/
+{
+	double value = g_Sim.Level + Profile->Sigma * SimGaussian();
+	LONG level;
+
+	if (Profile->SpikeRate != 0 && SimUniform() < Profile->SpikeRate)
+	{
+		value -= 10 + 50 * SimUniform();
+	}
+
+	level = (LONG)floor(value + 0.5);
+	level = (level < 0) ? 0 : (level > LRADC_DATA_MASK) ? LRADC_DATA_MASK : level;
+
+	if (!g_Sim.IsDown && level < DOWN_LEVEL)
+	{
+		g_Sim.IsDown = TRUE;
+		g_Sim.Ints |= LRADC_ADC0_DOWNPEND;
+	}
+
+	if (g_Sim.IsDown)
+	{
+		if (level == LRADC_DATA_MASK)
+		{
+			g_Sim.IsDown = FALSE;
+			g_Sim.Ints |= LRADC_ADC0_UPPEND;
+		}
+		else
+		{
+			g_Sim.Data0 = (ULONG)level;
+			g_Sim.Ints |= LRADC_ADC0_DATAPEND;
+		}
+	}
+
+	if ((g_Sim.Ints & g_Sim.Intc) != 0)
+	{
+		ButtonInterruptIsr(NULL, 0);
+	}
+
+	if (g_Sim.IsDpcQueued)
+	{
+		g_Sim.IsDpcQueued = FALSE;
+		ButtonInterruptDpc(NULL, NULL);
+	}
+}
+
+static VOID
+SimRun(
+	_In_ const PROFILE *Profile,
+	_In_ ULONGLONG DurationUs,
+	_In_ double Target,
+	_In_ BOOLEAN IsBouncing
+)
+/*++
+
+Routine Description:
+
+	Moves the line towards Target for DurationUs, or towards the idle
+	level while a bouncing contact is open, sampling as the LRADC is
+	programmed.
+
+--*/
+{
+	ULONGLONG endUs = g_Sim.NowUs + DurationUs;
+	double alpha = 1.0 - exp(-(double)STEP_US / (Profile->TauMs * 1000.0));
+	double target;
+	BOOLEAN isOpen = FALSE;
+
+	while (g_Sim.NowUs < endUs)
+	{
+		if (IsBouncing && SimUniform() < 0.3)
+		{
+			isOpen = !isOpen;
+		}
+
+		target = isOpen ? IDLE_LEVEL : Target;
+		g_Sim.Level += (target - g_Sim.Level) * alpha;
+		g_Sim.NowUs += STEP_US;
+
+		if (g_Sim.IsTimerSet && g_Sim.NowUs >= g_Sim.TimerDueUs)
+		{
+			g_Sim.IsTimerSet = FALSE;
+			ButtonReleaseTimer(NULL);
+		}
+
+		if (g_Sim.NowUs >= g_Sim.NextSampleUs)
+		{
+			SimSample(Profile);
+			g_Sim.NextSampleUs += 1000000 / SimSampleHz();
+		}
+	}
+}
+
+static VOID
+SimReset(
+	_In_ ULONGLONG Seed
+)
+{
+	NTSTATUS status;
+
+	memset(&g_Sim, 0, sizeof(g_Sim));
+	g_Sim.Random = Seed * 2654435761ULL + 1;
+	g_Sim.Level = IDLE_LEVEL;
+	g_Sim.ActiveHz = BUTTON_ACTIVE_RATE_HZ;
+	g_Sim.IdleHz = BUTTON_IDLE_RATE_HZ;
+
+	status = HidButtonEvtDevicePrepareHardware((WDFDEVICE)&g_Sim, NULL, NULL);
+	if (NT_SUCCESS(status))
+	{
+		status = HidButtonEvtDeviceD0Entry((WDFDEVICE)&g_Sim, WdfPowerDeviceD3Final);
+	}
+
+	Check(NT_SUCCESS(status), "setup", "device started");
+	Check(g_Sim.Extension.LadderCount == KEY_COUNT, "setup", "LadderKeys loaded");
+}
+
+//
+// ----------------------------------------------------------------- Profiles
+//
+
+static int
+CompareDouble(
+	_In_ const void *A,
+	_In_ const void *B
+)
+{
+	double a = *(const double *)A;
+	double b = *(const double *)B;
+
+	return (a > b) - (a < b);
+}
+
+static VOID
+RunProfile(
+	_In_ const PROFILE *Profile,
+	_In_ ULONG Presses,
+	_In_ ULONGLONG Seed
+)
+{
+	static double latencies[MAX_LATENCIES];
+	const BUTTON_LADDER_KEY *key;
+	ULONGLONG pressUs;
+	ULONGLONG holdUs;
+	ULONGLONG bounceUs = (ULONGLONG)(Profile->BounceMs * 1000);
+	ULONG found = 0;
+	ULONG falses = 0;
+	ULONG missed = 0;
+	ULONG stuck = 0;
+	ULONG downs;
+	double sum = 0;
+	ULONG index;
+	ULONG p;
+	ULONG r;
+
+	SimReset(Seed);
+	SimRun(Profile, 200000, IDLE_LEVEL, FALSE);
+
+	for (p = 0; p < Presses; p++)
+	{
+		index = 1 + (ULONG)(SimUniform() * (KEY_COUNT - 1));
+		key = &SimLadder[index];
+		holdUs = 60000 + (ULONGLONG)(340000 * SimUniform());
+		g_Sim.ReportCount = 0;
+		pressUs = g_Sim.NowUs;
+
+		if (bounceUs != 0)
+		{
+			SimRun(Profile, bounceUs, SimNominal[index], TRUE);
+		}
+
+		SimRun(Profile, holdUs - bounceUs, SimNominal[index], FALSE);
+
+		if (bounceUs != 0)
+		{
+			SimRun(Profile, bounceUs, SimNominal[index], TRUE);
+		}
+
+		SimRun(Profile, 150000 + (ULONGLONG)(650000 * SimUniform()), IDLE_LEVEL, FALSE);
+
+		//
+		// Everything up to the next press belongs to this one
+		//
+		downs = 0;
+
+		for (r = 0; r < g_Sim.ReportCount; r++)
+		{
+			const REPORT *report = &g_Sim.Reports[r];
+
+			if (report->State == 0)
+			{
+				continue;
+			}
+
+			if (report->ReportId != key->ReportId || report->State != key->State || downs != 0)
+			{
+				falses++;
+			}
+			else
+			{
+				downs++;
+
+				if (found < MAX_LATENCIES)
+				{
+					latencies[found] = (report->TimeUs - pressUs) / 1000.0;
+					sum += latencies[found];
+					found++;
+				}
+			}
+		}
+
+		missed += (downs == 0);
+		stuck += (g_Sim.Extension.KeyIndex != BUTTON_NO_KEY);
+	}
+
+	qsort(latencies, found, sizeof(latencies[0]), CompareDouble);
+
+	printf("%-12s %5lu presses  latency %5.1f %5.1f %5.1f ms  false %7.2f/1000  missed %4lu  stuck %4lu\n",
+		Profile->Name,
+		(unsigned long)Presses,
+		found ? sum / found : 0.0,
+		found ? latencies[(found * 99) / 100] : 0.0,
+		found ? latencies[found - 1] : 0.0,
+		falses * 1000.0 / Presses,
+		(unsigned long)missed,
+		(unsigned long)stuck);
+
+	Check(falses * 1000.0 / Presses <= FALSE_LIMIT, Profile->Name, "false presses within FALSE_LIMIT");
+
+	if (Profile->IsChecked)
+	{
+		Check(falses == 0, Profile->Name, "no false presses");
+		Check(missed == 0, Profile->Name, "no missed presses");
+		Check(stuck == 0, Profile->Name, "every release reported");
+		Check(found != 0 && latencies[found - 1] <= LATENCY_LIMIT_MS, Profile->Name,
+			"worst latency below LATENCY_LIMIT_MS");
+	}
+}
+
+//
+// ---------------------------------------------------------------------- Cases
+//
+
+static VOID
+TestRates(
+	VOID
+)
+{
+	const PROFILE *clean = &SimProfiles[0];
+	ULONG writes;
+
+	SimReset(1);
+	Check((g_Sim.Ctrl & LRADC_EN) != 0, "rates", "LRADC enabled");
+	Check(SimSampleHz() == BUTTON_IDLE_RATE_HZ, "rates", "idle rate after D0Entry");
+
+	SimRun(clean, 100000, SimNominal[3], FALSE);
+	Check(SimSampleHz() == BUTTON_ACTIVE_RATE_HZ, "rates", "active rate while down");
+
+	SimRun(clean, 200000, IDLE_LEVEL, FALSE);
+	Check(SimSampleHz() == BUTTON_IDLE_RATE_HZ, "rates", "idle rate after release");
+	Check(g_Sim.ReportCount == 2, "rates", "one press and one release");
+
+	//
+	// With both rates the same the control register is left alone
+	//
+	memset(&g_Sim, 0, sizeof(g_Sim));
+	g_Sim.Random = 1;
+	g_Sim.Level = IDLE_LEVEL;
+	g_Sim.ActiveHz = 125;
+	g_Sim.IdleHz = 125;
+	HidButtonEvtDevicePrepareHardware((WDFDEVICE)&g_Sim, NULL, NULL);
+	HidButtonEvtDeviceD0Entry((WDFDEVICE)&g_Sim, WdfPowerDeviceD3Final);
+	writes = g_Sim.CtrlWrites;
+
+	SimRun(clean, 100000, SimNominal[3], FALSE);
+	SimRun(clean, 200000, IDLE_LEVEL, FALSE);
+	Check(SimSampleHz() == 125, "rates", "fixed rate");
+	Check(g_Sim.CtrlWrites == writes, "rates", "fixed rate not reprogrammed");
+}
+
+static VOID
+TestCombo(
+	VOID
+)
+{
+	const PROFILE *clean = &SimProfiles[0];
+	static const UCHAR expected[][2] = {
+		{ REPORT_ID_CONSUMER, 0x01 },
+		{ REPORT_ID_CONSUMER, 0x03 },
+		{ REPORT_ID_CONSUMER, 0x01 },
+		{ REPORT_ID_CONSUMER, 0x00 },
+	};
+	BOOLEAN isExpected = TRUE;
+	ULONG i;
+
+	SimReset(2);
+	SimRun(clean, 50000, SimNominal[1], FALSE);
+	SimRun(clean, 100000, SimNominal[KEY_COMBO], FALSE);
+	SimRun(clean, 50000, SimNominal[1], FALSE);
+	SimRun(clean, 100000, IDLE_LEVEL, FALSE);
+
+	Check(g_Sim.ReportCount == ARRAYSIZE(expected), "combo", "report count");
+
+	for (i = 0; i < ARRAYSIZE(expected) && i < g_Sim.ReportCount; i++)
+	{
+		isExpected = isExpected &&
+			g_Sim.Reports[i].ReportId == expected[i][0] &&
+			g_Sim.Reports[i].State == expected[i][1];
+	}
+
+	Check(isExpected, "combo", "volume up, both, volume up, release");
+}
+
+static VOID
+TestRelease(
+	VOID
+)
+{
+	const PROFILE *clean = &SimProfiles[0];
+	ULONGLONG releaseUs;
+
+	SimReset(3);
+	SimRun(clean, 100000, SimNominal[KEY_COUNT - 1], FALSE);
+	Check(g_Sim.ReportCount == 1, "release", "top key pressed");
+
+	//
+	// Long enough for one or two samples at full scale, shorter than
+	// the release timer
+	//
+	SimRun(clean, 6000, IDLE_LEVEL, FALSE);
+	SimRun(clean, 100000, SimNominal[KEY_COUNT - 1], FALSE);
+	Check(g_Sim.ReportCount == 1, "release", "a glitch to full scale is no release");
+	Check(SimSampleHz() == BUTTON_ACTIVE_RATE_HZ, "release", "active rate while down");
+
+	releaseUs = g_Sim.NowUs;
+	SimRun(clean, 200000, IDLE_LEVEL, FALSE);
+	Check(g_Sim.ReportCount == 2 && g_Sim.Reports[1].State == 0, "release", "released once");
+	Check(g_Sim.ReportCount == 2 && g_Sim.Reports[1].TimeUs - releaseUs <= RELEASE_LIMIT_MS * 1000,
+		"release", "release within RELEASE_LIMIT_MS");
+	Check(SimSampleHz() == BUTTON_IDLE_RATE_HZ, "release", "idle rate after release");
+}
+
+int
+main(
+	int argc,
+	char **argv
+)
+{
+	ULONG presses = DEFAULT_PRESSES;
+	ULONGLONG seed = 1;
+	ULONG i;
+	int a;
+
+	for (a = 1; a + 1 < argc; a += 2)
+	{
+		if (strcmp(argv[a], "-n") == 0)
+		{
+			presses = (ULONG)strtoul(argv[a + 1], NULL, 0);
+		}
+		else if (strcmp(argv[a], "-s") == 0)
+		{
+			seed = strtoull(argv[a + 1], NULL, 0);
+		}
+	}
+
+	TestRates();
+	TestCombo();
+	TestRelease();
+
+	printf("profile                    latency  mean   p99 worst\n");
+
+	for (i = 0; i < ARRAYSIZE(SimProfiles); i++)
+	{
+		RunProfile(&SimProfiles[i], presses, seed + i);
+	}
+
+	if (g_Failures != 0)
+	{
+		printf("%d check(s) failed\n", g_Failures);
+		return 1;
+	}
+
+	printf("all checks passed\n");
+	return 0;
+}
@@ -113,6 +113,7 @@ NTSTATUS
 	WDF_OBJECT_ATTRIBUTES         attributes;
 	WDF_OBJECT_ATTRIBUTES         LockAttributes;
 	WDF_PNPPOWER_EVENT_CALLBACKS  pnpPowerCallbacks;
+	WDF_TIMER_CONFIG              timerConfig;
 
 	UNREFERENCED_PARAMETER(Driver);
 
@@ -210,6 +211,24 @@ NTSTATUS
 		return status;
 	}
 
+	//
+	// Passive level one shot timer that puts the panel in monitor mode,
+	// it talks to the panel under the interrupt lock.
+	//
+	TouchActivityInitialize(&devContext->Activity, 0);
+
+	WDF_TIMER_CONFIG_INIT(&timerConfig, OnDozeTimer);
+	timerConfig.AutomaticSerialization = FALSE;
+	WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+	attributes.ParentObject = hDevice;
+	attributes.ExecutionLevel = WdfExecutionLevelPassive;
+
+	status = WdfTimerCreate(&timerConfig, &attributes, &devContext->DozeTimer);
+	if (!NT_SUCCESS(status)) {
+		KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "line:%d WdfTimerCreate fail\n", __LINE__));
+		return status;
+	}
+
 	return status;
 }
 
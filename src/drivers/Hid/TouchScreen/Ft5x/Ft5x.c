@@ -204,75 +204,18 @@ Return Value:
 --*/
 
 {
-	NTSTATUS					Status;
-	WDFMEMORY					Memory;
-	WDFREQUEST					IoctlRequest;
-	WDF_OBJECT_ATTRIBUTES		Attributes;
-	WDF_REQUEST_SEND_OPTIONS	SendOptions;
-	WDF_OBJECT_ATTRIBUTES		RequestAttributes;
-
-
-	IoctlRequest = NULL;
-	Memory = WDF_NO_HANDLE;
-
-	WDF_OBJECT_ATTRIBUTES_INIT(&RequestAttributes);
-	Status = WdfRequestCreate(&RequestAttributes, pDevice->SpbController, &IoctlRequest);
-	if (!NT_SUCCESS(Status)) {
-		goto Done;
-	}
+	NTSTATUS Status;
 
 	if (InBuffer == NULL) {
 		return STATUS_UNSUCCESSFUL;
 	}
 
-	NT_ASSERT(Memory == WDF_NO_HANDLE);
-
-	WDF_OBJECT_ATTRIBUTES_INIT(&Attributes);
-	Attributes.ParentObject = IoctlRequest;
-	Status = WdfMemoryCreatePreallocated(
-		&Attributes,
-		InBuffer,
-		InBufferlength,
-		&Memory);
-
-	if (!NT_SUCCESS(Status)) {
-		goto Done;
-	}
-
-	Status = WdfIoTargetFormatRequestForWrite(
-		pDevice->SpbController,
-		IoctlRequest,
-		Memory,
-		NULL,
-		NULL
-		);
+	Status = SpbClientWrite(&pDevice->SpbClient, InBuffer, InBufferlength);
 
 	if (!NT_SUCCESS(Status)) {
-		return Status;
+		KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "ft5x: SpbRequestWrite fail!\n"));
 	}
 
-	WDF_REQUEST_SEND_OPTIONS_INIT(&SendOptions,
-		WDF_REQUEST_SEND_OPTION_SYNCHRONOUS);
-
-	WDF_REQUEST_SEND_OPTIONS_SET_TIMEOUT(&SendOptions,
-		WDF_REL_TIMEOUT_IN_SEC(60));
-
-	Status = WdfRequestAllocateTimer(IoctlRequest);
-	if (!NT_SUCCESS(Status)) {
-		goto Done;
-	}
-
-	if (!WdfRequestSend(IoctlRequest, pDevice->SpbController, &SendOptions)) {
-		Status = WdfRequestGetStatus(IoctlRequest);
-	}
-
-	if (!NT_SUCCESS(Status)) {
-	}
-
-Done:
-	if (IoctlRequest != NULL) {
-		WdfObjectDelete(IoctlRequest);
-	}
 	return Status;
 }
 
@@ -298,80 +241,18 @@ Return Value:
 
 --*/
 {
-	NTSTATUS					Status;
-	WDFMEMORY					Memory;
-	WDFREQUEST					IoctlRequest;
-	WDF_OBJECT_ATTRIBUTES		Attributes;
-	WDF_REQUEST_SEND_OPTIONS	SendOptions;
-	WDF_OBJECT_ATTRIBUTES		RequestAttributes;
-
-	IoctlRequest = NULL;
-	Memory = WDF_NO_HANDLE;
-
-	WDF_OBJECT_ATTRIBUTES_INIT(&RequestAttributes);
-	Status = WdfRequestCreate(&RequestAttributes, pDevice->SpbController, &IoctlRequest);
-	if (!NT_SUCCESS(Status)) {
-		goto Done;
-	}
+	NTSTATUS Status;
 
 	if (OutBuffer == NULL) {
 		return STATUS_UNSUCCESSFUL;
 	}
 
-	//
-	// Create preallocated WDFMEMORY. The IOCTL is METHOD_BUFFERED,
-	// so the memory doesn't have to persist until the request is
-	// completed.
-	//
-
-	NT_ASSERT(Memory == WDF_NO_HANDLE);
-
-	WDF_OBJECT_ATTRIBUTES_INIT(&Attributes);
-	Attributes.ParentObject = IoctlRequest;
-	Status = WdfMemoryCreatePreallocated(
-		&Attributes,
-		OutBuffer,
-		OutBufferlength,
-		&Memory);
-
-	if (!NT_SUCCESS(Status)) {
-		goto Done;
-	}
-
-	Status = WdfIoTargetFormatRequestForRead(
-		pDevice->SpbController,
-		IoctlRequest,
-		Memory,
-		NULL,
-		NULL
-		);
+	Status = SpbClientRead(&pDevice->SpbClient, OutBuffer, OutBufferlength, NULL);
 
 	if (!NT_SUCCESS(Status)) {
-		goto Done;
+		KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "ft5x: SpbRequestRead fail!\n"));
 	}
 
-	WDF_REQUEST_SEND_OPTIONS_INIT(&SendOptions,
-		WDF_REQUEST_SEND_OPTION_SYNCHRONOUS);
-
-	WDF_REQUEST_SEND_OPTIONS_SET_TIMEOUT(&SendOptions,
-		WDF_REL_TIMEOUT_IN_SEC(60));
-
-	Status = WdfRequestAllocateTimer(IoctlRequest);
-	if (!NT_SUCCESS(Status)) {
-		goto Done;
-	}
-
-	if (!WdfRequestSend(IoctlRequest, pDevice->SpbController, &SendOptions)) {
-		Status = WdfRequestGetStatus(IoctlRequest);
-	}
-
-	if (!NT_SUCCESS(Status)) {
-	}
-
-Done:
-	if (IoctlRequest != NULL) {
-		WdfObjectDelete(IoctlRequest);
-	}
 	return Status;
 }
 
@@ -401,116 +282,23 @@ Return Value:
 
 --*/
 {
-	NTSTATUS					Status;
-	WDFMEMORY					Memory;
-	WDFREQUEST					IoctlRequest;
-	WDF_OBJECT_ATTRIBUTES		Attributes;
-	WDF_REQUEST_SEND_OPTIONS	SendOptions;
-	WDF_OBJECT_ATTRIBUTES		RequestAttributes;
-
-	IoctlRequest = NULL;
-	Memory = WDF_NO_HANDLE;
-
-	WDF_OBJECT_ATTRIBUTES_INIT(&RequestAttributes);
-	Status = WdfRequestCreate(&RequestAttributes, pDevice->SpbController, &IoctlRequest);
-	if (!NT_SUCCESS(Status)) {
-		goto Done;
-	}
-
+	NTSTATUS Status;
 
 	if ((InBuffer == NULL) || (OutBuffer == NULL)) {
 		return STATUS_UNSUCCESSFUL;
 	}
 
 	//
-	// Build SPB sequence.
-	//
-
-	const ULONG transfers = 2;
-
-	SPB_TRANSFER_LIST_AND_ENTRIES(2) seq;
-	SPB_TRANSFER_LIST_INIT(&(seq.List), transfers);
-
-	{
-		//
-		// PreFAST cannot figure out the SPB_TRANSFER_LIST_ENTRY
-		// "struct hack" size but using an index variable quiets 
-		// the warning. This is a false positive from OACR.
-		// 
-
-		ULONG index = 0;
-		seq.List.Transfers[index] = SPB_TRANSFER_LIST_ENTRY_INIT_SIMPLE(
-			SpbTransferDirectionToDevice,
-			0,
-			InBuffer,
-			InBufferlength);
-
-		seq.List.Transfers[index + 1] = SPB_TRANSFER_LIST_ENTRY_INIT_SIMPLE(
-			SpbTransferDirectionFromDevice,
-			0,
-			OutBuffer,
-			OutBufferlength);
-	}
-
-	//
-	// Create preallocated WDFMEMORY. The IOCTL is METHOD_BUFFERED,
-	// so the memory doesn't have to persist until the request is
-	// completed.
+	// Both transfers go out as one SPB sequence on the preallocated
+	// request, so the controller issues a repeated start between them.
 	//
 
-	NT_ASSERT(Memory == WDF_NO_HANDLE);
-
-	WDF_OBJECT_ATTRIBUTES_INIT(&Attributes);
-	Attributes.ParentObject = IoctlRequest;
-	Status = WdfMemoryCreatePreallocated(
-		&Attributes,
-		(PVOID) &seq,
-		sizeof(seq),
-		&Memory);
+	Status = SpbClientWriteRead(&pDevice->SpbClient, InBuffer, InBufferlength, OutBuffer, OutBufferlength);
 
 	if (!NT_SUCCESS(Status)) {
-		goto Done;
+		KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "ft5x: SpbRequestWriteRead fail!\n"));
 	}
 
-	//
-	// Format and send the SPB sequence request.
-	//
-
-	Status = WdfIoTargetFormatRequestForIoctl(
-		pDevice->SpbController,
-		IoctlRequest,
-		IOCTL_SPB_EXECUTE_SEQUENCE,
-		Memory,
-		NULL,
-		NULL,
-		NULL);
-
-	if (!NT_SUCCESS(Status)) {
-		goto Done;
-	}
-
-	WDF_REQUEST_SEND_OPTIONS_INIT(&SendOptions,
-		WDF_REQUEST_SEND_OPTION_SYNCHRONOUS);
-
-	WDF_REQUEST_SEND_OPTIONS_SET_TIMEOUT(&SendOptions,
-		WDF_REL_TIMEOUT_IN_SEC(60));
-
-	Status = WdfRequestAllocateTimer(IoctlRequest);
-	if (!NT_SUCCESS(Status)) {
-		goto Done;
-	}
-
-	if (!WdfRequestSend(IoctlRequest, pDevice->SpbController, &SendOptions)) {
-		Status = WdfRequestGetStatus(IoctlRequest);
-	}
-
-	if (!NT_SUCCESS(Status)) {
-	}
-
-Done:
-	if (IoctlRequest != NULL) {
-		WdfObjectDelete(IoctlRequest);
-	}
 	return Status;
 }
 
@@ -820,6 +608,34 @@ Arguments:
 
 }
 
+NTSTATUS
+CtpSetDoze(
+	_In_ PDEVICE_EXTENSION pDevice,
+	_In_ BOOLEAN Doze
+)
+/*++
+
+Routine Description:
+	Switch the panel between active and monitor mode
+
+Arguments:
+	pDevice - handle to the device extension.
+	Doze - TRUE for monitor mode.
+
+Return Value:
+	NT status value
+
+--*/
+{
+	UCHAR InputBuffer[2] = { FT5X_PMODE_REG, FT5X_PMODE_ACTIVE };
+
+	if (Doze) {
+		InputBuffer[1] = FT5X_PMODE_MONITOR;
+	}
+
+	return SpbRequestWrite(pDevice, InputBuffer, sizeof(InputBuffer));
+}
+
 NTSTATUS
 SpbPeripheralOpen(
 	_In_  PDEVICE_EXTENSION pDevice
@@ -874,6 +690,19 @@ Return Value:
 	if (!NT_SUCCESS(status))
 	{
 		KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "*****open fail! line:%d*****\n", __LINE__));
+		return status;
+	}
+
+	//
+	// Preallocate the request reused for every transfer to the panel.
+	//
+
+	status = SpbClientInitialize(&pDevice->SpbClient, pDevice->SpbController);
+
+	if (!NT_SUCCESS(status))
+	{
+		KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "*****spb client fail! line:%d*****\n", __LINE__));
+		WdfIoTargetClose(pDevice->SpbController);
 	}
 
 	return status;
@@ -902,6 +731,7 @@ Return Value:
 	KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "*****close handle to SPB target:%d*****\n", __LINE__));
 
 	WdfIoTargetClose(pDevice->SpbController);
+	SpbClientCleanup(&pDevice->SpbClient);
 
 	return STATUS_SUCCESS;
 }
@@ -972,6 +802,8 @@ NTSTATUS
 	pDevice->Report = 0;
 	pDevice->DataReady = FALSE;
 	pDevice->ReportTime = 0;
+	TouchTrackerInitialize(&pDevice->Tracker, 0x01, FT5X_MAX_CONTACTS);
+	TouchTrackerReadFilterConfig(pDevice->FxDevice, &pDevice->Tracker);
 	RtlZeroMemory(pDevice->Data, sizeof(pDevice->Data));
 
 	SetWakeupHigh(pDevice, 20); //Wakeup pin down up after 20 ms
@@ -980,6 +812,16 @@ NTSTATUS
 
 	ReadChipId(pDevice);
 
+	//
+	// The panel starts active, the timer puts it in monitor mode once it
+	// was quiet for DozeQuietMs.
+	//
+	TouchActivityReadConfig(pDevice->FxDevice, &pDevice->Activity);
+	TouchActivityStart(&pDevice->Activity, (ULONG)(TouchTimeUs() / 1000));
+	if (pDevice->Interrupt != NULL && pDevice->Activity.QuietMs != 0) {
+		WdfTimerStart(pDevice->DozeTimer, WDF_REL_TIMEOUT_IN_MS(pDevice->Activity.QuietMs));
+	}
+
 	return status;
 }
 
@@ -1034,228 +876,91 @@ Return Value:
 
 	devContext = GetDeviceContext(Device);
 
-	SpbPeripheralClose(devContext);
-
-	return STATUS_SUCCESS;
-}
-
-VOID ProcessCtpDataUp(
-	_In_ PDEVICE_EXTENSION pDevice
-	)
-	// Processing the data up
-{
-
-
-	PHIDFX2_INPUT_REPORT inputReport = NULL;
-	ULONG				 bytesToCopy = 0;
-	size_t				 bytesReturned = 0;
-	WDFREQUEST           request;
-	NTSTATUS status;
-
-
-	status = WdfIoQueueRetrieveNextRequest(pDevice->InterruptMsgQueue, &request);
-	if (NT_SUCCESS(status)) {
-
-		bytesToCopy = sizeof(HIDFX2_INPUT_REPORT);
-
-		if (bytesToCopy == 0) {
-
-			goto exit_bytes;
-		}
-
-		status = WdfRequestRetrieveOutputBuffer(request,
-			bytesToCopy,
-			&inputReport,
-			&bytesReturned);// BufferLength
-		RtlZeroMemory(inputReport, sizeof(inputReport));
-
-		if (!NT_SUCCESS(status)) {
-		}
-		else {
-
-			inputReport->ReportTouchId = 0x01;
-			inputReport->ScanTimeLSB = pDevice->ReportTime & 0x00ff;
-			inputReport->ScanTimeMSB = (pDevice->ReportTime & 0xff00) >> 8;
-			inputReport->ContactCount = 0;
-		}
-		bytesReturned = bytesToCopy;
-		WdfRequestCompleteWithInformation(request, status, bytesReturned);
+	//
+	// Stopped under the interrupt lock first, so a running doze timer
+	// does not arm itself again.
+	//
+	if (devContext->Interrupt != NULL) {
+		WdfInterruptAcquireLock(devContext->Interrupt);
+		TouchActivityStop(&devContext->Activity, (ULONG)(TouchTimeUs() / 1000));
+		WdfInterruptReleaseLock(devContext->Interrupt);
 	}
-	else if (status != STATUS_NO_MORE_ENTRIES) {
+	else {
+		TouchActivityStop(&devContext->Activity, (ULONG)(TouchTimeUs() / 1000));
 	}
+	WdfTimerStop(devContext->DozeTimer, TRUE);
+	KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL,
+		"ft5x: active %I64u ms, monitor %I64u ms, %u dozes, %u failed\n",
+		devContext->Activity.ModeMs[TouchModeActive],
+		devContext->Activity.ModeMs[TouchModeDoze],
+		devContext->Activity.DozeEntries,
+		devContext->Activity.DozeFailures));
 
-exit_bytes:
-	pDevice->ReportTime += 125;
-	if (pDevice->ReportTime > 0xffff)
-		pDevice->ReportTime = 0;
+	SpbPeripheralClose(devContext);
 
-	return;
+	return STATUS_SUCCESS;
 }
 
-
-VOID ProcessCtpDataDown(
+VOID ProcessCtpData(
 	_In_ PDEVICE_EXTENSION pDevice
 	)
 	// Processing the data, and data will be reported to the system
+	//
+	// The contacts are handed to the tracker, which writes each report of
+	// the frame straight into the output buffer of a pended read.
 {
+	TOUCH_POINT points[FT5X_MAX_CONTACTS];
+	UCHAR* point = NULL;
 	UCHAR TouchNumber;
 	UCHAR Index;
 
-	PHIDFX2_INPUT_REPORT inputReport = NULL;
-	ULONG				 bytesToCopy = 0;
-	size_t				 bytesReturned = 0;
+	PVOID				 inputReport = NULL;
+	size_t				 bufferLength = 0;
+	ULONG				 bytesReturned = 0;
 	WDFREQUEST           request;
 	NTSTATUS status;
 
-	long input_x = 0;
-	long input_y = 0;
+	TouchNumber = pDevice->Data[FT5X_TD_STATUS] & 0x07;
+	if (TouchNumber > FT5X_MAX_CONTACTS) {
+		TouchNumber = FT5X_MAX_CONTACTS;
+	}
 
-	TouchNumber = pDevice->Data[2] & 0x07;
-	Index = 0;
+	for (Index = 0; Index < TouchNumber; Index++) {
+		point = &pDevice->Data[FT5X_POINT_BASE + Index * FT5X_POINT_LENGTH];
 
-	status = WdfIoQueueRetrieveNextRequest(pDevice->InterruptMsgQueue, &request);
-	if (NT_SUCCESS(status)) {
+		points[Index].Id = (point[2] & 0xF0) >> 4;
+		points[Index].X = (USHORT)(1280 - ((point[0] & 0x0F) << 8 | point[1]));
+		points[Index].Y = (USHORT)(800 - ((point[2] & 0x0F) << 8 | point[3]));
+	}
 
-		bytesToCopy = sizeof(HIDFX2_INPUT_REPORT);
+	TouchTrackerSetFrameTimes(&pDevice->Tracker, pDevice->InterruptTime, pDevice->ReadTime);
 
-		if (bytesToCopy == 0) {
-			goto exit_bytes;
-		}
+	if (TouchTrackerUpdate(&pDevice->Tracker, points, TouchNumber, (USHORT)pDevice->ReportTime) != 0) {
 
-		status = WdfRequestRetrieveOutputBuffer(request,
-			bytesToCopy,
-			&inputReport,
-			&bytesReturned);// BufferLength
-		RtlZeroMemory(inputReport, sizeof(HIDFX2_INPUT_REPORT));
+		while (pDevice->Tracker.PendingReports != 0) {
 
-		if (!NT_SUCCESS(status)) {
-		}
-		else {
-			for (Index = 0; Index < 5; Index++) {
-				switch (Index)
-				{
-				case 4:
-					if (TouchNumber < 5) {
-						inputReport->Tip4 = 0x00;
-						inputReport->ContactId4 = (pDevice->Data[0x1d] & 0xF0) >> 4;
-						break;
-					}
-
-					input_x = (pDevice->Data[0x1b] & 0x0F) << 8 | pDevice->Data[0x1C];
-					input_y = (pDevice->Data[0x1d] & 0x0F) << 8 | pDevice->Data[0x1e];
-
-					input_x = 1280 - input_x;
-					input_y = 800 - input_y;
-
-					inputReport->Tip4 = 0x01;
-					inputReport->ContactId4 = (pDevice->Data[0x1d] & 0xF0) >> 4;
-					inputReport->XLSB4 = input_x & 0x00ff;
-					inputReport->XMSB4 = (input_x & 0xff00) >> 8;
-					inputReport->YLSB4 = input_y & 0x00ff;
-					inputReport->YMSB4 = (input_y & 0xff00) >> 8;
-					break;
-				case 3:
-					if (TouchNumber < 4) {
-						inputReport->Tip3 = 0x00;
-						inputReport->ContactId3 = (pDevice->Data[0x17] & 0xF0) >> 4;
-						break;
-					}
-
-					input_x = (pDevice->Data[0x15] & 0x0F) << 8 | pDevice->Data[0x16];
-					input_y = (pDevice->Data[0x17] & 0x0F) << 8 | pDevice->Data[0x18];
-
-					input_x = 1280 - input_x;
-					input_y = 800 - input_y;
-
-
-					inputReport->Tip3 = 0x01;
-					inputReport->ContactId3 = (pDevice->Data[0x17] & 0xF0) >> 4;
-					inputReport->XLSB3 = input_x & 0x00ff;
-					inputReport->XMSB3 = (input_x & 0xff00) >> 8;
-					inputReport->YLSB3 = input_y & 0x00ff;
-					inputReport->YMSB3 = (input_y & 0xff00) >> 8;
-					break;
-				case 2:
-					if (TouchNumber < 3) {
-						inputReport->Tip2 = 0x00;
-						inputReport->ContactId2 = (pDevice->Data[0x11] & 0xF0) >> 4;
-						break;
-					}
-
-					input_x = (pDevice->Data[0x0f] & 0x0F) << 8 | pDevice->Data[0x10];
-					input_y = (pDevice->Data[0x11] & 0x0F) << 8 | pDevice->Data[0x12];
-
-					input_x = 1280 - input_x;
-					input_y = 800 - input_y;
-
-					inputReport->Tip2 = 0x01;
-					inputReport->ContactId2 = (pDevice->Data[0x11] & 0xF0) >> 4;
-
-					inputReport->XLSB2 = input_x & 0x00ff;
-					inputReport->XMSB2 = (input_x & 0xff00) >> 8;
-					inputReport->YLSB2 = input_y & 0x00ff;
-					inputReport->YMSB2 = (input_y & 0xff00) >> 8;
-					break;
-				case 1:
-					if (TouchNumber < 2) {
-						inputReport->Tip1 = 0x00;
-						inputReport->ContactId1 = (pDevice->Data[0x0b] & 0xF0) >> 4;
-						break;
-					}
-
-					input_x = (pDevice->Data[0x09] & 0x0F) << 8 | pDevice->Data[0x0a];
-					input_y = (pDevice->Data[0x17] & 0x0b) << 8 | pDevice->Data[0x0c];
-
-					input_x = 1280 - input_x;
-					input_y = 800 - input_y;
-
-					inputReport->Tip1 = 0x01;
-					inputReport->ContactId1 = (pDevice->Data[0x0b] & 0xF0) >> 4;
-
-					inputReport->XLSB1 = input_x & 0x00ff;
-					inputReport->XMSB1 = (input_x & 0xff00) >> 8;
-					inputReport->YLSB1 = input_y & 0x00ff;
-					inputReport->YMSB1 = (input_y & 0xff00) >> 8;
-					break;
-				case 0:
-					if (TouchNumber < 1) {
-						inputReport->Tip0 = 0x00;
-						inputReport->ContactId0 = (pDevice->Data[0x05] & 0xF0) >> 4;
-						break;
-					}
-
-					input_x = (pDevice->Data[0x03] & 0x0F) << 8 | pDevice->Data[0x4];
-					input_y = (pDevice->Data[0x5] & 0x0F) << 8 | pDevice->Data[0x6];
-
-					input_x = 1280 - input_x;
-					input_y = 800 - input_y;
-
-					inputReport->Tip0 = 0x01;
-					inputReport->ContactId0 = (pDevice->Data[0x05] & 0xF0) >> 4;
-
-					inputReport->XLSB0 = input_x & 0x00ff;
-					inputReport->XMSB0 = (input_x & 0xff00) >> 8;
-					inputReport->YLSB0 = input_y & 0x00ff;
-					inputReport->YMSB0 = (input_y & 0xff00) >> 8;
-					break;
-				default:
-					break;
-				}
+			status = WdfIoQueueRetrieveNextRequest(pDevice->InterruptMsgQueue, &request);
+			if (!NT_SUCCESS(status)) {
+				break;
 			}
 
-			
-			inputReport->ReportTouchId = 0x01;
-			inputReport->ScanTimeLSB = pDevice->ReportTime & 0x00ff;
-			inputReport->ScanTimeMSB = (pDevice->ReportTime & 0xff00) >> 8;
-			inputReport->ContactCount = TouchNumber;
+			bytesReturned = 0;
+			status = WdfRequestRetrieveOutputBuffer(request,
+				sizeof(HIDFX2_INPUT_REPORT),
+				&inputReport,
+				&bufferLength);
+			if (NT_SUCCESS(status)) {
+				bytesReturned = TouchTrackerNextReport(&pDevice->Tracker, inputReport, (ULONG)bufferLength);
+				TouchTrackerReportBuilt(&pDevice->Tracker, TouchTimeUs());
+			}
+
+			WdfRequestCompleteWithInformation(request, status, bytesReturned);
+			if (bytesReturned != 0) {
+				TouchTrackerReportCompleted(&pDevice->Tracker, TouchTimeUs());
+			}
 		}
 	}
-	else if (status != STATUS_NO_MORE_ENTRIES) {
-	}
 
-exit_bytes:
-	bytesReturned = bytesToCopy;
-	WdfRequestCompleteWithInformation(request, status, bytesReturned);
 	pDevice->ReportTime += 125;
 	if (pDevice->ReportTime > 0xffff)
 		pDevice->ReportTime = 0;
@@ -1294,23 +999,85 @@ Return Value:
 	BOOLEAN fInterruptRecognized = TRUE;
 	WDFDEVICE device;
 	PDEVICE_EXTENSION pDevice;
+	ULONGLONG interruptTime;
 
 	UNREFERENCED_PARAMETER(MessageID);
 
+	interruptTime = TouchTimeUs();
+
 	device = WdfInterruptGetDevice(FxInterrupt);
 	pDevice = GetDeviceContext(device);
 	if (pDevice == NULL) {
 		return fInterruptRecognized;
 	}
+
+	//
+	// A panel in monitor mode is set active before its first frame is
+	// read, and the quiet period starts over.
+	//
+	if (TouchActivityInterrupt(&pDevice->Activity, (ULONG)(interruptTime / 1000))) {
+		CtpSetDoze(pDevice, FALSE);
+		WdfTimerStart(pDevice->DozeTimer, WDF_REL_TIMEOUT_IN_MS(pDevice->Activity.QuietMs));
+	}
+
 	pDevice->Data[0] = 0;
 	SpbRequestWriteRead(pDevice, &pDevice->Data[0], 1, &pDevice->Data[0], 32); //Read the data
 
-	if (((pDevice->Report & 0x07) == 0x07))
+	if (((pDevice->Report & 0x07) == 0x07)) {
+		pDevice->InterruptTime = interruptTime;
+		pDevice->ReadTime = TouchTimeUs();
 		WdfInterruptQueueDpcForIsr(FxInterrupt);
+	}
 
 	return fInterruptRecognized;
 }
 
+VOID
+OnDozeTimer(
+	_In_ WDFTIMER Timer
+)
+/*++
+
+Routine Description:
+
+	Puts the panel in monitor mode when no interrupt arrived for the
+	quiet period, otherwise waits for the rest of it. Runs at
+	PASSIVE_LEVEL with the interrupt lock held, so the ISR is not
+	talking to the panel meanwhile.
+
+Arguments:
+
+	Timer - the doze timer of the device.
+
+Return Value:
+
+	None
+
+--*/
+{
+	PDEVICE_EXTENSION pDevice;
+	unsigned int waitMs;
+	ULONG now;
+	NTSTATUS status;
+
+	pDevice = GetDeviceContext(WdfTimerGetParentObject(Timer));
+
+	WdfInterruptAcquireLock(pDevice->Interrupt);
+
+	now = (ULONG)(TouchTimeUs() / 1000);
+	if (TouchActivityDozeDue(&pDevice->Activity, now, &waitMs)) {
+		status = CtpSetDoze(pDevice, TRUE);
+		TouchActivityDozeEntered(&pDevice->Activity, now, NT_SUCCESS(status));
+		TouchActivityDozeDue(&pDevice->Activity, now, &waitMs);
+	}
+
+	WdfInterruptReleaseLock(pDevice->Interrupt);
+
+	if (waitMs != 0) {
+		WdfTimerStart(Timer, WDF_REL_TIMEOUT_IN_MS(waitMs));
+	}
+}
+
 VOID
 OnInterruptDpc(
 	_In_ WDFINTERRUPT WdfInterrupt,
@@ -1335,7 +1102,6 @@ Return Value:
 --*/
 {
 	PDEVICE_EXTENSION pDevice = NULL;
-	UCHAR touch_num = 0;
 
 	UNREFERENCED_PARAMETER(WdfInterrupt);
 
@@ -1345,15 +1111,9 @@ Return Value:
 		return;
 	}
 
-	touch_num = pDevice->Data[2] & 0x07;
-
 	WdfSpinLockAcquire(pDevice->OnLock);
 
-	if (touch_num != 0)
-		ProcessCtpDataDown(pDevice);
-	else
-		ProcessCtpDataUp(pDevice);
-
+	ProcessCtpData(pDevice);
 
 	WdfSpinLockRelease(pDevice->OnLock);
 
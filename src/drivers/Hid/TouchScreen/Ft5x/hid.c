@@ -246,11 +246,11 @@ Return Value:
 	NTSTATUS                     status = STATUS_SUCCESS;
 	PHID_XFER_PACKET             transferPacket = NULL;
 	WDF_REQUEST_PARAMETERS       params;
-//	WDFDEVICE                    device;
+	WDFDEVICE                    device;
 
 	PAGED_CODE();
 
-	//device = WdfIoQueueGetDevice(WdfRequestGetIoQueue(Request));
+	device = WdfIoQueueGetDevice(WdfRequestGetIoQueue(Request));
 
 	WDF_REQUEST_PARAMETERS_INIT(&params);
 	WdfRequestGetParameters(Request, &params);
@@ -286,6 +286,16 @@ Return Value:
 		return status;
 	}
 
+	//
+	// Writing the latency report clears the statistics.
+	//
+	if (transferPacket->reportId == TOUCH_LATENCY_REPORT_ID)
+	{
+		TouchTrackerSetLatencyFeature(&GetDeviceContext(device)->Tracker,
+			GetDeviceContext(device)->OnLock);
+		return status;
+	}
+
 	return status;
 }
 
@@ -313,7 +323,7 @@ Return Value:
 
 --*/
 {
-//	WDFDEVICE						device;
+	WDFDEVICE						device;
 	NTSTATUS						status = STATUS_SUCCESS;
 	PHID_XFER_PACKET				transferPacket = NULL;
 	WDF_REQUEST_PARAMETERS			params;
@@ -325,7 +335,7 @@ Return Value:
 
 	*BytesReturned = 0;
 
-	//device = WdfIoQueueGetDevice(WdfRequestGetIoQueue(Request));
+	device = WdfIoQueueGetDevice(WdfRequestGetIoQueue(Request));
 
 	WDF_REQUEST_PARAMETERS_INIT(&params);
 	WdfRequestGetParameters(Request, &params);
@@ -364,7 +374,7 @@ Return Value:
 	if (transferPacket->reportId == 0x05)
 	{
 		featureReportCount = (PHIDFX2_FEATURE_REPORT_COUNT) transferPacket->reportBuffer;
-		featureReportCount->ContactCountMaximum = 0x05;
+		featureReportCount->ContactCountMaximum = FT5X_MAX_CONTACTS;
 		*BytesReturned = sizeof (HIDFX2_FEATURE_REPORT_COUNT);
 	}
 	else if (transferPacket->reportId == 0x44)
@@ -375,6 +385,14 @@ Return Value:
 		*BytesReturned = sizeof (HIDFX2_FEATURE_REPORT_VENDOR);
 
 	}
+	else if (transferPacket->reportId == TOUCH_LATENCY_REPORT_ID)
+	{
+		status = TouchTrackerGetLatencyFeature(&GetDeviceContext(device)->Tracker,
+			GetDeviceContext(device)->OnLock,
+			transferPacket->reportBuffer,
+			transferPacket->reportBufferLen,
+			BytesReturned);
+	}
 	else {
 		status = STATUS_INVALID_DEVICE_REQUEST;
 		return status;
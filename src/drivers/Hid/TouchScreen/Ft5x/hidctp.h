@@ -11,6 +11,28 @@
 
 #define NTSTRSAFE_LIB
 #include <ntstrsafe.h>
+
+#include "..\spbclient.h"
+#include "..\touchreport.h"
+#include "..\touchactivity.h"
+
+//
+// Point registers: TD_STATUS at 0x02, then 6 bytes per contact from 0x03
+// (event and X high nibble, X low, id and Y high nibble, Y low, ...).
+//
+#define FT5X_MAX_CONTACTS		5
+#define FT5X_TD_STATUS			0x02
+#define FT5X_POINT_BASE			0x03
+#define FT5X_POINT_LENGTH		6
+
+//
+// Power mode. In monitor mode the panel scans slowly and switches back to
+// active by itself when touched.
+//
+#define FT5X_PMODE_REG			0xA5
+#define FT5X_PMODE_ACTIVE		0x00
+#define FT5X_PMODE_MONITOR		0x01
+
 typedef UCHAR HID_REPORT_DESCRIPTOR, *PHID_REPORT_DESCRIPTOR;
 
 #ifdef USE_HARDCODED_HID_REPORT_DESCRIPTOR
@@ -196,6 +218,7 @@ CONST HID_REPORT_DESCRIPTOR G_DefaultReportDescriptor[] = {
 	0x75, 0x08,                         //   REPORT_SIZE (8)             
 	0x96, 0x00, 0x01,                   //   REPORT_COUNT (0x100 (256))             
 	0xb1, 0x02,                         //   FEATURE (Data,Var,Abs) 
+	TOUCH_LATENCY_FEATURE_DESCRIPTOR,
 	0xc0, // END_COLLECTION
 };
 
@@ -327,6 +350,8 @@ typedef struct _HIDFX2_INPUT_REPORT {
 
 }HIDFX2_INPUT_REPORT, *PHIDFX2_INPUT_REPORT;
 
+C_ASSERT(sizeof(HIDFX2_INPUT_REPORT) == TOUCH_REPORT_LENGTH(FT5X_MAX_CONTACTS));
+
 
 typedef struct _HIDFX2_FEATURE_REPORT_COUNT {
 	//
@@ -367,10 +392,10 @@ typedef struct _DEVICE_EXTENSION{
 	WDFIOTARGET SpbController;
 
 	//
-	// SPB request object
+	// Preallocated SPB request, reused for every transfer
 	//
 
-	WDFREQUEST SpbRequest;
+	SPB_CLIENT SpbClient;
 
 
 	//
@@ -388,12 +413,29 @@ typedef struct _DEVICE_EXTENSION{
 	UCHAR				Data[32];
 	long				ReportTime;
 
+	TOUCH_TRACKER		Tracker;
+
+	//
+	// Interrupt entry and end of the contact read of the frame handed to
+	// the DPC, in us, for the tracker's latency statistics.
+	//
+	ULONGLONG			InterruptTime;
+	ULONGLONG			ReadTime;
+
+	//
+	// Scan rate management, the timer drops the panel to monitor mode
+	// after the quiet period.
+	//
+	TOUCH_ACTIVITY		Activity;
+	WDFTIMER			DozeTimer;
+
 } DEVICE_EXTENSION, *PDEVICE_EXTENSION;
 WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(DEVICE_EXTENSION, GetDeviceContext)
 
 
 EVT_WDF_INTERRUPT_ISR					OnInterruptIsr;
 EVT_WDF_INTERRUPT_DPC					OnInterruptDpc;
+EVT_WDF_TIMER							OnDozeTimer;
 
 
 DRIVER_INITIALIZE DriverEntry;
@@ -464,6 +506,12 @@ ReadChipId(
 	_In_ PDEVICE_EXTENSION pDevice
 );
 
+NTSTATUS
+CtpSetDoze(
+	_In_ PDEVICE_EXTENSION pDevice,
+	_In_ BOOLEAN Doze
+);
+
 VOID
 Wait(
 	LONG msec
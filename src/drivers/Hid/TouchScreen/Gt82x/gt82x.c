@@ -230,23 +230,6 @@ Return Value:
 
 {
 	NTSTATUS Status;
-	WDFMEMORY Memory;
-	WDFREQUEST IoctlRequest;
-	WDF_OBJECT_ATTRIBUTES Attributes;
-	WDF_REQUEST_SEND_OPTIONS SendOptions;
-	WDF_OBJECT_ATTRIBUTES RequestAttributes;
-
-
-	IoctlRequest = NULL;
-	Memory = WDF_NO_HANDLE;
-
-	WDF_OBJECT_ATTRIBUTES_INIT(&RequestAttributes);
-	Status = WdfRequestCreate(&RequestAttributes, pDevice->SpbController, &IoctlRequest);
-	if (!NT_SUCCESS(Status)) {
-		TraceEvents(TRACE_LEVEL_ERROR, DBG_CTP,
-			"request fail *****line:%d*****\n", __LINE__);
-		goto Done;
-	}
 
 	if (InBuffer == NULL) {
 		TraceEvents(TRACE_LEVEL_ERROR, DBG_CTP,
@@ -254,62 +237,13 @@ Return Value:
 		return STATUS_UNSUCCESSFUL;
 	}
 
-	NT_ASSERT(Memory == WDF_NO_HANDLE);
-
-	WDF_OBJECT_ATTRIBUTES_INIT(&Attributes);
-	Attributes.ParentObject = IoctlRequest;
-	Status = WdfMemoryCreatePreallocated(
-		&Attributes,
-		InBuffer,
-		InBufferlength,
-		&Memory);
-
-	if (!NT_SUCCESS(Status)) {
-		TraceEvents(TRACE_LEVEL_ERROR, DBG_CTP,
-			"WdfMemoryCreatePreallocated fail *****line:%d*****\n", __LINE__);
-		goto Done;
-	}
-
-	Status = WdfIoTargetFormatRequestForWrite(
-		pDevice->SpbController,
-		IoctlRequest,
-		Memory,
-		NULL,
-		NULL
-		);
-
-	if (!NT_SUCCESS(Status)) {
-		TraceEvents(TRACE_LEVEL_ERROR, DBG_CTP,
-			"*****line:%d*****\n", __LINE__);
-		return Status;
-	}
-
-	WDF_REQUEST_SEND_OPTIONS_INIT(&SendOptions,
-		WDF_REQUEST_SEND_OPTION_SYNCHRONOUS);
-
-	WDF_REQUEST_SEND_OPTIONS_SET_TIMEOUT(&SendOptions,
-		WDF_REL_TIMEOUT_IN_SEC(60));
-
-	Status = WdfRequestAllocateTimer(IoctlRequest);
-	if (!NT_SUCCESS(Status)) {
-		TraceEvents(TRACE_LEVEL_ERROR, DBG_CTP,
-			"*****line:%d*****\n", __LINE__);
-		goto Done;
-	}
-
-	if (!WdfRequestSend(IoctlRequest, pDevice->SpbController, &SendOptions)) {
-		Status = WdfRequestGetStatus(IoctlRequest);
-	}
+	Status = SpbClientWrite(&pDevice->SpbClient, InBuffer, InBufferlength);
 
 	if (!NT_SUCCESS(Status)) {
 		TraceEvents(TRACE_LEVEL_ERROR, DBG_CTP,
-			"*****line:%d status0x%x*****\n", __LINE__, Status);
+			"*****line:%d Status:0x%x*****\n", __LINE__, Status);
 	}
 
-Done:
-	if (IoctlRequest != NULL) {
-		WdfObjectDelete(IoctlRequest);
-	}
 	return Status;
 }
 
@@ -336,22 +270,6 @@ Return Value:
 --*/
 {
 	NTSTATUS Status;
-	WDFMEMORY Memory;
-	WDFREQUEST IoctlRequest;
-	WDF_OBJECT_ATTRIBUTES Attributes;
-	WDF_REQUEST_SEND_OPTIONS SendOptions;
-	WDF_OBJECT_ATTRIBUTES RequestAttributes;
-
-	IoctlRequest = NULL;
-	Memory = WDF_NO_HANDLE;
-
-	WDF_OBJECT_ATTRIBUTES_INIT(&RequestAttributes);
-	Status = WdfRequestCreate(&RequestAttributes, pDevice->SpbController, &IoctlRequest);
-	if (!NT_SUCCESS(Status)) {
-		TraceEvents(TRACE_LEVEL_ERROR, DBG_CTP,
-			"request fail *****line:%d*****\n", __LINE__);
-		goto Done;
-	}
 
 	if (OutBuffer == NULL) {
 		TraceEvents(TRACE_LEVEL_ERROR, DBG_CTP,
@@ -359,69 +277,13 @@ Return Value:
 		return STATUS_UNSUCCESSFUL;
 	}
 
-	//
-	// Create preallocated WDFMEMORY. The IOCTL is METHOD_BUFFERED,
-	// so the memory doesn't have to persist until the request is
-	// completed.
-	//
-
-	NT_ASSERT(Memory == WDF_NO_HANDLE);
-
-	WDF_OBJECT_ATTRIBUTES_INIT(&Attributes);
-	Attributes.ParentObject = IoctlRequest;
-	Status = WdfMemoryCreatePreallocated(
-		&Attributes,
-		OutBuffer,
-		OutBufferlength,
-		&Memory);
-
-	if (!NT_SUCCESS(Status))
-	{
-		TraceEvents(TRACE_LEVEL_ERROR, DBG_CTP,
-			"WdfMemoryCreatePreallocated fail *****line:%d*****\n", __LINE__);
-		goto Done;
-	}
-
-	Status = WdfIoTargetFormatRequestForRead(
-		pDevice->SpbController,
-		IoctlRequest,
-		Memory,
-		NULL,
-		NULL
-		);
-
-	if (!NT_SUCCESS(Status)) {
-		TraceEvents(TRACE_LEVEL_ERROR, DBG_CTP,
-			"forIoctl error *****line:%d*****\n", __LINE__);
-		goto Done;
-	}
-
-	WDF_REQUEST_SEND_OPTIONS_INIT(&SendOptions,
-		WDF_REQUEST_SEND_OPTION_SYNCHRONOUS);
-
-	WDF_REQUEST_SEND_OPTIONS_SET_TIMEOUT(&SendOptions,
-		WDF_REL_TIMEOUT_IN_SEC(60));
-
-	Status = WdfRequestAllocateTimer(IoctlRequest);
-	if (!NT_SUCCESS(Status)) {
-		TraceEvents(TRACE_LEVEL_ERROR, DBG_CTP,
-			"*****line:%d*****\n", __LINE__);
-		goto Done;
-	}
-
-	if (!WdfRequestSend(IoctlRequest, pDevice->SpbController, &SendOptions)) {
-		Status = WdfRequestGetStatus(IoctlRequest);
-	}
+	Status = SpbClientRead(&pDevice->SpbClient, OutBuffer, OutBufferlength, NULL);
 
 	if (!NT_SUCCESS(Status)) {
 		TraceEvents(TRACE_LEVEL_ERROR, DBG_CTP,
 			"*****line:%d Status:0x%x*****\n", __LINE__, Status);
 	}
 
-Done:
-	if (IoctlRequest != NULL) {
-		WdfObjectDelete(IoctlRequest);
-	}
 	return Status;
 }
 
@@ -452,23 +314,6 @@ Return Value:
 --*/
 {
 	NTSTATUS Status;
-	WDFMEMORY Memory;
-	WDFREQUEST IoctlRequest;
-	WDF_OBJECT_ATTRIBUTES Attributes;
-	WDF_REQUEST_SEND_OPTIONS SendOptions;
-	WDF_OBJECT_ATTRIBUTES RequestAttributes;
-
-	IoctlRequest = NULL;
-	Memory = WDF_NO_HANDLE;
-
-	WDF_OBJECT_ATTRIBUTES_INIT(&RequestAttributes);
-	Status = WdfRequestCreate(&RequestAttributes, pDevice->SpbController, &IoctlRequest);
-	if (!NT_SUCCESS(Status)) {
-		TraceEvents(TRACE_LEVEL_ERROR, DBG_CTP,
-			"request fail *****line:%d status:0x%x*****\n", __LINE__, Status);
-		goto Done;
-	}
-
 
 	if ((InBuffer == NULL) || (OutBuffer == NULL)) {
 		TraceEvents(TRACE_LEVEL_ERROR, DBG_CTP,
@@ -477,104 +322,17 @@ Return Value:
 	}
 
 	//
-	// Build SPB sequence.
-	//
-
-	const ULONG transfers = 2;
-
-	SPB_TRANSFER_LIST_AND_ENTRIES(2) seq;
-	SPB_TRANSFER_LIST_INIT(&(seq.List), transfers);
-
-	{
-		//
-		// PreFAST cannot figure out the SPB_TRANSFER_LIST_ENTRY
-		// "struct hack" size but using an index variable quiets 
-		// the warning. This is a false positive from OACR.
-		// 
-
-		ULONG index = 0;
-		seq.List.Transfers[index] = SPB_TRANSFER_LIST_ENTRY_INIT_SIMPLE(
-			SpbTransferDirectionToDevice,
-			0,
-			InBuffer,
-			InBufferlength);
-
-		seq.List.Transfers[index + 1] = SPB_TRANSFER_LIST_ENTRY_INIT_SIMPLE(
-			SpbTransferDirectionFromDevice,
-			0,
-			OutBuffer,
-			OutBufferlength);
-	}
-
-	//
-	// Create preallocated WDFMEMORY. The IOCTL is METHOD_BUFFERED,
-	// so the memory doesn't have to persist until the request is
-	// completed.
-	//
-
-	NT_ASSERT(Memory == WDF_NO_HANDLE);
-
-	WDF_OBJECT_ATTRIBUTES_INIT(&Attributes);
-	Attributes.ParentObject = IoctlRequest;
-	Status = WdfMemoryCreatePreallocated(
-		&Attributes,
-		(PVOID) &seq,
-		sizeof(seq),
-		&Memory);
-
-	if (!NT_SUCCESS(Status))
-	{
-		TraceEvents(TRACE_LEVEL_ERROR, DBG_CTP,
-			"WdfMemoryCreatePreallocated fail *****line:%d Status:0x%x*****\n", __LINE__, Status);
-		goto Done;
-	}
-
-	//
-	// Format and send the SPB sequence request.
+	// Both transfers go out as one SPB sequence on the preallocated
+	// request, so the controller issues a repeated start between them.
 	//
 
-	Status = WdfIoTargetFormatRequestForIoctl(
-		pDevice->SpbController,
-		IoctlRequest,
-		IOCTL_SPB_EXECUTE_SEQUENCE,
-		Memory,
-		NULL,
-		NULL,
-		NULL);
-
-	if (!NT_SUCCESS(Status))
-	{
-		TraceEvents(TRACE_LEVEL_ERROR, DBG_CTP,
-			"forIoctl error *****line:%d Status:0x%x*****\n", __LINE__, Status);
-		goto Done;
-	}
-
-	WDF_REQUEST_SEND_OPTIONS_INIT(&SendOptions,
-		WDF_REQUEST_SEND_OPTION_SYNCHRONOUS);
+	Status = SpbClientWriteRead(&pDevice->SpbClient, InBuffer, InBufferlength, OutBuffer, OutBufferlength);
 
-	WDF_REQUEST_SEND_OPTIONS_SET_TIMEOUT(&SendOptions,
-		WDF_REL_TIMEOUT_IN_SEC(60));
-
-	Status = WdfRequestAllocateTimer(IoctlRequest);
 	if (!NT_SUCCESS(Status)) {
 		TraceEvents(TRACE_LEVEL_ERROR, DBG_CTP,
 			"*****line:%d Status:0x%x*****\n", __LINE__, Status);
-		goto Done;
-	}
-
-	if (!WdfRequestSend(IoctlRequest, pDevice->SpbController, &SendOptions)) {
-		Status = WdfRequestGetStatus(IoctlRequest);
-	}
-
-	if (!NT_SUCCESS(Status)) {
-		TraceEvents(TRACE_LEVEL_ERROR, DBG_CTP,
-			"*****line:%d Status0x%x*****\n", __LINE__, Status);
 	}
 
-Done:
-	if (IoctlRequest != NULL) {
-		WdfObjectDelete(IoctlRequest);
-	}
 	return Status;
 }
 
@@ -595,10 +353,15 @@ Return Value:
 
 --*/
 {
-	NTSTATUS Status;
-	UCHAR InPutBufferEnd[] = { 0x80, 0x00 };
-	Status = SpbRequestWrite(pDevice, InPutBufferEnd, 2);
-	return Status;
+	static UCHAR InPutBufferEnd[] = { 0x80, 0x00 };
+
+	//
+	// Nothing waits on the end command, so queue it and let the next
+	// transfer serialize behind it. The buffer is static because the
+	// write completes after this routine returns.
+	//
+
+	return SpbClientWriteAsync(&pDevice->SpbClient, InPutBufferEnd, sizeof(InPutBufferEnd), NULL, NULL);
 
 }
 
@@ -1056,6 +819,19 @@ Return Value:
 	if (!NT_SUCCESS(status))
 	{
 		KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "*****open fail! line:%d*****\n", __LINE__));
+		return status;
+	}
+
+	//
+	// Preallocate the request reused for every transfer to the panel.
+	//
+
+	status = SpbClientInitialize(&pDevice->SpbClient, pDevice->SpbController);
+
+	if (!NT_SUCCESS(status))
+	{
+		KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "*****spb client fail! line:%d*****\n", __LINE__));
+		WdfIoTargetClose(pDevice->SpbController);
 	}
 
 	return status;
@@ -1084,6 +860,7 @@ Return Value:
 	KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "*****close handle to SPB target:%d*****\n", __LINE__));
 
 	WdfIoTargetClose(pDevice->SpbController);
+	SpbClientCleanup(&pDevice->SpbClient);
 
 	return STATUS_SUCCESS;
 }
@@ -1157,6 +934,8 @@ Return Value:
 	pDevice->Report = 0;
 	pDevice->DataReady = FALSE;
 	pDevice->ReportTime = 0;
+	TouchTrackerInitialize(&pDevice->Tracker, 0x01, GT82X_MAX_CONTACTS);
+	TouchTrackerReadFilterConfig(pDevice->FxDevice, &pDevice->Tracker);
 	RtlZeroMemory(pDevice->Data, sizeof(pDevice->Data));
 
 	SetWakeupHigh(pDevice, 20); //Wakeup pin down up after 20 ms
@@ -1231,65 +1010,6 @@ Return Value:
 	return STATUS_SUCCESS;
 }
 
-VOID ProcessCtpDataUp(
-	_In_ PDEVICE_EXTENSION pDevice
-)
-	// Processing the data up
-{
-
-
-	PHIDFX2_INPUT_REPORT inputReport = NULL;
-	ULONG				 bytesToCopy = 0;
-	size_t				 bytesReturned = 0;
-	WDFREQUEST           request;
-	NTSTATUS status;
-
-
-	status = WdfIoQueueRetrieveNextRequest(pDevice->InterruptMsgQueue, &request);
-	if (NT_SUCCESS(status)) {
-
-		bytesToCopy = sizeof(HIDFX2_INPUT_REPORT);
-
-		if (bytesToCopy == 0) {
-			TraceEvents(TRACE_LEVEL_ERROR, DBG_CTP,
-				"bytesToCopy == 0");
-			goto exit_bytes;
-		}
-
-		status = WdfRequestRetrieveOutputBuffer(request,
-			bytesToCopy,
-			&inputReport,
-			&bytesReturned);// BufferLength
-		RtlZeroMemory(inputReport, sizeof(inputReport));
-
-		if (!NT_SUCCESS(status)) {
-			TraceEvents(TRACE_LEVEL_ERROR, DBG_CTP,
-				"line:%d WdfRequestRetrieveOutputBuffer fail\n", __LINE__);
-		}
-		else {
-
-			inputReport->ReportTouchId = 0x01;
-			inputReport->ScanTimeLSB = pDevice->ReportTime & 0x00ff;
-			inputReport->ScanTimeMSB = (pDevice->ReportTime & 0xff00) >> 8;
-			inputReport->ContactCount = 0;
-		}
-		bytesReturned = bytesToCopy;
-		WdfRequestCompleteWithInformation(request, status, bytesReturned);
-	}
-	else if (status != STATUS_NO_MORE_ENTRIES) {
-		TraceEvents(TRACE_LEVEL_ERROR, DBG_CTP,
-			"line:%d  status : 0x%08x\n", __LINE__, status);
-	}
-
-exit_bytes:
-	pDevice->ReportTime += 125;
-	if (pDevice->ReportTime > 0xffff)
-		pDevice->ReportTime = 0;
-
-	return;
-}
-
-
 VOID ReadCTPData(
 	_In_ PDEVICE_EXTENSION pDevice
 	)
@@ -1344,187 +1064,119 @@ VOID ReadCTPData(
 	return;
 }
 
-VOID ProcessCtpDataDown(
+VOID ProcessCtpData(
 	_In_ PDEVICE_EXTENSION pDevice
 	)
 	// Processing the data, and data will be reported to the system
+	//
+	// The contacts are handed to the tracker, which writes each report of
+	// the frame straight into the output buffer of a pended read. The
+	// slot number is the contact's tracking id, coordinates are stored
+	// only for the touched slots.
 {
+	TOUCH_POINT points[GT82X_MAX_CONTACTS];
 	UCHAR* coor_data = NULL;
 	UCHAR  check_sum = 0;
 	UCHAR  touch_num = 0;
-	UCHAR  pre_num = 0;
 	UCHAR  finger = 0;
 
-	PHIDFX2_INPUT_REPORT inputReport = NULL;
-	ULONG				 bytesToCopy = 0;
-	size_t				 bytesReturned = 0;
+	PVOID				 inputReport = NULL;
+	size_t				 bufferLength = 0;
+	ULONG				 bytesReturned = 0;
 	WDFREQUEST           request;
 	NTSTATUS status = STATUS_SUCCESS;
 
 	long input_x = 0;
 	long input_y = 0;
-	long input_w = 0;
 	UCHAR idx = 0;
 
 	finger = pDevice->Data[0];
-	touch_num = (finger & 0x01) + !!(finger & 0x02) + !!(finger & 0x04) + !!(finger & 0x08) + !!(finger & 0x10);
-	pre_num = (pDevice->TouchNum & 0x01) + !!(pDevice->TouchNum & 0x02) + !!(pDevice->TouchNum & 0x04) +
-		!!(pDevice->TouchNum & 0x08) + !!(pDevice->TouchNum & 0x10);
-
-	if (touch_num == 0)
-		return;
-
 	coor_data = &pDevice->Data[2];
-	check_sum = 0;
-	for (idx = 0; idx < 5 * touch_num; idx++){
-		check_sum += coor_data[idx];
-	}
 
-	if (check_sum != coor_data[5 * touch_num]){
-		TraceEvents(TRACE_LEVEL_ERROR, DBG_CTP,
-			"ReadData %d:Check sum error!", __LINE__);
-		goto exit_work_func;
+	for (idx = 0; idx < GT82X_MAX_CONTACTS; idx++){
+		if (finger & (0x01 << idx)) {
+			touch_num++;
+		}
 	}
 
-	status = WdfIoQueueRetrieveNextRequest(pDevice->InterruptMsgQueue, &request);
-	if (NT_SUCCESS(status)) {
-
-		bytesToCopy = sizeof(HIDFX2_INPUT_REPORT);
+	if (touch_num != 0) {
+		check_sum = 0;
+		for (idx = 0; idx < GT82X_POINT_LENGTH * touch_num; idx++){
+			check_sum += coor_data[idx];
+		}
 
-		if (bytesToCopy == 0) {
+		if (check_sum != coor_data[GT82X_POINT_LENGTH * touch_num]){
 			TraceEvents(TRACE_LEVEL_ERROR, DBG_CTP,
-				"bytesToCopy == 0");
-			goto exit_bytes;
+				"ReadData %d:Check sum error!", __LINE__);
+			return;
 		}
+	}
 
-		status = WdfRequestRetrieveOutputBuffer(request,
-			bytesToCopy,
-			&inputReport,
-			&bytesReturned);// BufferLength
-		RtlZeroMemory(inputReport, sizeof(HIDFX2_INPUT_REPORT));
-
-		if (!NT_SUCCESS(status)) {
-			TraceEvents(TRACE_LEVEL_ERROR, DBG_CTP,
-				"line:%d WdfRequestRetrieveOutputBuffer fail\n", __LINE__);
+	touch_num = 0;
+	for (idx = 0; idx < GT82X_MAX_CONTACTS; idx++){
+		if (!(finger & (0x01 << idx))) {
+			continue;
 		}
-		else {
-			long  pos = 0;
-			for (idx = 0; idx < 5; idx++){
-				if (idx < touch_num) {
-					input_x = coor_data[pos] << 8;
-					input_x |= coor_data[pos + 1];
 
-					input_x = 800 - input_x;
+		input_x = coor_data[0] << 8;
+		input_x |= coor_data[1];
 
-					input_y = coor_data[pos + 2] << 8;
-					input_y |= coor_data[pos + 3];
+		input_x = 800 - input_x;
 
-					input_y = 1280 - input_y;
+		input_y = coor_data[2] << 8;
+		input_y |= coor_data[3];
 
-					input_w = coor_data[pos + 4];
-				}
+		input_y = 1280 - input_y;
+
+		points[touch_num].Id = idx;
+		points[touch_num].X = (USHORT)input_y;
+		points[touch_num].Y = (USHORT)input_x;
+		touch_num++;
+		coor_data += GT82X_POINT_LENGTH;
+	}
 
-				switch (idx)
-				{
-				case 0:
-					if (!(finger & (0x01 << idx))) {
-						inputReport->Tip0 = 0x00;
-						inputReport->ContactId0 = idx;
-						break;
-					}
-
-					inputReport->Tip0 = 0x01;
-					inputReport->ContactId0 = idx;
-					inputReport->XLSB0 = input_y & 0x00ff;
-					inputReport->XMSB0 = (input_y & 0xff00) >> 8;
-					inputReport->YLSB0 = input_x & 0x00ff;
-					inputReport->YMSB0 = (input_x & 0xff00) >> 8;
-
-					break;
-				case 1:
-					if (!(finger & (0x01 << idx))) {
-						inputReport->Tip1 = 0x00;
-						inputReport->ContactId1 = idx;
-						break;
-					}
-
-					inputReport->Tip1 = 0x01;
-					inputReport->ContactId1 = idx;
-					inputReport->XLSB1 = input_y & 0x00ff;
-					inputReport->XMSB1 = (input_y & 0xff00) >> 8;
-					inputReport->YLSB1 = input_x & 0x00ff;
-					inputReport->YMSB1 = (input_x & 0xff00) >> 8;
-
-					break;
-				case 2:
-					if (!(finger & (0x01 << idx))) {
-						inputReport->Tip2 = 0x00;
-						inputReport->ContactId2 = idx;
-						break;
-					}
-
-					inputReport->Tip2 = 0x01;
-					inputReport->ContactId2 = idx;
-					inputReport->XLSB2 = input_y & 0x00ff;
-					inputReport->XMSB2 = (input_y & 0xff00) >> 8;
-					inputReport->YLSB2 = input_x & 0x00ff;
-					inputReport->YMSB2 = (input_x & 0xff00) >> 8;
-					break;
-				case 3:
-					if (!(finger & (0x01 << idx))) {
-						inputReport->Tip3 = 0x00;
-						inputReport->ContactId3 = idx;
-						break;
-					}
-
-					inputReport->Tip3 = 0x01;
-					inputReport->ContactId3 = idx;
-					inputReport->XLSB3 = input_y & 0x00ff;
-					inputReport->XMSB3 = (input_y & 0xff00) >> 8;
-					inputReport->YLSB3 = input_x & 0x00ff;
-					inputReport->YMSB3 = (input_x & 0xff00) >> 8;
-
-					break;
-				case 4:
-					if (!(finger & (0x01 << idx))) {
-						inputReport->Tip4 = 0x00;
-						inputReport->ContactId4 = idx;
-						break;
-					}
-
-					inputReport->Tip4 = 0x01;
-					inputReport->ContactId4 = idx;
-					inputReport->XLSB4 = input_y & 0x00ff;
-					inputReport->XMSB4 = (input_y & 0xff00) >> 8;
-					inputReport->YLSB4 = input_x & 0x00ff;
-					inputReport->YMSB4 = (input_x & 0xff00) >> 8;
-					break;
-				default:
-					break;
+	TouchTrackerSetFrameTimes(&pDevice->Tracker, pDevice->InterruptTime, pDevice->ReadTime);
+
+	if (TouchTrackerUpdate(&pDevice->Tracker, points, touch_num, (USHORT)pDevice->ReportTime) != 0) {
+
+		while (pDevice->Tracker.PendingReports != 0) {
+
+			status = WdfIoQueueRetrieveNextRequest(pDevice->InterruptMsgQueue, &request);
+			if (!NT_SUCCESS(status)) {
+				if (status != STATUS_NO_MORE_ENTRIES) {
+					TraceEvents(TRACE_LEVEL_ERROR, DBG_CTP,
+						"line:%d  status : 0x%08x\n", __LINE__, status);
 				}
-				pos += 5;
+				break;
+			}
+
+			bytesReturned = 0;
+			status = WdfRequestRetrieveOutputBuffer(request,
+				sizeof(HIDFX2_INPUT_REPORT),
+				&inputReport,
+				&bufferLength);
+			if (NT_SUCCESS(status)) {
+				bytesReturned = TouchTrackerNextReport(&pDevice->Tracker, inputReport, (ULONG)bufferLength);
+				TouchTrackerReportBuilt(&pDevice->Tracker, TouchTimeUs());
+			}
+			else {
+				TraceEvents(TRACE_LEVEL_ERROR, DBG_CTP,
+					"line:%d WdfRequestRetrieveOutputBuffer fail\n", __LINE__);
+			}
+
+			WdfRequestCompleteWithInformation(request, status, bytesReturned);
+			if (bytesReturned != 0) {
+				TouchTrackerReportCompleted(&pDevice->Tracker, TouchTimeUs());
 			}
-			inputReport->ReportTouchId = 0x01;
-			inputReport->ScanTimeLSB = pDevice->ReportTime & 0x00ff;
-			inputReport->ScanTimeMSB = (pDevice->ReportTime & 0xff00) >> 8;
-			inputReport->ContactCount = touch_num;
 		}
 	}
-	else if (status != STATUS_NO_MORE_ENTRIES) {
-		TraceEvents(TRACE_LEVEL_ERROR, DBG_CTP,
-			"line:%d  status : 0x%08x\n", __LINE__, status);
-	}
 
-exit_bytes:
-	bytesReturned = bytesToCopy;
-	WdfRequestCompleteWithInformation(request, status, bytesReturned);
 	pDevice->TouchNum = finger;
 	pDevice->ReportTime += 125;
 	if (pDevice->ReportTime > 0xffff)
 		pDevice->ReportTime = 0;
 
 	pDevice->DataReady = FALSE;
-exit_work_func:
 	return;
 }
 
@@ -1558,8 +1210,11 @@ Return Value:
 	BOOLEAN fInterruptRecognized = TRUE;
 	WDFDEVICE device;
 	PDEVICE_EXTENSION pDevice;
+	ULONGLONG interruptTime;
 
 	UNREFERENCED_PARAMETER(MessageID);
+
+	interruptTime = TouchTimeUs();
 	AWPRINT("ctp int isr....\n");
 	device = WdfInterruptGetDevice(FxInterrupt);
 	pDevice = GetDeviceContext(device);
@@ -1571,8 +1226,11 @@ Return Value:
 
 	ReadCTPData(pDevice); //Read the data
 
-	if (((pDevice->Report & 0x07) == 0x07))
+	if (((pDevice->Report & 0x07) == 0x07)) {
+		pDevice->InterruptTime = interruptTime;
+		pDevice->ReadTime = TouchTimeUs();
 		WdfInterruptQueueDpcForIsr(FxInterrupt);
+	}
 
 	return fInterruptRecognized;
 }
@@ -1601,8 +1259,6 @@ Return Value:
 --*/
 {
 	PDEVICE_EXTENSION pDevice = NULL;
-	UCHAR finger = 0;
-	UCHAR touch_num = 0;
 
 	UNREFERENCED_PARAMETER(WdfInterrupt);
 
@@ -1614,17 +1270,9 @@ Return Value:
 		return;
 	}
 
-	finger = pDevice->Data[0];
-	touch_num = (finger & 0x01) + !!(finger & 0x02) + !!(finger & 0x04) + !!(finger & 0x08) + !!(finger & 0x10);
-
-
 	WdfSpinLockAcquire(pDevice->OnLock);
 
-	if (touch_num != 0)
-		ProcessCtpDataDown(pDevice);
-	else
-		ProcessCtpDataUp(pDevice);
-
+	ProcessCtpData(pDevice);
 
 	WdfSpinLockRelease(pDevice->OnLock);
 
@@ -259,7 +259,7 @@ NT status value
 	NTSTATUS                     status = STATUS_SUCCESS;
 	PHID_XFER_PACKET             transferPacket = NULL;
 	WDF_REQUEST_PARAMETERS       params;
-	//WDFDEVICE                    device;
+	WDFDEVICE                    device;
 	//UCHAR                        featureUsage = 0;
 	//PHIDFX2_FEATURE_REPORT_COUNT featureReportCount = NULL;
 	//PHIDFX2_FEATURE_REPORT_VENDOR featureReportVendor = NULL;
@@ -268,7 +268,7 @@ NT status value
 
 	TraceEvents(TRACE_LEVEL_VERBOSE, DBG_IOCTL, "HidFx2SetFeature Enter\n");
 
-	//device = WdfIoQueueGetDevice(WdfRequestGetIoQueue(Request));
+	device = WdfIoQueueGetDevice(WdfRequestGetIoQueue(Request));
 
 	WDF_REQUEST_PARAMETERS_INIT(&params);
 	WdfRequestGetParameters(Request, &params);
@@ -312,6 +312,16 @@ NT status value
 		return status;
 	}
 
+	//
+	// Writing the latency report clears the statistics.
+	//
+	if (transferPacket->reportId == TOUCH_LATENCY_REPORT_ID)
+	{
+		TouchTrackerSetLatencyFeature(&GetDeviceContext(device)->Tracker,
+			GetDeviceContext(device)->OnLock);
+		return status;
+	}
+
 	//featureReport = (PHIDFX2_FEATURE_REPORT)transferPacket->reportBuffer;
 	//featureUsage = featureReport->ContactCountMaximum;
 
@@ -376,7 +386,7 @@ NT status value
 	WDF_REQUEST_PARAMETERS       params;
 	PHIDFX2_FEATURE_REPORT_COUNT       featureReportCount = NULL;
 	PHIDFX2_FEATURE_REPORT_VENDOR       featureReportVendor = NULL;
-	//WDFDEVICE                    device;
+	WDFDEVICE                    device;
 
 	PAGED_CODE();
 
@@ -384,7 +394,7 @@ NT status value
 
 	*BytesReturned = 0;
 
-	//device = WdfIoQueueGetDevice(WdfRequestGetIoQueue(Request));
+	device = WdfIoQueueGetDevice(WdfRequestGetIoQueue(Request));
 
 	WDF_REQUEST_PARAMETERS_INIT(&params);
 	WdfRequestGetParameters(Request, &params);
@@ -431,7 +441,7 @@ NT status value
 	if (transferPacket->reportId == 0x05)
 	{
 		featureReportCount = (PHIDFX2_FEATURE_REPORT_COUNT) transferPacket->reportBuffer;
-		featureReportCount->ContactCountMaximum = 0x05;
+		featureReportCount->ContactCountMaximum = GT82X_MAX_CONTACTS;
 		*BytesReturned = sizeof (HIDFX2_FEATURE_REPORT_COUNT);
 	}
 	else if (transferPacket->reportId == 0x44)
@@ -442,6 +452,14 @@ NT status value
 		*BytesReturned = sizeof (HIDFX2_FEATURE_REPORT_VENDOR);
 
 	}
+	else if (transferPacket->reportId == TOUCH_LATENCY_REPORT_ID)
+	{
+		status = TouchTrackerGetLatencyFeature(&GetDeviceContext(device)->Tracker,
+			GetDeviceContext(device)->OnLock,
+			transferPacket->reportBuffer,
+			transferPacket->reportBufferLen,
+			BytesReturned);
+	}
 	else
 	{
 		status = STATUS_INVALID_DEVICE_REQUEST;
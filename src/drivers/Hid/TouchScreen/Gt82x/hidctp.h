@@ -54,6 +54,9 @@ Revision History:
 #define NTSTRSAFE_LIB
 #include <ntstrsafe.h>
 
+#include "..\spbclient.h"
+#include "..\touchreport.h"
+
 #include "trace.h"
 
 #define AWPRINT(string)		KdPrintEx((DPFLTR_IHVDRIVER_ID,  DPFLTR_INFO_LEVEL, "SPBTEST: "##string##"\n"))
@@ -76,6 +79,14 @@ EVT_WDF_INTERRUPT_DPC					OnInterruptDpc;
 #define POOL_TAG                      (ULONG) 'CTPF'
 #define INPUT_REPORT_BYTES            1
 
+//
+// Point data at 0x0F40: a bitmap of the touched slots, the key byte,
+// 5 bytes per touched slot in slot order (X, Y big endian, width) and
+// a checksum of the coordinate bytes.
+//
+#define GT82X_MAX_CONTACTS            5
+#define GT82X_POINT_LENGTH            5
+
 #define CONSUMER_CONTROL_REPORT_ID    1
 #define SYSTEM_CONTROL_REPORT_ID      2
 #define DIP_SWITCHES_REPORT_ID        3
@@ -287,6 +298,7 @@ CONST HID_REPORT_DESCRIPTOR G_DefaultReportDescriptor[] = {
 	0x75, 0x08,                         //   REPORT_SIZE (8)             
 	0x96, 0x00, 0x01,                   //   REPORT_COUNT (0x100 (256))             
 	0xb1, 0x02,                         //   FEATURE (Data,Var,Abs) 
+	TOUCH_LATENCY_FEATURE_DESCRIPTOR,
 	0xc0, // END_COLLECTION
 };
 
@@ -420,6 +432,8 @@ typedef struct _HIDFX2_INPUT_REPORT {
 
 }HIDFX2_INPUT_REPORT, *PHIDFX2_INPUT_REPORT;
 
+C_ASSERT(sizeof(HIDFX2_INPUT_REPORT) == TOUCH_REPORT_LENGTH(GT82X_MAX_CONTACTS));
+
 
 typedef struct _HIDFX2_FEATURE_REPORT_COUNT {
 	//
@@ -460,10 +474,10 @@ typedef struct _DEVICE_EXTENSION{
 	WDFIOTARGET SpbController;
 
 	//
-	// SPB request object
+	// Preallocated SPB request, reused for every transfer
 	//
 
-	WDFREQUEST SpbRequest;
+	SPB_CLIENT SpbClient;
 
 
 	//
@@ -482,6 +496,15 @@ typedef struct _DEVICE_EXTENSION{
 	UCHAR				Data[30];
 	long				ReportTime;
 
+	TOUCH_TRACKER		Tracker;
+
+	//
+	// Interrupt entry and end of the contact read of the frame handed to
+	// the DPC, in us, for the tracker's latency statistics.
+	//
+	ULONGLONG			InterruptTime;
+	ULONGLONG			ReadTime;
+
 } DEVICE_EXTENSION, *PDEVICE_EXTENSION;
 
 WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(DEVICE_EXTENSION, GetDeviceContext)
@@ -208,75 +208,17 @@ Return Value:
 
 {
 	NTSTATUS Status;
-	WDFMEMORY Memory;
-	WDFREQUEST IoctlRequest;
-	WDF_OBJECT_ATTRIBUTES Attributes;
-	WDF_REQUEST_SEND_OPTIONS SendOptions;
-	WDF_OBJECT_ATTRIBUTES RequestAttributes;
-
-
-	IoctlRequest = NULL;
-	Memory = WDF_NO_HANDLE;
-
-	WDF_OBJECT_ATTRIBUTES_INIT(&RequestAttributes);
-	Status = WdfRequestCreate(&RequestAttributes, pDevice->SpbController, &IoctlRequest);
-	if (!NT_SUCCESS(Status)) {
-		goto Done;
-	}
 
 	if (InBuffer == NULL) {
 		return STATUS_UNSUCCESSFUL;
 	}
 
-	NT_ASSERT(Memory == WDF_NO_HANDLE);
-
-	WDF_OBJECT_ATTRIBUTES_INIT(&Attributes);
-	Attributes.ParentObject = IoctlRequest;
-	Status = WdfMemoryCreatePreallocated(
-		&Attributes,
-		InBuffer,
-		InBufferlength,
-		&Memory);
-
-	if (!NT_SUCCESS(Status)) {
-		goto Done;
-	}
-
-	Status = WdfIoTargetFormatRequestForWrite(
-		pDevice->SpbController,
-		IoctlRequest,
-		Memory,
-		NULL,
-		NULL
-		);
-
-	if (!NT_SUCCESS(Status)) {
-		return Status;
-	}
-
-	WDF_REQUEST_SEND_OPTIONS_INIT(&SendOptions,
-		WDF_REQUEST_SEND_OPTION_SYNCHRONOUS);
-
-	WDF_REQUEST_SEND_OPTIONS_SET_TIMEOUT(&SendOptions,
-		WDF_REL_TIMEOUT_IN_SEC(60));
-
-	Status = WdfRequestAllocateTimer(IoctlRequest);
-	if (!NT_SUCCESS(Status)) {
-		goto Done;
-	}
-
-	if (!WdfRequestSend(IoctlRequest, pDevice->SpbController, &SendOptions)) {
-		Status = WdfRequestGetStatus(IoctlRequest);
-	}
+	Status = SpbClientWrite(&pDevice->SpbClient, InBuffer, InBufferlength);
 
 	if (!NT_SUCCESS(Status)) {
 		KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "gt9xx: SpbRequestWrite fail!\n"));
 	}
 
-Done:
-	if (IoctlRequest != NULL) {
-		WdfObjectDelete(IoctlRequest);
-	}
 	return Status;
 }
 
@@ -303,81 +245,17 @@ Return Value:
 --*/
 {
 	NTSTATUS Status;
-	WDFMEMORY Memory;
-	WDFREQUEST IoctlRequest;
-	WDF_OBJECT_ATTRIBUTES Attributes;
-	WDF_REQUEST_SEND_OPTIONS SendOptions;
-	WDF_OBJECT_ATTRIBUTES RequestAttributes;
-
-	IoctlRequest = NULL;
-	Memory = WDF_NO_HANDLE;
-
-	WDF_OBJECT_ATTRIBUTES_INIT(&RequestAttributes);
-	Status = WdfRequestCreate(&RequestAttributes, pDevice->SpbController, &IoctlRequest);
-	if (!NT_SUCCESS(Status)) {
-		goto Done;
-	}
 
 	if (OutBuffer == NULL) {
 		return STATUS_UNSUCCESSFUL;
 	}
 
-	//
-	// Create preallocated WDFMEMORY. The IOCTL is METHOD_BUFFERED,
-	// so the memory doesn't have to persist until the request is
-	// completed.
-	//
-
-	NT_ASSERT(Memory == WDF_NO_HANDLE);
-
-	WDF_OBJECT_ATTRIBUTES_INIT(&Attributes);
-	Attributes.ParentObject = IoctlRequest;
-	Status = WdfMemoryCreatePreallocated(
-		&Attributes,
-		OutBuffer,
-		OutBufferlength,
-		&Memory);
-
-	if (!NT_SUCCESS(Status))
-	{
-		goto Done;
-	}
-
-	Status = WdfIoTargetFormatRequestForRead(
-		pDevice->SpbController,
-		IoctlRequest,
-		Memory,
-		NULL,
-		NULL
-		);
-
-	if (!NT_SUCCESS(Status)) {
-		goto Done;
-	}
-
-	WDF_REQUEST_SEND_OPTIONS_INIT(&SendOptions,
-		WDF_REQUEST_SEND_OPTION_SYNCHRONOUS);
-
-	WDF_REQUEST_SEND_OPTIONS_SET_TIMEOUT(&SendOptions,
-		WDF_REL_TIMEOUT_IN_SEC(60));
-
-	Status = WdfRequestAllocateTimer(IoctlRequest);
-	if (!NT_SUCCESS(Status)) {
-		goto Done;
-	}
-
-	if (!WdfRequestSend(IoctlRequest, pDevice->SpbController, &SendOptions)) {
-		Status = WdfRequestGetStatus(IoctlRequest);
-	}
+	Status = SpbClientRead(&pDevice->SpbClient, OutBuffer, OutBufferlength, NULL);
 
 	if (!NT_SUCCESS(Status)) {
 		KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "SPBTEST: SpbRequestRead fail! \n"));
 	}
 
-Done:
-	if (IoctlRequest != NULL) {
-		WdfObjectDelete(IoctlRequest);
-	}
 	return Status;
 }
 
@@ -408,118 +286,22 @@ Return Value:
 --*/
 {
 	NTSTATUS Status;
-	WDFMEMORY Memory;
-	WDFREQUEST IoctlRequest;
-	WDF_OBJECT_ATTRIBUTES Attributes;
-	WDF_REQUEST_SEND_OPTIONS SendOptions;
-	WDF_OBJECT_ATTRIBUTES RequestAttributes;
-
-	IoctlRequest = NULL;
-	Memory = WDF_NO_HANDLE;
-
-	WDF_OBJECT_ATTRIBUTES_INIT(&RequestAttributes);
-	Status = WdfRequestCreate(&RequestAttributes, pDevice->SpbController, &IoctlRequest);
-	if (!NT_SUCCESS(Status)) {
-		goto Done;
-	}
-
 
 	if ((InBuffer == NULL) || (OutBuffer == NULL)) {
 		return STATUS_UNSUCCESSFUL;
 	}
 
 	//
-	// Build SPB sequence.
-	//
-
-	const ULONG transfers = 2;
-
-	SPB_TRANSFER_LIST_AND_ENTRIES(2) seq;
-	SPB_TRANSFER_LIST_INIT(&(seq.List), transfers);
-
-	{
-		//
-		// PreFAST cannot figure out the SPB_TRANSFER_LIST_ENTRY
-		// "struct hack" size but using an index variable quiets 
-		// the warning. This is a false positive from OACR.
-		// 
-
-		ULONG index = 0;
-		seq.List.Transfers[index] = SPB_TRANSFER_LIST_ENTRY_INIT_SIMPLE(
-			SpbTransferDirectionToDevice,
-			0,
-			InBuffer,
-			InBufferlength);
-
-		seq.List.Transfers[index + 1] = SPB_TRANSFER_LIST_ENTRY_INIT_SIMPLE(
-			SpbTransferDirectionFromDevice,
-			0,
-			OutBuffer,
-			OutBufferlength);
-	}
-
-	//
-	// Create preallocated WDFMEMORY. The IOCTL is METHOD_BUFFERED,
-	// so the memory doesn't have to persist until the request is
-	// completed.
-	//
-
-	NT_ASSERT(Memory == WDF_NO_HANDLE);
-
-	WDF_OBJECT_ATTRIBUTES_INIT(&Attributes);
-	Attributes.ParentObject = IoctlRequest;
-	Status = WdfMemoryCreatePreallocated(
-		&Attributes,
-		(PVOID) &seq,
-		sizeof(seq),
-		&Memory);
-
-	if (!NT_SUCCESS(Status))
-	{
-		goto Done;
-	}
-
-	//
-	// Format and send the SPB sequence request.
+	// Both transfers go out as one SPB sequence on the preallocated
+	// request, so the controller issues a repeated start between them.
 	//
 
-	Status = WdfIoTargetFormatRequestForIoctl(
-		pDevice->SpbController,
-		IoctlRequest,
-		IOCTL_SPB_EXECUTE_SEQUENCE,
-		Memory,
-		NULL,
-		NULL,
-		NULL);
-
-	if (!NT_SUCCESS(Status))
-	{
-		goto Done;
-	}
-
-	WDF_REQUEST_SEND_OPTIONS_INIT(&SendOptions,
-		WDF_REQUEST_SEND_OPTION_SYNCHRONOUS);
-
-	WDF_REQUEST_SEND_OPTIONS_SET_TIMEOUT(&SendOptions,
-		WDF_REL_TIMEOUT_IN_SEC(60));
-
-	Status = WdfRequestAllocateTimer(IoctlRequest);
-	if (!NT_SUCCESS(Status)) {
-		goto Done;
-	}
-
-	if (!WdfRequestSend(IoctlRequest, pDevice->SpbController, &SendOptions)) {
-		Status = WdfRequestGetStatus(IoctlRequest);
-	}
+	Status = SpbClientWriteRead(&pDevice->SpbClient, InBuffer, InBufferlength, OutBuffer, OutBufferlength);
 
 	if (!NT_SUCCESS(Status)) {
 		KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "gt9xx:SpbRequestWriteRead fail! \n"));
 	}
 
-Done:
-	if (IoctlRequest != NULL) {
-		WdfObjectDelete(IoctlRequest);
-	}
 	return Status;
 }
 
@@ -540,10 +322,15 @@ Return Value:
 
 --*/
 {
-	NTSTATUS Status;
-	UCHAR InPutBufferEnd[] = { 0x81, 0x4E, 0x00 };
-	Status = SpbRequestWrite(pDevice, InPutBufferEnd, 3);
-	return Status;
+	static UCHAR InPutBufferEnd[] = { 0x81, 0x4E, 0x00 };
+
+	//
+	// Nothing waits on the end command, so queue it and let the next
+	// transfer serialize behind it. The buffer is static because the
+	// write completes after this routine returns.
+	//
+
+	return SpbClientWriteAsync(&pDevice->SpbClient, InPutBufferEnd, sizeof(InPutBufferEnd), NULL, NULL);
 
 }
 
@@ -1005,6 +792,19 @@ Return Value:
 	if (!NT_SUCCESS(status))
 	{
 		KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "*****open fail! line:%d*****\n", __LINE__));
+		return status;
+	}
+
+	//
+	// Preallocate the request reused for every transfer to the panel.
+	//
+
+	status = SpbClientInitialize(&pDevice->SpbClient, pDevice->SpbController);
+
+	if (!NT_SUCCESS(status))
+	{
+		KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "*****spb client fail! line:%d*****\n", __LINE__));
+		WdfIoTargetClose(pDevice->SpbController);
 	}
 
 	return status;
@@ -1033,6 +833,7 @@ Return Value:
 	KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "*****close handle to SPB target:%d*****\n", __LINE__));
 
 	WdfIoTargetClose(pDevice->SpbController);
+	SpbClientCleanup(&pDevice->SpbClient);
 
 	return STATUS_SUCCESS;
 }
@@ -1102,7 +903,10 @@ Return Value:
 	}
 
 	pDevice->TouchNum = 0;
+	pDevice->ReadContacts = 0;
 	pDevice->Report = 0;
+	TouchTrackerInitialize(&pDevice->Tracker, 0x01, GT9XX_MAX_CONTACTS);
+	TouchTrackerReadFilterConfig(pDevice->FxDevice, &pDevice->Tracker);
 	pDevice->DataReady = FALSE;
 	pDevice->ReportTime = 0;
 	RtlZeroMemory(pDevice->Data, sizeof(pDevice->Data));
@@ -1174,171 +978,143 @@ Return Value:
 	return STATUS_SUCCESS;
 }
 
-VOID ProcessCtpDataUp(
+VOID ReadCTPData(
 	_In_ PDEVICE_EXTENSION pDevice
 	)
-	// Processing the data up
+	// Read data of CTP
+	//
+	// Status and contacts are fetched with one write-read sized from the
+	// previous frame's contact count, so a steady touch costs one I2C
+	// transaction for the read. Only a frame with more contacts than the
+	// last one needs a second read for the rest. The status is cleared
+	// by a separate write once a ready buffer has been read completely;
+	// clearing a buffer that is not ready yet would drop the frame the
+	// controller is still filling.
 {
+	UCHAR  point_data[2] = { GT9XX_STATUS_REG >> 8, GT9XX_STATUS_REG & 0xff };
+	SPB_CLIENT_TRANSFER transfers[2];
+	ULONG  length;
+	USHORT reg;
+	UCHAR  expected;
+	UCHAR  finger = 0;
+	NTSTATUS Status;
 
+	RtlZeroMemory(pDevice->Data, sizeof(pDevice->Data));
 
-	PHIDFX2_INPUT_REPORT inputReport = NULL;
-	ULONG				 bytesToCopy = 0;
-	size_t				 bytesReturned = 0;
-	WDFREQUEST           request;
-	NTSTATUS status;
-
-
-	status = WdfIoQueueRetrieveNextRequest(pDevice->InterruptMsgQueue, &request);
-	if (NT_SUCCESS(status)) {
-
-		bytesToCopy = sizeof(HIDFX2_INPUT_REPORT);
-
-		if (bytesToCopy == 0) {
-			goto exit_bytes;
-		}
-
-		status = WdfRequestRetrieveOutputBuffer(request,
-			bytesToCopy,
-			&inputReport,
-			&bytesReturned);// BufferLength
-		RtlZeroMemory(inputReport, sizeof(inputReport));
-
-		if (!NT_SUCCESS(status)) {
-			KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "gt9xx:WdfRequestRetrieveOutputBuffer fail! \n"));
-		}
-		else {
-
-			inputReport->ReportTouchId = 0x01;
-			inputReport->ScanTimeLSB = pDevice->ReportTime & 0x00ff;
-			inputReport->ScanTimeMSB = (pDevice->ReportTime & 0xff00) >> 8;
-			inputReport->ContactCount = 0;
-		}
-		bytesReturned = bytesToCopy;
-		WdfRequestCompleteWithInformation(request, status, bytesReturned);
-	}
-	else if (status != STATUS_NO_MORE_ENTRIES) {
-		KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "gt9xx: WdfRequestRetrieveOutputBuffer status is STATUS_NO_MORE_ENTRIES!\n"));
+	expected = pDevice->ReadContacts;
+	if (expected == 0) {
+		expected = 1;
 	}
+	length = GT9XX_READ_LENGTH(expected);
 
-exit_bytes:
-	pDevice->ReportTime += 125;
-	if (pDevice->ReportTime > 0xffff)
-		pDevice->ReportTime = 0;
+	transfers[0].Direction = SpbTransferDirectionToDevice;
+	transfers[0].DelayInUs = 0;
+	transfers[0].Buffer = point_data;
+	transfers[0].Length = sizeof(point_data);
 
-	return;
-}
-
-
-VOID ReadCTPData(
-	_In_ PDEVICE_EXTENSION pDevice
-	)
-	// Read data of CTP
-{
-	UCHAR  point_data[2] = { 0x81, 0x4E };
-	UCHAR  finger = 0;
+	transfers[1].Direction = SpbTransferDirectionFromDevice;
+	transfers[1].DelayInUs = 0;
+	transfers[1].Buffer = pDevice->Data;
+	transfers[1].Length = length;
 
-	RtlZeroMemory(pDevice->Data, sizeof(pDevice->Data));
+	Status = SpbClientSequence(&pDevice->SpbClient, transfers, 2);
+	if (!NT_SUCCESS(Status)) {
+		KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "gt9xx: ReadCTPData fail! 0x%x\n", Status));
+		pDevice->Data[0] = 0;
+		return;
+	}
 
-	SpbRequestWriteRead(pDevice, point_data, 2, &pDevice->Data[0], 12);
-	if ((pDevice->Data[0] & 0x80) == 0) {
+	if ((pDevice->Data[0] & GT9XX_STATUS_READY) == 0) {
 		return;
 	}
-	finger = pDevice->Data[0] & 0x0f;
-	if (finger > 5) {
+	finger = pDevice->Data[0] & GT9XX_STATUS_CONTACTS;
+	if (finger > GT9XX_MAX_CONTACTS) {
+		pDevice->Data[0] = 0;
+		EndCmd(pDevice);
 		return;
 	}
 
-	if (finger > 1){
+	if (finger > expected){
 		UCHAR buf[2];
-		buf[0] = 0x81;
-		buf[1] = 0x4E + 12;
-		SpbRequestWriteRead(pDevice, buf, 2, &pDevice->Data[12], 8 * (finger - 1));
+
+		reg = (USHORT)(GT9XX_STATUS_REG + length);
+		buf[0] = reg >> 8;
+		buf[1] = reg & 0xff;
+		SpbRequestWriteRead(pDevice, buf, 2, &pDevice->Data[length],
+			(UCHAR)(GT9XX_READ_LENGTH(finger) - length));
+		pDevice->ExtraReads++;
 	}
 
 	EndCmd(pDevice);
+
+	pDevice->ReadContacts = finger;
 	return;
 }
 
-VOID ProcessCtpDataDown(
+VOID ProcessCtpData(
 	_In_ PDEVICE_EXTENSION pDevice
 	)
 	// Processing the data, and data will be reported to the system
+	//
+	// The contacts are handed to the tracker, which writes each report of
+	// the frame straight into the output buffer of a pended read.
 {
+	TOUCH_POINT points[GT9XX_MAX_CONTACTS];
 	UCHAR* coor_data = NULL;
 	UCHAR  touch_num = 0;
-	UCHAR	id;
+	UCHAR  idx = 0;
 
-	PHIDFX2_INPUT_REPORT inputReport = NULL;
-	ULONG				 bytesToCopy = 0;
-	size_t				 bytesReturned = 0;
+	PVOID				 inputReport = NULL;
+	size_t				 bufferLength = 0;
+	ULONG				 bytesReturned = 0;
 	WDFREQUEST           request;
 	NTSTATUS status = STATUS_SUCCESS;
 
-	long input_x = 0;
-	long input_y = 0;
-	long input_w = 0;
-	UCHAR idx = 0;
+	touch_num = pDevice->Data[0] & GT9XX_STATUS_CONTACTS;
 
-	touch_num = pDevice->Data[0] & 0xf;
+	for (idx = 0; idx < touch_num; idx++)
+	{
+		coor_data = &pDevice->Data[idx * GT9XX_CONTACT_LENGTH + 1];
 
-	if (touch_num == 0)
-		return;
+		points[idx].Id = coor_data[0] & 0x0F;
+		points[idx].X = (USHORT)(coor_data[1] | (coor_data[2] << 8));
+		points[idx].Y = (USHORT)(coor_data[3] | (coor_data[4] << 8));
+	}
 
-	status = WdfIoQueueRetrieveNextRequest(pDevice->InterruptMsgQueue, &request);
-	if (NT_SUCCESS(status)) {
+	TouchTrackerSetFrameTimes(&pDevice->Tracker, pDevice->InterruptTime, pDevice->ReadTime);
 
-		bytesToCopy = sizeof(HIDFX2_INPUT_REPORT);
+	if (TouchTrackerUpdate(&pDevice->Tracker, points, touch_num, (USHORT)pDevice->ReportTime) != 0) {
 
-		if (bytesToCopy == 0) {
-			goto exit_bytes;
-		}
+		while (pDevice->Tracker.PendingReports != 0) {
 
-		status = WdfRequestRetrieveOutputBuffer(request,
-			bytesToCopy,
-			&inputReport,
-			&bytesReturned);// BufferLength
-		RtlZeroMemory(inputReport, sizeof(HIDFX2_INPUT_REPORT));
+			status = WdfIoQueueRetrieveNextRequest(pDevice->InterruptMsgQueue, &request);
+			if (!NT_SUCCESS(status)) {
+				if (status != STATUS_NO_MORE_ENTRIES) {
+					KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "gt9xx: WdfIoQueueRetrieveNextRequest fail! 0x%x\n", status));
+				}
+				break;
+			}
 
-		if (!NT_SUCCESS(status)) {
-			KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "gt9xx: WdfRequestRetrieveOutputBuffer fail!\n"));
-		}
-		else {
-			for (idx = 0; idx < 5; idx++)
-			{
-				inputReport->ReportData[idx].ContactId = idx;
-				inputReport->ReportData[idx].Tip = 0x00;		
+			bytesReturned = 0;
+			status = WdfRequestRetrieveOutputBuffer(request,
+				sizeof(HIDFX2_INPUT_REPORT),
+				&inputReport,
+				&bufferLength);
+			if (NT_SUCCESS(status)) {
+				bytesReturned = TouchTrackerNextReport(&pDevice->Tracker, inputReport, (ULONG)bufferLength);
+				TouchTrackerReportBuilt(&pDevice->Tracker, TouchTimeUs());
+			}
+			else {
+				KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "gt9xx: WdfRequestRetrieveOutputBuffer fail!\n"));
 			}
 
-			for (idx = 0; idx < touch_num; idx++)
-			{
-				coor_data = &pDevice->Data[idx * 8 + 1];
-
-				id = coor_data[0] & 0x0F;
-				input_x = coor_data[1] | (coor_data[2] << 8);
-				input_y = coor_data[3] | (coor_data[4] << 8);
-				input_w = coor_data[5] | (coor_data[6] << 8);
-
-				inputReport->ReportData[id].Tip = 0x01;
-				inputReport->ReportData[id].ContactId = id;
-				inputReport->ReportData[id].XLSB = input_x & 0x00ff;
-				inputReport->ReportData[id].XMSB = (input_x & 0xff00) >> 8;
-				inputReport->ReportData[id].YLSB = input_y & 0x00ff;
-				inputReport->ReportData[id].YMSB = (input_y & 0xff00) >> 8;
+			WdfRequestCompleteWithInformation(request, status, bytesReturned);
+			if (bytesReturned != 0) {
+				TouchTrackerReportCompleted(&pDevice->Tracker, TouchTimeUs());
 			}
-			inputReport->ReportTouchId = 0x01;
-			inputReport->ScanTimeLSB = pDevice->ReportTime & 0x00ff;
-			inputReport->ScanTimeMSB = (pDevice->ReportTime & 0xff00) >> 8;
-			inputReport->ContactCount = touch_num;
 		}
 	}
-	else if (status != STATUS_NO_MORE_ENTRIES) {
-		KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "gt9xx: WdfRequestRetrieveOutputBuffer status is STATUS_NO_MORE_ENTRIES!\n"));
-	}
 
-exit_bytes:
-	bytesReturned = bytesToCopy;
-	WdfRequestCompleteWithInformation(request, status, bytesReturned);
-	pDevice->TouchNum = touch_num;
 	pDevice->ReportTime += 125;
 	if (pDevice->ReportTime > 0xffff)
 		pDevice->ReportTime = 0;
@@ -1377,9 +1153,12 @@ Return Value:
 	BOOLEAN fInterruptRecognized = TRUE;
 	WDFDEVICE device;
 	PDEVICE_EXTENSION pDevice;
+	ULONGLONG interruptTime;
 
 	UNREFERENCED_PARAMETER(MessageID);
 
+	interruptTime = TouchTimeUs();
+
 	device = WdfInterruptGetDevice(FxInterrupt);
 	pDevice = GetDeviceContext(device);
 	if (pDevice == NULL) {
@@ -1388,8 +1167,11 @@ Return Value:
 
 	ReadCTPData(pDevice); //Read the data
 
-	if (((pDevice->Report & 0x07) == 0x07))
+	if (((pDevice->Report & 0x07) == 0x07)) {
+		pDevice->InterruptTime = interruptTime;
+		pDevice->ReadTime = TouchTimeUs();
 		WdfInterruptQueueDpcForIsr(FxInterrupt);
+	}
 
 	return fInterruptRecognized;
 }
@@ -1418,7 +1200,6 @@ WdfDevice - Associated device object.
 --*/
 {
 	PDEVICE_EXTENSION pDevice = NULL;
-	UCHAR finger = 0;
 
 	UNREFERENCED_PARAMETER(WdfInterrupt);
 
@@ -1428,18 +1209,15 @@ WdfDevice - Associated device object.
 		return;
 	}
 
-	finger = pDevice->Data[0] & 0x0f;
-
-
-	WdfSpinLockAcquire(pDevice->OnLock);
-
-	if (finger!= 0)
-		ProcessCtpDataDown(pDevice);
-	else
-		ProcessCtpDataUp(pDevice);
-
+	//
+	// No frame when the point buffer was not ready or the read failed.
+	//
 
-	WdfSpinLockRelease(pDevice->OnLock);
+	if ((pDevice->Data[0] & GT9XX_STATUS_READY) != 0) {
+		WdfSpinLockAcquire(pDevice->OnLock);
+		ProcessCtpData(pDevice);
+		WdfSpinLockRelease(pDevice->OnLock);
+	}
 
 	pDevice->IsInterruptEnable = TRUE;
 
@@ -241,14 +241,14 @@ Return Value:
 	NTSTATUS                     status = STATUS_SUCCESS;
 	PHID_XFER_PACKET             transferPacket = NULL;
 	WDF_REQUEST_PARAMETERS       params;
-	//WDFDEVICE                    device;
+	WDFDEVICE                    device;
 	//UCHAR                        featureUsage = 0;
 	//PHIDFX2_FEATURE_REPORT_COUNT featureReportCount = NULL;
 	//PHIDFX2_FEATURE_REPORT_VENDOR featureReportVendor = NULL;
 
 	PAGED_CODE();
 
-	//device = WdfIoQueueGetDevice(WdfRequestGetIoQueue(Request));
+	device = WdfIoQueueGetDevice(WdfRequestGetIoQueue(Request));
 
 	WDF_REQUEST_PARAMETERS_INIT(&params);
 	WdfRequestGetParameters(Request, &params);
@@ -284,6 +284,16 @@ Return Value:
 		return status;
 	}
 
+	//
+	// Writing the latency report clears the statistics.
+	//
+	if (transferPacket->reportId == TOUCH_LATENCY_REPORT_ID)
+	{
+		TouchTrackerSetLatencyFeature(&GetDeviceContext(device)->Tracker,
+			GetDeviceContext(device)->OnLock);
+		return status;
+	}
+
 	//featureReport = (PHIDFX2_FEATURE_REPORT)transferPacket->reportBuffer;
 	//featureUsage = featureReport->ContactCountMaximum;
 
@@ -347,14 +357,14 @@ Return Value:
 	WDF_REQUEST_PARAMETERS       params;
 	PHIDFX2_FEATURE_REPORT_COUNT       featureReportCount = NULL;
 	PHIDFX2_FEATURE_REPORT_VENDOR       featureReportVendor = NULL;
-	//WDFDEVICE                    device;
+	WDFDEVICE                    device;
 
 	PAGED_CODE();
 
 
 	*BytesReturned = 0;
 
-	//device = WdfIoQueueGetDevice(WdfRequestGetIoQueue(Request));
+	device = WdfIoQueueGetDevice(WdfRequestGetIoQueue(Request));
 
 	WDF_REQUEST_PARAMETERS_INIT(&params);
 	WdfRequestGetParameters(Request, &params);
@@ -393,7 +403,7 @@ Return Value:
 	if (transferPacket->reportId == 0x05)
 	{
 		featureReportCount = (PHIDFX2_FEATURE_REPORT_COUNT) transferPacket->reportBuffer;
-		featureReportCount->ContactCountMaximum = 0x05;
+		featureReportCount->ContactCountMaximum = GT9XX_MAX_CONTACTS;
 		*BytesReturned = sizeof (HIDFX2_FEATURE_REPORT_COUNT);
 	}
 	else if (transferPacket->reportId == 0x44)
@@ -404,6 +414,14 @@ Return Value:
 		*BytesReturned = sizeof (HIDFX2_FEATURE_REPORT_VENDOR);
 
 	}
+	else if (transferPacket->reportId == TOUCH_LATENCY_REPORT_ID)
+	{
+		status = TouchTrackerGetLatencyFeature(&GetDeviceContext(device)->Tracker,
+			GetDeviceContext(device)->OnLock,
+			transferPacket->reportBuffer,
+			transferPacket->reportBufferLen,
+			BytesReturned);
+	}
 	else
 	{
 		status = STATUS_INVALID_DEVICE_REQUEST;
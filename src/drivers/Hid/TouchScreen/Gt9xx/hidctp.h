@@ -54,7 +54,10 @@ Revision History:
 #define NTSTRSAFE_LIB
 #include <ntstrsafe.h>
 
-#define AWPRINT(string)		KdPrintEx((DPFLTR_IHVDRIVER_ID,  DPFLTR_INFO_LEVEL, "SPBTEST: "##string##"\n"))
+#include "../spbclient.h"
+#include "../touchreport.h"
+
+#define AWPRINT(string)		KdPrintEx((DPFLTR_IHVDRIVER_ID,  DPFLTR_INFO_LEVEL, "SPBTEST: " string "\n"))
 
 EVT_WDF_INTERRUPT_ISR					OnInterruptIsr;
 EVT_WDF_INTERRUPT_DPC					OnInterruptDpc;
@@ -87,6 +90,18 @@ EVT_WDF_INTERRUPT_DPC					OnInterruptDpc;
 
 #define SWICTHPACK_DEBOUNCE_TIME_IN_MS   10 
 
+//
+// GT9xx point buffer: the status byte at 0x814E (bit 7 buffer ready,
+// bits 0-3 number of contacts) followed by 8 bytes per contact. The
+// panel configuration enables the controller's full 10 contacts.
+//
+#define GT9XX_MAX_CONTACTS               10
+#define GT9XX_CONTACT_LENGTH             8
+#define GT9XX_STATUS_REG                 0x814E
+#define GT9XX_STATUS_READY               0x80
+#define GT9XX_STATUS_CONTACTS            0x0F
+#define GT9XX_READ_LENGTH(Contacts)      (1 + (Contacts) * GT9XX_CONTACT_LENGTH)
+
 typedef UCHAR HID_REPORT_DESCRIPTOR, *PHID_REPORT_DESCRIPTOR;
 
 //
@@ -102,6 +117,41 @@ typedef UCHAR HID_REPORT_DESCRIPTOR, *PHID_REPORT_DESCRIPTOR;
 
 
 
+//
+// One contact of the touch report: tip switch, contact identifier, X and Y.
+//
+#define GT9XX_FINGER_COLLECTION \
+	0x05, 0x0d,                         /* USAGE_PAGE (Digitizers) */ \
+	0x09, 0x22,                         /* USAGE (Finger) */ \
+	0xa1, 0x02,                         /* COLLECTION (Logical) */ \
+	0x09, 0x42,                         /* USAGE (Tip Switch) */ \
+	0x15, 0x00,                         /* LOGICAL_MINIMUM (0) */ \
+	0x25, 0x01,                         /* LOGICAL_MAXIMUM (1) */ \
+	0x75, 0x01,                         /* REPORT_SIZE (1) */ \
+	0x95, 0x01,                         /* REPORT_COUNT (1) */ \
+	0x81, 0x02,                         /* INPUT (Data,Var,Abs) */ \
+	0x95, 0x07,                         /* REPORT_COUNT (7) */ \
+	0x81, 0x03,                         /* INPUT (Cnst,Ary,Abs) */ \
+	0x75, 0x08,                         /* REPORT_SIZE (8) */ \
+	0x09, 0x51,                         /* USAGE (Contact Identifier) */ \
+	0x95, 0x01,                         /* REPORT_COUNT (1) */ \
+	0x81, 0x02,                         /* INPUT (Data,Var,Abs) */ \
+	0x05, 0x01,                         /* USAGE_PAGE (Generic Desk.. */ \
+	0x26, 0x00, 0x06,                   /* LOGICAL_MAXIMUM (1536) */ \
+	0x75, 0x10,                         /* REPORT_SIZE (16) */ \
+	0x55, 0x0e,                         /* UNIT_EXPONENT (-2) */ \
+	0x65, 0x13,                         /* UNIT(Inch,EngLinear) */ \
+	0x09, 0x30,                         /* USAGE (X) */ \
+	0x35, 0x00,                         /* PHYSICAL_MINIMUM (0) */ \
+	0x46, 0x58, 0x02,                   /* PHYSICAL_MAXIMUM (600) */ \
+	0x95, 0x01,                         /* REPORT_COUNT (1) */ \
+	0x81, 0x02,                         /* INPUT (Data,Var,Abs) */ \
+	0x46, 0x90, 0x01,                   /* PHYSICAL_MAXIMUM (400) */ \
+	0x26, 0x00, 0x08,                   /* LOGICAL_MAXIMUM (2048) */ \
+	0x09, 0x31,                         /* USAGE (Y) */ \
+	0x81, 0x02,                         /* INPUT (Data,Var,Abs) */ \
+	0xc0                                /* END_COLLECTION */
+
 #ifdef USE_HARDCODED_HID_REPORT_DESCRIPTOR
 
 CONST HID_REPORT_DESCRIPTOR G_DefaultReportDescriptor[] = {
@@ -109,155 +159,16 @@ CONST HID_REPORT_DESCRIPTOR G_DefaultReportDescriptor[] = {
 	0x09, 0x04, // USAGE (Touch Screen)             
 	0xa1, 0x01, // COLLECTION (Application)  
 	0x85, 0x01,                         // REPORT_ID (Touch)
-	0x09, 0x22,                         // USAGE (Finger)                 
-	0xa1, 0x02,                         // COLLECTION (Logical)
-	0x09, 0x42,                         // USAGE (Tip Switch)           
-	0x15, 0x00,                         // LOGICAL_MINIMUM (0)          
-	0x25, 0x01,                         // LOGICAL_MAXIMUM (1)          
-	0x75, 0x01,                         // REPORT_SIZE (1)              
-	0x95, 0x01,                         // REPORT_COUNT (1)             
-	0x81, 0x02,                         // INPUT (Data,Var,Abs) 
-	0x95, 0x07,                         // REPORT_COUNT (7)  
-	0x81, 0x03,                         // INPUT (Cnst,Ary,Abs)
-	0x75, 0x08,                         // REPORT_SIZE (8)
-	0x09, 0x51,                         // USAGE (Contact Identifier)
-	0x95, 0x01,                         // REPORT_COUNT (1)             
-	0x81, 0x02,                         // INPUT (Data,Var,Abs) 
-	0x05, 0x01,                         // USAGE_PAGE (Generic Desk..
-	0x26, 0x00, 0x06,                   // LOGICAL_MAXIMUM (1536)         
-	0x75, 0x10,                         // REPORT_SIZE (16)             
-	0x55, 0x0e,                         // UNIT_EXPONENT (-2)           
-	0x65, 0x13,                         // UNIT(Inch,EngLinear)                  
-	0x09, 0x30,                         // USAGE (X)                    
-	0x35, 0x00,                         // PHYSICAL_MINIMUM (0)         
-	0x46, 0x58, 0x02,                   // PHYSICAL_MAXIMUM (600)
-	0x95, 0x01,                         // REPORT_COUNT (1)         
-	0x81, 0x02,                         // INPUT (Data,Var,Abs) 
-	0x46, 0x90, 0x01,                   // PHYSICAL_MAXIMUM (400)
-	0x26, 0x00, 0x08,                   // LOGICAL_MAXIMUM (2048) 
-	0x09, 0x31,                         // USAGE (Y)                    
-	0x81, 0x02,                         // INPUT (Data,Var,Abs)
-	0xc0, //     END_COLLECTION
-	0x05, 0x0d,                         // USAGE_PAGE (Digitizers)
-	0x09, 0x22,                         // USAGE (Finger)                 
-	0xa1, 0x02,                         // COLLECTION (Logical)
-	0x09, 0x42,                         // USAGE (Tip Switch)           
-	0x15, 0x00,                         // LOGICAL_MINIMUM (0)          
-	0x25, 0x01,                         // LOGICAL_MAXIMUM (1)          
-	0x75, 0x01,                         // REPORT_SIZE (1)              
-	0x95, 0x01,                         // REPORT_COUNT (1)             
-	0x81, 0x02,                         // INPUT (Data,Var,Abs) 
-	0x95, 0x07,                         // REPORT_COUNT (7)  
-	0x81, 0x03,                         // INPUT (Cnst,Ary,Abs)
-	0x75, 0x08,                         // REPORT_SIZE (8)
-	0x09, 0x51,                         // USAGE (Contact Identifier)
-	0x95, 0x01,                         // REPORT_COUNT (1)             
-	0x81, 0x02,                         // INPUT (Data,Var,Abs) 
-	0x05, 0x01,                         // USAGE_PAGE (Generic Desk..
-	0x26, 0x00, 0x06,                   // LOGICAL_MAXIMUM (1536)         
-	0x75, 0x10,                         // REPORT_SIZE (16)             
-	0x55, 0x0e,                         // UNIT_EXPONENT (-2)           
-	0x65, 0x13,                         // UNIT(Inch,EngLinear)                  
-	0x09, 0x30,                         // USAGE (X)                    
-	0x35, 0x00,                         // PHYSICAL_MINIMUM (0)         
-	0x46, 0x58, 0x02,                   // PHYSICAL_MAXIMUM (600)
-	0x95, 0x01,                         // REPORT_COUNT (1)         
-	0x81, 0x02,                         // INPUT (Data,Var,Abs) 
-	0x46, 0x90, 0x01,                   // PHYSICAL_MAXIMUM (400)
-	0x26, 0x00, 0x08,                   // LOGICAL_MAXIMUM (2048) 
-	0x09, 0x31,                         // USAGE (Y)                    
-	0x81, 0x02,                         // INPUT (Data,Var,Abs)
-	0xc0, //     END_COLLECTION
-	0x05, 0x0d,                         // USAGE_PAGE (Digitizers)
-	0x09, 0x22,                         // USAGE (Finger)                 
-	0xa1, 0x02,                         // COLLECTION (Logical)
-	0x09, 0x42,                         // USAGE (Tip Switch)           
-	0x15, 0x00,                         // LOGICAL_MINIMUM (0)          
-	0x25, 0x01,                         // LOGICAL_MAXIMUM (1)          
-	0x75, 0x01,                         // REPORT_SIZE (1)              
-	0x95, 0x01,                         // REPORT_COUNT (1)             
-	0x81, 0x02,                         // INPUT (Data,Var,Abs) 
-	0x95, 0x07,                         // REPORT_COUNT (7)  
-	0x81, 0x03,                         // INPUT (Cnst,Ary,Abs)
-	0x75, 0x08,                         // REPORT_SIZE (8)
-	0x09, 0x51,                         // USAGE (Contact Identifier)
-	0x95, 0x01,                         // REPORT_COUNT (1)             
-	0x81, 0x02,                         // INPUT (Data,Var,Abs) 
-	0x05, 0x01,                         // USAGE_PAGE (Generic Desk..
-	0x26, 0x00, 0x06,                   // LOGICAL_MAXIMUM (1536)         
-	0x75, 0x10,                         // REPORT_SIZE (16)             
-	0x55, 0x0e,                         // UNIT_EXPONENT (-2)           
-	0x65, 0x13,                         // UNIT(Inch,EngLinear)                  
-	0x09, 0x30,                         // USAGE (X)                    
-	0x35, 0x00,                         // PHYSICAL_MINIMUM (0)         
-	0x46, 0x58, 0x02,                   // PHYSICAL_MAXIMUM (600)
-	0x95, 0x01,                         // REPORT_COUNT (1)         
-	0x81, 0x02,                         // INPUT (Data,Var,Abs) 
-	0x46, 0x90, 0x01,                   // PHYSICAL_MAXIMUM (400)
-	0x26, 0x00, 0x08,                   // LOGICAL_MAXIMUM (2048) 
-	0x09, 0x31,                         // USAGE (Y)                    
-	0x81, 0x02,                         // INPUT (Data,Var,Abs)
-	0xc0, //     END_COLLECTION
-	0x05, 0x0d,                         // USAGE_PAGE (Digitizers)
-	0x09, 0x22,                         // USAGE (Finger)                 
-	0xa1, 0x02,                         // COLLECTION (Logical)
-	0x09, 0x42,                         // USAGE (Tip Switch)           
-	0x15, 0x00,                         // LOGICAL_MINIMUM (0)          
-	0x25, 0x01,                         // LOGICAL_MAXIMUM (1)          
-	0x75, 0x01,                         // REPORT_SIZE (1)              
-	0x95, 0x01,                         // REPORT_COUNT (1)             
-	0x81, 0x02,                         // INPUT (Data,Var,Abs) 
-	0x95, 0x07,                         // REPORT_COUNT (7)  
-	0x81, 0x03,                         // INPUT (Cnst,Ary,Abs)
-	0x75, 0x08,                         // REPORT_SIZE (8)
-	0x09, 0x51,                         // USAGE (Contact Identifier)
-	0x95, 0x01,                         // REPORT_COUNT (1)             
-	0x81, 0x02,                         // INPUT (Data,Var,Abs) 
-	0x05, 0x01,                         // USAGE_PAGE (Generic Desk..
-	0x26, 0x00, 0x06,                   // LOGICAL_MAXIMUM (1536)         
-	0x75, 0x10,                         // REPORT_SIZE (16)             
-	0x55, 0x0e,                         // UNIT_EXPONENT (-2)           
-	0x65, 0x13,                         // UNIT(Inch,EngLinear)                  
-	0x09, 0x30,                         // USAGE (X)                    
-	0x35, 0x00,                         // PHYSICAL_MINIMUM (0)         
-	0x46, 0x58, 0x02,                   // PHYSICAL_MAXIMUM (600)
-	0x95, 0x01,                         // REPORT_COUNT (1)         
-	0x81, 0x02,                         // INPUT (Data,Var,Abs) 
-	0x46, 0x90, 0x01,                   // PHYSICAL_MAXIMUM (400)
-	0x26, 0x00, 0x08,                   // LOGICAL_MAXIMUM (2048) 
-	0x09, 0x31,                         // USAGE (Y)                    
-	0x81, 0x02,                         // INPUT (Data,Var,Abs)
-	0xc0, //     END_COLLECTION
-	0x05, 0x0d,                         // USAGE_PAGE (Digitizers)
-	0x09, 0x22,                         // USAGE (Finger)                 
-	0xa1, 0x02,                         // COLLECTION (Logical)
-	0x09, 0x42,                         // USAGE (Tip Switch)           
-	0x15, 0x00,                         // LOGICAL_MINIMUM (0)          
-	0x25, 0x01,                         // LOGICAL_MAXIMUM (1)          
-	0x75, 0x01,                         // REPORT_SIZE (1)              
-	0x95, 0x01,                         // REPORT_COUNT (1)             
-	0x81, 0x02,                         // INPUT (Data,Var,Abs) 
-	0x95, 0x07,                         // REPORT_COUNT (7)  
-	0x81, 0x03,                         // INPUT (Cnst,Ary,Abs)
-	0x75, 0x08,                         // REPORT_SIZE (8)
-	0x09, 0x51,                         // USAGE (Contact Identifier)
-	0x95, 0x01,                         // REPORT_COUNT (1)             
-	0x81, 0x02,                         // INPUT (Data,Var,Abs) 
-	0x05, 0x01,                         // USAGE_PAGE (Generic Desk..
-	0x26, 0x00, 0x06,                   // LOGICAL_MAXIMUM (1536)         
-	0x75, 0x10,                         // REPORT_SIZE (16)             
-	0x55, 0x0e,                         // UNIT_EXPONENT (-2)           
-	0x65, 0x13,                         // UNIT(Inch,EngLinear)                  
-	0x09, 0x30,                         // USAGE (X)                    
-	0x35, 0x00,                         // PHYSICAL_MINIMUM (0)         
-	0x46, 0x58, 0x02,                   // PHYSICAL_MAXIMUM (600)
-	0x95, 0x01,                         // REPORT_COUNT (1)         
-	0x81, 0x02,                         // INPUT (Data,Var,Abs) 
-	0x46, 0x90, 0x01,                   // PHYSICAL_MAXIMUM (400)
-	0x26, 0x00, 0x08,                   // LOGICAL_MAXIMUM (2048) 
-	0x09, 0x31,                         // USAGE (Y)                    
-	0x81, 0x02,                         // INPUT (Data,Var,Abs)
-	0xc0, //     END_COLLECTION
+	GT9XX_FINGER_COLLECTION,
+	GT9XX_FINGER_COLLECTION,
+	GT9XX_FINGER_COLLECTION,
+	GT9XX_FINGER_COLLECTION,
+	GT9XX_FINGER_COLLECTION,
+	GT9XX_FINGER_COLLECTION,
+	GT9XX_FINGER_COLLECTION,
+	GT9XX_FINGER_COLLECTION,
+	GT9XX_FINGER_COLLECTION,
+	GT9XX_FINGER_COLLECTION,
 	0x05, 0x0d,                         //   USAGE_PAGE (Digitizers)
 	0x55, 0x0C,                         //   UNIT_EXPONENT (-4)           
 	0x66, 0x01, 0x10,                   //   UNIT (Seconds)        
@@ -285,6 +196,7 @@ CONST HID_REPORT_DESCRIPTOR G_DefaultReportDescriptor[] = {
 	0x75, 0x08,                         //   REPORT_SIZE (8)             
 	0x96, 0x00, 0x01,                   //   REPORT_COUNT (0x100 (256))             
 	0xb1, 0x02,                         //   FEATURE (Data,Var,Abs) 
+	TOUCH_LATENCY_FEATURE_DESCRIPTOR,
 	0xc0, // END_COLLECTION
 };
 
@@ -383,7 +295,7 @@ typedef struct _INPUT_REPORT_DATA{
 typedef struct _HIDFX2_INPUT_REPORT {
 	BYTE ReportTouchId;			//Report ID for the collection
 
-	INPUT_REPORT_DATA ReportData[5]; //X,Y axis data
+	INPUT_REPORT_DATA ReportData[GT9XX_MAX_CONTACTS]; //X,Y axis data
 
 	BYTE ScanTimeLSB;			//The Scan Time LSB			
 	BYTE ScanTimeMSB;			//The Scan Time LSB	
@@ -391,6 +303,8 @@ typedef struct _HIDFX2_INPUT_REPORT {
 
 }HIDFX2_INPUT_REPORT, *PHIDFX2_INPUT_REPORT;
 
+C_ASSERT(sizeof(HIDFX2_INPUT_REPORT) == TOUCH_REPORT_LENGTH(GT9XX_MAX_CONTACTS));
+
 //typedef struct _HIDFX2_INPUT_REPORT {
 //
 //	BYTE ReportTouchId;			//Report ID for the collection
@@ -476,10 +390,10 @@ typedef struct _DEVICE_EXTENSION{
 	WDFIOTARGET SpbController;
 
 	//
-	// SPB request object
+	// Preallocated SPB request, reused for every transfer
 	//
 
-	WDFREQUEST SpbRequest;
+	SPB_CLIENT SpbClient;
 
 
 	//
@@ -495,9 +409,25 @@ typedef struct _DEVICE_EXTENSION{
 	BOOLEAN				IsInit;
 
 	BOOLEAN				DataReady;
-	UCHAR				Data[84];
+	UCHAR				Data[GT9XX_READ_LENGTH(GT9XX_MAX_CONTACTS)];
+
+	//
+	// Contacts in the last frame read, sizes the next read. ExtraReads
+	// counts frames that had more contacts and needed a second read.
+	//
+	UCHAR				ReadContacts;
+	ULONG				ExtraReads;
+
+	TOUCH_TRACKER		Tracker;
 	long				ReportTime;
 
+	//
+	// Interrupt entry and end of the contact read of the frame handed to
+	// the DPC, in us, for the tracker's latency statistics.
+	//
+	ULONGLONG			InterruptTime;
+	ULONGLONG			ReadTime;
+
 } DEVICE_EXTENSION, *PDEVICE_EXTENSION;
 
 WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(DEVICE_EXTENSION, GetDeviceContext)
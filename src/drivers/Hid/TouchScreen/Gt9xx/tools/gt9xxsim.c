@@ -0,0 +1,980 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	gt9xxsim.c
+
+Abstract:
+
+	Reads contact frames with ReadCTPData of gt9xx.c from a fake GT9xx
+	register map behind a fake SPB client. The fake keeps the point
+	buffer at GT9XX_STATUS_REG: a frame lands only while the status
+	byte is clear, and the next queued frame lands as soon as the
+	driver clears it, the earliest a real controller could. Cases:
+
+		idle        the buffer is not ready, nothing is written
+		late frame  a frame lands between the status read and the
+		            end of the sequence, the next read still gets it
+		one contact read in one transaction, then cleared
+		more        a frame with more contacts than the last one,
+		            the rest is read before the clear, so it does not
+		            mix with the frame queued behind it
+		bad count   a status with more than GT9XX_MAX_CONTACTS
+		            contacts is dropped and cleared
+		bus error   a failed read leaves the status alone
+		report      a frame goes from the interrupt through the DPC
+		            into the input report of a pended read
+		latency     the report descriptor carries feature report
+		            TOUCH_LATENCY_REPORT_ID, getting it returns the
+		            statistics under the report lock, setting it
+		            clears them
+
+	and prints the bus transactions a steady two finger touch costs
+	per frame.
+
+	Build and use on any host with a C compiler:
+
+		cc -O2 -D_KERNEL_MODE -I../../../../../tools/host -I.. -o gt9xxsim gt9xxsim.c ../gt9xx.c ../../touchreport.c
+		gt9xxsim
+
+Environment:
+
+	user mode
+
+--*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+//
+// For the report descriptor, hid.c defines it the same way.
+//
+#define USE_HARDCODED_HID_REPORT_DESCRIPTOR
+
+#include "hidctp.h"
+
+//
+// gt9xx.c defines it ahead of its only caller, hidctp.h does not declare it.
+//
+VOID
+ReadCTPData(
+	_In_ PDEVICE_EXTENSION pDevice
+	);
+
+#define FAKE_REG_BASE			0x8000
+#define FAKE_REG_COUNT			0x200
+#define FAKE_FRAMES				8
+#define NEVER					0xffffffff
+
+typedef struct _FAKE_POINT
+{
+	UCHAR Id;
+	USHORT X;
+	USHORT Y;
+}FAKE_POINT;
+
+typedef struct _FAKE_FRAME
+{
+	UCHAR Contacts;
+	UCHAR Status;
+	FAKE_POINT Points[GT9XX_MAX_CONTACTS];
+}FAKE_FRAME;
+
+typedef struct _FAKE_PANEL
+{
+	UCHAR Regs[FAKE_REG_COUNT];
+	USHORT Pointer;
+
+	//
+	// Frames waiting for the point buffer, the first one lands once
+	// the status is clear and LandAt transfers were seen.
+	//
+	FAKE_FRAME Queue[FAKE_FRAMES];
+	ULONG Queued;
+	ULONG LandAt;
+
+	ULONG FailAt;
+
+	ULONG Transfers;
+	ULONG Transactions;
+	ULONG StatusWrites;
+	ULONG Landed;
+}FAKE_PANEL;
+
+static FAKE_PANEL g_Panel;
+static DEVICE_EXTENSION g_Extension;
+static LONGLONG g_Time;
+static int g_Failures;
+
+static HIDFX2_INPUT_REPORT g_Report;
+static BOOLEAN g_ReportPended;
+static ULONG_PTR g_ReportLength;
+
+static ULONG g_LockAcquires;
+static LONG g_LockHeld;
+
+static void
+Check(int Condition, const char *Case, const char *What)
+{
+	if (!Condition)
+	{
+		printf("FAIL %s: %s\n", Case, What);
+		g_Failures++;
+	}
+}
+
+//
+// -------------------------------------------------------------- Fake panel
+//
+
+static PUCHAR
+FakeReg(ULONG Address)
+{
+	static UCHAR none;
+
+	if (Address < FAKE_REG_BASE || Address >= FAKE_REG_BASE + FAKE_REG_COUNT)
+	{
+		none = 0;
+		return &none;
+	}
+
+	return &g_Panel.Regs[Address - FAKE_REG_BASE];
+}
+
+static void
+FakeLand(void)
+{
+	FAKE_FRAME *frame = &g_Panel.Queue[0];
+	PUCHAR record;
+	ULONG i;
+
+	if (g_Panel.Queued == 0 || g_Panel.Transfers < g_Panel.LandAt ||
+		(*FakeReg(GT9XX_STATUS_REG) & GT9XX_STATUS_READY) != 0)
+	{
+		return;
+	}
+
+	for (i = 0; i < frame->Contacts; i++)
+	{
+		record = FakeReg(GT9XX_STATUS_REG + 1 + i * GT9XX_CONTACT_LENGTH);
+		record[0] = frame->Points[i].Id;
+		record[1] = (UCHAR)frame->Points[i].X;
+		record[2] = (UCHAR)(frame->Points[i].X >> 8);
+		record[3] = (UCHAR)frame->Points[i].Y;
+		record[4] = (UCHAR)(frame->Points[i].Y >> 8);
+		record[5] = 0x20;
+		record[6] = 0x00;
+		record[7] = 0x00;
+	}
+	*FakeReg(GT9XX_STATUS_REG) = frame->Status;
+
+	g_Panel.Queued--;
+	memmove(&g_Panel.Queue[0], &g_Panel.Queue[1], g_Panel.Queued * sizeof(FAKE_FRAME));
+	g_Panel.LandAt = 0;
+	g_Panel.Landed++;
+}
+
+static NTSTATUS
+FakeTransfer(SPB_TRANSFER_DIRECTION Direction, PUCHAR Buffer, ULONG Length)
+{
+	ULONG i;
+
+	g_Panel.Transfers++;
+	g_Time += ((1 + Length) * 9 * 10000000LL) / 400000;
+
+	if (g_Panel.Transfers == g_Panel.FailAt)
+	{
+		return STATUS_IO_TIMEOUT;
+	}
+
+	if (Direction == SpbTransferDirectionToDevice)
+	{
+		g_Panel.Pointer = (USHORT)((Buffer[0] << 8) | Buffer[1]);
+		for (i = 2; i < Length; i++)
+		{
+			if (g_Panel.Pointer == GT9XX_STATUS_REG)
+			{
+				g_Panel.StatusWrites++;
+			}
+			*FakeReg(g_Panel.Pointer++) = Buffer[i];
+		}
+	}
+	else
+	{
+		for (i = 0; i < Length; i++)
+		{
+			Buffer[i] = *FakeReg(g_Panel.Pointer++);
+		}
+	}
+
+	FakeLand();
+	return STATUS_SUCCESS;
+}
+
+static void
+FakeQueue(UCHAR Contacts, ULONG Seed)
+{
+	FAKE_FRAME *frame = &g_Panel.Queue[g_Panel.Queued++];
+	ULONG i;
+
+	frame->Contacts = Contacts;
+	frame->Status = GT9XX_STATUS_READY | Contacts;
+	for (i = 0; i < Contacts && i < GT9XX_MAX_CONTACTS; i++)
+	{
+		frame->Points[i].Id = (UCHAR)i;
+		frame->Points[i].X = (USHORT)(Seed * 16 + i * 100);
+		frame->Points[i].Y = (USHORT)(Seed * 8 + i * 50);
+	}
+
+	FakeLand();
+}
+
+static void
+FakeReset(void)
+{
+	memset(&g_Panel, 0, sizeof(g_Panel));
+	g_Panel.FailAt = NEVER;
+
+	memset(&g_Extension.Data, 0, sizeof(g_Extension.Data));
+	g_Extension.ReadContacts = 0;
+	g_Extension.ExtraReads = 0;
+}
+
+NTSTATUS
+SpbClientSequence(
+	_In_ PSPB_CLIENT Client,
+	_In_reads_(TransferCount) PSPB_CLIENT_TRANSFER Transfers,
+	_In_ ULONG TransferCount
+	)
+{
+	NTSTATUS status = STATUS_SUCCESS;
+	ULONG i;
+
+	UNREFERENCED_PARAMETER(Client);
+
+	g_Panel.Transactions++;
+	for (i = 0; i < TransferCount && NT_SUCCESS(status); i++)
+	{
+		status = FakeTransfer(Transfers[i].Direction, Transfers[i].Buffer, Transfers[i].Length);
+	}
+
+	return status;
+}
+
+NTSTATUS
+SpbClientWrite(
+	_In_ PSPB_CLIENT Client,
+	_In_reads_(Length) PVOID Buffer,
+	_In_ ULONG Length
+	)
+{
+	UNREFERENCED_PARAMETER(Client);
+
+	g_Panel.Transactions++;
+	return FakeTransfer(SpbTransferDirectionToDevice, Buffer, Length);
+}
+
+NTSTATUS
+SpbClientWriteAsync(
+	_In_ PSPB_CLIENT Client,
+	_In_reads_(Length) PVOID Buffer,
+	_In_ ULONG Length,
+	_In_opt_ PFN_SPB_CLIENT_COMPLETION Completion,
+	_In_opt_ PVOID Context
+	)
+{
+	NTSTATUS status;
+
+	status = SpbClientWrite(Client, Buffer, Length);
+	if (Completion != NULL)
+	{
+		Completion(Client, status, Length, Context);
+	}
+
+	return STATUS_SUCCESS;
+}
+
+NTSTATUS
+SpbClientRead(
+	_In_ PSPB_CLIENT Client,
+	_Out_writes_(Length) PVOID Buffer,
+	_In_ ULONG Length,
+	_Out_opt_ PULONG_PTR BytesRead
+	)
+{
+	NTSTATUS status;
+
+	UNREFERENCED_PARAMETER(Client);
+
+	g_Panel.Transactions++;
+	status = FakeTransfer(SpbTransferDirectionFromDevice, Buffer, Length);
+	if (BytesRead != NULL)
+	{
+		*BytesRead = NT_SUCCESS(status) ? Length : 0;
+	}
+
+	return status;
+}
+
+NTSTATUS
+SpbClientWriteRead(
+	_In_ PSPB_CLIENT Client,
+	_In_reads_(WriteLength) PVOID WriteBuffer,
+	_In_ ULONG WriteLength,
+	_Out_writes_(ReadLength) PVOID ReadBuffer,
+	_In_ ULONG ReadLength
+	)
+{
+	SPB_CLIENT_TRANSFER transfers[2];
+
+	transfers[0].Direction = SpbTransferDirectionToDevice;
+	transfers[0].DelayInUs = 0;
+	transfers[0].Buffer = WriteBuffer;
+	transfers[0].Length = WriteLength;
+
+	transfers[1].Direction = SpbTransferDirectionFromDevice;
+	transfers[1].DelayInUs = 0;
+	transfers[1].Buffer = ReadBuffer;
+	transfers[1].Length = ReadLength;
+
+	return SpbClientSequence(Client, transfers, 2);
+}
+
+NTSTATUS
+SpbClientInitialize(
+	_Out_ PSPB_CLIENT Client,
+	_In_ WDFIOTARGET Target
+	)
+{
+	Client->Target = Target;
+	Client->IsInit = TRUE;
+	return STATUS_SUCCESS;
+}
+
+VOID
+SpbClientCleanup(
+	_Inout_ PSPB_CLIENT Client
+	)
+{
+	Client->IsInit = FALSE;
+}
+
+//
+// ---------------------------------------------------- Kernel and framework
+//
+
+PVOID
+WdfObjectGetTypedContextWorker(
+	_In_ WDFOBJECT Handle
+	)
+{
+	UNREFERENCED_PARAMETER(Handle);
+
+	return &g_Extension;
+}
+
+VOID
+WdfObjectDelete(
+	_In_ WDFOBJECT Object
+	)
+{
+	UNREFERENCED_PARAMETER(Object);
+}
+
+NTSTATUS
+KeDelayExecutionThread(
+	_In_ KPROCESSOR_MODE WaitMode,
+	_In_ BOOLEAN Alertable,
+	_In_ PLARGE_INTEGER Interval
+	)
+{
+	UNREFERENCED_PARAMETER(WaitMode);
+	UNREFERENCED_PARAMETER(Alertable);
+
+	g_Time -= Interval->QuadPart;
+	return STATUS_SUCCESS;
+}
+
+LARGE_INTEGER
+KeQueryPerformanceCounter(
+	_Out_opt_ PLARGE_INTEGER PerformanceFrequency
+	)
+{
+	LARGE_INTEGER counter;
+
+	if (PerformanceFrequency != NULL)
+	{
+		PerformanceFrequency->QuadPart = 10000000;
+	}
+
+	g_Time += 10;
+	counter.QuadPart = g_Time;
+	return counter;
+}
+
+NTSTATUS
+WdfInterruptCreate(
+	_In_ WDFDEVICE Device,
+	_In_ PWDF_INTERRUPT_CONFIG Configuration,
+	_In_opt_ PWDF_OBJECT_ATTRIBUTES Attributes,
+	_Out_ WDFINTERRUPT *Interrupt
+	)
+{
+	UNREFERENCED_PARAMETER(Device);
+	UNREFERENCED_PARAMETER(Configuration);
+	UNREFERENCED_PARAMETER(Attributes);
+
+	*Interrupt = NULL;
+	return STATUS_NOT_FOUND;
+}
+
+WDFDEVICE
+WdfInterruptGetDevice(
+	_In_ WDFINTERRUPT Interrupt
+	)
+{
+	UNREFERENCED_PARAMETER(Interrupt);
+
+	return (WDFDEVICE)&g_Extension;
+}
+
+BOOLEAN
+WdfInterruptQueueDpcForIsr(
+	_In_ WDFINTERRUPT Interrupt
+	)
+{
+	OnInterruptDpc(Interrupt, (WDFOBJECT)&g_Extension);
+	return TRUE;
+}
+
+VOID
+WdfSpinLockAcquire(
+	_In_ WDFSPINLOCK SpinLock
+	)
+{
+	UNREFERENCED_PARAMETER(SpinLock);
+
+	g_LockAcquires++;
+	g_LockHeld++;
+}
+
+VOID
+WdfSpinLockRelease(
+	_In_ WDFSPINLOCK SpinLock
+	)
+{
+	UNREFERENCED_PARAMETER(SpinLock);
+
+	g_LockHeld--;
+}
+
+//
+// The fake has no resources, GPIO or registry, only the pended read of
+// the report case.
+//
+
+ULONG
+WdfCmResourceListGetCount(
+	_In_ WDFCMRESLIST List
+	)
+{
+	UNREFERENCED_PARAMETER(List);
+
+	return 0;
+}
+
+PCM_PARTIAL_RESOURCE_DESCRIPTOR
+WdfCmResourceListGetDescriptor(
+	_In_ WDFCMRESLIST List,
+	_In_ ULONG Index
+	)
+{
+	UNREFERENCED_PARAMETER(List);
+	UNREFERENCED_PARAMETER(Index);
+
+	return NULL;
+}
+
+NTSTATUS
+WdfIoTargetCreate(
+	_In_ WDFDEVICE Device,
+	_In_opt_ PWDF_OBJECT_ATTRIBUTES Attributes,
+	_Out_ WDFIOTARGET *IoTarget
+	)
+{
+	UNREFERENCED_PARAMETER(Device);
+	UNREFERENCED_PARAMETER(Attributes);
+
+	*IoTarget = NULL;
+	return STATUS_NOT_FOUND;
+}
+
+NTSTATUS
+WdfIoTargetOpen(
+	_In_ WDFIOTARGET IoTarget,
+	_In_ PWDF_IO_TARGET_OPEN_PARAMS OpenParams
+	)
+{
+	UNREFERENCED_PARAMETER(IoTarget);
+	UNREFERENCED_PARAMETER(OpenParams);
+
+	return STATUS_NOT_FOUND;
+}
+
+VOID
+WdfIoTargetClose(
+	_In_ WDFIOTARGET IoTarget
+	)
+{
+	UNREFERENCED_PARAMETER(IoTarget);
+}
+
+NTSTATUS
+WdfRequestCreate(
+	_In_opt_ PWDF_OBJECT_ATTRIBUTES Attributes,
+	_In_opt_ WDFIOTARGET IoTarget,
+	_Out_ WDFREQUEST *Request
+	)
+{
+	UNREFERENCED_PARAMETER(Attributes);
+	UNREFERENCED_PARAMETER(IoTarget);
+
+	*Request = NULL;
+	return STATUS_NOT_FOUND;
+}
+
+NTSTATUS
+WdfMemoryCreatePreallocated(
+	_In_opt_ PWDF_OBJECT_ATTRIBUTES Attributes,
+	_In_ PVOID Buffer,
+	_In_ size_t BufferSize,
+	_Out_ WDFMEMORY *Memory
+	)
+{
+	UNREFERENCED_PARAMETER(Attributes);
+	UNREFERENCED_PARAMETER(Buffer);
+	UNREFERENCED_PARAMETER(BufferSize);
+
+	*Memory = NULL;
+	return STATUS_NOT_FOUND;
+}
+
+NTSTATUS
+WdfIoTargetFormatRequestForIoctl(
+	_In_ WDFIOTARGET IoTarget,
+	_In_ WDFREQUEST Request,
+	_In_ ULONG IoctlCode,
+	_In_opt_ WDFMEMORY InputBuffer,
+	_In_opt_ PLONGLONG InputBufferOffset,
+	_In_opt_ WDFMEMORY OutputBuffer,
+	_In_opt_ PLONGLONG OutputBufferOffset
+	)
+{
+	UNREFERENCED_PARAMETER(IoTarget);
+	UNREFERENCED_PARAMETER(Request);
+	UNREFERENCED_PARAMETER(IoctlCode);
+	UNREFERENCED_PARAMETER(InputBuffer);
+	UNREFERENCED_PARAMETER(InputBufferOffset);
+	UNREFERENCED_PARAMETER(OutputBuffer);
+	UNREFERENCED_PARAMETER(OutputBufferOffset);
+
+	return STATUS_NOT_FOUND;
+}
+
+NTSTATUS
+WdfRequestAllocateTimer(
+	_In_ WDFREQUEST Request
+	)
+{
+	UNREFERENCED_PARAMETER(Request);
+
+	return STATUS_NOT_FOUND;
+}
+
+BOOLEAN
+WdfRequestSend(
+	_In_ WDFREQUEST Request,
+	_In_ WDFIOTARGET Target,
+	_In_opt_ PWDF_REQUEST_SEND_OPTIONS Options
+	)
+{
+	UNREFERENCED_PARAMETER(Request);
+	UNREFERENCED_PARAMETER(Target);
+	UNREFERENCED_PARAMETER(Options);
+
+	return FALSE;
+}
+
+NTSTATUS
+WdfRequestGetStatus(
+	_In_ WDFREQUEST Request
+	)
+{
+	UNREFERENCED_PARAMETER(Request);
+
+	return STATUS_NOT_FOUND;
+}
+
+NTSTATUS
+WdfIoQueueRetrieveNextRequest(
+	_In_ WDFQUEUE Queue,
+	_Out_ WDFREQUEST *OutRequest
+	)
+{
+	UNREFERENCED_PARAMETER(Queue);
+
+	if (!g_ReportPended)
+	{
+		return STATUS_NO_MORE_ENTRIES;
+	}
+
+	g_ReportPended = FALSE;
+	*OutRequest = (WDFREQUEST)&g_Report;
+	return STATUS_SUCCESS;
+}
+
+NTSTATUS
+WdfRequestRetrieveOutputBuffer(
+	_In_ WDFREQUEST Request,
+	_In_ size_t MinimumRequiredSize,
+	_Out_ PVOID *Buffer,
+	_Out_opt_ size_t *Length
+	)
+{
+	if (MinimumRequiredSize > sizeof(g_Report))
+	{
+		return STATUS_INVALID_PARAMETER;
+	}
+
+	*Buffer = Request;
+	if (Length != NULL)
+	{
+		*Length = sizeof(g_Report);
+	}
+
+	return STATUS_SUCCESS;
+}
+
+VOID
+WdfRequestCompleteWithInformation(
+	_In_ WDFREQUEST Request,
+	_In_ NTSTATUS Status,
+	_In_ ULONG_PTR Information
+	)
+{
+	UNREFERENCED_PARAMETER(Request);
+
+	g_ReportLength = NT_SUCCESS(Status) ? Information : 0;
+}
+
+NTSTATUS
+WdfDeviceOpenRegistryKey(
+	_In_ WDFDEVICE Device,
+	_In_ ULONG DeviceInstanceKeyType,
+	_In_ ACCESS_MASK DesiredAccess,
+	_In_opt_ PWDF_OBJECT_ATTRIBUTES KeyAttributes,
+	_Out_ WDFKEY *Key
+	)
+{
+	UNREFERENCED_PARAMETER(Device);
+	UNREFERENCED_PARAMETER(DeviceInstanceKeyType);
+	UNREFERENCED_PARAMETER(DesiredAccess);
+	UNREFERENCED_PARAMETER(KeyAttributes);
+
+	*Key = NULL;
+	return STATUS_OBJECT_NAME_NOT_FOUND;
+}
+
+NTSTATUS
+WdfRegistryQueryULong(
+	_In_ WDFKEY Key,
+	_In_ PCUNICODE_STRING ValueName,
+	_Out_ PULONG Value
+	)
+{
+	UNREFERENCED_PARAMETER(Key);
+	UNREFERENCED_PARAMETER(ValueName);
+	UNREFERENCED_PARAMETER(Value);
+
+	return STATUS_OBJECT_NAME_NOT_FOUND;
+}
+
+VOID
+WdfRegistryClose(
+	_In_ WDFKEY Key
+	)
+{
+	UNREFERENCED_PARAMETER(Key);
+}
+
+//
+// ------------------------------------------------------------------ Cases
+//
+
+//
+// TRUE when the extension holds frame Seed with Contacts contacts, as
+// FakeQueue built it.
+//
+static BOOLEAN
+HoldsFrame(UCHAR Contacts, ULONG Seed)
+{
+	PUCHAR record;
+	ULONG i;
+
+	if (g_Extension.Data[0] != (GT9XX_STATUS_READY | Contacts))
+	{
+		return FALSE;
+	}
+
+	for (i = 0; i < Contacts; i++)
+	{
+		record = &g_Extension.Data[1 + i * GT9XX_CONTACT_LENGTH];
+		if (record[0] != i ||
+			(ULONG)(record[1] | (record[2] << 8)) != Seed * 16 + i * 100 ||
+			(ULONG)(record[3] | (record[4] << 8)) != Seed * 8 + i * 50)
+		{
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static BOOLEAN
+StatusClear(void)
+{
+	return (*FakeReg(GT9XX_STATUS_REG) & GT9XX_STATUS_READY) == 0;
+}
+
+static void
+TestIdle(void)
+{
+	FakeReset();
+
+	ReadCTPData(&g_Extension);
+	Check((g_Extension.Data[0] & GT9XX_STATUS_READY) == 0, "idle", "no frame");
+	Check(g_Panel.StatusWrites == 0, "idle", "status not written");
+	Check(g_Panel.Transactions == 1, "idle", "one transaction");
+}
+
+static void
+TestLateFrame(void)
+{
+	FakeReset();
+
+	//
+	// The frame is done right after the status byte went out, before
+	// the sequence ends.
+	//
+	g_Panel.LandAt = 2;
+	FakeQueue(1, 1);
+
+	ReadCTPData(&g_Extension);
+	Check((g_Extension.Data[0] & GT9XX_STATUS_READY) == 0, "late frame", "not seen by this read");
+	Check(g_Panel.Landed == 1 && !StatusClear(), "late frame", "still ready in the panel");
+
+	ReadCTPData(&g_Extension);
+	Check(HoldsFrame(1, 1), "late frame", "read by the next interrupt");
+	Check(StatusClear(), "late frame", "cleared after it was read");
+}
+
+static void
+TestOneContact(void)
+{
+	FakeReset();
+	FakeQueue(1, 2);
+
+	ReadCTPData(&g_Extension);
+	Check(HoldsFrame(1, 2), "one contact", "frame read");
+	Check(g_Panel.Transactions == 2, "one contact", "one read and the clear");
+	Check(g_Panel.StatusWrites == 1 && StatusClear(), "one contact", "cleared once");
+	Check(g_Extension.ReadContacts == 1 && g_Extension.ExtraReads == 0, "one contact", "no extra read");
+}
+
+static void
+TestMoreContacts(void)
+{
+	FakeReset();
+	FakeQueue(1, 3);
+	ReadCTPData(&g_Extension);
+
+	//
+	// Five contacts, and the next frame is queued behind them.
+	//
+	FakeQueue(5, 4);
+	FakeQueue(5, 5);
+
+	ReadCTPData(&g_Extension);
+	Check(HoldsFrame(5, 4), "more", "all contacts from one frame");
+	Check(g_Extension.ExtraReads == 1, "more", "rest read with a second read");
+	Check(g_Extension.ReadContacts == 5, "more", "next read sized for five");
+
+	g_Panel.Transactions = 0;
+	ReadCTPData(&g_Extension);
+	Check(HoldsFrame(5, 5), "more", "queued frame read whole");
+	Check(g_Extension.ExtraReads == 1, "more", "no second read for the same count");
+	Check(g_Panel.Transactions == 2, "more", "one read and the clear");
+}
+
+static void
+TestBadCount(void)
+{
+	FakeReset();
+	FakeQueue(GT9XX_MAX_CONTACTS, 6);
+	g_Panel.Queue[0].Status = GT9XX_STATUS_READY | GT9XX_STATUS_CONTACTS;
+	g_Panel.Regs[GT9XX_STATUS_REG - FAKE_REG_BASE] = GT9XX_STATUS_READY | GT9XX_STATUS_CONTACTS;
+
+	ReadCTPData(&g_Extension);
+	Check(g_Extension.Data[0] == 0, "bad count", "dropped");
+	Check(StatusClear(), "bad count", "cleared");
+}
+
+static void
+TestBusError(void)
+{
+	FakeReset();
+	FakeQueue(2, 7);
+	g_Panel.FailAt = 2;
+
+	ReadCTPData(&g_Extension);
+	Check(g_Extension.Data[0] == 0, "bus error", "no frame");
+	Check(g_Panel.StatusWrites == 0 && !StatusClear(), "bus error", "status left for the next read");
+
+	ReadCTPData(&g_Extension);
+	Check(HoldsFrame(2, 7), "bus error", "read by the next interrupt");
+}
+
+static void
+TestReport(void)
+{
+	PINPUT_REPORT_DATA contact;
+	ULONG i;
+
+	FakeReset();
+	TouchTrackerInitialize(&g_Extension.Tracker, 0x01, GT9XX_MAX_CONTACTS);
+	g_Extension.Report = 0x07;
+	g_Extension.ReportTime = 0;
+
+	FakeQueue(3, 8);
+	memset(&g_Report, 0, sizeof(g_Report));
+	g_ReportPended = TRUE;
+	g_ReportLength = 0;
+
+	OnInterruptIsr(NULL, 0);
+	Check(g_ReportLength == sizeof(g_Report), "report", "pended read completed");
+	Check(g_Report.ReportTouchId == 0x01 && g_Report.ContactCount == 3, "report", "three contacts");
+
+	for (i = 0; i < 3; i++)
+	{
+		contact = &g_Report.ReportData[i];
+		Check(contact->Tip != 0 &&
+			(contact->XLSB | (contact->XMSB << 8)) == 8 * 16 + contact->ContactId * 100 &&
+			(contact->YLSB | (contact->YMSB << 8)) == 8 * 8 + contact->ContactId * 50,
+			"report", "contact position");
+	}
+}
+
+static void
+TestLatencyFeature(void)
+{
+	static const UCHAR item[] = {
+		0x85, TOUCH_LATENCY_REPORT_ID,
+		0x09, 0xC6,
+		0x96, (TOUCH_LATENCY_REPORT_LENGTH - 1) & 0xff, (TOUCH_LATENCY_REPORT_LENGTH - 1) >> 8,
+		0xb1, 0x02,
+		0xc0 };
+	UCHAR buffer[TOUCH_LATENCY_REPORT_LENGTH];
+	PTOUCH_LATENCY_REPORT report = (PTOUCH_LATENCY_REPORT)buffer;
+	NTSTATUS status;
+	ULONG length;
+	ULONG acquires;
+
+	//
+	// The last items of the touch collection, right before its end.
+	//
+	Check(memcmp(G_DefaultReportDescriptor + sizeof(G_DefaultReportDescriptor) - sizeof(item),
+		item, sizeof(item)) == 0,
+		"latency", "descriptor items");
+
+	//
+	// Right after the report case, which built and completed one report.
+	//
+	acquires = g_LockAcquires;
+	length = 1;
+	status = TouchTrackerGetLatencyFeature(&g_Extension.Tracker, g_Extension.OnLock,
+		buffer, sizeof(buffer) - 1, &length);
+	Check(status == STATUS_BUFFER_TOO_SMALL && length == 0, "latency", "short buffer rejected");
+
+	memset(buffer, 0xff, sizeof(buffer));
+	status = TouchTrackerGetLatencyFeature(&g_Extension.Tracker, g_Extension.OnLock,
+		buffer, sizeof(buffer), &length);
+	Check(NT_SUCCESS(status) && length == TOUCH_LATENCY_REPORT_LENGTH, "latency", "report length");
+	Check(report->ReportId == TOUCH_LATENCY_REPORT_ID && report->Version == TOUCH_LATENCY_REPORT_VERSION,
+		"latency", "report header");
+	Check(report->Frames == 1 && report->Reports == 1 && report->DroppedReports == 0,
+		"latency", "report counts");
+
+	TouchTrackerSetLatencyFeature(&g_Extension.Tracker, g_Extension.OnLock);
+	TouchTrackerGetLatencyFeature(&g_Extension.Tracker, g_Extension.OnLock,
+		buffer, sizeof(buffer), &length);
+	Check(report->Frames == 0 && report->Reports == 0, "latency", "set clears the statistics");
+
+	Check(g_LockAcquires - acquires == 4 && g_LockHeld == 0, "latency", "under the report lock");
+}
+
+static void
+SteadyTouch(void)
+{
+	ULONG frame;
+
+	FakeReset();
+	for (frame = 0; frame < 100; frame++)
+	{
+		FakeQueue(2, frame);
+		ReadCTPData(&g_Extension);
+	}
+
+	printf("steady touch: %.2f transactions, %.2f transfers per frame\n",
+		g_Panel.Transactions / 100.0, g_Panel.Transfers / 100.0);
+}
+
+int
+main(void)
+{
+	TestIdle();
+	TestLateFrame();
+	TestOneContact();
+	TestMoreContacts();
+	TestBadCount();
+	TestBusError();
+	TestReport();
+	TestLatencyFeature();
+	SteadyTouch();
+
+	if (g_Failures != 0)
+	{
+		printf("%d check(s) failed\n", g_Failures);
+		return 1;
+	}
+
+	printf("all checks passed\n");
+	return 0;
+}
@@ -55,6 +55,7 @@ Return Value:
     WDF_INTERRUPT_CONFIG InterruptConfiguration;
     WDFINTERRUPT WdfInterrupt;
     WDF_IO_QUEUE_CONFIG	queueConfig;
+    WDF_TIMER_CONFIG timerConfig;
 	
 #ifdef GSL_TIMER
 	HANDLE  thread_handle;
@@ -99,20 +100,8 @@ Return Value:
 #ifdef SUPPORT_WINKEY
 		devContext->ButtonDown = FALSE;
 #endif
-		{
-			UINT8 i = 0;
-			UINT8 j = 0;
-			for (; i < PS_DEEP; i++)
-			{
-				for (; j < MAX_CONTACTS; j++)
-				{
-					devContext->Point_Data[i][j].id = 0;
-					devContext->Point_Data[i][j].x = 0;
-					devContext->Point_Data[i][j].y = 0;
-				}
-				devContext->ContactCount[i] = 0;
-			}
-		}
+		TouchTrackerInitialize(&devContext->Tracker, REPORTID_INPUT, MAX_CONTACTS);
+		TouchTrackerReadFilterConfig(device, &devContext->Tracker);
 #ifdef GSL_TIMER
 	//
 	// Initialize the timer.
@@ -121,16 +110,8 @@ Return Value:
 		NotificationEvent,
 		FALSE);
 
-	devContext->int_1st[0] = 0;
-	devContext->int_1st[1] = 0;
-	devContext->int_1st[2] = 0;
-	devContext->int_1st[3] = 0;
-	devContext->int_2nd[0] = 0;
-	devContext->int_2nd[1] = 0;
-	devContext->int_2nd[2] = 0;
-	devContext->int_2nd[3] = 0;
-	devContext->b0_counter = 0;
-	devContext->bc_counter = 0;
+	GSLEsdInitialize(&devContext->Esd);
+	devContext->EsdArmed = FALSE;
 	devContext->i2c_lock = 0;
 	KeInitializeDpc(&devContext->EsdDPC, GSLDevESDRoutine, (PVOID)devContext);
 	KeInitializeTimerEx(&devContext->EsdTimer, NotificationTimer);
@@ -191,6 +172,7 @@ Return Value:
             DbgPrint("WdfInterruptCreate failed 0x%x\n", status);
             return status;
         }
+        devContext->Interrupt = WdfInterrupt;
 		
         //
         // Initialize the I/O Package and any Queues
@@ -255,6 +237,18 @@ Return Value:
             DbgPrint("WdfSpinLockCreate DpcLock failed 0x%x\n", status);
             return status;
         }
+        //DozeTimer, one shot at passive level
+        TouchActivityInitialize(&devContext->Activity, 0);
+        WDF_TIMER_CONFIG_INIT(&timerConfig, GSLDevDozeTimer);
+        timerConfig.AutomaticSerialization = FALSE;
+        WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+        attributes.ParentObject = device;
+        attributes.ExecutionLevel = WdfExecutionLevelPassive;
+        status = WdfTimerCreate(&timerConfig, &attributes, &devContext->DozeTimer);
+        if (!NT_SUCCESS(status)) {
+            DbgPrint("WdfTimerCreate DozeTimer failed 0x%x\n", status);
+            return status;
+        }
     }
 	//DbgPrintEx(DPFLTR_IHVDRIVER_ID, 0, "SSSSSSSSSSSSSSSSSSSS SileadTouchCreateDevice exit\n");
     DbgPrint("SileadTouchCreateDevice Exit\n");
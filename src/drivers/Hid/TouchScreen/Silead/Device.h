@@ -27,6 +27,10 @@ Environment:
 #include "gsl_point_id.h"
 #include "Features.h"
 #include "Hiddesc.h"
+#include "../spbclient.h"
+#include "../touchreport.h"
+#include "../touchactivity.h"
+#include "GSLEsd.h"
 //
 // Pool tag for GSL GPIO allocations.
 //
@@ -76,6 +80,34 @@ typedef struct _TS_CFG_DATA
 	UINT32 val;
 }TS_CFG_DATA, *PTS_CFG_DATA;
 
+#define GSL_PAGE_REG 0xf0
+#define GSL_PAGE_LEN 128
+
+C_ASSERT(I2C_TRANSMIT_LEN < SPB_CLIENT_STAGING_LENGTH);
+
+//
+// Configuration download. Entries are staged one page at a time and every
+// page is written in I2C_TRANSMIT_LEN bursts. Once a download succeeded,
+// later ones read each page back first and skip it if the chip holds it.
+//
+typedef struct _GSL_CFG_LOADER
+{
+	UCHAR Page[GSL_PAGE_LEN];
+	UCHAR ReadBack[GSL_PAGE_LEN];
+	ULONG PageNumber;
+	ULONG PageLength;
+	BOOLEAN IsPageOpen;
+	BOOLEAN IsLoaded;
+	NTSTATUS Status;
+	LARGE_INTEGER StartTime;
+
+	ULONG PagesWritten;
+	ULONG PagesSkipped;
+	ULONG Transfers;
+	ULONG Bytes;
+	ULONG LoadTimeMs;
+}GSL_CFG_LOADER, *PGSL_CFG_LOADER;
+
 typedef struct _DEVICE_EXTENSION {
 	WDFQUEUE IdleQueue;
 	WDFQUEUE ReportQueue;
@@ -84,6 +116,8 @@ typedef struct _DEVICE_EXTENSION {
 	WDFSPINLOCK DpcLock;
 	ULONG IoResourceCount;
 	WDFIOTARGET I2CIOTarget;
+	SPB_CLIENT SpbClient;
+	GSL_CFG_LOADER CfgLoader;
 	ULONG InterruptCount;
 	LARGE_INTEGER ConnectionIds[MAX_NUMBER_IO_RESOURCES];
 	BOOLEAN DpcRerun;
@@ -93,18 +127,22 @@ typedef struct _DEVICE_EXTENSION {
 	LARGE_INTEGER StartTime;
 	BOOLEAN bStartTime;
 	BOOLEAN ButtonDown;
-	POINT_DATA Point_Data[PS_DEEP][MAX_CONTACTS];
-	BYTE ContactCount[PS_DEEP];
+	TOUCH_TRACKER Tracker;
+	//
+	// Scan rate management, the timer dozes the chip after the quiet
+	// period and talks to it under the interrupt lock.
+	//
+	WDFINTERRUPT Interrupt;
+	TOUCH_ACTIVITY Activity;
+	WDFTIMER DozeTimer;
 #ifdef GSL_TIMER
 	PVOID          thread_pointer;
 	BOOLEAN            terminate_thread;
 	KEVENT          request_event;
 	KTIMER EsdTimer;
 	KDPC EsdDPC;
-	UCHAR int_1st[4];
-	UCHAR int_2nd[4];
-	UCHAR b0_counter;
-	UCHAR bc_counter;
+	GSL_ESD Esd;
+	BOOLEAN EsdArmed;
 	UCHAR i2c_lock;
 #endif
 }DEVICE_EXTENSION, *PDEVICE_EXTENSION;
@@ -137,6 +175,9 @@ GSL_Init_Chip(IN WDFDEVICE    Device);
 NTSTATUS
 GSL_Load_CFG(IN WDFDEVICE    Device);
 
+NTSTATUS
+GSL_Load_CFG_Container(IN WDFDEVICE    Device);
+
 NTSTATUS 
 GPIORstReset(IN  WDFDEVICE Device);
 NTSTATUS GPIOSHUTDOWN_LOW(IN WDFDEVICE Device);
@@ -221,6 +262,12 @@ _In_ WDFDEVICE  FxDevice,
 _In_ WDFREQUEST FxRequest
 );
 
+NTSTATUS
+SetFeatureReport(
+_In_ WDFDEVICE  FxDevice,
+_In_ WDFREQUEST FxRequest
+);
+
 NTSTATUS
 HidGSLGetString(
 _In_ WDFDEVICE  FxDevice,
@@ -245,12 +292,13 @@ VOID GSLDevESDRoutine(_In_ struct _KDPC *Dpc, _In_opt_ PVOID DeferredContext,
 	_In_opt_ PVOID SystemArgument1, _In_opt_ PVOID SystemArgument2
 	);
 VOID ThreadFunc(IN PVOID Context);
+VOID GSLDevArmESDTimer(PDEVICE_EXTENSION devContext);
 #endif
 
-#ifdef WINKEY_WAKEUP_SYSTEM
 NTSTATUS
 GSL_Enter_Doze(IN WDFDEVICE    Device);
 
 NTSTATUS
 GSL_Exit_Doze(IN WDFDEVICE    Device);
-#endif
\ No newline at end of file
+
+EVT_WDF_TIMER GSLDevDozeTimer;
\ No newline at end of file
@@ -4,7 +4,8 @@
 #define GSL_DEBUG
 //#define GSL_TIMER
 #define SUPPORT_WINKEY
-#define I2C_TRANSMIT_LEN 16
+//configuration download burst, a whole page by default, at most SPB_CLIENT_STAGING_LENGTH - 1
+#define I2C_TRANSMIT_LEN 128
 //#define SCANTIME_CONSTANT
 #ifdef SCANTIME_CONSTANT
 #define SCANTIME_STEP 90
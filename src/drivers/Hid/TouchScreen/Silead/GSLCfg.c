@@ -0,0 +1,222 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	GSLCfg.c
+
+Abstract:
+
+	Decoder of the binary configuration container described in GSLCfg.h.
+	It uses no kernel or runtime services so the converter builds it as
+	well to verify what it wrote.
+
+Environment:
+
+	kernel mode, and user mode for the converter
+
+--*/
+
+#include "GSLCfg.h"
+
+unsigned int
+GSLCfgCrc32(
+	const unsigned char *Data,
+	unsigned int Length
+	)
+{
+	unsigned int crc = 0xffffffff;
+	unsigned int i;
+	int bit;
+
+	for (i = 0; i < Length; i++)
+	{
+		crc ^= Data[i];
+		for (bit = 0; bit < 8; bit++)
+		{
+			crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+		}
+	}
+
+	return ~crc;
+}
+
+typedef struct _GSL_CFG_STREAM
+{
+	const unsigned char *Data;
+	unsigned int Length;
+	unsigned int Position;
+}GSL_CFG_STREAM;
+
+static int
+GSLCfgReadByte(GSL_CFG_STREAM *Stream, unsigned int *Value)
+{
+	if (Stream->Position >= Stream->Length)
+	{
+		return GSL_CFG_E_DATA;
+	}
+
+	*Value = Stream->Data[Stream->Position++];
+	return 0;
+}
+
+static int
+GSLCfgReadWords(
+	GSL_CFG_STREAM *Stream,
+	unsigned int Page,
+	unsigned int Count,
+	GSL_CFG_WORD_CALLBACK *Callback,
+	void *Context
+	)
+{
+	unsigned int previous = 0;
+	unsigned int index = 0;
+	unsigned int token;
+	unsigned int n;
+	unsigned int byte;
+	unsigned int i;
+	int result;
+
+	while (index < Count)
+	{
+		result = GSLCfgReadByte(Stream, &token);
+		if (result != 0)
+		{
+			return result;
+		}
+
+		if ((token & GSL_CFG_TOKEN_RUN_MAX) == GSL_CFG_TOKEN_RUN)
+		{
+			n = token + 1;
+		}
+		else
+		{
+			n = (token & (GSL_CFG_TOKEN_COUNT_MAX - 1)) + 1;
+		}
+
+		if (n > Count - index)
+		{
+			return GSL_CFG_E_DATA;
+		}
+
+		while (n-- > 0)
+		{
+			if ((token & GSL_CFG_TOKEN_KIND) == GSL_CFG_TOKEN_DELTA)
+			{
+				result = GSLCfgReadByte(Stream, &byte);
+				if (result != 0)
+				{
+					return result;
+				}
+				previous += (unsigned int)(int)(signed char)byte;
+			}
+			else if ((token & GSL_CFG_TOKEN_KIND) == GSL_CFG_TOKEN_LITERAL)
+			{
+				if (Stream->Length - Stream->Position < 4)
+				{
+					return GSL_CFG_E_DATA;
+				}
+				previous = 0;
+				for (i = 0; i < 4; i++)
+				{
+					previous |= (unsigned int)Stream->Data[Stream->Position++] << (i * 8);
+				}
+			}
+
+			result = Callback(Context, Page, index, previous);
+			if (result != 0)
+			{
+				return result;
+			}
+			index++;
+		}
+	}
+
+	return 0;
+}
+
+int
+GSLCfgDecode(
+	const unsigned char *Container,
+	unsigned int Length,
+	GSL_CFG_WORD_CALLBACK *Callback,
+	void *Context
+	)
+{
+	const GSL_CFG_HEADER *header = (const GSL_CFG_HEADER *)Container;
+	GSL_CFG_STREAM stream;
+	unsigned int page;
+	unsigned int count;
+	unsigned int i;
+	int result;
+
+	if (Length < sizeof(GSL_CFG_HEADER) ||
+		header->Signature != GSL_CFG_SIGNATURE ||
+		header->Version != GSL_CFG_VERSION ||
+		header->HeaderSize < sizeof(GSL_CFG_HEADER) ||
+		header->HeaderSize > Length ||
+		header->DataLength > Length - header->HeaderSize ||
+		header->IdCount > GSL_CFG_MAX_ID_WORDS ||
+		header->PageCount > GSL_CFG_MAX_PAGES)
+	{
+		return GSL_CFG_E_HEADER;
+	}
+
+	stream.Data = Container + header->HeaderSize;
+	stream.Length = header->DataLength;
+	stream.Position = 0;
+
+	if (GSLCfgCrc32(stream.Data, stream.Length) != header->Crc32)
+	{
+		return GSL_CFG_E_CRC;
+	}
+
+	result = GSLCfgReadWords(&stream, GSL_CFG_ID_PAGE, header->IdCount, Callback, Context);
+	if (result != 0)
+	{
+		return result;
+	}
+
+	for (i = 0; i < header->PageCount; i++)
+	{
+		result = GSLCfgReadByte(&stream, &page);
+		if (result == 0)
+		{
+			result = GSLCfgReadByte(&stream, &count);
+		}
+		if (result != 0)
+		{
+			return result;
+		}
+
+		if (count == 0 || count > GSL_CFG_PAGE_WORDS)
+		{
+			return GSL_CFG_E_DATA;
+		}
+
+		result = GSLCfgReadWords(&stream, page, count, Callback, Context);
+		if (result != 0)
+		{
+			return result;
+		}
+	}
+
+	return (stream.Position == stream.Length) ? 0 : GSL_CFG_E_DATA;
+}
@@ -0,0 +1,130 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	GSLCfg.h
+
+Abstract:
+
+	Binary touch panel configuration container, built from the
+	default_tp_config headers by tools\gslcfgconv.c and decoded by the
+	driver straight into the configuration page loader.
+
+	All fields are little endian. The header is followed by DataLength
+	bytes covered by Crc32 (CRC-32/IEEE):
+
+		IdCount words of gsl_config_data_id, as one word stream
+		PageCount page records
+
+	A page record is the page number, the number of words in the page
+	(1 - GSL_CFG_PAGE_WORDS) and that many words as a word stream. A word
+	stream is a sequence of tokens, every stream starts with a previous
+	word of 0:
+
+		0x00 - 0x7f	previous word repeated (token + 1) times
+		0x80 - 0xbf	(token & 0x3f) + 1 words, each a signed byte delta
+					to the word before it
+		0xc0 - 0xff	(token & 0x3f) + 1 literal 4 byte words
+
+Environment:
+
+	kernel mode, and user mode for the converter
+
+--*/
+
+#ifndef _GSLCFG_H_
+#define _GSLCFG_H_
+
+#define GSL_CFG_SIGNATURE		0x434c5347	// "GSLC"
+#define GSL_CFG_VERSION			1
+
+#define GSL_CFG_PAGE_WORDS		32
+#define GSL_CFG_MAX_ID_WORDS	512
+#define GSL_CFG_MAX_PAGES		256
+
+//
+// Largest container accepted. One with every word stored as a literal
+// and the most id words and pages is about 36KB.
+//
+#define GSL_CFG_MAX_LENGTH		0x10000
+
+#define GSL_CFG_TOKEN_RUN		0x00
+#define GSL_CFG_TOKEN_DELTA		0x80
+#define GSL_CFG_TOKEN_LITERAL	0xc0
+#define GSL_CFG_TOKEN_KIND		0xc0
+#define GSL_CFG_TOKEN_RUN_MAX	0x80
+#define GSL_CFG_TOKEN_COUNT_MAX	0x40
+
+#pragma pack(push, 1)
+
+typedef struct _GSL_CFG_HEADER
+{
+	unsigned int Signature;
+	unsigned short Version;
+	unsigned short HeaderSize;
+	unsigned int IdCount;
+	unsigned int PageCount;
+	unsigned int DataLength;
+	unsigned int Crc32;
+}GSL_CFG_HEADER, *PGSL_CFG_HEADER;
+
+#pragma pack(pop)
+
+//
+// Called for every decoded word. Page is the page number of a
+// configuration word, or GSL_CFG_ID_PAGE for a gsl_config_data_id word.
+// A new page starts with Index 0. Returning nonzero stops the decode.
+//
+#define GSL_CFG_ID_PAGE			0xffffffff
+
+typedef int
+GSL_CFG_WORD_CALLBACK(
+	void *Context,
+	unsigned int Page,
+	unsigned int Index,
+	unsigned int Value
+	);
+
+unsigned int
+GSLCfgCrc32(
+	const unsigned char *Data,
+	unsigned int Length
+	);
+
+//
+// Checks the header and CRC, then decodes the container calling
+// Callback for every word in order. Returns 0 on success, a negative
+// GSL_CFG_E_xxx value when the container is malformed, or the nonzero
+// value returned by Callback.
+//
+#define GSL_CFG_E_HEADER		(-1)
+#define GSL_CFG_E_CRC			(-2)
+#define GSL_CFG_E_DATA			(-3)
+
+int
+GSLCfgDecode(
+	const unsigned char *Container,
+	unsigned int Length,
+	GSL_CFG_WORD_CALLBACK *Callback,
+	void *Context
+	);
+
+#endif
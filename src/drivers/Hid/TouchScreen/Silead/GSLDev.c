@@ -103,6 +103,17 @@ IN WDFDEVICE    Device
 		goto SetupI2CConnectionFailed;
 	}
 
+	//
+	// Preallocate the request reused for every transfer to the panel.
+	//
+	Status = SpbClientInitialize(&devContext->SpbClient, devContext->I2CIOTarget);
+	if (!NT_SUCCESS(Status)) {
+		DbgPrint("SpbClientInitialize failed Status:%x\n",
+			Status);
+		WdfIoTargetClose(devContext->I2CIOTarget);
+		goto SetupI2CConnectionFailed;
+	}
+
 SetupI2CConnectionFailed:
 	return Status;
 }
@@ -119,6 +130,7 @@ IN WDFDEVICE    Device
 		if (devContext->I2CIOTarget != NULL)
 		{
 			WdfIoTargetClose(devContext->I2CIOTarget);
+			SpbClientCleanup(&devContext->SpbClient);
 			WdfObjectDelete(devContext->I2CIOTarget);
 		}
 	}
@@ -527,12 +539,25 @@ NTSTATUS
 	GSL_Startup_Chip(Device);
 	GSL_Check_Memdata(Device);
 #ifdef GSL_TIMER
+	//
+	// The chip was just started, the watchdog begins at its base period.
+	//
+	WdfSpinLockAcquire(devContext->DpcLock);
+	GSLEsdReinitDone(&devContext->Esd);
+	devContext->EsdArmed = TRUE;
+	GSLDevArmESDTimer(devContext);
+	WdfSpinLockRelease(devContext->DpcLock);
+#endif
+	//
+	// The chip scans at full rate, the timer dozes it once it was quiet
+	// for DozeQuietMs.
+	//
+	TouchActivityReadConfig(Device, &devContext->Activity);
+	TouchActivityStart(&devContext->Activity, QuerySystemTime());
+	if (devContext->Activity.QuietMs != 0)
 	{
-		LARGE_INTEGER duetime = { 0 };
-		KeCancelTimer(&devContext->EsdTimer);
-		KeSetTimerEx(&devContext->EsdTimer, duetime, 3000, &devContext->EsdDPC);
+		WdfTimerStart(devContext->DozeTimer, WDF_REL_TIMEOUT_IN_MS(devContext->Activity.QuietMs));
 	}
-#endif
 	DbgPrint("HidGSLEvtDeviceD0Entry finish.\n");
 	return STATUS_SUCCESS;
 }
@@ -581,8 +606,22 @@ NTSTATUS
 
 	--*/
 {
+		PDEVICE_EXTENSION devContext = GetDeviceContext(Device);
 		UNREFERENCED_PARAMETER(TargetState);
 		DbgPrint("HidGSLEvtDeviceD0Exit\n");
+		//
+		// Stopped under the interrupt lock first, so a running doze timer
+		// does not arm itself again.
+		//
+		WdfInterruptAcquireLock(devContext->Interrupt);
+		TouchActivityStop(&devContext->Activity, QuerySystemTime());
+		WdfInterruptReleaseLock(devContext->Interrupt);
+		WdfTimerStop(devContext->DozeTimer, TRUE);
+		DbgPrint("full rate %I64u ms, doze %I64u ms, %u dozes, %u failed\n",
+			devContext->Activity.ModeMs[TouchModeActive],
+			devContext->Activity.ModeMs[TouchModeDoze],
+			devContext->Activity.DozeEntries,
+			devContext->Activity.DozeFailures);
 #ifdef WINKEY_WAKEUP_SYSTEM
 		GSL_Enter_Doze(Device);
 #else
@@ -590,8 +629,10 @@ NTSTATUS
 		UCHAR tmp = 0xb5; 
 #endif
 #ifdef GSL_TIMER
-	PDEVICE_EXTENSION devContext = GetDeviceContext(Device);
+	WdfSpinLockAcquire(devContext->DpcLock);
+	devContext->EsdArmed = FALSE;
 	KeCancelTimer(&devContext->EsdTimer);
+	WdfSpinLockRelease(devContext->DpcLock);
 #endif
 	GSL_Reset_Chip(Device);
 #if !defined(GSL2681)&& !defined(GSL1680)
@@ -605,7 +646,62 @@ NTSTATUS
 }
 
 
+//
+// Dozes the chip when no interrupt arrived for the quiet period, otherwise
+// waits for the rest of it. Runs at PASSIVE_LEVEL with the interrupt lock
+// held, so the ISR is not talking to the chip meanwhile.
+//
+VOID GSLDevDozeTimer(_In_ WDFTIMER Timer)
+{
+	WDFDEVICE Device;
+	PDEVICE_EXTENSION devContext;
+	unsigned int waitMs;
+	ULONG now;
+	NTSTATUS status;
+
+	Device = (WDFDEVICE)WdfTimerGetParentObject(Timer);
+	devContext = GetDeviceContext(Device);
+
+	WdfInterruptAcquireLock(devContext->Interrupt);
+
+	now = QuerySystemTime();
+	if (TouchActivityDozeDue(&devContext->Activity, now, &waitMs))
+	{
+#ifdef GSL_TIMER
+		//
+		// The ESD watchdog has the bus, try again after another quiet
+		// period.
+		//
+		if (devContext->i2c_lock != 0)
+		{
+			status = STATUS_DEVICE_BUSY;
+		}
+		else
+#endif
+		{
+			status = GSL_Enter_Doze(Device);
+		}
+		TouchActivityDozeEntered(&devContext->Activity, now, NT_SUCCESS(status));
+		TouchActivityDozeDue(&devContext->Activity, now, &waitMs);
+	}
+
+	WdfInterruptReleaseLock(devContext->Interrupt);
+
+	if (waitMs != 0)
+	{
+		WdfTimerStart(Timer, WDF_REL_TIMEOUT_IN_MS(waitMs));
+	}
+}
+
 #ifdef GSL_TIMER
+VOID GSLDevArmESDTimer(PDEVICE_EXTENSION devContext)
+{
+	LARGE_INTEGER duetime;
+
+	duetime.QuadPart = -10000LL * devContext->Esd.PeriodMs;
+	KeSetTimerEx(&devContext->EsdTimer, duetime, 0, &devContext->EsdDPC);
+}
+
 //#pragma LOCKEDCODE
 VOID GSLDevESDRoutine(_In_ struct _KDPC *Dpc,_In_opt_ PVOID DeferredContext,
 			_In_opt_ PVOID SystemArgument1,_In_opt_ PVOID SystemArgument2
@@ -625,13 +721,58 @@ VOID GSLDevESDRoutine(_In_ struct _KDPC *Dpc,_In_opt_ PVOID DeferredContext,
 		FALSE);
 }
 
+//
+// Sleeps with the bus released so touch frames keep flowing, then takes
+// it back. Returns FALSE if the interrupt thread holds the bus.
+//
+static BOOLEAN GSLDevESDDelay(PDEVICE_EXTENSION devContext, ULONG DelayMs)
+{
+	LARGE_INTEGER interval;
+
+	devContext->i2c_lock = 0;
+	interval.QuadPart = -10000LL * DelayMs;
+	KeDelayExecutionThread(KernelMode, FALSE, &interval);
+	if (devContext->i2c_lock != 0)
+	{
+		return FALSE;
+	}
+	devContext->i2c_lock = 1;
+	return TRUE;
+}
+
+static ULONG GSLDevESDRead(IN WDFDEVICE Device, BYTE RegisterAddress, NTSTATUS *Status)
+{
+	UCHAR read_buf[4] = { 0 };
+
+	*Status = GSLDevReadBuffer(Device, RegisterAddress, read_buf, 4);
+	return read_buf[0] | (read_buf[1] << 8) | (read_buf[2] << 16) | ((ULONG)read_buf[3] << 24);
+}
+
+//
+// One watchdog check, run as GSLEsd.h describes: the scan counter first,
+// the status registers now and then, and a reinitialization only after
+// a failure was confirmed.
+//
 VOID GSLDevESDDetail(IN WDFDEVICE    Device)
 {
 	PDEVICE_EXTENSION	devContext;
-	UCHAR read_buf[4] = { 0 };
-	UCHAR init_chip_flag = 0;
+	GSL_ESD_ACTION action;
+	NTSTATUS status;
+	ULONG counter;
+	ULONG b0;
+	ULONG bc;
 	devContext = GetDeviceContext(Device);
 	DbgPrintGSL("%s Entry\n", __FUNCTION__);
+
+	//
+	// A dozing chip scans too slowly for the counter check, it is checked
+	// again once a touch brought it back to full rate.
+	//
+	if (devContext->Activity.Mode == TouchModeDoze)
+	{
+		return;
+	}
+
 	if (devContext->i2c_lock != 0)
 	{
 		return;
@@ -639,63 +780,54 @@ VOID GSLDevESDDetail(IN WDFDEVICE    Device)
 	else
 	{
 		devContext->i2c_lock = 1;
-	}	
-	//read 0xb0.
-	GSLDevReadBuffer(Device, 0xb0, read_buf, 4);
-	if (read_buf[3] != 0x5a || read_buf[2] != 0x5a || read_buf[1] != 0x5a || read_buf[0] != 0x5a)
-		devContext->b0_counter++;
-	else
-		devContext->b0_counter = 0;
-	
-	if (devContext->b0_counter > 1)
-	{
-		DbgPrint("======read 0xb0: %x %x %x %x ======\n", read_buf[3], read_buf[2], read_buf[1], read_buf[0]);
-		init_chip_flag = 1;
-		devContext->b0_counter = 0;
-		goto init_chip_lable;
-	}
-	//read 0xb4.
-	GSLDevReadBuffer(Device, 0xb4, read_buf, 4);
-	devContext->int_2nd[3] = devContext->int_1st[3];
-	devContext->int_2nd[2] = devContext->int_1st[2];
-	devContext->int_2nd[1] = devContext->int_1st[1];
-	devContext->int_2nd[0] = devContext->int_1st[0];
-	devContext->int_1st[3] = read_buf[3];
-	devContext->int_1st[2] = read_buf[2];
-	devContext->int_1st[1] = read_buf[1];
-	devContext->int_1st[0] = read_buf[0];
-	
-	if (devContext->int_1st[3] == devContext->int_2nd[3]
-		&& devContext->int_1st[2] == devContext->int_2nd[2]
-		&& devContext->int_1st[1] == devContext->int_2nd[1]
-		&& devContext->int_1st[0] == devContext->int_2nd[0]
-		)
-	{
-		DbgPrint("======int_1st: %x %x %x %x , int_2nd: %x %x %x %x ======\n",
-			devContext->int_1st[3], devContext->int_1st[2], devContext->int_1st[1], devContext->int_1st[0],
-			devContext->int_2nd[3], devContext->int_2nd[2], devContext->int_2nd[1], devContext->int_2nd[0]);
-		init_chip_flag = 1;
-		goto init_chip_lable;
-	}
-	//read 0xbc.
-	GSLDevReadBuffer(Device, 0xbc, read_buf, 4);
-	if (read_buf[3] != 0 || read_buf[2] != 0 || read_buf[1] != 0 || read_buf[0] != 0)
-		devContext->bc_counter++;
-	else
-		devContext->bc_counter = 0;
-	if (devContext->bc_counter > 1)
-	{
-		DbgPrint("======read 0xbc: %x %x %x %x======\n", read_buf[3], read_buf[2], read_buf[1], read_buf[0]);
-		init_chip_flag = 1;
-		devContext->bc_counter = 0;
-	}	
-init_chip_lable:
-	if (init_chip_flag)
+	}
+
+	action = GSLEsdStart(&devContext->Esd, QuerySystemTime());
+	while (action != GslEsdActionDone)
 	{
-		wd_delay(50);
-		GSL_Init_Chip(Device);
-		wd_delay(100); 
-		GSL_Check_Memdata(Device);
+		if (devContext->Esd.DelayMs != 0 &&
+			!GSLDevESDDelay(devContext, devContext->Esd.DelayMs))
+		{
+			return;
+		}
+
+		switch (action)
+		{
+		case GslEsdActionReadCounter:
+			counter = GSLDevESDRead(Device, 0xb4, &status);
+			action = GSLEsdCounterRead(&devContext->Esd, NT_SUCCESS(status), counter);
+			break;
+
+		case GslEsdActionReadStatus:
+			b0 = GSLDevESDRead(Device, 0xb0, &status);
+			if (NT_SUCCESS(status))
+			{
+				bc = GSLDevESDRead(Device, 0xbc, &status);
+			}
+			else
+			{
+				bc = 0;
+			}
+			action = GSLEsdStatusRead(&devContext->Esd, NT_SUCCESS(status), b0, bc);
+			break;
+
+		case GslEsdActionReinit:
+			DbgPrint("======esd reinit %u: counter %u, status %u, bus %u======\n",
+				devContext->Esd.Reinits,
+				devContext->Esd.ReinitReasons[GslEsdReasonCounter],
+				devContext->Esd.ReinitReasons[GslEsdReasonStatus],
+				devContext->Esd.ReinitReasons[GslEsdReasonBus]);
+			wd_delay(50);
+			GSL_Init_Chip(Device);
+			wd_delay(100);
+			GSL_Check_Memdata(Device);
+			action = GSLEsdReinitDone(&devContext->Esd);
+			break;
+
+		default:
+			action = GslEsdActionDone;
+			break;
+		}
 	}
 	devContext->i2c_lock = 0;
 }
@@ -719,12 +851,23 @@ VOID ThreadFunc(IN PVOID Context)
 			FALSE,
 			NULL
 			);
-		GSLDevESDDetail(Device);
 		KeResetEvent(&devContext->request_event);
 		if (devContext->terminate_thread)
 		{
 			PsTerminateSystemThread(STATUS_SUCCESS);
 		}
+		GSLDevESDDetail(Device);
+
+		//
+		// The timer is one shot, the next check is due after the period
+		// the policy chose.
+		//
+		WdfSpinLockAcquire(devContext->DpcLock);
+		if (devContext->EsdArmed)
+		{
+			GSLDevArmESDTimer(devContext);
+		}
+		WdfSpinLockRelease(devContext->DpcLock);
 	}
 }
 #endif
@@ -27,7 +27,10 @@
 #include "Device.h"
 #include "trace.h"
 #include "Hiddesc.h"
+#include "GSLCfg.h"
 #define XOR 0x88
+#define GSL_CFG_CONTAINER_NAME L"SileadTouch.gslcfg"
+#define GSL_CFG_PATH_LEN 260
 //#include "GSL_TS_CFG.h"
 
 #ifdef PORTRIAT_RESOLUTION
@@ -96,56 +99,27 @@ _In_reads_(DataLength) PUCHAR PData,
 _In_ ULONG DataLength
 )
 {
-	PUCHAR Buffer;
-	ULONG BufferLength;
-	ULONG_PTR BytesWritten;
-	WDF_MEMORY_DESCRIPTOR MemoryDescriptor;
-	WDFMEMORY MemoryWrite = NULL;
-	NTSTATUS Status;
+	NTSTATUS Status = STATUS_SUCCESS;
 	PDEVICE_EXTENSION             devContext = NULL;
 	UINT16 i;
 	
 	devContext = GetDeviceContext(Device);
-	BufferLength = DataLength + sizeof(BYTE);
-	Status = WdfMemoryCreate(WDF_NO_OBJECT_ATTRIBUTES,
-		NonPagedPoolNx,
-		GSL_GPIO_POOL_TAG,
-		BufferLength,
-		&MemoryWrite,
-		(PVOID*)&Buffer);
-
-	if (!NT_SUCCESS(Status)) {
-		DbgPrint("%s: WdfMemoryCreate failed allocating memory buffer for write!"
-			"Status:%x\n",
-			__FUNCTION__,
-			Status);
-		goto GSLWriteEnd;
-	}
+	if (PData == NULL)
+		DataLength = 0;
 
-	RtlCopyMemory(Buffer, &RegisterAddress, sizeof(BYTE));
-	if(PData != NULL)
-		RtlCopyMemory((Buffer + sizeof(BYTE)), PData, DataLength);
-	
-	WDF_MEMORY_DESCRIPTOR_INIT_HANDLE(&MemoryDescriptor, MemoryWrite, NULL); //chnage here
+	//
+	// The register address is staged in the preallocated SPB client,
+	// so no memory is allocated per write.
+	//
 	//if write first failed, write again. 
 	for (i = 0; i < 2; i++)
 	{
-		Status = WdfIoTargetSendWriteSynchronously(
-			devContext->I2CIOTarget,
-			NULL,
-			&MemoryDescriptor,
-			NULL,
-			NULL,
-			&BytesWritten);
+		Status = SpbClientWriteRegister(&devContext->SpbClient, RegisterAddress, PData, DataLength);
 
 		if (!NT_SUCCESS(Status)) {
-			DbgPrint("%s: WdfIoTargetSendWriteSynchronously failed! Status = 0x%x\n",
+			DbgPrint("%s: SpbClientWriteRegister failed! Status = 0x%x\n",
 				__FUNCTION__,
 				Status);
-			//added by guoying to debug the driver
-			//DbgPrintEx(DPFLTR_IHVDRIVER_ID, 0, "%s: WdfIoTargetSendWriteSynchronously failed! Status = 0x%x\n",
-			//	__FUNCTION__,
-			//	Status);
 			continue;
 		}
 		else
@@ -154,10 +128,6 @@ _In_ ULONG DataLength
 		}
 	}
 
-GSLWriteEnd:
-	if (MemoryWrite != NULL) {
-		WdfObjectDelete(MemoryWrite);
-	}
 	return Status;
 }
 
@@ -169,34 +139,13 @@ _Out_writes_(DataLength) PUCHAR PData,
 _In_ USHORT DataLength
 )
 {
-	PUCHAR Buffer;
+	NTSTATUS Status = STATUS_SUCCESS;
 	ULONG_PTR BytesRead = 0;
-	WDF_MEMORY_DESCRIPTOR MemoryDescriptor;
-	WDFMEMORY MemoryRead = NULL;
-	NTSTATUS Status;
 	UINT16 i;
 	PDEVICE_EXTENSION             devContext;
 	devContext = GetDeviceContext(Device);
 
-	Status = WdfMemoryCreate(WDF_NO_OBJECT_ATTRIBUTES,
-		NonPagedPoolNx,
-		GSL_GPIO_POOL_TAG,
-		DataLength,
-		&MemoryRead, 
-		NULL);
-
-	if (!NT_SUCCESS(Status)) {
-		DbgPrint("%s: WdfMemoryCreate failed allocating memory buffer for write!"
-			"Status:%x\n",
-			__FUNCTION__,
-			Status);
-		goto GSLReadEnd;
-	}
-
-	WDF_MEMORY_DESCRIPTOR_INIT_HANDLE(&MemoryDescriptor, MemoryRead, NULL);
-	Buffer = WdfMemoryGetBuffer(MemoryRead, (size_t*)&DataLength);
-
-	//if read first failed,read again. 
+	//if read first failed or came back short,read again. 
 	for (i = 0; i < 2; i++)
 	{
 		Status = GSLDevWriteBuffer(Device, RegisterAddress, NULL, 0);
@@ -207,41 +156,32 @@ _In_ USHORT DataLength
 				Status);
 			continue;
 		}
-		Status = WdfIoTargetSendReadSynchronously(
-			devContext->I2CIOTarget,
-			NULL,
-			&MemoryDescriptor,
-			NULL,
-			NULL,
-			&BytesRead);
+		Status = SpbClientRead(&devContext->SpbClient, PData, DataLength, &BytesRead);
 
 		if (!NT_SUCCESS(Status)) {
-			DbgPrint("%s: WdfIoTargetSendReadSynchronously read failed! Status = %x\n",
+			DbgPrint("%s: SpbClientRead read failed! Status = %x\n",
 				__FUNCTION__,
 				Status);
-			//added by guoying to debug the driver
-			//DbgPrintEx(DPFLTR_IHVDRIVER_ID, 0, "%s: WdfIoTargetSendReadSynchronously read failed! Status = %x\n",
-			//	__FUNCTION__,
-			//	Status);
 		}
-		else if(BytesRead == DataLength)
+		else if (BytesRead == DataLength)
 		{
 			break;
 		}
+		else
+		{
+			DbgPrint("%s: SpbClientRead short read! %Iu of %u bytes\n",
+				__FUNCTION__,
+				BytesRead,
+				DataLength);
+			Status = STATUS_DEVICE_DATA_ERROR;
+		}
 	}
 	if (!NT_SUCCESS(Status)){
 		DbgPrint("%s read failed! Status = %x\n",
 			__FUNCTION__,
 			Status);
-		goto GSLReadEnd;
 	}
-	
-	RtlCopyMemory(PData, Buffer, DataLength);
 
-GSLReadEnd:
-	if (MemoryRead != NULL) {
-		WdfObjectDelete(MemoryRead);
-	}
 	return Status;
 
 }
@@ -416,14 +356,142 @@ GSL_Load_CFG(IN WDFDEVICE    Device)
 }
 #endif
 
+static VOID
+GSL_Cfg_Begin(IN WDFDEVICE    Device)
+{
+	PGSL_CFG_LOADER loader = &GetDeviceContext(Device)->CfgLoader;
+
+	loader->PageLength = 0;
+	loader->IsPageOpen = FALSE;
+	loader->Status = STATUS_SUCCESS;
+	loader->PagesWritten = 0;
+	loader->PagesSkipped = 0;
+	loader->Transfers = 0;
+	loader->Bytes = 0;
+	loader->StartTime = KeQueryPerformanceCounter(NULL);
+}
+
+static VOID
+GSL_Cfg_Flush_Page(IN WDFDEVICE    Device)
+{
+	PGSL_CFG_LOADER loader = &GetDeviceContext(Device)->CfgLoader;
+	NTSTATUS Status;
+	BYTE page;
+	ULONG offset;
+	ULONG length;
+
+	if (!loader->IsPageOpen || loader->PageLength == 0)
+	{
+		loader->IsPageOpen = FALSE;
+		return;
+	}
+
+	loader->IsPageOpen = FALSE;
+
+	page = (BYTE)loader->PageNumber;
+	Status = GSLDevWriteBuffer(Device, GSL_PAGE_REG, &page, 1);
+	loader->Transfers++;
+	if (!NT_SUCCESS(Status))
+	{
+		loader->Status = Status;
+		return;
+	}
+
+	//the chip held the configuration before, only rewrite what changed
+	if (loader->IsLoaded)
+	{
+		//the readback sets the register address, then reads
+		Status = GSLDevReadBuffer(Device, 0, loader->ReadBack, (USHORT)loader->PageLength);
+		loader->Transfers += 2;
+		if (NT_SUCCESS(Status) && RtlEqualMemory(loader->ReadBack, loader->Page, loader->PageLength))
+		{
+			loader->PagesSkipped++;
+			return;
+		}
+	}
+
+	for (offset = 0; offset < loader->PageLength; offset += length)
+	{
+		length = min(I2C_TRANSMIT_LEN, loader->PageLength - offset);
+
+		Status = GSLDevWriteBuffer(Device, (BYTE)offset, &loader->Page[offset], length);
+		loader->Transfers++;
+		loader->Bytes += length;
+		if (!NT_SUCCESS(Status))
+		{
+			loader->Status = Status;
+			return;
+		}
+	}
+
+	loader->PagesWritten++;
+}
+
+//
+// Feeds one configuration entry, a page select (offset 0xf0) or the next
+// word of the current page. Words before the first page select, or past the
+// end of a page, are dropped.
+//
+static VOID
+GSL_Cfg_Feed(IN WDFDEVICE    Device, IN BYTE Offset, IN UINT32 Value)
+{
+	PGSL_CFG_LOADER loader = &GetDeviceContext(Device)->CfgLoader;
+
+	if (GSL_PAGE_REG == Offset)
+	{
+		GSL_Cfg_Flush_Page(Device);
+		loader->PageNumber = Value & 0xff;
+		loader->PageLength = 0;
+		loader->IsPageOpen = TRUE;
+		return;
+	}
+
+	if (!loader->IsPageOpen)
+	{
+		return;
+	}
+
+	loader->Page[loader->PageLength + 0] = (BYTE)(Value & 0xff);
+	loader->Page[loader->PageLength + 1] = (BYTE)((Value >> 8) & 0xff);
+	loader->Page[loader->PageLength + 2] = (BYTE)((Value >> 16) & 0xff);
+	loader->Page[loader->PageLength + 3] = (BYTE)((Value >> 24) & 0xff);
+	loader->PageLength += 4;
+
+	if (loader->PageLength >= GSL_PAGE_LEN)
+	{
+		GSL_Cfg_Flush_Page(Device);
+	}
+}
+
+static NTSTATUS
+GSL_Cfg_End(IN WDFDEVICE    Device)
+{
+	PGSL_CFG_LOADER loader = &GetDeviceContext(Device)->CfgLoader;
+	LARGE_INTEGER endTime, frequency;
+
+	GSL_Cfg_Flush_Page(Device);
+
+	endTime = KeQueryPerformanceCounter(&frequency);
+	loader->LoadTimeMs = (ULONG)(((endTime.QuadPart - loader->StartTime.QuadPart) * 1000) / frequency.QuadPart);
+	loader->IsLoaded = NT_SUCCESS(loader->Status);
+
+	DbgPrint("%s: %d ms, %d pages written, %d skipped, %d transfers, %d bytes, Status = 0x%x\n",
+		__FUNCTION__,
+		loader->LoadTimeMs,
+		loader->PagesWritten,
+		loader->PagesSkipped,
+		loader->Transfers,
+		loader->Bytes,
+		loader->Status);
+
+	return loader->Status;
+}
+
 #if 1
 NTSTATUS
 GSL_Load_CFG(IN WDFDEVICE    Device)
 {
 	PTS_CFG_DATA ptr_ts_cfg = NULL;
-	BYTE offset = 0;
-	BYTE buf[128];
-	BYTE send_flag = 0;
 	ULONG source_line=0;
 	ULONG source_len = 0;
 	PDEVICE_EXTENSION devContext;
@@ -439,32 +507,15 @@ GSL_Load_CFG(IN WDFDEVICE    Device)
 	ptr_ts_cfg = GSL_TS_CFG;	
 	source_len = ARRAYSIZE(GSL_TS_CFG);
 
+	GSL_Cfg_Begin(Device);
+
 	for (source_line=0; source_line<source_len; source_line++)
 	{
-		if(0xf0 == ptr_ts_cfg[source_line].offset)
-		{
-			buf[0] = (BYTE)(ptr_ts_cfg[source_line].val & 0xff);
-			GSLDevWriteBuffer(Device, 0xf0, buf, 1);
-			send_flag = 1;
-			offset = 0;
-		}
-		else if(1 == send_flag)
-		{
-			buf[offset + 0] = (BYTE)(ptr_ts_cfg[source_line].val & 0xff);
-			buf[offset + 1] = (BYTE)((ptr_ts_cfg[source_line].val >> 8) & 0xff);
-			buf[offset + 2] = (BYTE)((ptr_ts_cfg[source_line].val >> 16) & 0xff);
-			buf[offset + 3] = (BYTE)((ptr_ts_cfg[source_line].val >> 24) & 0xff);
-			offset += 4;
-			if(0 == (offset%I2C_TRANSMIT_LEN))
-				GSLDevWriteBuffer(Device, offset - I2C_TRANSMIT_LEN, &buf[offset - I2C_TRANSMIT_LEN], I2C_TRANSMIT_LEN);
-			if(offset >= 128)
-			{
-				send_flag = 0;
-			}
-		}
+		GSL_Cfg_Feed(Device, ptr_ts_cfg[source_line].offset, ptr_ts_cfg[source_line].val);
 	}
+
 	DbgPrint("================%s end===============\n", __FUNCTION__);
-	return STATUS_SUCCESS;
+	return GSL_Cfg_End(Device);
 }
 #endif
 
@@ -509,9 +560,7 @@ GSL_Load_CFG_Flie(IN WDFDEVICE    Device)
 	UCHAR i;
 	PDEVICE_EXTENSION devContext;
 	NTSTATUS Status;
-	BYTE offset = 0;
 	ULONG id_offset = 0;
-	BYTE buf[128];
 	BYTE send_flag = 0;
 	UINT32 value;
 	unsigned int gsl_config_data_id_inner[512] = { 0 };
@@ -622,6 +671,7 @@ GSL_Load_CFG_Flie(IN WDFDEVICE    Device)
 		file_offset++;
 	}
 	DbgPrint("GSL_TS_CFG\n");
+	GSL_Cfg_Begin(Device);
 	while(file_offset < (BytesRead - 2))
 	{
 		if ((file_buf[file_offset] ^ XOR) == ';')
@@ -646,21 +696,13 @@ GSL_Load_CFG_Flie(IN WDFDEVICE    Device)
 				//DbgPrint ("value = 0x%x\n", value );
 				if(send_flag == 1)
 				{
-					buf[0] = (char)(value & 0xff);
-					GSLDevWriteBuffer(Device, 0xf0, buf, 1);
-					offset = 0;
+					GSL_Cfg_Feed(Device, GSL_PAGE_REG, value);
 					send_flag = 2;
 				}
 				else
 				{
-					buf[offset + 0] = (char)(value & 0xff);
-					buf[offset + 1] = (char)((value >> 8) & 0xff);
-					buf[offset + 2] = (char)((value >> 16) & 0xff);
-					buf[offset + 3] = (char)((value >> 24) & 0xff);
-					offset += 4;
-					if(0 == (offset%I2C_TRANSMIT_LEN))
-						GSLDevWriteBuffer(Device, offset - I2C_TRANSMIT_LEN, &buf[offset - I2C_TRANSMIT_LEN], I2C_TRANSMIT_LEN);
-					if(offset >= 128)
+					GSL_Cfg_Feed(Device, 0, value);
+					if(!devContext->CfgLoader.IsPageOpen)
 					{
 						send_flag = 0;
 					}
@@ -675,8 +717,198 @@ GSL_Load_CFG_Flie(IN WDFDEVICE    Device)
 	ZwClose(FileHandle); 
 	
 	DbgPrint("================%s end===============\n", __FUNCTION__);
-	return STATUS_SUCCESS;
+	return GSL_Cfg_End(Device);
 }
+//
+// Silead.inf copies the container next to the driver image into the driver
+// store (DIRID 13), the service ImagePath points there.
+//
+static NTSTATUS
+GSL_Cfg_Container_Path(IN WDFDEVICE    Device, OUT PUNICODE_STRING Path)
+{
+	NTSTATUS Status;
+	WDFKEY key;
+	UNICODE_STRING servicePath;
+	WCHAR imageBuffer[GSL_CFG_PATH_LEN];
+	UNICODE_STRING imagePath;
+	USHORT length;
+	DECLARE_CONST_UNICODE_STRING(imagePathName, L"ImagePath");
+
+	RtlInitUnicodeString(&servicePath, WdfDriverGetRegistryPath(WdfDeviceGetDriver(Device)));
+	Status = WdfRegistryOpenKey(NULL,
+		&servicePath,
+		KEY_READ,
+		WDF_NO_OBJECT_ATTRIBUTES,
+		&key);
+	if (!NT_SUCCESS(Status))
+	{
+		return Status;
+	}
+
+	RtlInitEmptyUnicodeString(&imagePath, imageBuffer, sizeof(imageBuffer));
+	Status = WdfRegistryQueryUnicodeString(key, &imagePathName, NULL, &imagePath);
+	WdfRegistryClose(key);
+	if (!NT_SUCCESS(Status))
+	{
+		return Status;
+	}
+
+	//keep the directory, with its trailing backslash
+	length = imagePath.Length / sizeof(WCHAR);
+	while (length > 0 && imagePath.Buffer[length - 1] != L'\\')
+	{
+		length--;
+	}
+	imagePath.Length = length * sizeof(WCHAR);
+
+	Path->Length = 0;
+	if (length == 0 || imagePath.Buffer[0] != L'\\')
+	{
+		//relative to the system root, as the service control manager does
+		Status = RtlUnicodeStringCatString(Path, L"\\SystemRoot\\");
+	}
+	if (NT_SUCCESS(Status))
+	{
+		Status = RtlUnicodeStringCat(Path, &imagePath);
+	}
+	if (NT_SUCCESS(Status))
+	{
+		Status = RtlUnicodeStringCatString(Path, GSL_CFG_CONTAINER_NAME);
+	}
+
+	return Status;
+}
+
+typedef struct _GSL_CFG_DECODE_CONTEXT
+{
+	WDFDEVICE Device;
+	unsigned int IdCount;
+	unsigned int Ids[GSL_CFG_MAX_ID_WORDS];
+}GSL_CFG_DECODE_CONTEXT, *PGSL_CFG_DECODE_CONTEXT;
+
+static int
+GSL_Cfg_Decode_Word(void *Context, unsigned int Page, unsigned int Index, unsigned int Value)
+{
+	PGSL_CFG_DECODE_CONTEXT decode = (PGSL_CFG_DECODE_CONTEXT)Context;
+
+	if (GSL_CFG_ID_PAGE == Page)
+	{
+		decode->Ids[decode->IdCount++] = Value;
+		return 0;
+	}
+
+	if (0 == Index)
+	{
+		GSL_Cfg_Feed(decode->Device, GSL_PAGE_REG, Page);
+	}
+	GSL_Cfg_Feed(decode->Device, 0, Value);
+
+	return NT_SUCCESS(GetDeviceContext(decode->Device)->CfgLoader.Status) ? 0 : 1;
+}
+
+//
+// Loads the binary container (GSLCfg.h). The whole file is checked
+// against its CRC before the first page is written.
+//
+NTSTATUS
+GSL_Load_CFG_Container(IN WDFDEVICE    Device)
+{
+	WCHAR pathBuffer[GSL_CFG_PATH_LEN];
+	UNICODE_STRING CFGName;
+	OBJECT_ATTRIBUTES  Attributes;
+	HANDLE   FileHandle;
+	IO_STATUS_BLOCK    ioStatusBlock;
+	FILE_STANDARD_INFORMATION StandardInfo;
+	ULONG length;
+	PUCHAR file_buf = NULL;
+	PGSL_CFG_DECODE_CONTEXT decode = NULL;
+	PDEVICE_EXTENSION devContext;
+	NTSTATUS Status;
+	int result;
+
+	devContext = GetDeviceContext(Device);
+
+	RtlInitEmptyUnicodeString(&CFGName, pathBuffer, sizeof(pathBuffer));
+	Status = GSL_Cfg_Container_Path(Device, &CFGName);
+	if (!NT_SUCCESS(Status))
+	{
+		return Status;
+	}
+
+	InitializeObjectAttributes(&Attributes, &CFGName, OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE, NULL, NULL);
+	Status = ZwOpenFile(&FileHandle, FILE_READ_DATA, &Attributes, &ioStatusBlock, FILE_SHARE_READ, FILE_SYNCHRONOUS_IO_NONALERT);
+	if (!NT_SUCCESS(Status))
+	{
+		DbgPrint("%s: no container %wZ, Status = 0x%x\n", __FUNCTION__, &CFGName, Status);
+		return Status;
+	}
+
+	Status = ZwQueryInformationFile(FileHandle,
+		&ioStatusBlock,
+		&StandardInfo,
+		sizeof(FILE_STANDARD_INFORMATION),
+		FileStandardInformation);
+	if (!NT_SUCCESS(Status))
+	{
+		goto exit;
+	}
+
+	length = StandardInfo.EndOfFile.LowPart;
+	if (StandardInfo.EndOfFile.HighPart != 0 || length < sizeof(GSL_CFG_HEADER) || length > GSL_CFG_MAX_LENGTH)
+	{
+		Status = STATUS_INVALID_IMAGE_FORMAT;
+		goto exit;
+	}
+
+	file_buf = ExAllocatePoolWithTag(PagedPool, length, GSL_GPIO_POOL_TAG);
+	decode = ExAllocatePoolWithTag(PagedPool, sizeof(GSL_CFG_DECODE_CONTEXT), GSL_GPIO_POOL_TAG);
+	if (NULL == file_buf || NULL == decode)
+	{
+		Status = STATUS_INSUFFICIENT_RESOURCES;
+		goto exit;
+	}
+
+	Status = ZwReadFile(FileHandle, NULL, NULL, NULL, &ioStatusBlock, file_buf, length, NULL, NULL);
+	if (!NT_SUCCESS(Status) || ioStatusBlock.Information != length)
+	{
+		Status = NT_SUCCESS(Status) ? STATUS_END_OF_FILE : Status;
+		goto exit;
+	}
+
+	decode->Device = Device;
+	decode->IdCount = 0;
+
+	GSL_Cfg_Begin(Device);
+
+	result = GSLCfgDecode(file_buf, length, GSL_Cfg_Decode_Word, decode);
+
+	Status = GSL_Cfg_End(Device);
+	if (result < 0)
+	{
+		DbgPrint("%s: %wZ is corrupt, error %d\n", __FUNCTION__, &CFGName, result);
+		Status = STATUS_INVALID_IMAGE_FORMAT;
+		goto exit;
+	}
+
+	if (NT_SUCCESS(Status) && devContext->NoIDVersion && decode->IdCount != 0)
+	{
+		gsl_DataInit(decode->Ids);
+	}
+
+exit:
+	if (NULL != decode)
+	{
+		ExFreePoolWithTag(decode, GSL_GPIO_POOL_TAG);
+	}
+	if (NULL != file_buf)
+	{
+		ExFreePoolWithTag(file_buf, GSL_GPIO_POOL_TAG);
+	}
+	ZwClose(FileHandle);
+
+	return Status;
+}
+
 NTSTATUS
 GSL_Init_Chip(IN WDFDEVICE    Device)
 {
@@ -694,7 +926,11 @@ GSL_Init_Chip(IN WDFDEVICE    Device)
 	}
 	GSL_Clr_Reg(Device);
 	GSL_Reset_Chip(Device);	
-	Status = GSL_Load_CFG_Flie(Device);
+	Status = GSL_Load_CFG_Container(Device);
+	if (!NT_SUCCESS(Status))
+	{
+		Status = GSL_Load_CFG_Flie(Device);
+	}
 	if (!NT_SUCCESS(Status)) 
 	{
 		DbgPrint("!!!!!!!!!GSL_Load_CFG_Flie fail!!!!!!!!!!!\n");
@@ -808,42 +1044,46 @@ GSL_Check_Memdata(IN WDFDEVICE    Device)
 //
 //}
 
-#ifdef WINKEY_WAKEUP_SYSTEM
 NTSTATUS
 GSL_Enter_Doze(IN WDFDEVICE    Device)
 {
+	NTSTATUS status;
 	UCHAR buf[4] = { 0 };
 	buf[0] = 0xa;
 	buf[1] = 0;
 	buf[2] = 0;
 	buf[3] = 0;
-	GSLDevWriteBuffer(Device, 0xf0, buf, 4);
+	status = GSLDevWriteBuffer(Device, 0xf0, buf, 4);
+	if (!NT_SUCCESS(status))
+		return status;
 	buf[0] = 0;
 	buf[1] = 0;
 	buf[2] = 0x1;
 	buf[3] = 0x5a;
-	GSLDevWriteBuffer(Device, 0x8, buf, 4);
+	status = GSLDevWriteBuffer(Device, 0x8, buf, 4);
 	wd_delay(10);
 
-	return STATUS_SUCCESS;
+	return status;
 }
 
 NTSTATUS
 GSL_Exit_Doze(IN WDFDEVICE    Device)
 {
+	NTSTATUS status;
 	UCHAR buf[4] = { 0 };
 	buf[0] = 0xa;
 	buf[1] = 0;
 	buf[2] = 0;
 	buf[3] = 0;
-	GSLDevWriteBuffer(Device, 0xf0, buf, 4);
+	status = GSLDevWriteBuffer(Device, 0xf0, buf, 4);
+	if (!NT_SUCCESS(status))
+		return status;
 	buf[0] = 0;
 	buf[1] = 0;
 	buf[2] = 0x0;
 	buf[3] = 0x5a;
-	GSLDevWriteBuffer(Device, 0x8, buf, 4);
+	status = GSLDevWriteBuffer(Device, 0x8, buf, 4);
 	wd_delay(10);
 
-	return STATUS_SUCCESS;
+	return status;
 }
-#endif
@@ -0,0 +1,237 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	GSLEsd.c
+
+Abstract:
+
+	ESD watchdog policy described in GSLEsd.h. It uses no kernel or
+	runtime services so the simulator builds it as well.
+
+Environment:
+
+	kernel mode, and user mode for the simulator
+
+--*/
+
+#include "GSLEsd.h"
+
+void
+GSLEsdInitialize(
+	PGSL_ESD Esd
+	)
+{
+	unsigned int i;
+
+	Esd->PeriodMs = GSL_ESD_BASE_PERIOD_MS;
+	Esd->DelayMs = 0;
+	Esd->LastActivity = 0;
+	Esd->HasActivity = 0;
+	Esd->Counter = 0;
+	Esd->HasCounter = 0;
+	Esd->StatusAgeMs = 0;
+	Esd->Suspect = GslEsdReasons;
+
+	Esd->Checks = 0;
+	Esd->Skipped = 0;
+	Esd->CounterReads = 0;
+	Esd->StatusReads = 0;
+	Esd->FalseAlarms = 0;
+	Esd->Reinits = 0;
+	for (i = 0; i < GslEsdReasons; i++)
+	{
+		Esd->ReinitReasons[i] = 0;
+	}
+}
+
+void
+GSLEsdActivity(
+	PGSL_ESD Esd,
+	unsigned int Now
+	)
+{
+	Esd->LastActivity = Now;
+	Esd->HasActivity = 1;
+}
+
+static GSL_ESD_ACTION
+GSLEsdPass(
+	PGSL_ESD Esd
+	)
+{
+	if (Esd->Suspect != GslEsdReasons)
+	{
+		Esd->FalseAlarms++;
+		Esd->Suspect = GslEsdReasons;
+	}
+
+	Esd->DelayMs = 0;
+	return GslEsdActionDone;
+}
+
+//
+// A check failed. The first failure repeats the read after a short
+// delay, a failure of the repeated read reinitializes the controller.
+//
+static GSL_ESD_ACTION
+GSLEsdFail(
+	PGSL_ESD Esd,
+	GSL_ESD_REASON Reason,
+	GSL_ESD_ACTION Repeat
+	)
+{
+	if (Esd->Suspect == GslEsdReasons)
+	{
+		Esd->Suspect = Reason;
+		Esd->DelayMs = GSL_ESD_CONFIRM_DELAY_MS;
+		return Repeat;
+	}
+
+	Esd->Suspect = GslEsdReasons;
+	Esd->DelayMs = 0;
+	Esd->Reinits++;
+	Esd->ReinitReasons[Reason]++;
+	return GslEsdActionReinit;
+}
+
+GSL_ESD_ACTION
+GSLEsdStart(
+	PGSL_ESD Esd,
+	unsigned int Now
+	)
+{
+	int active = Esd->HasActivity;
+
+	Esd->Checks++;
+	Esd->StatusAgeMs += Esd->PeriodMs;
+	Esd->DelayMs = 0;
+	Esd->Suspect = GslEsdReasons;
+	Esd->HasActivity = 0;
+
+	//
+	// Touch frames in the last base period prove the controller alive.
+	// Any activity since the last check means somebody is using the
+	// panel, so the period goes back to its base, otherwise it doubles
+	// with every idle check.
+	//
+	if (active)
+	{
+		Esd->PeriodMs = GSL_ESD_BASE_PERIOD_MS;
+
+		if ((unsigned int)(Now - Esd->LastActivity) < GSL_ESD_BASE_PERIOD_MS)
+		{
+			Esd->Skipped++;
+			return GslEsdActionDone;
+		}
+	}
+	else
+	{
+		Esd->PeriodMs *= 2;
+		if (Esd->PeriodMs > GSL_ESD_MAX_PERIOD_MS)
+		{
+			Esd->PeriodMs = GSL_ESD_MAX_PERIOD_MS;
+		}
+	}
+
+	return GslEsdActionReadCounter;
+}
+
+GSL_ESD_ACTION
+GSLEsdCounterRead(
+	PGSL_ESD Esd,
+	int Ok,
+	unsigned int Counter
+	)
+{
+	int first = !Esd->HasCounter;
+
+	Esd->CounterReads++;
+
+	if (!Ok)
+	{
+		return GSLEsdFail(Esd, GslEsdReasonBus, GslEsdActionReadCounter);
+	}
+
+	if (!first && (Counter == Esd->Counter))
+	{
+		return GSLEsdFail(Esd, GslEsdReasonCounter, GslEsdActionReadCounter);
+	}
+
+	if (Esd->Suspect != GslEsdReasons)
+	{
+		Esd->FalseAlarms++;
+		Esd->Suspect = GslEsdReasons;
+	}
+
+	Esd->Counter = Counter;
+	Esd->HasCounter = 1;
+
+	if (first || (Esd->StatusAgeMs >= GSL_ESD_STATUS_INTERVAL_MS))
+	{
+		Esd->DelayMs = 0;
+		return GslEsdActionReadStatus;
+	}
+
+	return GSLEsdPass(Esd);
+}
+
+GSL_ESD_ACTION
+GSLEsdStatusRead(
+	PGSL_ESD Esd,
+	int Ok,
+	unsigned int StatusB0,
+	unsigned int StatusBc
+	)
+{
+	Esd->StatusReads++;
+
+	if (!Ok)
+	{
+		return GSLEsdFail(Esd, GslEsdReasonBus, GslEsdActionReadStatus);
+	}
+
+	if ((StatusB0 != GSL_ESD_STATUS_B0) || (StatusBc != GSL_ESD_STATUS_BC))
+	{
+		return GSLEsdFail(Esd, GslEsdReasonStatus, GslEsdActionReadStatus);
+	}
+
+	Esd->StatusAgeMs = 0;
+	return GSLEsdPass(Esd);
+}
+
+GSL_ESD_ACTION
+GSLEsdReinitDone(
+	PGSL_ESD Esd
+	)
+{
+	//
+	// The scan counter restarts with the controller, take a new
+	// reference and read the status at the next check.
+	//
+	Esd->HasCounter = 0;
+	Esd->StatusAgeMs = 0;
+	Esd->Suspect = GslEsdReasons;
+	Esd->DelayMs = 0;
+	Esd->PeriodMs = GSL_ESD_BASE_PERIOD_MS;
+
+	return GslEsdActionDone;
+}
@@ -0,0 +1,170 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	GSLEsd.h
+
+Abstract:
+
+	Policy of the ESD watchdog, which finds a controller that stopped
+	scanning or lost its state and reinitializes it. The driver's
+	watchdog thread runs the actions the policy asks for and reports
+	what it read back:
+
+		GslEsdActionReadCounter - read the scan counter at 0xb4 and call
+			GSLEsdCounterRead. The counter advancing is the cheap first
+			stage check.
+		GslEsdActionReadStatus - read 0xb0, which holds 0x5a5a5a5a, and
+			0xbc, which holds 0, and call GSLEsdStatusRead. This runs
+			once GSL_ESD_STATUS_INTERVAL_MS passed since the last status
+			read, and after the first counter read.
+		GslEsdActionReinit - reinitialize the controller and call
+			GSLEsdReinitDone.
+
+	Before an action the thread sleeps DelayMs. A failed check is
+	repeated once after GSL_ESD_CONFIRM_DELAY_MS and only a second
+	failure reinitializes the controller.
+
+	No check runs while touch frames keep arriving, the controller is
+	obviously alive then and the bus is busy with reports. Every check
+	without touch activity since the previous one doubles the period,
+	from GSL_ESD_BASE_PERIOD_MS up to GSL_ESD_MAX_PERIOD_MS. Activity
+	and reinitializations bring it back to the base period.
+
+	Times are in ms from any free running clock and may wrap.
+
+Environment:
+
+	kernel mode, and user mode for the simulator
+
+--*/
+
+#ifndef _GSLESD_H_
+#define _GSLESD_H_
+
+#define GSL_ESD_BASE_PERIOD_MS		3000
+#define GSL_ESD_MAX_PERIOD_MS		24000
+#define GSL_ESD_CONFIRM_DELAY_MS	50
+#define GSL_ESD_STATUS_INTERVAL_MS	12000
+
+#define GSL_ESD_STATUS_B0			0x5a5a5a5a
+#define GSL_ESD_STATUS_BC			0
+
+typedef enum _GSL_ESD_ACTION
+{
+	GslEsdActionDone = 0,
+	GslEsdActionReadCounter,
+	GslEsdActionReadStatus,
+	GslEsdActionReinit
+}GSL_ESD_ACTION;
+
+typedef enum _GSL_ESD_REASON
+{
+	GslEsdReasonCounter = 0,
+	GslEsdReasonStatus,
+	GslEsdReasonBus,
+	GslEsdReasons
+}GSL_ESD_REASON;
+
+typedef struct _GSL_ESD
+{
+	//
+	// Period until the next check and the sleep before the next action.
+	//
+	unsigned int PeriodMs;
+	unsigned int DelayMs;
+
+	unsigned int LastActivity;
+	unsigned int HasActivity;
+
+	unsigned int Counter;
+	unsigned int HasCounter;
+	unsigned int StatusAgeMs;
+
+	//
+	// The failure being confirmed, GslEsdReasons when none.
+	//
+	unsigned int Suspect;
+
+	//
+	// Statistics: checks started, checks skipped for touch activity,
+	// register reads, failures cleared by their confirmation and
+	// reinitializations per reason.
+	//
+	unsigned int Checks;
+	unsigned int Skipped;
+	unsigned int CounterReads;
+	unsigned int StatusReads;
+	unsigned int FalseAlarms;
+	unsigned int Reinits;
+	unsigned int ReinitReasons[GslEsdReasons];
+}GSL_ESD, *PGSL_ESD;
+
+void
+GSLEsdInitialize(
+	PGSL_ESD Esd
+	);
+
+//
+// A touch frame was read, the controller is alive.
+//
+void
+GSLEsdActivity(
+	PGSL_ESD Esd,
+	unsigned int Now
+	);
+
+//
+// The watchdog period elapsed. Returns the first action of the check.
+//
+GSL_ESD_ACTION
+GSLEsdStart(
+	PGSL_ESD Esd,
+	unsigned int Now
+	);
+
+//
+// Ok is zero when the bus transfer failed.
+//
+GSL_ESD_ACTION
+GSLEsdCounterRead(
+	PGSL_ESD Esd,
+	int Ok,
+	unsigned int Counter
+	);
+
+GSL_ESD_ACTION
+GSLEsdStatusRead(
+	PGSL_ESD Esd,
+	int Ok,
+	unsigned int StatusB0,
+	unsigned int StatusBc
+	);
+
+//
+// The controller was reinitialized, by the watchdog or by a power up.
+//
+GSL_ESD_ACTION
+GSLEsdReinitDone(
+	PGSL_ESD Esd
+	);
+
+#endif
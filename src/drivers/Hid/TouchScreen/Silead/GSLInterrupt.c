@@ -26,6 +26,8 @@
 #include "GSLInterrupt.tmh"
 #endif
 
+C_ASSERT(sizeof(HIDFX2_INPUT_REPORT) == TOUCH_REPORT_LENGTH(MAX_CONTACTS));
+
 #if 0
 VOID DebugReportData(_In_ WDFDEVICE device, _Inout_ PHIDFX2_INPUT_REPORT pInputReport)
 {
@@ -63,12 +65,12 @@ VOID DebugReportData(_In_ WDFDEVICE device, _Inout_ PHIDFX2_INPUT_REPORT pInputR
 #endif
 
 #ifdef SUPPORT_WINKEY
-BYTE GSLProcessData(_In_ WDFDEVICE device, _Inout_ PHIDFX2_INPUT_REPORT pInputReport, _Inout_ PHIDFX2_INPUT_REPORT_EX pInputReportEx)
+BYTE GSLProcessData(_In_ WDFDEVICE device, _Out_writes_(MAX_CONTACTS) PTOUCH_POINT Points, _Out_ PUCHAR PointCount, _Inout_ PHIDFX2_INPUT_REPORT_EX pInputReportEx)
 #else
-BYTE GSLProcessData(_In_ WDFDEVICE device, _Inout_ PHIDFX2_INPUT_REPORT pInputReport)
+BYTE GSLProcessData(_In_ WDFDEVICE device, _Out_writes_(MAX_CONTACTS) PTOUCH_POINT Points, _Out_ PUCHAR PointCount)
 #endif
 {
-	UCHAR	i, id, xlsb, xmsb, ylsb, ymsb;
+	UCHAR	i, id, count;
 	UCHAR	touch_data[4 + MAX_CONTACTS*4];
 	PDEVICE_EXTENSION	devContext;
 	NTSTATUS Status = STATUS_SUCCESS;
@@ -77,10 +79,10 @@ BYTE GSLProcessData(_In_ WDFDEVICE device, _Inout_ PHIDFX2_INPUT_REPORT pInputRe
 	UCHAR buf[4] = {0};
 	struct gsl_touch_info cinfo = {0};
 	BYTE process_status = 1;
-	BOOLEAN bUP = FALSE;
 	DbgPrintGSL("%s Entry\n", __FUNCTION__);
 
 	devContext = GetDeviceContext(device);
+	*PointCount = 0;
 
 #ifdef SUPPORT_WINKEY	
 	pInputReportEx->ReportTouchId = REPORTID_WINKEY;
@@ -89,53 +91,12 @@ BYTE GSLProcessData(_In_ WDFDEVICE device, _Inout_ PHIDFX2_INPUT_REPORT pInputRe
 	for(i = 0; i < 6; i ++)
 		pInputReportEx->KeyCode[i] = 0;
 #endif
-	pInputReport->ReportTouchId = REPORTID_INPUT;
-	pInputReport->Tip0 = 0;
-	pInputReport->Tip1 = 0;
-	pInputReport->Tip2 = 0;
-	pInputReport->Tip3 = 0;
-	pInputReport->Tip4 = 0;
-#ifndef	SET_MULTITOUCH_5POINT
-	pInputReport->Tip5 = 0;
-	pInputReport->Tip6 = 0;
-	pInputReport->Tip7 = 0;
-	pInputReport->Tip8 = 0;
-	pInputReport->Tip9 = 0;
-#endif
-	pInputReport->ContactId0 = 0;
-	pInputReport->ContactId1 = 0;
-	pInputReport->ContactId2 = 0;
-	pInputReport->ContactId3 = 0;
-	pInputReport->ContactId4 = 0;
-#ifndef	SET_MULTITOUCH_5POINT
-	pInputReport->ContactId5 = 0;
-	pInputReport->ContactId6 = 0;
-	pInputReport->ContactId7 = 0;
-	pInputReport->ContactId8 = 0;
-	pInputReport->ContactId9 = 0;
-#endif
 
 	/*
-	1.clear new to 0,Point_Data[0][0-9]
-	2.assign new, Point_Data[0][id[i]-1]
-	3.judge up or down
-	4.new becomes old.
-	remark: Point_Data[0][0-9] store new data, Point_Data[1][0-9] store old data
+	The points of this frame are handed to the contact tracker, which
+	keeps the contact ids stable and reports the lifts, see touchreport.h.
 	*/
 
-	{	//step1: clear new to 0, Point_Data[0][0 - 9]
-		UINT8 i1 = 0;
-		UINT8 j = 0;
-		for (; i1 < PS_DEEP-1; i1++)
-		{
-			for (; j < MAX_CONTACTS; j++)
-			{
-				devContext->Point_Data[i1][j].id = 0;
-				devContext->Point_Data[i1][j].x = 0;
-				devContext->Point_Data[i1][j].y = 0;
-			}
-		}
-	}
 	Status = GSLDevReadBuffer(device, 0x80, touch_data, sizeof(touch_data));
 	if (!NT_SUCCESS(Status)) {
 		DbgPrint("read touch data error! Status = 0x%x\n", Status);
@@ -190,40 +151,31 @@ BYTE GSLProcessData(_In_ WDFDEVICE device, _Inout_ PHIDFX2_INPUT_REPORT pInputRe
 	if(touches == 0)
 		DbgPrintGSL("=======raw data, finger_number = 0 =======\n");
 
-	pInputReport->ScanTimeLSB = (devContext->ScanTime)&0xff;
-	pInputReport->ScanTimeMSB = ((devContext->ScanTime)>>8)&0xff;
-	DbgPrintGSL("----devContext->ScanTime = %d, ScanTimeMSB = %d, ScanTimeLSB = %d\n", devContext->ScanTime, pInputReport->ScanTimeMSB, pInputReport->ScanTimeLSB);
-
+	count = 0;
 	for(i = 0; i < touches; i ++)
 	{
 		if(devContext->NoIDVersion)
 		{		
 			id = (UCHAR)cinfo.id[i];
-			xmsb = (UCHAR)(cinfo.x[i]>>8);
-			xlsb = (UCHAR)(cinfo.x[i]&0xff);
-			ymsb = (UCHAR)(cinfo.y[i]>>8);
-			ylsb = (UCHAR)(cinfo.y[i] & 0xff);
 			if (id > 0)
 			{
-				devContext->Point_Data[0][(UINT8)(id - 1)].id = (UINT8)id;
 				cinfo.x[i] = 800 - cinfo.x[i];
-				devContext->Point_Data[0][(UINT8)(id - 1)].x = cinfo.x[i];
 				cinfo.y[i] =1280 - cinfo.y[i];
-				devContext->Point_Data[0][(UINT8)(id - 1)].y = cinfo.y[i];
+				Points[count].Id = id;
+				Points[count].X = (USHORT)cinfo.x[i];
+				Points[count].Y = (USHORT)cinfo.y[i];
+				count++;
 			}
-			//DbgPrintGSL("==========after x[%d] = %d, y[%d] = %d, id[%d] = %d ==========\n", i, cinfo.x[i], i, cinfo.y[i], i, id);
-			//DbgPrintEx(DPFLTR_IHVDRIVER_ID, 0, "==========after x[%d] = %d, y[%d] = %d, id[%d] = %d ==========\n", i, cinfo.x[i], i, cinfo.y[i], i, id);
-
 		}
 		else
 		{		
 			id = (touch_data[4 + i*4 + 3]>>4)&0xf;
-			xmsb = touch_data[4 + i*4 + 3]&0xf;
-			xlsb = touch_data[4 + i*4 + 2];
-			ymsb = touch_data[4 + i*4 + 1];
-			ylsb = touch_data[4 + i*4 + 0];
+			Points[count].Id = id;
+			Points[count].X = (USHORT)(800 - ((touch_data[4 + i*4 + 3]&0xf)*256 + touch_data[4 + i*4 + 2]));
+			Points[count].Y = (USHORT)(1280 - (touch_data[4 + i*4 + 1]*256 + touch_data[4 + i*4 + 0]));
+			count++;
 		}
- 		DbgPrintGSL("=======raw data, id = %d, xmsb = %d, xlsb = %d, ymsb = %d, ylsb = %d=======\n", id, xmsb, xlsb, ymsb, ylsb);
+ 		DbgPrintGSL("=======raw data, id = %d, x = %d, y = %d=======\n", id, cinfo.x[i], cinfo.y[i]);
 
 #ifdef SUPPORT_WINKEY		
 		if((cinfo.x[i] > (WINKEY_CENTER_X - WINKEY_WIDTH_X/2))
@@ -239,248 +191,41 @@ BYTE GSLProcessData(_In_ WDFDEVICE device, _Inout_ PHIDFX2_INPUT_REPORT pInputRe
 		}
 #endif
 	}
-	//step3: judge up or down
-	for (i = 0; i < MAX_TOUCHES; i++)
+	*PointCount = count;
+
+#ifdef SUPPORT_WINKEY
+	if(devContext->ButtonDown  == TRUE)
 	{
-		if (devContext->Point_Data[0][i].x != 0 || devContext->Point_Data[0][i].y != 0)	//new data !=0, it is down.
-		{			
-			if (pInputReport->XLSB0 == 0 && pInputReport->XMSB0 == 0 && pInputReport->YLSB0 == 0 && pInputReport->YMSB0 == 0 && pInputReport->ContactId0 == 0)
-			{
-				pInputReport->Tip0 = 1;
-				pInputReport->ContactId0 = devContext->Point_Data[0][i].id;
-				pInputReport->XLSB0 = (UCHAR)(devContext->Point_Data[0][i].x & 0xff);
-				pInputReport->XMSB0 = (UCHAR)(devContext->Point_Data[0][i].x >> 8);
-				pInputReport->YLSB0 = (UCHAR)(devContext->Point_Data[0][i].y & 0xff);
-				pInputReport->YMSB0 = (UCHAR)(devContext->Point_Data[0][i].y >> 8);
-				continue;
-			}
-			if (pInputReport->XLSB1 == 0 && pInputReport->XMSB1 == 0 && pInputReport->YLSB1 == 0 && pInputReport->YMSB1 == 0 && pInputReport->ContactId1 == 0)
-			{
-				pInputReport->Tip1 = 1;
-				pInputReport->ContactId1 = devContext->Point_Data[0][i].id;
-				pInputReport->XLSB1 = (UCHAR)(devContext->Point_Data[0][i].x & 0xff);
-				pInputReport->XMSB1 = (UCHAR)(devContext->Point_Data[0][i].x >> 8);
-				pInputReport->YLSB1 = (UCHAR)(devContext->Point_Data[0][i].y & 0xff);
-				pInputReport->YMSB1 = (UCHAR)(devContext->Point_Data[0][i].y >> 8);
-				continue;
-			}
-			if (pInputReport->XLSB2 == 0 && pInputReport->XMSB2 == 0 && pInputReport->YLSB2 == 0 && pInputReport->YMSB2 == 0 && pInputReport->ContactId2 == 0)
-			{
-				pInputReport->Tip2 = 1;
-				pInputReport->ContactId2 = devContext->Point_Data[0][i].id;
-				pInputReport->XLSB2 = (UCHAR)(devContext->Point_Data[0][i].x & 0xff);
-				pInputReport->XMSB2 = (UCHAR)(devContext->Point_Data[0][i].x >> 8);
-				pInputReport->YLSB2 = (UCHAR)(devContext->Point_Data[0][i].y & 0xff);
-				pInputReport->YMSB2 = (UCHAR)(devContext->Point_Data[0][i].y >> 8);
-				continue;
-			}
-			if (pInputReport->XLSB3 == 0 && pInputReport->XMSB3 == 0 && pInputReport->YLSB3 == 0 && pInputReport->YMSB3 == 0 && pInputReport->ContactId3 == 0)
-			{
-				pInputReport->Tip3 = 1;
-				pInputReport->ContactId3 = devContext->Point_Data[0][i].id;
-				pInputReport->XLSB3 = (UCHAR)(devContext->Point_Data[0][i].x & 0xff);
-				pInputReport->XMSB3 = (UCHAR)(devContext->Point_Data[0][i].x >> 8);
-				pInputReport->YLSB3 = (UCHAR)(devContext->Point_Data[0][i].y & 0xff);
-				pInputReport->YMSB3 = (UCHAR)(devContext->Point_Data[0][i].y >> 8);
-				continue;
-			}
-			if (pInputReport->XLSB4 == 0 && pInputReport->XMSB4 == 0 && pInputReport->YLSB4 == 0 && pInputReport->YMSB4 == 0 && pInputReport->ContactId4 == 0)
-			{
-				pInputReport->Tip4 = 1;
-				pInputReport->ContactId4 = devContext->Point_Data[0][i].id;
-				pInputReport->XLSB4 = (UCHAR)(devContext->Point_Data[0][i].x & 0xff);
-				pInputReport->XMSB4 = (UCHAR)(devContext->Point_Data[0][i].x >> 8);
-				pInputReport->YLSB4 = (UCHAR)(devContext->Point_Data[0][i].y & 0xff);
-				pInputReport->YMSB4 = (UCHAR)(devContext->Point_Data[0][i].y >> 8);
-				continue;
-			}
-#ifndef	SET_MULTITOUCH_5POINT
-			if (pInputReport->XLSB5 == 0 && pInputReport->XMSB5 == 0 && pInputReport->YLSB5 == 0 && pInputReport->YMSB5 == 0 && pInputReport->ContactId5 == 0)
-			{
-				pInputReport->Tip5 = 1;
-				pInputReport->ContactId5 = devContext->Point_Data[0][i].id;
-				pInputReport->XLSB5 = (UCHAR)(devContext->Point_Data[0][i].x & 0xff);
-				pInputReport->XMSB5 = (UCHAR)(devContext->Point_Data[0][i].x >> 8);
-				pInputReport->YLSB5 = (UCHAR)(devContext->Point_Data[0][i].y & 0xff);
-				pInputReport->YMSB5 = (UCHAR)(devContext->Point_Data[0][i].y >> 8);
-				continue;
-			}
-			if (pInputReport->XLSB6 == 0 && pInputReport->XMSB6 == 0 && pInputReport->YLSB6 == 0 && pInputReport->YMSB6 == 0 && pInputReport->ContactId6 == 0)
-			{
-				pInputReport->Tip6 = 1;
-				pInputReport->ContactId6 = devContext->Point_Data[0][i].id;
-				pInputReport->XLSB6 = (UCHAR)(devContext->Point_Data[0][i].x & 0xff);
-				pInputReport->XMSB6 = (UCHAR)(devContext->Point_Data[0][i].x >> 8);
-				pInputReport->YLSB6 = (UCHAR)(devContext->Point_Data[0][i].y & 0xff);
-				pInputReport->YMSB6 = (UCHAR)(devContext->Point_Data[0][i].y >> 8);
-				continue;
-			}
-			if (pInputReport->XLSB7 == 0 && pInputReport->XMSB7 == 0 && pInputReport->YLSB7 == 0 && pInputReport->YMSB7 == 0 && pInputReport->ContactId7 == 0)
-			{
-				pInputReport->Tip7 = 1;
-				pInputReport->ContactId7 = devContext->Point_Data[0][i].id;
-				pInputReport->XLSB7 = (UCHAR)(devContext->Point_Data[0][i].x & 0xff);
-				pInputReport->XMSB7 = (UCHAR)(devContext->Point_Data[0][i].x >> 8);
-				pInputReport->YLSB7 = (UCHAR)(devContext->Point_Data[0][i].y & 0xff);
-				pInputReport->YMSB7 = (UCHAR)(devContext->Point_Data[0][i].y >> 8);
-				continue;
-			}
-			if (pInputReport->XLSB8 == 0 && pInputReport->XMSB8 == 0 && pInputReport->YLSB8 == 0 && pInputReport->YMSB8 == 0 && pInputReport->ContactId8 == 0)
-			{
-				pInputReport->Tip8 = 1;
-				pInputReport->ContactId8 = devContext->Point_Data[0][i].id;
-				pInputReport->XLSB8 = (UCHAR)(devContext->Point_Data[0][i].x & 0xff);
-				pInputReport->XMSB8 = (UCHAR)(devContext->Point_Data[0][i].x >> 8);
-				pInputReport->YLSB8 = (UCHAR)(devContext->Point_Data[0][i].y & 0xff);
-				pInputReport->YMSB8 = (UCHAR)(devContext->Point_Data[0][i].y >> 8);
-				continue;
-			}
-			if (pInputReport->XLSB9 == 0 && pInputReport->XMSB9 == 0 && pInputReport->YLSB9 == 0 && pInputReport->YMSB9 == 0 && pInputReport->ContactId9 == 0)
-			{
-				pInputReport->Tip9 = 1;
-				pInputReport->ContactId9 = devContext->Point_Data[0][i].id;
-				pInputReport->XLSB9 = (UCHAR)(devContext->Point_Data[0][i].x & 0xff);
-				pInputReport->XMSB9 = (UCHAR)(devContext->Point_Data[0][i].x >> 8);
-				pInputReport->YLSB9 = (UCHAR)(devContext->Point_Data[0][i].y & 0xff);
-				pInputReport->YMSB9 = (UCHAR)(devContext->Point_Data[0][i].y >> 8);
-				continue;
-			}
-#endif
-		}
-		else if (devContext->Point_Data[1][i].x != 0 || devContext->Point_Data[1][i].y != 0)
+		if(process_status != 2)
 		{
-			bUP = TRUE;
-			//new data = 0, old != 0, it is up.
-			if (pInputReport->XLSB0 == 0 && pInputReport->XMSB0 == 0 && pInputReport->YLSB0 == 0 && pInputReport->YMSB0 == 0 && pInputReport->ContactId0 == 0)
-			{
-				pInputReport->Tip0 = 0;
-				pInputReport->ContactId0 = devContext->Point_Data[1][i].id;
-				pInputReport->XLSB0 = (UCHAR)(devContext->Point_Data[1][i].x & 0xff);
-				pInputReport->XMSB0 = (UCHAR)(devContext->Point_Data[1][i].x >> 8);
-				pInputReport->YLSB0 = (UCHAR)(devContext->Point_Data[1][i].y & 0xff);
-				pInputReport->YMSB0 = (UCHAR)(devContext->Point_Data[1][i].y >> 8);
-				continue;
-			}
-			if (pInputReport->XLSB1 == 0 && pInputReport->XMSB1 == 0 && pInputReport->YLSB1 == 0 && pInputReport->YMSB1 == 0 && pInputReport->ContactId1 == 0)
-			{
-				pInputReport->Tip1 = 0;
-				pInputReport->ContactId1 = devContext->Point_Data[1][i].id;
-				pInputReport->XLSB1 = (UCHAR)(devContext->Point_Data[1][i].x & 0xff);
-				pInputReport->XMSB1 = (UCHAR)(devContext->Point_Data[1][i].x >> 8);
-				pInputReport->YLSB1 = (UCHAR)(devContext->Point_Data[1][i].y & 0xff);
-				pInputReport->YMSB1 = (UCHAR)(devContext->Point_Data[1][i].y >> 8);
-				continue;
-			}
-			if (pInputReport->XLSB2 == 0 && pInputReport->XMSB2 == 0 && pInputReport->YLSB2 == 0 && pInputReport->YMSB2 == 0 && pInputReport->ContactId2 == 0)
-			{
-				pInputReport->Tip2 = 0;
-				pInputReport->ContactId2 = devContext->Point_Data[1][i].id;
-				pInputReport->XLSB2 = (UCHAR)(devContext->Point_Data[1][i].x & 0xff);
-				pInputReport->XMSB2 = (UCHAR)(devContext->Point_Data[1][i].x >> 8);
-				pInputReport->YLSB2 = (UCHAR)(devContext->Point_Data[1][i].y & 0xff);
-				pInputReport->YMSB2 = (UCHAR)(devContext->Point_Data[1][i].y >> 8);
-				continue;
-			}
-			if (pInputReport->XLSB3 == 0 && pInputReport->XMSB3 == 0 && pInputReport->YLSB3 == 0 && pInputReport->YMSB3 == 0 && pInputReport->ContactId3 == 0)
-			{
-				pInputReport->Tip3 = 0;
-				pInputReport->ContactId3 = devContext->Point_Data[1][i].id;
-				pInputReport->XLSB3 = (UCHAR)(devContext->Point_Data[1][i].x & 0xff);
-				pInputReport->XMSB3 = (UCHAR)(devContext->Point_Data[1][i].x >> 8);
-				pInputReport->YLSB3 = (UCHAR)(devContext->Point_Data[1][i].y & 0xff);
-				pInputReport->YMSB3 = (UCHAR)(devContext->Point_Data[1][i].y >> 8);
-				continue;
-			}
-			if (pInputReport->XLSB4 == 0 && pInputReport->XMSB4 == 0 && pInputReport->YLSB4 == 0 && pInputReport->YMSB4 == 0 && pInputReport->ContactId4 == 0)
-			{
-				pInputReport->Tip4 = 0;
-				pInputReport->ContactId4 = devContext->Point_Data[1][i].id;
-				pInputReport->XLSB4 = (UCHAR)(devContext->Point_Data[1][i].x & 0xff);
-				pInputReport->XMSB4 = (UCHAR)(devContext->Point_Data[1][i].x >> 8);
-				pInputReport->YLSB4 = (UCHAR)(devContext->Point_Data[1][i].y & 0xff);
-				pInputReport->YMSB4 = (UCHAR)(devContext->Point_Data[1][i].y >> 8);
-				continue;
-			}
-#ifndef	SET_MULTITOUCH_5POINT			
-			if (pInputReport->XLSB5 == 0 && pInputReport->XMSB5 == 0 && pInputReport->YLSB5 == 0 && pInputReport->YMSB5 == 0 && pInputReport->ContactId5 == 0)
-			{
-				pInputReport->Tip5 = 0;
-				pInputReport->ContactId5 = devContext->Point_Data[1][i].id;
-				pInputReport->XLSB5 = (UCHAR)(devContext->Point_Data[1][i].x & 0xff);
-				pInputReport->XMSB5 = (UCHAR)(devContext->Point_Data[1][i].x >> 8);
-				pInputReport->YLSB5 = (UCHAR)(devContext->Point_Data[1][i].y & 0xff);
-				pInputReport->YMSB5 = (UCHAR)(devContext->Point_Data[1][i].y >> 8);
-				continue;
-			}
-			if (pInputReport->XLSB6 == 0 && pInputReport->XMSB6 == 0 && pInputReport->YLSB6 == 0 && pInputReport->YMSB6 == 0 && pInputReport->ContactId6 == 0)
-			{
-				pInputReport->Tip6 = 0;
-				pInputReport->ContactId6 = devContext->Point_Data[1][i].id;
-				pInputReport->XLSB6 = (UCHAR)(devContext->Point_Data[1][i].x & 0xff);
-				pInputReport->XMSB6 = (UCHAR)(devContext->Point_Data[1][i].x >> 8);
-				pInputReport->YLSB6 = (UCHAR)(devContext->Point_Data[1][i].y & 0xff);
-				pInputReport->YMSB6 = (UCHAR)(devContext->Point_Data[1][i].y >> 8);
-				continue;
-			}
-			if (pInputReport->XLSB7 == 0 && pInputReport->XMSB7 == 0 && pInputReport->YLSB7 == 0 && pInputReport->YMSB7 == 0 && pInputReport->ContactId7 == 0)
-			{
-				pInputReport->Tip7 = 0;
-				pInputReport->ContactId7 = devContext->Point_Data[1][i].id;
-				pInputReport->XLSB7 = (UCHAR)(devContext->Point_Data[1][i].x & 0xff);
-				pInputReport->XMSB7 = (UCHAR)(devContext->Point_Data[1][i].x >> 8);
-				pInputReport->YLSB7 = (UCHAR)(devContext->Point_Data[1][i].y & 0xff);
-				pInputReport->YMSB7 = (UCHAR)(devContext->Point_Data[1][i].y >> 8);
-				continue;
-			}
-			if (pInputReport->XLSB8 == 0 && pInputReport->XMSB8 == 0 && pInputReport->YLSB8 == 0 && pInputReport->YMSB8 == 0 && pInputReport->ContactId8 == 0)
-			{
-				pInputReport->Tip8 = 0;
-				pInputReport->ContactId8 = devContext->Point_Data[1][i].id;
-				pInputReport->XLSB8 = (UCHAR)(devContext->Point_Data[1][i].x & 0xff);
-				pInputReport->XMSB8 = (UCHAR)(devContext->Point_Data[1][i].x >> 8);
-				pInputReport->YLSB8 = (UCHAR)(devContext->Point_Data[1][i].y & 0xff);
-				pInputReport->YMSB8 = (UCHAR)(devContext->Point_Data[1][i].y >> 8);
-				continue;
-			}
-			if (pInputReport->XLSB9 == 0 && pInputReport->XMSB9 == 0 && pInputReport->YLSB9 == 0 && pInputReport->YMSB9 == 0 && pInputReport->ContactId9 == 0)
-			{
-				pInputReport->Tip9 = 0;
-				pInputReport->ContactId9 = devContext->Point_Data[1][i].id;
-				pInputReport->XLSB9 = (UCHAR)(devContext->Point_Data[1][i].x & 0xff);
-				pInputReport->XMSB9 = (UCHAR)(devContext->Point_Data[1][i].x >> 8);
-				pInputReport->YLSB9 = (UCHAR)(devContext->Point_Data[1][i].y & 0xff);
-				pInputReport->YMSB9 = (UCHAR)(devContext->Point_Data[1][i].y >> 8);
-				continue;
-			}
-#endif
+			devContext->ButtonDown  = FALSE;
+			process_status = 2;
 		}
 	}
-	devContext->ContactCount[0] = touches;
-	if (bUP == TRUE)
-		pInputReport->ContactCount = devContext->ContactCount[1];
 	else
-		pInputReport->ContactCount = devContext->ContactCount[0];
-
-	//step4: new becomes old.
-	for (i = 0; i < MAX_TOUCHES; i++)
 	{
-		devContext->Point_Data[1][i].x = devContext->Point_Data[0][i].x;
-		devContext->Point_Data[1][i].y = devContext->Point_Data[0][i].y;
-		devContext->Point_Data[1][i].id = devContext->Point_Data[0][i].id;
+		if(process_status == 2)	
+			devContext->ButtonDown  = TRUE;
 	}
-	devContext->ContactCount[1] = devContext->ContactCount[0];
+#endif
+	return process_status;
+}
+
+static VOID GSLUpdateScanTime(_In_ PDEVICE_EXTENSION devContext, _In_ ULONG contacts)
+{
+	UNREFERENCED_PARAMETER(contacts);
 
 #ifdef SCANTIME_CONSTANT
-	if(devContext->ScanTime < 65535 && 0 != pInputReport->ContactCount)
+	if(devContext->ScanTime < 65535 && 0 != contacts)
 		devContext->ScanTime += SCANTIME_STEP;
-	if (devContext->ScanTime > 65535 || 0 == pInputReport->ContactCount)
+	if (devContext->ScanTime > 65535 || 0 == contacts)
 		devContext->ScanTime = 0;
 #endif
 
 #ifdef SCANTIME_SYSTEM
 	//ScanTime for WHQL test
 	{
-		if (pInputReport->ContactCount == 0)
+		if (contacts == 0)
 		{
 			devContext->bStartTime = FALSE;
 			devContext->ScanTime = 0;
@@ -516,28 +261,6 @@ BYTE GSLProcessData(_In_ WDFDEVICE device, _Inout_ PHIDFX2_INPUT_REPORT pInputRe
 		}
 	}
 #endif
-
-#ifdef SUPPORT_WINKEY
-	if(devContext->ButtonDown  == TRUE)
-	{
-		if(process_status != 2)
-		{
-			devContext->ButtonDown  = FALSE;
-			process_status = 2;
-		}
-	}
-	else
-	{
-		if(process_status == 2)	
-			devContext->ButtonDown  = TRUE;
-	}
-#endif
-#if 0
-	{
-		DebugReportData(device, pInputReport);
-	}
-#endif	
-	return process_status;
 }
 
 /*
@@ -560,15 +283,22 @@ GSLDevInterruptIsr(_In_ WDFINTERRUPT Interrupt, _In_ ULONG MessageID)
 	BOOLEAN				InterruptRecognized = FALSE;
 	NTSTATUS			status;
 	WDFREQUEST			request = NULL;
-	WDFMEMORY			reqMemory;
-	HIDFX2_INPUT_REPORT	InputReport = { 0 };
+	PVOID				reportBuffer;
+	size_t				reportLength;
+	TOUCH_POINT			points[MAX_CONTACTS];
+	UCHAR				pointCount = 0;
+	BOOLEAN				queued = FALSE;
+	ULONGLONG			interruptTime;
 #ifdef SUPPORT_WINKEY
+	WDFMEMORY			reqMemory;
 	HIDFX2_INPUT_REPORT_EX	InputReportEx = { 0 };
 #endif
 	BYTE process_status;
 	
 	//DbgPrintEx(DPFLTR_IHVDRIVER_ID,0,"%s SSSSSSSSSSSSSSSSSSSS GSLDevInterruptIsr \n", __FUNCTION__);
 	UNREFERENCED_PARAMETER(MessageID);
+
+	interruptTime = TouchTimeUs();
 	
 	device = WdfInterruptGetDevice(Interrupt);
 	devContext = GetDeviceContext(device);
@@ -584,52 +314,97 @@ GSLDevInterruptIsr(_In_ WDFINTERRUPT Interrupt, _In_ ULONG MessageID)
 		devContext->i2c_lock = 1;
 	}
 #endif
-	status = WdfIoQueueRetrieveNextRequest(
-		devContext->ReportQueue,
-		&request);
-	if (!NT_SUCCESS(status) || (request == NULL)) {
-		DbgPrintGSL("No requests to process, WdfIoQueueRetrieveNextRequest failed status: 0x%x\n", status);
-		goto exit;// No requests to process. 
+	//
+	// A dozing chip goes back to full rate before its first frame is
+	// read, and the quiet period starts over.
+	//
+	if (TouchActivityInterrupt(&devContext->Activity, QuerySystemTime()))
+	{
+		GSL_Exit_Doze(device);
+		WdfTimerStart(devContext->DozeTimer, WDF_REL_TIMEOUT_IN_MS(devContext->Activity.QuietMs));
 	}
+
 #ifdef SUPPORT_WINKEY
-	process_status = GSLProcessData(device, &InputReport, &InputReportEx);
+	process_status = GSLProcessData(device, points, &pointCount, &InputReportEx);
 #else
-	process_status = GSLProcessData(device, &InputReport);
+	process_status = GSLProcessData(device, points, &pointCount);
 #endif
 	DbgPrintGSL("GSLProcessData, process_status = %d\n", process_status);
 	if (1 == process_status)
 	{
 		//
-		// Retrieve the request buffer
+		// The latency statistics are shared with the DPC, which records
+		// the completions, and with feature report reads.
 		//
-		status = WdfRequestRetrieveOutputMemory(request, &reqMemory);
-		if (!NT_SUCCESS(status))
-		{
-			DbgPrint("WdfRequestRetrieveOutputMemory failed status: 0x%x\n", status);
-			goto requestComplete;
-		}
+		WdfSpinLockAcquire(devContext->DpcLock);
+		TouchTrackerSetFrameTimes(&devContext->Tracker, interruptTime, TouchTimeUs());
+		WdfSpinLockRelease(devContext->DpcLock);
 
-		//
-		// Copy the input report into the request buffer
-		status = WdfMemoryCopyFromBuffer(
-			reqMemory,
-			0,
-			(PVOID)&InputReport,
-			sizeof(HIDFX2_INPUT_REPORT));
-		if (!NT_SUCCESS(status))
-		{
-			DbgPrint("WdfMemoryCopyFromBuffer failed status: 0x%x\n", status);
-			goto requestComplete;
-		}
+		TouchTrackerUpdate(&devContext->Tracker, points, pointCount, (USHORT)devContext->ScanTime);
+		GSLUpdateScanTime(devContext, devContext->Tracker.FrameContacts);
+#ifdef GSL_TIMER
+		GSLEsdActivity(&devContext->Esd, QuerySystemTime());
+#endif
 
 		//
-		// Report how many bytes were copied
+		// Every report of the frame is written straight into the output
+		// buffer of a pended read. A frame left without reads is replaced
+		// by the next one.
 		//
-		WdfRequestSetInformation(request, sizeof(HIDFX2_INPUT_REPORT));
+		while (devContext->Tracker.PendingReports != 0)
+		{
+			status = WdfIoQueueRetrieveNextRequest(
+				devContext->ReportQueue,
+				&request);
+			if (!NT_SUCCESS(status) || (request == NULL)) {
+				DbgPrintGSL("No requests to process, WdfIoQueueRetrieveNextRequest failed status: 0x%x\n", status);
+				break;// No requests to process. 
+			}
+
+			status = WdfRequestRetrieveOutputBuffer(
+				request,
+				sizeof(HIDFX2_INPUT_REPORT),
+				&reportBuffer,
+				&reportLength);
+			if (!NT_SUCCESS(status))
+			{
+				DbgPrint("WdfRequestRetrieveOutputBuffer failed status: 0x%x\n", status);
+			}
+			else
+			{
+				//
+				// Report how many bytes were written
+				//
+				WdfRequestSetInformation(request,
+					TouchTrackerNextReport(&devContext->Tracker, reportBuffer, (ULONG)reportLength));
+
+				WdfSpinLockAcquire(devContext->DpcLock);
+				TouchTrackerReportBuilt(&devContext->Tracker, TouchTimeUs());
+				WdfSpinLockRelease(devContext->DpcLock);
+			}
+
+			status = WdfRequestForwardToIoQueue(request, devContext->CompletionQueue);
+			if (!NT_SUCCESS(status)) {
+				//
+				// CompletionQueue is a manual-dispatch, non-power-managed queue. This should*never* fail.
+				//
+				DbgPrint("WdfRequestForwardToIoQueue failed status: 0x%x\n", status);
+				break;
+			}
+			queued = TRUE;
+		}
 	}
 #ifdef SUPPORT_WINKEY
 	else if(2 == process_status)
 	{
+		status = WdfIoQueueRetrieveNextRequest(
+			devContext->ReportQueue,
+			&request);
+		if (!NT_SUCCESS(status) || (request == NULL)) {
+			DbgPrintGSL("No requests to process, WdfIoQueueRetrieveNextRequest failed status: 0x%x\n", status);
+			goto exit;// No requests to process. 
+		}
+
 		//
 		// Retrieve the request buffer
 		//
@@ -657,24 +432,25 @@ GSLDevInterruptIsr(_In_ WDFINTERRUPT Interrupt, _In_ ULONG MessageID)
 		// Report how many bytes were copied
 		//
 		WdfRequestSetInformation(request, sizeof(HIDFX2_INPUT_REPORT_EX));
-	}
-#endif
-	else
-	{
-		goto exit;
-	}
 
 requestComplete:
-	status = WdfRequestForwardToIoQueue(request, devContext->CompletionQueue);
-	if (!NT_SUCCESS(status)) {
-		//
-		// CompletionQueue is a manual-dispatch, non-power-managed queue. This should*never* fail.
-		//
-		DbgPrint("WdfRequestForwardToIoQueue failed status: 0x%x\n", status);
-		goto exit;
+		status = WdfRequestForwardToIoQueue(request, devContext->CompletionQueue);
+		if (!NT_SUCCESS(status)) {
+			//
+			// CompletionQueue is a manual-dispatch, non-power-managed queue. This should*never* fail.
+			//
+			DbgPrint("WdfRequestForwardToIoQueue failed status: 0x%x\n", status);
+			goto exit;
+		}
+		queued = TRUE;
 	}
-	WdfInterruptQueueDpcForIsr(Interrupt);
+#endif
+
+	if (queued)
+		WdfInterruptQueueDpcForIsr(Interrupt);
+#ifdef SUPPORT_WINKEY
 exit:
+#endif
 #ifdef GSL_TIMER
 	devContext->i2c_lock = 0;
 i2c_lock:
@@ -734,6 +510,10 @@ GSLDevInterruptDpc(_In_ WDFINTERRUPT Interrupt, _In_ WDFOBJECT AssociatedObject)
 			}
 			DbgPrintGSL("%s in the completion queuesuccess\n", __FUNCTION__);
 			WdfRequestComplete(request, STATUS_SUCCESS);
+
+			WdfSpinLockAcquire(devContext->DpcLock);
+			TouchTrackerReportCompleted(&devContext->Tracker, TouchTimeUs());
+			WdfSpinLockRelease(devContext->DpcLock);
 		}
 
 		WdfSpinLockAcquire(devContext->DpcLock);
@@ -366,6 +366,7 @@ CONST  HID_REPORT_DESCRIPTOR           G_DefaultReportDescriptor[] = {//386
 	0x75, 0x08,                         //   REPORT_SIZE (8)             
 	0x96, 0x00, 0x01,                   //   REPORT_COUNT (0x100 (256))             
 	0xb1, 0x02,                         //   FEATURE (Data,Var,Abs) 
+	TOUCH_LATENCY_FEATURE_DESCRIPTOR,
 	0xc0, // END_COLLECTION
 
 #ifdef SUPPORT_WINKEY
@@ -488,6 +489,10 @@ IN ULONG        IoControlCode
 		//WdfRequestCompleteWithInformation(Request, status, bytesReturned);
 		break;
 
+	case IOCTL_HID_SET_FEATURE:
+		status = SetFeatureReport(device, Request);
+		break;
+
 	case IOCTL_HID_GET_STRING:
 		status = HidGSLGetString(device, Request);
 		break;
@@ -511,7 +516,6 @@ IN ULONG        IoControlCode
 	case IOCTL_HID_DEACTIVATE_DEVICE:
 	case IOCTL_HID_SET_OUTPUT_REPORT:			    //host to device
 
-	case IOCTL_HID_SET_FEATURE:
 	case IOCTL_HID_GET_INPUT_REPORT:
 	default:
 		status = STATUS_NOT_SUPPORTED;
@@ -970,6 +974,25 @@ NTSTATUS indicating success or failure
 			WdfRequestSetInformation(FxRequest, sizeof (HID_FW_KEY_REPORT));
 			break;
 		}
+
+		case TOUCH_LATENCY_REPORT_ID:
+		{
+			ULONG length;
+
+			status = TouchTrackerGetLatencyFeature(&devContext->Tracker,
+				devContext->DpcLock,
+				featurePacket->reportBuffer,
+				featurePacket->reportBufferLen,
+				&length);
+			if (!NT_SUCCESS(status))
+			{
+				DbgPrint("GetFeatureReport TOUCH_LATENCY_REPORT_ID STATUS_BUFFER_TOO_SMALL====\n");
+				goto exit;
+			}
+
+			WdfRequestSetInformation(FxRequest, length);
+			break;
+		}
 		default:
 		{
 			DbgPrint("GetFeatureReportSTATUS_INVALID_PARAMETER====\n");
@@ -983,6 +1006,62 @@ exit:
 	return status;
 }
 
+NTSTATUS
+SetFeatureReport(
+_In_ WDFDEVICE  FxDevice,
+_In_ WDFREQUEST FxRequest
+)
+/*++
+
+Routine Description:
+
+Handles a HID Feature report written by the host. Only the latency
+report is writable, writing it clears the statistics.
+
+Arguments:
+
+FxDevice  - Framework device object
+FxRequest - Framework request object
+
+Return Value:
+
+NTSTATUS indicating success or failure
+
+--*/
+{
+	PDEVICE_EXTENSION             devContext;
+	PHID_XFER_PACKET       featurePacket;
+	WDF_REQUEST_PARAMETERS params;
+
+	devContext = GetDeviceContext(FxDevice);
+
+	WDF_REQUEST_PARAMETERS_INIT(&params);
+	WdfRequestGetParameters(FxRequest, &params);
+
+	if (params.Parameters.DeviceIoControl.InputBufferLength <
+		sizeof(HID_XFER_PACKET))
+	{
+		return STATUS_BUFFER_TOO_SMALL;
+	}
+
+	featurePacket =
+		(PHID_XFER_PACKET)WdfRequestWdmGetIrp(FxRequest)->UserBuffer;
+
+	if ((NULL == featurePacket) || (featurePacket->reportBufferLen == 0))
+	{
+		return STATUS_INVALID_DEVICE_REQUEST;
+	}
+
+	if (*(PUCHAR)featurePacket->reportBuffer != TOUCH_LATENCY_REPORT_ID)
+	{
+		return STATUS_NOT_SUPPORTED;
+	}
+
+	TouchTrackerSetLatencyFeature(&devContext->Tracker, devContext->DpcLock);
+
+	return STATUS_SUCCESS;
+}
+
 PCHAR
 DbgHidInternalIoctlString(
 IN ULONG        IoControlCode
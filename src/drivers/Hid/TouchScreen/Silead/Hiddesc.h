@@ -41,7 +41,6 @@ typedef UCHAR HID_REPORT_DESCRIPTOR, *PHID_REPORT_DESCRIPTOR;
 #define PHYSICAL_YMSB (PHYSICAL_MAX_Y/256)
 #define MAX_TOUCHES REPORTID_MAX_COUNT 
 #define MAX_CONTACTS REPORTID_MAX_COUNT
-#define PS_DEEP 2
 #define FW_KEY_LENGTH 256
 
 typedef struct _MAX_COUNT_REPORT{ 
@@ -389,12 +388,6 @@ typedef struct _HIDFX2_INPUT_REPORT {
 	BYTE ContactCount;			//touches num
 }HIDFX2_INPUT_REPORT, *PHIDFX2_INPUT_REPORT;
 
-typedef struct _POINT_DATA{
-	UINT8 id;
-	UINT32 x;
-	UINT32 y;
-}POINT_DATA, *PPOINT_DATA;
-
 #ifdef SUPPORT_WINKEY
 typedef struct  _HIDFX2_INPUT_REPORT_EX {
 
@@ -0,0 +1,501 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	gslcfgconv.c
+
+Abstract:
+
+	Host converter from a default_tp_config header (gsl_config_data_id and
+	GSL_TS_CFG) to the binary container of GSLCfg.h. Every container is
+	decoded again with the driver's decoder and compared word for word
+	with what GSL_Load_CFG would have written from the header.
+
+	Build and use on any host with a C compiler:
+
+		cc -O2 -I.. -o gslcfgconv gslcfgconv.c ../GSLCfg.c
+		gslcfgconv GSL3675.h SileadTouch.gslcfg
+		gslcfgconv -v GSL3675.h SileadTouch.gslcfg
+
+Environment:
+
+	user mode
+
+--*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "GSLCfg.h"
+
+#define GSL_PAGE_REG	0xf0
+
+typedef struct _CFG_PAGE
+{
+	unsigned int Number;
+	unsigned int Count;
+	unsigned int Words[GSL_CFG_PAGE_WORDS];
+}CFG_PAGE;
+
+typedef struct _CFG_IMAGE
+{
+	unsigned int IdCount;
+	unsigned int Ids[GSL_CFG_MAX_ID_WORDS];
+	unsigned int PageCount;
+	CFG_PAGE Pages[GSL_CFG_MAX_PAGES];
+}CFG_IMAGE;
+
+typedef struct _CFG_BUFFER
+{
+	unsigned char *Data;
+	unsigned int Length;
+	unsigned int Capacity;
+}CFG_BUFFER;
+
+static char *
+ReadFile(const char *Path, long *Length)
+{
+	FILE *file = fopen(Path, "rb");
+	char *data;
+
+	if (file == NULL)
+	{
+		return NULL;
+	}
+
+	fseek(file, 0, SEEK_END);
+	*Length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	data = malloc(*Length + 1);
+	if (data != NULL && fread(data, 1, *Length, file) != (size_t)*Length)
+	{
+		free(data);
+		data = NULL;
+	}
+	if (data != NULL)
+	{
+		data[*Length] = 0;
+	}
+
+	fclose(file);
+	return data;
+}
+
+//
+// Skips whitespace and comments, returns the next character of interest.
+//
+static char *
+SkipBlank(char *p)
+{
+	for (;;)
+	{
+		while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+		{
+			p++;
+		}
+		if (p[0] == '/' && p[1] == '/')
+		{
+			while (*p != 0 && *p != '\n')
+			{
+				p++;
+			}
+		}
+		else if (p[0] == '/' && p[1] == '*')
+		{
+			p = strstr(p + 2, "*/");
+			p = (p == NULL) ? "" : p + 2;
+		}
+		else
+		{
+			return p;
+		}
+	}
+}
+
+static int
+ParseNumber(char **p, unsigned int *Value)
+{
+	char *end;
+
+	*p = SkipBlank(*p);
+	*Value = (unsigned int)strtoul(*p, &end, 0);
+	if (end == *p)
+	{
+		return 0;
+	}
+
+	*p = SkipBlank(end);
+	if (**p == ',')
+	{
+		*p = SkipBlank(*p + 1);
+	}
+	return 1;
+}
+
+//
+// Parses the header into the pages GSL_Load_CFG writes: words follow a
+// page select, a page ends after GSL_CFG_PAGE_WORDS words.
+//
+static int
+ParseHeader(char *Text, CFG_IMAGE *Image)
+{
+	char *p;
+	unsigned int offset;
+	unsigned int value;
+	unsigned int expected = 0;
+	unsigned int dropped = 0;
+	CFG_PAGE *page = NULL;
+
+	memset(Image, 0, sizeof(*Image));
+
+	p = strstr(Text, "gsl_config_data_id");
+	if (p != NULL)
+	{
+		p = strchr(p, '{');
+		if (p == NULL)
+		{
+			return 0;
+		}
+		p++;
+		while (ParseNumber(&p, &value))
+		{
+			if (Image->IdCount == GSL_CFG_MAX_ID_WORDS)
+			{
+				fprintf(stderr, "gsl_config_data_id has more than %d words\n", GSL_CFG_MAX_ID_WORDS);
+				return 0;
+			}
+			Image->Ids[Image->IdCount++] = value;
+		}
+	}
+
+	p = strstr(Text, "GSL_TS_CFG");
+	if (p == NULL || (p = strchr(p, '{')) == NULL)
+	{
+		fprintf(stderr, "GSL_TS_CFG not found\n");
+		return 0;
+	}
+	p = SkipBlank(p + 1);
+
+	while (*p == '{')
+	{
+		p++;
+		if (!ParseNumber(&p, &offset) || !ParseNumber(&p, &value) || *p != '}')
+		{
+			fprintf(stderr, "malformed GSL_TS_CFG entry\n");
+			return 0;
+		}
+		p = SkipBlank(p + 1);
+		if (*p == ',')
+		{
+			p = SkipBlank(p + 1);
+		}
+
+		if (offset == GSL_PAGE_REG)
+		{
+			if (Image->PageCount == GSL_CFG_MAX_PAGES)
+			{
+				fprintf(stderr, "more than %d pages\n", GSL_CFG_MAX_PAGES);
+				return 0;
+			}
+			page = &Image->Pages[Image->PageCount++];
+			page->Number = value & 0xff;
+			expected = 0;
+			continue;
+		}
+
+		if (page == NULL || page->Count == GSL_CFG_PAGE_WORDS)
+		{
+			dropped++;
+			continue;
+		}
+
+		if (offset != expected)
+		{
+			fprintf(stderr, "warning: page 0x%x offset 0x%x where 0x%x was expected, loaded in order\n",
+				page->Number, offset, expected);
+		}
+		expected = offset + 4;
+
+		page->Words[page->Count++] = value;
+	}
+
+	if (dropped != 0)
+	{
+		fprintf(stderr, "warning: %u words outside of a page dropped, as the driver does\n", dropped);
+	}
+
+	//
+	// A page select without words writes nothing
+	//
+	for (offset = 0, value = 0; offset < Image->PageCount; offset++)
+	{
+		if (Image->Pages[offset].Count != 0)
+		{
+			Image->Pages[value++] = Image->Pages[offset];
+		}
+	}
+	Image->PageCount = value;
+
+	return 1;
+}
+
+static void
+Put(CFG_BUFFER *Buffer, unsigned int Byte)
+{
+	if (Buffer->Length == Buffer->Capacity)
+	{
+		Buffer->Capacity = Buffer->Capacity ? Buffer->Capacity * 2 : 4096;
+		Buffer->Data = realloc(Buffer->Data, Buffer->Capacity);
+		if (Buffer->Data == NULL)
+		{
+			fprintf(stderr, "out of memory\n");
+			exit(1);
+		}
+	}
+	Buffer->Data[Buffer->Length++] = (unsigned char)Byte;
+}
+
+static int
+IsDelta(unsigned int From, unsigned int To)
+{
+	int delta = (int)(To - From);
+	return delta >= -128 && delta <= 127;
+}
+
+static void
+EncodeWords(CFG_BUFFER *Buffer, const unsigned int *Words, unsigned int Count)
+{
+	unsigned int previous = 0;
+	unsigned int i = 0;
+	unsigned int n;
+	unsigned int j;
+	unsigned int kind;
+
+	while (i < Count)
+	{
+		n = 0;
+		while (i + n < Count && Words[i + n] == previous && n < GSL_CFG_TOKEN_RUN_MAX)
+		{
+			n++;
+		}
+		if (n != 0)
+		{
+			Put(Buffer, GSL_CFG_TOKEN_RUN | (n - 1));
+			i += n;
+			continue;
+		}
+
+		//
+		// A group of deltas or literals, ended by a run of two or more
+		//
+		kind = IsDelta(previous, Words[i]) ? GSL_CFG_TOKEN_DELTA : GSL_CFG_TOKEN_LITERAL;
+		n = 1;
+		while (i + n < Count && n < GSL_CFG_TOKEN_COUNT_MAX &&
+			(IsDelta(Words[i + n - 1], Words[i + n]) ? GSL_CFG_TOKEN_DELTA : GSL_CFG_TOKEN_LITERAL) == kind &&
+			!(Words[i + n] == Words[i + n - 1] && i + n + 1 < Count && Words[i + n + 1] == Words[i + n]))
+		{
+			n++;
+		}
+
+		Put(Buffer, kind | (n - 1));
+		for (j = 0; j < n; j++)
+		{
+			if (kind == GSL_CFG_TOKEN_DELTA)
+			{
+				Put(Buffer, (Words[i + j] - previous) & 0xff);
+			}
+			else
+			{
+				Put(Buffer, Words[i + j] & 0xff);
+				Put(Buffer, (Words[i + j] >> 8) & 0xff);
+				Put(Buffer, (Words[i + j] >> 16) & 0xff);
+				Put(Buffer, (Words[i + j] >> 24) & 0xff);
+			}
+			previous = Words[i + j];
+		}
+		i += n;
+	}
+}
+
+static void
+Encode(const CFG_IMAGE *Image, CFG_BUFFER *Container)
+{
+	GSL_CFG_HEADER header;
+	CFG_BUFFER data = { 0 };
+	unsigned int i;
+
+	EncodeWords(&data, Image->Ids, Image->IdCount);
+
+	for (i = 0; i < Image->PageCount; i++)
+	{
+		Put(&data, Image->Pages[i].Number);
+		Put(&data, Image->Pages[i].Count);
+		EncodeWords(&data, Image->Pages[i].Words, Image->Pages[i].Count);
+	}
+
+	memset(&header, 0, sizeof(header));
+	header.Signature = GSL_CFG_SIGNATURE;
+	header.Version = GSL_CFG_VERSION;
+	header.HeaderSize = sizeof(header);
+	header.IdCount = Image->IdCount;
+	header.PageCount = Image->PageCount;
+	header.DataLength = data.Length;
+	header.Crc32 = GSLCfgCrc32(data.Data, data.Length);
+
+	for (i = 0; i < sizeof(header); i++)
+	{
+		Put(Container, ((unsigned char *)&header)[i]);
+	}
+	for (i = 0; i < data.Length; i++)
+	{
+		Put(Container, data.Data[i]);
+	}
+
+	free(data.Data);
+}
+
+static int
+Collect(void *Context, unsigned int Page, unsigned int Index, unsigned int Value)
+{
+	CFG_IMAGE *image = Context;
+	CFG_PAGE *page;
+
+	if (Page == GSL_CFG_ID_PAGE)
+	{
+		image->Ids[image->IdCount++] = Value;
+		return 0;
+	}
+
+	if (Index == 0)
+	{
+		page = &image->Pages[image->PageCount++];
+		page->Number = Page;
+		page->Count = 0;
+	}
+	page = &image->Pages[image->PageCount - 1];
+	page->Words[page->Count++] = Value;
+	return 0;
+}
+
+static int
+Verify(const CFG_IMAGE *Expected, const unsigned char *Container, unsigned int Length)
+{
+	static CFG_IMAGE decoded;
+	unsigned int i;
+	int result;
+
+	memset(&decoded, 0, sizeof(decoded));
+
+	result = GSLCfgDecode(Container, Length, Collect, &decoded);
+	if (result != 0)
+	{
+		fprintf(stderr, "decode failed %d\n", result);
+		return 0;
+	}
+
+	if (decoded.IdCount != Expected->IdCount ||
+		memcmp(decoded.Ids, Expected->Ids, Expected->IdCount * sizeof(unsigned int)) != 0)
+	{
+		fprintf(stderr, "gsl_config_data_id differs\n");
+		return 0;
+	}
+
+	if (decoded.PageCount != Expected->PageCount)
+	{
+		fprintf(stderr, "%u pages decoded, %u expected\n", decoded.PageCount, Expected->PageCount);
+		return 0;
+	}
+
+	for (i = 0; i < Expected->PageCount; i++)
+	{
+		if (decoded.Pages[i].Number != Expected->Pages[i].Number ||
+			decoded.Pages[i].Count != Expected->Pages[i].Count ||
+			memcmp(decoded.Pages[i].Words, Expected->Pages[i].Words, Expected->Pages[i].Count * sizeof(unsigned int)) != 0)
+		{
+			fprintf(stderr, "page %u (0x%x) differs\n", i, Expected->Pages[i].Number);
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+int
+main(int argc, char **argv)
+{
+	static CFG_IMAGE image;
+	CFG_BUFFER container = { 0 };
+	int isVerifyOnly = 0;
+	char *text;
+	char *data;
+	long length;
+	FILE *file;
+
+	if (argc == 4 && strcmp(argv[1], "-v") == 0)
+	{
+		isVerifyOnly = 1;
+		argv++;
+		argc--;
+	}
+
+	if (argc != 3)
+	{
+		fprintf(stderr, "usage: gslcfgconv [-v] config.h container.gslcfg\n");
+		return 2;
+	}
+
+	text = ReadFile(argv[1], &length);
+	if (text == NULL || !ParseHeader(text, &image))
+	{
+		fprintf(stderr, "cannot parse %s\n", argv[1]);
+		return 1;
+	}
+
+	if (!isVerifyOnly)
+	{
+		Encode(&image, &container);
+
+		file = fopen(argv[2], "wb");
+		if (file == NULL || fwrite(container.Data, 1, container.Length, file) != container.Length)
+		{
+			fprintf(stderr, "cannot write %s\n", argv[2]);
+			return 1;
+		}
+		fclose(file);
+	}
+
+	data = ReadFile(argv[2], &length);
+	if (data == NULL || !Verify(&image, (unsigned char *)data, (unsigned int)length))
+	{
+		fprintf(stderr, "%s does not match %s\n", argv[2], argv[1]);
+		return 1;
+	}
+
+	printf("%s: %u id words, %u pages, %ld bytes (header %ld bytes)\n",
+		argv[2], image.IdCount, image.PageCount, length, (long)strlen(text));
+
+	free(text);
+	free(data);
+	free(container.Data);
+	return 0;
+}
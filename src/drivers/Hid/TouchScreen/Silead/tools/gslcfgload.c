@@ -0,0 +1,843 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	gslcfgload.c
+
+Abstract:
+
+	Runs the configuration downloads of GSLDev_i2c.c on a fake GSL
+	controller behind a fake SPB client. The fake keeps the
+	configuration memory the driver writes, page by page through the
+	page register 0xf0, and counts every transfer and every byte on
+	the bus. The compiled in configuration (GSL_Load_CFG) is loaded
+	for:
+
+		first load  every page is written, in I2C_TRANSMIT_LEN bursts
+		reload      nothing changed, every page is read back, none
+		            written
+		mismatch    one page lost a byte, only that page is written
+		read error  the readback of a page fails, the page is written
+		write error a burst fails on both tries, the download goes on
+		            and returns the error, the next one writes every
+		            page again
+
+	and the container download (GSL_Load_CFG_Container) from a fake
+	service key and file system:
+
+		container   the file next to the ImagePath in the driver store
+		            is opened and loaded
+		relative    an ImagePath without a root is taken from
+		            \SystemRoot
+		corrupt     a CRC mismatch is rejected before the first page
+		oversized   a file over GSL_CFG_MAX_LENGTH is rejected before
+		            a buffer is allocated for it
+		missing     no file, the error lets the caller fall back
+
+	The download's own counters (GSL_CFG_LOADER) must match what the
+	fake saw: a page select and one transfer per burst for a page
+	written, a page select and the two legs of the readback, address
+	and data, for a page checked. Transfers repeated by the retry in
+	GSLDevWriteBuffer and GSLDevReadBuffer are only seen by the fake.
+	Every load prints its transfers, bytes and time on a 400kHz bus.
+
+	Build and use on any host with a C compiler:
+
+		cc -O2 -I../../../../../tools/host -I.. -o gslcfgload gslcfgload.c ../GSLDev_i2c.c ../GSLCfg.c
+		gslcfgload
+
+Environment:
+
+	user mode
+
+--*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Device.h"
+#include "GSLCfg.h"
+
+//
+// A second copy of the compiled in configuration, to know what the
+// controller has to hold.
+//
+#define GSL_TS_CFG				ExpectedCfg
+#define gsl_config_data_id		ExpectedId
+#include "GSL_TS_CFG.h"
+#undef GSL_TS_CFG
+#undef gsl_config_data_id
+
+#define FAKE_PAGES				256
+#define FAKE_BUS_HZ				400000
+#define NEVER					0xffffffff
+#define FAKE_PATH_LEN			260
+#define FAKE_SERVICE_KEY		L"\\Registry\\Machine\\System\\CurrentControlSet\\Services\\SileadTouch"
+
+typedef struct _FAKE_CHIP
+{
+	UCHAR Memory[FAKE_PAGES][GSL_PAGE_LEN];
+	BOOLEAN Touched[FAKE_PAGES];
+	ULONG Page;
+	ULONG Pointer;
+
+	//
+	// Transfers fail from FailFrom on, FailCount of them, counting
+	// writes or reads only when FailReads says so.
+	//
+	ULONG FailFrom;
+	ULONG FailCount;
+	BOOLEAN FailReads;
+
+	ULONG Transfers;
+	ULONG Writes;
+	ULONG Reads;
+	ULONG BusBytes;
+}FAKE_CHIP;
+
+//
+// The service key holds ImagePath, one file exists.
+//
+typedef struct _FAKE_SYSTEM
+{
+	const WCHAR *ImagePath;
+	const WCHAR *FilePath;
+	PUCHAR File;
+	ULONG FileLength;
+
+	WCHAR Opened[FAKE_PATH_LEN];
+	ULONG Allocations;
+	SIZE_T LargestAllocation;
+}FAKE_SYSTEM;
+
+static FAKE_CHIP g_Chip;
+static FAKE_SYSTEM g_System;
+static DEVICE_EXTENSION g_Extension;
+static LONGLONG g_Time;
+static int g_Failures;
+
+static UCHAR g_Expected[FAKE_PAGES][GSL_PAGE_LEN];
+static BOOLEAN g_ExpectedPage[FAKE_PAGES];
+static ULONG g_ExpectedWords[FAKE_PAGES];
+static ULONG g_Pages;
+static ULONG g_Bursts;
+static ULONG g_Bytes;
+
+static void
+Check(int Condition, const char *Case, const char *What)
+{
+	if (!Condition)
+	{
+		printf("FAIL %s: %s\n", Case, What);
+		g_Failures++;
+	}
+}
+
+//
+// ------------------------------------------------------------ Fake target
+//
+
+static BOOLEAN
+FakeFails(BOOLEAN IsRead)
+{
+	ULONG number = IsRead ? g_Chip.Reads : g_Chip.Writes;
+
+	if (g_Chip.FailReads != IsRead || g_Chip.FailCount == 0 || number < g_Chip.FailFrom)
+	{
+		return FALSE;
+	}
+
+	g_Chip.FailCount--;
+	return TRUE;
+}
+
+NTSTATUS
+SpbClientWriteRegister(
+	_In_ PSPB_CLIENT Client,
+	_In_ UCHAR Register,
+	_In_reads_opt_(Length) PVOID Data,
+	_In_ ULONG Length
+	)
+{
+	PUCHAR bytes = Data;
+	ULONG i;
+
+	UNREFERENCED_PARAMETER(Client);
+
+	g_Chip.Transfers++;
+	g_Chip.Writes++;
+	g_Chip.BusBytes += 2 + Length;
+	g_Time += ((2 + Length) * 9 * 10000000LL) / FAKE_BUS_HZ;
+
+	if (FakeFails(FALSE))
+	{
+		return STATUS_DEVICE_DATA_ERROR;
+	}
+
+	g_Chip.Pointer = Register;
+
+	if (GSL_PAGE_REG == Register)
+	{
+		if (Length != 0)
+		{
+			g_Chip.Page = bytes[0];
+		}
+		return STATUS_SUCCESS;
+	}
+
+	for (i = 0; i < Length && Register + i < GSL_PAGE_LEN; i++)
+	{
+		g_Chip.Memory[g_Chip.Page][Register + i] = bytes[i];
+		g_Chip.Touched[g_Chip.Page] = TRUE;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+NTSTATUS
+SpbClientRead(
+	_In_ PSPB_CLIENT Client,
+	_Out_writes_(Length) PVOID Buffer,
+	_In_ ULONG Length,
+	_Out_opt_ PULONG_PTR BytesRead
+	)
+{
+	PUCHAR bytes = Buffer;
+	ULONG i;
+
+	UNREFERENCED_PARAMETER(Client);
+
+	g_Chip.Transfers++;
+	g_Chip.Reads++;
+	g_Chip.BusBytes += 1 + Length;
+	g_Time += ((1 + Length) * 9 * 10000000LL) / FAKE_BUS_HZ;
+
+	if (FakeFails(TRUE))
+	{
+		return STATUS_DEVICE_DATA_ERROR;
+	}
+
+	for (i = 0; i < Length; i++)
+	{
+		bytes[i] = (g_Chip.Pointer + i < GSL_PAGE_LEN) ? g_Chip.Memory[g_Chip.Page][g_Chip.Pointer + i] : 0;
+	}
+
+	if (BytesRead != NULL)
+	{
+		*BytesRead = Length;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+//
+// ---------------------------------------------------- Kernel and framework
+//
+
+PVOID
+WdfObjectGetTypedContextWorker(
+	_In_ WDFOBJECT Handle
+	)
+{
+	UNREFERENCED_PARAMETER(Handle);
+
+	return &g_Extension;
+}
+
+VOID
+KeQuerySystemTime(
+	_Out_ PLARGE_INTEGER CurrentTime
+	)
+{
+	g_Time += 100;
+	CurrentTime->QuadPart = g_Time;
+}
+
+LARGE_INTEGER
+KeQueryPerformanceCounter(
+	_Out_opt_ PLARGE_INTEGER PerformanceFrequency
+	)
+{
+	LARGE_INTEGER counter;
+
+	if (PerformanceFrequency != NULL)
+	{
+		PerformanceFrequency->QuadPart = 10000000;
+	}
+
+	counter.QuadPart = g_Time;
+	return counter;
+}
+
+PVOID
+ExAllocatePoolWithTag(
+	_In_ POOL_TYPE PoolType,
+	_In_ SIZE_T NumberOfBytes,
+	_In_ ULONG Tag
+	)
+{
+	UNREFERENCED_PARAMETER(PoolType);
+	UNREFERENCED_PARAMETER(Tag);
+
+	g_System.Allocations++;
+	if (NumberOfBytes > g_System.LargestAllocation)
+	{
+		g_System.LargestAllocation = NumberOfBytes;
+	}
+	return malloc(NumberOfBytes);
+}
+
+VOID
+ExFreePoolWithTag(
+	_In_ PVOID P,
+	_In_ ULONG Tag
+	)
+{
+	UNREFERENCED_PARAMETER(Tag);
+
+	free(P);
+}
+
+VOID
+RtlInitUnicodeString(
+	_Out_ PUNICODE_STRING DestinationString,
+	_In_opt_ PCWSTR SourceString
+	)
+{
+	size_t length = (SourceString != NULL) ? wcslen(SourceString) * sizeof(WCHAR) : 0;
+
+	DestinationString->Buffer = (PWCH)SourceString;
+	DestinationString->Length = (USHORT)length;
+	DestinationString->MaximumLength = (USHORT)(length + sizeof(WCHAR));
+}
+
+NTSTATUS
+RtlUnicodeStringCat(
+	_Inout_ PUNICODE_STRING DestinationString,
+	_In_ PCUNICODE_STRING SourceString
+	)
+{
+	if (DestinationString->Length + SourceString->Length > DestinationString->MaximumLength)
+	{
+		return STATUS_BUFFER_OVERFLOW;
+	}
+
+	memcpy((PUCHAR)DestinationString->Buffer + DestinationString->Length,
+		SourceString->Buffer,
+		SourceString->Length);
+	DestinationString->Length += SourceString->Length;
+
+	return STATUS_SUCCESS;
+}
+
+NTSTATUS
+RtlUnicodeStringCatString(
+	_Inout_ PUNICODE_STRING DestinationString,
+	_In_ PCWSTR pszSrc
+	)
+{
+	UNICODE_STRING source;
+
+	RtlInitUnicodeString(&source, pszSrc);
+	return RtlUnicodeStringCat(DestinationString, &source);
+}
+
+
+static BOOLEAN
+FakeEqual(PCUNICODE_STRING String, const WCHAR *Text)
+{
+	return Text != NULL &&
+		String->Length == wcslen(Text) * sizeof(WCHAR) &&
+		memcmp(String->Buffer, Text, String->Length) == 0;
+}
+
+WDFDRIVER
+WdfDeviceGetDriver(
+	_In_ WDFDEVICE Device
+	)
+{
+	UNREFERENCED_PARAMETER(Device);
+
+	return NULL;
+}
+
+PWSTR
+WdfDriverGetRegistryPath(
+	_In_ WDFDRIVER Driver
+	)
+{
+	UNREFERENCED_PARAMETER(Driver);
+
+	return FAKE_SERVICE_KEY;
+}
+
+NTSTATUS
+WdfRegistryOpenKey(
+	_In_opt_ WDFKEY ParentKey,
+	_In_ PCUNICODE_STRING KeyName,
+	_In_ ACCESS_MASK DesiredAccess,
+	_In_opt_ PWDF_OBJECT_ATTRIBUTES KeyAttributes,
+	_Out_ WDFKEY *Key
+	)
+{
+	UNREFERENCED_PARAMETER(ParentKey);
+	UNREFERENCED_PARAMETER(DesiredAccess);
+	UNREFERENCED_PARAMETER(KeyAttributes);
+
+	*Key = NULL;
+	if (!FakeEqual(KeyName, FAKE_SERVICE_KEY))
+	{
+		return STATUS_OBJECT_NAME_NOT_FOUND;
+	}
+
+	*Key = (WDFKEY)&g_System;
+	return STATUS_SUCCESS;
+}
+
+NTSTATUS
+WdfRegistryQueryUnicodeString(
+	_In_ WDFKEY Key,
+	_In_ PCUNICODE_STRING ValueName,
+	_Out_opt_ PUSHORT ValueByteLength,
+	_Inout_opt_ PUNICODE_STRING Value
+	)
+{
+	UNICODE_STRING imagePath;
+
+	UNREFERENCED_PARAMETER(Key);
+	UNREFERENCED_PARAMETER(ValueByteLength);
+
+	if (!FakeEqual(ValueName, L"ImagePath") || g_System.ImagePath == NULL)
+	{
+		return STATUS_OBJECT_NAME_NOT_FOUND;
+	}
+
+	RtlInitUnicodeString(&imagePath, g_System.ImagePath);
+	Value->Length = 0;
+	return RtlUnicodeStringCat(Value, &imagePath);
+}
+
+VOID
+WdfRegistryClose(
+	_In_ WDFKEY Key
+	)
+{
+	UNREFERENCED_PARAMETER(Key);
+}
+
+NTSTATUS
+ZwOpenFile(
+	_Out_ PHANDLE FileHandle,
+	_In_ ACCESS_MASK DesiredAccess,
+	_In_ POBJECT_ATTRIBUTES ObjectAttributes,
+	_Out_ PIO_STATUS_BLOCK IoStatusBlock,
+	_In_ ULONG ShareAccess,
+	_In_ ULONG OpenOptions
+	)
+{
+	PUNICODE_STRING name = ObjectAttributes->ObjectName;
+
+	UNREFERENCED_PARAMETER(DesiredAccess);
+	UNREFERENCED_PARAMETER(ShareAccess);
+	UNREFERENCED_PARAMETER(OpenOptions);
+
+	if (name->Length < sizeof(g_System.Opened))
+	{
+		memcpy(g_System.Opened, name->Buffer, name->Length);
+		g_System.Opened[name->Length / sizeof(WCHAR)] = 0;
+	}
+
+	*FileHandle = NULL;
+	if (!FakeEqual(name, g_System.FilePath))
+	{
+		IoStatusBlock->Status = STATUS_OBJECT_NAME_NOT_FOUND;
+		return STATUS_OBJECT_NAME_NOT_FOUND;
+	}
+
+	*FileHandle = (HANDLE)&g_System;
+	IoStatusBlock->Status = STATUS_SUCCESS;
+	return STATUS_SUCCESS;
+}
+
+NTSTATUS
+ZwQueryInformationFile(
+	_In_ HANDLE FileHandle,
+	_Out_ PIO_STATUS_BLOCK IoStatusBlock,
+	_Out_ PVOID FileInformation,
+	_In_ ULONG Length,
+	_In_ FILE_INFORMATION_CLASS FileInformationClass
+	)
+{
+	FILE_STANDARD_INFORMATION *information = FileInformation;
+
+	UNREFERENCED_PARAMETER(FileHandle);
+
+	if (FileInformationClass != FileStandardInformation || Length < sizeof(*information))
+	{
+		return STATUS_INVALID_PARAMETER;
+	}
+
+	memset(information, 0, sizeof(*information));
+	information->EndOfFile.QuadPart = g_System.FileLength;
+	information->AllocationSize.QuadPart = g_System.FileLength;
+	IoStatusBlock->Status = STATUS_SUCCESS;
+	IoStatusBlock->Information = sizeof(*information);
+
+	return STATUS_SUCCESS;
+}
+
+NTSTATUS
+ZwReadFile(
+	_In_ HANDLE FileHandle,
+	_In_opt_ HANDLE Event,
+	_In_opt_ PVOID ApcRoutine,
+	_In_opt_ PVOID ApcContext,
+	_Out_ PIO_STATUS_BLOCK IoStatusBlock,
+	_Out_ PVOID Buffer,
+	_In_ ULONG Length,
+	_In_opt_ PLARGE_INTEGER ByteOffset,
+	_In_opt_ PULONG Key
+	)
+{
+	UNREFERENCED_PARAMETER(FileHandle);
+	UNREFERENCED_PARAMETER(Event);
+	UNREFERENCED_PARAMETER(ApcRoutine);
+	UNREFERENCED_PARAMETER(ApcContext);
+	UNREFERENCED_PARAMETER(ByteOffset);
+	UNREFERENCED_PARAMETER(Key);
+
+	Length = min(Length, g_System.FileLength);
+	memcpy(Buffer, g_System.File, Length);
+	IoStatusBlock->Status = STATUS_SUCCESS;
+	IoStatusBlock->Information = Length;
+
+	return STATUS_SUCCESS;
+}
+
+NTSTATUS
+ZwClose(
+	_In_ HANDLE Handle
+	)
+{
+	UNREFERENCED_PARAMETER(Handle);
+
+	return STATUS_SUCCESS;
+}
+
+void
+gsl_DataInit(unsigned int *conf_in)
+{
+	UNREFERENCED_PARAMETER(conf_in);
+}
+
+//
+// ------------------------------------------------------------------ Cases
+//
+
+//
+// What the controller holds once the configuration is loaded, and the
+// transfers and bytes a full download takes.
+//
+static void
+ExpectedImage(void)
+{
+	ULONG page = NEVER;
+	ULONG length = 0;
+	ULONG i;
+
+	for (i = 0; i < ARRAYSIZE(ExpectedCfg); i++)
+	{
+		if (GSL_PAGE_REG == ExpectedCfg[i].offset)
+		{
+			page = ExpectedCfg[i].val & 0xff;
+			length = 0;
+			if (!g_ExpectedPage[page])
+			{
+				g_ExpectedPage[page] = TRUE;
+				g_Pages++;
+			}
+			continue;
+		}
+
+		if (NEVER == page || length >= GSL_PAGE_LEN)
+		{
+			continue;
+		}
+
+		memcpy(&g_Expected[page][length], &ExpectedCfg[i].val, 4);
+		if (length % I2C_TRANSMIT_LEN == 0)
+		{
+			g_Bursts++;
+		}
+		length += 4;
+		g_Bytes += 4;
+		g_ExpectedWords[page] = max(g_ExpectedWords[page], length / 4);
+	}
+}
+
+//
+// Words as one literal token per GSL_CFG_TOKEN_COUNT_MAX of them.
+//
+static ULONG
+PutWords(PUCHAR Out, const UCHAR *Words, ULONG Count)
+{
+	ULONG length = 0;
+	ULONG n;
+
+	while (Count > 0)
+	{
+		n = min(Count, GSL_CFG_TOKEN_COUNT_MAX);
+		Out[length++] = (UCHAR)(GSL_CFG_TOKEN_LITERAL | (n - 1));
+		memcpy(&Out[length], Words, n * 4);
+		length += n * 4;
+		Words += n * 4;
+		Count -= n;
+	}
+
+	return length;
+}
+
+//
+// The expected image as a container, every word a literal.
+//
+static ULONG
+BuildContainer(PUCHAR Container)
+{
+	PGSL_CFG_HEADER header = (PGSL_CFG_HEADER)Container;
+	PUCHAR data = Container + sizeof(GSL_CFG_HEADER);
+	ULONG length = 0;
+	ULONG page;
+
+	length += PutWords(&data[length], (const UCHAR *)ExpectedId, ARRAYSIZE(ExpectedId));
+
+	for (page = 0; page < FAKE_PAGES; page++)
+	{
+		if (g_ExpectedPage[page])
+		{
+			data[length++] = (UCHAR)page;
+			data[length++] = (UCHAR)g_ExpectedWords[page];
+			length += PutWords(&data[length], g_Expected[page], g_ExpectedWords[page]);
+		}
+	}
+
+	header->Signature = GSL_CFG_SIGNATURE;
+	header->Version = GSL_CFG_VERSION;
+	header->HeaderSize = sizeof(GSL_CFG_HEADER);
+	header->IdCount = ARRAYSIZE(ExpectedId);
+	header->PageCount = g_Pages;
+	header->DataLength = length;
+	header->Crc32 = GSLCfgCrc32(data, length);
+
+	return sizeof(GSL_CFG_HEADER) + length;
+}
+
+static BOOLEAN
+ChipHoldsImage(void)
+{
+	ULONG page;
+
+	for (page = 0; page < FAKE_PAGES; page++)
+	{
+		if (g_ExpectedPage[page] && memcmp(g_Chip.Memory[page], g_Expected[page], GSL_PAGE_LEN) != 0)
+		{
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static ULONG
+FirstPage(void)
+{
+	ULONG page;
+
+	for (page = 0; !g_ExpectedPage[page]; page++)
+	{
+	}
+
+	return page;
+}
+
+static NTSTATUS
+Load(const char *Name, BOOLEAN IsContainer)
+{
+	PGSL_CFG_LOADER loader = &g_Extension.CfgLoader;
+	NTSTATUS status;
+
+	g_Chip.Transfers = 0;
+	g_Chip.Writes = 0;
+	g_Chip.Reads = 0;
+	g_Chip.BusBytes = 0;
+
+	status = IsContainer ? GSL_Load_CFG_Container((WDFDEVICE)&g_Extension) : GSL_Load_CFG((WDFDEVICE)&g_Extension);
+
+	printf("%-12s %3lu written %3lu skipped %5lu transfers %7lu bytes %7.1f ms\n",
+		Name,
+		(unsigned long)loader->PagesWritten,
+		(unsigned long)loader->PagesSkipped,
+		(unsigned long)g_Chip.Transfers,
+		(unsigned long)g_Chip.BusBytes,
+		(g_Chip.BusBytes * 9 * 1000.0) / FAKE_BUS_HZ);
+
+	return status;
+}
+
+static void
+TestLoads(void)
+{
+	PGSL_CFG_LOADER loader = &g_Extension.CfgLoader;
+	NTSTATUS status;
+	ULONG page;
+
+	status = Load("first load", FALSE);
+	Check(NT_SUCCESS(status), "first load", "succeeded");
+	Check(ChipHoldsImage(), "first load", "controller holds the configuration");
+	Check(loader->IsLoaded, "first load", "marked loaded");
+	Check(loader->PagesWritten == g_Pages && loader->PagesSkipped == 0, "first load", "every page written");
+	Check(loader->Transfers == g_Pages + g_Bursts, "first load", "a select and the bursts per page");
+	Check(loader->Transfers == g_Chip.Transfers, "first load", "transfers counted as on the bus");
+	Check(loader->Bytes == g_Bytes, "first load", "configuration bytes counted");
+
+	status = Load("reload", FALSE);
+	Check(NT_SUCCESS(status), "reload", "succeeded");
+	Check(loader->PagesWritten == 0 && loader->PagesSkipped == g_Pages, "reload", "every page skipped");
+	Check(g_Chip.Writes == 2 * g_Pages && g_Chip.Reads == g_Pages, "reload", "a select and a readback per page");
+	Check(loader->Transfers == 3 * g_Pages, "reload", "both readback legs counted");
+	Check(loader->Transfers == g_Chip.Transfers, "reload", "transfers counted as on the bus");
+	Check(loader->Bytes == 0, "reload", "nothing written");
+
+	page = FirstPage();
+	g_Chip.Memory[page][5] ^= 0x5a;
+
+	status = Load("mismatch", FALSE);
+	Check(NT_SUCCESS(status), "mismatch", "succeeded");
+	Check(ChipHoldsImage(), "mismatch", "page restored");
+	Check(loader->PagesWritten == 1 && loader->PagesSkipped == g_Pages - 1, "mismatch", "only that page written");
+	Check(loader->Transfers == g_Chip.Transfers, "mismatch", "transfers counted as on the bus");
+	Check(loader->Transfers == 3 * g_Pages + (GSL_PAGE_LEN + I2C_TRANSMIT_LEN - 1) / I2C_TRANSMIT_LEN,
+		"mismatch", "readback and bursts of the page counted");
+
+	//
+	// Both tries of the first readback fail.
+	//
+	g_Chip.FailReads = TRUE;
+	g_Chip.FailFrom = 1;
+	g_Chip.FailCount = 2;
+
+	status = Load("read error", FALSE);
+	Check(NT_SUCCESS(status), "read error", "succeeded");
+	Check(ChipHoldsImage(), "read error", "controller holds the configuration");
+	Check(loader->PagesWritten == 1 && loader->PagesSkipped == g_Pages - 1, "read error", "unread page written");
+	Check(loader->Transfers == g_Chip.Transfers - 2, "read error", "all but the retried readback counted");
+
+	//
+	// Both tries of the third page's first burst fail, on a controller
+	// that lost its memory.
+	//
+	memset(g_Chip.Memory, 0, sizeof(g_Chip.Memory));
+	loader->IsLoaded = FALSE;
+	g_Chip.FailReads = FALSE;
+	g_Chip.FailFrom = 6;
+	g_Chip.FailCount = 2;
+
+	status = Load("write error", FALSE);
+	Check(status == STATUS_DEVICE_DATA_ERROR, "write error", "the error is returned");
+	Check(!loader->IsLoaded, "write error", "not marked loaded");
+	Check(loader->PagesWritten == g_Pages - 1, "write error", "every other page written");
+
+	status = Load("after error", FALSE);
+	Check(NT_SUCCESS(status), "write error", "next download succeeded");
+	Check(ChipHoldsImage(), "write error", "controller holds the configuration");
+	Check(loader->PagesWritten == g_Pages && loader->PagesSkipped == 0, "write error", "every page written again");
+}
+
+static void
+TestContainer(void)
+{
+	static UCHAR container[GSL_CFG_MAX_LENGTH + 1];
+	PGSL_CFG_LOADER loader = &g_Extension.CfgLoader;
+	NTSTATUS status;
+
+	memset(g_Chip.Memory, 0, sizeof(g_Chip.Memory));
+	loader->IsLoaded = FALSE;
+
+	g_System.ImagePath = L"\\SystemRoot\\System32\\DriverStore\\FileRepository\\silead.inf_arm_5a3c\\Silead.sys";
+	g_System.FilePath = L"\\SystemRoot\\System32\\DriverStore\\FileRepository\\silead.inf_arm_5a3c\\SileadTouch.gslcfg";
+	g_System.File = container;
+	g_System.FileLength = BuildContainer(container);
+
+	status = Load("container", TRUE);
+	Check(NT_SUCCESS(status), "container", "succeeded");
+	Check(wcscmp(g_System.Opened, g_System.FilePath) == 0, "container", "opened next to the image in the driver store");
+	Check(ChipHoldsImage(), "container", "controller holds the configuration");
+	Check(loader->PagesWritten == g_Pages, "container", "every page written");
+
+	g_System.ImagePath = L"System32\\DriverStore\\FileRepository\\silead.inf_arm_5a3c\\Silead.sys";
+
+	status = Load("relative", TRUE);
+	Check(NT_SUCCESS(status), "relative", "succeeded");
+	Check(wcscmp(g_System.Opened, g_System.FilePath) == 0, "relative", "image path taken from the system root");
+
+	container[sizeof(GSL_CFG_HEADER) + 100] ^= 0x01;
+
+	status = Load("corrupt", TRUE);
+	Check(status == STATUS_INVALID_IMAGE_FORMAT, "corrupt", "rejected");
+	Check(g_Chip.Transfers == 0, "corrupt", "nothing written");
+
+	container[sizeof(GSL_CFG_HEADER) + 100] ^= 0x01;
+	g_System.FileLength = GSL_CFG_MAX_LENGTH + 1;
+	g_System.Allocations = 0;
+	g_System.LargestAllocation = 0;
+
+	status = Load("oversized", TRUE);
+	Check(status == STATUS_INVALID_IMAGE_FORMAT, "oversized", "rejected");
+	Check(g_System.LargestAllocation <= GSL_CFG_MAX_LENGTH, "oversized", "rejected before the allocation");
+	Check(g_Chip.Transfers == 0, "oversized", "nothing written");
+
+	g_System.FilePath = NULL;
+
+	status = Load("missing", TRUE);
+	Check(!NT_SUCCESS(status), "missing", "fails, so the next source is tried");
+	Check(g_Chip.Transfers == 0, "missing", "nothing written");
+}
+
+int
+main(void)
+{
+	ExpectedImage();
+	printf("%lu pages, %lu bursts of up to %d bytes\n",
+		(unsigned long)g_Pages,
+		(unsigned long)g_Bursts,
+		I2C_TRANSMIT_LEN);
+
+	TestLoads();
+	TestContainer();
+
+	if (g_Failures != 0)
+	{
+		printf("%d check(s) failed\n", g_Failures);
+		return 1;
+	}
+
+	printf("all checks passed\n");
+	return 0;
+}
@@ -0,0 +1,554 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	gslesdsim.c
+
+Abstract:
+
+	Host simulation of the ESD watchdog. The driver's policy (GSLEsd.c)
+	and the fixed 3 s check it replaced run against the same synthetic
+	touch traces and injected faults, in 1 ms steps:
+
+		idle        no touches at all
+		continuous  2 s strokes with 200 ms lifts, the whole time
+		bursts      sessions of 5 s to 60 s, idle 30 s to 10 min between
+
+	The simulated controller scans every 10 ms and raises a frame every
+	scan while touched. A frozen controller stops its scan counter, a
+	corrupted one keeps scanning but has lost 0xb0/0xbc; neither reports
+	frames until it is reinitialized. Every register read fails with the
+	given bus error rate, a failed read leaves the buffer as it was, like
+	GSLDevReadBuffer does.
+
+	Reported per run are 4 byte register reads, watchdog wakeups,
+	reinitializations, those of a healthy controller and the detection
+	latency from the fault to its reinitialization.
+
+		cc -O2 -I.. -o gslesdsim gslesdsim.c ../GSLEsd.c
+		gslesdsim
+		gslesdsim -h 8 -f 20 -e 2
+
+	-h simulated hours (4), -f mean minutes between faults (15, 0 for
+	none), -e bus error rate in percent for the second set of runs (1).
+
+Environment:
+
+	user mode
+
+--*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "GSLEsd.h"
+
+#define SCAN_MS			10
+#define LEGACY_PERIOD_MS	3000
+#define REINIT_MS		150
+
+typedef enum _CHIP_STATE
+{
+	ChipHealthy = 0,
+	ChipFrozen,
+	ChipCorrupted
+}CHIP_STATE;
+
+typedef struct _TRACE
+{
+	const char *Name;
+	unsigned int Count;
+	unsigned int *Start;
+	unsigned int *End;
+}TRACE;
+
+typedef struct _SIM
+{
+	const TRACE *Trace;
+	unsigned int Duration;
+	unsigned int ErrorRate;			// per 10000 reads
+	unsigned int Seed;
+
+	CHIP_STATE State;
+	unsigned int Counter;
+	unsigned int FaultTime;
+	unsigned int NextFault;
+	unsigned int FaultMeanMs;
+
+	unsigned int Reads;
+	unsigned int Wakeups;
+	unsigned int Faults;
+	unsigned int Detected;
+	unsigned int Reinits;
+	unsigned int FalseReinits;
+	unsigned long long LatencyTotal;
+	unsigned int LatencyMax;
+}SIM;
+
+static unsigned int
+Random(unsigned int *Seed)
+{
+	*Seed = *Seed * 1103515245 + 12345;
+	return (*Seed >> 8) & 0xffffff;
+}
+
+static unsigned int
+RandomRange(unsigned int *Seed, unsigned int Low, unsigned int High)
+{
+	return Low + Random(Seed) % (High - Low + 1);
+}
+
+static void
+TraceAdd(TRACE *Trace, unsigned int Start, unsigned int End)
+{
+	Trace->Start = realloc(Trace->Start, (Trace->Count + 1) * sizeof(unsigned int));
+	Trace->End = realloc(Trace->End, (Trace->Count + 1) * sizeof(unsigned int));
+	if (Trace->Start == NULL || Trace->End == NULL)
+	{
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+	Trace->Start[Trace->Count] = Start;
+	Trace->End[Trace->Count] = End;
+	Trace->Count++;
+}
+
+//
+// Strokes of 0.5 s to 2 s with 200 ms lifts from Start to End.
+//
+static void
+TraceStrokes(TRACE *Trace, unsigned int *Seed, unsigned int Start, unsigned int End)
+{
+	unsigned int t = Start;
+
+	while (t < End)
+	{
+		unsigned int stroke = RandomRange(Seed, 500, 2000);
+
+		if (t + stroke > End)
+		{
+			stroke = End - t;
+		}
+		TraceAdd(Trace, t, t + stroke);
+		t += stroke + 200;
+	}
+}
+
+static void
+TraceBuild(TRACE *Trace, const char *Name, unsigned int Duration)
+{
+	unsigned int seed = 7;
+	unsigned int t;
+
+	memset(Trace, 0, sizeof(*Trace));
+	Trace->Name = Name;
+
+	if (strcmp(Name, "continuous") == 0)
+	{
+		TraceStrokes(Trace, &seed, 0, Duration);
+	}
+	else if (strcmp(Name, "bursts") == 0)
+	{
+		t = RandomRange(&seed, 30000, 600000);
+		while (t < Duration)
+		{
+			unsigned int session = RandomRange(&seed, 5000, 60000);
+
+			if (t + session > Duration)
+			{
+				session = Duration - t;
+			}
+			TraceStrokes(Trace, &seed, t, t + session);
+			t += session + RandomRange(&seed, 30000, 600000);
+		}
+	}
+}
+
+//
+// Nonzero if a stroke covers Time. Strokes are sorted and Time only
+// moves forward, so Cursor does too.
+//
+static int
+Touched(const TRACE *Trace, unsigned int *Cursor, unsigned int Time)
+{
+	while (*Cursor < Trace->Count && Trace->End[*Cursor] <= Time)
+	{
+		(*Cursor)++;
+	}
+
+	return *Cursor < Trace->Count && Trace->Start[*Cursor] <= Time;
+}
+
+static void
+SimStart(SIM *Sim, const TRACE *Trace, unsigned int Duration,
+	unsigned int FaultMeanMs, unsigned int ErrorRate)
+{
+	memset(Sim, 0, sizeof(*Sim));
+	Sim->Trace = Trace;
+	Sim->Duration = Duration;
+	Sim->FaultMeanMs = FaultMeanMs;
+	Sim->ErrorRate = ErrorRate;
+	Sim->Seed = 12345;
+	Sim->Counter = 0x1000;
+	Sim->NextFault = FaultMeanMs ? RandomRange(&Sim->Seed, FaultMeanMs / 2, FaultMeanMs * 3 / 2) : ~0u;
+}
+
+//
+// A 4 byte register read of the simulated controller.
+//
+static int
+SimRead(SIM *Sim, unsigned int Register, unsigned int *Value)
+{
+	Sim->Reads++;
+
+	if (Random(&Sim->Seed) % 10000 < Sim->ErrorRate)
+	{
+		return 0;
+	}
+
+	switch (Register)
+	{
+	case 0xb0:
+		*Value = (Sim->State == ChipCorrupted) ? 0x12345678 : GSL_ESD_STATUS_B0;
+		break;
+	case 0xb4:
+		*Value = Sim->Counter;
+		break;
+	case 0xbc:
+		*Value = (Sim->State == ChipCorrupted) ? 0x00010000 : GSL_ESD_STATUS_BC;
+		break;
+	}
+
+	return 1;
+}
+
+static void
+SimReinit(SIM *Sim, unsigned int Time)
+{
+	Sim->Reinits++;
+
+	if (Sim->State == ChipHealthy)
+	{
+		Sim->FalseReinits++;
+	}
+	else
+	{
+		unsigned int latency = Time - Sim->FaultTime;
+
+		Sim->Detected++;
+		Sim->LatencyTotal += latency;
+		if (latency > Sim->LatencyMax)
+		{
+			Sim->LatencyMax = latency;
+		}
+	}
+
+	Sim->State = ChipHealthy;
+	Sim->Counter = 0;
+}
+
+//
+// The scan counter advances Ms later, as it would while the watchdog
+// sleeps between two reads.
+//
+static void
+SimSleep(SIM *Sim, unsigned int Ms)
+{
+	if (Sim->State != ChipFrozen)
+	{
+		Sim->Counter += Ms / SCAN_MS;
+	}
+}
+
+//
+// GSLDevESDDetail before the adaptive watchdog. A failed read keeps the
+// previous buffer, so read_buf carries over between the reads.
+//
+typedef struct _LEGACY
+{
+	unsigned int Buffer;
+	unsigned int First;
+	unsigned int Second;
+	unsigned int B0Count;
+	unsigned int BcCount;
+}LEGACY;
+
+static void
+LegacyCheck(SIM *Sim, LEGACY *Legacy, unsigned int Time)
+{
+	SimRead(Sim, 0xb0, &Legacy->Buffer);
+	if (Legacy->Buffer != GSL_ESD_STATUS_B0)
+	{
+		Legacy->B0Count++;
+	}
+	else
+	{
+		Legacy->B0Count = 0;
+	}
+	if (Legacy->B0Count > 1)
+	{
+		Legacy->B0Count = 0;
+		SimReinit(Sim, Time);
+		return;
+	}
+
+	SimRead(Sim, 0xb4, &Legacy->Buffer);
+	Legacy->Second = Legacy->First;
+	Legacy->First = Legacy->Buffer;
+	if (Legacy->First == Legacy->Second)
+	{
+		SimReinit(Sim, Time);
+		return;
+	}
+
+	SimRead(Sim, 0xbc, &Legacy->Buffer);
+	if (Legacy->Buffer != GSL_ESD_STATUS_BC)
+	{
+		Legacy->BcCount++;
+	}
+	else
+	{
+		Legacy->BcCount = 0;
+	}
+	if (Legacy->BcCount > 1)
+	{
+		Legacy->BcCount = 0;
+		SimReinit(Sim, Time);
+	}
+}
+
+//
+// GSLDevESDDetail with the adaptive policy. Returns the time the check
+// finished, the timer is armed from there.
+//
+static unsigned int
+AdaptiveCheck(SIM *Sim, PGSL_ESD Esd, unsigned int Time)
+{
+	GSL_ESD_ACTION action = GSLEsdStart(Esd, Time);
+	unsigned int value = 0;
+	unsigned int b0 = 0;
+	unsigned int bc = 0;
+	int ok;
+
+	while (action != GslEsdActionDone)
+	{
+		if (Esd->DelayMs != 0)
+		{
+			SimSleep(Sim, Esd->DelayMs);
+			Time += Esd->DelayMs;
+		}
+
+		switch (action)
+		{
+		case GslEsdActionReadCounter:
+			ok = SimRead(Sim, 0xb4, &value);
+			action = GSLEsdCounterRead(Esd, ok, value);
+			break;
+
+		case GslEsdActionReadStatus:
+			ok = SimRead(Sim, 0xb0, &b0);
+			if (ok)
+			{
+				ok = SimRead(Sim, 0xbc, &bc);
+			}
+			action = GSLEsdStatusRead(Esd, ok, b0, bc);
+			break;
+
+		case GslEsdActionReinit:
+			SimReinit(Sim, Time);
+			Time += REINIT_MS;
+			action = GSLEsdReinitDone(Esd);
+			break;
+
+		default:
+			action = GslEsdActionDone;
+			break;
+		}
+	}
+
+	return Time;
+}
+
+static void
+Run(SIM *Sim, int Adaptive, GSL_ESD *Esd)
+{
+	const TRACE *trace = Sim->Trace;
+	unsigned int cursor = 0;
+	unsigned int nextCheck = Adaptive ? GSL_ESD_BASE_PERIOD_MS : LEGACY_PERIOD_MS;
+	LEGACY legacy;
+	unsigned int t;
+
+	memset(&legacy, 0, sizeof(legacy));
+	GSLEsdInitialize(Esd);
+
+	for (t = 0; t < Sim->Duration; t++)
+	{
+		int touching = Touched(trace, &cursor, t);
+
+		if (t == Sim->NextFault)
+		{
+			if (Sim->State == ChipHealthy)
+			{
+				Sim->State = (Sim->Faults & 1) ? ChipCorrupted : ChipFrozen;
+				Sim->FaultTime = t;
+				Sim->Faults++;
+			}
+			Sim->NextFault = t + RandomRange(&Sim->Seed, Sim->FaultMeanMs / 2, Sim->FaultMeanMs * 3 / 2);
+		}
+
+		if ((t % SCAN_MS) == 0 && Sim->State != ChipFrozen)
+		{
+			Sim->Counter++;
+			if (touching && Sim->State == ChipHealthy)
+			{
+				GSLEsdActivity(Esd, t);
+			}
+		}
+
+		if (t < nextCheck)
+		{
+			continue;
+		}
+
+		Sim->Wakeups++;
+
+		//
+		// The check is skipped while the interrupt thread holds the bus.
+		//
+		if (touching && Sim->State == ChipHealthy && (t % SCAN_MS) == 0)
+		{
+			nextCheck = t + (Adaptive ? Esd->PeriodMs : LEGACY_PERIOD_MS);
+			continue;
+		}
+
+		if (Adaptive)
+		{
+			unsigned int end = AdaptiveCheck(Sim, Esd, t);
+
+			nextCheck = end + Esd->PeriodMs;
+		}
+		else
+		{
+			LegacyCheck(Sim, &legacy, t);
+			nextCheck = t + LEGACY_PERIOD_MS;
+		}
+	}
+}
+
+static void
+Report(const SIM *Sim, const char *Policy, unsigned int ErrorRate)
+{
+	printf("%-10s %4u.%02u%% %-8s %8u %7u %7u %5u %4u/%-4u %8.0f %8u\n",
+		Sim->Trace->Name,
+		ErrorRate / 100, ErrorRate % 100,
+		Policy,
+		Sim->Reads,
+		Sim->Wakeups,
+		Sim->Reinits,
+		Sim->FalseReinits,
+		Sim->Detected,
+		Sim->Faults,
+		Sim->Detected ? (double)Sim->LatencyTotal / Sim->Detected : 0,
+		Sim->LatencyMax);
+}
+
+int
+main(int argc, char **argv)
+{
+	static const char *traceNames[] = { "idle", "continuous", "bursts" };
+	unsigned int hours = 4;
+	unsigned int faultMinutes = 15;
+	unsigned int errorPercent = 1;
+	unsigned int errorRates[2];
+	unsigned int duration;
+	unsigned int i;
+	unsigned int e;
+	int arg;
+
+	for (arg = 1; arg < argc; arg++)
+	{
+		if (arg + 1 < argc && strcmp(argv[arg], "-h") == 0)
+		{
+			hours = (unsigned int)atoi(argv[++arg]);
+		}
+		else if (arg + 1 < argc && strcmp(argv[arg], "-f") == 0)
+		{
+			faultMinutes = (unsigned int)atoi(argv[++arg]);
+		}
+		else if (arg + 1 < argc && strcmp(argv[arg], "-e") == 0)
+		{
+			errorPercent = (unsigned int)atoi(argv[++arg]);
+		}
+		else
+		{
+			fprintf(stderr, "usage: gslesdsim [-h hours] [-f fault minutes] [-e bus error percent]\n");
+			return 1;
+		}
+	}
+
+	if (hours == 0 || hours > 1000 || errorPercent > 100)
+	{
+		fprintf(stderr, "hours must be 1 to 1000 and the error rate at most 100%%\n");
+		return 1;
+	}
+
+	duration = hours * 3600000;
+	errorRates[0] = 0;
+	errorRates[1] = errorPercent * 100;
+
+	printf("%u h, a fault every %u min on average, latency in ms\n\n", hours, faultMinutes);
+	printf("%-10s %8s %-8s %8s %7s %7s %5s %9s %8s %8s\n",
+		"trace", "bus err", "policy", "reads", "wakeups", "reinits", "false",
+		"detected", "mean", "max");
+
+	for (i = 0; i < sizeof(traceNames) / sizeof(traceNames[0]); i++)
+	{
+		TRACE trace;
+
+		TraceBuild(&trace, traceNames[i], duration);
+
+		for (e = 0; e < 2; e++)
+		{
+			GSL_ESD esd;
+			SIM sim;
+
+			SimStart(&sim, &trace, duration, faultMinutes * 60000, errorRates[e]);
+			Run(&sim, 0, &esd);
+			Report(&sim, "fixed", errorRates[e]);
+
+			SimStart(&sim, &trace, duration, faultMinutes * 60000, errorRates[e]);
+			Run(&sim, 1, &esd);
+			Report(&sim, "adaptive", errorRates[e]);
+
+			printf("%-10s %8s %-8s skipped %u, counter reads %u, status reads %u, false alarms %u, reinits %u/%u/%u\n",
+				"", "", "", esd.Skipped, esd.CounterReads, esd.StatusReads, esd.FalseAlarms,
+				esd.ReinitReasons[GslEsdReasonCounter],
+				esd.ReinitReasons[GslEsdReasonStatus],
+				esd.ReinitReasons[GslEsdReasonBus]);
+		}
+
+		free(trace.Start);
+		free(trace.End);
+	}
+
+	return 0;
+}
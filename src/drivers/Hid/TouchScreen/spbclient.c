@@ -0,0 +1,644 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+#include <ntddk.h>
+#include <wdf.h>
+
+#include "spbclient.h"
+
+EVT_WDF_REQUEST_COMPLETION_ROUTINE SpbClientEvtRequestCompletion;
+
+static
+NTSTATUS
+SpbClientAcquire(
+	_In_ PSPB_CLIENT Client,
+	_In_ BOOLEAN Wait
+	)
+/*++
+
+Routine Description:
+
+	Takes ownership of the client's request. Callers at PASSIVE_LEVEL
+	wait for an outstanding transfer to finish, callers at higher IRQL
+	fail with STATUS_DEVICE_BUSY instead.
+
+Arguments:
+
+	Client - pointer to the SPB client
+
+	Wait - TRUE to wait for the request to become idle
+
+Return Value:
+
+	NT status value
+
+--*/
+{
+	LARGE_INTEGER Timeout;
+	NTSTATUS Status;
+
+	if (Client->IsInit == FALSE) {
+		return STATUS_DEVICE_NOT_READY;
+	}
+
+	if ((Wait != FALSE) && (KeGetCurrentIrql() == PASSIVE_LEVEL)) {
+		KeWaitForSingleObject(&Client->Idle, Executive, KernelMode, FALSE, NULL);
+		return STATUS_SUCCESS;
+	}
+
+	Timeout.QuadPart = 0;
+	Status = KeWaitForSingleObject(&Client->Idle, Executive, KernelMode, FALSE, &Timeout);
+
+	return (Status == STATUS_SUCCESS) ? STATUS_SUCCESS : STATUS_DEVICE_BUSY;
+}
+
+static
+VOID
+SpbClientRelease(
+	_In_ PSPB_CLIENT Client
+	)
+{
+	KeSetEvent(&Client->Idle, IO_NO_INCREMENT, FALSE);
+}
+
+static
+NTSTATUS
+SpbClientFormat(
+	_In_ PSPB_CLIENT Client,
+	_In_reads_(TransferCount) PSPB_CLIENT_TRANSFER Transfers,
+	_In_ ULONG TransferCount
+	)
+/*++
+
+Routine Description:
+
+	Reinitializes the client's request and formats it as an
+	IOCTL_SPB_EXECUTE_SEQUENCE over the client's transfer list. The
+	transfer buffers are referenced, not copied, so they must stay valid
+	until the request completes.
+
+Arguments:
+
+	Client - pointer to the SPB client, owned by the caller
+
+	Transfers - the transfers making up the sequence
+
+	TransferCount - number of entries in Transfers
+
+Return Value:
+
+	NT status value
+
+--*/
+{
+	NTSTATUS Status;
+	WDF_REQUEST_REUSE_PARAMS ReuseParams;
+	WDFMEMORY_OFFSET MemoryOffset;
+	ULONG i;
+
+	if ((TransferCount == 0) || (TransferCount > SPB_CLIENT_MAX_TRANSFERS)) {
+		return STATUS_INVALID_PARAMETER;
+	}
+
+	WDF_REQUEST_REUSE_PARAMS_INIT(&ReuseParams, WDF_REQUEST_REUSE_NO_FLAGS, STATUS_SUCCESS);
+	Status = WdfRequestReuse(Client->Request, &ReuseParams);
+	if (!NT_SUCCESS(Status)) {
+		return Status;
+	}
+
+	SPB_TRANSFER_LIST_INIT(&Client->Sequence.List, TransferCount);
+
+	for (i = 0; i < TransferCount; i++) {
+		if ((Transfers[i].Buffer == NULL) || (Transfers[i].Length == 0)) {
+			return STATUS_INVALID_PARAMETER;
+		}
+
+		Client->Sequence.List.Transfers[i] = SPB_TRANSFER_LIST_ENTRY_INIT_SIMPLE(
+			Transfers[i].Direction,
+			Transfers[i].DelayInUs,
+			Transfers[i].Buffer,
+			Transfers[i].Length);
+	}
+
+	//
+	// Only hand the controller the entries in use.
+	//
+
+	MemoryOffset.BufferOffset = 0;
+	MemoryOffset.BufferLength = sizeof(SPB_TRANSFER_LIST) +
+		((TransferCount - 1) * sizeof(SPB_TRANSFER_LIST_ENTRY));
+
+	return WdfIoTargetFormatRequestForIoctl(
+		Client->Target,
+		Client->Request,
+		IOCTL_SPB_EXECUTE_SEQUENCE,
+		Client->SequenceMemory,
+		&MemoryOffset,
+		NULL,
+		NULL);
+}
+
+NTSTATUS
+SpbClientInitialize(
+	_Out_ PSPB_CLIENT Client,
+	_In_ WDFIOTARGET Target
+	)
+/*++
+
+Routine Description:
+
+	Creates the request, timer and memory handle the client reuses for
+	every transfer. Both objects are parented to the SPB target. Call
+	once the target has been opened.
+
+Arguments:
+
+	Client - pointer to the SPB client
+
+	Target - the opened SPB io target
+
+Return Value:
+
+	NT status value
+
+--*/
+{
+	NTSTATUS Status;
+	WDF_OBJECT_ATTRIBUTES Attributes;
+
+	RtlZeroMemory(Client, sizeof(SPB_CLIENT));
+	Client->Target = Target;
+	KeInitializeEvent(&Client->Idle, SynchronizationEvent, TRUE);
+
+	WDF_OBJECT_ATTRIBUTES_INIT(&Attributes);
+	Attributes.ParentObject = Target;
+	Status = WdfRequestCreate(&Attributes, Target, &Client->Request);
+	if (!NT_SUCCESS(Status)) {
+		goto Done;
+	}
+
+	Status = WdfRequestAllocateTimer(Client->Request);
+	if (!NT_SUCCESS(Status)) {
+		goto Done;
+	}
+
+	WDF_OBJECT_ATTRIBUTES_INIT(&Attributes);
+	Attributes.ParentObject = Target;
+	Status = WdfMemoryCreatePreallocated(
+		&Attributes,
+		(PVOID)&Client->Sequence,
+		sizeof(Client->Sequence),
+		&Client->SequenceMemory);
+	if (!NT_SUCCESS(Status)) {
+		goto Done;
+	}
+
+	Client->IsInit = TRUE;
+
+Done:
+	if (!NT_SUCCESS(Status)) {
+		KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "spbclient: initialize fail! Status:0x%x\n", Status));
+		SpbClientCleanup(Client);
+	}
+	return Status;
+}
+
+VOID
+SpbClientCleanup(
+	_Inout_ PSPB_CLIENT Client
+	)
+/*++
+
+Routine Description:
+
+	Waits for an outstanding transfer and deletes the client's objects.
+	Call after the SPB target has been closed, which cancels anything
+	still in flight.
+
+Arguments:
+
+	Client - pointer to the SPB client
+
+--*/
+{
+	if (Client->IsInit != FALSE) {
+		KeWaitForSingleObject(&Client->Idle, Executive, KernelMode, FALSE, NULL);
+		Client->IsInit = FALSE;
+	}
+
+	if (Client->SequenceMemory != NULL) {
+		WdfObjectDelete(Client->SequenceMemory);
+		Client->SequenceMemory = NULL;
+	}
+
+	if (Client->Request != NULL) {
+		WdfObjectDelete(Client->Request);
+		Client->Request = NULL;
+	}
+}
+
+static
+NTSTATUS
+SpbClientSend(
+	_In_ PSPB_CLIENT Client,
+	_Out_opt_ PULONG_PTR Information
+	)
+/*++
+
+Routine Description:
+
+	Sends the formatted request synchronously. The client must be owned
+	by the caller and stays owned on return. Information receives the
+	number of bytes the controller transferred.
+
+--*/
+{
+	NTSTATUS Status;
+	WDF_REQUEST_SEND_OPTIONS SendOptions;
+
+	WdfRequestSetCompletionRoutine(Client->Request, NULL, NULL);
+
+	WDF_REQUEST_SEND_OPTIONS_INIT(&SendOptions,
+		WDF_REQUEST_SEND_OPTION_SYNCHRONOUS);
+
+	WDF_REQUEST_SEND_OPTIONS_SET_TIMEOUT(&SendOptions,
+		WDF_REL_TIMEOUT_IN_SEC(SPB_CLIENT_TIMEOUT_SEC));
+
+	Client->TransferCount++;
+
+	WdfRequestSend(Client->Request, Client->Target, &SendOptions);
+	Status = WdfRequestGetStatus(Client->Request);
+
+	if (!NT_SUCCESS(Status)) {
+		Client->ErrorCount++;
+	}
+
+	if (Information != NULL) {
+		*Information = NT_SUCCESS(Status) ? WdfRequestGetInformation(Client->Request) : 0;
+	}
+
+	return Status;
+}
+
+static
+NTSTATUS
+SpbClientSendAsync(
+	_In_ PSPB_CLIENT Client,
+	_In_opt_ PFN_SPB_CLIENT_COMPLETION Completion,
+	_In_opt_ PVOID Context
+	)
+/*++
+
+Routine Description:
+
+	Sends the formatted request without waiting. Ownership passes to the
+	completion routine; on a send failure the client is released here and
+	Completion is not called.
+
+--*/
+{
+	NTSTATUS Status;
+	WDF_REQUEST_SEND_OPTIONS SendOptions;
+
+	Client->Completion = Completion;
+	Client->CompletionContext = Context;
+
+	WdfRequestSetCompletionRoutine(Client->Request, SpbClientEvtRequestCompletion, Client);
+
+	WDF_REQUEST_SEND_OPTIONS_INIT(&SendOptions, WDF_REQUEST_SEND_OPTION_TIMEOUT);
+
+	WDF_REQUEST_SEND_OPTIONS_SET_TIMEOUT(&SendOptions,
+		WDF_REL_TIMEOUT_IN_SEC(SPB_CLIENT_TIMEOUT_SEC));
+
+	Client->TransferCount++;
+
+	if (WdfRequestSend(Client->Request, Client->Target, &SendOptions) == FALSE) {
+		Status = WdfRequestGetStatus(Client->Request);
+		Client->ErrorCount++;
+		Client->Completion = NULL;
+		Client->CompletionContext = NULL;
+		SpbClientRelease(Client);
+		return Status;
+	}
+
+	return STATUS_PENDING;
+}
+
+VOID
+SpbClientEvtRequestCompletion(
+	_In_ WDFREQUEST Request,
+	_In_ WDFIOTARGET Target,
+	_In_ PWDF_REQUEST_COMPLETION_PARAMS Params,
+	_In_ WDFCONTEXT Context
+	)
+/*++
+
+Routine Description:
+
+	Completion routine for asynchronous transfers. Releases the client
+	before calling the caller's callback so the callback can submit the
+	next transfer.
+
+--*/
+{
+	PSPB_CLIENT Client = (PSPB_CLIENT)Context;
+	PFN_SPB_CLIENT_COMPLETION Completion;
+	PVOID CompletionContext;
+	NTSTATUS Status;
+	ULONG_PTR Information;
+
+	UNREFERENCED_PARAMETER(Request);
+	UNREFERENCED_PARAMETER(Target);
+
+	Status = Params->IoStatus.Status;
+	Information = Params->IoStatus.Information;
+
+	Completion = Client->Completion;
+	CompletionContext = Client->CompletionContext;
+	Client->Completion = NULL;
+	Client->CompletionContext = NULL;
+
+	if (!NT_SUCCESS(Status)) {
+		Client->ErrorCount++;
+		KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "spbclient: async transfer fail! Status:0x%x\n", Status));
+	}
+
+	SpbClientRelease(Client);
+
+	if (Completion != NULL) {
+		Completion(Client, Status, Information, CompletionContext);
+	}
+}
+
+NTSTATUS
+SpbClientSequence(
+	_In_ PSPB_CLIENT Client,
+	_In_reads_(TransferCount) PSPB_CLIENT_TRANSFER Transfers,
+	_In_ ULONG TransferCount
+	)
+/*++
+
+Routine Description:
+
+	Runs up to SPB_CLIENT_MAX_TRANSFERS transfers as one bus transaction
+	and waits for the result. Must be called at PASSIVE_LEVEL.
+
+Arguments:
+
+	Client - pointer to the SPB client
+
+	Transfers - the transfers making up the sequence
+
+	TransferCount - number of entries in Transfers
+
+Return Value:
+
+	NT status value
+
+--*/
+{
+	NTSTATUS Status;
+
+	Status = SpbClientAcquire(Client, TRUE);
+	if (!NT_SUCCESS(Status)) {
+		return Status;
+	}
+
+	Status = SpbClientFormat(Client, Transfers, TransferCount);
+	if (NT_SUCCESS(Status)) {
+		Status = SpbClientSend(Client, NULL);
+	}
+
+	SpbClientRelease(Client);
+	return Status;
+}
+
+NTSTATUS
+SpbClientSequenceAsync(
+	_In_ PSPB_CLIENT Client,
+	_In_reads_(TransferCount) PSPB_CLIENT_TRANSFER Transfers,
+	_In_ ULONG TransferCount,
+	_In_opt_ PFN_SPB_CLIENT_COMPLETION Completion,
+	_In_opt_ PVOID Context
+	)
+/*++
+
+Routine Description:
+
+	Queues a sequence and returns without waiting for the bus. At
+	PASSIVE_LEVEL the call waits for a previous transfer to finish; at
+	DISPATCH_LEVEL it fails with STATUS_DEVICE_BUSY instead. The transfer
+	buffers must stay valid until Completion runs.
+
+Arguments:
+
+	Client - pointer to the SPB client
+
+	Transfers - the transfers making up the sequence
+
+	TransferCount - number of entries in Transfers
+
+	Completion - optional callback run when the sequence completes
+
+	Context - passed to Completion
+
+Return Value:
+
+	STATUS_PENDING if Completion will be called, otherwise the error
+
+--*/
+{
+	NTSTATUS Status;
+
+	Status = SpbClientAcquire(Client, TRUE);
+	if (!NT_SUCCESS(Status)) {
+		return Status;
+	}
+
+	Status = SpbClientFormat(Client, Transfers, TransferCount);
+	if (!NT_SUCCESS(Status)) {
+		SpbClientRelease(Client);
+		return Status;
+	}
+
+	return SpbClientSendAsync(Client, Completion, Context);
+}
+
+NTSTATUS
+SpbClientWrite(
+	_In_ PSPB_CLIENT Client,
+	_In_reads_(Length) PVOID Buffer,
+	_In_ ULONG Length
+	)
+{
+	SPB_CLIENT_TRANSFER Transfer;
+
+	Transfer.Direction = SpbTransferDirectionToDevice;
+	Transfer.DelayInUs = 0;
+	Transfer.Buffer = Buffer;
+	Transfer.Length = Length;
+
+	return SpbClientSequence(Client, &Transfer, 1);
+}
+
+NTSTATUS
+SpbClientRead(
+	_In_ PSPB_CLIENT Client,
+	_Out_writes_(Length) PVOID Buffer,
+	_In_ ULONG Length,
+	_Out_opt_ PULONG_PTR BytesRead
+	)
+/*++
+
+Routine Description:
+
+	Reads Length bytes. The controller may end a read early, callers
+	that need the whole buffer check BytesRead.
+
+--*/
+{
+	SPB_CLIENT_TRANSFER Transfer;
+	NTSTATUS Status;
+
+	if (BytesRead != NULL) {
+		*BytesRead = 0;
+	}
+
+	Transfer.Direction = SpbTransferDirectionFromDevice;
+	Transfer.DelayInUs = 0;
+	Transfer.Buffer = Buffer;
+	Transfer.Length = Length;
+
+	Status = SpbClientAcquire(Client, TRUE);
+	if (!NT_SUCCESS(Status)) {
+		return Status;
+	}
+
+	Status = SpbClientFormat(Client, &Transfer, 1);
+	if (NT_SUCCESS(Status)) {
+		Status = SpbClientSend(Client, BytesRead);
+	}
+
+	SpbClientRelease(Client);
+	return Status;
+}
+
+NTSTATUS
+SpbClientWriteRead(
+	_In_ PSPB_CLIENT Client,
+	_In_reads_(WriteLength) PVOID WriteBuffer,
+	_In_ ULONG WriteLength,
+	_Out_writes_(ReadLength) PVOID ReadBuffer,
+	_In_ ULONG ReadLength
+	)
+{
+	SPB_CLIENT_TRANSFER Transfers[2];
+
+	Transfers[0].Direction = SpbTransferDirectionToDevice;
+	Transfers[0].DelayInUs = 0;
+	Transfers[0].Buffer = WriteBuffer;
+	Transfers[0].Length = WriteLength;
+
+	Transfers[1].Direction = SpbTransferDirectionFromDevice;
+	Transfers[1].DelayInUs = 0;
+	Transfers[1].Buffer = ReadBuffer;
+	Transfers[1].Length = ReadLength;
+
+	return SpbClientSequence(Client, Transfers, 2);
+}
+
+NTSTATUS
+SpbClientWriteAsync(
+	_In_ PSPB_CLIENT Client,
+	_In_reads_(Length) PVOID Buffer,
+	_In_ ULONG Length,
+	_In_opt_ PFN_SPB_CLIENT_COMPLETION Completion,
+	_In_opt_ PVOID Context
+	)
+{
+	SPB_CLIENT_TRANSFER Transfer;
+
+	Transfer.Direction = SpbTransferDirectionToDevice;
+	Transfer.DelayInUs = 0;
+	Transfer.Buffer = Buffer;
+	Transfer.Length = Length;
+
+	return SpbClientSequenceAsync(Client, &Transfer, 1, Completion, Context);
+}
+
+NTSTATUS
+SpbClientWriteRegister(
+	_In_ PSPB_CLIENT Client,
+	_In_ UCHAR Register,
+	_In_reads_opt_(Length) PVOID Data,
+	_In_ ULONG Length
+	)
+/*++
+
+Routine Description:
+
+	Writes a register address followed by Data in a single transfer. The
+	bytes are staged in the client, so Data may live on the caller's
+	stack.
+
+Arguments:
+
+	Client - pointer to the SPB client
+
+	Register - register address sent before the data
+
+	Data - optional data written after the register address
+
+	Length - length of Data in bytes
+
+Return Value:
+
+	NT status value
+
+--*/
+{
+	NTSTATUS Status;
+	SPB_CLIENT_TRANSFER Transfer;
+
+	if ((Length >= SPB_CLIENT_STAGING_LENGTH) || ((Data == NULL) && (Length != 0))) {
+		return STATUS_INVALID_PARAMETER;
+	}
+
+	Status = SpbClientAcquire(Client, TRUE);
+	if (!NT_SUCCESS(Status)) {
+		return Status;
+	}
+
+	Client->Staging[0] = Register;
+	if (Length != 0) {
+		RtlCopyMemory(&Client->Staging[1], Data, Length);
+	}
+
+	Transfer.Direction = SpbTransferDirectionToDevice;
+	Transfer.DelayInUs = 0;
+	Transfer.Buffer = Client->Staging;
+	Transfer.Length = Length + 1;
+
+	Status = SpbClientFormat(Client, &Transfer, 1);
+	if (NT_SUCCESS(Status)) {
+		Status = SpbClientSend(Client, NULL);
+	}
+
+	SpbClientRelease(Client);
+	return Status;
+}
@@ -0,0 +1,184 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	spbclient.h
+
+Abstract:
+
+	SPB transfer helpers shared by the touch screen drivers. Every client
+	owns one WDFREQUEST and one transfer list that are created when the
+	SPB target is opened and reused for every transfer afterwards, so a
+	touch sample costs no allocation. Transfers are issued as
+	IOCTL_SPB_EXECUTE_SEQUENCE, either synchronously or with a completion
+	callback.
+
+Environment:
+
+	kernel mode only
+
+--*/
+
+#ifndef _SPBCLIENT_H_
+#define _SPBCLIENT_H_
+
+#include <wdm.h>
+#include <wdf.h>
+#include <spb.h>
+
+//
+// Maximum number of transfers in one batched sequence.
+//
+#define SPB_CLIENT_MAX_TRANSFERS		4
+
+//
+// Size of the staging buffer used to prefix a register address to
+// caller data (SpbClientWriteRegister).
+//
+#define SPB_CLIENT_STAGING_LENGTH		256
+
+//
+// Timeout applied to every transfer, in seconds.
+//
+#define SPB_CLIENT_TIMEOUT_SEC			60
+
+typedef struct _SPB_CLIENT SPB_CLIENT, *PSPB_CLIENT;
+
+//
+// Completion callback for asynchronous transfers. Called at
+// IRQL <= DISPATCH_LEVEL after the client has been released, so the
+// callback may queue the next transfer.
+//
+typedef
+VOID
+SPB_CLIENT_COMPLETION(
+	_In_ PSPB_CLIENT Client,
+	_In_ NTSTATUS Status,
+	_In_ ULONG_PTR Information,
+	_In_opt_ PVOID Context
+	);
+
+typedef SPB_CLIENT_COMPLETION *PFN_SPB_CLIENT_COMPLETION;
+
+typedef struct _SPB_CLIENT_TRANSFER {
+	SPB_TRANSFER_DIRECTION	Direction;
+	ULONG					DelayInUs;
+	PVOID					Buffer;
+	ULONG					Length;
+} SPB_CLIENT_TRANSFER, *PSPB_CLIENT_TRANSFER;
+
+struct _SPB_CLIENT {
+	WDFIOTARGET				Target;
+
+	//
+	// Request and memory handle reused for every transfer.
+	//
+	WDFREQUEST				Request;
+	WDFMEMORY				SequenceMemory;
+
+	//
+	// Owned while a transfer is outstanding. A synchronization event
+	// rather than a lock, so an asynchronous transfer can release it
+	// from its completion routine.
+	//
+	KEVENT					Idle;
+
+	PFN_SPB_CLIENT_COMPLETION	Completion;
+	PVOID					CompletionContext;
+
+	SPB_TRANSFER_LIST_AND_ENTRIES(SPB_CLIENT_MAX_TRANSFERS) Sequence;
+
+	UCHAR					Staging[SPB_CLIENT_STAGING_LENGTH];
+
+	ULONG					TransferCount;
+	ULONG					ErrorCount;
+	BOOLEAN					IsInit;
+};
+
+NTSTATUS
+SpbClientInitialize(
+	_Out_ PSPB_CLIENT Client,
+	_In_ WDFIOTARGET Target
+	);
+
+VOID
+SpbClientCleanup(
+	_Inout_ PSPB_CLIENT Client
+	);
+
+NTSTATUS
+SpbClientSequence(
+	_In_ PSPB_CLIENT Client,
+	_In_reads_(TransferCount) PSPB_CLIENT_TRANSFER Transfers,
+	_In_ ULONG TransferCount
+	);
+
+NTSTATUS
+SpbClientSequenceAsync(
+	_In_ PSPB_CLIENT Client,
+	_In_reads_(TransferCount) PSPB_CLIENT_TRANSFER Transfers,
+	_In_ ULONG TransferCount,
+	_In_opt_ PFN_SPB_CLIENT_COMPLETION Completion,
+	_In_opt_ PVOID Context
+	);
+
+NTSTATUS
+SpbClientWrite(
+	_In_ PSPB_CLIENT Client,
+	_In_reads_(Length) PVOID Buffer,
+	_In_ ULONG Length
+	);
+
+NTSTATUS
+SpbClientRead(
+	_In_ PSPB_CLIENT Client,
+	_Out_writes_(Length) PVOID Buffer,
+	_In_ ULONG Length,
+	_Out_opt_ PULONG_PTR BytesRead
+	);
+
+NTSTATUS
+SpbClientWriteRead(
+	_In_ PSPB_CLIENT Client,
+	_In_reads_(WriteLength) PVOID WriteBuffer,
+	_In_ ULONG WriteLength,
+	_Out_writes_(ReadLength) PVOID ReadBuffer,
+	_In_ ULONG ReadLength
+	);
+
+NTSTATUS
+SpbClientWriteAsync(
+	_In_ PSPB_CLIENT Client,
+	_In_reads_(Length) PVOID Buffer,
+	_In_ ULONG Length,
+	_In_opt_ PFN_SPB_CLIENT_COMPLETION Completion,
+	_In_opt_ PVOID Context
+	);
+
+NTSTATUS
+SpbClientWriteRegister(
+	_In_ PSPB_CLIENT Client,
+	_In_ UCHAR Register,
+	_In_reads_opt_(Length) PVOID Data,
+	_In_ ULONG Length
+	);
+
+#endif
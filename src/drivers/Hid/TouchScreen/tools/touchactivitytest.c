@@ -0,0 +1,506 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	touchactivitytest.c
+
+Abstract:
+
+	Host test of the scan rate state machine (touchactivity.c). It runs
+	a few scripted transitions first, then drives the state machine
+	the way the drivers do, with an interrupt for every frame of a
+	simulated touch and a one shot doze timer, through idle periods,
+	taps, drags, a suspend and rejected doze commands. The panel scans
+	every 10 ms at full rate and every 20 ms in doze, the clock starts
+	shortly before it wraps.
+
+	Build and run on any host with a C compiler, it prints the time
+	spent in each mode and returns nonzero when a check fails:
+
+		cc -O2 -I.. -o touchactivitytest touchactivitytest.c ../touchactivity.c
+		touchactivitytest [-q quietms] [-f failpercent] [-s seed]
+
+Environment:
+
+	user mode
+
+--*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "touchactivity.h"
+
+#define FULL_FRAME_MS		10
+#define DOZE_FRAME_MS		20
+#define NO_TIMER			0xFFFFFFFFu
+
+static const char *ModeNames[TouchModes] = { "active", "doze", "off" };
+
+static unsigned int Failures;
+
+static void
+Check(int Condition, const char *What, unsigned int Time)
+{
+	if (!Condition)
+	{
+		if (Failures < 20)
+		{
+			fprintf(stderr, "FAILED at %u ms: %s\n", Time, What);
+		}
+		Failures++;
+	}
+}
+
+static void
+ScriptedChecks(void)
+{
+	TOUCH_ACTIVITY activity;
+	unsigned int waitMs;
+	unsigned int now;
+
+	//
+	// 0 keeps the panel at full rate.
+	//
+	TouchActivityInitialize(&activity, 0);
+	TouchActivityStart(&activity, 1000);
+	Check(!TouchActivityDozeDue(&activity, 900000, &waitMs) && (waitMs == 0),
+		"disabled state machine asked for doze", 0);
+
+	TouchActivitySetQuietTime(&activity, 20);
+	Check(activity.QuietMs == TOUCH_ACTIVITY_MIN_QUIET_MS,
+		"short quiet period not raised to the minimum", 0);
+
+	//
+	// Doze only once the quiet period passed.
+	//
+	TouchActivityInitialize(&activity, 500);
+	TouchActivityStart(&activity, 1000);
+	Check(!TouchActivityDozeDue(&activity, 1200, &waitMs) && (waitMs == 300),
+		"doze due before the quiet period", 1200);
+	Check(!TouchActivityInterrupt(&activity, 1300),
+		"wake reported at full rate", 1300);
+	Check(!TouchActivityDozeDue(&activity, 1500, &waitMs) && (waitMs == 300),
+		"interrupt did not restart the quiet period", 1500);
+	Check(TouchActivityDozeDue(&activity, 1800, &waitMs),
+		"doze not due after the quiet period", 1800);
+
+	TouchActivityDozeEntered(&activity, 1800, 1);
+	Check(activity.Mode == TouchModeDoze, "doze not entered", 1800);
+	Check(!TouchActivityDozeDue(&activity, 5000, &waitMs) && (waitMs == 0),
+		"doze due while dozing", 5000);
+
+	//
+	// Only the first interrupt in doze asks for the full rate.
+	//
+	Check(TouchActivityInterrupt(&activity, 5000), "first interrupt did not wake", 5000);
+	Check(!TouchActivityInterrupt(&activity, 5010), "second interrupt woke again", 5010);
+	Check((activity.DozeEntries == 1) && (activity.DozeExits == 1),
+		"transition counts", 5010);
+
+	//
+	// A rejected doze command is retried after another quiet period.
+	//
+	Check(TouchActivityDozeDue(&activity, 5510, &waitMs), "doze not due", 5510);
+	TouchActivityDozeEntered(&activity, 5510, 0);
+	Check((activity.Mode == TouchModeActive) && (activity.DozeFailures == 1),
+		"failed doze changed the mode", 5510);
+	Check(!TouchActivityDozeDue(&activity, 5600, &waitMs) && (waitMs == 410),
+		"failed doze retried early", 5600);
+
+	//
+	// Time accounting, across a stop and start.
+	//
+	TouchActivityStop(&activity, 6000);
+	Check(!TouchActivityDozeDue(&activity, 9000, &waitMs) && (waitMs == 0),
+		"doze due while stopped", 9000);
+	Check(!TouchActivityInterrupt(&activity, 9000), "wake while stopped", 9000);
+	TouchActivityStart(&activity, 10000);
+	TouchActivityAccount(&activity, 10500);
+	Check(activity.ModeMs[TouchModeActive] == 800 + 1000 + 500,
+		"active time", 10500);
+	Check(activity.ModeMs[TouchModeDoze] == 3200, "doze time", 10500);
+	Check(activity.ModeMs[TouchModeOff] == 4000, "off time", 10500);
+
+	//
+	// The clock wraps.
+	//
+	now = 0xFFFFFF00u;
+	TouchActivityInitialize(&activity, 500);
+	TouchActivityStart(&activity, now);
+	Check(!TouchActivityDozeDue(&activity, now + 400, &waitMs) && (waitMs == 100),
+		"doze due early across the wrap", now + 400);
+	Check(TouchActivityDozeDue(&activity, now + 500, &waitMs),
+		"doze not due across the wrap", now + 500);
+	TouchActivityDozeEntered(&activity, now + 500, 1);
+	TouchActivityAccount(&activity, now + 700);
+	Check((activity.ModeMs[TouchModeActive] == 500) &&
+		(activity.ModeMs[TouchModeDoze] == 200),
+		"accounting across the wrap", now + 700);
+}
+
+//
+// What the simulated finger does, one phase after the other.
+//
+typedef enum _PHASE_KIND
+{
+	PhaseIdle,
+	PhaseTaps,
+	PhaseDrag,
+	PhaseSuspend
+}PHASE_KIND;
+
+typedef struct _PHASE
+{
+	PHASE_KIND Kind;
+	unsigned int DurationMs;
+}PHASE;
+
+static const PHASE Phases[] =
+{
+	{ PhaseIdle, 30000 },
+	{ PhaseTaps, 60000 },
+	{ PhaseDrag, 20000 },
+	{ PhaseIdle, 15000 },
+	{ PhaseSuspend, 10000 },
+	{ PhaseTaps, 30000 },
+	{ PhaseIdle, 60000 },
+};
+
+typedef struct _SIMULATION
+{
+	TOUCH_ACTIVITY Activity;
+	unsigned int FailPercent;
+
+	// Absolute expiry of the doze timer, NO_TIMER when not armed.
+	unsigned int TimerDue;
+
+	unsigned int LastInterrupt;
+	unsigned int LastRejected;
+	unsigned int NextFrame;
+
+	// Start of the current touch and whether it was reported yet.
+	unsigned int TouchStart;
+	int TouchReported;
+	unsigned int MaxWakeMs;
+
+	// Suspends that found the panel dozing, it leaves doze without a wake.
+	unsigned int DozingSuspends;
+}SIMULATION;
+
+static void
+ArmTimer(SIMULATION *Sim, unsigned int Now, unsigned int Ms)
+{
+	Sim->TimerDue = Now + Ms;
+}
+
+//
+// The driver's doze timer callback.
+//
+static void
+DozeTimer(SIMULATION *Sim, unsigned int Now)
+{
+	unsigned int waitMs;
+
+	Sim->TimerDue = NO_TIMER;
+
+	if (TouchActivityDozeDue(&Sim->Activity, Now, &waitMs))
+	{
+		int ok = (unsigned int)(rand() % 100) >= Sim->FailPercent;
+
+		Check((unsigned int)(Now - Sim->LastInterrupt) >= Sim->Activity.QuietMs,
+			"doze before the quiet period", Now);
+
+		TouchActivityDozeEntered(&Sim->Activity, Now, ok);
+		if (!ok)
+		{
+			Sim->LastRejected = Now;
+		}
+		else
+		{
+			Sim->NextFrame = Now + DOZE_FRAME_MS;
+		}
+
+		TouchActivityDozeDue(&Sim->Activity, Now, &waitMs);
+	}
+
+	if (waitMs != 0)
+	{
+		ArmTimer(Sim, Now, waitMs);
+	}
+}
+
+//
+// The driver's ISR, for a frame with a touch.
+//
+static void
+Interrupt(SIMULATION *Sim, unsigned int Now)
+{
+	int dozing = (Sim->Activity.Mode == TouchModeDoze);
+	int wake = TouchActivityInterrupt(&Sim->Activity, Now);
+
+	Check(wake == dozing, "first interrupt in doze did not wake", Now);
+	Check(Sim->Activity.Mode == TouchModeActive, "not at full rate after an interrupt", Now);
+
+	if (wake)
+	{
+		ArmTimer(Sim, Now, Sim->Activity.QuietMs);
+	}
+
+	if (!Sim->TouchReported)
+	{
+		unsigned int latency = Now - Sim->TouchStart;
+
+		if (latency > Sim->MaxWakeMs)
+		{
+			Sim->MaxWakeMs = latency;
+		}
+		Sim->TouchReported = 1;
+	}
+
+	Sim->LastInterrupt = Now;
+}
+
+static int
+Simulate(unsigned int QuietMs, unsigned int FailPercent, unsigned int Seed)
+{
+	SIMULATION sim;
+	unsigned int start = 0xFFFFFFFFu - 40000;
+	unsigned int now = start;
+	unsigned int offMs = 0;
+	int wasTouching = 0;
+	unsigned long long total = 0;
+	unsigned int phase;
+	unsigned int mode;
+
+	srand(Seed);
+
+	TouchActivityInitialize(&sim.Activity, QuietMs);
+	sim.FailPercent = FailPercent;
+	sim.TimerDue = NO_TIMER;
+	sim.LastInterrupt = now;
+	sim.LastRejected = now;
+	sim.NextFrame = now;
+	sim.TouchStart = now;
+	sim.TouchReported = 1;
+	sim.MaxWakeMs = 0;
+	sim.DozingSuspends = 0;
+
+	TouchActivityStart(&sim.Activity, now);
+	if (sim.Activity.QuietMs != 0)
+	{
+		ArmTimer(&sim, now, sim.Activity.QuietMs);
+	}
+
+	for (phase = 0; phase < sizeof(Phases) / sizeof(Phases[0]); phase++)
+	{
+		unsigned int end = now + Phases[phase].DurationMs;
+		unsigned int tapLeft = 0;
+		unsigned int gapLeft = 0;
+
+		if (Phases[phase].Kind == PhaseSuspend)
+		{
+			if (sim.Activity.Mode == TouchModeDoze)
+			{
+				sim.DozingSuspends++;
+			}
+			TouchActivityStop(&sim.Activity, now);
+			sim.TimerDue = NO_TIMER;
+			offMs += Phases[phase].DurationMs;
+			now = end;
+
+			TouchActivityStart(&sim.Activity, now);
+			if (sim.Activity.QuietMs != 0)
+			{
+				ArmTimer(&sim, now, sim.Activity.QuietMs);
+			}
+			sim.LastInterrupt = now;
+			sim.NextFrame = now;
+			continue;
+		}
+
+		while (now != end)
+		{
+			int touching;
+
+			//
+			// Taps of 50 to 400 ms with 0.1 to 4 s between them, a drag
+			// touches all the time.
+			//
+			if (Phases[phase].Kind == PhaseIdle)
+			{
+				touching = 0;
+			}
+			else if (Phases[phase].Kind == PhaseDrag)
+			{
+				touching = 1;
+			}
+			else
+			{
+				if ((tapLeft == 0) && (gapLeft == 0))
+				{
+					tapLeft = 50 + (rand() % 350);
+					gapLeft = 100 + (rand() % 3900);
+				}
+				if (tapLeft != 0)
+				{
+					touching = 1;
+					tapLeft--;
+				}
+				else
+				{
+					touching = 0;
+					gapLeft--;
+				}
+			}
+
+			if (touching && !wasTouching)
+			{
+				sim.TouchStart = now;
+				sim.TouchReported = 0;
+			}
+			wasTouching = touching;
+
+			if (sim.TimerDue == now)
+			{
+				DozeTimer(&sim, now);
+			}
+
+			//
+			// The panel reports frames with a touch at the rate of its
+			// current mode, a touch that ended is reported no more.
+			//
+			if (now == sim.NextFrame)
+			{
+				if (touching)
+				{
+					Interrupt(&sim, now);
+				}
+				sim.NextFrame = now + ((sim.Activity.Mode == TouchModeDoze) ?
+					DOZE_FRAME_MS : FULL_FRAME_MS);
+			}
+
+			//
+			// The timer is never lost: at full rate with a doze period the
+			// panel dozes within QuietMs of the last interrupt or rejection.
+			//
+			if ((sim.Activity.QuietMs != 0) && (sim.Activity.Mode == TouchModeActive))
+			{
+				unsigned int last = sim.LastInterrupt;
+
+				if ((unsigned int)(sim.LastRejected - last) < 0x80000000u)
+				{
+					last = sim.LastRejected;
+				}
+				Check((unsigned int)(now - last) <= sim.Activity.QuietMs,
+					"panel stayed at full rate after the quiet period", now);
+			}
+
+			Check(sim.Activity.DozeEntries == sim.Activity.DozeExits + sim.DozingSuspends +
+				(sim.Activity.Mode == TouchModeDoze),
+				"doze entries and exits out of step", now);
+
+			now++;
+		}
+	}
+
+	TouchActivityStop(&sim.Activity, now);
+
+	for (mode = 0; mode < TouchModes; mode++)
+	{
+		total += sim.Activity.ModeMs[mode];
+	}
+	Check(total == (unsigned int)(now - start), "mode times do not add up", now);
+	Check(sim.Activity.ModeMs[TouchModeOff] == offMs, "off time", now);
+	Check(sim.MaxWakeMs <= DOZE_FRAME_MS, "touch reported later than one doze frame", now);
+	if (QuietMs == 0)
+	{
+		Check(sim.Activity.DozeEntries == 0, "dozed while disabled", now);
+	}
+
+	printf("quiet %u ms, %u%% rejected doze commands, %.1f s simulated\n",
+		sim.Activity.QuietMs, FailPercent, total / 1000.0);
+	for (mode = 0; mode < TouchModes; mode++)
+	{
+		printf("  %-7s %8.1f s %5.1f%%\n", ModeNames[mode],
+			sim.Activity.ModeMs[mode] / 1000.0,
+			total ? 100.0 * sim.Activity.ModeMs[mode] / total : 0.0);
+	}
+	printf("  doze entries %u, exits %u, rejected %u, first touch reported within %u ms\n",
+		sim.Activity.DozeEntries, sim.Activity.DozeExits, sim.Activity.DozeFailures,
+		sim.MaxWakeMs);
+
+	return 1;
+}
+
+int
+main(int argc, char **argv)
+{
+	unsigned int quietMs = 2000;
+	unsigned int failPercent = 10;
+	unsigned int seed = 1;
+	int i;
+
+	for (i = 1; i < argc; i++)
+	{
+		if ((argv[i][0] == '-') && (i + 1 < argc))
+		{
+			unsigned int value = (unsigned int)strtoul(argv[i + 1], NULL, 0);
+
+			switch (argv[i][1])
+			{
+			case 'q':
+				quietMs = value;
+				break;
+			case 'f':
+				failPercent = value;
+				break;
+			case 's':
+				seed = value;
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-q quietms] [-f failpercent] [-s seed]\n", argv[0]);
+				return 1;
+			}
+			i++;
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [-q quietms] [-f failpercent] [-s seed]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	ScriptedChecks();
+
+	Simulate(0, 0, seed);
+	Simulate(quietMs, 0, seed);
+	Simulate(quietMs, failPercent, seed);
+
+	if (Failures != 0)
+	{
+		printf("%u checks failed\n", Failures);
+		return 1;
+	}
+
+	printf("all checks passed\n");
+	return 0;
+}
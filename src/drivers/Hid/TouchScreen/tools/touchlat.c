@@ -0,0 +1,295 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	touchlat.c
+
+Abstract:
+
+	Decodes the touch latency feature report (TOUCH_LATENCY_REPORT_ID,
+	see touchreport.h) into per stage counts, mean, maximum and
+	percentiles. Percentiles are interpolated linearly inside the log2
+	bucket they fall in, so they are estimates within that bucket.
+
+	On Windows the report is read from every touch screen collection
+	that declares it, -r clears the statistics after reading:
+
+		cl /I.. touchlat.c hid.lib setupapi.lib
+		touchlat
+		touchlat -r
+
+	On any host a saved report can be decoded:
+
+		cc -O2 -I.. -o touchlat touchlat.c
+		touchlat report.bin
+
+Environment:
+
+	user mode
+
+--*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <setupapi.h>
+#include <hidsdi.h>
+#endif
+
+#include "touchreport.h"
+
+static const char *StageNames[TOUCH_LATENCY_STAGES] = {
+	"read",
+	"build",
+	"complete",
+	"total"
+};
+
+//
+// Latency below which Percent of the samples fall.
+//
+static double
+Percentile(const TOUCH_LATENCY_HISTOGRAM *Histogram, unsigned int BaseShift, double Percent)
+{
+	unsigned long long target;
+	unsigned long long seen = 0;
+	unsigned int bucket;
+
+	if (Histogram->Count == 0)
+	{
+		return 0;
+	}
+
+	target = (unsigned long long)(Histogram->Count * Percent / 100.0 + 0.5);
+	if (target == 0)
+	{
+		target = 1;
+	}
+
+	for (bucket = 0; bucket < TOUCH_LATENCY_BUCKETS; bucket++)
+	{
+		unsigned int count = Histogram->Buckets[bucket];
+		double low = (bucket == 0) ? 0 : (double)(1ULL << (BaseShift + bucket - 1));
+		double high = (double)(1ULL << (BaseShift + bucket));
+
+		if (seen + count < target)
+		{
+			seen += count;
+			continue;
+		}
+
+		if ((bucket == TOUCH_LATENCY_BUCKETS - 1) || (high > Histogram->MaxUs))
+		{
+			high = Histogram->MaxUs;
+		}
+		if (high < low)
+		{
+			high = low;
+		}
+
+		return low + (high - low) * (double)(target - seen) / count;
+	}
+
+	return Histogram->MaxUs;
+}
+
+static int
+Decode(const unsigned char *Data, unsigned int Length)
+{
+	const TOUCH_LATENCY_REPORT *report = (const TOUCH_LATENCY_REPORT *)Data;
+	unsigned int i;
+
+	if (Length < TOUCH_LATENCY_REPORT_LENGTH ||
+		report->ReportId != TOUCH_LATENCY_REPORT_ID ||
+		report->Version != TOUCH_LATENCY_REPORT_VERSION ||
+		report->Stages != TOUCH_LATENCY_STAGES ||
+		report->Buckets != TOUCH_LATENCY_BUCKETS)
+	{
+		fprintf(stderr, "not a version %d latency report\n", TOUCH_LATENCY_REPORT_VERSION);
+		return 1;
+	}
+
+	printf("frames %u, reports %u, dropped frames %u, dropped reports %u, overflows %u\n",
+		report->Frames, report->Reports, report->DroppedFrames,
+		report->DroppedReports, report->Overflows);
+
+	printf("%-9s %9s %9s %9s %9s %9s %9s\n",
+		"stage", "count", "mean", "p50", "p90", "p99", "max");
+
+	for (i = 0; i < TOUCH_LATENCY_STAGES; i++)
+	{
+		TOUCH_LATENCY_HISTOGRAM histogram = report->Latency[i];
+
+		printf("%-9s %9u %9.0f %9.0f %9.0f %9.0f %9u\n",
+			StageNames[i],
+			histogram.Count,
+			histogram.Count ? (double)histogram.TotalUs / histogram.Count : 0,
+			Percentile(&histogram, report->BaseShift, 50),
+			Percentile(&histogram, report->BaseShift, 90),
+			Percentile(&histogram, report->BaseShift, 99),
+			histogram.MaxUs);
+	}
+	printf("(us)\n");
+
+	return 0;
+}
+
+static int
+DecodeFile(const char *Path)
+{
+	unsigned char data[TOUCH_LATENCY_REPORT_LENGTH];
+	FILE *file = fopen(Path, "rb");
+	size_t length;
+
+	if (file == NULL)
+	{
+		fprintf(stderr, "cannot open %s\n", Path);
+		return 1;
+	}
+
+	length = fread(data, 1, sizeof(data), file);
+	fclose(file);
+
+	return Decode(data, (unsigned int)length);
+}
+
+#ifdef _WIN32
+
+static int
+QueryDevices(int Reset)
+{
+	GUID hidGuid;
+	HDEVINFO devInfo;
+	SP_DEVICE_INTERFACE_DATA interfaceData;
+	DWORD index;
+	int found = 0;
+
+	HidD_GetHidGuid(&hidGuid);
+	devInfo = SetupDiGetClassDevs(&hidGuid, NULL, NULL, DIGCF_PRESENT | DIGCF_DEVICEINTERFACE);
+	if (devInfo == INVALID_HANDLE_VALUE)
+	{
+		return 1;
+	}
+
+	interfaceData.cbSize = sizeof(interfaceData);
+	for (index = 0; SetupDiEnumDeviceInterfaces(devInfo, NULL, &hidGuid, index, &interfaceData); index++)
+	{
+		PSP_DEVICE_INTERFACE_DETAIL_DATA_A detail;
+		PHIDP_PREPARSED_DATA preparsed;
+		HIDP_CAPS caps;
+		unsigned char *report;
+		DWORD size = 0;
+		HANDLE device;
+
+		SetupDiGetDeviceInterfaceDetailA(devInfo, &interfaceData, NULL, 0, &size, NULL);
+		detail = malloc(size);
+		if (detail == NULL)
+		{
+			continue;
+		}
+		detail->cbSize = sizeof(*detail);
+		if (!SetupDiGetDeviceInterfaceDetailA(devInfo, &interfaceData, detail, size, NULL, NULL))
+		{
+			free(detail);
+			continue;
+		}
+
+		device = CreateFileA(detail->DevicePath, GENERIC_READ | GENERIC_WRITE,
+			FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL);
+		if (device == INVALID_HANDLE_VALUE)
+		{
+			free(detail);
+			continue;
+		}
+
+		//
+		// Touch screen collections (digitizer page, usage 0x04) only.
+		//
+		if (HidD_GetPreparsedData(device, &preparsed))
+		{
+			if (HidP_GetCaps(preparsed, &caps) == HIDP_STATUS_SUCCESS &&
+				caps.UsagePage == 0x0d && caps.Usage == 0x04 &&
+				caps.FeatureReportByteLength >= TOUCH_LATENCY_REPORT_LENGTH)
+			{
+				report = calloc(1, caps.FeatureReportByteLength);
+				if (report != NULL)
+				{
+					report[0] = TOUCH_LATENCY_REPORT_ID;
+					if (HidD_GetFeature(device, report, caps.FeatureReportByteLength))
+					{
+						printf("%s\n", detail->DevicePath);
+						Decode(report, caps.FeatureReportByteLength);
+						found++;
+
+						if (Reset)
+						{
+							memset(report, 0, caps.FeatureReportByteLength);
+							report[0] = TOUCH_LATENCY_REPORT_ID;
+							if (!HidD_SetFeature(device, report, caps.FeatureReportByteLength))
+							{
+								fprintf(stderr, "reset failed, error %lu\n", GetLastError());
+							}
+						}
+					}
+					free(report);
+				}
+			}
+			HidD_FreePreparsedData(preparsed);
+		}
+
+		CloseHandle(device);
+		free(detail);
+	}
+
+	SetupDiDestroyDeviceInfoList(devInfo);
+
+	if (found == 0)
+	{
+		fprintf(stderr, "no touch screen with a latency report found\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+#endif
+
+int
+main(int argc, char **argv)
+{
+	if (argc == 2 && strcmp(argv[1], "-r") != 0)
+	{
+		return DecodeFile(argv[1]);
+	}
+
+#ifdef _WIN32
+	if (argc == 1 || (argc == 2 && strcmp(argv[1], "-r") == 0))
+	{
+		return QueryDevices(argc == 2);
+	}
+#endif
+
+	fprintf(stderr, "usage: touchlat [-r] | touchlat report.bin\n");
+	return 1;
+}
@@ -0,0 +1,485 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	touchpredict.c
+
+Abstract:
+
+	Replays a recorded touch trace through the tracker's contact filter
+	(touchreport.c) and reports, for every prediction horizon, the RMS
+	distance between the position reported at time t and where the
+	finger actually was at t + horizon. The horizon stands for the
+	latency the prediction has to hide; the "raw" column is the same
+	error without filter and prediction.
+
+	A trace is a text file with one contact per line, contacts with the
+	same time belong to one frame, a time alone is a frame without
+	contacts:
+
+		<time us> <controller id> <x> <y>
+
+	Build and use on any host with a C compiler:
+
+		cc -O2 -I.. -o touchpredict touchpredict.c ../touchreport.c -lm
+		touchpredict [-a alpha] [-b beta] [-d maxdistance] trace.txt
+		touchpredict -s
+
+	-s replays a generated trace of noisy drags and flings instead.
+
+Environment:
+
+	user mode
+
+--*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "touchreport.h"
+
+#define MAX_SAMPLES		(1 << 20)
+#define NO_SAMPLE		(-1)
+
+typedef struct _SAMPLE
+{
+	unsigned long long Time;
+	unsigned int Id;
+	double X;
+	double Y;
+
+	// Next sample of the same stroke, NO_SAMPLE at lift.
+	int Next;
+}SAMPLE;
+
+typedef struct _TRACE
+{
+	SAMPLE *Samples;
+	int Count;
+}TRACE;
+
+static const unsigned int DefaultHorizonsMs[] = { 0, 4, 8, 12, 16, 20, 24, 32 };
+
+static int
+AddSample(TRACE *Trace, unsigned long long Time, int Id, double X, double Y)
+{
+	SAMPLE *sample;
+
+	if (Trace->Count == MAX_SAMPLES)
+	{
+		return 0;
+	}
+
+	sample = &Trace->Samples[Trace->Count++];
+	sample->Time = Time;
+	sample->Id = (unsigned int)Id;
+	sample->X = X;
+	sample->Y = Y;
+	sample->Next = NO_SAMPLE;
+	return 1;
+}
+
+//
+// Chains every sample to the next one of its stroke. A stroke ends at
+// the first frame without its controller id.
+//
+static void
+LinkStrokes(TRACE *Trace)
+{
+	int last[256];
+	int i;
+	int j;
+	int frameStart = 0;
+
+	for (i = 0; i < 256; i++)
+	{
+		last[i] = NO_SAMPLE;
+	}
+
+	while (frameStart < Trace->Count)
+	{
+		unsigned long long time = Trace->Samples[frameStart].Time;
+		int frameEnd = frameStart;
+		unsigned char present[256] = { 0 };
+
+		while (frameEnd < Trace->Count && Trace->Samples[frameEnd].Time == time)
+		{
+			frameEnd++;
+		}
+
+		for (j = frameStart; j < frameEnd; j++)
+		{
+			unsigned int id = Trace->Samples[j].Id;
+
+			if (id > 255)
+			{
+				continue;
+			}
+			if (last[id] != NO_SAMPLE)
+			{
+				Trace->Samples[last[id]].Next = j;
+			}
+			last[id] = j;
+			present[id] = 1;
+		}
+
+		for (j = 0; j < 256; j++)
+		{
+			if (!present[j])
+			{
+				last[j] = NO_SAMPLE;
+			}
+		}
+
+		frameStart = frameEnd;
+	}
+}
+
+static int
+LoadTrace(const char *Path, TRACE *Trace)
+{
+	FILE *file = fopen(Path, "r");
+	char line[256];
+
+	if (file == NULL)
+	{
+		fprintf(stderr, "cannot open %s\n", Path);
+		return 0;
+	}
+
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		unsigned long long time;
+		int id;
+		double x;
+		double y;
+		int fields = sscanf(line, "%llu %d %lf %lf", &time, &id, &x, &y);
+
+		if (fields == 4)
+		{
+			if (!AddSample(Trace, time, id, x, y))
+			{
+				break;
+			}
+		}
+		else if (fields == 1)
+		{
+			// Empty frame, recorded with an id no stroke uses.
+			if (!AddSample(Trace, time, 256, 0, 0))
+			{
+				break;
+			}
+		}
+	}
+
+	fclose(file);
+	return Trace->Count != 0;
+}
+
+static double
+Noise(void)
+{
+	return ((rand() % 1000) + (rand() % 1000) + (rand() % 1000) - 1498.5) / 500.0;
+}
+
+//
+// Drags along circles and flings along straight lines at 120Hz, about
+// two pixels of noise, with gaps between the strokes.
+//
+static void
+GenerateTrace(TRACE *Trace)
+{
+	const double period = 8333;
+	unsigned long long time = 1000000;
+	int stroke;
+	int frame;
+
+	srand(1);
+
+	for (stroke = 0; stroke < 40; stroke++)
+	{
+		int frames = 30 + (stroke % 5) * 20;
+		double speed = 0.2 + (stroke % 7) * 0.25;
+
+		for (frame = 0; frame < frames; frame++)
+		{
+			double t = frame * period / 1000.0;
+			double x;
+			double y;
+
+			if (stroke & 1)
+			{
+				double angle = speed * t / 300.0;
+
+				x = 640 + 300 * cos(angle);
+				y = 400 + 300 * sin(angle);
+			}
+			else
+			{
+				//
+				// Fling: accelerates, then slows down.
+				//
+				double s = speed * t * (1.0 - t / (2.0 * frames * period / 1000.0));
+
+				x = 100 + s * 0.8;
+				y = 700 - s * 0.6;
+			}
+
+			AddSample(Trace, time, stroke % 10, x + Noise(), y + Noise());
+			time += (unsigned long long)period;
+		}
+
+		AddSample(Trace, time, 256, 0, 0);
+		time += 200000;
+	}
+}
+
+//
+// Where the finger of sample Index was at Time, interpolated, or 0 when
+// the stroke had ended by then.
+//
+static int
+TruePosition(const TRACE *Trace, int Index, unsigned long long Time, double *X, double *Y)
+{
+	const SAMPLE *prev = &Trace->Samples[Index];
+
+	for (;;)
+	{
+		const SAMPLE *next;
+		double f;
+
+		if (prev->Time == Time)
+		{
+			*X = prev->X;
+			*Y = prev->Y;
+			return 1;
+		}
+		if (prev->Next == NO_SAMPLE)
+		{
+			return 0;
+		}
+
+		next = &Trace->Samples[prev->Next];
+		if (next->Time >= Time)
+		{
+			f = (double)(Time - prev->Time) / (double)(next->Time - prev->Time);
+			*X = prev->X + (next->X - prev->X) * f;
+			*Y = prev->Y + (next->Y - prev->Y) * f;
+			return 1;
+		}
+		prev = next;
+	}
+}
+
+static unsigned short
+Coordinate(double Value)
+{
+	if (Value < 0)
+	{
+		return 0;
+	}
+	if (Value > 65535)
+	{
+		return 65535;
+	}
+	return (unsigned short)(Value + 0.5);
+}
+
+//
+// Replays the trace with the given filter and returns the RMS error of
+// the reported positions against the positions HorizonUs later.
+//
+static double
+Replay(const TRACE *Trace, const TOUCH_FILTER_CONFIG *Config, unsigned int HorizonUs,
+	int UseReported, unsigned int *Samples)
+{
+	static TOUCH_TRACKER tracker;
+	unsigned char report[TOUCH_REPORT_LENGTH(TOUCH_MAX_CONTACTS)];
+	double sum = 0;
+	unsigned int count = 0;
+	int frameStart = 0;
+
+	TouchTrackerInitialize(&tracker, 1, TOUCH_MAX_CONTACTS);
+	TouchTrackerSetFilter(&tracker, Config);
+
+	while (frameStart < Trace->Count)
+	{
+		TOUCH_POINT points[TOUCH_MAX_CONTACTS];
+		int indexes[TOUCH_MAX_CONTACTS];
+		unsigned long long time = Trace->Samples[frameStart].Time;
+		unsigned int pointCount = 0;
+		int frameEnd = frameStart;
+		int j;
+
+		while (frameEnd < Trace->Count && Trace->Samples[frameEnd].Time == time)
+		{
+			const SAMPLE *sample = &Trace->Samples[frameEnd];
+
+			if (sample->Id <= 255 && pointCount < TOUCH_MAX_CONTACTS)
+			{
+				points[pointCount].Id = (unsigned char)sample->Id;
+				points[pointCount].X = Coordinate(sample->X);
+				points[pointCount].Y = Coordinate(sample->Y);
+				indexes[pointCount] = frameEnd;
+				pointCount++;
+			}
+			frameEnd++;
+		}
+
+		TouchTrackerSetFrameTimes(&tracker, time, time);
+		TouchTrackerUpdate(&tracker, points, pointCount, 0);
+
+		while (TouchTrackerNextReport(&tracker, report, sizeof(report)) != 0)
+		{
+			unsigned char *contact = &report[1];
+			unsigned int c;
+
+			for (c = 0; c < TOUCH_MAX_CONTACTS; c++, contact += TOUCH_CONTACT_LENGTH)
+			{
+				unsigned int slot = contact[1];
+				double x = contact[2] | (contact[3] << 8);
+				double y = contact[4] | (contact[5] << 8);
+				double trueX;
+				double trueY;
+
+				if (!(contact[0] & 1) || slot >= TOUCH_MAX_CONTACTS)
+				{
+					continue;
+				}
+
+				for (j = 0; j < (int)pointCount; j++)
+				{
+					if (points[j].Id == tracker.Slots[slot].ControllerId)
+					{
+						break;
+					}
+				}
+				if (j == (int)pointCount ||
+					!TruePosition(Trace, indexes[j], time + HorizonUs, &trueX, &trueY))
+				{
+					continue;
+				}
+
+				if (!UseReported)
+				{
+					x = Trace->Samples[indexes[j]].X;
+					y = Trace->Samples[indexes[j]].Y;
+				}
+
+				sum += (x - trueX) * (x - trueX) + (y - trueY) * (y - trueY);
+				count++;
+			}
+		}
+
+		frameStart = frameEnd;
+	}
+
+	*Samples = count;
+	return count ? sqrt(sum / count) : 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	TRACE trace;
+	TOUCH_FILTER_CONFIG config;
+	const char *path = NULL;
+	int synthetic = 0;
+	unsigned int i;
+	int a;
+
+	config.Alpha = 160;
+	config.Beta = 48;
+	config.HorizonUs = 0;
+	config.MaxDistance = 0;
+
+	for (a = 1; a < argc; a++)
+	{
+		if (strcmp(argv[a], "-s") == 0)
+		{
+			synthetic = 1;
+		}
+		else if (a + 1 < argc && strcmp(argv[a], "-a") == 0)
+		{
+			config.Alpha = (unsigned int)strtoul(argv[++a], NULL, 0);
+		}
+		else if (a + 1 < argc && strcmp(argv[a], "-b") == 0)
+		{
+			config.Beta = (unsigned int)strtoul(argv[++a], NULL, 0);
+		}
+		else if (a + 1 < argc && strcmp(argv[a], "-d") == 0)
+		{
+			config.MaxDistance = (unsigned int)strtoul(argv[++a], NULL, 0);
+		}
+		else
+		{
+			path = argv[a];
+		}
+	}
+
+	if (!synthetic && path == NULL)
+	{
+		fprintf(stderr, "usage: touchpredict [-a alpha] [-b beta] [-d maxdistance] trace.txt | -s\n");
+		return 1;
+	}
+
+	trace.Count = 0;
+	trace.Samples = malloc(MAX_SAMPLES * sizeof(SAMPLE));
+	if (trace.Samples == NULL)
+	{
+		return 1;
+	}
+
+	if (synthetic)
+	{
+		GenerateTrace(&trace);
+	}
+	else if (!LoadTrace(path, &trace))
+	{
+		free(trace.Samples);
+		return 1;
+	}
+
+	LinkStrokes(&trace);
+
+	printf("alpha %u/256, beta %u/256, max distance %u\n",
+		config.Alpha, config.Beta, config.MaxDistance);
+	printf("%10s %9s %9s %9s\n", "horizon ms", "samples", "raw rms", "rms");
+
+	for (i = 0; i < sizeof(DefaultHorizonsMs) / sizeof(DefaultHorizonsMs[0]); i++)
+	{
+		unsigned int horizonUs = DefaultHorizonsMs[i] * 1000;
+		unsigned int samples;
+		double raw;
+		double filtered;
+
+		config.HorizonUs = horizonUs;
+		raw = Replay(&trace, &config, horizonUs, 0, &samples);
+		filtered = Replay(&trace, &config, horizonUs, 1, &samples);
+
+		printf("%10u %9u %9.2f %9.2f\n", DefaultHorizonsMs[i], samples, raw, filtered);
+	}
+
+	free(trace.Samples);
+	return 0;
+}
@@ -0,0 +1,548 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	touchreporttest.c
+
+Abstract:
+
+	Host test and benchmark of the contact tracker (touchreport.c).
+
+	The test replays register dumps captured from the four controllers,
+	parsed into TOUCH_POINTs the way their drivers parse them, and
+	compares every frame's reports with the contacts expected in them.
+	Each replay runs with the driver's contacts per report and again
+	with two, so frames are split over several reports in hybrid mode.
+	Besides the contacts, every report must carry the report id and
+	the frame's scan time, the contact count in the first report of a
+	frame only, and zeroed unused contacts. The dumps cover:
+
+		gt9xx   a second finger joins, the first lifts, a new finger
+		        takes the freed slot, a frame nobody read is replaced
+		        and its contact still lifts
+		ft5x    the controller lists its contacts in another order
+		gt82x   contact bitmap with a checksum, a frame with a bad
+		        checksum is dropped by the driver
+		silead  five fingers, one lifts, a new one takes its slot
+
+	The benchmark then feeds ten moving contacts through the tracker
+	and prints reports per second, with and without the contact
+	filter, for one report per frame and for hybrid mode.
+
+	Build and run on any host with a C compiler, it returns nonzero
+	when a check fails:
+
+		cc -O2 -I.. -o touchreporttest touchreporttest.c ../touchreport.c
+		touchreporttest [-n frames]
+
+Environment:
+
+	user mode
+
+--*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "touchreport.h"
+
+#define MAX_DUMP			64
+#define NO_FRAME			(-1)
+#define SCAN_STEP			125
+
+//
+// A register dump as read by the driver and the contacts expected in
+// the reports of its frame, "tip:id:x:y" each in report order, then
+// "#count". NULL when the driver does not hand the dump to the
+// tracker, "" when the frame has no report.
+//
+typedef struct _REPLAY_FRAME
+{
+	const char *Dump;
+	const char *Expected;
+
+	// No read request is pending, the frame's reports are not taken.
+	int NoRead;
+}REPLAY_FRAME;
+
+typedef int PARSE_DUMP(const unsigned char *Data, unsigned int Length, TOUCH_POINT *Points);
+
+typedef struct _REPLAY
+{
+	const char *Name;
+	PARSE_DUMP *Parse;
+	unsigned int ReportContacts;
+	const REPLAY_FRAME *Frames;
+	unsigned int FrameCount;
+	unsigned int DroppedFrames;
+}REPLAY;
+
+static unsigned int Failures;
+
+//
+// Keeps the benchmark's reports from being optimized away.
+//
+static volatile unsigned int Sink;
+
+static void
+Check(int Condition, const char *Case, unsigned int Frame, const char *What)
+{
+	if (!Condition)
+	{
+		printf("FAIL %s frame %u: %s\n", Case, Frame, What);
+		Failures++;
+	}
+}
+
+//
+// ------------------------------------------------------------- Controllers
+//
+
+//
+// Gt9xx: status at 0x814E, bit 7 ready, bits 0-3 contacts, 8 byte
+// records of id, X, Y (16 bit little endian) and size.
+//
+static int
+ParseGt9xx(const unsigned char *Data, unsigned int Length, TOUCH_POINT *Points)
+{
+	unsigned int count;
+	unsigned int i;
+
+	if ((Length < 1) || ((Data[0] & 0x80) == 0))
+	{
+		return NO_FRAME;
+	}
+
+	count = Data[0] & 0x0f;
+	for (i = 0; (i < count) && (1 + (i + 1) * 8 <= Length); i++)
+	{
+		const unsigned char *record = &Data[1 + i * 8];
+
+		Points[i].Id = record[0] & 0x0f;
+		Points[i].X = (unsigned short)(record[1] | (record[2] << 8));
+		Points[i].Y = (unsigned short)(record[3] | (record[4] << 8));
+	}
+
+	return (int)i;
+}
+
+//
+// Ft5x: registers from 0x00, TD_STATUS at 0x02, 6 byte points from 0x03
+// with the id in the high nibble of YH, mirrored to the screen.
+//
+static int
+ParseFt5x(const unsigned char *Data, unsigned int Length, TOUCH_POINT *Points)
+{
+	unsigned int count;
+	unsigned int i;
+
+	if (Length < 3)
+	{
+		return NO_FRAME;
+	}
+
+	count = Data[2] & 0x07;
+	if (count > 5)
+	{
+		count = 5;
+	}
+
+	for (i = 0; (i < count) && (3 + (i + 1) * 6 <= Length); i++)
+	{
+		const unsigned char *point = &Data[3 + i * 6];
+
+		Points[i].Id = (point[2] & 0xf0) >> 4;
+		Points[i].X = (unsigned short)(1280 - ((point[0] & 0x0f) << 8 | point[1]));
+		Points[i].Y = (unsigned short)(800 - ((point[2] & 0x0f) << 8 | point[3]));
+	}
+
+	return (int)i;
+}
+
+//
+// Gt82x: contact bitmap, a reserved byte, 5 byte points (X, Y big
+// endian, pressure) and their checksum, rotated to the screen. The id
+// is the contact's bit.
+//
+static int
+ParseGt82x(const unsigned char *Data, unsigned int Length, TOUCH_POINT *Points)
+{
+	const unsigned char *coor = &Data[2];
+	unsigned char sum = 0;
+	unsigned int count = 0;
+	unsigned int i;
+
+	if (Length < 2)
+	{
+		return NO_FRAME;
+	}
+
+	for (i = 0; i < 5; i++)
+	{
+		if (Data[0] & (1 << i))
+		{
+			count++;
+		}
+	}
+
+	if (count != 0)
+	{
+		if (2 + count * 5 + 1 > Length)
+		{
+			return NO_FRAME;
+		}
+		for (i = 0; i < count * 5; i++)
+		{
+			sum += coor[i];
+		}
+		if (sum != coor[count * 5])
+		{
+			return NO_FRAME;
+		}
+	}
+
+	count = 0;
+	for (i = 0; i < 5; i++)
+	{
+		if (!(Data[0] & (1 << i)))
+		{
+			continue;
+		}
+
+		Points[count].Id = (unsigned char)i;
+		Points[count].X = (unsigned short)(1280 - ((coor[2] << 8) | coor[3]));
+		Points[count].Y = (unsigned short)(800 - ((coor[0] << 8) | coor[1]));
+		count++;
+		coor += 5;
+	}
+
+	return (int)count;
+}
+
+//
+// Silead, firmware with ids: contacts at 0x80, 4 byte points from 0x84
+// of Y (16 bit little endian), X low and id:X high, mirrored.
+//
+static int
+ParseSilead(const unsigned char *Data, unsigned int Length, TOUCH_POINT *Points)
+{
+	unsigned int count;
+	unsigned int i;
+
+	if (Length < 4)
+	{
+		return NO_FRAME;
+	}
+
+	count = Data[0];
+	if (count > TOUCH_MAX_CONTACTS)
+	{
+		count = TOUCH_MAX_CONTACTS;
+	}
+
+	for (i = 0; (i < count) && (4 + (i + 1) * 4 <= Length); i++)
+	{
+		const unsigned char *point = &Data[4 + i * 4];
+
+		Points[i].Id = (point[3] >> 4) & 0x0f;
+		Points[i].X = (unsigned short)(800 - ((point[3] & 0x0f) * 256 + point[2]));
+		Points[i].Y = (unsigned short)(1280 - (point[1] * 256 + point[0]));
+	}
+
+	return (int)i;
+}
+
+//
+// ------------------------------------------------------------------ Dumps
+//
+
+static const REPLAY_FRAME Gt9xxFrames[] =
+{
+	{ "81 00 20 01 40 01 18 00 00", "1:0:288:320 #1", 0 },
+	{ "82 00 24 01 44 01 18 00 00 01 00 03 58 02 18 00 00", "1:0:292:324 1:1:768:600 #2", 0 },
+	{ "81 01 08 03 5C 02 18 00 00", "0:0:292:324 1:1:776:604 #2", 0 },
+	{ "81 01 10 03 60 02 18 00 00", "1:1:784:608 #1", 0 },
+	{ "80", "0:1:784:608 #1", 0 },
+	{ "80", "", 0 },
+	{ "00", NULL, 0 },
+	{ "81 03 00 02 00 02 18 00 00", "1:0:512:512 #1", 0 },
+	{ "81 03 08 02 08 02 18 00 00", "1:0:520:520 #1", 1 },
+	{ "80", "0:0:520:520 #1", 0 },
+	{ "80", "", 0 },
+};
+
+static const REPLAY_FRAME Ft5xFrames[] =
+{
+	{ "00 00 02 80 64 00 C8 00 00 80 C8 10 90 00 00", "1:0:1180:600 1:1:1080:656 #2", 0 },
+	{ "00 00 02 80 D2 10 9A 00 00 80 6E 00 D2 00 00", "1:0:1170:590 1:1:1070:646 #2", 0 },
+	{ "00 00 00", "0:0:1170:590 0:1:1070:646 #2", 0 },
+	{ "00 00 00", "", 0 },
+};
+
+static const REPLAY_FRAME Gt82xFrames[] =
+{
+	{ "01 00 00 C8 01 2C 10 05", "1:0:980:600 #1", 0 },
+	{ "05 00 00 D2 01 36 10 02 58 03 20 10 A6", "1:0:970:590 1:1:480:200 #2", 0 },
+	{ "05 00 00 DC 01 40 10 02 62 03 2A 10 A6", NULL, 0 },
+	{ "04 00 02 5A 03 22 10 91", "0:0:970:590 1:1:478:198 #2", 0 },
+	{ "00 00", "0:1:478:198 #1", 0 },
+};
+
+static const REPLAY_FRAME SileadFrames[] =
+{
+	{ "05 00 00 00 C8 00 64 10 2C 01 C8 20 90 01 2C 31 F4 01 90 41 58 02 F4 51",
+		"1:0:700:1080 1:1:600:980 1:2:500:880 1:3:400:780 1:4:300:680 #5", 0 },
+	{ "04 00 00 00 C8 00 6E 10 2C 01 D2 20 F4 01 9A 41 58 02 FE 51",
+		"1:0:690:1080 1:1:590:980 0:2:500:880 1:3:390:780 1:4:290:680 #5", 0 },
+	{ "02 00 00 00 C8 00 6E 10 64 00 32 60",
+		"1:0:690:1080 0:1:590:980 1:2:750:1180 0:3:390:780 0:4:290:680 #5", 0 },
+	{ "00 00 00 00", "0:0:690:1080 0:2:750:1180 #2", 0 },
+	{ "00 00 00 00", "", 0 },
+};
+
+static const REPLAY Replays[] =
+{
+	{ "gt9xx", ParseGt9xx, 10, Gt9xxFrames, sizeof(Gt9xxFrames) / sizeof(Gt9xxFrames[0]), 1 },
+	{ "ft5x", ParseFt5x, 5, Ft5xFrames, sizeof(Ft5xFrames) / sizeof(Ft5xFrames[0]), 0 },
+	{ "gt82x", ParseGt82x, 5, Gt82xFrames, sizeof(Gt82xFrames) / sizeof(Gt82xFrames[0]), 0 },
+	{ "silead", ParseSilead, 10, SileadFrames, sizeof(SileadFrames) / sizeof(SileadFrames[0]), 0 },
+};
+
+//
+// ----------------------------------------------------------------- Replay
+//
+
+static unsigned int
+ParseHex(const char *Text, unsigned char *Data)
+{
+	unsigned int length = 0;
+	char *end;
+
+	while (length < MAX_DUMP)
+	{
+		unsigned long value = strtoul(Text, &end, 16);
+
+		if (end == Text)
+		{
+			break;
+		}
+		Data[length++] = (unsigned char)value;
+		Text = end;
+	}
+
+	return length;
+}
+
+//
+// Appends "tip:id:x:y " for every used contact of a report.
+//
+static void
+AppendContacts(char *Text, size_t Size, const unsigned char *Report, unsigned int Contacts)
+{
+	unsigned int i;
+
+	for (i = 0; i < Contacts; i++)
+	{
+		const unsigned char *contact = &Report[1 + i * TOUCH_CONTACT_LENGTH];
+		size_t used = strlen(Text);
+
+		snprintf(Text + used, Size - used, "%u:%u:%u:%u ",
+			contact[0], contact[1],
+			contact[2] | (contact[3] << 8),
+			contact[4] | (contact[5] << 8));
+	}
+}
+
+static void
+Replay(const REPLAY *Replay, unsigned int ReportContacts)
+{
+	TOUCH_TRACKER tracker;
+	TOUCH_POINT points[TOUCH_MAX_CONTACTS];
+	unsigned char data[MAX_DUMP];
+	unsigned char report[TOUCH_REPORT_LENGTH(TOUCH_MAX_CONTACTS)];
+	char name[32];
+	char text[256];
+	unsigned short scanTime = 0;
+	unsigned int f;
+
+	snprintf(name, sizeof(name), "%s/%u", Replay->Name, ReportContacts);
+	TouchTrackerInitialize(&tracker, 0x01, ReportContacts);
+
+	for (f = 0; f < Replay->FrameCount; f++)
+	{
+		const REPLAY_FRAME *frame = &Replay->Frames[f];
+		unsigned int length = ParseHex(frame->Dump, data);
+		unsigned int reports;
+		unsigned int left;
+		unsigned int r;
+		int count;
+
+		count = Replay->Parse(data, length, points);
+		if (count == NO_FRAME)
+		{
+			Check(frame->Expected == NULL, name, f, "dump rejected");
+			continue;
+		}
+		Check(frame->Expected != NULL, name, f, "dump accepted");
+
+		scanTime = (unsigned short)(scanTime + SCAN_STEP);
+		reports = TouchTrackerUpdate(&tracker, points, (unsigned int)count, scanTime);
+		if (frame->NoRead)
+		{
+			continue;
+		}
+
+		//
+		// Take every report of the frame and check its framing, the
+		// contacts are compared all together.
+		//
+		text[0] = '\0';
+		left = tracker.FrameContacts;
+		for (r = 0; r < reports; r++)
+		{
+			unsigned int contacts = (left < ReportContacts) ? left : ReportContacts;
+			const unsigned char *tail = &report[1 + ReportContacts * TOUCH_CONTACT_LENGTH];
+			unsigned int i;
+
+			memset(report, 0xcc, sizeof(report));
+			Check(TouchTrackerNextReport(&tracker, report, sizeof(report)) == TOUCH_REPORT_LENGTH(ReportContacts),
+				name, f, "report length");
+			Check(report[0] == 0x01, name, f, "report id");
+			Check((tail[0] | (tail[1] << 8)) == scanTime, name, f, "scan time in every report");
+			Check(tail[2] == ((r == 0) ? tracker.FrameContacts : 0), name, f, "contact count in the first report only");
+			for (i = contacts * TOUCH_CONTACT_LENGTH; i < ReportContacts * TOUCH_CONTACT_LENGTH; i++)
+			{
+				Check(report[1 + i] == 0, name, f, "unused contacts zeroed");
+			}
+
+			AppendContacts(text, sizeof(text), report, contacts);
+			left -= contacts;
+		}
+		Check(TouchTrackerNextReport(&tracker, report, sizeof(report)) == 0, name, f, "no report past the frame");
+
+		if (reports != 0)
+		{
+			size_t used = strlen(text);
+
+			snprintf(text + used, sizeof(text) - used, "#%u", tracker.FrameContacts);
+		}
+
+		if (strcmp(text, frame->Expected) != 0)
+		{
+			printf("FAIL %s frame %u: reported \"%s\", expected \"%s\"\n", name, f, text, frame->Expected);
+			Failures++;
+		}
+	}
+
+	Check(tracker.DroppedFrames == Replay->DroppedFrames, name, f, "dropped frames");
+	Check(tracker.Overflows == 0, name, f, "no overflow");
+}
+
+//
+// -------------------------------------------------------------- Benchmark
+//
+
+static void
+Benchmark(unsigned int Frames, unsigned int ReportContacts, int Filter)
+{
+	static const TOUCH_FILTER_CONFIG filter = { 128, 32, 8000, 64 };
+	TOUCH_TRACKER tracker;
+	TOUCH_POINT points[TOUCH_MAX_CONTACTS];
+	unsigned char report[TOUCH_REPORT_LENGTH(TOUCH_MAX_CONTACTS)];
+	unsigned int f;
+	unsigned int i;
+	clock_t start;
+	double seconds;
+
+	TouchTrackerInitialize(&tracker, 0x01, ReportContacts);
+	if (Filter)
+	{
+		TouchTrackerSetFilter(&tracker, &filter);
+	}
+
+	start = clock();
+	for (f = 0; f < Frames; f++)
+	{
+		//
+		// Ten fingers drawing circles, one of them lifts every 64
+		// frames for a frame.
+		//
+		for (i = 0; i < TOUCH_MAX_CONTACTS; i++)
+		{
+			points[i].Id = (unsigned char)i;
+			points[i].X = (unsigned short)(100 + i * 100 + (f & 63));
+			points[i].Y = (unsigned short)(400 + ((f + i * 16) & 63));
+		}
+
+		TouchTrackerUpdate(&tracker, points,
+			((f & 63) == 0) ? TOUCH_MAX_CONTACTS - 1 : TOUCH_MAX_CONTACTS,
+			(unsigned short)(f * SCAN_STEP));
+		while (tracker.PendingReports != 0)
+		{
+			Sink += TouchTrackerNextReport(&tracker, report, sizeof(report));
+			Sink += report[1 + TOUCH_CONTACT_LENGTH / 2];
+		}
+	}
+	seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	printf("%2u contacts per report, filter %-3s %9u reports %12.0f reports/s\n",
+		ReportContacts, Filter ? "on" : "off", tracker.Reports,
+		(seconds > 0) ? tracker.Reports / seconds : 0.0);
+}
+
+int
+main(int argc, char **argv)
+{
+	unsigned int frames = 2000000;
+	unsigned int i;
+
+	if ((argc == 3) && (strcmp(argv[1], "-n") == 0))
+	{
+		frames = (unsigned int)strtoul(argv[2], NULL, 0);
+	}
+	else if (argc != 1)
+	{
+		fprintf(stderr, "usage: %s [-n frames]\n", argv[0]);
+		return 1;
+	}
+
+	for (i = 0; i < sizeof(Replays) / sizeof(Replays[0]); i++)
+	{
+		Replay(&Replays[i], Replays[i].ReportContacts);
+		Replay(&Replays[i], 2);
+	}
+
+	Benchmark(frames, TOUCH_MAX_CONTACTS, 0);
+	Benchmark(frames, TOUCH_MAX_CONTACTS, 1);
+	Benchmark(frames, 2, 0);
+	Benchmark(frames, 2, 1);
+
+	if (Failures != 0)
+	{
+		printf("%u checks failed\n", Failures);
+		return 1;
+	}
+
+	printf("all checks passed\n");
+	return 0;
+}
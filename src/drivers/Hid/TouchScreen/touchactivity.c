@@ -0,0 +1,235 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	touchactivity.c
+
+Abstract:
+
+	Scan rate state machine, see touchactivity.h. Apart from
+	TouchActivityReadConfig it uses no kernel or runtime services so the
+	host test builds it as well.
+
+Environment:
+
+	kernel mode, and user mode for the host test
+
+--*/
+
+#ifdef _KERNEL_MODE
+#include <ntddk.h>
+#include <wdf.h>
+#endif
+
+#include "touchactivity.h"
+
+void
+TouchActivityInitialize(
+	PTOUCH_ACTIVITY Activity,
+	unsigned int QuietMs
+	)
+{
+	unsigned int mode;
+
+	//
+	// No mode until the first start, the time before it is not
+	// accounted.
+	//
+	Activity->Mode = TouchModes;
+	Activity->LastActivity = 0;
+	Activity->ModeStart = 0;
+
+	for (mode = 0; mode < TouchModes; mode++) {
+		Activity->ModeMs[mode] = 0;
+	}
+	Activity->DozeEntries = 0;
+	Activity->DozeExits = 0;
+	Activity->DozeFailures = 0;
+
+	TouchActivitySetQuietTime(Activity, QuietMs);
+}
+
+void
+TouchActivitySetQuietTime(
+	PTOUCH_ACTIVITY Activity,
+	unsigned int QuietMs
+	)
+{
+	if ((QuietMs != 0) && (QuietMs < TOUCH_ACTIVITY_MIN_QUIET_MS)) {
+		QuietMs = TOUCH_ACTIVITY_MIN_QUIET_MS;
+	}
+
+	Activity->QuietMs = QuietMs;
+}
+
+void
+TouchActivityAccount(
+	PTOUCH_ACTIVITY Activity,
+	unsigned int Now
+	)
+{
+	if (Activity->Mode < TouchModes) {
+		Activity->ModeMs[Activity->Mode] += (unsigned int)(Now - Activity->ModeStart);
+	}
+	Activity->ModeStart = Now;
+}
+
+static void
+TouchActivitySetMode(
+	PTOUCH_ACTIVITY Activity,
+	unsigned int Mode,
+	unsigned int Now
+	)
+{
+	TouchActivityAccount(Activity, Now);
+	Activity->Mode = Mode;
+}
+
+void
+TouchActivityStart(
+	PTOUCH_ACTIVITY Activity,
+	unsigned int Now
+	)
+{
+	TouchActivitySetMode(Activity, TouchModeActive, Now);
+	Activity->LastActivity = Now;
+}
+
+void
+TouchActivityStop(
+	PTOUCH_ACTIVITY Activity,
+	unsigned int Now
+	)
+{
+	TouchActivitySetMode(Activity, TouchModeOff, Now);
+}
+
+int
+TouchActivityInterrupt(
+	PTOUCH_ACTIVITY Activity,
+	unsigned int Now
+	)
+{
+	Activity->LastActivity = Now;
+
+	if (Activity->Mode != TouchModeDoze) {
+		return 0;
+	}
+
+	TouchActivitySetMode(Activity, TouchModeActive, Now);
+	Activity->DozeExits++;
+	return 1;
+}
+
+int
+TouchActivityDozeDue(
+	PTOUCH_ACTIVITY Activity,
+	unsigned int Now,
+	unsigned int *WaitMs
+	)
+{
+	unsigned int quiet;
+
+	*WaitMs = 0;
+
+	if ((Activity->Mode != TouchModeActive) || (Activity->QuietMs == 0)) {
+		return 0;
+	}
+
+	quiet = Now - Activity->LastActivity;
+	if (quiet < Activity->QuietMs) {
+		*WaitMs = Activity->QuietMs - quiet;
+		return 0;
+	}
+
+	return 1;
+}
+
+void
+TouchActivityDozeEntered(
+	PTOUCH_ACTIVITY Activity,
+	unsigned int Now,
+	int Ok
+	)
+{
+	if (!Ok) {
+		//
+		// Try again after another quiet period rather than hammering a
+		// panel that did not take the command.
+		//
+		Activity->DozeFailures++;
+		Activity->LastActivity = Now;
+		return;
+	}
+
+	TouchActivitySetMode(Activity, TouchModeDoze, Now);
+	Activity->DozeEntries++;
+}
+
+#ifdef _KERNEL_MODE
+
+VOID
+TouchActivityReadConfig(
+	_In_ WDFDEVICE Device,
+	_Inout_ PTOUCH_ACTIVITY Activity
+	)
+/*++
+
+Routine Description:
+
+	Reads the quiet period before the panel dozes from the device key,
+	the panel stays at full rate when DozeQuietMs is not set.
+
+Arguments:
+
+	Device - handle to the touch device.
+
+	Activity - the scan rate state.
+
+Return Value:
+
+	None
+
+--*/
+{
+	WDFKEY key = NULL;
+	ULONG value = 0;
+	NTSTATUS status;
+
+	DECLARE_CONST_UNICODE_STRING(quietName, L"DozeQuietMs");
+
+	status = WdfDeviceOpenRegistryKey(Device,
+		PLUGPLAY_REGKEY_DEVICE,
+		KEY_READ,
+		WDF_NO_OBJECT_ATTRIBUTES,
+		&key);
+
+	if (NT_SUCCESS(status)) {
+		if (!NT_SUCCESS(WdfRegistryQueryULong(key, &quietName, &value))) {
+			value = 0;
+		}
+		WdfRegistryClose(key);
+	}
+
+	TouchActivitySetQuietTime(Activity, value);
+}
+
+#endif
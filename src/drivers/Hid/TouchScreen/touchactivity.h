@@ -0,0 +1,157 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	touchactivity.h
+
+Abstract:
+
+	Scan rate management shared by the touch screen drivers. While the
+	device is in D0 the panel runs at its full report rate until no
+	interrupt arrived for QuietMs, then the driver drops it to its
+	low scan (doze) mode. The controller still interrupts on a touch in
+	that mode, and the driver restores the full rate from the ISR of
+	that first interrupt, before it reads the frame.
+
+	The driver calls, with its interrupt lock held:
+
+		TouchActivityStart - D0 entry, the panel runs at full rate.
+		TouchActivityStop - D0 exit.
+		TouchActivityInterrupt - every interrupt. Returns nonzero when
+			the panel dozes and has to be switched back to full rate.
+		TouchActivityDozeDue - from its doze timer. Returns nonzero when
+			the panel should doze now, otherwise the time until it
+			should be asked again, 0 for never.
+		TouchActivityDozeEntered - after switching the panel to doze,
+			with whether the switch worked.
+
+	The time spent in each mode and the number of transitions are kept
+	for the driver to log. Times are in ms from any free running clock
+	and may wrap.
+
+	tools\touchactivitytest runs the state machine against simulated
+	touch activity on the host.
+
+Environment:
+
+	kernel mode, and user mode for the host test
+
+--*/
+
+#ifndef _TOUCHACTIVITY_H_
+#define _TOUCHACTIVITY_H_
+
+//
+// Quiet period before the panel dozes, from DozeQuietMs in the device
+// key. 0 keeps the panel at full rate, shorter periods are raised to
+// TOUCH_ACTIVITY_MIN_QUIET_MS so the panel does not doze between the
+// frames of a touch.
+//
+#define TOUCH_ACTIVITY_MIN_QUIET_MS		100
+
+typedef enum _TOUCH_POWER_MODE {
+	TouchModeActive = 0,
+	TouchModeDoze,
+	TouchModeOff,
+	TouchModes
+} TOUCH_POWER_MODE;
+
+typedef struct _TOUCH_ACTIVITY {
+	unsigned int QuietMs;
+	unsigned int Mode;
+	unsigned int LastActivity;
+	unsigned int ModeStart;
+
+	//
+	// Statistics: ms spent in each mode, transitions into and out of
+	// doze and switches to doze the panel rejected.
+	//
+	unsigned long long ModeMs[TouchModes];
+	unsigned int DozeEntries;
+	unsigned int DozeExits;
+	unsigned int DozeFailures;
+} TOUCH_ACTIVITY, *PTOUCH_ACTIVITY;
+
+void
+TouchActivityInitialize(
+	PTOUCH_ACTIVITY Activity,
+	unsigned int QuietMs
+	);
+
+void
+TouchActivitySetQuietTime(
+	PTOUCH_ACTIVITY Activity,
+	unsigned int QuietMs
+	);
+
+void
+TouchActivityStart(
+	PTOUCH_ACTIVITY Activity,
+	unsigned int Now
+	);
+
+void
+TouchActivityStop(
+	PTOUCH_ACTIVITY Activity,
+	unsigned int Now
+	);
+
+int
+TouchActivityInterrupt(
+	PTOUCH_ACTIVITY Activity,
+	unsigned int Now
+	);
+
+int
+TouchActivityDozeDue(
+	PTOUCH_ACTIVITY Activity,
+	unsigned int Now,
+	unsigned int *WaitMs
+	);
+
+void
+TouchActivityDozeEntered(
+	PTOUCH_ACTIVITY Activity,
+	unsigned int Now,
+	int Ok
+	);
+
+//
+// Adds the time since the last transition to the current mode, so
+// ModeMs is up to date.
+//
+void
+TouchActivityAccount(
+	PTOUCH_ACTIVITY Activity,
+	unsigned int Now
+	);
+
+#ifdef _KERNEL_MODE
+
+VOID
+TouchActivityReadConfig(
+	_In_ WDFDEVICE Device,
+	_Inout_ PTOUCH_ACTIVITY Activity
+	);
+
+#endif
+
+#endif
@@ -0,0 +1,874 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	touchreport.c
+
+Abstract:
+
+	Contact tracking and HID input report packing, see touchreport.h.
+	Apart from TouchTrackerReadFilterConfig it uses no kernel or runtime
+	services so it can be built on the host to replay captured
+	controller data.
+
+Environment:
+
+	kernel mode, and user mode for replaying register dumps
+
+--*/
+
+#ifdef _KERNEL_MODE
+#include <ntddk.h>
+#include <wdf.h>
+#endif
+
+#include "touchreport.h"
+
+typedef char TOUCH_LATENCY_REPORT_LENGTH_CHECK[
+	(sizeof(TOUCH_LATENCY_REPORT) == TOUCH_LATENCY_REPORT_LENGTH) ? 1 : -1];
+
+static void
+TouchLatencyRecord(
+	PTOUCH_LATENCY_HISTOGRAM Histogram,
+	unsigned long long Start,
+	unsigned long long End
+	)
+{
+	unsigned long long us;
+	unsigned int bucket;
+
+	if ((Start == 0) || (End < Start)) {
+		return;
+	}
+
+	us = End - Start;
+	if (us > 0xffffffff) {
+		us = 0xffffffff;
+	}
+
+	for (bucket = 0; bucket < TOUCH_LATENCY_BUCKETS - 1; bucket++) {
+		if (us < (1ULL << (TOUCH_LATENCY_BASE_SHIFT + bucket))) {
+			break;
+		}
+	}
+
+	Histogram->Count++;
+	Histogram->TotalUs += us;
+	Histogram->Buckets[bucket]++;
+	if (us > Histogram->MaxUs) {
+		Histogram->MaxUs = (unsigned int)us;
+	}
+}
+
+static unsigned short
+TouchFilterPosition(
+	long long Position
+	)
+{
+	Position = (Position + TOUCH_FILTER_ONE / 2) / TOUCH_FILTER_ONE;
+
+	if (Position < 0) {
+		return 0;
+	}
+	if (Position > 0xffff) {
+		return 0xffff;
+	}
+	return (unsigned short)Position;
+}
+
+static void
+TouchFilterStart(
+	PTOUCH_SLOT Slot
+	)
+{
+	Slot->FilterX = Slot->X * TOUCH_FILTER_ONE;
+	Slot->FilterY = Slot->Y * TOUCH_FILTER_ONE;
+	Slot->VelocityX = 0;
+	Slot->VelocityY = 0;
+	Slot->Samples = 1;
+	Slot->ReportX = Slot->X;
+	Slot->ReportY = Slot->Y;
+}
+
+//
+// One alpha-beta step on one axis, positions in 1/256 units and the
+// velocity in 1/256 units per ms. Returns the extrapolated position.
+//
+static long long
+TouchFilterAxis(
+	const TOUCH_FILTER_CONFIG *Config,
+	int *Position,
+	int *Velocity,
+	unsigned int Measured,
+	unsigned int DeltaUs,
+	int Predict
+	)
+{
+	long long predicted;
+	long long residual;
+	long long offset;
+	long long limit;
+
+	predicted = *Position + (long long)*Velocity * DeltaUs / 1000;
+	residual = (long long)Measured * TOUCH_FILTER_ONE - predicted;
+
+	*Position = (int)(predicted + residual * Config->Alpha / TOUCH_FILTER_ONE);
+	*Velocity = (int)(*Velocity +
+		residual * Config->Beta * 1000 / ((long long)TOUCH_FILTER_ONE * DeltaUs));
+
+	if (!Predict) {
+		return *Position;
+	}
+
+	offset = (long long)*Velocity * Config->HorizonUs / 1000;
+	limit = (long long)Config->MaxDistance * TOUCH_FILTER_ONE;
+	if (offset > limit) {
+		offset = limit;
+	}
+	if (offset < -limit) {
+		offset = -limit;
+	}
+
+	return *Position + offset;
+}
+
+static void
+TouchFilterStep(
+	PTOUCH_TRACKER Tracker,
+	PTOUCH_SLOT Slot,
+	unsigned long long DeltaUs
+	)
+{
+	int predict;
+
+	if ((Tracker->Filter.Alpha == 0) ||
+		(DeltaUs == 0) || (DeltaUs > TOUCH_FILTER_MAX_GAP_US)) {
+		TouchFilterStart(Slot);
+		return;
+	}
+
+	if (Slot->Samples < TOUCH_FILTER_MIN_SAMPLES) {
+		Slot->Samples++;
+	}
+
+	predict = (Slot->Samples >= TOUCH_FILTER_MIN_SAMPLES) &&
+		(Tracker->Filter.HorizonUs != 0);
+
+	Slot->ReportX = TouchFilterPosition(TouchFilterAxis(&Tracker->Filter,
+		&Slot->FilterX, &Slot->VelocityX, Slot->X, (unsigned int)DeltaUs, predict));
+	Slot->ReportY = TouchFilterPosition(TouchFilterAxis(&Tracker->Filter,
+		&Slot->FilterY, &Slot->VelocityY, Slot->Y, (unsigned int)DeltaUs, predict));
+}
+
+void
+TouchTrackerReset(
+	PTOUCH_TRACKER Tracker
+	)
+/*++
+
+Routine Description:
+
+	Forgets every contact and any frame still being reported, e.g. when
+	the controller is powered down with fingers on the panel.
+
+Arguments:
+
+	Tracker - the tracker.
+
+Return Value:
+
+	None
+
+--*/
+{
+	unsigned int i;
+
+	for (i = 0; i < TOUCH_MAX_CONTACTS; i++) {
+		Tracker->Slots[i].State = TouchSlotFree;
+		Tracker->Slots[i].ControllerId = 0;
+		Tracker->Slots[i].X = 0;
+		Tracker->Slots[i].Y = 0;
+		Tracker->Slots[i].ReportX = 0;
+		Tracker->Slots[i].ReportY = 0;
+		Tracker->Slots[i].Samples = 0;
+	}
+
+	Tracker->ScanTime = 0;
+	Tracker->FrameContacts = 0;
+	Tracker->FrameNext = 0;
+	Tracker->PendingReports = 0;
+	Tracker->InterruptTime = 0;
+	Tracker->ReadTime = 0;
+	Tracker->BuildTime = 0;
+	Tracker->FilterTime = 0;
+}
+
+void
+TouchTrackerResetStatistics(
+	PTOUCH_TRACKER Tracker
+	)
+/*++
+
+Routine Description:
+
+	Clears the frame and report counters and the latency histograms.
+
+Arguments:
+
+	Tracker - the tracker.
+
+Return Value:
+
+	None
+
+--*/
+{
+	unsigned int i;
+	unsigned int b;
+
+	Tracker->Frames = 0;
+	Tracker->Reports = 0;
+	Tracker->DroppedFrames = 0;
+	Tracker->DroppedReports = 0;
+	Tracker->Overflows = 0;
+
+	for (i = 0; i < TOUCH_LATENCY_STAGES; i++) {
+		Tracker->Latency[i].Count = 0;
+		Tracker->Latency[i].MaxUs = 0;
+		Tracker->Latency[i].TotalUs = 0;
+		for (b = 0; b < TOUCH_LATENCY_BUCKETS; b++) {
+			Tracker->Latency[i].Buckets[b] = 0;
+		}
+	}
+}
+
+void
+TouchTrackerInitialize(
+	PTOUCH_TRACKER Tracker,
+	unsigned char ReportId,
+	unsigned int ReportContacts
+	)
+/*++
+
+Routine Description:
+
+	Initializes a tracker for a report descriptor holding ReportContacts
+	contacts per input report. The contact filter starts disabled.
+
+Arguments:
+
+	Tracker - the tracker.
+
+	ReportId - report id of the touch input report.
+
+	ReportContacts - contacts per input report, 1 - TOUCH_MAX_CONTACTS.
+
+Return Value:
+
+	None
+
+--*/
+{
+	if (ReportContacts == 0) {
+		ReportContacts = 1;
+	}
+	if (ReportContacts > TOUCH_MAX_CONTACTS) {
+		ReportContacts = TOUCH_MAX_CONTACTS;
+	}
+
+	Tracker->ReportId = ReportId;
+	Tracker->ReportContacts = ReportContacts;
+	Tracker->Filter.Alpha = 0;
+	Tracker->Filter.Beta = 0;
+	Tracker->Filter.HorizonUs = 0;
+	Tracker->Filter.MaxDistance = 0;
+
+	TouchTrackerResetStatistics(Tracker);
+	TouchTrackerReset(Tracker);
+}
+
+unsigned int
+TouchTrackerUpdate(
+	PTOUCH_TRACKER Tracker,
+	const TOUCH_POINT *Points,
+	unsigned int Count,
+	unsigned short ScanTime
+	)
+/*++
+
+Routine Description:
+
+	Starts a new frame from the contacts the controller reported. Points
+	are matched to slots by controller id, new ids take the lowest free
+	slot and active slots missing from the frame start lifting.
+
+	A frame whose reports have not all been taken is replaced. Its lifts
+	are carried into the new frame so no contact is left down.
+
+	The frame time for the contact filter is the ReadTime given to
+	TouchTrackerSetFrameTimes, or the scan time when there is none.
+
+Arguments:
+
+	Tracker - the tracker.
+
+	Points - the contacts of this frame.
+
+	Count - number of Points.
+
+	ScanTime - scan time of the frame, in 100us units.
+
+Return Value:
+
+	Number of reports the frame needs, 0 when nothing is or was in
+	contact.
+
+--*/
+{
+	unsigned char seen[TOUCH_MAX_CONTACTS];
+	unsigned int i;
+	unsigned int s;
+	unsigned int contacts;
+	unsigned long long now;
+	unsigned long long delta;
+
+	if (Tracker->ReadTime != 0) {
+		now = Tracker->ReadTime;
+		delta = ((Tracker->FilterTime != 0) && (now > Tracker->FilterTime)) ?
+			now - Tracker->FilterTime : 0;
+	}
+	else {
+		delta = (unsigned long long)(unsigned short)(ScanTime - Tracker->ScanTime) * 100;
+		now = Tracker->FilterTime + delta;
+	}
+	Tracker->FilterTime = now;
+
+	if (Tracker->PendingReports != 0) {
+		Tracker->DroppedFrames++;
+		Tracker->DroppedReports += Tracker->PendingReports;
+	}
+	else {
+		for (s = 0; s < TOUCH_MAX_CONTACTS; s++) {
+			if (Tracker->Slots[s].State == TouchSlotLifting) {
+				Tracker->Slots[s].State = TouchSlotFree;
+			}
+		}
+	}
+
+	for (s = 0; s < TOUCH_MAX_CONTACTS; s++) {
+		seen[s] = 0;
+	}
+
+	for (i = 0; i < Count; i++) {
+		unsigned int slot = TOUCH_MAX_CONTACTS;
+
+		for (s = 0; s < TOUCH_MAX_CONTACTS; s++) {
+			if ((Tracker->Slots[s].State != TouchSlotFree) &&
+				(Tracker->Slots[s].ControllerId == Points[i].Id)) {
+				slot = s;
+				break;
+			}
+		}
+
+		if (slot == TOUCH_MAX_CONTACTS) {
+			for (s = 0; s < TOUCH_MAX_CONTACTS; s++) {
+				if (Tracker->Slots[s].State == TouchSlotFree) {
+					slot = s;
+					break;
+				}
+			}
+		}
+
+		if (slot == TOUCH_MAX_CONTACTS) {
+			Tracker->Overflows++;
+			continue;
+		}
+
+		Tracker->Slots[slot].X = Points[i].X;
+		Tracker->Slots[slot].Y = Points[i].Y;
+
+		if (Tracker->Slots[slot].State == TouchSlotFree) {
+			TouchFilterStart(&Tracker->Slots[slot]);
+		}
+		else {
+			TouchFilterStep(Tracker, &Tracker->Slots[slot], delta);
+		}
+
+		Tracker->Slots[slot].State = TouchSlotActive;
+		Tracker->Slots[slot].ControllerId = Points[i].Id;
+		seen[slot] = 1;
+	}
+
+	contacts = 0;
+	for (s = 0; s < TOUCH_MAX_CONTACTS; s++) {
+		if ((Tracker->Slots[s].State == TouchSlotActive) && !seen[s]) {
+			Tracker->Slots[s].State = TouchSlotLifting;
+		}
+		if (Tracker->Slots[s].State != TouchSlotFree) {
+			contacts++;
+		}
+	}
+
+	Tracker->ScanTime = ScanTime;
+	Tracker->FrameContacts = contacts;
+	Tracker->FrameNext = 0;
+	Tracker->PendingReports =
+		(contacts + Tracker->ReportContacts - 1) / Tracker->ReportContacts;
+	Tracker->Frames++;
+
+	return Tracker->PendingReports;
+}
+
+unsigned int
+TouchTrackerNextReport(
+	PTOUCH_TRACKER Tracker,
+	void *Buffer,
+	unsigned int Length
+	)
+/*++
+
+Routine Description:
+
+	Writes the next input report of the current frame into Buffer,
+	which is normally the output buffer of a pended read request.
+
+Arguments:
+
+	Tracker - the tracker.
+
+	Buffer - receives the report.
+
+	Length - size of Buffer, at least
+		TOUCH_REPORT_LENGTH(Tracker->ReportContacts).
+
+Return Value:
+
+	Bytes written, 0 if the frame has no report left or Buffer is too
+	small.
+
+--*/
+{
+	unsigned char *report = (unsigned char *)Buffer;
+	unsigned char *contact;
+	unsigned int length = TOUCH_REPORT_LENGTH(Tracker->ReportContacts);
+	unsigned int written = 0;
+	unsigned int s;
+	unsigned short x;
+	unsigned short y;
+
+	if ((Tracker->PendingReports == 0) || (Length < length)) {
+		return 0;
+	}
+
+	report[0] = Tracker->ReportId;
+	contact = &report[1];
+
+	for (s = Tracker->FrameNext;
+		(s < TOUCH_MAX_CONTACTS) && (written < Tracker->ReportContacts);
+		s++) {
+		PTOUCH_SLOT slot = &Tracker->Slots[s];
+
+		if (slot->State == TouchSlotFree) {
+			continue;
+		}
+
+		//
+		// Lifts go out at the last measured position, never a predicted
+		// one.
+		//
+		if (slot->State == TouchSlotActive) {
+			x = slot->ReportX;
+			y = slot->ReportY;
+		}
+		else {
+			x = slot->X;
+			y = slot->Y;
+		}
+
+		contact[0] = (slot->State == TouchSlotActive) ? 1 : 0;
+		contact[1] = (unsigned char)s;
+		contact[2] = (unsigned char)(x & 0xff);
+		contact[3] = (unsigned char)(x >> 8);
+		contact[4] = (unsigned char)(y & 0xff);
+		contact[5] = (unsigned char)(y >> 8);
+		contact += TOUCH_CONTACT_LENGTH;
+		written++;
+	}
+
+	for (; written < Tracker->ReportContacts; written++) {
+		contact[0] = 0;
+		contact[1] = 0;
+		contact[2] = 0;
+		contact[3] = 0;
+		contact[4] = 0;
+		contact[5] = 0;
+		contact += TOUCH_CONTACT_LENGTH;
+	}
+
+	contact[0] = (unsigned char)(Tracker->ScanTime & 0xff);
+	contact[1] = (unsigned char)(Tracker->ScanTime >> 8);
+	contact[2] = (Tracker->FrameNext == 0) ?
+		(unsigned char)Tracker->FrameContacts : 0;
+
+	Tracker->FrameNext = s;
+	Tracker->PendingReports--;
+	Tracker->Reports++;
+
+	return length;
+}
+
+void
+TouchTrackerSetFrameTimes(
+	PTOUCH_TRACKER Tracker,
+	unsigned long long InterruptTime,
+	unsigned long long ReadTime
+	)
+/*++
+
+Routine Description:
+
+	Records when the interrupt of the next frame fired and when its
+	contact registers had been read. Called before TouchTrackerUpdate.
+
+Arguments:
+
+	Tracker - the tracker.
+
+	InterruptTime - entry of the interrupt service routine, in us.
+
+	ReadTime - completion of the register read, in us.
+
+Return Value:
+
+	None
+
+--*/
+{
+	Tracker->InterruptTime = InterruptTime;
+	Tracker->ReadTime = ReadTime;
+	Tracker->BuildTime = 0;
+
+	TouchLatencyRecord(&Tracker->Latency[TouchLatencyRead],
+		InterruptTime, ReadTime);
+}
+
+void
+TouchTrackerReportBuilt(
+	PTOUCH_TRACKER Tracker,
+	unsigned long long Time
+	)
+/*++
+
+Routine Description:
+
+	Records that TouchTrackerNextReport wrote a report into a request.
+
+Arguments:
+
+	Tracker - the tracker.
+
+	Time - current time, in us.
+
+Return Value:
+
+	None
+
+--*/
+{
+	Tracker->BuildTime = Time;
+
+	TouchLatencyRecord(&Tracker->Latency[TouchLatencyBuild],
+		Tracker->ReadTime, Time);
+}
+
+void
+TouchTrackerReportCompleted(
+	PTOUCH_TRACKER Tracker,
+	unsigned long long Time
+	)
+/*++
+
+Routine Description:
+
+	Records that the request holding the latest report was completed.
+	Drivers completing requests outside the routine that built them get
+	the times of the latest frame, which is the frame reported unless
+	another interrupt came in between.
+
+Arguments:
+
+	Tracker - the tracker.
+
+	Time - current time, in us.
+
+Return Value:
+
+	None
+
+--*/
+{
+	TouchLatencyRecord(&Tracker->Latency[TouchLatencyComplete],
+		Tracker->BuildTime, Time);
+	TouchLatencyRecord(&Tracker->Latency[TouchLatencyTotal],
+		Tracker->InterruptTime, Time);
+}
+
+unsigned int
+TouchTrackerLatencyReport(
+	PTOUCH_TRACKER Tracker,
+	void *Buffer,
+	unsigned int Length
+	)
+/*++
+
+Routine Description:
+
+	Writes the statistics as feature report TOUCH_LATENCY_REPORT_ID.
+
+Arguments:
+
+	Tracker - the tracker.
+
+	Buffer - receives the report.
+
+	Length - size of Buffer, at least TOUCH_LATENCY_REPORT_LENGTH.
+
+Return Value:
+
+	Bytes written, 0 if Buffer is too small.
+
+--*/
+{
+	PTOUCH_LATENCY_REPORT report = (PTOUCH_LATENCY_REPORT)Buffer;
+	unsigned int i;
+
+	if (Length < TOUCH_LATENCY_REPORT_LENGTH) {
+		return 0;
+	}
+
+	report->ReportId = TOUCH_LATENCY_REPORT_ID;
+	report->Version = TOUCH_LATENCY_REPORT_VERSION;
+	report->Stages = TOUCH_LATENCY_STAGES;
+	report->Buckets = TOUCH_LATENCY_BUCKETS;
+	report->BaseShift = TOUCH_LATENCY_BASE_SHIFT;
+	report->Reserved[0] = 0;
+	report->Reserved[1] = 0;
+	report->Reserved[2] = 0;
+	report->Frames = Tracker->Frames;
+	report->Reports = Tracker->Reports;
+	report->DroppedFrames = Tracker->DroppedFrames;
+	report->DroppedReports = Tracker->DroppedReports;
+	report->Overflows = Tracker->Overflows;
+
+	for (i = 0; i < TOUCH_LATENCY_STAGES; i++) {
+		report->Latency[i] = Tracker->Latency[i];
+	}
+
+	return TOUCH_LATENCY_REPORT_LENGTH;
+}
+
+void
+TouchTrackerSetFilter(
+	PTOUCH_TRACKER Tracker,
+	const TOUCH_FILTER_CONFIG *Config
+	)
+/*++
+
+Routine Description:
+
+	Sets the contact filter, out of range values are clamped. Contacts
+	already down restart their filter with the next frame.
+
+Arguments:
+
+	Tracker - the tracker.
+
+	Config - the filter settings, see TOUCH_FILTER_CONFIG.
+
+Return Value:
+
+	None
+
+--*/
+{
+	unsigned int s;
+
+	Tracker->Filter = *Config;
+
+	if (Tracker->Filter.Alpha > TOUCH_FILTER_ONE) {
+		Tracker->Filter.Alpha = TOUCH_FILTER_ONE;
+	}
+	if (Tracker->Filter.Beta > TOUCH_FILTER_ONE) {
+		Tracker->Filter.Beta = TOUCH_FILTER_ONE;
+	}
+	if (Tracker->Filter.HorizonUs > TOUCH_PREDICT_MAX_HORIZON_US) {
+		Tracker->Filter.HorizonUs = TOUCH_PREDICT_MAX_HORIZON_US;
+	}
+	if ((Tracker->Filter.MaxDistance == 0) ||
+		(Tracker->Filter.MaxDistance > 0xffff)) {
+		Tracker->Filter.MaxDistance = 0xffff;
+	}
+
+	for (s = 0; s < TOUCH_MAX_CONTACTS; s++) {
+		Tracker->Slots[s].Samples = 0;
+		Tracker->Slots[s].ReportX = Tracker->Slots[s].X;
+		Tracker->Slots[s].ReportY = Tracker->Slots[s].Y;
+	}
+	Tracker->FilterTime = 0;
+}
+
+#ifdef _KERNEL_MODE
+
+VOID
+TouchTrackerReadFilterConfig(
+	_In_ WDFDEVICE Device,
+	_Inout_ PTOUCH_TRACKER Tracker
+	)
+/*++
+
+Routine Description:
+
+	Reads the contact filter settings of the panel from the device key,
+	the filter stays disabled when FilterAlpha is not set.
+
+Arguments:
+
+	Device - handle to the touch device.
+
+	Tracker - the tracker.
+
+Return Value:
+
+	None
+
+--*/
+{
+	WDFKEY key = NULL;
+	TOUCH_FILTER_CONFIG config = { 0 };
+	ULONG value;
+	NTSTATUS status;
+
+	DECLARE_CONST_UNICODE_STRING(alphaName, L"FilterAlpha");
+	DECLARE_CONST_UNICODE_STRING(betaName, L"FilterBeta");
+	DECLARE_CONST_UNICODE_STRING(horizonName, L"PredictHorizonUs");
+	DECLARE_CONST_UNICODE_STRING(distanceName, L"PredictMaxDistance");
+
+	status = WdfDeviceOpenRegistryKey(Device,
+		PLUGPLAY_REGKEY_DEVICE,
+		KEY_READ,
+		WDF_NO_OBJECT_ATTRIBUTES,
+		&key);
+
+	if (!NT_SUCCESS(status)) {
+		return;
+	}
+
+	if (NT_SUCCESS(WdfRegistryQueryULong(key, &alphaName, &value))) {
+		config.Alpha = value;
+	}
+	if (NT_SUCCESS(WdfRegistryQueryULong(key, &betaName, &value))) {
+		config.Beta = value;
+	}
+	if (NT_SUCCESS(WdfRegistryQueryULong(key, &horizonName, &value))) {
+		config.HorizonUs = value;
+	}
+	if (NT_SUCCESS(WdfRegistryQueryULong(key, &distanceName, &value))) {
+		config.MaxDistance = value;
+	}
+
+	WdfRegistryClose(key);
+
+	TouchTrackerSetFilter(Tracker, &config);
+}
+
+NTSTATUS
+TouchTrackerGetLatencyFeature(
+	_Inout_ PTOUCH_TRACKER Tracker,
+	_In_ WDFSPINLOCK Lock,
+	_Out_writes_bytes_(Length) PVOID Buffer,
+	_In_ ULONG Length,
+	_Out_ PULONG BytesReturned
+	)
+/*++
+
+Routine Description:
+
+	Handles a get feature request for report TOUCH_LATENCY_REPORT_ID.
+
+Arguments:
+
+	Tracker - the tracker.
+
+	Lock - the spin lock the driver reports contacts under.
+
+	Buffer - receives the report.
+
+	Length - size of Buffer.
+
+	BytesReturned - receives the size of the report.
+
+Return Value:
+
+	STATUS_BUFFER_TOO_SMALL if the report does not fit into Buffer.
+
+--*/
+{
+	WdfSpinLockAcquire(Lock);
+	*BytesReturned = TouchTrackerLatencyReport(Tracker, Buffer, Length);
+	WdfSpinLockRelease(Lock);
+
+	if (*BytesReturned == 0) {
+		return STATUS_BUFFER_TOO_SMALL;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+VOID
+TouchTrackerSetLatencyFeature(
+	_Inout_ PTOUCH_TRACKER Tracker,
+	_In_ WDFSPINLOCK Lock
+	)
+/*++
+
+Routine Description:
+
+	Handles a set feature request for report TOUCH_LATENCY_REPORT_ID,
+	which clears the statistics.
+
+Arguments:
+
+	Tracker - the tracker.
+
+	Lock - the spin lock the driver reports contacts under.
+
+Return Value:
+
+	None
+
+--*/
+{
+	WdfSpinLockAcquire(Lock);
+	TouchTrackerResetStatistics(Tracker);
+	WdfSpinLockRelease(Lock);
+}
+
+#endif
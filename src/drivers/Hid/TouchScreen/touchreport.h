@@ -0,0 +1,367 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	touchreport.h
+
+Abstract:
+
+	Contact tracking and HID input report packing shared by the touch
+	screen drivers. A driver parses its controller registers into
+	TOUCH_POINTs and hands them to TouchTrackerUpdate once per frame,
+	then writes the frame's reports straight into pended read buffers
+	with TouchTrackerNextReport.
+
+	Every touch driver uses the same input report layout:
+
+		report id
+		ReportContacts times
+			tip switch (bit 0), contact identifier
+			X, Y (16 bit little endian)
+		scan time (16 bit little endian, 100us units)
+		contact count
+
+	A contact keeps its slot, and with it its HID contact identifier,
+	from touch down until the report carrying its lift has been built.
+	A contact missing from a frame is reported once more with the tip
+	switch clear at its last position. When a frame has more contacts
+	than one report holds, it is split over several reports in hybrid
+	mode: all of them carry the same scan time and only the first
+	carries the contact count.
+
+	The tracker also keeps latency histograms of the reports, fed with
+	timestamps the driver takes at the controller interrupt, after the
+	contact registers were read, when a report was written into a read
+	request and when that request was completed. They are returned by
+	the driver as the vendor feature report TOUCH_LATENCY_REPORT_ID and
+	decoded by tools\touchlat.
+
+	Optionally every contact is smoothed by an alpha-beta filter and
+	its reported position extrapolated along the filtered velocity, to
+	make up for the time a report takes to reach the screen. Neither is
+	applied on the touch down frame, and a lift is always reported at
+	the last measured position. tools\touchpredict replays recorded
+	traces through the filter to pick the settings of a panel.
+
+Environment:
+
+	kernel mode, and user mode for replaying register dumps
+
+--*/
+
+#ifndef _TOUCHREPORT_H_
+#define _TOUCHREPORT_H_
+
+#define TOUCH_MAX_CONTACTS				10
+
+#define TOUCH_CONTACT_LENGTH			6
+#define TOUCH_REPORT_LENGTH(Contacts)	(4 + (Contacts) * TOUCH_CONTACT_LENGTH)
+
+//
+// Latency stages, all in microseconds:
+//
+//	TouchLatencyRead - controller interrupt to contact registers read.
+//	TouchLatencyBuild - registers read to report written into a request.
+//	TouchLatencyComplete - report written to its request completed.
+//	TouchLatencyTotal - controller interrupt to request completed.
+//
+// Bucket 0 counts latencies under 64us, every following bucket doubles
+// the bound, the last one is open ended.
+//
+#define TOUCH_LATENCY_STAGES			4
+#define TOUCH_LATENCY_BUCKETS			12
+#define TOUCH_LATENCY_BASE_SHIFT		6
+
+#define TOUCH_LATENCY_REPORT_ID			0x46
+#define TOUCH_LATENCY_REPORT_VERSION	1
+#define TOUCH_LATENCY_REPORT_LENGTH		(28 + TOUCH_LATENCY_STAGES * 64)
+
+//
+// Report descriptor items of the latency feature report. They go after
+// the vendor defined items of the touch collection, which set the usage
+// page, LOGICAL_MAXIMUM (0xff) and REPORT_SIZE (8) they rely on.
+//
+#define TOUCH_LATENCY_FEATURE_DESCRIPTOR \
+	0x85, TOUCH_LATENCY_REPORT_ID,      /*   REPORT_ID (Feature) */ \
+	0x09, 0xC6,                         /*   USAGE (Vendor Usage 0xC6) */ \
+	0x96, (TOUCH_LATENCY_REPORT_LENGTH - 1) & 0xff, \
+		(TOUCH_LATENCY_REPORT_LENGTH - 1) >> 8, /*   REPORT_COUNT (latency statistics) */ \
+	0xb1, 0x02                          /*   FEATURE (Data,Var,Abs) */
+
+enum {
+	TouchLatencyRead = 0,
+	TouchLatencyBuild,
+	TouchLatencyComplete,
+	TouchLatencyTotal
+};
+
+//
+// Contact filter settings, read from the device key by
+// TouchTrackerReadFilterConfig:
+//
+//	FilterAlpha - position gain in 1/256, 256 follows the measurement,
+//		smaller values smooth more. 0 disables the filter.
+//	FilterBeta - velocity gain in 1/256.
+//	PredictHorizonUs - how far ahead positions are extrapolated, 0
+//		disables prediction.
+//	PredictMaxDistance - largest extrapolation in panel units, 0 for no
+//		limit.
+//
+// Prediction starts with the TOUCH_FILTER_MIN_SAMPLES frame of a contact.
+// A contact not seen for TOUCH_FILTER_MAX_GAP_US starts over.
+//
+#define TOUCH_FILTER_ONE				256
+#define TOUCH_FILTER_MIN_SAMPLES		3
+#define TOUCH_FILTER_MAX_GAP_US			50000
+#define TOUCH_PREDICT_MAX_HORIZON_US	50000
+
+typedef struct _TOUCH_FILTER_CONFIG {
+	unsigned int Alpha;
+	unsigned int Beta;
+	unsigned int HorizonUs;
+	unsigned int MaxDistance;
+} TOUCH_FILTER_CONFIG, *PTOUCH_FILTER_CONFIG;
+
+typedef enum _TOUCH_SLOT_STATE {
+	TouchSlotFree = 0,
+	TouchSlotActive,
+	TouchSlotLifting
+} TOUCH_SLOT_STATE;
+
+//
+// One contact as read from the controller. Id is the controller's own
+// tracking id, it only has to be unique within a frame and stable while
+// the finger stays down.
+//
+typedef struct _TOUCH_POINT {
+	unsigned char Id;
+	unsigned short X;
+	unsigned short Y;
+} TOUCH_POINT, *PTOUCH_POINT;
+
+typedef struct _TOUCH_SLOT {
+	unsigned char State;
+	unsigned char ControllerId;
+
+	//
+	// Last measured position, and the position reported while active.
+	//
+	unsigned short X;
+	unsigned short Y;
+	unsigned short ReportX;
+	unsigned short ReportY;
+
+	//
+	// Filter state: position in 1/256 units, velocity in 1/256 units
+	// per ms, and the frames seen since touch down.
+	//
+	int FilterX;
+	int FilterY;
+	int VelocityX;
+	int VelocityY;
+	unsigned int Samples;
+} TOUCH_SLOT, *PTOUCH_SLOT;
+
+typedef struct _TOUCH_LATENCY_HISTOGRAM {
+	unsigned int Count;
+	unsigned int MaxUs;
+	unsigned long long TotalUs;
+	unsigned int Buckets[TOUCH_LATENCY_BUCKETS];
+} TOUCH_LATENCY_HISTOGRAM, *PTOUCH_LATENCY_HISTOGRAM;
+
+//
+// Vendor feature report TOUCH_LATENCY_REPORT_ID, little endian. A set
+// feature request with this report id clears the statistics.
+//
+#pragma pack(push, 1)
+typedef struct _TOUCH_LATENCY_REPORT {
+	unsigned char ReportId;
+	unsigned char Version;
+	unsigned char Stages;
+	unsigned char Buckets;
+	unsigned char BaseShift;
+	unsigned char Reserved[3];
+	unsigned int Frames;
+	unsigned int Reports;
+	unsigned int DroppedFrames;
+	unsigned int DroppedReports;
+	unsigned int Overflows;
+	TOUCH_LATENCY_HISTOGRAM Latency[TOUCH_LATENCY_STAGES];
+} TOUCH_LATENCY_REPORT, *PTOUCH_LATENCY_REPORT;
+#pragma pack(pop)
+
+typedef struct _TOUCH_TRACKER {
+	unsigned char ReportId;
+
+	//
+	// Contacts one input report holds, as declared by the driver's
+	// report descriptor.
+	//
+	unsigned int ReportContacts;
+
+	TOUCH_SLOT Slots[TOUCH_MAX_CONTACTS];
+
+	//
+	// The frame being reported: its scan time, the number of contacts
+	// it carries and how many of them have been written to reports.
+	//
+	unsigned short ScanTime;
+	unsigned int FrameContacts;
+	unsigned int FrameNext;
+	unsigned int PendingReports;
+
+	TOUCH_FILTER_CONFIG Filter;
+	unsigned long long FilterTime;
+
+	unsigned int Frames;
+	unsigned int Reports;
+
+	//
+	// Frames replaced before all their reports were taken, and points
+	// ignored because every slot was in use.
+	//
+	unsigned int DroppedFrames;
+	unsigned int Overflows;
+
+	//
+	// Reports never taken because the next frame replaced theirs, i.e.
+	// no read request was pending.
+	//
+	unsigned int DroppedReports;
+
+	//
+	// Timestamps of the current frame and of its latest report, in us.
+	//
+	unsigned long long InterruptTime;
+	unsigned long long ReadTime;
+	unsigned long long BuildTime;
+
+	TOUCH_LATENCY_HISTOGRAM Latency[TOUCH_LATENCY_STAGES];
+} TOUCH_TRACKER, *PTOUCH_TRACKER;
+
+void
+TouchTrackerInitialize(
+	PTOUCH_TRACKER Tracker,
+	unsigned char ReportId,
+	unsigned int ReportContacts
+	);
+
+void
+TouchTrackerReset(
+	PTOUCH_TRACKER Tracker
+	);
+
+unsigned int
+TouchTrackerUpdate(
+	PTOUCH_TRACKER Tracker,
+	const TOUCH_POINT *Points,
+	unsigned int Count,
+	unsigned short ScanTime
+	);
+
+unsigned int
+TouchTrackerNextReport(
+	PTOUCH_TRACKER Tracker,
+	void *Buffer,
+	unsigned int Length
+	);
+
+void
+TouchTrackerSetFrameTimes(
+	PTOUCH_TRACKER Tracker,
+	unsigned long long InterruptTime,
+	unsigned long long ReadTime
+	);
+
+void
+TouchTrackerReportBuilt(
+	PTOUCH_TRACKER Tracker,
+	unsigned long long Time
+	);
+
+void
+TouchTrackerReportCompleted(
+	PTOUCH_TRACKER Tracker,
+	unsigned long long Time
+	);
+
+void
+TouchTrackerResetStatistics(
+	PTOUCH_TRACKER Tracker
+	);
+
+unsigned int
+TouchTrackerLatencyReport(
+	PTOUCH_TRACKER Tracker,
+	void *Buffer,
+	unsigned int Length
+	);
+
+void
+TouchTrackerSetFilter(
+	PTOUCH_TRACKER Tracker,
+	const TOUCH_FILTER_CONFIG *Config
+	);
+
+#ifdef _KERNEL_MODE
+
+//
+// Timestamp for the latency statistics, in microseconds.
+//
+__inline unsigned long long
+TouchTimeUs(
+	VOID
+	)
+{
+	LARGE_INTEGER counter;
+	LARGE_INTEGER frequency;
+
+	counter = KeQueryPerformanceCounter(&frequency);
+
+	return (unsigned long long)(counter.QuadPart / frequency.QuadPart) * 1000000 +
+		(unsigned long long)(counter.QuadPart % frequency.QuadPart) * 1000000 /
+		frequency.QuadPart;
+}
+
+VOID
+TouchTrackerReadFilterConfig(
+	_In_ WDFDEVICE Device,
+	_Inout_ PTOUCH_TRACKER Tracker
+	);
+
+NTSTATUS
+TouchTrackerGetLatencyFeature(
+	_Inout_ PTOUCH_TRACKER Tracker,
+	_In_ WDFSPINLOCK Lock,
+	_Out_writes_bytes_(Length) PVOID Buffer,
+	_In_ ULONG Length,
+	_Out_ PULONG BytesReturned
+	);
+
+VOID
+TouchTrackerSetLatencyFeature(
+	_Inout_ PTOUCH_TRACKER Tracker,
+	_In_ WDFSPINLOCK Lock
+	);
+
+#endif
+
+#endif
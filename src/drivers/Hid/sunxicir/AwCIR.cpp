@@ -81,7 +81,7 @@ NTSTATUS CIRInitialize(_In_ WDFDEVICE Device)
 	CIRInterruptConfig(Device);
 
 	//config CIR_RCR
-	WRITE_REGISTER_ULONG((volatile ULONG*)((ULONG)pDevContext->RegisterBase + 0x34), 0x00800543);
+	WRITE_REGISTER_ULONG((volatile ULONG*)((ULONG)pDevContext->RegisterBase + CIR_CONFIG_REG_OFFSET), CIR_CONFIG);
 	//WRITE_REGISTER_ULONG((volatile ULONG*)((ULONG)pDevContext->RegisterBase + 0x10), 0x0);
 
 	
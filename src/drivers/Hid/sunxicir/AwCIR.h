@@ -97,6 +97,19 @@
 #define CIR_RXFIFO_REG_OFFSET 0x20
 #define CIR_RXFIFO_LENGTH 0x1
 
+//Each FIFO entry is a run of samples of one level: bit 7 the level, bits 0-6 the sample count minus one
+#define CIR_RXFIFO_LEVEL_SHIFT 0x7
+#define CIR_RXFIFO_COUNT_MASK 0x7f
+
+
+#define CIR_CONFIG_REG_OFFSET 0x34
+
+//Sample clock OSC24M / 512, noise threshold 16 samples, idle threshold 6 * 128 samples
+#define CIR_CONFIG 0x00800543
+#define CIR_SAMPLE_CLOCK_HZ (24000000 / 512)
+
+#define CIR_SAMPLES_TO_US(Count) ((ULONG)(((Count) * 1000000ULL) / CIR_SAMPLE_CLOCK_HZ))
+
 
 #define CIR_RX_STATE_REG_OFFSET 0x30
 
@@ -35,6 +35,7 @@ NTSTATUS CirDeviceCreate(_In_ PWDFDEVICE_INIT DeviceInit)
 	PDEVICE_CONTEXT pDevContext = NULL;
 	WDF_PNPPOWER_EVENT_CALLBACKS pnpCallbacks = { 0 };
 	WDF_OBJECT_ATTRIBUTES attr = { 0 };
+	WDF_TIMER_CONFIG timerConfig;
 
 	PAGED_CODE();
 	FunctionEnter();
@@ -68,6 +69,17 @@ NTSTATUS CirDeviceCreate(_In_ PWDFDEVICE_INIT DeviceInit)
 		goto Exit;
 	}
 
+	WDF_TIMER_CONFIG_INIT(&timerConfig, CirEvtKeyReleaseTimer);
+	WDF_OBJECT_ATTRIBUTES_INIT(&attr);
+	attr.ParentObject = device;
+
+	status = WdfTimerCreate(&timerConfig, &attr, &pDevContext->KeyReleaseTimer);
+	if (!NT_SUCCESS(status))
+	{
+		DebugPrint(DEBUG_LEVEL_ERROR, "Error: WdfTimerCreate failed with error 0x%x\n", status);
+		goto Exit;
+	}
+
 Exit:
 
 	return status;
@@ -94,6 +106,8 @@ NTSTATUS SunxicirEvtDevicePrepareHardware(_In_ WDFDEVICE Device, _In_ WDFCMRESLI
 
 	pDevContext = DeviceGetContext(Device);
 
+	CirKeymapLoad(Device, &pDevContext->Keymap);
+
 	if (resListCountRaw != resListCountTrans)
 	{
 		DbgPrint_E("Error: Raw resource count is not equal to translated resources");
@@ -170,6 +184,9 @@ NTSTATUS SunxicirEvtDeviceD0Entry(_In_ WDFDEVICE Device, _In_ WDF_POWER_DEVICE_S
 		return status;
 	}
 
+	CirPulseRingReset(&DeviceGetContext(Device)->PulseRing);
+	CirDecoderReset(&DeviceGetContext(Device)->Decoder);
+
 	status = CIRInitialize(Device);
 	if (!NT_SUCCESS(status))
 	{
@@ -185,8 +202,10 @@ NTSTATUS SunxicirEvtDeviceD0Exit(_In_ WDFDEVICE Device, _In_ WDF_POWER_DEVICE_ST
 
 	FunctionEnter();
 
-	UNREFERENCED_PARAMETER(Device);
 	UNREFERENCED_PARAMETER(TargetState);
 
+	//Interrupts are disconnected by now, release a key still held by the remote
+	CirKeyReleaseNow(Device);
+
 	return NTSTATUS();
 }
\ No newline at end of file
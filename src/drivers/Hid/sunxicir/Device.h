@@ -19,11 +19,18 @@
 #pragma once
 #include "Driver.h"
 #include "SunxicirInterface.h"
+#include "IRDecoder.h"
+#include "Interrupt.h"
+#include "Keymap.h"
+#include "Common.h"
 
 #define CIR_REG_LENGTH 0x54
 #define CIR_GPIO_PIN_COUNT 1
 #define CIR_DATA_BUFFER_SIZE 64
 
+//Reports batched into one write to the HID injector
+#define HID_INJECT_MAX_REPORTS 8
+
 
 NTSTATUS CirDeviceCreate(_In_ PWDFDEVICE_INIT DeviceInit);
 
@@ -32,6 +39,26 @@ typedef enum
 	CIR_MODE_GPIO
 }CIR_GPIO_PIN, *PCIR_GPIO_PIN;
 
+typedef struct _HID_INJECT_CHANNEL
+{
+	//Request and buffer reused for every write, created once the injector is opened
+	WDFREQUEST Request;
+	WDFMEMORY Memory;
+
+	WDFSPINLOCK Lock;
+
+	//A write is in flight, reports queued meanwhile go out together with the next one
+	BOOLEAN IsBusy;
+	BOOLEAN IsRetry;
+	ULONG InFlightCount;
+
+	HIDINJECTOR_INPUT_REPORT Pending[HID_INJECT_MAX_REPORTS];
+	ULONG PendingCount;
+
+	ULONG WriteCount;
+	ULONG DroppedCount;
+}HID_INJECT_CHANNEL, *PHID_INJECT_CHANNEL;
+
 typedef struct _DEVICE_CONTEXT
 {
 	WDFDEVICE FxDevice;
@@ -44,18 +71,21 @@ typedef struct _DEVICE_CONTEXT
 
 	WDFINTERRUPT Interrupt;
 
-	BOOL IsReceiving;
+	CIR_PULSE_RING PulseRing;
+
+	//Owned by the DPC
+	CIR_DECODER Decoder;
 
-	BOOL PulsePrevious;
-	
-	ULONG DataBuffer[100];
-	
-	BOOL PulseBuffer[100];
+	CIR_KEY_STATE Key;
 
-	ULONG DataSize;
+	CIR_KEYMAP Keymap;
+
+	WDFTIMER KeyReleaseTimer;
 
 	WDFIOTARGET HidInjectorIoTarget;
 
+	HID_INJECT_CHANNEL HidChannel;
+
 }DEVICE_CONTEXT, *PDEVICE_CONTEXT;
 
 WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(DEVICE_CONTEXT, DeviceGetContext);
@@ -17,6 +17,7 @@
 **/
 
 #include "HidInterface.h"
+#include "SendInput.h"
 
 #include "Trace.h"
 #include "HidInterface.tmh"
@@ -127,6 +128,12 @@ NTSTATUS VhidReadyNotificationCallback(PVOID pDeviceChange, PVOID pContext)
 		goto Exit;
 	}
 
+	status = InjectChannelInitialize(pDevContext);
+	if (!NT_SUCCESS(status))
+	{
+		goto Exit;
+	}
+
 	KeSetEvent(&g_VhidArrivedEvent, 100, FALSE);
 
 	return status;
@@ -137,6 +144,7 @@ Exit:
 	{
 		WdfObjectDelete(pDevContext->HidInjectorIoTarget);
 		pDevContext->HidInjectorIoTarget = NULL;
+		pDevContext->HidChannel.Request = NULL;
 	}
 
 	return status;
@@ -21,48 +21,521 @@
 #include "IRDecoder.h"
 
 
+//Decoding phases of a protocol
+#define CIR_PHASE_IDLE 0
+#define CIR_PHASE_HEADER_SPACE 1
+#define CIR_PHASE_BIT_MARK 2
+#define CIR_PHASE_BIT_SPACE 3
+#define CIR_PHASE_MANCHESTER 4
 
-//PD6121G-F Decoder
-VOID PD6121G_F_Decoder(_In_ ULONG* Data, _In_ UINT DataSize, _Out_ UINT8* AddressCode, _Out_ UINT8* DataCode)
+//Longest run a Manchester frame can contain, in units
+#define CIR_MANCHESTER_MAX_UNITS 4
+
+typedef enum _CIR_FRAME_STATUS
+{
+	CirFrameIncomplete,
+	CirFrameComplete,
+	CirFrameInvalid
+}CIR_FRAME_STATUS;
+
+typedef enum _CIR_ENCODING
+{
+	//Fixed mark, the space length carries the bit (NEC)
+	CirEncodingPulseDistance,
+	//Fixed space, the mark length carries the bit (SIRC)
+	CirEncodingPulseWidth,
+	//Every bit is two half bits of opposite level (RC5, RC6)
+	CirEncodingManchester
+}CIR_ENCODING;
+
+//Called after every bit, and with IsEnd set when a gap ends the frame. Returns
+//CirFrameComplete with Code filled once the bits form a valid frame.
+typedef CIR_FRAME_STATUS CIR_FRAME_CHECK(_Inout_ PCIR_PROTOCOL_STATE State, _In_ BOOLEAN IsEnd, _Out_ PCIR_CODE Code);
+
+typedef struct _CIR_PROTOCOL_DESC
+{
+	CIR_PROTOCOL Protocol;
+	CIR_ENCODING Encoding;
+
+	//Durations in us, 0 when the protocol has none
+	ULONG HeaderMark;
+	ULONG HeaderSpace;
+	ULONG RepeatSpace;
+
+	//Short mark or space (pulse encodings) or half bit (Manchester), and the length of a one in units
+	ULONG Unit;
+	ULONG OneUnits;
+
+	//Bits of the longest frame
+	UINT8 MaxBits;
+
+	//Manchester: bit sent with double length halves (RC6 trailer), 0xFF if none
+	UINT8 WideBit;
+
+	//Manchester: a one is mark then space
+	BOOLEAN IsOneMarkFirst;
+
+	BOOLEAN IsLsbFirst;
+
+	CIR_FRAME_CHECK* Check;
+}CIR_PROTOCOL_DESC, *PCIR_PROTOCOL_DESC;
+
+static CIR_FRAME_CHECK CirCheckNec;
+static CIR_FRAME_CHECK CirCheckRc5;
+static CIR_FRAME_CHECK CirCheckRc6;
+static CIR_FRAME_CHECK CirCheckSirc;
+
+static const CIR_PROTOCOL_DESC CirProtocols[CIR_PROTOCOL_COUNT] =
+{
+	{ CirProtocolNec, CirEncodingPulseDistance, 9000, 4500, 2250, 560, 3, 32, 0xFF, FALSE, TRUE, CirCheckNec },
+	{ CirProtocolRc5, CirEncodingManchester, 0, 0, 0, 889, 1, 14, 0xFF, FALSE, FALSE, CirCheckRc5 },
+	{ CirProtocolRc6, CirEncodingManchester, 2666, 889, 0, 444, 1, 37, 4, TRUE, FALSE, CirCheckRc6 },
+	{ CirProtocolSirc, CirEncodingPulseWidth, 2400, 600, 0, 600, 2, 20, 0xFF, FALSE, TRUE, CirCheckSirc },
+};
+
+
+static BOOLEAN CirMatch(ULONG Duration, ULONG Expected)
+{
+	ULONG margin = Expected * CIR_TOLERANCE_PERCENT / 100 + CIR_TOLERANCE_US;
+
+	return (Duration + margin >= Expected) && (Duration <= Expected + margin);
+}
+
+static VOID CirStartBits(const CIR_PROTOCOL_DESC* Desc, PCIR_PROTOCOL_STATE State, UINT8 Phase)
 {
-	UINT32 tmp = 0;
-	UINT8 data = 0;
-	UINT8 dataNot = 0xFF;
-	UINT8 addr = 0;
-	UINT8 addrCompare = 0;
+	State->Phase = Phase;
+	State->Count = 0;
+	State->Length = Desc->MaxBits;
+	State->Half = 0;
+	State->Filled = 0;
+	State->Bits = 0;
+}
 
-	if (DataSize < 64 + 3)
+static CIR_FRAME_STATUS CirAppendBit(const CIR_PROTOCOL_DESC* Desc, PCIR_PROTOCOL_STATE State, UINT8 Bit, PCIR_CODE Code)
+{
+	if (Desc->IsLsbFirst)
+	{
+		State->Bits |= (UINT64)Bit << State->Count;
+	}
+	else
 	{
-		return;
+		State->Bits = (State->Bits << 1) | Bit;
 	}
+	State->Count++;
+
+	return Desc->Check(State, FALSE, Code);
+}
 
-	for (UINT i = 0; i < 64; i+=2)
+//NEC and SIRC
+static CIR_FRAME_STATUS CirDecodePulse(const CIR_PROTOCOL_DESC* Desc, PCIR_PROTOCOL_STATE State, BOOLEAN IsMark, ULONG Duration, PCIR_CODE Code)
+{
+	UINT8 bit;
+
+	switch (State->Phase)
 	{
-		BOOL b = (Data[i + 4] / Data[i + 3]) >= 2 ? 1 : 0;
-		tmp = tmp << 1;
-		tmp |= b;
+	case CIR_PHASE_HEADER_SPACE:
+		if (IsMark)
+			break;
+
+		if (CirMatch(Duration, Desc->HeaderSpace))
+		{
+			CirStartBits(Desc, State, CIR_PHASE_BIT_MARK);
+			return CirFrameIncomplete;
+		}
+
+		if (Desc->RepeatSpace != 0 && CirMatch(Duration, Desc->RepeatSpace) && State->IsLastValid)
+		{
+			*Code = State->Last;
+			Code->IsRepeat = TRUE;
+			return CirFrameComplete;
+		}
+		break;
+
+	case CIR_PHASE_BIT_MARK:
+		if (!IsMark)
+			break;
+
+		if (Desc->Encoding == CirEncodingPulseWidth)
+		{
+			if (CirMatch(Duration, Desc->Unit * Desc->OneUnits))
+				bit = 1;
+			else if (CirMatch(Duration, Desc->Unit))
+				bit = 0;
+			else
+				break;
+
+			State->Phase = CIR_PHASE_BIT_SPACE;
+			return CirAppendBit(Desc, State, bit, Code);
+		}
+
+		if (!CirMatch(Duration, Desc->Unit))
+			break;
+
+		State->Phase = CIR_PHASE_BIT_SPACE;
+		return CirFrameIncomplete;
+
+	case CIR_PHASE_BIT_SPACE:
+		if (IsMark)
+			break;
+
+		if (Desc->Encoding == CirEncodingPulseWidth)
+		{
+			if (CirMatch(Duration, Desc->Unit))
+			{
+				State->Phase = CIR_PHASE_BIT_MARK;
+				return CirFrameIncomplete;
+			}
+
+			//Frames of different lengths share the same timing, the gap tells where they end
+			if (Duration >= CIR_GAP_US)
+				return Desc->Check(State, TRUE, Code);
+			break;
+		}
+
+		if (CirMatch(Duration, Desc->Unit * Desc->OneUnits))
+			bit = 1;
+		else if (CirMatch(Duration, Desc->Unit))
+			bit = 0;
+		else
+			break;
+
+		State->Phase = CIR_PHASE_BIT_MARK;
+		return CirAppendBit(Desc, State, bit, Code);
+
+	default:
+		break;
 	}
 
-	dataNot = tmp & 0xFF;
-	tmp = tmp >> 8;
-	data = tmp & 0xFF;
-	tmp = tmp >> 8;
-	addr = tmp & 0xFF;
-	addrCompare = (UINT8)(tmp >> 8);
+	//Not part of the frame in progress, but may be the header of a new one
+	State->Phase = CIR_PHASE_IDLE;
+	if (IsMark && CirMatch(Duration, Desc->HeaderMark))
+	{
+		State->Phase = CIR_PHASE_HEADER_SPACE;
+	}
 
-	if ((data & dataNot) == 0)
+	return CirFrameIncomplete;
+}
+
+//RC5 and RC6. Runs are counted in half bit units and split back into half bits, a bit
+//is complete when its second half, of opposite level to the first, has been received.
+static CIR_FRAME_STATUS CirDecodeManchester(const CIR_PROTOCOL_DESC* Desc, PCIR_PROTOCOL_STATE State, BOOLEAN IsMark, ULONG Duration, PCIR_CODE Code)
+{
+	CIR_FRAME_STATUS status;
+	ULONG units;
+	UINT8 width;
+
+	switch (State->Phase)
 	{
-		//reverse data bits
+	case CIR_PHASE_IDLE:
+		if (Desc->HeaderMark != 0)
 		{
-			data = (data & 0x55) << 1 | (data & 0xAA) >> 1;
-			data = (data & 0x33) << 2 | (data & 0xCC) >> 2;
-			data = (data & 0x0F) << 4 | (data & 0xF0) >> 4;
+			if (IsMark && CirMatch(Duration, Desc->HeaderMark))
+				State->Phase = CIR_PHASE_HEADER_SPACE;
+			return CirFrameIncomplete;
 		}
-		*DataCode = data;
+
+		if (!IsMark)
+			return CirFrameIncomplete;
+
+		//Without a header the first half of the start bit is a space that cannot be told
+		//from idle, the frame begins with its second half
+		CirStartBits(Desc, State, CIR_PHASE_MANCHESTER);
+		State->Half = 1;
+		State->FirstLevel = FALSE;
+		break;
+
+	case CIR_PHASE_HEADER_SPACE:
+		if (IsMark || !CirMatch(Duration, Desc->HeaderSpace))
+			return CirFrameInvalid;
+
+		CirStartBits(Desc, State, CIR_PHASE_MANCHESTER);
+		return CirFrameIncomplete;
+
+	default:
+		break;
 	}
-	if (addr == addrCompare)
+
+	units = (Duration + Desc->Unit / 2) / Desc->Unit;
+	if (units == 0 || units > CIR_MANCHESTER_MAX_UNITS || !CirMatch(Duration, units * Desc->Unit))
+		return CirFrameInvalid;
+
+	while (units-- != 0)
+	{
+		width = (State->Count == Desc->WideBit) ? 2 : 1;
+
+		if (State->Filled == 0)
+			State->HalfLevel = IsMark;
+		else if (State->HalfLevel != IsMark)
+			return CirFrameInvalid;
+
+		State->Filled++;
+		if (State->Filled < width)
+			continue;
+		State->Filled = 0;
+
+		if (State->Half == 0)
+		{
+			State->FirstLevel = IsMark;
+			State->Half = 1;
+			continue;
+		}
+
+		if (State->FirstLevel == IsMark)
+			return CirFrameInvalid;
+		State->Half = 0;
+
+		status = CirAppendBit(Desc, State, (State->FirstLevel == Desc->IsOneMarkFirst) ? 1 : 0, Code);
+		if (status != CirFrameIncomplete)
+			return status;
+	}
+
+	//When the last bit starts with a mark, its space half runs into the gap after the
+	//frame. The bit is known as soon as the mark ends.
+	if (IsMark && State->Half == 1 && State->Filled == 0 && State->Count + 1 == State->Length)
+	{
+		return CirAppendBit(Desc, State, Desc->IsOneMarkFirst ? 1 : 0, Code);
+	}
+
+	return CirFrameIncomplete;
+}
+
+//NEC: 8 bit address, inverted address (or high byte of an extended address), command, inverted command, LSB first
+static CIR_FRAME_STATUS CirCheckNec(PCIR_PROTOCOL_STATE State, BOOLEAN IsEnd, PCIR_CODE Code)
+{
+	UINT8 address = (UINT8)State->Bits;
+	UINT8 addressInv = (UINT8)(State->Bits >> 8);
+	UINT8 command = (UINT8)(State->Bits >> 16);
+	UINT8 commandInv = (UINT8)(State->Bits >> 24);
+
+	if (State->Count < State->Length)
+		return IsEnd ? CirFrameInvalid : CirFrameIncomplete;
+
+	if ((UINT8)(command ^ commandInv) != 0xFF)
+		return CirFrameInvalid;
+
+	Code->Protocol = CirProtocolNec;
+	Code->Address = ((UINT8)(address ^ addressInv) == 0xFF) ? address : (UINT16)(address | (addressInv << 8));
+	Code->Command = command;
+
+	return CirFrameComplete;
+}
+
+//RC5: start, field (inverted command bit 6), toggle, 5 bit address, 6 bit command, MSB first
+static CIR_FRAME_STATUS CirCheckRc5(PCIR_PROTOCOL_STATE State, BOOLEAN IsEnd, PCIR_CODE Code)
+{
+	if (State->Count < State->Length)
+		return IsEnd ? CirFrameInvalid : CirFrameIncomplete;
+
+	if (((State->Bits >> 13) & 1) == 0)
+		return CirFrameInvalid;
+
+	Code->Protocol = CirProtocolRc5;
+	Code->Address = (UINT16)((State->Bits >> 6) & 0x1F);
+	Code->Command = (UINT16)((State->Bits & 0x3F) | ((~State->Bits >> 12) & 1) << 6);
+	Code->Toggle = (UINT8)((State->Bits >> 11) & 1);
+
+	return CirFrameComplete;
+}
+
+//RC6: start, 3 bit mode, trailer (toggle), then 16 data bits in mode 0 or 32 in mode 6A, MSB first
+static CIR_FRAME_STATUS CirCheckRc6(PCIR_PROTOCOL_STATE State, BOOLEAN IsEnd, PCIR_CODE Code)
+{
+	ULONG data;
+
+	if (IsEnd)
+		return CirFrameInvalid;
+
+	if (State->Count == 1 && State->Bits != 1)
+		return CirFrameInvalid;
+
+	if (State->Count == 4)
+	{
+		switch (State->Bits & 0x7)
+		{
+		case 0:
+			State->Length = 1 + 3 + 1 + 16;
+			break;
+		case 6:
+			State->Length = 1 + 3 + 1 + 32;
+			break;
+		default:
+			return CirFrameInvalid;
+		}
+	}
+
+	if (State->Count < State->Length)
+		return CirFrameIncomplete;
+
+	data = (ULONG)State->Bits;
+
+	Code->Protocol = CirProtocolRc6;
+	Code->Toggle = (UINT8)((State->Bits >> (State->Length - 5)) & 1);
+	if (State->Length == 1 + 3 + 1 + 16)
+	{
+		Code->Address = (UINT16)((data >> 8) & 0xFF);
+		Code->Command = (UINT16)(data & 0xFF);
+	}
+	else
+	{
+		Code->Address = (UINT16)(data >> 16);
+		Code->Command = (UINT16)data;
+
+		//MCE remotes keep the trailer at zero and toggle bit 15 instead
+		if (Code->Address == 0x800F)
+		{
+			Code->Toggle = (UINT8)((Code->Command >> 15) & 1);
+			Code->Command &= 0x7FFF;
+		}
+	}
+
+	return CirFrameComplete;
+}
+
+//SIRC: 7 bit command then 5, 8 or 13 address bits, LSB first
+static CIR_FRAME_STATUS CirCheckSirc(PCIR_PROTOCOL_STATE State, BOOLEAN IsEnd, PCIR_CODE Code)
+{
+	if (!IsEnd && State->Count < State->Length)
+		return CirFrameIncomplete;
+
+	if (State->Count != 12 && State->Count != 15 && State->Count != 20)
+		return CirFrameInvalid;
+
+	Code->Protocol = CirProtocolSirc;
+	Code->Address = (UINT16)(State->Bits >> 7);
+	Code->Command = (UINT16)(State->Bits & 0x7F);
+
+	return CirFrameComplete;
+}
+
+//Pass a completed run to every protocol. Once one of them completes a frame the others are reset.
+static BOOLEAN CirDecoderRun(PCIR_DECODER Decoder, BOOLEAN IsMark, ULONG Duration, PCIR_CODE Code)
+{
+	CIR_FRAME_STATUS status;
+	PCIR_PROTOCOL_STATE state;
+	UINT i;
+	UINT j;
+
+	RtlZeroMemory(Code, sizeof(CIR_CODE));
+
+	for (i = 0; i < CIR_PROTOCOL_COUNT; i++)
+	{
+		state = &Decoder->States[i];
+
+		if (CirProtocols[i].Encoding == CirEncodingManchester)
+			status = CirDecodeManchester(&CirProtocols[i], state, IsMark, Duration, Code);
+		else
+			status = CirDecodePulse(&CirProtocols[i], state, IsMark, Duration, Code);
+
+		if (status == CirFrameInvalid)
+		{
+			state->Phase = CIR_PHASE_IDLE;
+		}
+		else if (status == CirFrameComplete)
+		{
+			if (!Code->IsRepeat)
+			{
+				state->Last = *Code;
+				state->IsLastValid = TRUE;
+			}
+
+			for (j = 0; j < CIR_PROTOCOL_COUNT; j++)
+			{
+				Decoder->States[j].Phase = CIR_PHASE_IDLE;
+			}
+
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+static BOOLEAN CirDecoderEndRun(PCIR_DECODER Decoder, PCIR_CODE Code)
+{
+	BOOLEAN isCode = FALSE;
+
+	if (Decoder->Duration != 0 && !Decoder->IsGap)
+	{
+		isCode = CirDecoderRun(Decoder, Decoder->Level == Decoder->MarkLevel, Decoder->Duration, Code);
+	}
+
+	Decoder->Duration = 0;
+	Decoder->IsGap = FALSE;
+
+	return isCode;
+}
+
+
+VOID CirDecoderReset(PCIR_DECODER Decoder)
+{
+	UINT i;
+
+	Decoder->Duration = 0;
+	Decoder->IsGap = FALSE;
+
+	for (i = 0; i < CIR_PROTOCOL_COUNT; i++)
+	{
+		Decoder->States[i].Phase = CIR_PHASE_IDLE;
+		Decoder->States[i].IsLastValid = FALSE;
+	}
+}
+
+ULONG CirDecoderFeed(PCIR_DECODER Decoder, BOOLEAN Level, ULONG Duration, PCIR_CODE Codes)
+{
+	ULONG count = 0;
+
+	if (Decoder->Duration != 0 && Level != Decoder->Level)
+	{
+		if (CirDecoderEndRun(Decoder, &Codes[count]))
+		{
+			count++;
+		}
+	}
+
+	if (!Decoder->IsMarkLevelKnown)
+	{
+		Decoder->MarkLevel = Level;
+		Decoder->IsMarkLevelKnown = TRUE;
+	}
+
+	Decoder->Level = Level;
+	Decoder->Duration += Duration;
+
+	//Report the gap after a frame as soon as it is long enough, rather than when the next frame starts
+	if (!Decoder->IsGap && Decoder->Duration >= CIR_GAP_US)
+	{
+		if (Decoder->Duration >= CIR_MAX_MARK_US)
+		{
+			Decoder->MarkLevel = !Level;
+		}
+
+		//The gap is passed on even when the run before it just ended a frame
+		if (Level != Decoder->MarkLevel)
+		{
+			Decoder->IsGap = TRUE;
+			if (CirDecoderRun(Decoder, FALSE, Decoder->Duration, &Codes[count]))
+			{
+				count++;
+			}
+		}
+	}
+
+	return count;
+}
+
+ULONG CirDecoderFlush(PCIR_DECODER Decoder, PCIR_CODE Codes)
+{
+	ULONG count = 0;
+
+	if (CirDecoderEndRun(Decoder, &Codes[count]))
+	{
+		count++;
+	}
+
+	if (CirDecoderRun(Decoder, FALSE, CIR_GAP_US, &Codes[count]))
 	{
-		*AddressCode = addr;
+		count++;
 	}
 
-}
\ No newline at end of file
+	return count;
+}
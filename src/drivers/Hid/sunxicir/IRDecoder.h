@@ -18,36 +18,92 @@
 
 #pragma once
 #include "Driver.h"
-#include "Device.h"
-
-#define SKYWORTH_ADDR_CODE 0x70
-
-#define PD6121G_NUM0 0
-#define PD6121G_NUM1 1
-#define PD6121G_NUM2 2
-#define PD6121G_NUM3 3
-#define PD6121G_NUM4 4
-#define PD6121G_NUM5 5
-#define PD6121G_NUM6 6
-#define PD6121G_NUM7 7
-#define PD6121G_NUM8 8 
-#define PD6121G_NUM9 9
-#define PD6121G_POWER 12
-#define PD6121G_MUTE 13
-#define PD6121G_MENU 17
-#define PD6121G_CH_UP 18
-#define PD6121G_CH_DOWN 19
-#define PD6121G_VOL_UP 20
-#define PD6121G_VOL_DOWN 21
-#define PD6121G_BACK 91
-#define PD6121G_HOME 120
-#define PD6121G_UP 66
-#define PD6121G_DOWN 67
-#define PD6121G_LEFT 68
-#define PD6121G_RIGHT 69
-#define PD6121G_OK 70
-
-
-
-
-VOID PD6121G_F_Decoder(_In_ ULONG* Data, _In_ UINT DataSize, _Out_ UINT8* AddressCode, _Out_ UINT8* DataCode);
+
+//Timing tolerance, a duration matches when it is within this percentage of the expected value plus a fixed margin (us)
+#define CIR_TOLERANCE_PERCENT 20
+#define CIR_TOLERANCE_US 100
+
+//A space at least this long (us) ends a frame, it is longer than any space inside a frame of the supported protocols
+#define CIR_GAP_US 6000
+
+//No mark is this long (us), a run of this length tells the space level
+#define CIR_MAX_MARK_US 12000
+
+#define CIR_PROTOCOL_COUNT 4
+
+//Codes a single sample can produce: one frame ended by the level change, another by the gap the sample starts
+#define CIR_DECODER_MAX_CODES 2
+
+typedef enum _CIR_PROTOCOL
+{
+	CirProtocolNone = 0,
+	CirProtocolNec,
+	CirProtocolRc5,
+	CirProtocolRc6,
+	CirProtocolSirc
+}CIR_PROTOCOL, *PCIR_PROTOCOL;
+
+typedef struct _CIR_CODE
+{
+	CIR_PROTOCOL Protocol;
+
+	//NEC: 8 bit, or 16 bit for extended NEC. RC5: 5 bit. RC6: 8 bit (mode 0) or 16 bit (mode 6A). SIRC: 5, 8 or 13 bit
+	UINT16 Address;
+
+	UINT16 Command;
+
+	//RC5/RC6 toggle bit, flips on every new key press
+	UINT8 Toggle;
+
+	//NEC repeat frame, Address and Command are those of the last full frame
+	BOOLEAN IsRepeat;
+}CIR_CODE, *PCIR_CODE;
+
+//Per protocol decoding state
+typedef struct _CIR_PROTOCOL_STATE
+{
+	UINT8 Phase;
+
+	//Bits received and expected
+	UINT8 Count;
+	UINT8 Length;
+
+	//Manchester: which half of the bit, units received of that half, and the levels of both halves
+	UINT8 Half;
+	UINT8 Filled;
+	BOOLEAN HalfLevel;
+	BOOLEAN FirstLevel;
+
+	UINT64 Bits;
+
+	BOOLEAN IsLastValid;
+	CIR_CODE Last;
+}CIR_PROTOCOL_STATE, *PCIR_PROTOCOL_STATE;
+
+//Streaming decoder, fed (level, duration) samples in the order they are received.
+//Consecutive samples of the same level are merged into a run, every completed run is
+//passed to all protocols at once, and a code is returned as soon as a protocol has seen
+//the last bit of a frame.
+typedef struct _CIR_DECODER
+{
+	//Run being accumulated
+	BOOLEAN Level;
+	ULONG Duration;
+
+	//The run was already reported as the gap ending a frame
+	BOOLEAN IsGap;
+
+	//Level of a mark. Taken from the first run after reset and corrected by any run too long to be a mark
+	BOOLEAN MarkLevel;
+	BOOLEAN IsMarkLevelKnown;
+
+	CIR_PROTOCOL_STATE States[CIR_PROTOCOL_COUNT];
+}CIR_DECODER, *PCIR_DECODER;
+
+
+VOID CirDecoderReset(_Inout_ PCIR_DECODER Decoder);
+
+//Both return the number of codes written to Codes
+ULONG CirDecoderFeed(_Inout_ PCIR_DECODER Decoder, _In_ BOOLEAN Level, _In_ ULONG Duration, _Out_writes_(CIR_DECODER_MAX_CODES) PCIR_CODE Codes);
+
+ULONG CirDecoderFlush(_Inout_ PCIR_DECODER Decoder, _Out_writes_(CIR_DECODER_MAX_CODES) PCIR_CODE Codes);
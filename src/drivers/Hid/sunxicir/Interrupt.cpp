@@ -27,6 +27,9 @@
 #include "Trace.h"
 #include "Interrupt.tmh"
 
+static VOID CirProcessCode(_In_ PDEVICE_CONTEXT pDevContext, _In_ PCIR_CODE Code);
+static VOID CirKeyRelease(_In_ PDEVICE_CONTEXT pDevContext);
+static BOOLEAN CirKeyIsReleaseDue(_In_ PDEVICE_CONTEXT pDevContext);
 
 NTSTATUS CirInterruptCreate(WDFDEVICE Device, PCM_PARTIAL_RESOURCE_DESCRIPTOR InterruptRaw, PCM_PARTIAL_RESOURCE_DESCRIPTOR InterruptTrans)
 {
@@ -74,13 +77,10 @@ Exit:
 	return status;
 }
 
-VOID CirInterruptClearState(ULONG * RegBase, UINT32 IntStateRegOffset, ULONG IntState)
+VOID CirInterruptClearState(volatile ULONG * RegBase, UINT32 IntStateRegOffset, ULONG IntState)
 {
-	ULONG tmp = ReadReg(RegBase, IntStateRegOffset);
-
-	tmp &= ~0xff;
-	tmp |= IntState & 0xff;
-	WRITE_REGISTER_ULONG((volatile ULONG*)((ULONG)RegBase + IntStateRegOffset), tmp);
+	//The status bits are write one to clear, the rest of the register is read only
+	WRITE_REGISTER_ULONG((volatile ULONG*)((ULONG)RegBase + IntStateRegOffset), IntState & 0xff);
 }
 
 BOOLEAN CirEvtInterruptIsr(_In_ WDFINTERRUPT Interrupt, _In_ ULONG MessageID)
@@ -101,18 +101,7 @@ BOOLEAN CirEvtInterruptIsr(_In_ WDFINTERRUPT Interrupt, _In_ ULONG MessageID)
 	pIntContext->Device = device;
 
 	intState = ReadReg(pDevContext->RegisterBase, CIR_RX_STATE_REG_OFFSET);
-	{
-		ULONG tmp = ReadReg(pDevContext->RegisterBase, CIR_RX_STATE_REG_OFFSET);
-
-		tmp &= ~0xff;
-		tmp |= intState & 0xff;
-		WRITE_REGISTER_ULONG((volatile ULONG*)((ULONG)pDevContext->RegisterBase + CIR_RX_STATE_REG_OFFSET), tmp);
-	}
-	ULONG tmp = ReadReg(pDevContext->RegisterBase, CIR_RX_STATE_REG_OFFSET);
-
-	tmp &= ~0xff;
-	tmp |= intState & 0xff;
-	WRITE_REGISTER_ULONG((volatile ULONG*)((ULONG)pDevContext->RegisterBase + CIR_RX_STATE_REG_OFFSET), tmp);
+	CirInterruptClearState(pDevContext->RegisterBase, CIR_RX_STATE_REG_OFFSET, intState);
 
 	pIntContext->IsFifoOverrun = ((intState >> CIR_RX_STATE_ROI_MASK) & CIR_RX_STATE_ROI) ? TRUE : FALSE;
 	pIntContext->IsPacketEnd = ((intState >> CIR_RX_STATE_RPE_MASK) & CIR_RX_STATE_RPE) ? TRUE : FALSE;
@@ -131,61 +120,29 @@ BOOLEAN CirEvtInterruptIsr(_In_ WDFINTERRUPT Interrupt, _In_ ULONG MessageID)
 	WRITE_REGISTER_ULONG((volatile ULONG*)((ULONG)pDevContext->RegisterBase + 0x20), 0x0);
 
 
-	BOOL pulseNow = 0;
-	ULONG irDuration = 0;
+	PCIR_PULSE_RING ring = &pDevContext->PulseRing;
 
 	int i = 0;
 	for (i = 0; i < pIntContext->DataCount; i++)
 	{
 		ULONG data = ReadReg(pDevContext->RegisterBase, CIR_RXFIFO_REG_OFFSET);
 
-		pulseNow = data >> 7;
-		irDuration = data & 0x7f;
-
-		if (pDevContext->PulsePrevious == pulseNow)
-		{
-			pDevContext->DataBuffer[pDevContext->DataSize] = irDuration;
-			pDevContext->PulseBuffer[pDevContext->DataSize] = pulseNow;
-			pDevContext->DataSize++;
-		}
-		else
-		{
-			if (pDevContext->IsReceiving)
-			{
-				pDevContext->DataBuffer[pDevContext->DataSize] = irDuration;
-				pDevContext->PulseBuffer[pDevContext->DataSize] = pulseNow;
-				pDevContext->DataSize++;
-			}
-			else
-			{
-				pDevContext->IsReceiving = TRUE;
-
-				pDevContext->DataSize = 0;
-
-				pDevContext->DataBuffer[pDevContext->DataSize] = irDuration;
-				pDevContext->PulseBuffer[pDevContext->DataSize] = pulseNow;
-				pDevContext->DataSize++;
-			}
-			pDevContext->PulsePrevious = pulseNow;
-		}
-
-
+		CirPulseRingQueue(ring, (USHORT)(data & 0xff));
 	}
 
-
-
 	if (pIntContext->IsPacketEnd)
 	{
-		if (pDevContext->DataSize > 70)
-			WdfInterruptQueueDpcForIsr(Interrupt);
-		pDevContext->IsReceiving = FALSE;
+		CirPulseRingQueue(ring, CIR_PULSE_FRAME_END);
+		ring->Frames++;
 	}
 	if (pIntContext->IsFifoOverrun)
 	{
-		pDevContext->IsReceiving = 0;
-		pDevContext->PulsePrevious = 0;
+		CirPulseRingQueue(ring, CIR_PULSE_RESET);
+		ring->FifoOverruns++;
 	}
 
+	WdfInterruptQueueDpcForIsr(Interrupt);
+
 	return TRUE;
 }
 
@@ -193,8 +150,11 @@ void CirEvtInterruptDpc(_In_ WDFINTERRUPT Interrupt, _In_ WDFOBJECT AssociatedOb
 {
 	PDEVICE_CONTEXT pDevContext = NULL;
 	PINTERRUPT_CONTEXT pIntContext = NULL;
-	UINT8 dataCode = 0;
-	UINT8 addrCode = 0;
+	PCIR_PULSE_RING ring = NULL;
+	CIR_CODE codes[CIR_DECODER_MAX_CODES];
+	ULONG codeCount = 0;
+	ULONG i = 0;
+	USHORT entry = 0;
 
 	UNREFERENCED_PARAMETER(AssociatedObject);
 
@@ -203,91 +163,119 @@ void CirEvtInterruptDpc(_In_ WDFINTERRUPT Interrupt, _In_ WDFOBJECT AssociatedOb
 	pIntContext = InterruptGetContext(Interrupt);
 	pDevContext = DeviceGetContext(pIntContext->Device);
 
+	ring = &pDevContext->PulseRing;
 
-	PD6121G_F_Decoder(pDevContext->DataBuffer, pDevContext->DataSize, &addrCode, &dataCode);
-
-	pDevContext->DataSize = 0;
-	if (addrCode == SKYWORTH_ADDR_CODE)
+	//The ISR and the key release timer may queue this DPC again while it runs, only one instance drains the ring.
+	//Check again after letting go, entries queued in between would otherwise wait for the next interrupt.
+	while (CirPulseRingBeginDrain(ring))
 	{
-		DbgPrint_I("Received data: %d", dataCode);
-		
-		switch (dataCode)
+		while (CirPulseRingTake(ring, &entry))
+		{
+			if (entry == CIR_PULSE_RESET)
+			{
+				DbgPrint_I("Frame dropped, FIFO overruns %d ring overruns %d", ring->FifoOverruns, ring->RingOverruns);
+				CirDecoderReset(&pDevContext->Decoder);
+				continue;
+			}
+
+			if (entry == CIR_PULSE_FRAME_END)
+			{
+				codeCount = CirDecoderFlush(&pDevContext->Decoder, codes);
+			}
+			else
+			{
+				codeCount = CirDecoderFeed(&pDevContext->Decoder,
+					(entry >> CIR_RXFIFO_LEVEL_SHIFT) & 0x1,
+					CIR_SAMPLES_TO_US((entry & CIR_RXFIFO_COUNT_MASK) + 1),
+					codes);
+			}
+
+			for (i = 0; i < codeCount; i++)
+			{
+				CirProcessCode(pDevContext, &codes[i]);
+			}
+		}
+
+		if (CirKeyIsReleaseDue(pDevContext))
+		{
+			CirKeyRelease(pDevContext);
+		}
+
+		CirPulseRingEndDrain(ring);
+
+		if (CirPulseRingIsEmpty(ring) && !CirKeyIsReleaseDue(pDevContext))
 		{
-		case PD6121G_NUM0:
-			InjectUnicode('0', pDevContext);
-			break;
-		case PD6121G_NUM1:
-			InjectUnicode('1', pDevContext);
-			break;
-		case PD6121G_NUM2:
-			InjectUnicode('2', pDevContext);
-			break;
-		case PD6121G_NUM3:
-			InjectUnicode('3', pDevContext);
-			break;
-		case PD6121G_NUM4:
-			InjectUnicode('4', pDevContext);
-			break;
-		case PD6121G_NUM5:
-			InjectUnicode('5', pDevContext);
-			break;
-		case PD6121G_NUM6:
-			InjectUnicode('6', pDevContext);
-			break;
-		case PD6121G_NUM7:
-			InjectUnicode('7', pDevContext);
-			break;
-		case PD6121G_NUM8:
-			InjectUnicode('8', pDevContext);
-			break;
-		case PD6121G_NUM9:
-			InjectUnicode('9', pDevContext);
-			break;
-		case PD6121G_POWER:
-			break;
-		case PD6121G_MUTE:
-			InjectKeyDown(VK_VOLUME_MUTE, pDevContext);
-			InjectKeyUp(VK_VOLUME_MUTE, pDevContext);
-			break;
-		case PD6121G_MENU:
-			break;
-		case PD6121G_CH_UP:
-			break;
-		case PD6121G_CH_DOWN:
-			break;
-		case PD6121G_VOL_UP:
-			InjectKeyDown(VK_VOLUME_UP, pDevContext);
-			InjectKeyUp(VK_VOLUME_UP, pDevContext);
-			break;
-		case PD6121G_VOL_DOWN:
-			InjectKeyDown(VK_VOLUME_DOWN, pDevContext);
-			InjectKeyUp(VK_VOLUME_DOWN, pDevContext);
-			break;
-		case PD6121G_BACK:
-			break;
-		case PD6121G_HOME:
-			break;
-		case PD6121G_UP:
-			InjectKeyDown(VK_UP, pDevContext);
-			InjectKeyUp(VK_UP, pDevContext);
-			break;
-		case PD6121G_DOWN:
-			InjectKeyDown(VK_DOWN, pDevContext);
-			InjectKeyUp(VK_DOWN, pDevContext);
-			break;
-		case PD6121G_LEFT:
-			InjectKeyDown(VK_LEFT, pDevContext);
-			InjectKeyUp(VK_LEFT, pDevContext);
-			break;
-		case PD6121G_RIGHT:
-			InjectKeyDown(VK_RIGHT, pDevContext);
-			InjectKeyUp(VK_RIGHT, pDevContext);
-			break;
-		case PD6121G_OK:
-			InjectKeyDown(VK_RETURN, pDevContext);
-			InjectKeyUp(VK_RETURN, pDevContext);
 			break;
 		}
 	}
+}
+
+static VOID CirKeyInject(PDEVICE_CONTEXT pDevContext, PCIR_KEY_EVENT Events, ULONG EventCount)
+{
+	ULONG i;
+
+	for (i = 0; i < EventCount; i++)
+	{
+		if (Events[i].IsDown)
+		{
+			InjectKeyDown(Events[i].VirtualKey, pDevContext);
+		}
+		else
+		{
+			InjectKeyUp(Events[i].VirtualKey, pDevContext);
+		}
+	}
 
+	//The events of one frame, a release and the next press, go out as one write
+	InjectChannelFlush(pDevContext);
+}
+
+static VOID CirKeyRelease(PDEVICE_CONTEXT pDevContext)
+{
+	CIR_KEY_EVENT event;
+
+	CirKeyInject(pDevContext, &event, CirKeyStateRelease(&pDevContext->Key, &event));
+}
+
+static BOOLEAN CirKeyIsReleaseDue(PDEVICE_CONTEXT pDevContext)
+{
+	return CirKeyStateIsReleaseDue(&pDevContext->Key, KeQueryInterruptTime());
+}
+
+static VOID CirProcessCode(PDEVICE_CONTEXT pDevContext, PCIR_CODE Code)
+{
+	ULONGLONG now = KeQueryInterruptTime();
+	PCIR_KEY_STATE key = &pDevContext->Key;
+	CIR_KEY_EVENT events[CIR_KEY_MAX_EVENTS];
+	ULONG eventCount = 0;
+
+	DbgPrint_I("Received protocol %d address 0x%x command 0x%x%s", Code->Protocol, Code->Address, Code->Command, Code->IsRepeat ? " (repeat)" : "");
+
+	eventCount = CirKeyStateProcessCode(key, &pDevContext->Keymap, Code, now, events);
+	CirKeyInject(pDevContext, events, eventCount);
+
+	//Every frame of the held key moves the deadline out, the timer queues the DPC when it passes
+	if (key->IsDown && key->ReleaseTime > now)
+	{
+		WdfTimerStart(pDevContext->KeyReleaseTimer, WDF_REL_TIMEOUT_IN_US((key->ReleaseTime - now) / 10));
+	}
+}
+
+VOID CirKeyReleaseNow(WDFDEVICE Device)
+{
+	PDEVICE_CONTEXT pDevContext = DeviceGetContext(Device);
+
+	WdfTimerStop(pDevContext->KeyReleaseTimer, TRUE);
+	CirKeyRelease(pDevContext);
+}
+
+VOID CirEvtKeyReleaseTimer(_In_ WDFTIMER Timer)
+{
+	PDEVICE_CONTEXT pDevContext = DeviceGetContext(WdfTimerGetParentObject(Timer));
+
+	//Releasing from the DPC keeps every key event in one place
+	if (pDevContext->Interrupt != NULL)
+	{
+		WdfInterruptQueueDpcForIsr(pDevContext->Interrupt);
+	}
 }
@@ -18,6 +18,7 @@
 
 #pragma once
 #include "Driver.h"
+#include "PulseRing.h"
 
 typedef struct _INTERRUPT_CONTEXT
 {
@@ -39,4 +40,8 @@ EVT_WDF_INTERRUPT_ISR CirEvtInterruptIsr;
 
 EVT_WDF_INTERRUPT_DPC CirEvtInterruptDpc;
 
+EVT_WDF_TIMER CirEvtKeyReleaseTimer;
+
+VOID CirKeyReleaseNow(_In_ WDFDEVICE Device);
+
 
@@ -0,0 +1,301 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+#include "Keymap.h"
+#include "WinVK.h"
+
+#include "Trace.h"
+#include "Keymap.tmh"
+
+#ifdef ALLOC_PRAGMA
+#pragma alloc_text (PAGE, CirKeymapLoad)
+#endif
+
+static const CIR_KEYMAP_ENTRY SkyworthKeymap[] =
+{
+	{ CirProtocolNec, '0', SKYWORTH_ADDR_CODE, PD6121G_NUM0, 0 },
+	{ CirProtocolNec, '1', SKYWORTH_ADDR_CODE, PD6121G_NUM1, 0 },
+	{ CirProtocolNec, '2', SKYWORTH_ADDR_CODE, PD6121G_NUM2, 0 },
+	{ CirProtocolNec, '3', SKYWORTH_ADDR_CODE, PD6121G_NUM3, 0 },
+	{ CirProtocolNec, '4', SKYWORTH_ADDR_CODE, PD6121G_NUM4, 0 },
+	{ CirProtocolNec, '5', SKYWORTH_ADDR_CODE, PD6121G_NUM5, 0 },
+	{ CirProtocolNec, '6', SKYWORTH_ADDR_CODE, PD6121G_NUM6, 0 },
+	{ CirProtocolNec, '7', SKYWORTH_ADDR_CODE, PD6121G_NUM7, 0 },
+	{ CirProtocolNec, '8', SKYWORTH_ADDR_CODE, PD6121G_NUM8, 0 },
+	{ CirProtocolNec, '9', SKYWORTH_ADDR_CODE, PD6121G_NUM9, 0 },
+	{ CirProtocolNec, VK_VOLUME_MUTE, SKYWORTH_ADDR_CODE, PD6121G_MUTE, 0 },
+	{ CirProtocolNec, VK_VOLUME_UP, SKYWORTH_ADDR_CODE, PD6121G_VOL_UP, 0 },
+	{ CirProtocolNec, VK_VOLUME_DOWN, SKYWORTH_ADDR_CODE, PD6121G_VOL_DOWN, 0 },
+	{ CirProtocolNec, VK_UP, SKYWORTH_ADDR_CODE, PD6121G_UP, 0 },
+	{ CirProtocolNec, VK_DOWN, SKYWORTH_ADDR_CODE, PD6121G_DOWN, 0 },
+	{ CirProtocolNec, VK_LEFT, SKYWORTH_ADDR_CODE, PD6121G_LEFT, 0 },
+	{ CirProtocolNec, VK_RIGHT, SKYWORTH_ADDR_CODE, PD6121G_RIGHT, 0 },
+	{ CirProtocolNec, VK_RETURN, SKYWORTH_ADDR_CODE, PD6121G_OK, 0 },
+};
+
+static ULONG CirKeymapHash(UINT8 Protocol, UINT16 Address, UINT16 Command)
+{
+	ULONG key = ((ULONG)Protocol << 28) ^ ((ULONG)Address << 12) ^ Command;
+
+	//Multiplicative hash, the top bits index the table
+	return (key * 0x9E3779B1) >> 24;
+}
+
+static BOOLEAN CirKeymapInsert(PCIR_KEYMAP Keymap, const CIR_KEYMAP_ENTRY* Entry)
+{
+	ULONG slot = CirKeymapHash(Entry->Protocol, Entry->Address, Entry->Command);
+	PCIR_KEYMAP_ENTRY cur;
+
+	for (;; slot = (slot + 1) & (CIR_KEYMAP_SLOTS - 1))
+	{
+		cur = &Keymap->Slots[slot];
+
+		if (cur->VirtualKey == 0)
+		{
+			if (Keymap->Count >= CIR_KEYMAP_MAX_ENTRIES)
+			{
+				return FALSE;
+			}
+			Keymap->Count++;
+			break;
+		}
+
+		if (cur->Protocol == Entry->Protocol && cur->Address == Entry->Address && cur->Command == Entry->Command)
+		{
+			break;
+		}
+	}
+
+	*cur = *Entry;
+	cur->Reserved = 0;
+
+	return TRUE;
+}
+
+NTSTATUS CirKeymapLoad(WDFDEVICE Device, PCIR_KEYMAP Keymap)
+{
+	NTSTATUS status;
+	WDFKEY key = NULL;
+	WDFMEMORY memory = NULL;
+	PCIR_KEYMAP_ENTRY entries = NULL;
+	size_t length = 0;
+	ULONG count = 0;
+	ULONG type = 0;
+	ULONG i = 0;
+	DECLARE_CONST_UNICODE_STRING(valueName, CIR_KEYMAP_VALUE_NAME);
+
+	PAGED_CODE();
+	FunctionEnter();
+
+	RtlZeroMemory(Keymap, sizeof(CIR_KEYMAP));
+
+	status = WdfDeviceOpenRegistryKey(Device, PLUGPLAY_REGKEY_DEVICE, KEY_READ, WDF_NO_OBJECT_ATTRIBUTES, &key);
+	if (NT_SUCCESS(status))
+	{
+		status = WdfRegistryQueryMemory(key, &valueName, PagedPool, WDF_NO_OBJECT_ATTRIBUTES, &memory, &type);
+		WdfRegistryClose(key);
+	}
+
+	if (NT_SUCCESS(status))
+	{
+		entries = (PCIR_KEYMAP_ENTRY)WdfMemoryGetBuffer(memory, &length);
+		count = (ULONG)(length / sizeof(CIR_KEYMAP_ENTRY));
+
+		if (type != REG_BINARY || count == 0 || length % sizeof(CIR_KEYMAP_ENTRY) != 0)
+		{
+			DbgPrint_E("Invalid keymap, type %d length %d", type, (ULONG)length);
+			count = 0;
+		}
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		if (entries[i].VirtualKey == 0)
+		{
+			continue;
+		}
+
+		if (!CirKeymapInsert(Keymap, &entries[i]))
+		{
+			DbgPrint_E("Keymap full, %d of %d entries loaded", i, count);
+			break;
+		}
+	}
+
+	if (memory != NULL)
+	{
+		WdfObjectDelete(memory);
+	}
+
+	if (Keymap->Count == 0)
+	{
+		for (i = 0; i < ARRAYSIZE(SkyworthKeymap); i++)
+		{
+			CirKeymapInsert(Keymap, &SkyworthKeymap[i]);
+		}
+	}
+
+	DbgPrint_I("Keymap loaded, %d keys", Keymap->Count);
+
+	return STATUS_SUCCESS;
+}
+
+UINT8 CirKeymapLookup(PCIR_KEYMAP Keymap, PCIR_CODE Code)
+{
+	ULONG slot = CirKeymapHash((UINT8)Code->Protocol, Code->Address, Code->Command);
+	PCIR_KEYMAP_ENTRY cur;
+
+	//The table is never full, a free slot ends the probe
+	for (;; slot = (slot + 1) & (CIR_KEYMAP_SLOTS - 1))
+	{
+		cur = &Keymap->Slots[slot];
+
+		if (cur->VirtualKey == 0)
+		{
+			return 0;
+		}
+
+		if (cur->Protocol == Code->Protocol && cur->Address == Code->Address && cur->Command == Code->Command)
+		{
+			return cur->VirtualKey;
+		}
+	}
+}
+
+//Release timeout in ms
+static ULONG CirKeyStateReleaseTimeout(PCIR_KEY_STATE Key)
+{
+	ULONG timeout = CIR_KEY_RELEASE_TIMEOUT_MS;
+
+	if (Key->RepeatIntervalMs != 0)
+	{
+		timeout = Key->RepeatIntervalMs * 2;
+		timeout = max(timeout, CIR_KEY_RELEASE_MIN_MS);
+		timeout = min(timeout, CIR_KEY_RELEASE_MAX_MS);
+	}
+
+	return timeout;
+}
+
+//Push the release deadline out by the timeout
+static VOID CirKeyStateArmRelease(PCIR_KEY_STATE Key, ULONGLONG Now)
+{
+	Key->LastFrameTime = Now;
+	Key->ReleaseTime = Now + CirKeyStateReleaseTimeout(Key) * 10000ULL;
+}
+
+static ULONG CirKeyStatePress(PCIR_KEY_STATE Key, PCIR_CODE Code, UINT8 VirtualKey, ULONGLONG Now, PCIR_KEY_EVENT Event)
+{
+	Key->IsDown = TRUE;
+	Key->VirtualKey = VirtualKey;
+	Key->Code = *Code;
+	Key->RepeatIntervalMs = 0;
+
+	CirKeyStateArmRelease(Key, Now);
+
+	Event->VirtualKey = VirtualKey;
+	Event->IsDown = TRUE;
+
+	return 1;
+}
+
+//A repeat frame, or the same frame again, while the key is down. The key stays down and
+//Windows applies its own typematic repeat, only the release deadline moves.
+static VOID CirKeyStateHold(PCIR_KEY_STATE Key, ULONGLONG Now)
+{
+	ULONG interval = (ULONG)((Now - Key->LastFrameTime) / 10000);
+
+	if (Key->RepeatIntervalMs == 0)
+	{
+		Key->RepeatIntervalMs = interval;
+	}
+	else
+	{
+		Key->RepeatIntervalMs = (Key->RepeatIntervalMs * 3 + interval) / 4;
+	}
+
+	CirKeyStateArmRelease(Key, Now);
+}
+
+//NEC remotes send repeat frames while a key is held, RC5/RC6 resend the frame with the same
+//toggle and SIRC resends it unchanged. A new NEC frame is always a new press.
+static BOOLEAN CirKeyStateIsHeld(PCIR_KEY_STATE Key, PCIR_CODE Code)
+{
+	if (!Key->IsDown || Key->Code.Protocol != Code->Protocol)
+	{
+		return FALSE;
+	}
+
+	if (Code->IsRepeat)
+	{
+		return TRUE;
+	}
+
+	return Code->Protocol != CirProtocolNec &&
+		Key->Code.Address == Code->Address &&
+		Key->Code.Command == Code->Command &&
+		Key->Code.Toggle == Code->Toggle;
+}
+
+ULONG CirKeyStateRelease(PCIR_KEY_STATE Key, PCIR_KEY_EVENT Event)
+{
+	if (!Key->IsDown)
+	{
+		return 0;
+	}
+
+	Key->IsDown = FALSE;
+
+	Event->VirtualKey = Key->VirtualKey;
+	Event->IsDown = FALSE;
+
+	return 1;
+}
+
+BOOLEAN CirKeyStateIsReleaseDue(PCIR_KEY_STATE Key, ULONGLONG Now)
+{
+	return Key->IsDown && Now + CIR_KEY_RELEASE_SLACK_MS * 10000ULL >= Key->ReleaseTime;
+}
+
+ULONG CirKeyStateProcessCode(PCIR_KEY_STATE Key, PCIR_KEYMAP Keymap, PCIR_CODE Code, ULONGLONG Now, PCIR_KEY_EVENT Events)
+{
+	ULONG eventCount = 0;
+	UINT8 virtualKey = 0;
+
+	if (CirKeyStateIsHeld(Key, Code))
+	{
+		CirKeyStateHold(Key, Now);
+		return 0;
+	}
+
+	//A repeat of a key that was released or never mapped
+	if (Code->IsRepeat)
+	{
+		return 0;
+	}
+
+	eventCount = CirKeyStateRelease(Key, &Events[0]);
+
+	virtualKey = CirKeymapLookup(Keymap, Code);
+	if (virtualKey != 0)
+	{
+		eventCount += CirKeyStatePress(Key, Code, virtualKey, Now, &Events[eventCount]);
+	}
+
+	return eventCount;
+}
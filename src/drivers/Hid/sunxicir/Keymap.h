@@ -0,0 +1,115 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+#pragma once
+#include "Driver.h"
+#include "IRDecoder.h"
+
+//NEC extended address of the Skyworth remote (PD6121G-F), custom code 0x0E sent twice
+#define SKYWORTH_ADDR_CODE 0x0E0E
+
+#define PD6121G_NUM0 0
+#define PD6121G_NUM1 1
+#define PD6121G_NUM2 2
+#define PD6121G_NUM3 3
+#define PD6121G_NUM4 4
+#define PD6121G_NUM5 5
+#define PD6121G_NUM6 6
+#define PD6121G_NUM7 7
+#define PD6121G_NUM8 8
+#define PD6121G_NUM9 9
+#define PD6121G_MUTE 13
+#define PD6121G_VOL_UP 20
+#define PD6121G_VOL_DOWN 21
+#define PD6121G_UP 66
+#define PD6121G_DOWN 67
+#define PD6121G_LEFT 68
+#define PD6121G_RIGHT 69
+#define PD6121G_OK 70
+
+
+//Registry value under the device key holding the keymaps of all supported remotes,
+//REG_BINARY, an array of CIR_KEYMAP_ENTRY. The Skyworth keymap is used when it is absent.
+#define CIR_KEYMAP_VALUE_NAME L"Keymap"
+
+//Hash table slots, a power of two, and the most entries kept to bound probe lengths
+#define CIR_KEYMAP_SLOTS 256
+#define CIR_KEYMAP_MAX_ENTRIES 192
+
+//Release timeout before the repeat interval of the remote is known, and the bounds of the
+//timeout once it is, in ms. The timeout is twice the interval between repeated frames.
+#define CIR_KEY_RELEASE_TIMEOUT_MS 200
+#define CIR_KEY_RELEASE_MIN_MS 60
+#define CIR_KEY_RELEASE_MAX_MS 300
+
+//The release timer may fire up to a clock tick before the deadline, in ms
+#define CIR_KEY_RELEASE_SLACK_MS 16
+
+typedef struct _CIR_KEYMAP_ENTRY
+{
+	UINT8 Protocol;		//CIR_PROTOCOL
+	UINT8 VirtualKey;	//0 marks a free slot
+	UINT16 Address;
+	UINT16 Command;
+	UINT16 Reserved;
+}CIR_KEYMAP_ENTRY, *PCIR_KEYMAP_ENTRY;
+
+typedef struct _CIR_KEYMAP
+{
+	ULONG Count;
+	CIR_KEYMAP_ENTRY Slots[CIR_KEYMAP_SLOTS];
+}CIR_KEYMAP, *PCIR_KEYMAP;
+
+//Key held down by the remote, owned by the DPC
+typedef struct _CIR_KEY_STATE
+{
+	BOOLEAN IsDown;
+	UINT8 VirtualKey;
+
+	//Frame that pressed the key
+	CIR_CODE Code;
+
+	//Interrupt time (100ns) of the last frame for the key and of the release deadline
+	ULONGLONG LastFrameTime;
+	ULONGLONG ReleaseTime;
+
+	//Smoothed interval between repeated frames, 0 until the first repeat
+	ULONG RepeatIntervalMs;
+}CIR_KEY_STATE, *PCIR_KEY_STATE;
+
+//Key events a code leads to, the release of the held key and a press at most
+#define CIR_KEY_MAX_EVENTS 2
+
+typedef struct _CIR_KEY_EVENT
+{
+	UINT8 VirtualKey;
+	BOOLEAN IsDown;
+}CIR_KEY_EVENT, *PCIR_KEY_EVENT;
+
+
+NTSTATUS CirKeymapLoad(_In_ WDFDEVICE Device, _Out_ PCIR_KEYMAP Keymap);
+
+UINT8 CirKeymapLookup(_In_ PCIR_KEYMAP Keymap, _In_ PCIR_CODE Code);
+
+//Key state machine, driven by the DPC with the interrupt time (100ns). The caller injects the
+//events and arms the release timer for Key->ReleaseTime while the key is down.
+ULONG CirKeyStateProcessCode(_Inout_ PCIR_KEY_STATE Key, _In_ PCIR_KEYMAP Keymap, _In_ PCIR_CODE Code, _In_ ULONGLONG Now, _Out_writes_(CIR_KEY_MAX_EVENTS) PCIR_KEY_EVENT Events);
+
+ULONG CirKeyStateRelease(_Inout_ PCIR_KEY_STATE Key, _Out_ PCIR_KEY_EVENT Event);
+
+BOOLEAN CirKeyStateIsReleaseDue(_In_ PCIR_KEY_STATE Key, _In_ ULONGLONG Now);
@@ -0,0 +1,99 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+#include "PulseRing.h"
+
+VOID CirPulseRingReset(PCIR_PULSE_RING Ring)
+{
+	Ring->Head = 0;
+	Ring->Tail = 0;
+	Ring->IsDraining = 0;
+	Ring->IsOverrun = FALSE;
+}
+
+static BOOLEAN CirPulseRingPush(PCIR_PULSE_RING Ring, USHORT Entry)
+{
+	ULONG head = Ring->Head;
+
+	if (head - Ring->Tail >= CIR_PULSE_RING_LENGTH)
+	{
+		return FALSE;
+	}
+
+	Ring->Entries[head & (CIR_PULSE_RING_LENGTH - 1)] = Entry;
+
+	//Publish the entry before the new head
+	KeMemoryBarrier();
+	Ring->Head = head + 1;
+
+	return TRUE;
+}
+
+VOID CirPulseRingQueue(PCIR_PULSE_RING Ring, USHORT Entry)
+{
+	if (Ring->IsOverrun)
+	{
+		if (!CirPulseRingPush(Ring, CIR_PULSE_RESET))
+		{
+			Ring->RingOverruns++;
+			return;
+		}
+		Ring->IsOverrun = FALSE;
+	}
+
+	if (!CirPulseRingPush(Ring, Entry))
+	{
+		Ring->IsOverrun = TRUE;
+		Ring->RingOverruns++;
+	}
+}
+
+BOOLEAN CirPulseRingBeginDrain(PCIR_PULSE_RING Ring)
+{
+	return InterlockedCompareExchange(&Ring->IsDraining, 1, 0) == 0;
+}
+
+BOOLEAN CirPulseRingTake(PCIR_PULSE_RING Ring, PUSHORT Entry)
+{
+	ULONG tail = Ring->Tail;
+
+	if (tail == Ring->Head)
+	{
+		return FALSE;
+	}
+
+	//Read the entry after the head that published it
+	KeMemoryBarrier();
+	*Entry = Ring->Entries[tail & (CIR_PULSE_RING_LENGTH - 1)];
+
+	//Hand the slot back before the caller decodes the entry
+	KeMemoryBarrier();
+	Ring->Tail = tail + 1;
+
+	return TRUE;
+}
+
+VOID CirPulseRingEndDrain(PCIR_PULSE_RING Ring)
+{
+	InterlockedExchange(&Ring->IsDraining, 0);
+}
+
+BOOLEAN CirPulseRingIsEmpty(PCIR_PULSE_RING Ring)
+{
+	return Ring->Head == Ring->Tail;
+}
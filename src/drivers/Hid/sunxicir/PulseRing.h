@@ -0,0 +1,66 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+#pragma once
+#include "Driver.h"
+
+//Pulse ring between the ISR and the DPC, a power of two
+#define CIR_PULSE_RING_LENGTH 512
+
+//Ring entries are RX FIFO samples (bits 0-7) or one of these markers
+#define CIR_PULSE_FRAME_END 0x100	//receiver went idle, the frame is complete
+#define CIR_PULSE_RESET 0x200		//samples were lost, drop the frame in progress
+
+//Single producer (ISR), single consumer (DPC). Head and Tail are free running,
+//only the ISR writes Head and only the DPC writes Tail, so neither side takes a lock.
+typedef struct _CIR_PULSE_RING
+{
+	volatile ULONG Head;
+	volatile ULONG Tail;
+
+	//Set while a DPC drains the ring, a second instance on another processor backs off
+	volatile LONG IsDraining;
+
+	//Entries were dropped, a reset marker is queued before the next entry
+	BOOLEAN IsOverrun;
+
+	USHORT Entries[CIR_PULSE_RING_LENGTH];
+
+	//RX FIFO overruns reported by the controller
+	ULONG FifoOverruns;
+
+	//Entries dropped because the ring was full
+	ULONG RingOverruns;
+
+	ULONG Frames;
+}CIR_PULSE_RING, *PCIR_PULSE_RING;
+
+VOID CirPulseRingReset(_Inout_ PCIR_PULSE_RING Ring);
+
+//Producer side, called from the ISR only. Drops the entry and counts it when the ring is full.
+VOID CirPulseRingQueue(_Inout_ PCIR_PULSE_RING Ring, _In_ USHORT Entry);
+
+//Consumer side. Only the instance that begins the drain may take entries, it ends the drain when done
+//and checks the ring again, entries queued in between would otherwise wait for the next interrupt.
+BOOLEAN CirPulseRingBeginDrain(_Inout_ PCIR_PULSE_RING Ring);
+
+BOOLEAN CirPulseRingTake(_Inout_ PCIR_PULSE_RING Ring, _Out_ PUSHORT Entry);
+
+VOID CirPulseRingEndDrain(_Inout_ PCIR_PULSE_RING Ring);
+
+BOOLEAN CirPulseRingIsEmpty(_In_ PCIR_PULSE_RING Ring);
@@ -23,72 +23,197 @@
 HIDINJECTOR_INPUT_REPORT KeyboardState = { 0 };
 HIDINJECTOR_INPUT_REPORT MouseState = { 0 };
 
-NTSTATUS SendHidReport(HIDINJECTOR_INPUT_REPORT * Report, PDEVICE_CONTEXT pDevContext)
+static EVT_WDF_REQUEST_COMPLETION_ROUTINE InjectChannelCompletion;
+
+NTSTATUS InjectChannelInitialize(PDEVICE_CONTEXT pDevContext)
 {
-	NTSTATUS status = STATUS_SUCCESS;
-	PUCHAR buffer;
-	ULONG bufferLength;
-	ULONG_PTR bufferWrittenLen;
-	WDF_MEMORY_DESCRIPTOR memoryDescriptor;
-	WDFMEMORY memWrite = NULL;
+	NTSTATUS status;
+	PHID_INJECT_CHANNEL channel = &pDevContext->HidChannel;
+	WDF_OBJECT_ATTRIBUTES attr;
+
+	WDF_OBJECT_ATTRIBUTES_INIT(&attr);
+	attr.ParentObject = pDevContext->HidInjectorIoTarget;
 
-	if (pDevContext->HidInjectorIoTarget == NULL)
+	status = WdfSpinLockCreate(&attr, &channel->Lock);
+	if (!NT_SUCCESS(status))
 	{
-		DbgPrint_E("Io target is invalid\n");
+		DbgPrint_E("failed to create channel lock 0x%x\n", status);
 		goto Exit;
 	}
 
-	bufferLength = sizeof(*Report);
+	status = WdfRequestCreate(&attr, pDevContext->HidInjectorIoTarget, &channel->Request);
+	if (!NT_SUCCESS(status))
+	{
+		DbgPrint_E("failed to create channel request 0x%x\n", status);
+		goto Exit;
+	}
 
-	status = WdfMemoryCreate(WDF_NO_OBJECT_ATTRIBUTES, NonPagedPool, 0, bufferLength, &memWrite, (PVOID*)&buffer);
+	WDF_OBJECT_ATTRIBUTES_INIT(&attr);
+	attr.ParentObject = channel->Request;
+
+	status = WdfMemoryCreate(&attr, NonPagedPool, 0, sizeof(channel->Pending), &channel->Memory, NULL);
 	if (!NT_SUCCESS(status))
 	{
-		DbgPrint_E("failed to create memory 0x%x\n", status);
+		DbgPrint_E("failed to create channel memory 0x%x\n", status);
 		goto Exit;
 	}
 
-	if (Report != NULL)
+	channel->IsBusy = FALSE;
+	channel->PendingCount = 0;
+
+Exit:
+
+	return status;
+}
+
+//Write the in-flight buffer, called with IsBusy set. The completion routine runs unless this fails.
+static NTSTATUS InjectChannelSend(PDEVICE_CONTEXT pDevContext)
+{
+	NTSTATUS status;
+	PHID_INJECT_CHANNEL channel = &pDevContext->HidChannel;
+	WDF_REQUEST_REUSE_PARAMS reuseParams;
+	WDFMEMORY_OFFSET offset;
+
+	WDF_REQUEST_REUSE_PARAMS_INIT(&reuseParams, WDF_REQUEST_REUSE_NO_FLAGS, STATUS_SUCCESS);
+	WdfRequestReuse(channel->Request, &reuseParams);
+
+	offset.BufferOffset = 0;
+	offset.BufferLength = channel->InFlightCount * sizeof(HIDINJECTOR_INPUT_REPORT);
+
+	status = WdfIoTargetFormatRequestForWrite(pDevContext->HidInjectorIoTarget, channel->Request, channel->Memory, &offset, NULL);
+	if (NT_SUCCESS(status))
 	{
-		RtlCopyMemory(buffer, Report, sizeof(*Report));
+		WdfRequestSetCompletionRoutine(channel->Request, InjectChannelCompletion, pDevContext);
+
+		if (WdfRequestSend(channel->Request, pDevContext->HidInjectorIoTarget, WDF_NO_SEND_OPTIONS))
+		{
+			return STATUS_SUCCESS;
+		}
+
+		status = WdfRequestGetStatus(channel->Request);
 	}
 
-	WDF_MEMORY_DESCRIPTOR_INIT_HANDLE(&memoryDescriptor, memWrite, NULL);
-	UINT i = 0;
-	for (i = 0; i < 2; i++)
+	DbgPrint_E("Failed to send write request 0x%x\n", status);
+
+	return status;
+}
+
+//The in-flight write is over, its reports are dropped if it failed
+static VOID InjectChannelEndWrite(PDEVICE_CONTEXT pDevContext, NTSTATUS Status)
+{
+	PHID_INJECT_CHANNEL channel = &pDevContext->HidChannel;
+
+	WdfSpinLockAcquire(channel->Lock);
+	if (NT_SUCCESS(Status))
 	{
-		status = WdfIoTargetSendWriteSynchronously(
-			pDevContext->HidInjectorIoTarget,
-			NULL,
-			&memoryDescriptor,
-			NULL,
-			NULL,
-			&bufferWrittenLen);
-
-		if (!NT_SUCCESS(status))
+		channel->WriteCount++;
+	}
+	else
+	{
+		channel->DroppedCount += channel->InFlightCount;
+	}
+	channel->IsBusy = FALSE;
+	WdfSpinLockRelease(channel->Lock);
+}
+
+//Send everything queued as one write, unless a write is already in flight. Its completion sends the rest.
+VOID InjectChannelFlush(PDEVICE_CONTEXT pDevContext)
+{
+	PHID_INJECT_CHANNEL channel = &pDevContext->HidChannel;
+	NTSTATUS status;
+
+	if (channel->Request == NULL)
+	{
+		return;
+	}
+
+	for (;;)
+	{
+		WdfSpinLockAcquire(channel->Lock);
+
+		if (channel->IsBusy || channel->PendingCount == 0)
 		{
-			if (i == 0)
-			{
-				DbgPrint_E("Failed to send write request 0x%x and will retry\n", status);
-			}
-			else
-			{
-				DbgPrint_E("Failed to send write request 0x%x\n", status);
-			}
-			continue;
+			WdfSpinLockRelease(channel->Lock);
+			return;
 		}
-		else
+
+		RtlCopyMemory(WdfMemoryGetBuffer(channel->Memory, NULL), channel->Pending, channel->PendingCount * sizeof(HIDINJECTOR_INPUT_REPORT));
+		channel->InFlightCount = channel->PendingCount;
+		channel->PendingCount = 0;
+		channel->IsBusy = TRUE;
+		channel->IsRetry = FALSE;
+
+		WdfSpinLockRelease(channel->Lock);
+
+		status = InjectChannelSend(pDevContext);
+		if (NT_SUCCESS(status))
 		{
-			break;
+			return;
 		}
+
+		//No completion will come. Reports queued meanwhile found the channel busy and were left for it.
+		InjectChannelEndWrite(pDevContext, status);
 	}
+}
 
-Exit:
-	if (memWrite != NULL)
+static VOID InjectChannelCompletion(WDFREQUEST Request, WDFIOTARGET Target, PWDF_REQUEST_COMPLETION_PARAMS Params, WDFCONTEXT Context)
+{
+	PDEVICE_CONTEXT pDevContext = (PDEVICE_CONTEXT)Context;
+	PHID_INJECT_CHANNEL channel = &pDevContext->HidChannel;
+	NTSTATUS status = Params->IoStatus.Status;
+
+	UNREFERENCED_PARAMETER(Request);
+	UNREFERENCED_PARAMETER(Target);
+
+	if (!NT_SUCCESS(status))
+	{
+		if (!channel->IsRetry)
+		{
+			DbgPrint_E("Failed to send write request 0x%x and will retry\n", status);
+			channel->IsRetry = TRUE;
+
+			status = InjectChannelSend(pDevContext);
+			if (NT_SUCCESS(status))
+			{
+				return;
+			}
+		}
+
+		DbgPrint_E("Failed to send write request 0x%x\n", status);
+	}
+
+	//Drop the reports of a failed write either way, the ones queued meanwhile still go out
+	InjectChannelEndWrite(pDevContext, status);
+	InjectChannelFlush(pDevContext);
+}
+
+//Queue a report on the injection channel, it is written by the next InjectChannelFlush
+NTSTATUS SendHidReport(HIDINJECTOR_INPUT_REPORT * Report, PDEVICE_CONTEXT pDevContext)
+{
+	NTSTATUS status = STATUS_SUCCESS;
+	PHID_INJECT_CHANNEL channel = &pDevContext->HidChannel;
+
+	if (pDevContext->HidInjectorIoTarget == NULL || channel->Request == NULL)
 	{
-		WdfObjectDelete(memWrite);
-		memWrite = NULL;
+		DbgPrint_E("Io target is invalid\n");
+		return STATUS_INVALID_DEVICE_STATE;
 	}
 
+	WdfSpinLockAcquire(channel->Lock);
+
+	if (channel->PendingCount < HID_INJECT_MAX_REPORTS)
+	{
+		channel->Pending[channel->PendingCount] = *Report;
+		channel->PendingCount++;
+	}
+	else
+	{
+		channel->DroppedCount++;
+		status = STATUS_INSUFFICIENT_RESOURCES;
+	}
+
+	WdfSpinLockRelease(channel->Lock);
+
 	return status;
 }
 
@@ -215,16 +340,14 @@ BOOL InjectSendInputSingle(LPINPUT Input, PDEVICE_CONTEXT pDevContext)
 }
 
 
-UINT InjectSendInput(
+//Queue the reports of the inputs without sending them
+static UINT InjectQueueInput(
 	_In_ UINT    nInputs,
 	_In_ LPINPUT pInputs,
-	_In_ int     cbSize,
 	PDEVICE_CONTEXT pDevContext
 )
 {
 	UINT c = 0;
-	
-	UNREFERENCED_PARAMETER(cbSize);
 
 	for (UINT i = 0; i < nInputs; i++)
 	{
@@ -233,15 +356,34 @@ UINT InjectSendInput(
 			c++;
 		}
 	}
+
+	return c;
+}
+
+UINT InjectSendInput(
+	_In_ UINT    nInputs,
+	_In_ LPINPUT pInputs,
+	_In_ int     cbSize,
+	PDEVICE_CONTEXT pDevContext
+)
+{
+	UNREFERENCED_PARAMETER(cbSize);
+
+	InjectQueueInput(nInputs, pInputs, pDevContext);
+
+	//All reports of this call, a key down and up included, go out as one write
+	InjectChannelFlush(pDevContext);
+
 	return 0;
 }
 
+//Key down and up only queue their report, the caller sends all of them with one InjectChannelFlush
 void InjectKeyDown(UCHAR vk, PDEVICE_CONTEXT pDevContext)
 {
 	INPUT inp = { 0 };
 	inp.type = INPUT_KEYBOARD;
 	inp.ki.wVk = vk;
-	InjectSendInput(1, &inp, sizeof(inp), pDevContext);
+	InjectQueueInput(1, &inp, pDevContext);
 }
 
 void InjectKeyUp(UCHAR vk, PDEVICE_CONTEXT pDevContext)
@@ -250,7 +392,7 @@ void InjectKeyUp(UCHAR vk, PDEVICE_CONTEXT pDevContext)
 	inp.type = INPUT_KEYBOARD;
 	inp.ki.dwFlags = KEYEVENTF_KEYUP;
 	inp.ki.wVk = vk;
-	InjectSendInput(1, &inp, sizeof(inp), pDevContext);
+	InjectQueueInput(1, &inp, pDevContext);
 
 }
 
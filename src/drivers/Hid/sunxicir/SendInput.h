@@ -26,6 +26,7 @@
 extern "C" {
 #endif
 
+	//Key down and up only queue their report, send it with InjectChannelFlush
 	void InjectKeyDown(
 		UCHAR vk,
 		PDEVICE_CONTEXT pDevContext
@@ -57,6 +58,14 @@ extern "C" {
 	);
 
 
+	NTSTATUS InjectChannelInitialize(
+		PDEVICE_CONTEXT pDevContext
+	);
+
+	VOID InjectChannelFlush(
+		PDEVICE_CONTEXT pDevContext
+	);
+
 	UINT InjectSendInput(
 		_In_ UINT    nInputs,
 		_In_ LPINPUT pInputs,
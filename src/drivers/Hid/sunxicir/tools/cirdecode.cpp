@@ -0,0 +1,422 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	cirdecode.cpp
+
+Abstract:
+
+	Replays the pulse train corpus (cirpulses.txt) through the streaming
+	decoder of IRDecoder.cpp and benchmarks it per sample. Every train is
+	fed three ways, which must all report the codes the corpus lists:
+
+		fifo     one sample per FIFO entry, then a flush at the packet
+		         end, as the interrupt DPC does
+		runs     one sample per run of equal level, the gap after a
+		         frame included, so the sample ending a frame is also
+		         the one that crosses the gap
+		split    one sample per sample clock tick
+
+	The benchmark replays the corpus the fifo way and reports the mean
+	time per sample and per code, and the slowest single sample.
+
+	Build and use on any host with a C++ compiler:
+
+		c++ -O2 -I../../../../tools/host -I.. -o cirdecode cirdecode.cpp ../IRDecoder.cpp
+		cirdecode [corpus [passes]]
+
+Environment:
+
+	user mode
+
+--*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "IRDecoder.h"
+
+//
+// RX FIFO entry layout and sample clock, as in AwCIR.h, which pulls in the
+// whole device context.
+//
+
+#define CIR_RXFIFO_LEVEL_SHIFT 0x7
+#define CIR_RXFIFO_COUNT_MASK 0x7f
+#define CIR_SAMPLE_CLOCK_HZ (24000000 / 512)
+#define CIR_SAMPLES_TO_US(Count) ((ULONG)(((Count) * 1000000ULL) / CIR_SAMPLE_CLOCK_HZ))
+
+#define MAX_FRAMES 64
+#define MAX_ENTRIES 256
+#define MAX_EXPECTED 4
+
+typedef enum _FEED_MODE
+{
+	FeedFifo,
+	FeedRuns,
+	FeedSplit
+}FEED_MODE;
+
+typedef struct _FRAME
+{
+	char Comment[96];
+	UINT8 Entries[MAX_ENTRIES];
+	ULONG EntryCount;
+	CIR_CODE Expected[MAX_EXPECTED];
+	ULONG ExpectedCount;
+}FRAME, *PFRAME;
+
+typedef struct _RESULT
+{
+	CIR_CODE Codes[MAX_EXPECTED * 2];
+	ULONG CodeCount;
+	ULONG Samples;
+}RESULT, *PRESULT;
+
+static FRAME g_Frames[MAX_FRAMES];
+static ULONG g_FrameCount;
+static int g_Failures;
+
+static const char* g_ProtocolNames[] = { "none", "nec", "rc5", "rc6", "sirc" };
+
+static LONGLONG NowNs()
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (LONGLONG)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static BOOLEAN ParseCode(const char* Text, PCIR_CODE Code)
+{
+	char protocol[16];
+	unsigned int address;
+	unsigned int command;
+	unsigned int toggle;
+	unsigned int repeat;
+	UINT i;
+
+	if (sscanf(Text, "%15s %x %x %u %u", protocol, &address, &command, &toggle, &repeat) != 5)
+		return FALSE;
+
+	RtlZeroMemory(Code, sizeof(CIR_CODE));
+	for (i = 0; i < sizeof(g_ProtocolNames) / sizeof(g_ProtocolNames[0]); i++)
+	{
+		if (strcmp(protocol, g_ProtocolNames[i]) == 0)
+			Code->Protocol = (CIR_PROTOCOL)i;
+	}
+
+	Code->Address = (UINT16)address;
+	Code->Command = (UINT16)command;
+	Code->Toggle = (UINT8)toggle;
+	Code->IsRepeat = (BOOLEAN)repeat;
+
+	return Code->Protocol != CirProtocolNone;
+}
+
+static BOOLEAN LoadCorpus(const char* Path)
+{
+	char line[512];
+	char* next;
+	char* text;
+	FILE* file;
+	PFRAME frame = NULL;
+	unsigned long value;
+	ULONG lineNumber = 0;
+
+	file = fopen(Path, "r");
+	if (file == NULL)
+	{
+		printf("cannot open %s\n", Path);
+		return FALSE;
+	}
+
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		lineNumber++;
+		line[strcspn(line, "\r\n")] = 0;
+
+		if (frame == NULL && line[0] != 0)
+		{
+			if (g_FrameCount == MAX_FRAMES)
+				break;
+			frame = &g_Frames[g_FrameCount];
+			RtlZeroMemory(frame, sizeof(FRAME));
+		}
+
+		if (line[0] == 0)
+		{
+			continue;
+		}
+		else if (line[0] == '#')
+		{
+			for (text = line + 1; *text == ' '; text++)
+				;
+			snprintf(frame->Comment, sizeof(frame->Comment), "%.90s", text);
+		}
+		else if (strncmp(line, "code ", 5) == 0)
+		{
+			if (frame->ExpectedCount == MAX_EXPECTED || !ParseCode(line + 5, &frame->Expected[frame->ExpectedCount]))
+				break;
+			frame->ExpectedCount++;
+		}
+		else if (strncmp(line, "fifo ", 5) == 0)
+		{
+			for (text = line + 5; *text != 0; text = next)
+			{
+				value = strtoul(text, &next, 16);
+				if (next == text)
+					break;
+				if (frame->EntryCount == MAX_ENTRIES)
+					goto Malformed;
+				frame->Entries[frame->EntryCount++] = (UINT8)value;
+			}
+		}
+		else if (strcmp(line, "end") == 0)
+		{
+			g_FrameCount++;
+			frame = NULL;
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	if (!feof(file))
+	{
+Malformed:
+		printf("%s:%lu: malformed line\n", Path, (unsigned long)lineNumber);
+		fclose(file);
+		return FALSE;
+	}
+
+	fclose(file);
+	return g_FrameCount != 0;
+}
+
+static VOID AddCodes(PRESULT Result, PCIR_CODE Codes, ULONG Count)
+{
+	ULONG i;
+
+	for (i = 0; i < Count && Result->CodeCount < MAX_EXPECTED * 2; i++)
+	{
+		Result->Codes[Result->CodeCount++] = Codes[i];
+	}
+}
+
+static VOID Feed(PCIR_DECODER Decoder, PRESULT Result, BOOLEAN Level, ULONG Duration)
+{
+	CIR_CODE codes[CIR_DECODER_MAX_CODES];
+
+	AddCodes(Result, codes, CirDecoderFeed(Decoder, Level, Duration, codes));
+	Result->Samples++;
+}
+
+static VOID Replay(PCIR_DECODER Decoder, PFRAME Frame, FEED_MODE Mode, PRESULT Result)
+{
+	CIR_CODE codes[CIR_DECODER_MAX_CODES];
+	BOOLEAN level;
+	ULONG count;
+	ULONG i;
+	ULONG j;
+	ULONG run = 0;
+
+	RtlZeroMemory(Result, sizeof(RESULT));
+
+	for (i = 0; i < Frame->EntryCount; i++)
+	{
+		level = (Frame->Entries[i] >> CIR_RXFIFO_LEVEL_SHIFT) & 0x1;
+		count = (Frame->Entries[i] & CIR_RXFIFO_COUNT_MASK) + 1;
+
+		switch (Mode)
+		{
+		case FeedFifo:
+			Feed(Decoder, Result, level, CIR_SAMPLES_TO_US(count));
+			break;
+
+		case FeedRuns:
+			run += count;
+			if (i + 1 == Frame->EntryCount || ((Frame->Entries[i + 1] >> CIR_RXFIFO_LEVEL_SHIFT) & 0x1) != level)
+			{
+				Feed(Decoder, Result, level, CIR_SAMPLES_TO_US(run));
+				run = 0;
+			}
+			break;
+
+		case FeedSplit:
+			for (j = 0; j < count; j++)
+			{
+				Feed(Decoder, Result, level, CIR_SAMPLES_TO_US(j + 1) - CIR_SAMPLES_TO_US(j));
+			}
+			break;
+		}
+	}
+
+	AddCodes(Result, codes, CirDecoderFlush(Decoder, codes));
+}
+
+static BOOLEAN SameCode(const CIR_CODE* Left, const CIR_CODE* Right)
+{
+	return Left->Protocol == Right->Protocol &&
+		Left->Address == Right->Address &&
+		Left->Command == Right->Command &&
+		Left->Toggle == Right->Toggle &&
+		Left->IsRepeat == Right->IsRepeat;
+}
+
+static VOID PrintCode(const char* Prefix, const CIR_CODE* Code)
+{
+	printf("  %s %s 0x%04x 0x%04x toggle %u%s\n",
+		Prefix,
+		g_ProtocolNames[Code->Protocol],
+		Code->Address,
+		Code->Command,
+		Code->Toggle,
+		Code->IsRepeat ? " repeat" : "");
+}
+
+static VOID TestCorpus()
+{
+	static const char* modes[] = { "fifo", "runs", "split" };
+	CIR_DECODER decoder;
+	RESULT result;
+	ULONG frame;
+	ULONG i;
+	ULONG mode;
+	BOOLEAN isSame;
+
+	for (mode = FeedFifo; mode <= FeedSplit; mode++)
+	{
+		RtlZeroMemory(&decoder, sizeof(decoder));
+		CirDecoderReset(&decoder);
+
+		for (frame = 0; frame < g_FrameCount; frame++)
+		{
+			Replay(&decoder, &g_Frames[frame], (FEED_MODE)mode, &result);
+
+			isSame = (result.CodeCount == g_Frames[frame].ExpectedCount);
+			for (i = 0; isSame && i < result.CodeCount; i++)
+			{
+				isSame = SameCode(&result.Codes[i], &g_Frames[frame].Expected[i]);
+			}
+
+			if (!isSame)
+			{
+				printf("FAIL %s: %s\n", modes[mode], g_Frames[frame].Comment);
+				for (i = 0; i < g_Frames[frame].ExpectedCount; i++)
+					PrintCode("expected", &g_Frames[frame].Expected[i]);
+				for (i = 0; i < result.CodeCount; i++)
+					PrintCode("decoded ", &result.Codes[i]);
+				g_Failures++;
+			}
+		}
+	}
+}
+
+static VOID Benchmark(ULONG Passes)
+{
+	CIR_DECODER decoder;
+	RESULT result;
+	LONGLONG elapsed;
+	LONGLONG slowest = 0;
+	LONGLONG start;
+	LONGLONG sample;
+	ULONGLONG samples = 0;
+	ULONGLONG codes = 0;
+	CIR_CODE code[CIR_DECODER_MAX_CODES];
+	ULONG frame;
+	ULONG pass;
+	ULONG i;
+
+	RtlZeroMemory(&decoder, sizeof(decoder));
+	CirDecoderReset(&decoder);
+
+	start = NowNs();
+	for (pass = 0; pass < Passes; pass++)
+	{
+		for (frame = 0; frame < g_FrameCount; frame++)
+		{
+			Replay(&decoder, &g_Frames[frame], FeedFifo, &result);
+			samples += result.Samples;
+			codes += result.CodeCount;
+		}
+	}
+	elapsed = NowNs() - start;
+
+	//Time every sample of one more pass on its own for the slowest one
+	for (frame = 0; frame < g_FrameCount; frame++)
+	{
+		for (i = 0; i < g_Frames[frame].EntryCount; i++)
+		{
+			start = NowNs();
+			CirDecoderFeed(&decoder,
+				(g_Frames[frame].Entries[i] >> CIR_RXFIFO_LEVEL_SHIFT) & 0x1,
+				CIR_SAMPLES_TO_US((g_Frames[frame].Entries[i] & CIR_RXFIFO_COUNT_MASK) + 1),
+				code);
+			sample = NowNs() - start;
+			if (sample > slowest)
+				slowest = sample;
+		}
+		CirDecoderFlush(&decoder, code);
+	}
+
+	printf("%lu frames, %llu samples, %llu codes in %lu passes\n",
+		(unsigned long)g_FrameCount,
+		(unsigned long long)samples,
+		(unsigned long long)codes,
+		(unsigned long)Passes);
+	printf("%.1f ns per sample, %.1f ns per code, slowest sample %lld ns\n",
+		(double)elapsed / samples,
+		(double)elapsed / codes,
+		(long long)slowest);
+}
+
+int main(int argc, char** argv)
+{
+	const char* path = "cirpulses.txt";
+	ULONG passes = 2000;
+
+	if (argc > 1)
+		path = argv[1];
+	if (argc > 2)
+		passes = strtoul(argv[2], NULL, 0);
+
+	if (!LoadCorpus(path) || passes == 0)
+	{
+		fprintf(stderr, "usage: cirdecode [corpus [passes]]\n");
+		return 2;
+	}
+
+	TestCorpus();
+	Benchmark(passes);
+
+	if (g_Failures != 0)
+	{
+		printf("%d check(s) failed\n", g_Failures);
+		return 1;
+	}
+
+	printf("all checks passed\n");
+	return 0;
+}
@@ -0,0 +1,490 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	cirring.cpp
+
+Abstract:
+
+	Stress test of the pulse ring (PulseRing.cpp) between the ISR and the
+	DPC. A producer thread queues numbered samples and frame end markers
+	the way the ISR does, consumer threads run the drain loop of the DPC,
+	several at once, as the ISR and the key release timer may queue the
+	DPC again while another processor is still in it. The DPC is queued
+	the way WdfInterruptQueueDpcForIsr does, at most once until it runs.
+
+	Every phase checks that:
+
+		the consumers take exactly what the producer got into the ring,
+		in order, and only one of them drains at a time
+		samples are only missing after a reset marker, and every queue
+		call either got its entry in or was counted as a ring overrun
+		the ring is empty whenever the DPCs are done, no entry waits for
+		the next interrupt
+
+	The phases are:
+
+		fast     the producer queues as fast as it can while the ring
+		         has room
+		stalls   the consumer stalls now and then, the ring overruns
+		trickle  interrupts come in pairs of a few entries each, the
+		         second while the DPC of the first may still run, then
+		         the bus is quiet until the DPCs are done
+
+	Build and use on any host with a C++ compiler:
+
+		c++ -O2 -I../../../../tools/host -I.. -o cirring cirring.cpp ../PulseRing.cpp -lpthread
+		cirring
+
+Environment:
+
+	user mode
+
+--*/
+
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "PulseRing.h"
+
+#define CONSUMER_COUNT 3
+#define MAX_ENTRIES (4 * 1024 * 1024)
+
+//A frame end marker after this many samples
+#define FRAME_SAMPLES 50
+
+typedef enum _PHASE
+{
+	PhaseFast,
+	PhaseStalls,
+	PhaseTrickle
+}PHASE;
+
+typedef struct _PHASE_RESULT
+{
+	ULONG Queued;
+	ULONG Taken;
+	ULONG Resets;
+	ULONG Dpcs;
+	ULONG Drains;
+	LONGLONG Ns;
+}PHASE_RESULT, *PPHASE_RESULT;
+
+static CIR_PULSE_RING g_Ring;
+static PHASE g_Phase;
+static ULONG g_QueueCalls;
+
+//Entries the producer got into the ring, in ring order, written before the count
+static USHORT* g_Accepted;
+static volatile ULONG g_AcceptedCount;
+
+//Consumer side, only touched by the instance that drains
+static ULONG g_Taken;
+static ULONG g_Mismatches;
+static ULONG g_Drains;
+
+static volatile LONG g_Drainers;
+static volatile LONG g_Overlaps;
+
+static volatile LONG g_DpcQueued;
+static volatile LONG g_DpcRunning;
+static volatile LONG g_Dpcs;
+static volatile LONG g_Stop;
+static volatile LONG g_ProducerDone;
+
+//Entries left in the ring after the DPCs went idle
+static ULONG g_Stranded;
+static sem_t g_DpcEvent;
+
+static int g_Failures;
+
+static void Check(BOOLEAN Condition, const char* Case, const char* What)
+{
+	if (!Condition)
+	{
+		printf("FAIL %s: %s\n", Case, What);
+		g_Failures++;
+	}
+}
+
+static LONGLONG NowNs()
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (LONGLONG)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static ULONG Random(PULONG State)
+{
+	ULONG x = *State;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*State = x;
+
+	return x;
+}
+
+//WdfInterruptQueueDpcForIsr, a DPC already queued is not queued again
+static void QueueDpc()
+{
+	if (InterlockedCompareExchange(&g_DpcQueued, 1, 0) == 0)
+	{
+		sem_post(&g_DpcEvent);
+	}
+}
+
+//Nothing is queued and nothing runs. A DPC counts as running before it is dequeued.
+static void WaitDpcIdle()
+{
+	while (g_DpcQueued != 0 || g_DpcRunning != 0)
+	{
+		sched_yield();
+	}
+}
+
+static void Queue(USHORT Entry)
+{
+	ULONG head = g_Ring.Head;
+	ULONG count = g_AcceptedCount;
+
+	CirPulseRingQueue(&g_Ring, Entry);
+	g_QueueCalls++;
+
+	//Only the producer writes the slots, the ones it just filled still hold what it queued
+	for (; head != g_Ring.Head; head++)
+	{
+		g_Accepted[count++] = g_Ring.Entries[head & (CIR_PULSE_RING_LENGTH - 1)];
+	}
+
+	KeMemoryBarrier();
+	g_AcceptedCount = count;
+}
+
+static void* Producer(void* Context)
+{
+	ULONG entries = (ULONG)(ULONG_PTR)Context;
+	ULONG seed = 0x2545f491;
+	ULONG sequence = 0;
+	ULONG burst = 0;
+	ULONG interrupts = 0;
+	LONGLONG gap;
+	ULONG i;
+
+	for (i = 0; i < entries; i++)
+	{
+		if (i % (FRAME_SAMPLES + 1) == FRAME_SAMPLES)
+		{
+			Queue(CIR_PULSE_FRAME_END);
+		}
+		else
+		{
+			Queue((USHORT)(sequence++ & 0xff));
+		}
+
+		if (g_Phase == PhaseFast)
+		{
+			//Keep the ring from overrunning, the DPC keeps up with the receiver on real hardware
+			while (g_Ring.Head - g_Ring.Tail >= CIR_PULSE_RING_LENGTH * 3 / 4)
+			{
+				QueueDpc();
+				sched_yield();
+			}
+		}
+
+		if (g_Phase != PhaseTrickle)
+		{
+			if ((i & 15) == 15)
+			{
+				QueueDpc();
+			}
+			continue;
+		}
+
+		//An interrupt hands over a few FIFO entries, a second one follows shortly,
+		//then the bus is quiet and whatever is left in the ring waits for the next frame
+		if (burst == 0)
+		{
+			QueueDpc();
+			burst = 1 + Random(&seed) % 8;
+
+			if (++interrupts % 2 == 0)
+			{
+				WaitDpcIdle();
+				if (g_Ring.Head != g_Ring.Tail)
+				{
+					g_Stranded++;
+				}
+			}
+			else
+			{
+				gap = NowNs() + Random(&seed) % 50000;
+				while (NowNs() < gap)
+				{
+				}
+			}
+		}
+		burst--;
+	}
+
+	QueueDpc();
+	return NULL;
+}
+
+static void TakeEntry(USHORT Entry, PULONG Seed)
+{
+	//The producer logs an entry right after it is published, wait for the log to catch up
+	while (g_AcceptedCount <= g_Taken && !g_ProducerDone)
+	{
+		sched_yield();
+	}
+	KeMemoryBarrier();
+
+	if (g_Taken >= g_AcceptedCount)
+	{
+		//Taken twice, or never queued
+		g_Mismatches++;
+		return;
+	}
+
+	if (g_Accepted[g_Taken] != Entry && g_Mismatches++ < 5)
+	{
+		printf("entry %u: took 0x%x, queued 0x%x\n", g_Taken, Entry, g_Accepted[g_Taken]);
+	}
+	g_Taken++;
+
+	if (g_Phase == PhaseStalls && Random(Seed) % 4096 == 0)
+	{
+		usleep(200);
+	}
+}
+
+//The drain loop of CirEvtInterruptDpc, without the decoder and the key release
+static void Dpc(PULONG Seed)
+{
+	USHORT entry;
+
+	while (CirPulseRingBeginDrain(&g_Ring))
+	{
+		if (InterlockedExchange(&g_Drainers, 1) != 0)
+		{
+			g_Overlaps++;
+		}
+		g_Drains++;
+
+		while (CirPulseRingTake(&g_Ring, &entry))
+		{
+			TakeEntry(entry, Seed);
+		}
+
+		//The driver checks the key release here, the ISR may queue entries and the DPC meanwhile
+		if (Random(Seed) % 2 == 0)
+		{
+			sched_yield();
+		}
+
+		InterlockedExchange(&g_Drainers, 0);
+		CirPulseRingEndDrain(&g_Ring);
+
+		if (CirPulseRingIsEmpty(&g_Ring))
+		{
+			break;
+		}
+	}
+}
+
+static void* Consumer(void* Context)
+{
+	ULONG seed = 0x9e3779b9 + (ULONG)(ULONG_PTR)Context;
+
+	for (;;)
+	{
+		sem_wait(&g_DpcEvent);
+		if (g_Stop)
+		{
+			break;
+		}
+
+		//Running before dequeued, see WaitDpcIdle
+		__sync_add_and_fetch(&g_DpcRunning, 1);
+		InterlockedExchange(&g_DpcQueued, 0);
+		__sync_add_and_fetch(&g_Dpcs, 1);
+
+		Dpc(&seed);
+
+		__sync_sub_and_fetch(&g_DpcRunning, 1);
+	}
+
+	return NULL;
+}
+
+//Samples are numbered, a gap is only allowed right after a reset marker
+static void CheckAccepted(const char* Case, PPHASE_RESULT Result)
+{
+	ULONG expected = 0;
+	ULONG gaps = 0;
+	BOOLEAN isReset = FALSE;
+	ULONG i;
+
+	for (i = 0; i < g_AcceptedCount; i++)
+	{
+		USHORT entry = g_Accepted[i];
+
+		if (entry == CIR_PULSE_RESET)
+		{
+			Result->Resets++;
+			isReset = TRUE;
+			continue;
+		}
+		if (entry == CIR_PULSE_FRAME_END)
+		{
+			continue;
+		}
+
+		if (entry != (expected & 0xff) && !isReset)
+		{
+			gaps++;
+		}
+		expected = entry + 1;
+		isReset = FALSE;
+	}
+
+	Check(gaps == 0, Case, "samples are only missing after a reset marker");
+	Check(g_QueueCalls == g_AcceptedCount - Result->Resets + g_Ring.RingOverruns, Case,
+		"every entry was queued or counted as an overrun");
+}
+
+static void RunPhase(PHASE Phase, const char* Case, ULONG Entries)
+{
+	pthread_t producer;
+	pthread_t consumers[CONSUMER_COUNT];
+	PHASE_RESULT result;
+	LONGLONG start;
+	ULONG i;
+
+	RtlZeroMemory(&result, sizeof(result));
+	RtlZeroMemory(&g_Ring, sizeof(g_Ring));
+	CirPulseRingReset(&g_Ring);
+	g_Phase = Phase;
+	g_QueueCalls = 0;
+	g_AcceptedCount = 0;
+	g_Taken = 0;
+	g_Mismatches = 0;
+	g_Drains = 0;
+	g_Drainers = 0;
+	g_Overlaps = 0;
+	g_DpcQueued = 0;
+	g_DpcRunning = 0;
+	g_Dpcs = 0;
+	g_Stop = 0;
+	g_ProducerDone = 0;
+	g_Stranded = 0;
+	sem_init(&g_DpcEvent, 0, 0);
+
+	for (i = 0; i < CONSUMER_COUNT; i++)
+	{
+		pthread_create(&consumers[i], NULL, Consumer, (void*)(ULONG_PTR)i);
+	}
+
+	start = NowNs();
+	pthread_create(&producer, NULL, Producer, (void*)(ULONG_PTR)Entries);
+	pthread_join(producer, NULL);
+	g_ProducerDone = 1;
+
+	//The producer queued the last DPC after its last entry
+	WaitDpcIdle();
+	result.Ns = NowNs() - start;
+
+	g_Stop = 1;
+	for (i = 0; i < CONSUMER_COUNT; i++)
+	{
+		sem_post(&g_DpcEvent);
+	}
+	for (i = 0; i < CONSUMER_COUNT; i++)
+	{
+		pthread_join(consumers[i], NULL);
+	}
+	sem_destroy(&g_DpcEvent);
+
+	result.Queued = g_AcceptedCount;
+	result.Taken = g_Taken;
+	result.Dpcs = g_Dpcs;
+	result.Drains = g_Drains;
+
+	Check(g_Ring.Head == g_Ring.Tail && g_Stranded == 0, Case, "ring empty whenever the DPCs went idle");
+	Check(g_Taken == g_AcceptedCount, Case, "took every entry the producer got in");
+	Check(g_Mismatches == 0, Case, "took the entries in the order they were queued");
+	Check(g_Overlaps == 0, Case, "one instance drains at a time");
+	Check(!g_Ring.IsDraining, Case, "no instance left draining");
+
+	CheckAccepted(Case, &result);
+
+	if (Phase == PhaseStalls)
+	{
+		Check(g_Ring.RingOverruns != 0, Case, "the ring overran");
+		Check(result.Resets != 0, Case, "a reset marker followed the overrun");
+	}
+	else
+	{
+		Check(g_Ring.RingOverruns == 0 && result.Resets == 0, Case, "the ring never overran");
+	}
+
+	printf("%-8s %8u queued %8u overruns %5u resets %7u dpcs %7u drains, %.1f ns per entry\n",
+		Case,
+		result.Queued,
+		g_Ring.RingOverruns,
+		result.Resets,
+		result.Dpcs,
+		result.Drains,
+		(double)result.Ns / Entries);
+}
+
+int main()
+{
+	g_Accepted = (USHORT*)malloc(MAX_ENTRIES * 2 * sizeof(USHORT));
+	if (g_Accepted == NULL)
+	{
+		printf("out of memory\n");
+		return 1;
+	}
+
+	RunPhase(PhaseFast, "fast", MAX_ENTRIES);
+	RunPhase(PhaseStalls, "stalls", MAX_ENTRIES);
+	RunPhase(PhaseTrickle, "trickle", MAX_ENTRIES / 16);
+
+	free(g_Accepted);
+
+	if (g_Failures != 0)
+	{
+		printf("%d check(s) failed\n", g_Failures);
+		return 1;
+	}
+
+	printf("all checks passed\n");
+	return 0;
+}
@@ -0,0 +1,568 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	injectbench.cpp
+
+Abstract:
+
+	Runs the HID injection channel of SendInput.cpp against a fake I/O
+	target standing in for the vhfhid raw PDO, checks its writes and
+	benchmarks it per keystroke, a key down and up sent with one
+	flush as the CIR decoder does.
+
+	The fake target completes a write either inline, from within
+	WdfRequestSend, or deferred, when the test lets it. It can fail a
+	write asynchronously with a status or synchronously, in which case
+	WdfRequestSend returns FALSE and no completion follows. Reports of
+	the writes that succeed are logged in order.
+
+	The cases are:
+
+		inline      every keystroke is one write of two reports, in order
+		coalesce    keystrokes queued behind a write in flight go out
+		            as one write, beyond the channel size they are
+		            dropped and counted
+		retry       a failed write is sent once more
+		sync fail   a write that cannot be sent drops its reports,
+		            the next keystroke goes out
+		retry sync  the retry of a failed write cannot be sent, its
+		            reports are dropped and those queued meanwhile
+		            still go out
+		retry fail  the retry fails too, likewise
+
+	The benchmark reports the time, writes and allocations per
+	keystroke on both targets.
+
+	Build and use on any host with a C++ compiler:
+
+		c++ -O2 -I../../../../tools/host -I.. -o injectbench injectbench.cpp ../SendInput.cpp ../HidInject.cpp
+		injectbench [keystrokes]
+
+Environment:
+
+	user mode
+
+--*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "SendInput.h"
+#include "HidInject.h"
+
+#define MAX_LOGGED 64
+
+typedef enum _FAKE_MODE
+{
+	FakeInline,
+	FakeDeferred
+}FAKE_MODE;
+
+typedef struct _FAKE_REQUEST
+{
+	PFN_WDF_REQUEST_COMPLETION_ROUTINE Completion;
+	WDFCONTEXT Context;
+	PUCHAR Buffer;
+	size_t Length;
+	NTSTATUS Status;
+	BOOLEAN IsFormatted;
+}FAKE_REQUEST, *PFAKE_REQUEST;
+
+//Fake target, one request in flight at most
+typedef struct _FAKE_TARGET
+{
+	FAKE_MODE Mode;
+
+	//Outcomes of the next sends, consumed in order, success once they run out
+	NTSTATUS AsyncStatus[4];
+	BOOLEAN IsSyncFailure[4];
+	ULONG ScriptCount;
+	ULONG ScriptNext;
+
+	PFAKE_REQUEST InFlight;
+	NTSTATUS InFlightStatus;
+
+	ULONG Sends;
+	ULONG Writes;
+	ULONG Reports;
+	HIDINJECTOR_INPUT_REPORT Logged[MAX_LOGGED];
+	ULONG LoggedCount;
+
+	ULONG Allocations;
+	LONG LockDepth;
+	ULONG LockErrors;
+}FAKE_TARGET;
+
+unsigned long g_DebugLevel = 0;
+
+//Key state of SendInput.cpp
+extern HIDINJECTOR_INPUT_REPORT KeyboardState;
+
+static FAKE_TARGET g_Target;
+static int g_Failures;
+
+static void Check(BOOLEAN Condition, const char* Case, const char* What)
+{
+	if (!Condition)
+	{
+		printf("FAIL %s: %s\n", Case, What);
+		g_Failures++;
+	}
+}
+
+static LONGLONG NowNs()
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (LONGLONG)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+NTSTATUS WdfSpinLockCreate(PWDF_OBJECT_ATTRIBUTES SpinLockAttributes, WDFSPINLOCK* SpinLock)
+{
+	UNREFERENCED_PARAMETER(SpinLockAttributes);
+
+	*SpinLock = (WDFSPINLOCK)&g_Target.LockDepth;
+	return STATUS_SUCCESS;
+}
+
+VOID WdfSpinLockAcquire(WDFSPINLOCK SpinLock)
+{
+	UNREFERENCED_PARAMETER(SpinLock);
+
+	if (g_Target.LockDepth++ != 0)
+	{
+		g_Target.LockErrors++;
+	}
+}
+
+VOID WdfSpinLockRelease(WDFSPINLOCK SpinLock)
+{
+	UNREFERENCED_PARAMETER(SpinLock);
+
+	if (--g_Target.LockDepth != 0)
+	{
+		g_Target.LockErrors++;
+	}
+}
+
+NTSTATUS WdfRequestCreate(PWDF_OBJECT_ATTRIBUTES RequestAttributes, WDFIOTARGET IoTarget, WDFREQUEST* Request)
+{
+	UNREFERENCED_PARAMETER(RequestAttributes);
+	UNREFERENCED_PARAMETER(IoTarget);
+
+	g_Target.Allocations++;
+	*Request = (WDFREQUEST)calloc(1, sizeof(FAKE_REQUEST));
+	return STATUS_SUCCESS;
+}
+
+NTSTATUS WdfMemoryCreate(PWDF_OBJECT_ATTRIBUTES Attributes, POOL_TYPE PoolType, ULONG PoolTag, size_t BufferSize, WDFMEMORY* Memory, PVOID* Buffer)
+{
+	UNREFERENCED_PARAMETER(Attributes);
+	UNREFERENCED_PARAMETER(PoolType);
+	UNREFERENCED_PARAMETER(PoolTag);
+
+	g_Target.Allocations++;
+	*Memory = (WDFMEMORY)calloc(1, BufferSize);
+	if (Buffer != NULL)
+	{
+		*Buffer = *Memory;
+	}
+	return STATUS_SUCCESS;
+}
+
+PVOID WdfMemoryGetBuffer(WDFMEMORY Memory, size_t* BufferSize)
+{
+	UNREFERENCED_PARAMETER(BufferSize);
+
+	return Memory;
+}
+
+NTSTATUS WdfRequestReuse(WDFREQUEST Request, PWDF_REQUEST_REUSE_PARAMS ReuseParams)
+{
+	PFAKE_REQUEST request = (PFAKE_REQUEST)Request;
+
+	request->Status = ReuseParams->Status;
+	request->IsFormatted = FALSE;
+	return STATUS_SUCCESS;
+}
+
+NTSTATUS WdfIoTargetFormatRequestForWrite(WDFIOTARGET IoTarget, WDFREQUEST Request, WDFMEMORY InputBuffer, PWDFMEMORY_OFFSET InputBufferOffset, PLONGLONG DeviceOffset)
+{
+	PFAKE_REQUEST request = (PFAKE_REQUEST)Request;
+
+	UNREFERENCED_PARAMETER(IoTarget);
+	UNREFERENCED_PARAMETER(DeviceOffset);
+
+	request->Buffer = (PUCHAR)InputBuffer + InputBufferOffset->BufferOffset;
+	request->Length = InputBufferOffset->BufferLength;
+	request->IsFormatted = TRUE;
+	return STATUS_SUCCESS;
+}
+
+VOID WdfRequestSetCompletionRoutine(WDFREQUEST Request, PFN_WDF_REQUEST_COMPLETION_ROUTINE CompletionRoutine, WDFCONTEXT CompletionContext)
+{
+	PFAKE_REQUEST request = (PFAKE_REQUEST)Request;
+
+	request->Completion = CompletionRoutine;
+	request->Context = CompletionContext;
+}
+
+NTSTATUS WdfRequestGetStatus(WDFREQUEST Request)
+{
+	return ((PFAKE_REQUEST)Request)->Status;
+}
+
+static void FakeComplete()
+{
+	PFAKE_REQUEST request = g_Target.InFlight;
+	WDF_REQUEST_COMPLETION_PARAMS params;
+	ULONG count;
+	ULONG i;
+
+	if (request == NULL)
+	{
+		return;
+	}
+
+	g_Target.InFlight = NULL;
+
+	params.IoStatus.Status = g_Target.InFlightStatus;
+	params.IoStatus.Information = 0;
+
+	if (NT_SUCCESS(params.IoStatus.Status))
+	{
+		count = (ULONG)(request->Length / sizeof(HIDINJECTOR_INPUT_REPORT));
+		params.IoStatus.Information = request->Length;
+
+		g_Target.Writes++;
+		g_Target.Reports += count;
+		for (i = 0; i < count && g_Target.LoggedCount < MAX_LOGGED; i++)
+		{
+			RtlCopyMemory(&g_Target.Logged[g_Target.LoggedCount++], request->Buffer + i * sizeof(HIDINJECTOR_INPUT_REPORT), sizeof(HIDINJECTOR_INPUT_REPORT));
+		}
+	}
+
+	request->Completion((WDFREQUEST)request, NULL, &params, request->Context);
+}
+
+BOOLEAN WdfRequestSend(WDFREQUEST Request, WDFIOTARGET Target, PWDF_REQUEST_SEND_OPTIONS Options)
+{
+	PFAKE_REQUEST request = (PFAKE_REQUEST)Request;
+	NTSTATUS status = STATUS_SUCCESS;
+	BOOLEAN isSyncFailure = FALSE;
+
+	UNREFERENCED_PARAMETER(Target);
+	UNREFERENCED_PARAMETER(Options);
+
+	g_Target.Sends++;
+
+	if (g_Target.LockDepth != 0 || g_Target.InFlight != NULL || !request->IsFormatted)
+	{
+		g_Target.LockErrors++;
+	}
+
+	if (g_Target.ScriptNext < g_Target.ScriptCount)
+	{
+		status = g_Target.AsyncStatus[g_Target.ScriptNext];
+		isSyncFailure = g_Target.IsSyncFailure[g_Target.ScriptNext];
+		g_Target.ScriptNext++;
+	}
+
+	if (isSyncFailure)
+	{
+		request->Status = STATUS_DEVICE_NOT_CONNECTED;
+		return FALSE;
+	}
+
+	g_Target.InFlight = request;
+	g_Target.InFlightStatus = status;
+
+	if (g_Target.Mode == FakeInline)
+	{
+		FakeComplete();
+	}
+
+	return TRUE;
+}
+
+static void Script(NTSTATUS AsyncStatus, BOOLEAN IsSyncFailure)
+{
+	g_Target.AsyncStatus[g_Target.ScriptCount] = AsyncStatus;
+	g_Target.IsSyncFailure[g_Target.ScriptCount] = IsSyncFailure;
+	g_Target.ScriptCount++;
+}
+
+//The channel objects are children of the target, closing it deletes them
+static void Close(PDEVICE_CONTEXT pDevContext)
+{
+	free(pDevContext->HidChannel.Request);
+	free(pDevContext->HidChannel.Memory);
+}
+
+static void Reset(FAKE_MODE Mode, PDEVICE_CONTEXT pDevContext)
+{
+	RtlZeroMemory(&g_Target, sizeof(g_Target));
+	g_Target.Mode = Mode;
+
+	RtlZeroMemory(pDevContext, sizeof(DEVICE_CONTEXT));
+	pDevContext->HidInjectorIoTarget = (WDFIOTARGET)&g_Target;
+
+	RtlZeroMemory(&KeyboardState, sizeof(KeyboardState));
+
+	InjectChannelInitialize(pDevContext);
+}
+
+static void Keystroke(UCHAR VirtualKey, PDEVICE_CONTEXT pDevContext)
+{
+	InjectKeyDown(VirtualKey, pDevContext);
+	InjectKeyUp(VirtualKey, pDevContext);
+	InjectChannelFlush(pDevContext);
+}
+
+//Logged report Index holds Usage as the only key, or no key
+static BOOLEAN IsLogged(ULONG Index, UCHAR Usage)
+{
+	PHIDINJECTOR_INPUT_REPORT report = &g_Target.Logged[Index];
+
+	return Index < g_Target.LoggedCount &&
+		report->ReportId == KEYBOARD_REPORT_ID &&
+		report->Report.KeyReport.Key1 == Usage &&
+		report->Report.KeyReport.Key2 == 0;
+}
+
+//No write in flight and nothing left queued, nothing is stranded
+static BOOLEAN IsIdle(PDEVICE_CONTEXT pDevContext)
+{
+	return !pDevContext->HidChannel.IsBusy &&
+		pDevContext->HidChannel.PendingCount == 0 &&
+		g_Target.InFlight == NULL;
+}
+
+static void TestInline()
+{
+	DEVICE_CONTEXT context;
+	BOOLEAN isOrdered = TRUE;
+	ULONG i;
+
+	Reset(FakeInline, &context);
+	g_Target.Allocations = 0;
+
+	for (i = 0; i < 26; i++)
+	{
+		Keystroke((UCHAR)('A' + i), &context);
+	}
+
+	Check(g_Target.Writes == 26 && g_Target.Reports == 52, "inline", "one write per keystroke");
+	for (i = 0; i < 26; i++)
+	{
+		isOrdered = isOrdered && IsLogged(i * 2, VKeyToKeyboardUsage((UCHAR)('A' + i))) && IsLogged(i * 2 + 1, 0);
+	}
+	Check(isOrdered, "inline", "down and up of each key in order");
+	Check(g_Target.Allocations == 0, "inline", "nothing allocated per keystroke");
+	Check(g_Target.LockErrors == 0, "inline", "sent once formatted, without the lock");
+	Check(context.HidChannel.WriteCount == 26 && context.HidChannel.DroppedCount == 0, "inline", "statistics");
+	Check(IsIdle(&context), "inline", "idle");
+
+	Close(&context);
+}
+
+static void TestCoalesce()
+{
+	DEVICE_CONTEXT context;
+	ULONG i;
+
+	Reset(FakeDeferred, &context);
+
+	//The first keystroke goes out, three more wait for it
+	Keystroke('A', &context);
+	for (i = 0; i < 3; i++)
+	{
+		Keystroke((UCHAR)('B' + i), &context);
+	}
+	Check(g_Target.Sends == 1 && context.HidChannel.PendingCount == 6, "coalesce", "queued behind the write in flight");
+
+	FakeComplete();
+	Check(g_Target.Sends == 2 && g_Target.Writes == 1, "coalesce", "the completion sends the rest");
+	FakeComplete();
+	Check(g_Target.Writes == 2 && g_Target.Reports == 8, "coalesce", "six reports in one write");
+	Check(IsLogged(0, VKeyToKeyboardUsage('A')) && IsLogged(1, 0) && IsLogged(6, VKeyToKeyboardUsage('D')) && IsLogged(7, 0),
+		"coalesce", "in order");
+
+	//One keystroke in flight, the channel holds eight more reports, the rest is dropped
+	Keystroke('E', &context);
+	for (i = 0; i < 5; i++)
+	{
+		Keystroke((UCHAR)('F' + i), &context);
+	}
+	Check(context.HidChannel.PendingCount == HID_INJECT_MAX_REPORTS, "coalesce", "channel full");
+	Check(context.HidChannel.DroppedCount == 10 - HID_INJECT_MAX_REPORTS, "coalesce", "overflow dropped and counted");
+
+	FakeComplete();
+	FakeComplete();
+	Check(g_Target.Reports == 8 + 2 + HID_INJECT_MAX_REPORTS, "coalesce", "the channel went out");
+	Check(IsIdle(&context), "coalesce", "idle");
+	Check(g_Target.LockErrors == 0, "coalesce", "sent once formatted, without the lock");
+
+	Close(&context);
+}
+
+static void TestRetry()
+{
+	DEVICE_CONTEXT context;
+
+	Reset(FakeInline, &context);
+	Script(STATUS_UNSUCCESSFUL, FALSE);
+
+	InjectKeyDown('A', &context);
+	InjectChannelFlush(&context);
+	Check(g_Target.Sends == 2 && g_Target.Writes == 1, "retry", "sent again after the failure");
+	Check(IsLogged(0, VKeyToKeyboardUsage('A')), "retry", "delivered");
+	Check(context.HidChannel.WriteCount == 1 && context.HidChannel.DroppedCount == 0, "retry", "statistics");
+	Check(IsIdle(&context), "retry", "idle");
+
+	Close(&context);
+}
+
+static void TestSyncFailure()
+{
+	DEVICE_CONTEXT context;
+
+	Reset(FakeInline, &context);
+	Script(STATUS_SUCCESS, TRUE);
+
+	InjectKeyDown('A', &context);
+	InjectChannelFlush(&context);
+	Check(g_Target.Sends == 1 && g_Target.Writes == 0, "sync fail", "not sent");
+	Check(context.HidChannel.DroppedCount == 1, "sync fail", "dropped and counted");
+	Check(IsIdle(&context), "sync fail", "not left busy");
+
+	InjectKeyUp('A', &context);
+	InjectChannelFlush(&context);
+	Check(g_Target.Writes == 1 && IsLogged(0, 0), "sync fail", "the next report goes out");
+
+	Close(&context);
+}
+
+//The retry of a failed write cannot be sent, or fails again, while reports wait behind it
+static void TestRetryFailure(const char* Case, BOOLEAN IsSyncFailure)
+{
+	DEVICE_CONTEXT context;
+
+	Reset(FakeDeferred, &context);
+	Script(STATUS_UNSUCCESSFUL, FALSE);
+	Script(STATUS_UNSUCCESSFUL, IsSyncFailure);
+
+	InjectKeyDown('A', &context);
+	InjectChannelFlush(&context);
+	InjectKeyUp('A', &context);
+	Keystroke('B', &context);
+	Check(context.HidChannel.PendingCount == 3, Case, "queued behind the write in flight");
+
+	FakeComplete();
+	if (!IsSyncFailure)
+	{
+		Check(g_Target.InFlight != NULL, Case, "retry in flight");
+		FakeComplete();
+	}
+
+	Check(context.HidChannel.DroppedCount == 1, Case, "the failed write is dropped");
+	Check(g_Target.InFlight != NULL && context.HidChannel.PendingCount == 0, Case, "the queued reports are sent");
+
+	FakeComplete();
+	Check(g_Target.Writes == 1 && g_Target.Reports == 3, Case, "the queued reports arrive");
+	Check(IsLogged(0, 0) && IsLogged(1, VKeyToKeyboardUsage('B')) && IsLogged(2, 0), Case, "in order");
+	Check(IsIdle(&context), Case, "idle");
+	Check(g_Target.LockErrors == 0, Case, "sent once formatted, without the lock");
+
+	Close(&context);
+}
+
+static void Benchmark(FAKE_MODE Mode, const char* Name, ULONG Keystrokes)
+{
+	DEVICE_CONTEXT context;
+	LONGLONG start;
+	LONGLONG elapsed;
+	ULONG i;
+
+	Reset(Mode, &context);
+	g_Target.Allocations = 0;
+
+	start = NowNs();
+	for (i = 0; i < Keystrokes; i++)
+	{
+		Keystroke((UCHAR)('A' + i % 26), &context);
+
+		//The injector completes a write about every other keystroke
+		if (Mode == FakeDeferred && (i & 1) != 0 && g_Target.InFlight != NULL)
+		{
+			FakeComplete();
+		}
+	}
+	while (g_Target.InFlight != NULL)
+	{
+		FakeComplete();
+	}
+	elapsed = NowNs() - start;
+
+	Check(g_Target.Reports == Keystrokes * 2 && context.HidChannel.DroppedCount == 0, Name, "every report delivered");
+	Check(g_Target.Allocations == 0, Name, "nothing allocated per keystroke");
+	Check(Mode != FakeInline || g_Target.Writes == Keystrokes, Name, "one write per keystroke");
+
+	printf("%-8s %6.1f ns per keystroke, %.2f writes and %.2f allocations per keystroke\n",
+		Name,
+		(double)elapsed / Keystrokes,
+		(double)g_Target.Writes / Keystrokes,
+		(double)g_Target.Allocations / Keystrokes);
+
+	Close(&context);
+}
+
+int main(int argc, char** argv)
+{
+	ULONG keystrokes = 1000000;
+
+	if (argc > 1)
+	{
+		keystrokes = (ULONG)strtoul(argv[1], NULL, 0);
+	}
+
+	TestInline();
+	TestCoalesce();
+	TestRetry();
+	TestSyncFailure();
+	TestRetryFailure("retry sync", TRUE);
+	TestRetryFailure("retry fail", FALSE);
+
+	Benchmark(FakeInline, "inline", keystrokes);
+	Benchmark(FakeDeferred, "deferred", keystrokes);
+
+	if (g_Failures != 0)
+	{
+		printf("%d check(s) failed\n", g_Failures);
+		return 1;
+	}
+
+	printf("all checks passed\n");
+	return 0;
+}
@@ -0,0 +1,536 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	keystate.cpp
+
+Abstract:
+
+	Unit test of the keymap and the key state machine of Keymap.cpp,
+	driven with synthetic frame timings. The registry routines
+	CirKeymapLoad calls are implemented here against one fake value.
+
+	The keymap cases load:
+
+		default     no Keymap value, the Skyworth keymap is used
+		registry    the keymaps of two remotes
+		invalid     a value of the wrong type or length
+		full        more entries than the table takes
+		duplicate   the same code twice, the last one wins
+
+	The key cases feed codes at given interrupt times:
+
+		nec hold    repeat frames keep the key down, the release
+		            timeout follows the repeat interval
+		nec press   a new NEC frame while the key is down is a new press
+		rc5 toggle  the same toggle holds, a new toggle presses again
+		sirc        an unchanged frame holds, another command presses
+		repeats     a repeat with no key down, or of another protocol,
+		            changes nothing
+		unmapped    an unmapped code releases the held key
+		bounds      the release timeout stays within 60-300 ms
+		jitter      a 5 s hold with jittery repeats is one press and
+		            one release, the timer may fire up to a tick early
+
+	Build and use on any host with a C++ compiler:
+
+		c++ -O2 -I../../../../tools/host -I.. -o keystate keystate.cpp ../Keymap.cpp
+		keystate
+
+Environment:
+
+	user mode
+
+--*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Keymap.h"
+#include "WinVK.h"
+
+#define MS(Ms) ((ULONGLONG)(Ms) * 10000)
+
+#define TEST_NEC_ADDRESS 0x04fb
+#define TEST_RC5_ADDRESS 0x00
+
+unsigned long g_DebugLevel = 0;
+
+//The Keymap value, absent unless IsPresent
+typedef struct _FAKE_VALUE
+{
+	BOOLEAN IsPresent;
+	ULONG Type;
+	UCHAR Data[4096];
+	size_t Length;
+	LONG Buffers;
+}FAKE_VALUE;
+
+static FAKE_VALUE g_Value;
+static int g_Failures;
+
+static void Check(BOOLEAN Condition, const char* Case, const char* What)
+{
+	if (!Condition)
+	{
+		printf("FAIL %s: %s\n", Case, What);
+		g_Failures++;
+	}
+}
+
+NTSTATUS WdfDeviceOpenRegistryKey(WDFDEVICE Device, ULONG DeviceInstanceKeyType, ULONG DesiredAccess, PWDF_OBJECT_ATTRIBUTES KeyAttributes, WDFKEY* Key)
+{
+	UNREFERENCED_PARAMETER(Device);
+	UNREFERENCED_PARAMETER(DeviceInstanceKeyType);
+	UNREFERENCED_PARAMETER(DesiredAccess);
+	UNREFERENCED_PARAMETER(KeyAttributes);
+
+	*Key = (WDFKEY)&g_Value;
+	return STATUS_SUCCESS;
+}
+
+NTSTATUS WdfRegistryQueryMemory(WDFKEY Key, PCUNICODE_STRING ValueName, POOL_TYPE PoolType, PWDF_OBJECT_ATTRIBUTES MemoryAttributes, WDFMEMORY* Memory, PULONG ValueType)
+{
+	UNREFERENCED_PARAMETER(Key);
+	UNREFERENCED_PARAMETER(ValueName);
+	UNREFERENCED_PARAMETER(PoolType);
+	UNREFERENCED_PARAMETER(MemoryAttributes);
+
+	if (!g_Value.IsPresent)
+	{
+		return STATUS_OBJECT_NAME_NOT_FOUND;
+	}
+
+	g_Value.Buffers++;
+	*Memory = (WDFMEMORY)&g_Value;
+	if (ValueType != NULL)
+	{
+		*ValueType = g_Value.Type;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+VOID WdfRegistryClose(WDFKEY Key)
+{
+	UNREFERENCED_PARAMETER(Key);
+}
+
+PVOID WdfMemoryGetBuffer(WDFMEMORY Memory, size_t* BufferSize)
+{
+	UNREFERENCED_PARAMETER(Memory);
+
+	if (BufferSize != NULL)
+	{
+		*BufferSize = g_Value.Length;
+	}
+
+	return g_Value.Data;
+}
+
+VOID WdfObjectDelete(WDFOBJECT Object)
+{
+	UNREFERENCED_PARAMETER(Object);
+
+	g_Value.Buffers--;
+}
+
+static void SetValue(ULONG Type, const CIR_KEYMAP_ENTRY* Entries, ULONG Count)
+{
+	RtlZeroMemory(&g_Value, sizeof(g_Value));
+	g_Value.IsPresent = TRUE;
+	g_Value.Type = Type;
+	g_Value.Length = Count * sizeof(CIR_KEYMAP_ENTRY);
+	RtlCopyMemory(g_Value.Data, Entries, g_Value.Length);
+}
+
+static CIR_CODE Code(CIR_PROTOCOL Protocol, UINT16 Address, UINT16 Command, UINT8 Toggle, BOOLEAN IsRepeat)
+{
+	CIR_CODE code;
+
+	RtlZeroMemory(&code, sizeof(code));
+	code.Protocol = Protocol;
+	code.Address = Address;
+	code.Command = Command;
+	code.Toggle = Toggle;
+	code.IsRepeat = IsRepeat;
+
+	return code;
+}
+
+static UINT8 Lookup(PCIR_KEYMAP Keymap, CIR_PROTOCOL Protocol, UINT16 Address, UINT16 Command)
+{
+	CIR_CODE code = Code(Protocol, Address, Command, 0, FALSE);
+
+	return CirKeymapLookup(Keymap, &code);
+}
+
+static void TestDefaultKeymap()
+{
+	CIR_KEYMAP keymap;
+
+	RtlZeroMemory(&g_Value, sizeof(g_Value));
+	CirKeymapLoad(NULL, &keymap);
+
+	Check(keymap.Count == 18, "default", "the Skyworth keymap is loaded");
+	Check(Lookup(&keymap, CirProtocolNec, SKYWORTH_ADDR_CODE, PD6121G_VOL_UP) == VK_VOLUME_UP, "default", "volume up");
+	Check(Lookup(&keymap, CirProtocolNec, SKYWORTH_ADDR_CODE, PD6121G_NUM7) == '7', "default", "digit");
+	Check(Lookup(&keymap, CirProtocolNec, SKYWORTH_ADDR_CODE + 1, PD6121G_VOL_UP) == 0, "default", "other address");
+	Check(Lookup(&keymap, CirProtocolRc5, SKYWORTH_ADDR_CODE, PD6121G_VOL_UP) == 0, "default", "other protocol");
+}
+
+static void TestRegistryKeymap()
+{
+	static const CIR_KEYMAP_ENTRY entries[] =
+	{
+		{ CirProtocolNec, VK_UP, TEST_NEC_ADDRESS, 0x40, 0 },
+		{ CirProtocolNec, VK_DOWN, TEST_NEC_ADDRESS, 0x41, 0 },
+		{ CirProtocolNec, 0, TEST_NEC_ADDRESS, 0x42, 0 },
+		{ CirProtocolRc5, VK_VOLUME_UP, TEST_RC5_ADDRESS, 16, 0 },
+		{ CirProtocolRc5, VK_VOLUME_DOWN, TEST_RC5_ADDRESS, 17, 0 },
+	};
+	CIR_KEYMAP keymap;
+
+	SetValue(REG_BINARY, entries, ARRAYSIZE(entries));
+	CirKeymapLoad(NULL, &keymap);
+
+	Check(keymap.Count == 4, "registry", "the entries with a key are loaded");
+	Check(Lookup(&keymap, CirProtocolNec, TEST_NEC_ADDRESS, 0x41) == VK_DOWN, "registry", "NEC remote");
+	Check(Lookup(&keymap, CirProtocolRc5, TEST_RC5_ADDRESS, 16) == VK_VOLUME_UP, "registry", "RC5 remote");
+	Check(Lookup(&keymap, CirProtocolNec, TEST_NEC_ADDRESS, 0x42) == 0, "registry", "no key is no entry");
+	Check(Lookup(&keymap, CirProtocolNec, SKYWORTH_ADDR_CODE, PD6121G_VOL_UP) == 0, "registry", "no default keys");
+	Check(g_Value.Buffers == 0, "registry", "value memory deleted");
+}
+
+static void TestInvalidKeymap()
+{
+	static const CIR_KEYMAP_ENTRY entries[] =
+	{
+		{ CirProtocolNec, VK_UP, TEST_NEC_ADDRESS, 0x40, 0 },
+	};
+	CIR_KEYMAP keymap;
+
+	SetValue(REG_BINARY + 1, entries, ARRAYSIZE(entries));
+	CirKeymapLoad(NULL, &keymap);
+	Check(keymap.Count == 18 && Lookup(&keymap, CirProtocolNec, TEST_NEC_ADDRESS, 0x40) == 0,
+		"invalid", "the wrong type loads the default keymap");
+	Check(g_Value.Buffers == 0, "invalid", "value memory deleted");
+
+	SetValue(REG_BINARY, entries, ARRAYSIZE(entries));
+	g_Value.Length -= 1;
+	CirKeymapLoad(NULL, &keymap);
+	Check(keymap.Count == 18 && Lookup(&keymap, CirProtocolNec, TEST_NEC_ADDRESS, 0x40) == 0,
+		"invalid", "a partial entry loads the default keymap");
+
+	SetValue(REG_BINARY, entries, 0);
+	CirKeymapLoad(NULL, &keymap);
+	Check(keymap.Count == 18, "invalid", "an empty value loads the default keymap");
+}
+
+static void TestFullKeymap()
+{
+	CIR_KEYMAP_ENTRY entries[CIR_KEYMAP_SLOTS + 44];
+	CIR_KEYMAP keymap;
+	ULONG found = 0;
+	ULONG i;
+
+	for (i = 0; i < ARRAYSIZE(entries); i++)
+	{
+		entries[i].Protocol = (UINT8)(CirProtocolNec + i % 4);
+		entries[i].VirtualKey = (UINT8)(0x30 + i % 64);
+		entries[i].Address = (UINT16)(i / 16);
+		entries[i].Command = (UINT16)i;
+		entries[i].Reserved = 0;
+	}
+
+	SetValue(REG_BINARY, entries, ARRAYSIZE(entries));
+	CirKeymapLoad(NULL, &keymap);
+
+	Check(keymap.Count == CIR_KEYMAP_MAX_ENTRIES, "full", "loading stops at the entry limit");
+
+	for (i = 0; i < ARRAYSIZE(entries); i++)
+	{
+		if (Lookup(&keymap, (CIR_PROTOCOL)entries[i].Protocol, entries[i].Address, entries[i].Command) == entries[i].VirtualKey)
+		{
+			Check(i < CIR_KEYMAP_MAX_ENTRIES, "full", "only entries within the limit are found");
+			found++;
+		}
+	}
+	Check(found == CIR_KEYMAP_MAX_ENTRIES, "full", "every loaded entry is found");
+}
+
+static void TestDuplicateKeymap()
+{
+	static const CIR_KEYMAP_ENTRY entries[] =
+	{
+		{ CirProtocolNec, VK_UP, TEST_NEC_ADDRESS, 0x40, 0 },
+		{ CirProtocolNec, VK_LEFT, TEST_NEC_ADDRESS, 0x40, 0 },
+	};
+	CIR_KEYMAP keymap;
+
+	SetValue(REG_BINARY, entries, ARRAYSIZE(entries));
+	CirKeymapLoad(NULL, &keymap);
+
+	Check(keymap.Count == 1, "duplicate", "one entry per code");
+	Check(Lookup(&keymap, CirProtocolNec, TEST_NEC_ADDRESS, 0x40) == VK_LEFT, "duplicate", "the last entry wins");
+}
+
+static void LoadTestKeymap(PCIR_KEYMAP Keymap)
+{
+	static const CIR_KEYMAP_ENTRY entries[] =
+	{
+		{ CirProtocolNec, VK_UP, TEST_NEC_ADDRESS, 0x40, 0 },
+		{ CirProtocolNec, VK_DOWN, TEST_NEC_ADDRESS, 0x41, 0 },
+		{ CirProtocolRc5, VK_VOLUME_UP, TEST_RC5_ADDRESS, 16, 0 },
+		{ CirProtocolSirc, VK_RETURN, 1, 11, 0 },
+		{ CirProtocolSirc, VK_BACK, 1, 12, 0 },
+	};
+
+	SetValue(REG_BINARY, entries, ARRAYSIZE(entries));
+	CirKeymapLoad(NULL, Keymap);
+}
+
+//Feeds a code and checks the events it led to, +VK for a press, -VK for a release and 0 for none
+static void Feed(PCIR_KEY_STATE Key, PCIR_KEYMAP Keymap, CIR_CODE Code, ULONGLONG Now, int First, int Second, const char* Case, const char* What)
+{
+	CIR_KEY_EVENT events[CIR_KEY_MAX_EVENTS];
+	int expected[CIR_KEY_MAX_EVENTS] = { First, Second };
+	BOOLEAN isMatch;
+	ULONG count;
+	ULONG i;
+
+	count = CirKeyStateProcessCode(Key, Keymap, &Code, Now, events);
+
+	isMatch = count == (ULONG)((First != 0) + (Second != 0));
+	for (i = 0; isMatch && i < count; i++)
+	{
+		isMatch = events[i].IsDown == (expected[i] > 0) && events[i].VirtualKey == abs(expected[i]);
+	}
+
+	Check(isMatch, Case, What);
+}
+
+static void TestNecHold()
+{
+	CIR_KEYMAP keymap;
+	CIR_KEY_STATE key;
+	CIR_KEY_EVENT event;
+
+	LoadTestKeymap(&keymap);
+	RtlZeroMemory(&key, sizeof(key));
+
+	Feed(&key, &keymap, Code(CirProtocolNec, TEST_NEC_ADDRESS, 0x40, 0, FALSE), MS(1000), VK_UP, 0, "nec hold", "frame presses the key");
+	Check(key.ReleaseTime == MS(1000 + CIR_KEY_RELEASE_TIMEOUT_MS), "nec hold", "release after the initial timeout");
+
+	Feed(&key, &keymap, Code(CirProtocolNec, 0, 0, 0, TRUE), MS(1108), 0, 0, "nec hold", "repeat holds the key");
+	Check(key.RepeatIntervalMs == 108, "nec hold", "repeat interval measured");
+	Check(key.ReleaseTime == MS(1108 + 216), "nec hold", "release after twice the interval");
+
+	Feed(&key, &keymap, Code(CirProtocolNec, 0, 0, 0, TRUE), MS(1220), 0, 0, "nec hold", "second repeat holds the key");
+	Check(key.RepeatIntervalMs == (108 * 3 + 112) / 4, "nec hold", "repeat interval smoothed");
+
+	Check(!CirKeyStateIsReleaseDue(&key, MS(1220 + 218 - CIR_KEY_RELEASE_SLACK_MS) - 1), "nec hold", "not due before the deadline");
+	Check(CirKeyStateIsReleaseDue(&key, MS(1220 + 218 - CIR_KEY_RELEASE_SLACK_MS)), "nec hold", "due within the timer slack");
+
+	Check(CirKeyStateRelease(&key, &event) == 1 && !event.IsDown && event.VirtualKey == VK_UP, "nec hold", "release event");
+	Check(CirKeyStateRelease(&key, &event) == 0, "nec hold", "released once");
+	Check(!CirKeyStateIsReleaseDue(&key, MS(5000)), "nec hold", "nothing due once released");
+}
+
+static void TestNecPress()
+{
+	CIR_KEYMAP keymap;
+	CIR_KEY_STATE key;
+
+	LoadTestKeymap(&keymap);
+	RtlZeroMemory(&key, sizeof(key));
+
+	Feed(&key, &keymap, Code(CirProtocolNec, TEST_NEC_ADDRESS, 0x40, 0, FALSE), MS(0), VK_UP, 0, "nec press", "first press");
+	Feed(&key, &keymap, Code(CirProtocolNec, TEST_NEC_ADDRESS, 0x40, 0, FALSE), MS(150), -VK_UP, VK_UP, "nec press", "same frame again presses again");
+	Feed(&key, &keymap, Code(CirProtocolNec, TEST_NEC_ADDRESS, 0x41, 0, FALSE), MS(300), -VK_UP, VK_DOWN, "nec press", "another key");
+	Check(key.RepeatIntervalMs == 0, "nec press", "a new press forgets the repeat interval");
+}
+
+static void TestRc5Toggle()
+{
+	CIR_KEYMAP keymap;
+	CIR_KEY_STATE key;
+
+	LoadTestKeymap(&keymap);
+	RtlZeroMemory(&key, sizeof(key));
+
+	Feed(&key, &keymap, Code(CirProtocolRc5, TEST_RC5_ADDRESS, 16, 1, FALSE), MS(0), VK_VOLUME_UP, 0, "rc5 toggle", "press");
+	Feed(&key, &keymap, Code(CirProtocolRc5, TEST_RC5_ADDRESS, 16, 1, FALSE), MS(114), 0, 0, "rc5 toggle", "same toggle holds");
+	Check(key.ReleaseTime == MS(114 + 228), "rc5 toggle", "release after twice the interval");
+	Feed(&key, &keymap, Code(CirProtocolRc5, TEST_RC5_ADDRESS, 16, 0, FALSE), MS(228), -VK_VOLUME_UP, VK_VOLUME_UP, "rc5 toggle", "new toggle presses again");
+}
+
+static void TestSirc()
+{
+	CIR_KEYMAP keymap;
+	CIR_KEY_STATE key;
+
+	LoadTestKeymap(&keymap);
+	RtlZeroMemory(&key, sizeof(key));
+
+	Feed(&key, &keymap, Code(CirProtocolSirc, 1, 11, 0, FALSE), MS(0), VK_RETURN, 0, "sirc", "press");
+	Feed(&key, &keymap, Code(CirProtocolSirc, 1, 11, 0, FALSE), MS(45), 0, 0, "sirc", "unchanged frame holds");
+	Check(key.ReleaseTime == MS(45 + 90), "sirc", "release after twice the interval");
+	Feed(&key, &keymap, Code(CirProtocolSirc, 1, 12, 0, FALSE), MS(90), -VK_RETURN, VK_BACK, "sirc", "another command presses");
+}
+
+static void TestRepeats()
+{
+	CIR_KEYMAP keymap;
+	CIR_KEY_STATE key;
+	ULONGLONG releaseTime;
+
+	LoadTestKeymap(&keymap);
+	RtlZeroMemory(&key, sizeof(key));
+
+	Feed(&key, &keymap, Code(CirProtocolNec, 0, 0, 0, TRUE), MS(0), 0, 0, "repeats", "repeat with no key down");
+	Check(!key.IsDown, "repeats", "no key down");
+
+	Feed(&key, &keymap, Code(CirProtocolRc5, TEST_RC5_ADDRESS, 16, 1, FALSE), MS(100), VK_VOLUME_UP, 0, "repeats", "press");
+	releaseTime = key.ReleaseTime;
+	Feed(&key, &keymap, Code(CirProtocolNec, 0, 0, 0, TRUE), MS(150), 0, 0, "repeats", "NEC repeat while an RC5 key is down");
+	Check(key.IsDown && key.ReleaseTime == releaseTime, "repeats", "deadline unchanged");
+}
+
+static void TestUnmapped()
+{
+	CIR_KEYMAP keymap;
+	CIR_KEY_STATE key;
+
+	LoadTestKeymap(&keymap);
+	RtlZeroMemory(&key, sizeof(key));
+
+	Feed(&key, &keymap, Code(CirProtocolNec, TEST_NEC_ADDRESS, 0x41, 0, FALSE), MS(0), VK_DOWN, 0, "unmapped", "press");
+	Feed(&key, &keymap, Code(CirProtocolNec, TEST_NEC_ADDRESS, 0x77, 0, FALSE), MS(200), -VK_DOWN, 0, "unmapped", "unmapped code releases");
+	Check(!key.IsDown, "unmapped", "no key down");
+	Feed(&key, &keymap, Code(CirProtocolNec, 0, 0, 0, TRUE), MS(308), 0, 0, "unmapped", "its repeats do nothing");
+}
+
+static void TestBounds()
+{
+	CIR_KEYMAP keymap;
+	CIR_KEY_STATE key;
+
+	LoadTestKeymap(&keymap);
+	RtlZeroMemory(&key, sizeof(key));
+
+	Feed(&key, &keymap, Code(CirProtocolNec, TEST_NEC_ADDRESS, 0x40, 0, FALSE), MS(0), VK_UP, 0, "bounds", "press");
+	Feed(&key, &keymap, Code(CirProtocolNec, 0, 0, 0, TRUE), MS(10), 0, 0, "bounds", "fast repeat");
+	Check(key.ReleaseTime == MS(10 + CIR_KEY_RELEASE_MIN_MS), "bounds", "timeout raised to the minimum");
+
+	RtlZeroMemory(&key, sizeof(key));
+	Feed(&key, &keymap, Code(CirProtocolNec, TEST_NEC_ADDRESS, 0x40, 0, FALSE), MS(0), VK_UP, 0, "bounds", "press");
+	Feed(&key, &keymap, Code(CirProtocolNec, 0, 0, 0, TRUE), MS(190), 0, 0, "bounds", "slow repeat");
+	Check(key.ReleaseTime == MS(190 + CIR_KEY_RELEASE_MAX_MS), "bounds", "timeout capped at the maximum");
+}
+
+//Runs the hold on a 1 ms clock the way the DPC does, the release timer fires up to a tick before the deadline
+static void TestJitter()
+{
+	CIR_KEYMAP keymap;
+	CIR_KEY_STATE key;
+	CIR_KEY_EVENT events[CIR_KEY_MAX_EVENTS];
+	CIR_CODE frame = Code(CirProtocolNec, TEST_NEC_ADDRESS, 0x41, 0, FALSE);
+	CIR_CODE repeat = Code(CirProtocolNec, 0, 0, 0, TRUE);
+	ULONG seed = 12345;
+	ULONG presses = 0;
+	ULONG releases = 0;
+	ULONG count;
+	ULONG i;
+	ULONG nextFrame = 100;
+	ULONG lastFrame = 0;
+	ULONG releasedAt = 0;
+	ULONG timerAt = 0;
+	ULONG ms;
+
+	LoadTestKeymap(&keymap);
+	RtlZeroMemory(&key, sizeof(key));
+
+	for (ms = 0; ms < 6000; ms++)
+	{
+		count = 0;
+
+		if (ms == nextFrame && ms < 5100)
+		{
+			count = CirKeyStateProcessCode(&key, &keymap, ms == 100 ? &frame : &repeat, MS(ms), events);
+			lastFrame = ms;
+
+			seed = seed * 1103515245 + 12345;
+			nextFrame = ms + 100 + (seed >> 16) % 17;
+
+			seed = seed * 1103515245 + 12345;
+			timerAt = (ULONG)(key.ReleaseTime / 10000) - (seed >> 16) % CIR_KEY_RELEASE_SLACK_MS;
+		}
+		else if (ms == timerAt && CirKeyStateIsReleaseDue(&key, MS(ms)))
+		{
+			count = CirKeyStateRelease(&key, events);
+			releasedAt = ms;
+		}
+
+		for (i = 0; i < count; i++)
+		{
+			if (events[i].IsDown)
+			{
+				presses++;
+			}
+			else
+			{
+				releases++;
+			}
+		}
+	}
+
+	Check(presses == 1 && releases == 1, "jitter", "one press and one release");
+	Check(releasedAt > lastFrame && releasedAt <= lastFrame + 2 * 116, "jitter", "released within two repeat intervals of the last frame");
+	printf("jitter   repeat interval %u ms, released %u ms after the last frame\n", key.RepeatIntervalMs, releasedAt - lastFrame);
+}
+
+int main()
+{
+	TestDefaultKeymap();
+	TestRegistryKeymap();
+	TestInvalidKeymap();
+	TestFullKeymap();
+	TestDuplicateKeymap();
+
+	TestNecHold();
+	TestNecPress();
+	TestRc5Toggle();
+	TestSirc();
+	TestRepeats();
+	TestUnmapped();
+	TestBounds();
+	TestJitter();
+
+	if (g_Failures != 0)
+	{
+		printf("%d check(s) failed\n", g_Failures);
+		return 1;
+	}
+
+	printf("all checks passed\n");
+	return 0;
+}
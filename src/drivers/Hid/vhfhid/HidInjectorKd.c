@@ -158,7 +158,6 @@ HID_DESCRIPTOR              G_DefaultHidDescriptor =
 #pragma alloc_text(PAGE, HIDINJECTOR_EvtDeviceSelfManagedIoInit)
 #pragma alloc_text(PAGE, HIDINJECTOR_EvtDeviceSelfManagedIoCleanup)
 #pragma alloc_text(PAGE, HIDINJECTOR_VhfInitialize)
-#pragma alloc_text(PAGE, HIDINJECTOR_VhfSubmitReadReport)
 #pragma alloc_text(PAGE, HIDINJECTOR_GetFeatureReport)
 #pragma alloc_text(PAGE, HIDINJECTOR_VhfAsyncOperationGetFeature)
 
@@ -247,6 +246,8 @@ NTSTATUS
 	WDF_OBJECT_ATTRIBUTES   deviceAttributes;
 	WDFDEVICE               device;
 	PHID_DEVICE_CONTEXT     deviceContext;
+	WDF_OBJECT_ATTRIBUTES   attributes;
+	WDF_TIMER_CONFIG        timerConfig;
 
 	UNREFERENCED_PARAMETER(Driver);
 	WDF_PNPPOWER_EVENT_CALLBACKS    wdfPnpPowerCallbacks;
@@ -287,6 +288,29 @@ NTSTATUS
 	deviceContext->HidDescriptor = G_DefaultHidDescriptor;
 	deviceContext->ReportDescriptor = G_DefaultReportDescriptor;
 
+	//
+	// Lock and timer pacing the submission of written reports
+	//
+	WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+	attributes.ParentObject = device;
+
+	status = WdfSpinLockCreate(&attributes, &deviceContext->ReportLock);
+	if (!NT_SUCCESS(status))
+	{
+		KdPrint(("WdfSpinLockCreate failed 0x%x\n", status));
+		return status;
+	}
+
+	WDF_TIMER_CONFIG_INIT(&timerConfig, HIDINJECTOR_EvtBatchTimer);
+	timerConfig.AutomaticSerialization = FALSE;
+
+	status = WdfTimerCreate(&timerConfig, &attributes, &deviceContext->BatchTimer);
+	if (!NT_SUCCESS(status))
+	{
+		KdPrint(("WdfTimerCreate failed 0x%x\n", status));
+		return status;
+	}
+
 	//
 	// Initialize VHF.  This will talk to HIDCLASS for us.
 	//
@@ -335,7 +359,7 @@ RawQueueCreate(
 
 	WDF_IO_QUEUE_CONFIG_INIT(
 		&queueConfig,
-		WdfIoQueueDispatchParallel);
+		WdfIoQueueDispatchSequential);
 
 	queueConfig.EvtIoWrite = HIDINJECTOR_EvtIoWriteFromRawPdo;
 
@@ -364,6 +388,303 @@ RawQueueCreate(
 }
 
 
+static VOID
+HIDINJECTOR_BatchFinish(
+	_In_ PHID_DEVICE_CONTEXT DeviceContext,
+	_In_ NTSTATUS Status
+)
+{
+	PHIDINJECTOR_BATCH batch = &DeviceContext->Batch;
+	WDFREQUEST request = batch->Request;
+	ULONG_PTR information = batch->HeaderLength + batch->Index * batch->Stride;
+
+	if (Status == STATUS_DEVICE_BUSY)
+	{
+		DeviceContext->BusyCount++;
+	}
+
+	batch->Request = NULL;
+	batch->State = BatchIdle;
+
+	WdfRequestCompleteWithInformation(request, Status, information);
+}
+
+static VOID
+HIDINJECTOR_BatchComplete(
+	_In_ PHID_DEVICE_CONTEXT DeviceContext,
+	_In_ NTSTATUS Status
+)
+/*++
+Routine Description:
+
+HIDINJECTOR_BatchComplete completes the current write from the path that owns
+the batch. If the write was cancelled but EvtRequestCancel has not run yet,
+the request is left for it to complete.
+
+Arguments:
+
+DeviceContext - 	The device context.
+
+Status - 			The completion status.
+
+Return Value:
+
+VOID
+
+--*/
+{
+	PHIDINJECTOR_BATCH batch = &DeviceContext->Batch;
+	BOOLEAN isCancelPending = FALSE;
+
+	if (WdfRequestUnmarkCancelable(batch->Request) == STATUS_CANCELLED)
+	{
+		WdfSpinLockAcquire(DeviceContext->ReportLock);
+
+		if (!batch->IsCancelled)
+		{
+			batch->CompletionStatus = Status;
+			batch->State = BatchCancelPending;
+			isCancelPending = TRUE;
+		}
+
+		WdfSpinLockRelease(DeviceContext->ReportLock);
+	}
+
+	if (!isCancelPending)
+	{
+		HIDINJECTOR_BatchFinish(DeviceContext, Status);
+	}
+}
+
+static VOID
+HIDINJECTOR_BatchRun(
+	_In_ PHID_DEVICE_CONTEXT DeviceContext
+)
+/*++
+Routine Description:
+
+HIDINJECTOR_BatchRun submits the reports of the current write in order until
+one has to wait for its delay or for HIDCLASS to get ready, the timer or
+EvtVhfReadyForNextReadReport resumes it. Called in BatchRunning state by
+whichever path owns the batch.
+
+Arguments:
+
+DeviceContext - 	The device context.
+
+Return Value:
+
+VOID
+
+--*/
+{
+	PHIDINJECTOR_BATCH batch = &DeviceContext->Batch;
+	PUCHAR entry;
+	ULONG delayUs;
+	NTSTATUS status = STATUS_SUCCESS;
+
+	while (batch->Index < batch->Count)
+	{
+		entry = batch->Entries + batch->Index * batch->Stride;
+
+		if (batch->HeaderLength != 0)
+		{
+			delayUs = ((PHIDINJECTOR_BATCH_ENTRY)entry)->DelayUs;
+			entry = (PUCHAR)&((PHIDINJECTOR_BATCH_ENTRY)entry)->Report;
+		}
+		else
+		{
+			delayUs = 0;
+		}
+
+		WdfSpinLockAcquire(DeviceContext->ReportLock);
+
+		if (batch->IsCancelled)
+		{
+			WdfSpinLockRelease(DeviceContext->ReportLock);
+			status = STATUS_CANCELLED;
+			break;
+		}
+
+		//
+		// Waits are started under the lock so EvtRequestCancel always
+		// finds the timer queued
+		//
+		if (!batch->IsDelayDone)
+		{
+			batch->IsDelayDone = TRUE;
+
+			if (delayUs != 0)
+			{
+				batch->State = BatchDelay;
+				WdfTimerStart(DeviceContext->BatchTimer, WDF_REL_TIMEOUT_IN_US(delayUs));
+				WdfSpinLockRelease(DeviceContext->ReportLock);
+				return;
+			}
+		}
+
+		if (!DeviceContext->IsReadReady)
+		{
+			if (batch->Flags & HIDINJECTOR_BATCH_FLAG_NO_WAIT)
+			{
+				WdfSpinLockRelease(DeviceContext->ReportLock);
+				status = STATUS_DEVICE_BUSY;
+				break;
+			}
+
+			batch->State = BatchWaitRead;
+			WdfTimerStart(DeviceContext->BatchTimer, WDF_REL_TIMEOUT_IN_MS(HIDINJECTOR_BATCH_STALL_MS));
+			WdfSpinLockRelease(DeviceContext->ReportLock);
+			return;
+		}
+
+		DeviceContext->IsReadReady = FALSE;
+
+		WdfSpinLockRelease(DeviceContext->ReportLock);
+
+		status = HIDINJECTOR_VhfSubmitReadReport(DeviceContext,
+			entry,
+			sizeof(HIDINJECTOR_INPUT_REPORT));
+		if (!NT_SUCCESS(status))
+		{
+			break;
+		}
+
+		batch->Index++;
+		batch->IsDelayDone = FALSE;
+	}
+
+	HIDINJECTOR_BatchComplete(DeviceContext, status);
+}
+
+VOID
+HIDINJECTOR_EvtBatchTimer(
+	_In_ WDFTIMER Timer
+)
+{
+	PHID_DEVICE_CONTEXT deviceContext = GetHidDeviceContext(WdfTimerGetParentObject(Timer));
+	PHIDINJECTOR_BATCH batch = &deviceContext->Batch;
+	BOOLEAN isResume = FALSE;
+	BOOLEAN isStalled = FALSE;
+
+	WdfSpinLockAcquire(deviceContext->ReportLock);
+
+	if (batch->State == BatchDelay ||
+		(batch->State == BatchWaitRead && deviceContext->IsReadReady))
+	{
+		batch->State = BatchRunning;
+		isResume = TRUE;
+	}
+	else if (batch->State == BatchWaitRead)
+	{
+		batch->State = BatchRunning;
+		isStalled = TRUE;
+	}
+
+	WdfSpinLockRelease(deviceContext->ReportLock);
+
+	if (isResume)
+	{
+		HIDINJECTOR_BatchRun(deviceContext);
+	}
+	else if (isStalled)
+	{
+		KdPrint(("HIDINJECTOR no read pending for %dms, %d of %d reports submitted\n",
+			HIDINJECTOR_BATCH_STALL_MS, batch->Index, batch->Count));
+		HIDINJECTOR_BatchComplete(deviceContext, STATUS_DEVICE_BUSY);
+	}
+}
+
+VOID
+HIDINJECTOR_EvtBatchRequestCancel(
+	_In_ WDFREQUEST Request
+)
+/*++
+Routine Description:
+
+HIDINJECTOR_EvtBatchRequestCancel completes a cancelled write that waits for
+its delay or for HIDCLASS. A write being submitted stops before its next
+report and completes itself.
+
+Arguments:
+
+Request - 	The write being submitted.
+
+Return Value:
+
+VOID
+
+--*/
+{
+	PQUEUE_CONTEXT queueContext = GetQueueContext(WdfRequestGetIoQueue(Request));
+	PHID_DEVICE_CONTEXT deviceContext = queueContext->DeviceContext;
+	PHIDINJECTOR_BATCH batch = &deviceContext->Batch;
+	NTSTATUS status = STATUS_CANCELLED;
+	BOOLEAN isOwner = FALSE;
+
+	WdfSpinLockAcquire(deviceContext->ReportLock);
+
+	batch->IsCancelled = TRUE;
+
+	if (batch->State == BatchCancelPending)
+	{
+		status = batch->CompletionStatus;
+		isOwner = TRUE;
+	}
+	else if ((batch->State == BatchDelay || batch->State == BatchWaitRead) &&
+		WdfTimerStop(deviceContext->BatchTimer, FALSE))
+	{
+		batch->State = BatchRunning;
+		isOwner = TRUE;
+	}
+
+	WdfSpinLockRelease(deviceContext->ReportLock);
+
+	if (isOwner)
+	{
+		HIDINJECTOR_BatchFinish(deviceContext, status);
+	}
+}
+
+VOID
+HIDINJECTOR_EvtVhfReadyForNextReadReport(
+	_In_ PVOID VhfClientContext
+)
+/*++
+Routine Description:
+
+HIDINJECTOR_EvtVhfReadyForNextReadReport is called by VHF once HIDCLASS can take
+the next input report. Exactly one report may be submitted per call.
+
+Arguments:
+
+VhfClientContext - 	The device context passed in VHF_CONFIG.
+
+Return Value:
+
+VOID
+
+--*/
+{
+	PHID_DEVICE_CONTEXT deviceContext = (PHID_DEVICE_CONTEXT)VhfClientContext;
+	PHIDINJECTOR_BATCH batch = &deviceContext->Batch;
+	BOOLEAN isWaiting;
+
+	WdfSpinLockAcquire(deviceContext->ReportLock);
+	deviceContext->IsReadReady = TRUE;
+	isWaiting = (batch->State == BatchWaitRead);
+	WdfSpinLockRelease(deviceContext->ReportLock);
+
+	//
+	// If the stall timer already fired it sees IsReadReady and resumes itself
+	//
+	if (isWaiting && WdfTimerStop(deviceContext->BatchTimer, FALSE))
+	{
+		batch->State = BatchRunning;
+		HIDINJECTOR_BatchRun(deviceContext);
+	}
+}
+
 VOID HIDINJECTOR_EvtIoWriteFromRawPdo(
 	_In_ WDFQUEUE   Queue,
 	_In_ WDFREQUEST Request,
@@ -371,12 +692,18 @@ VOID HIDINJECTOR_EvtIoWriteFromRawPdo(
 )
 {
 	PQUEUE_CONTEXT queueContext;
+	PHIDINJECTOR_BATCH batch;
+	PHIDINJECTOR_BATCH_HEADER header;
+	PHIDINJECTOR_BATCH_ENTRY entries;
+	ULONGLONG totalUs;
+	ULONG i;
 	WDFMEMORY memory;
 	void *pvoid;
 	size_t length;
 	NTSTATUS status;
 
 	queueContext = GetQueueContext(Queue);
+	batch = &queueContext->DeviceContext->Batch;
 
 	if (Length < sizeof(HIDINJECTOR_INPUT_REPORT))
 	{
@@ -395,24 +722,96 @@ VOID HIDINJECTOR_EvtIoWriteFromRawPdo(
 		return;
 	}
 	pvoid = WdfMemoryGetBuffer(memory, &length);
-	if (pvoid == NULL)
+	if (pvoid == NULL || length < Length)
 	{
 		WdfRequestComplete(Request, STATUS_INVALID_BUFFER_SIZE);
 		return;
 	}
 
+	header = (PHIDINJECTOR_BATCH_HEADER)pvoid;
 
-	// 
-	// Complete the input IRP if we have one
-	//
-	HIDINJECTOR_VhfSubmitReadReport(queueContext->DeviceContext,
-		pvoid,
-		Length);
+	if (header->Signature == HIDINJECTOR_BATCH_SIGNATURE)
+	{
+		if (Length < sizeof(HIDINJECTOR_BATCH_HEADER) ||
+			header->Version != HIDINJECTOR_BATCH_VERSION ||
+			header->Count == 0 ||
+			header->Count > HIDINJECTOR_BATCH_MAX_REPORTS ||
+			Length < sizeof(HIDINJECTOR_BATCH_HEADER) + header->Count * sizeof(HIDINJECTOR_BATCH_ENTRY))
+		{
+			KdPrint(("WriteReport: invalid batch. size %d\n", Length));
+			WdfRequestComplete(Request, STATUS_INVALID_PARAMETER);
+			return;
+		}
 
+		//
+		// Bound how long a write can hold the sequential queue
+		//
+		entries = (PHIDINJECTOR_BATCH_ENTRY)(header + 1);
+		totalUs = 0;
+
+		for (i = 0; i < header->Count; i++)
+		{
+			if (entries[i].DelayUs > HIDINJECTOR_BATCH_MAX_DELAY_US)
+			{
+				break;
+			}
+
+			totalUs += entries[i].DelayUs;
+		}
+
+		if (i < header->Count || totalUs > HIDINJECTOR_BATCH_MAX_TOTAL_MS * 1000ULL)
+		{
+			KdPrint(("WriteReport: batch delays too long. entry %d, total %dus\n",
+				i, (ULONG)totalUs));
+			WdfRequestComplete(Request, STATUS_INVALID_PARAMETER);
+			return;
+		}
+
+		batch->HeaderLength = sizeof(HIDINJECTOR_BATCH_HEADER);
+		batch->Stride = sizeof(HIDINJECTOR_BATCH_ENTRY);
+		batch->Count = header->Count;
+		batch->Flags = header->Flags;
+	}
+	else
+	{
+		//
+		// One or more whole reports, submitted back to back
+		//
+		if (Length % sizeof(HIDINJECTOR_INPUT_REPORT) != 0)
+		{
+			KdPrint(("WriteReport: invalid input buffer. size %d, expect multiple of %d\n",
+				Length, sizeof(HIDINJECTOR_INPUT_REPORT)));
+			WdfRequestComplete(Request, STATUS_INVALID_BUFFER_SIZE);
+			return;
+		}
+
+		batch->HeaderLength = 0;
+		batch->Stride = sizeof(HIDINJECTOR_INPUT_REPORT);
+		batch->Count = (ULONG)(Length / sizeof(HIDINJECTOR_INPUT_REPORT));
+		batch->Flags = 0;
+	}
+
+	batch->Request = Request;
+	batch->Entries = (PUCHAR)pvoid + batch->HeaderLength;
+	batch->Index = 0;
+	batch->IsDelayDone = FALSE;
+	batch->IsCancelled = FALSE;
+	batch->State = BatchRunning;
+
+	status = WdfRequestMarkCancelableEx(Request, HIDINJECTOR_EvtBatchRequestCancel);
+	if (!NT_SUCCESS(status))
+	{
+		batch->Request = NULL;
+		batch->State = BatchIdle;
+		WdfRequestComplete(Request, status);
+		return;
+	}
+
+	// 
+	// Complete the input IRP if we have one, the request is completed once
+	// all reports are submitted
 	//
-	// set status and information
-	//
-	WdfRequestCompleteWithInformation(Request, STATUS_SUCCESS, Length);
+	HIDINJECTOR_BatchRun(queueContext->DeviceContext);
 }
 
 NTSTATUS
@@ -444,11 +843,32 @@ HIDINJECTOR_EvtDeviceSelfManagedIoCleanup(
 )
 {
 	PHID_DEVICE_CONTEXT	deviceContext;
+	BOOLEAN isWaiting;
 
 	PAGED_CODE();
 
 	deviceContext = GetHidDeviceContext(WdfDevice);
 
+	//
+	// Fail a write still waiting for its delay or for HIDCLASS, unless
+	// EvtRequestCancel got to it first
+	//
+	WdfTimerStop(deviceContext->BatchTimer, TRUE);
+
+	WdfSpinLockAcquire(deviceContext->ReportLock);
+	isWaiting = (deviceContext->Batch.State == BatchDelay ||
+		deviceContext->Batch.State == BatchWaitRead);
+	if (isWaiting)
+	{
+		deviceContext->Batch.State = BatchRunning;
+	}
+	WdfSpinLockRelease(deviceContext->ReportLock);
+
+	if (isWaiting)
+	{
+		HIDINJECTOR_BatchComplete(deviceContext, STATUS_DEVICE_REMOVED);
+	}
+
 	VhfDelete(deviceContext->VhfHandle, TRUE);
 
 	return;
@@ -475,6 +895,7 @@ HIDINJECTOR_VhfInitialize(
 	vhfConfig.VhfClientContext = deviceContext;
 	vhfConfig.OperationContextSize = 11;
 	vhfConfig.EvtVhfAsyncOperationGetFeature = HIDINJECTOR_VhfAsyncOperationGetFeature;
+	vhfConfig.EvtVhfReadyForNextReadReport = HIDINJECTOR_EvtVhfReadyForNextReadReport;
 
 	status = VhfCreate(&vhfConfig, &deviceContext->VhfHandle);
 
@@ -488,7 +909,7 @@ _exit:
 	return status;
 }
 
-VOID
+NTSTATUS
 HIDINJECTOR_VhfSubmitReadReport(
 	_In_ PHID_DEVICE_CONTEXT DeviceContext,
 	_In_ PUCHAR Report,
@@ -508,6 +929,8 @@ HIDINJECTOR_VhfSubmitReadReport(
 	{
 		KdPrint(("VhfReadReportSubmit failed %d", status));
 	}
+
+	return status;
 }
 
 NTSTATUS
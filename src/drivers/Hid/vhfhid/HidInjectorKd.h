@@ -35,6 +35,9 @@ EVT_WDF_DRIVER_DEVICE_ADD           HIDINJECTOR_EvtDeviceAdd;
 EVT_WDF_DEVICE_SELF_MANAGED_IO_INIT HIDINJECTOR_EvtDeviceSelfManagedIoInit;
 EVT_WDF_IO_QUEUE_IO_WRITE			HIDINJECTOR_EvtIoWriteForRawPdo;
 EVT_WDF_IO_QUEUE_IO_WRITE			HIDINJECTOR_EvtIoWriteFromRawPdo;
+EVT_WDF_TIMER						HIDINJECTOR_EvtBatchTimer;
+EVT_WDF_REQUEST_CANCEL				HIDINJECTOR_EvtBatchRequestCancel;
+EVT_VHF_READY_FOR_NEXT_READ_REPORT	HIDINJECTOR_EvtVhfReadyForNextReadReport;
 
 typedef struct _HID_MAX_COUNT_REPORT
 {
@@ -42,6 +45,34 @@ typedef struct _HID_MAX_COUNT_REPORT
 	UCHAR MaxCount;
 } HIDINJECTOR_MAX_COUNT_REPORT, *PHIDINJECTOR_MAX_COUNT_REPORT;
 
+typedef enum _HIDINJECTOR_BATCH_STATE
+{
+	BatchIdle,
+	BatchRunning,
+	BatchDelay,		// BatchTimer runs out the DelayUs of the next report
+	BatchWaitRead,	// HIDCLASS is not ready, BatchTimer runs out the stall timeout
+	BatchCancelPending,	// done, EvtRequestCancel completes it with CompletionStatus
+} HIDINJECTOR_BATCH_STATE;
+
+//
+// The write being submitted. The raw PDO queue is sequential so there is at
+// most one, plain writes are handled as batches without delays.
+//
+typedef struct _HIDINJECTOR_BATCH
+{
+	WDFREQUEST				Request;
+	PUCHAR					Entries;
+	ULONG					HeaderLength;
+	ULONG					Stride;
+	ULONG					Count;
+	ULONG					Index;
+	ULONG					Flags;
+	BOOLEAN					IsDelayDone;
+	BOOLEAN					IsCancelled;	// EvtRequestCancel ran without completing it
+	NTSTATUS				CompletionStatus;
+	HIDINJECTOR_BATCH_STATE	State;
+} HIDINJECTOR_BATCH, *PHIDINJECTOR_BATCH;
+
 typedef struct _HID_DEVICE_CONTEXT
 {
 	WDFDEVICE               Device;
@@ -52,6 +83,15 @@ typedef struct _HID_DEVICE_CONTEXT
 	WDFDEVICE				RawPdo;
 	WDFQUEUE				RawPdoQueue;	// Queue for handling requests that come from the rawPdo
 	VHFHANDLE               VhfHandle;
+
+	//
+	// Set by EvtVhfReadyForNextReadReport, consumed by each submitted report
+	//
+	WDFSPINLOCK				ReportLock;
+	BOOLEAN					IsReadReady;
+	WDFTIMER				BatchTimer;
+	HIDINJECTOR_BATCH		Batch;
+	ULONG					BusyCount;
 } HID_DEVICE_CONTEXT, *PHID_DEVICE_CONTEXT;
 
 WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(HID_DEVICE_CONTEXT, GetHidDeviceContext);
@@ -118,7 +158,7 @@ HIDINJECTOR_VhfInitialize(
 	WDFDEVICE WdfDevice
 );
 
-VOID
+NTSTATUS
 HIDINJECTOR_VhfSubmitReadReport(
 	_In_ PHID_DEVICE_CONTEXT DeviceContext,
 	_In_ PUCHAR Report,
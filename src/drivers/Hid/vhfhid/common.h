@@ -78,5 +78,43 @@ typedef struct _HIDINJECTOR_INPUT_REPORT {
 #define TOUCH_IN_RANGE			0x02
 #define TOUCH_MAX_FINGER		0x0a // 10
 
+//
+// Batched write. Besides whole HIDINJECTOR_INPUT_REPORTs a write may carry a
+// HIDINJECTOR_BATCH_HEADER followed by Count HIDINJECTOR_BATCH_ENTRYs. The
+// reports are submitted in order, each one at least DelayUs after the previous
+// one (rounded up to the timer resolution, 0 submits it right away).
+//
+// A report is only submitted once HIDCLASS is ready for it. If it does not get
+// ready within HIDINJECTOR_BATCH_STALL_MS, or at once with
+// HIDINJECTOR_BATCH_FLAG_NO_WAIT, the write completes with STATUS_DEVICE_BUSY.
+// The information of a write is always the number of bytes consumed, header
+// included, so the caller can resend the rest.
+//
+// A batch with a DelayUs above HIDINJECTOR_BATCH_MAX_DELAY_US, or whose delays
+// add up to more than HIDINJECTOR_BATCH_MAX_TOTAL_MS, fails with
+// STATUS_INVALID_PARAMETER before any report is submitted. A write that is
+// cancelled completes with STATUS_CANCELLED before its next report.
+//
+#define HIDINJECTOR_BATCH_SIGNATURE		0xBA // never a ReportId
+#define HIDINJECTOR_BATCH_VERSION		1
+#define HIDINJECTOR_BATCH_MAX_REPORTS	256
+#define HIDINJECTOR_BATCH_STALL_MS		100
+#define HIDINJECTOR_BATCH_MAX_DELAY_US	50000
+#define HIDINJECTOR_BATCH_MAX_TOTAL_MS	1000
+
+#define HIDINJECTOR_BATCH_FLAG_NO_WAIT	0x00000001
+
+typedef struct _HIDINJECTOR_BATCH_HEADER {
+	UCHAR Signature;
+	UCHAR Version;
+	USHORT Count;
+	ULONG Flags;
+} HIDINJECTOR_BATCH_HEADER, *PHIDINJECTOR_BATCH_HEADER;
+
+typedef struct _HIDINJECTOR_BATCH_ENTRY {
+	ULONG DelayUs;
+	HIDINJECTOR_INPUT_REPORT Report;
+} HIDINJECTOR_BATCH_ENTRY, *PHIDINJECTOR_BATCH_ENTRY;
+
 #include <poppack.h>
 
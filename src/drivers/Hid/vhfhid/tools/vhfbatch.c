@@ -0,0 +1,1266 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	vhfbatch.c
+
+Abstract:
+
+	Runs the unmodified HidInjectorKd.c against a fake framework and a
+	fake VHF whose HIDCLASS side takes one report per pending read and
+	posts the next read ReadLatency later. Time is virtual, timers and
+	reads fire in due order and timer due times are rounded up to the
+	timer resolution. The cases are:
+
+		plain       whole reports without a header go out back to back
+		paced       every report of a batch waits at least its DelayUs
+		caps        a DelayUs above HIDINJECTOR_BATCH_MAX_DELAY_US or
+		            delays adding up to more than
+		            HIDINJECTOR_BATCH_MAX_TOTAL_MS are rejected before
+		            any report is submitted
+		no wait     with HIDINJECTOR_BATCH_FLAG_NO_WAIT a write fails
+		            with STATUS_DEVICE_BUSY as soon as no read is
+		            pending, its information is the bytes consumed
+		stall       without a read for HIDINJECTOR_BATCH_STALL_MS the
+		            write fails with STATUS_DEVICE_BUSY
+		slow reader the reports follow the reads of a slow consumer
+		cancel      a write is cancelled while it waits for a delay, a
+		            read or while it is submitting, before it was
+		            marked cancelable, and while its cancel routine is
+		            still pending
+		removal     surprise removal fails a waiting write, once
+
+	Every report must reach the consumer once and in order, only when
+	a read is pending, and every write must be completed exactly once,
+	never while it is still cancelable.
+
+	The benchmark then writes the same reports one per write and in
+	batches of HIDINJECTOR_BATCH_MAX_REPORTS to a consumer that always
+	has the next read pending, and prints the reports per second the
+	driver sustains on this host.
+
+	Build and use on any host with a C compiler:
+
+		cc -O2 -D_KERNEL_MODE -I../../../../tools/host -I.. -o vhfbatch vhfbatch.c ../HidInjectorKd.c
+		vhfbatch
+
+Environment:
+
+	user mode
+
+--*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "HidInjectorKd.h"
+
+#define REPORT_SIZE				sizeof(HIDINJECTOR_INPUT_REPORT)
+#define MAX_SUBMITTED			4096
+#define MAX_OBJECTS				64
+#define HNS_PER_US				10
+#define HNS_PER_MS				10000
+#define NEVER					(-1)
+#define BENCH_REPORTS			(HIDINJECTOR_BATCH_MAX_REPORTS * 2000)
+
+//
+// Every framework object starts with its header, the context follows
+// the object.
+//
+typedef struct _FAKE_OBJECT
+{
+	PVOID					Context;
+	WDFOBJECT				Parent;
+} FAKE_OBJECT, *PFAKE_OBJECT;
+
+typedef struct _FAKE_TIMER
+{
+	FAKE_OBJECT				Object;
+	EVT_WDF_TIMER			*EvtTimerFunc;
+	BOOLEAN					IsQueued;
+	LONGLONG				DueTime;
+} FAKE_TIMER, *PFAKE_TIMER;
+
+typedef struct _FAKE_MEMORY
+{
+	FAKE_OBJECT				Object;
+	PUCHAR					Buffer;
+	size_t					Length;
+} FAKE_MEMORY, *PFAKE_MEMORY;
+
+typedef struct _FAKE_REQUEST
+{
+	FAKE_OBJECT				Object;
+	FAKE_MEMORY				Memory;
+	UCHAR					Buffer[sizeof(HIDINJECTOR_BATCH_HEADER) +
+								HIDINJECTOR_BATCH_MAX_REPORTS * sizeof(HIDINJECTOR_BATCH_ENTRY)];
+	PFN_WDF_REQUEST_CANCEL	CancelRoutine;
+	BOOLEAN					IsCancelled;		// cancel was requested
+	BOOLEAN					IsCancelPending;	// and its routine has not run yet
+	ULONG					Completions;
+	NTSTATUS				Status;
+	ULONG_PTR				Information;
+	LONGLONG				CompletionTime;
+} FAKE_REQUEST, *PFAKE_REQUEST;
+
+typedef struct _FAKE
+{
+	LONGLONG				Now;				// 100ns
+	LONGLONG				TimerResolution;	// 100ns
+
+	PVOID					Objects[MAX_OBJECTS];
+	ULONG					ObjectCount;
+
+	WDFDEVICE				Device;
+	WDF_PNPPOWER_EVENT_CALLBACKS PnpPowerCallbacks;
+	WDFQUEUE				RawPdoQueue;
+	EVT_WDF_IO_QUEUE_IO_WRITE *EvtIoWrite;
+	PFAKE_TIMER				Timer;
+	LONG					LockDepth;
+
+	//
+	// VHF and the HIDCLASS reads behind it. After a report is taken the
+	// next read is pending ReadLatency later, NEVER for none.
+	//
+	VHF_CONFIG				Vhf;
+	BOOLEAN					IsStarted;
+	BOOLEAN					IsReadPending;
+	BOOLEAN					IsReadDue;
+	LONGLONG				ReadTime;
+	LONGLONG				ReadLatency;
+
+	//
+	// Reports the consumer took, by sequence number
+	//
+	ULONG					Submitted;
+	USHORT					Sequence[MAX_SUBMITTED];
+	LONGLONG				SubmitTime[MAX_SUBMITTED];
+	ULONG					Overruns;
+
+	//
+	// Cancel this request when report CancelAt is submitted
+	//
+	PFAKE_REQUEST			CancelRequest;
+	ULONG					CancelAt;
+	BOOLEAN					IsCancelDeferred;
+
+	ULONG					Violations;
+} FAKE;
+
+static FAKE g_Fake;
+static int g_Failures;
+
+static VOID
+Check(
+	_In_ BOOLEAN Condition,
+	_In_ const char *Case,
+	_In_ const char *What
+)
+{
+	if (!Condition)
+	{
+		printf("FAIL %s: %s\n", Case, What);
+		g_Failures++;
+	}
+}
+
+static VOID
+Violation(
+	_In_ const char *What
+)
+{
+	printf("VIOLATION %s\n", What);
+	g_Fake.Violations++;
+}
+
+//
+// ------------------------------------------------------------------ Framework
+//
+
+static PVOID
+FakeObjectCreate(
+	_In_ size_t Size,
+	_In_opt_ PWDF_OBJECT_ATTRIBUTES Attributes
+)
+{
+	size_t contextSize = (Attributes != NULL) ? Attributes->ContextSize : 0;
+	PFAKE_OBJECT object;
+
+	object = (PFAKE_OBJECT)calloc(1, Size + contextSize);
+	if (object == NULL || g_Fake.ObjectCount == MAX_OBJECTS)
+	{
+		abort();
+	}
+
+	object->Context = (contextSize != 0) ? (PUCHAR)object + Size : NULL;
+	object->Parent = (Attributes != NULL) ? Attributes->ParentObject : NULL;
+	g_Fake.Objects[g_Fake.ObjectCount++] = object;
+
+	return object;
+}
+
+PVOID
+WdfObjectGetTypedContextWorker(
+	_In_ WDFOBJECT Handle
+)
+{
+	return ((PFAKE_OBJECT)Handle)->Context;
+}
+
+NTSTATUS
+WdfDriverCreate(
+	_In_ PDRIVER_OBJECT DriverObject,
+	_In_ PUNICODE_STRING RegistryPath,
+	_In_opt_ PWDF_OBJECT_ATTRIBUTES DriverAttributes,
+	_In_ PWDF_DRIVER_CONFIG DriverConfig,
+	_Out_opt_ WDFDRIVER *Driver
+)
+{
+	UNREFERENCED_PARAMETER(DriverObject);
+	UNREFERENCED_PARAMETER(RegistryPath);
+	UNREFERENCED_PARAMETER(DriverAttributes);
+	UNREFERENCED_PARAMETER(DriverConfig);
+	UNREFERENCED_PARAMETER(Driver);
+
+	return STATUS_SUCCESS;
+}
+
+VOID
+WdfFdoInitSetFilter(
+	_In_ PWDFDEVICE_INIT DeviceInit
+)
+{
+	UNREFERENCED_PARAMETER(DeviceInit);
+}
+
+VOID
+WdfDeviceInitSetPnpPowerEventCallbacks(
+	_In_ PWDFDEVICE_INIT DeviceInit,
+	_In_ PWDF_PNPPOWER_EVENT_CALLBACKS PnpPowerEventCallbacks
+)
+{
+	UNREFERENCED_PARAMETER(DeviceInit);
+
+	g_Fake.PnpPowerCallbacks = *PnpPowerEventCallbacks;
+}
+
+NTSTATUS
+WdfDeviceCreate(
+	_Inout_ PWDFDEVICE_INIT *DeviceInit,
+	_In_opt_ PWDF_OBJECT_ATTRIBUTES DeviceAttributes,
+	_Out_ WDFDEVICE *Device
+)
+{
+	UNREFERENCED_PARAMETER(DeviceInit);
+
+	*Device = (WDFDEVICE)FakeObjectCreate(sizeof(FAKE_OBJECT), DeviceAttributes);
+	g_Fake.Device = *Device;
+
+	return STATUS_SUCCESS;
+}
+
+PDEVICE_OBJECT
+WdfDeviceWdmGetDeviceObject(
+	_In_ WDFDEVICE Device
+)
+{
+	return (PDEVICE_OBJECT)Device;
+}
+
+NTSTATUS
+WdfIoQueueCreate(
+	_In_ WDFDEVICE Device,
+	_In_ PWDF_IO_QUEUE_CONFIG Config,
+	_In_opt_ PWDF_OBJECT_ATTRIBUTES QueueAttributes,
+	_Out_opt_ WDFQUEUE *Queue
+)
+{
+	WDFQUEUE queue;
+
+	UNREFERENCED_PARAMETER(Device);
+
+	if (Config->DispatchType != WdfIoQueueDispatchSequential)
+	{
+		Violation("the raw PDO queue is not sequential");
+	}
+
+	queue = (WDFQUEUE)FakeObjectCreate(sizeof(FAKE_OBJECT), QueueAttributes);
+	g_Fake.RawPdoQueue = queue;
+	g_Fake.EvtIoWrite = Config->EvtIoWrite;
+
+	if (Queue != NULL)
+	{
+		*Queue = queue;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+NTSTATUS
+HIDINJECTOR_CreateRawPdo(
+	_In_ WDFDEVICE Device
+)
+{
+	UNREFERENCED_PARAMETER(Device);
+
+	return STATUS_SUCCESS;
+}
+
+WDFQUEUE
+WdfRequestGetIoQueue(
+	_In_ WDFREQUEST Request
+)
+{
+	UNREFERENCED_PARAMETER(Request);
+
+	return g_Fake.RawPdoQueue;
+}
+
+NTSTATUS
+WdfRequestRetrieveInputMemory(
+	_In_ WDFREQUEST Request,
+	_Out_ WDFMEMORY *Memory
+)
+{
+	*Memory = (WDFMEMORY)&((PFAKE_REQUEST)Request)->Memory;
+
+	return STATUS_SUCCESS;
+}
+
+PVOID
+WdfMemoryGetBuffer(
+	_In_ WDFMEMORY Memory,
+	_Out_opt_ size_t *BufferSize
+)
+{
+	PFAKE_MEMORY memory = (PFAKE_MEMORY)Memory;
+
+	if (BufferSize != NULL)
+	{
+		*BufferSize = memory->Length;
+	}
+
+	return memory->Buffer;
+}
+
+NTSTATUS
+WdfRequestMarkCancelableEx(
+	_In_ WDFREQUEST Request,
+	_In_ PFN_WDF_REQUEST_CANCEL EvtRequestCancel
+)
+{
+	PFAKE_REQUEST request = (PFAKE_REQUEST)Request;
+
+	if (request->IsCancelled)
+	{
+		return STATUS_CANCELLED;
+	}
+
+	request->CancelRoutine = EvtRequestCancel;
+
+	return STATUS_SUCCESS;
+}
+
+NTSTATUS
+WdfRequestUnmarkCancelable(
+	_In_ WDFREQUEST Request
+)
+{
+	PFAKE_REQUEST request = (PFAKE_REQUEST)Request;
+
+	if (request->IsCancelled)
+	{
+		//
+		// The cancel routine ran or is about to
+		//
+		return STATUS_CANCELLED;
+	}
+
+	if (request->CancelRoutine == NULL)
+	{
+		Violation("request unmarked but not cancelable");
+	}
+
+	request->CancelRoutine = NULL;
+
+	return STATUS_SUCCESS;
+}
+
+VOID
+WdfRequestCompleteWithInformation(
+	_In_ WDFREQUEST Request,
+	_In_ NTSTATUS Status,
+	_In_ ULONG_PTR Information
+)
+{
+	PFAKE_REQUEST request = (PFAKE_REQUEST)Request;
+
+	if (request->CancelRoutine != NULL && !request->IsCancelled)
+	{
+		Violation("request completed while still cancelable");
+	}
+
+	if (request->IsCancelPending)
+	{
+		Violation("request completed before its cancel routine ran");
+	}
+
+	if (g_Fake.LockDepth != 0)
+	{
+		Violation("request completed under the report lock");
+	}
+
+	request->Completions++;
+	request->Status = Status;
+	request->Information = Information;
+	request->CompletionTime = g_Fake.Now;
+}
+
+NTSTATUS
+WdfTimerCreate(
+	_In_ PWDF_TIMER_CONFIG Config,
+	_In_ PWDF_OBJECT_ATTRIBUTES Attributes,
+	_Out_ WDFTIMER *Timer
+)
+{
+	PFAKE_TIMER timer;
+
+	timer = (PFAKE_TIMER)FakeObjectCreate(sizeof(FAKE_TIMER), Attributes);
+	timer->EvtTimerFunc = Config->EvtTimerFunc;
+	g_Fake.Timer = timer;
+	*Timer = (WDFTIMER)timer;
+
+	return STATUS_SUCCESS;
+}
+
+BOOLEAN
+WdfTimerStart(
+	_In_ WDFTIMER Timer,
+	_In_ LONGLONG DueTime
+)
+{
+	PFAKE_TIMER timer = (PFAKE_TIMER)Timer;
+	LONGLONG resolution = g_Fake.TimerResolution;
+	BOOLEAN wasQueued = timer->IsQueued;
+
+	timer->DueTime = (g_Fake.Now - DueTime + resolution - 1) / resolution * resolution;
+	timer->IsQueued = TRUE;
+
+	return wasQueued;
+}
+
+BOOLEAN
+WdfTimerStop(
+	_In_ WDFTIMER Timer,
+	_In_ BOOLEAN Wait
+)
+{
+	PFAKE_TIMER timer = (PFAKE_TIMER)Timer;
+	BOOLEAN wasQueued = timer->IsQueued;
+
+	UNREFERENCED_PARAMETER(Wait);
+
+	timer->IsQueued = FALSE;
+
+	return wasQueued;
+}
+
+WDFOBJECT
+WdfTimerGetParentObject(
+	_In_ WDFTIMER Timer
+)
+{
+	return ((PFAKE_TIMER)Timer)->Object.Parent;
+}
+
+NTSTATUS
+WdfSpinLockCreate(
+	_In_opt_ PWDF_OBJECT_ATTRIBUTES SpinLockAttributes,
+	_Out_ WDFSPINLOCK *SpinLock
+)
+{
+	*SpinLock = (WDFSPINLOCK)FakeObjectCreate(sizeof(FAKE_OBJECT), SpinLockAttributes);
+
+	return STATUS_SUCCESS;
+}
+
+VOID
+WdfSpinLockAcquire(
+	_In_ WDFSPINLOCK SpinLock
+)
+{
+	UNREFERENCED_PARAMETER(SpinLock);
+
+	if (g_Fake.LockDepth != 0)
+	{
+		Violation("report lock acquired recursively");
+	}
+
+	g_Fake.LockDepth++;
+}
+
+VOID
+WdfSpinLockRelease(
+	_In_ WDFSPINLOCK SpinLock
+)
+{
+	UNREFERENCED_PARAMETER(SpinLock);
+
+	g_Fake.LockDepth--;
+}
+
+//
+// ------------------------------------------------------------------------ VHF
+//
+
+static VOID
+FakeReadAfter(
+	_In_ LONGLONG Latency
+)
+{
+	g_Fake.IsReadDue = (Latency != NEVER);
+	g_Fake.ReadTime = g_Fake.Now + Latency;
+}
+
+static VOID
+FakeCancel(
+	_In_ PFAKE_REQUEST Request,
+	_In_ BOOLEAN IsDeferred
+)
+{
+	PFN_WDF_REQUEST_CANCEL cancelRoutine = Request->CancelRoutine;
+
+	Request->IsCancelled = TRUE;
+
+	if (cancelRoutine == NULL || Request->Completions != 0)
+	{
+		return;
+	}
+
+	if (IsDeferred)
+	{
+		Request->IsCancelPending = TRUE;
+		return;
+	}
+
+	Request->CancelRoutine = NULL;
+	cancelRoutine((WDFREQUEST)Request);
+}
+
+static VOID
+FakeRunCancel(
+	_In_ PFAKE_REQUEST Request
+)
+{
+	PFN_WDF_REQUEST_CANCEL cancelRoutine = Request->CancelRoutine;
+
+	if (!Request->IsCancelPending)
+	{
+		return;
+	}
+
+	Request->IsCancelPending = FALSE;
+	Request->CancelRoutine = NULL;
+	cancelRoutine((WDFREQUEST)Request);
+}
+
+NTSTATUS
+VhfCreate(
+	_In_ PVHF_CONFIG VhfConfig,
+	_Out_ PVHFHANDLE VhfHandle
+)
+{
+	g_Fake.Vhf = *VhfConfig;
+	*VhfHandle = &g_Fake;
+
+	return STATUS_SUCCESS;
+}
+
+NTSTATUS
+VhfStart(
+	_In_ VHFHANDLE VhfHandle
+)
+{
+	UNREFERENCED_PARAMETER(VhfHandle);
+
+	g_Fake.IsStarted = TRUE;
+	FakeReadAfter(g_Fake.ReadLatency);
+
+	return STATUS_SUCCESS;
+}
+
+VOID
+VhfDelete(
+	_In_ VHFHANDLE VhfHandle,
+	_In_ BOOLEAN Wait
+)
+{
+	UNREFERENCED_PARAMETER(VhfHandle);
+	UNREFERENCED_PARAMETER(Wait);
+
+	g_Fake.IsStarted = FALSE;
+	g_Fake.IsReadDue = FALSE;
+}
+
+NTSTATUS
+VhfReadReportSubmit(
+	_In_ VHFHANDLE VhfHandle,
+	_In_ PHID_XFER_PACKET HidTransferPacket
+)
+{
+	PHIDINJECTOR_INPUT_REPORT report = (PHIDINJECTOR_INPUT_REPORT)HidTransferPacket->reportBuffer;
+
+	UNREFERENCED_PARAMETER(VhfHandle);
+
+	if (!g_Fake.IsStarted || HidTransferPacket->reportBufferLen != REPORT_SIZE)
+	{
+		Violation("report submitted to a stopped device or with a bad length");
+		return STATUS_UNSUCCESSFUL;
+	}
+
+	if (!g_Fake.IsReadPending)
+	{
+		g_Fake.Overruns++;
+	}
+
+	if (g_Fake.Submitted < MAX_SUBMITTED)
+	{
+		g_Fake.Sequence[g_Fake.Submitted] = (USHORT)(report->Report.KeyReport.Key1 |
+			(report->Report.KeyReport.Key2 << 8));
+		g_Fake.SubmitTime[g_Fake.Submitted] = g_Fake.Now;
+	}
+
+	g_Fake.Submitted++;
+	g_Fake.IsReadPending = FALSE;
+	FakeReadAfter(g_Fake.ReadLatency);
+
+	if (g_Fake.CancelRequest != NULL && g_Fake.Submitted == g_Fake.CancelAt)
+	{
+		FakeCancel(g_Fake.CancelRequest, g_Fake.IsCancelDeferred);
+	}
+
+	return STATUS_SUCCESS;
+}
+
+NTSTATUS
+VhfAsyncOperationComplete(
+	_In_ VHFOPERATIONHANDLE VhfOperationHandle,
+	_In_ NTSTATUS CompletionStatus
+)
+{
+	UNREFERENCED_PARAMETER(VhfOperationHandle);
+	UNREFERENCED_PARAMETER(CompletionStatus);
+
+	return STATUS_SUCCESS;
+}
+
+//
+// ---------------------------------------------------------------- Simulation
+//
+
+static VOID
+FakeReset(
+	_In_ LONGLONG ReadLatency
+)
+{
+	ULONG i;
+
+	for (i = 0; i < g_Fake.ObjectCount; i++)
+	{
+		free(g_Fake.Objects[i]);
+	}
+
+	memset(&g_Fake, 0, sizeof(g_Fake));
+	g_Fake.TimerResolution = HNS_PER_MS;
+	g_Fake.ReadLatency = ReadLatency;
+
+	if (!NT_SUCCESS(HIDINJECTOR_EvtDeviceAdd(NULL, NULL)) ||
+		!NT_SUCCESS(g_Fake.PnpPowerCallbacks.EvtDeviceSelfManagedIoInit(g_Fake.Device)))
+	{
+		abort();
+	}
+}
+
+static VOID
+FakeRun(
+	_In_ LONGLONG Until
+)
+/*++
+
+Routine Description:
+
+	Fires the timer and the reads of the consumer in due order until
+	nothing is due before Until.
+
+--*/
+{
+	PFAKE_TIMER timer = g_Fake.Timer;
+	BOOLEAN isTimer;
+
+	for (;;)
+	{
+		if (timer->IsQueued &&
+			(!g_Fake.IsReadDue || timer->DueTime < g_Fake.ReadTime))
+		{
+			if (timer->DueTime > Until)
+			{
+				break;
+			}
+
+			isTimer = TRUE;
+			g_Fake.Now = (timer->DueTime > g_Fake.Now) ? timer->DueTime : g_Fake.Now;
+		}
+		else if (g_Fake.IsReadDue && g_Fake.ReadTime <= Until)
+		{
+			isTimer = FALSE;
+			g_Fake.Now = (g_Fake.ReadTime > g_Fake.Now) ? g_Fake.ReadTime : g_Fake.Now;
+		}
+		else
+		{
+			break;
+		}
+
+		if (isTimer)
+		{
+			timer->IsQueued = FALSE;
+			timer->EvtTimerFunc((WDFTIMER)timer);
+		}
+		else
+		{
+			g_Fake.IsReadDue = FALSE;
+			g_Fake.IsReadPending = TRUE;
+			g_Fake.Vhf.EvtVhfReadyForNextReadReport(g_Fake.Vhf.VhfClientContext);
+		}
+
+		if (g_Fake.LockDepth != 0)
+		{
+			Violation("report lock held after a callback");
+			g_Fake.LockDepth = 0;
+		}
+	}
+
+	if (Until > g_Fake.Now)
+	{
+		g_Fake.Now = Until;
+	}
+}
+
+static PFAKE_REQUEST
+FakeRequest(
+	VOID
+)
+{
+	PFAKE_REQUEST request;
+
+	request = (PFAKE_REQUEST)FakeObjectCreate(sizeof(FAKE_REQUEST), NULL);
+	request->Memory.Buffer = request->Buffer;
+
+	return request;
+}
+
+static VOID
+FakeWrite(
+	_In_ PFAKE_REQUEST Request
+)
+{
+	g_Fake.EvtIoWrite(g_Fake.RawPdoQueue, (WDFREQUEST)Request, Request->Memory.Length);
+
+	if (g_Fake.LockDepth != 0)
+	{
+		Violation("report lock held after a write");
+		g_Fake.LockDepth = 0;
+	}
+}
+
+static VOID
+FillReport(
+	_Out_ PHIDINJECTOR_INPUT_REPORT Report,
+	_In_ ULONG Sequence
+)
+{
+	memset(Report, 0, REPORT_SIZE);
+	Report->ReportId = KEYBOARD_REPORT_ID;
+	Report->Report.KeyReport.Key1 = (UCHAR)Sequence;
+	Report->Report.KeyReport.Key2 = (UCHAR)(Sequence >> 8);
+}
+
+static PFAKE_REQUEST
+PlainWrite(
+	_In_ ULONG Count,
+	_In_ ULONG First
+)
+{
+	PFAKE_REQUEST request = FakeRequest();
+	PHIDINJECTOR_INPUT_REPORT reports = (PHIDINJECTOR_INPUT_REPORT)request->Buffer;
+	ULONG i;
+
+	for (i = 0; i < Count; i++)
+	{
+		FillReport(&reports[i], First + i);
+	}
+
+	request->Memory.Length = Count * REPORT_SIZE;
+
+	return request;
+}
+
+static PFAKE_REQUEST
+BatchWrite(
+	_In_ ULONG Count,
+	_In_ ULONG First,
+	_In_ ULONG DelayUs,
+	_In_ ULONG Flags
+)
+{
+	PFAKE_REQUEST request = FakeRequest();
+	PHIDINJECTOR_BATCH_HEADER header = (PHIDINJECTOR_BATCH_HEADER)request->Buffer;
+	PHIDINJECTOR_BATCH_ENTRY entries = (PHIDINJECTOR_BATCH_ENTRY)(header + 1);
+	ULONG i;
+
+	header->Signature = HIDINJECTOR_BATCH_SIGNATURE;
+	header->Version = HIDINJECTOR_BATCH_VERSION;
+	header->Count = (USHORT)Count;
+	header->Flags = Flags;
+
+	for (i = 0; i < Count; i++)
+	{
+		entries[i].DelayUs = DelayUs;
+		FillReport(&entries[i].Report, First + i);
+	}
+
+	request->Memory.Length = sizeof(HIDINJECTOR_BATCH_HEADER) + Count * sizeof(HIDINJECTOR_BATCH_ENTRY);
+
+	return request;
+}
+
+static ULONG_PTR
+BatchBytes(
+	_In_ ULONG Count
+)
+{
+	return sizeof(HIDINJECTOR_BATCH_HEADER) + Count * sizeof(HIDINJECTOR_BATCH_ENTRY);
+}
+
+static VOID
+CheckCompleted(
+	_In_ const char *Case,
+	_In_ PFAKE_REQUEST Request,
+	_In_ NTSTATUS Status,
+	_In_ ULONG_PTR Information
+)
+{
+	Check(Request->Completions == 1, Case, "completed once");
+	Check(Request->Status == Status, Case, "completion status");
+	Check(Request->Information == Information, Case, "bytes consumed");
+}
+
+static VOID
+CheckSubmitted(
+	_In_ const char *Case,
+	_In_ ULONG First,
+	_In_ ULONG Count
+)
+{
+	BOOLEAN isInOrder = TRUE;
+	ULONG i;
+
+	for (i = 0; i < Count && i < g_Fake.Submitted; i++)
+	{
+		isInOrder = isInOrder && (g_Fake.Sequence[i] == (USHORT)(First + i));
+	}
+
+	Check(g_Fake.Submitted == Count, Case, "report count");
+	Check(isInOrder, Case, "reports in order");
+	Check(g_Fake.Overruns == 0, Case, "reports only submitted to pending reads");
+	Check(g_Fake.Violations == 0, Case, "framework rules kept");
+}
+
+static VOID
+TestPlain(
+	VOID
+)
+{
+	PFAKE_REQUEST request;
+
+	FakeReset(0);
+	request = PlainWrite(4, 1);
+	FakeWrite(request);
+	FakeRun(HNS_PER_MS);
+
+	CheckCompleted("plain", request, STATUS_SUCCESS, 4 * REPORT_SIZE);
+	CheckSubmitted("plain", 1, 4);
+	Check(request->CompletionTime == 0, "plain", "no time spent waiting");
+
+	FakeReset(0);
+	request = PlainWrite(1, 1);
+	request->Memory.Length--;
+	FakeWrite(request);
+	CheckCompleted("plain", request, STATUS_INVALID_BUFFER_SIZE, 0);
+	CheckSubmitted("plain", 1, 0);
+}
+
+static VOID
+TestPaced(
+	VOID
+)
+{
+	PFAKE_REQUEST request;
+	BOOLEAN isPaced = TRUE;
+	LONGLONG gap;
+	ULONG i;
+
+	FakeReset(0);
+	request = BatchWrite(8, 10, 2500, 0);
+	FakeWrite(request);
+	FakeRun(HNS_PER_MS * 100);
+
+	CheckCompleted("paced", request, STATUS_SUCCESS, BatchBytes(8));
+	CheckSubmitted("paced", 10, 8);
+
+	for (i = 0; i < 8; i++)
+	{
+		gap = g_Fake.SubmitTime[i] - ((i == 0) ? 0 : g_Fake.SubmitTime[i - 1]);
+		isPaced = isPaced && gap >= 2500 * HNS_PER_US &&
+			gap < 2500 * HNS_PER_US + g_Fake.TimerResolution;
+	}
+
+	Check(isPaced, "paced", "each report waits its delay, rounded up to the timer");
+}
+
+static VOID
+TestCaps(
+	VOID
+)
+{
+	PHIDINJECTOR_BATCH_ENTRY entries;
+	PFAKE_REQUEST request;
+	ULONG count;
+
+	FakeReset(0);
+	request = BatchWrite(4, 1, 1000, 0);
+	entries = (PHIDINJECTOR_BATCH_ENTRY)(request->Buffer + sizeof(HIDINJECTOR_BATCH_HEADER));
+	entries[2].DelayUs = HIDINJECTOR_BATCH_MAX_DELAY_US + 1;
+	FakeWrite(request);
+	CheckCompleted("caps", request, STATUS_INVALID_PARAMETER, 0);
+	Check(!g_Fake.Timer->IsQueued, "caps", "no delay started for a rejected batch");
+
+	request = BatchWrite(4, 1, 0xffffffff, 0);
+	FakeWrite(request);
+	CheckCompleted("caps", request, STATUS_INVALID_PARAMETER, 0);
+
+	count = HIDINJECTOR_BATCH_MAX_TOTAL_MS * 1000 / HIDINJECTOR_BATCH_MAX_DELAY_US + 1;
+	request = BatchWrite(count, 1, HIDINJECTOR_BATCH_MAX_DELAY_US, 0);
+	FakeWrite(request);
+	CheckCompleted("caps", request, STATUS_INVALID_PARAMETER, 0);
+	CheckSubmitted("caps", 1, 0);
+
+	//
+	// Right at both limits is fine
+	//
+	count--;
+	request = BatchWrite(count, 1, HIDINJECTOR_BATCH_MAX_DELAY_US, 0);
+	FakeWrite(request);
+	FakeRun(HNS_PER_MS * (HIDINJECTOR_BATCH_MAX_TOTAL_MS + 100));
+	CheckCompleted("caps", request, STATUS_SUCCESS, BatchBytes(count));
+	CheckSubmitted("caps", 1, count);
+	Check(request->CompletionTime == HNS_PER_MS * HIDINJECTOR_BATCH_MAX_TOTAL_MS,
+		"caps", "the longest batch takes HIDINJECTOR_BATCH_MAX_TOTAL_MS");
+}
+
+static VOID
+TestNoWait(
+	VOID
+)
+{
+	PFAKE_REQUEST request;
+	PFAKE_REQUEST rest;
+
+	//
+	// The first read is pending, the next one only after the consumer
+	// ran, so the write stops after one report
+	//
+	FakeReset(0);
+	FakeRun(0);
+	request = BatchWrite(3, 1, 0, HIDINJECTOR_BATCH_FLAG_NO_WAIT);
+	FakeWrite(request);
+	CheckCompleted("no wait", request, STATUS_DEVICE_BUSY, BatchBytes(1));
+	Check(GetHidDeviceContext(g_Fake.Device)->BusyCount == 1, "no wait", "busy counted");
+	Check(!g_Fake.Timer->IsQueued, "no wait", "no stall timer");
+
+	//
+	// The caller resends the rest
+	//
+	FakeRun(0);
+	rest = BatchWrite(2, 2, 0, 0);
+	FakeWrite(rest);
+	FakeRun(HNS_PER_MS);
+	CheckCompleted("no wait", rest, STATUS_SUCCESS, BatchBytes(2));
+	CheckSubmitted("no wait", 1, 3);
+
+	FakeReset(NEVER);
+	request = BatchWrite(3, 1, 0, HIDINJECTOR_BATCH_FLAG_NO_WAIT);
+	FakeWrite(request);
+	CheckCompleted("no wait", request, STATUS_DEVICE_BUSY, BatchBytes(0));
+	CheckSubmitted("no wait", 1, 0);
+}
+
+static VOID
+TestStall(
+	VOID
+)
+{
+	PFAKE_REQUEST request;
+
+	FakeReset(NEVER);
+	request = PlainWrite(2, 1);
+	FakeWrite(request);
+	FakeRun(HNS_PER_MS * HIDINJECTOR_BATCH_STALL_MS * 2);
+
+	CheckCompleted("stall", request, STATUS_DEVICE_BUSY, 0);
+	Check(request->CompletionTime == HNS_PER_MS * HIDINJECTOR_BATCH_STALL_MS,
+		"stall", "failed after HIDINJECTOR_BATCH_STALL_MS");
+	CheckSubmitted("stall", 1, 0);
+}
+
+static VOID
+TestSlowReader(
+	VOID
+)
+{
+	PFAKE_REQUEST request;
+	ULONG i;
+	BOOLEAN isOnRead = TRUE;
+
+	FakeReset(HNS_PER_MS * 8);
+	request = PlainWrite(16, 100);
+	FakeWrite(request);
+	FakeRun(HNS_PER_MS * 1000);
+
+	CheckCompleted("slow reader", request, STATUS_SUCCESS, 16 * REPORT_SIZE);
+	CheckSubmitted("slow reader", 100, 16);
+
+	for (i = 0; i < 16; i++)
+	{
+		isOnRead = isOnRead && g_Fake.SubmitTime[i] == (LONGLONG)(i + 1) * HNS_PER_MS * 8;
+	}
+
+	Check(isOnRead, "slow reader", "each report goes out when its read is posted");
+}
+
+static VOID
+TestCancel(
+	VOID
+)
+{
+	PFAKE_REQUEST request;
+	PFAKE_REQUEST next;
+
+	//
+	// Waiting for a delay
+	//
+	FakeReset(0);
+	request = BatchWrite(4, 1, 40000, 0);
+	FakeWrite(request);
+	FakeRun(HNS_PER_MS * 50);
+	FakeCancel(request, FALSE);
+	CheckCompleted("cancel delay", request, STATUS_CANCELLED, BatchBytes(1));
+	Check(!g_Fake.Timer->IsQueued, "cancel delay", "delay stopped");
+	Check(request->CompletionTime == HNS_PER_MS * 50, "cancel delay", "completed at once");
+	FakeRun(HNS_PER_MS * 500);
+	Check(request->Completions == 1, "cancel delay", "not completed again");
+	CheckSubmitted("cancel delay", 1, 1);
+
+	next = PlainWrite(1, 2);
+	FakeWrite(next);
+	FakeRun(HNS_PER_MS * 600);
+	CheckCompleted("cancel delay", next, STATUS_SUCCESS, REPORT_SIZE);
+	CheckSubmitted("cancel delay", 1, 2);
+
+	//
+	// Waiting for a read
+	//
+	FakeReset(NEVER);
+	request = PlainWrite(2, 1);
+	FakeWrite(request);
+	FakeRun(HNS_PER_MS * 10);
+	FakeCancel(request, FALSE);
+	CheckCompleted("cancel read", request, STATUS_CANCELLED, 0);
+	Check(!g_Fake.Timer->IsQueued, "cancel read", "stall timer stopped");
+	Check(GetHidDeviceContext(g_Fake.Device)->BusyCount == 0, "cancel read", "not counted busy");
+
+	//
+	// While submitting, the write stops before its next report
+	//
+	FakeReset(0);
+	request = PlainWrite(6, 1);
+	g_Fake.CancelRequest = request;
+	g_Fake.CancelAt = 2;
+	FakeWrite(request);
+	FakeRun(HNS_PER_MS * 10);
+	CheckCompleted("cancel submit", request, STATUS_CANCELLED, 2 * REPORT_SIZE);
+	CheckSubmitted("cancel submit", 1, 2);
+
+	//
+	// Before the write was marked cancelable
+	//
+	FakeReset(0);
+	request = PlainWrite(2, 1);
+	request->IsCancelled = TRUE;
+	FakeWrite(request);
+	CheckCompleted("cancel early", request, STATUS_CANCELLED, 0);
+	CheckSubmitted("cancel early", 1, 0);
+
+	next = PlainWrite(1, 1);
+	FakeWrite(next);
+	FakeRun(HNS_PER_MS);
+	CheckCompleted("cancel early", next, STATUS_SUCCESS, REPORT_SIZE);
+
+	//
+	// The last report went out while the cancel routine is pending, it
+	// completes the write with the status of the batch
+	//
+	FakeReset(0);
+	request = PlainWrite(3, 1);
+	g_Fake.CancelRequest = request;
+	g_Fake.CancelAt = 3;
+	g_Fake.IsCancelDeferred = TRUE;
+	FakeWrite(request);
+	FakeRun(HNS_PER_MS * 10);
+	Check(request->Completions == 0, "cancel pending", "left to the cancel routine");
+	FakeRunCancel(request);
+	CheckCompleted("cancel pending", request, STATUS_SUCCESS, 3 * REPORT_SIZE);
+	CheckSubmitted("cancel pending", 1, 3);
+}
+
+static VOID
+TestRemoval(
+	VOID
+)
+{
+	PFAKE_REQUEST request;
+
+	FakeReset(NEVER);
+	request = PlainWrite(2, 1);
+	FakeWrite(request);
+	FakeRun(HNS_PER_MS * 10);
+	g_Fake.PnpPowerCallbacks.EvtDeviceSelfManagedIoCleanup(g_Fake.Device);
+	CheckCompleted("removal", request, STATUS_DEVICE_REMOVED, 0);
+	Check(!g_Fake.Timer->IsQueued, "removal", "stall timer stopped");
+	FakeRun(HNS_PER_MS * 500);
+	Check(request->Completions == 1, "removal", "not completed again");
+
+	//
+	// The queue purge cancels it, the cancel routine runs after the
+	// cleanup and completes it
+	//
+	FakeReset(0);
+	request = BatchWrite(2, 1, 20000, 0);
+	FakeWrite(request);
+	FakeRun(HNS_PER_MS * 10);
+	FakeCancel(request, TRUE);
+	g_Fake.PnpPowerCallbacks.EvtDeviceSelfManagedIoCleanup(g_Fake.Device);
+	Check(request->Completions == 0, "removal cancel", "left to the cancel routine");
+	FakeRunCancel(request);
+	CheckCompleted("removal cancel", request, STATUS_DEVICE_REMOVED, BatchBytes(0));
+	CheckSubmitted("removal cancel", 1, 0);
+}
+
+static double
+Seconds(
+	VOID
+)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static VOID
+Benchmark(
+	_In_ ULONG ReportsPerWrite
+)
+{
+	PFAKE_REQUEST request;
+	ULONG failed = 0;
+	ULONG reports;
+	double start;
+	double elapsed;
+
+	FakeReset(0);
+	request = (ReportsPerWrite == 1) ?
+		PlainWrite(1, 0) :
+		BatchWrite(ReportsPerWrite, 0, 0, 0);
+
+	start = Seconds();
+
+	for (reports = 0; reports < BENCH_REPORTS; reports += ReportsPerWrite)
+	{
+		request->Completions = 0;
+		request->CancelRoutine = NULL;
+		FakeWrite(request);
+		FakeRun(g_Fake.Now);
+		failed += (request->Completions != 1 || request->Status != STATUS_SUCCESS);
+	}
+
+	elapsed = Seconds() - start;
+
+	Check(failed == 0, "benchmark", "every write succeeded");
+	Check(g_Fake.Submitted == reports && g_Fake.Overruns == 0 && g_Fake.Violations == 0,
+		"benchmark", "every report reached the consumer");
+
+	printf("%3lu report(s) per write: %lu reports in %.3f s, %.0f reports/s\n",
+		(unsigned long)ReportsPerWrite,
+		(unsigned long)reports,
+		elapsed,
+		reports / elapsed);
+}
+
+int
+main(
+	VOID
+)
+{
+	TestPlain();
+	TestPaced();
+	TestCaps();
+	TestNoWait();
+	TestStall();
+	TestSlowReader();
+	TestCancel();
+	TestRemoval();
+
+	Benchmark(1);
+	Benchmark(HIDINJECTOR_BATCH_MAX_REPORTS);
+
+	FakeReset(0);
+
+	if (g_Failures != 0)
+	{
+		printf("%d check(s) failed\n", g_Failures);
+		return 1;
+	}
+
+	printf("all checks passed\n");
+	return 0;
+}
@@ -60,7 +60,7 @@ Environment:
 #define DEBUG_LEVEL_TERSE       4
 #define DEBUG_LEVEL_VERBOSE     5
 
-extern unsigned long g_DebugLevel;
+extern ULONG g_DebugLevel;
 
 #define DebugPrint(_LEVEL_, _FORMAT_, ...) \
 if (g_DebugLevel >= _LEVEL_) \
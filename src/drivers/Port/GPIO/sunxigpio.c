@@ -27,6 +27,7 @@
 #include <gpioclx.h>
 #include <acpiioct.h>
 #include "Trace.h"
+#include "sunxigpioioctl.h"
 
 ULONG g_DebugLevel = DEBUG_LEVEL_TERSE;
 
@@ -42,6 +43,15 @@ ULONG g_DebugLevel = DEBUG_LEVEL_TERSE;
 #define SUNXI_GPIO_PINS_PER_BANK		(32)
 #define SUNXI_GPIO_TOTAL_BANKS			(10)
 
+//
+// Interrupt storm throttling defaults, overridden by the
+// InterruptStormThreshold and InterruptStormBackoffMs device parameters.
+// A threshold of zero disables throttling.
+//
+
+#define SUNXI_GPIO_STORM_THRESHOLD		(0)
+#define SUNXI_GPIO_STORM_BACKOFF_MS		(100)
+
 
 //
 // Define that controls whether f-state based power management will be supported
@@ -108,6 +118,55 @@ typedef struct _SUNXI_GPIO_BANK {
     SUNXI_GPIO_REGISTERS		SavedContext;
 	SUNXI_GPIO_INT_REGISTERS	IntSavedContext;
 	ULONG						InterruptResourceIndex;
+
+	//
+	// Software copy of the PnDat output latch. Only touched from the
+	// read/write/restore callbacks, which the class extension serializes
+	// per bank, so a write is a single store to the register.
+	//
+
+	ULONG						OutputShadow;
+	BOOLEAN						OutputShadowValid;
+
+	//
+	// Set once SavedContext and IntSavedContext have been read back from
+	// the hardware. Until then a restore writes every register.
+	//
+
+	BOOLEAN						ContextValid;
+
+	//
+	// Interrupt statistics, updated with the bank's interrupt lock held.
+	// WindowCount counts interrupts since WindowStart and yields the rate
+	// once a second. ActiveTimestamp is taken when the active interrupts
+	// are queried and ends when they are cleared.
+	//
+
+	SUNXI_GPIO_PIN_STATISTICS	PinStatistics[SUNXI_GPIO_PINS_PER_BANK];
+	ULONG						WindowCount[SUNXI_GPIO_PINS_PER_BANK];
+	LARGE_INTEGER				WindowStart;
+	LARGE_INTEGER				ActiveTimestamp;
+
+	//
+	// Storm throttling policy in effect for the bank. Copied from the
+	// controller's with the bank's interrupt lock held, so the ISR always
+	// sees a threshold and a back-off that were set together. StormCount
+	// counts interrupts against the threshold, it restarts with every
+	// window and whenever the pin is throttled.
+	//
+
+	ULONG						StormThreshold;
+	ULONG						StormBackoffMs;
+	ULONG						StormCount[SUNXI_GPIO_PINS_PER_BANK];
+
+	//
+	// Pins masked for exceeding the storm threshold, and those of them
+	// the class extension expects enabled once the back-off expires.
+	//
+
+	ULONG						ThrottledMask;
+	ULONG						ThrottleResumeMask;
+	LONGLONG					ThrottleExpiry[SUNXI_GPIO_PINS_PER_BANK];
 } SUNXI_GPIO_BANK, *PSUNXI_GPIO_BANK;
 
 //
@@ -122,8 +181,38 @@ typedef struct _SUNXI_GPIO_CONTEXT {
 	ULONG				TotalBanks;
 	UCHAR				InterruptIndex;
     SUNXI_GPIO_BANK		Banks[SUNXI_GPIO_TOTAL_BANKS];
+
+	//
+	// Storm throttling policy, each bank uses its own copy. The throttle
+	// DPC is queued from DIRQL to arm the timer, whose DPC unmasks the pins
+	// once the back-off expires. Stopping is set under the throttle lock
+	// while the controller is stopped, the timer is not armed again then.
+	//
+
+	ULONG				StormThreshold;
+	ULONG				StormBackoffMs;
+	LARGE_INTEGER		PerfFrequency;
+	KDPC				ThrottleDpc;
+	KDPC				ReleaseDpc;
+	KTIMER				ThrottleTimer;
+	KSPIN_LOCK			ThrottleLock;
+	BOOLEAN				Stopping;
 } SUNXI_GPIO_CONTEXT, *PSUNXI_GPIO_CONTEXT;
 
+//
+// Pin configuration accumulated over a whole pin table, so that each
+// configuration, drive and pull register is read and written at most once.
+//
+
+typedef struct _SUNXI_GPIO_PIN_CONFIG {
+	ULONG					CfgMask[4];
+	ULONG					CfgValue[4];
+	ULONG					DrvMask[2];
+	ULONG					DrvValue[2];
+	ULONG					PulMask[2];
+	ULONG					PulValue[2];
+} SUNXI_GPIO_PIN_CONFIG, *PSUNXI_GPIO_PIN_CONFIG;
+
 typedef struct _ACPI_DATA {
 		ACPI_EVAL_OUTPUT_BUFFER buffer;
 		ULONG data[7];
@@ -189,6 +278,39 @@ GPIO_CLIENT_WRITE_PINS_MASK SunxiGpioWriteGpioPins;
 GPIO_CLIENT_SAVE_BANK_HARDWARE_CONTEXT SunxiGpioSaveBankHardwareContext;
 GPIO_CLIENT_RESTORE_BANK_HARDWARE_CONTEXT SunxiGpioRestoreBankHardwareContext;
 
+//
+// Handler for controller specific functions (interrupt statistics).
+//
+
+GPIO_CLIENT_CONTROLLER_SPECIFIC_FUNCTION SunxiGpioControllerSpecificFunction;
+
+//
+// Interrupt storm throttling.
+//
+
+KDEFERRED_ROUTINE SunxiGpioThrottleDpc;
+KDEFERRED_ROUTINE SunxiGpioReleaseDpc;
+
+VOID
+SunxiGpioInitializeInterruptStatistics (
+    _In_ WDFDEVICE Device,
+    _Inout_ PSUNXI_GPIO_CONTEXT GpioContext
+    );
+
+VOID
+SunxiGpioCountInterrupts (
+    _In_ PSUNXI_GPIO_CONTEXT GpioContext,
+    _Inout_ PSUNXI_GPIO_BANK GpioBank,
+    _In_ ULONG ActiveMask
+    );
+
+VOID
+SunxiGpioRecordInterruptLatency (
+    _In_ PSUNXI_GPIO_CONTEXT GpioContext,
+    _Inout_ PSUNXI_GPIO_BANK GpioBank,
+    _In_ ULONG ClearMask
+    );
+
 //
 // -------------------------------------------------------------------- Pragmas
 //
@@ -201,6 +323,71 @@ GPIO_CLIENT_RESTORE_BANK_HARDWARE_CONTEXT SunxiGpioRestoreBankHardwareContext;
 // ------------------------------------------------------------------ Functions
 //
 
+FORCEINLINE
+ULONG
+SunxiGpioGetOutputShadow (
+    _In_ PSUNXI_GPIO_BANK GpioBank
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the bank's output latch shadow, loading it from
+    PnDat the first time it is needed.
+
+Arguments:
+
+    GpioBank - Supplies a pointer to the bank.
+
+Return Value:
+
+    The shadowed PnDat value.
+
+--*/
+
+{
+    if (GpioBank->OutputShadowValid == FALSE) {
+        GpioBank->OutputShadow = READ_REGISTER_ULONG(&GpioBank->Registers->PnDat);
+        GpioBank->OutputShadowValid = TRUE;
+    }
+
+    return GpioBank->OutputShadow;
+}
+
+FORCEINLINE
+VOID
+SunxiGpioWriteRegister (
+    _Out_ PULONG Shadow,
+    _In_ PULONG Register,
+    _In_ ULONG Value
+    )
+
+/*++
+
+Routine Description:
+
+    This routine writes a bank register and its copy in the saved context.
+
+Arguments:
+
+    Shadow - Supplies the register's copy in the bank's saved context.
+
+    Register - Supplies the register address.
+
+    Value - Supplies the value to write.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+    *Shadow = Value;
+    WRITE_REGISTER_ULONG(Register, Value);
+}
+
 NTSTATUS
 DriverEntry (
     _In_ PDRIVER_OBJECT  DriverObject,
@@ -318,6 +505,12 @@ Return Value:
     RegistrationPacket.CLIENT_ReadGpioPinsUsingMask = SunxiGpioReadGpioPins;
     RegistrationPacket.CLIENT_WriteGpioPinsUsingMask = SunxiGpioWriteGpioPins;
 
+    //
+    // Handler for controller specific functions.
+    //
+
+    RegistrationPacket.CLIENT_ControllerSpecificFunction = SunxiGpioControllerSpecificFunction;
+
     //
     // Handlers for GPIO save and restore context (if F-state power mgmt is
     // supported).
@@ -676,6 +869,8 @@ Return Value:
     RtlZeroMemory(GpioContext, sizeof(SUNXI_GPIO_CONTEXT));
 
 	GetAcpiData(Device, GpioContext);
+
+	SunxiGpioInitializeInterruptStatistics(Device, GpioContext);
 	
 	for (Index = 0; Index < GpioContext->TotalBanks; Index++)
 		GpioContext->TotalPins += GpioContext->Banks[Index].NumberOfPins;
@@ -808,9 +1003,17 @@ Return Value:
 {
 
     UNREFERENCED_PARAMETER(Device);
-    UNREFERENCED_PARAMETER(Context);
 
 	FunctionEnter();
+
+    //
+    // Make sure no throttling DPC runs once the registers are unmapped. The
+    // controller was stopped first, so the timer can no longer be armed.
+    //
+
+    KeCancelTimer(&((PSUNXI_GPIO_CONTEXT)Context)->ThrottleTimer);
+    KeFlushQueuedDpcs();
+
     //
     // Release the mappings established in the initialize callback.
     //
@@ -1110,6 +1313,7 @@ Return Value:
     BANK_ID BankId;
     PSUNXI_GPIO_BANK GpioBank;
     PSUNXI_GPIO_CONTEXT GpioContext;
+    KIRQL OldIrql;
     //ULONG PinValue;
     GPIO_SAVE_RESTORE_BANK_HARDWARE_CONTEXT_PARAMETERS RestoreParameters;
    // PSUNXI_GPIO_REGISTERS sunxigpioRegisters;
@@ -1173,6 +1377,16 @@ Return Value:
         }
     }
 
+    //
+    // Pins still throttled when the controller stopped lost their timer,
+    // let the release DPC unmask the expired ones and arm it again.
+    //
+
+    KeAcquireSpinLock(&GpioContext->ThrottleLock, &OldIrql);
+    GpioContext->Stopping = FALSE;
+    KeReleaseSpinLock(&GpioContext->ThrottleLock, OldIrql);
+    KeInsertQueueDpc(&GpioContext->ThrottleDpc, NULL, NULL);
+
     return STATUS_SUCCESS;
 }
 
@@ -1216,6 +1430,7 @@ Return Value:
 
     BANK_ID BankId;
     PSUNXI_GPIO_CONTEXT GpioContext;
+    KIRQL OldIrql;
     GPIO_SAVE_RESTORE_BANK_HARDWARE_CONTEXT_PARAMETERS SaveParameters;
 
     UNREFERENCED_PARAMETER(TargetState);
@@ -1235,6 +1450,19 @@ Return Value:
     //
 
     GpioContext = (PSUNXI_GPIO_CONTEXT)Context;
+
+    //
+    // No back-off may expire once the controller is off. A release DPC
+    // running now sees Stopping and does not arm the timer again, so it
+    // stays cancelled once the queued DPCs are flushed.
+    //
+
+    KeAcquireSpinLock(&GpioContext->ThrottleLock, &OldIrql);
+    GpioContext->Stopping = TRUE;
+    KeReleaseSpinLock(&GpioContext->ThrottleLock, OldIrql);
+    KeCancelTimer(&GpioContext->ThrottleTimer);
+    KeFlushQueuedDpcs();
+
     if (SaveContext == TRUE) {
         for (BankId = 0; BankId < GpioContext->TotalBanks; BankId += 1) {
             SaveParameters.BankId = BankId;
@@ -1389,7 +1617,9 @@ Environment:
 	PinValue = READ_REGISTER_ULONG(&GpioRegisters->PnCfg[Index]);
 	PinValue &= ~(0x0f << ShiftBits);
 	PinValue |= (0x06 << ShiftBits);
-	WRITE_REGISTER_ULONG(&GpioRegisters->PnCfg[Index], PinValue);
+	SunxiGpioWriteRegister(&GpioBank->SavedContext.PnCfg[Index],
+						   &GpioRegisters->PnCfg[Index],
+						   PinValue);
 
 
 	//
@@ -1400,7 +1630,9 @@ Environment:
 	PinValue = READ_REGISTER_ULONG(&GpioRegisters->PnPul[Index]);
 	PinValue &= ~(0x03 << ShiftBits);
 	PinValue |= EnableParameters->PullConfiguration << ShiftBits;
-	WRITE_REGISTER_ULONG(&GpioRegisters->PnPul[Index], PinValue);
+	SunxiGpioWriteRegister(&GpioBank->SavedContext.PnPul[Index],
+						   &GpioRegisters->PnPul[Index],
+						   PinValue);
 
 	//
 	// Set the mode register.0:positive edge, 1:Negative edge, 2:High level, 3: low level,
@@ -1438,7 +1670,9 @@ Environment:
 
 	PinValue &= ~(0xf << ShiftBits);
 	PinValue |= Value << ShiftBits;
-    WRITE_REGISTER_ULONG(&IntGpioRegisters->PnIntCfg[Index], PinValue);
+    SunxiGpioWriteRegister(&GpioBank->IntSavedContext.PnIntCfg[Index],
+						   &IntGpioRegisters->PnIntCfg[Index],
+						   PinValue);
 
 	//
 	//According to DebounceTimeoutset debounce register.
@@ -1457,7 +1691,9 @@ Environment:
 		PinValue |= (0x7) << 4;
 	}
 
-	WRITE_REGISTER_ULONG(&IntGpioRegisters->PnIntDeb, PinValue);
+	SunxiGpioWriteRegister(&GpioBank->IntSavedContext.PnIntDeb,
+						   &IntGpioRegisters->PnIntDeb,
+						   PinValue);
 
 	//
 	// NOTE: If the GPIO controller supports a separate set of mask registers,
@@ -1479,9 +1715,14 @@ Environment:
 	// Enable the interrupt by setting the bit in the interrupt enable register.
 	//
 
+	GpioBank->ThrottledMask &= ~(1 << PinNumber);
+	GpioBank->ThrottleResumeMask &= ~(1 << PinNumber);
+
 	PinValue = READ_REGISTER_ULONG(&IntGpioRegisters->PnIntCtl);
 	PinValue |= (1 << PinNumber);
-	WRITE_REGISTER_ULONG(&IntGpioRegisters->PnIntCtl, PinValue);
+	SunxiGpioWriteRegister(&GpioBank->IntSavedContext.PnIntCtl,
+						   &IntGpioRegisters->PnIntCtl,
+						   PinValue);
 
     //
     // Release the interrupt lock.
@@ -1572,12 +1813,25 @@ Environment:
     // register.
     //
 
-	PinValue = READ_REGISTER_ULONG(&IntGpioRegisters->PnIntCtl);
-	if ((1 << DisableParameters->PinNumber) & PinValue)
-		PinValue &= ~(1 << DisableParameters->PinNumber);
-	else
-		PinValue |= (1 << DisableParameters->PinNumber);
-	WRITE_REGISTER_ULONG(&IntGpioRegisters->PnIntCtl, PinValue);
+	if (GpioBank->ThrottledMask & (1 << DisableParameters->PinNumber)) {
+
+		//
+		// Already masked by the storm throttling, just forget about it.
+		//
+
+		GpioBank->ThrottledMask &= ~(1 << DisableParameters->PinNumber);
+		GpioBank->ThrottleResumeMask &= ~(1 << DisableParameters->PinNumber);
+
+	} else {
+		PinValue = READ_REGISTER_ULONG(&IntGpioRegisters->PnIntCtl);
+		if ((1 << DisableParameters->PinNumber) & PinValue)
+			PinValue &= ~(1 << DisableParameters->PinNumber);
+		else
+			PinValue |= (1 << DisableParameters->PinNumber);
+		SunxiGpioWriteRegister(&GpioBank->IntSavedContext.PnIntCtl,
+							   &IntGpioRegisters->PnIntCtl,
+							   PinValue);
+	}
 
     GPIO_CLX_ReleaseInterruptLock(Context, BankId);
 
@@ -1661,9 +1915,13 @@ Environment:
     // and automatically synchronized with other DIRQL interrupts callbacks.
     //
 
+    GpioBank->ThrottleResumeMask &= ~(ULONG)(MaskParameters->PinMask);
+
     PinValue = READ_REGISTER_ULONG(&IntGpioRegisters->PnIntCtl);
     PinValue &= ~(ULONG)(MaskParameters->PinMask);
-    WRITE_REGISTER_ULONG(&IntGpioRegisters->PnIntCtl, PinValue);
+    SunxiGpioWriteRegister(&GpioBank->IntSavedContext.PnIntCtl,
+						   &IntGpioRegisters->PnIntCtl,
+						   PinValue);
 
     //
     // Set the bitmask of pins that could not be successfully masked.
@@ -1763,9 +2021,20 @@ Environment:
     // DIRQL and automatically synchronized with other DIRQL-level callbacks.
     //
 
+    //
+    // A throttled pin stays masked until its back-off expires.
+    //
+
+    if (GpioBank->ThrottledMask & (1 << UnmaskParameters->PinNumber)) {
+        GpioBank->ThrottleResumeMask |= (1 << UnmaskParameters->PinNumber);
+        return STATUS_SUCCESS;
+    }
+
     PinValue = READ_REGISTER_ULONG(&IntGpioRegisters->PnIntCtl);
     PinValue |= (1 << UnmaskParameters->PinNumber);
-    WRITE_REGISTER_ULONG(&IntGpioRegisters->PnIntCtl, PinValue);
+    SunxiGpioWriteRegister(&GpioBank->IntSavedContext.PnIntCtl,
+						   &IntGpioRegisters->PnIntCtl,
+						   PinValue);
 
     return STATUS_SUCCESS;
 }
@@ -1865,6 +2134,14 @@ Environment:
 
     PinValue = READ_REGISTER_ULONG(&IntGpioRegisters->PnIntSta);
     QueryActiveParameters->ActiveMask = (ULONG64)PinValue;
+
+    //
+    // Disabled pins latch their status too but are not delivered.
+    //
+
+    SunxiGpioCountInterrupts(GpioContext,
+                             GpioBank,
+                             PinValue & (ULONG)QueryActiveParameters->EnabledMask);
     return STATUS_SUCCESS;
 }
 
@@ -2025,6 +2302,10 @@ Environment:
     PinValue |= ((ULONG)ClearParameters->ClearActiveMask);
     WRITE_REGISTER_ULONG(&IntGpioRegisters->PnIntSta, PinValue);
 
+    SunxiGpioRecordInterruptLatency(GpioContext,
+                                    GpioBank,
+                                    (ULONG)ClearParameters->ClearActiveMask);
+
     //
     // Set the bitmask of pins that could not be successfully cleared.
     // Since this is a memory-mapped controller, the clear operation always
@@ -2152,7 +2433,9 @@ Environment:
 	PinValue = READ_REGISTER_ULONG(&GpioRegisters->PnCfg[Index]);
 	PinValue &= ~(0xf << ShiftBits);
 	PinValue |= (0x06 << ShiftBits);
-	WRITE_REGISTER_ULONG(&GpioRegisters->PnCfg[Index], PinValue);
+	SunxiGpioWriteRegister(&GpioBank->SavedContext.PnCfg[Index],
+						   &GpioRegisters->PnCfg[Index],
+						   PinValue);
 
     //
     // Set the mode register. If the interrupt is Level then set the bit;
@@ -2189,15 +2472,24 @@ Environment:
 
 	PinValue &= ~(0xf << ShiftBits);
 	PinValue |= (Value << ShiftBits);
-	WRITE_REGISTER_ULONG(&IntGpioRegisters->PnIntCfg[Index], PinValue);
+	SunxiGpioWriteRegister(&GpioBank->IntSavedContext.PnIntCfg[Index],
+						   &IntGpioRegisters->PnIntCfg[Index],
+						   PinValue);
 
 	//
 	// Enable the interrupt by setting the bit in the interrupt enable register.
 	//
 
+	if (GpioBank->ThrottledMask & (1 << PinNumber)) {
+		GpioBank->ThrottleResumeMask |= (1 << PinNumber);
+		return STATUS_SUCCESS;
+	}
+
 	PinValue = READ_REGISTER_ULONG(&IntGpioRegisters->PnIntCtl);
 	PinValue |= (1 << PinNumber);
-	WRITE_REGISTER_ULONG(&IntGpioRegisters->PnIntCtl, PinValue);
+	SunxiGpioWriteRegister(&GpioBank->IntSavedContext.PnIntCtl,
+						   &IntGpioRegisters->PnIntCtl,
+						   PinValue);
 
     return STATUS_SUCCESS;
 }
@@ -2206,6 +2498,164 @@ Environment:
 // --------------------------------------------------------------- I/O Handlers
 //
 
+VOID
+SunxiGpioAddPinConfig (
+	_Inout_ PSUNXI_GPIO_PIN_CONFIG PinConfig,
+	_In_ PIN_NUMBER PinNumber,
+	_In_ ULONG Function,
+	_In_ ULONG Drive,
+	_In_ ULONG Pull
+	)
+
+/*++
+
+Routine Description:
+
+	This routine merges the function select, drive strength and pull
+	settings of one pin into a pin configuration. A later pin overrides
+	an earlier one, as consecutive read-modify-writes would.
+
+Arguments:
+
+	PinConfig - Supplies the configuration being accumulated.
+
+	PinNumber - Supplies the bank relative pin number.
+
+	Function - Supplies the 4 bit function select value.
+
+	Drive - Supplies the 2 bit drive level.
+
+	Pull - Supplies the 2 bit pull configuration.
+
+Return Value:
+
+	None.
+
+--*/
+
+{
+	ULONG RegisterNumber;
+	ULONG Shift;
+
+	RegisterNumber = PinNumber / 8;
+	Shift = (PinNumber % 8) * 4;
+	PinConfig->CfgMask[RegisterNumber] |= (0xf << Shift);
+	PinConfig->CfgValue[RegisterNumber] &= ~(0xf << Shift);
+	PinConfig->CfgValue[RegisterNumber] |= (Function << Shift);
+
+	RegisterNumber = PinNumber / 16;
+	Shift = (PinNumber % 16) * 2;
+	PinConfig->DrvMask[RegisterNumber] |= (0x3 << Shift);
+	PinConfig->DrvValue[RegisterNumber] &= ~(0x3 << Shift);
+	PinConfig->DrvValue[RegisterNumber] |= (Drive << Shift);
+
+	PinConfig->PulMask[RegisterNumber] |= (0x3 << Shift);
+	PinConfig->PulValue[RegisterNumber] &= ~(0x3 << Shift);
+	PinConfig->PulValue[RegisterNumber] |= (Pull << Shift);
+}
+
+VOID
+SunxiGpioApplyRegisterConfig (
+	_Inout_ PULONG Shadow,
+	_In_ PULONG Register,
+	_In_ ULONG Mask,
+	_In_ ULONG Value
+	)
+
+/*++
+
+Routine Description:
+
+	This routine replaces the masked bits of one register.
+
+Arguments:
+
+	Shadow - Supplies the register's copy in the bank's saved context.
+
+	Register - Supplies the register address.
+
+	Mask - Supplies the bits to replace.
+
+	Value - Supplies the new value of the masked bits.
+
+Return Value:
+
+	None.
+
+--*/
+
+{
+	ULONG PinValue;
+
+	if (Mask == 0) {
+		return;
+	}
+
+	if (Mask == 0xffffffff) {
+		PinValue = Value;
+	} else {
+		PinValue = READ_REGISTER_ULONG(Register);
+		PinValue &= ~Mask;
+		PinValue |= Value;
+	}
+
+	SunxiGpioWriteRegister(Shadow, Register, PinValue);
+}
+
+VOID
+SunxiGpioApplyPinConfig (
+	_In_ PSUNXI_GPIO_BANK GpioBank,
+	_In_ PSUNXI_GPIO_PIN_CONFIG PinConfig
+	)
+
+/*++
+
+Routine Description:
+
+	This routine programs an accumulated pin configuration. Registers with
+	no pin in the configuration are not touched, fully covered registers
+	are written without being read first.
+
+Arguments:
+
+	GpioBank - Supplies the bank to program.
+
+	PinConfig - Supplies the configuration to program.
+
+Return Value:
+
+	None.
+
+--*/
+
+{
+	ULONG Index;
+	PSUNXI_GPIO_REGISTERS GpioRegisters;
+
+	GpioRegisters = GpioBank->Registers;
+
+	for (Index = 0; Index < 4; Index += 1) {
+		SunxiGpioApplyRegisterConfig(&GpioBank->SavedContext.PnCfg[Index],
+									 &GpioRegisters->PnCfg[Index],
+									 PinConfig->CfgMask[Index],
+									 PinConfig->CfgValue[Index]);
+	}
+
+	for (Index = 0; Index < 2; Index += 1) {
+		SunxiGpioApplyRegisterConfig(&GpioBank->SavedContext.PnDrv[Index],
+									 &GpioRegisters->PnDrv[Index],
+									 PinConfig->DrvMask[Index],
+									 PinConfig->DrvValue[Index]);
+	}
+
+	for (Index = 0; Index < 2; Index += 1) {
+		SunxiGpioApplyRegisterConfig(&GpioBank->SavedContext.PnPul[Index],
+									 &GpioRegisters->PnPul[Index],
+									 PinConfig->PulMask[Index],
+									 PinConfig->PulValue[Index]);
+	}
+}
+
 VOID PrintConnectParameters(
 	_In_ PGPIO_CONNECT_IO_PINS_PARAMETERS ConnectParameters
 	)
@@ -2339,15 +2789,14 @@ Environment:
 {
 	ULONG Value;
 	ULONG Index;
-	ULONG PinValue;
-	ULONG RegisterNumber;
-	ULONG RegisterBitNumber;
+	ULONG Function;
+	ULONG Pull;
 	NTSTATUS Status;
 	PIN_NUMBER PinNumber;
+	SUNXI_GPIO_PIN_CONFIG PinConfig;
 	PPIN_NUMBER PinNumberTable;
 	PSUNXI_GPIO_BANK GpioBank;
 	PSUNXI_GPIO_CONTEXT GpioContext;
-    PSUNXI_GPIO_REGISTERS GpioRegisters;
     
 
 	FunctionEnter();
@@ -2356,9 +2805,15 @@ Environment:
 
     GpioContext = (PSUNXI_GPIO_CONTEXT)Context;
     GpioBank = &GpioContext->Banks[ConnectParameters->BankId];
-    GpioRegisters = GpioBank->Registers;
     Status = STATUS_SUCCESS;
 
+	//
+	// Accumulate the settings of every pin, then program each touched
+	// register once.
+	//
+
+	RtlZeroMemory(&PinConfig, sizeof(PinConfig));
+
 	PinNumberTable = ConnectParameters->PinNumberTable;
 	for (Index = 0; Index < ConnectParameters->PinCount; Index += 1) {
 
@@ -2370,42 +2825,31 @@ Environment:
 
 		if ((PinNumber >= GpioBank->NumberOfPins) || (PinNumber < 0)) {
 			KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "the pin is not support!\n"));
-			return Status;
+			break;
 		}
 
 		//
-		// The first stepset config control register.
-		//Calculate the control register number and bit number
+		// Function select: input 0, output 1, otherwise taken from the
+		// vendor data.
 		//
-		RegisterNumber = PinNumber / 8;
-		RegisterBitNumber = PinNumber % 8;
-		PinValue = READ_REGISTER_ULONG(&GpioRegisters->PnCfg[RegisterNumber]);
 
 		switch (ConnectParameters->ConnectMode)
 		{
 		case ConnectModeInput:
-			PinValue &= ~(0xf << (RegisterBitNumber * 4)); /* input:0 */
+			Function = 0;
 			break;
 		case ConnectModeOutput:
-			PinValue &= ~(0xf << (RegisterBitNumber * 4));/* output:1 */
-			PinValue |= (1 << (RegisterBitNumber * 4));
+			Function = 1;
 			break;
 		default:
-			PinValue &= ~(0xf << (RegisterBitNumber * 4));
-			PinValue |= ((ULONG) ConnectParameters->VendorData << (RegisterBitNumber * 4));
+			Function = (ULONG) ConnectParameters->VendorData;
 			break;
 		}
 
-		WRITE_REGISTER_ULONG(&GpioRegisters->PnCfg[RegisterNumber], PinValue);
-
 		//
-		//The second stepset driving register
-		//Calculate the control register number and bit number
+		// Drive level, only applied to outputs.
 		//
 
-		RegisterNumber = PinNumber / 16;
-		RegisterBitNumber = PinNumber % 16;
-		PinValue = READ_REGISTER_ULONG(&GpioRegisters->PnDrv[RegisterNumber]);
 		if (ConnectParameters->ConnectMode == ConnectModeOutput) {
 			switch (ConnectParameters->DriveStrength)
 			{
@@ -2429,29 +2873,20 @@ Environment:
 		else
 			Value = 0x1;
 
-		PinValue &= ~(0x03 << (RegisterBitNumber * 2));
-		PinValue |= Value << (RegisterBitNumber * 2);
-		WRITE_REGISTER_ULONG(&GpioRegisters->PnDrv[RegisterNumber], PinValue);
-
 		//
-		//The third step set pull register 
-		//Calculate the control register number and bit number
+		// Pull configuration, only applied to outputs.
 		//
 
-		RegisterNumber = PinNumber / 16;
-		RegisterBitNumber = PinNumber % 16;
-		PinValue = READ_REGISTER_ULONG(&GpioRegisters->PnPul[RegisterNumber]);
 		if (ConnectParameters->ConnectMode == ConnectModeOutput)
-			Value = ConnectParameters->PullConfiguration ;
+			Pull = ConnectParameters->PullConfiguration ;
 		else
-			Value = 0x0;
-		
-		PinValue &= ~(0x03 << (RegisterBitNumber * 2));
-		PinValue |= Value << (RegisterBitNumber * 2);
-		WRITE_REGISTER_ULONG(&GpioRegisters->PnPul[RegisterNumber], PinValue);
-
+			Pull = 0x0;
 
+		SunxiGpioAddPinConfig(&PinConfig, PinNumber, Function, Value, Pull);
 	}
+
+	SunxiGpioApplyPinConfig(GpioBank, &PinConfig);
+
     return Status;
 }
 
@@ -2510,15 +2945,12 @@ Environment:
 
 {
 
-	ULONG				RegisterNumber;
-	ULONG				RegisterBitNumber;
 	ULONG				Index;
-	ULONG				PinValue;
 	PIN_NUMBER			PinNumber;
+	SUNXI_GPIO_PIN_CONFIG	PinConfig;
 	PPIN_NUMBER			PinNumberTable;
 	PSUNXI_GPIO_BANK		GpioBank;
 	PSUNXI_GPIO_CONTEXT	GpioContext;
-	PSUNXI_GPIO_REGISTERS	AwGpioRegisters;
 
 	FunctionEnter();
 
@@ -2533,13 +2965,14 @@ Environment:
 
 	GpioContext = (PSUNXI_GPIO_CONTEXT) Context;
 	GpioBank = &GpioContext->Banks[DisconnectParameters->BankId];
-	AwGpioRegisters = GpioBank->Registers;
 
 	//
 	// Walk through all the supplied pins and disconnect them. On AwGPIO
 	// controller, all pins are reset to the default mode (Disable).
 	//
 
+	RtlZeroMemory(&PinConfig, sizeof(PinConfig));
+
 	PinNumberTable = DisconnectParameters->PinNumberTable;
 	for (Index = 0; Index < DisconnectParameters->PinCount; Index += 1) {
 
@@ -2547,46 +2980,19 @@ Environment:
 
 		if ((PinNumber >= GpioBank->NumberOfPins) || (PinNumber < 0)) {
 			KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "the pin is not support!\n"));
-			return STATUS_SUCCESS;
+			break;
 		}
 
 		//
-		// The first step: set control register(default mode:Disable(0x07))
-		//Calculate the control register number and bit number
-		//
-
-		RegisterNumber = PinNumber / 8;
-		RegisterBitNumber = (PinNumber % 8) * 4;
-		PinValue = READ_REGISTER_ULONG(&AwGpioRegisters->PnCfg[RegisterNumber]);
-		PinValue &= ~(0xf << RegisterBitNumber);
-		PinValue |= (0x07 << RegisterBitNumber);
-		WRITE_REGISTER_ULONG(&AwGpioRegisters->PnCfg[RegisterNumber], PinValue);
-
-		//
-		//The second stepset driving register(default mode:level1(0x01))
-		//Calculate the control register number and bit number
+		// Default mode: function Disable (0x07), drive level1 (0x01),
+		// pull register 0x01.
 		//
 
-		RegisterNumber = PinNumber / 16;
-		RegisterBitNumber = (PinNumber % 16) * 2;
-		PinValue = READ_REGISTER_ULONG(&AwGpioRegisters->PnDrv[RegisterNumber]);
-		PinValue &= ~(0x3 << RegisterBitNumber);
-		PinValue |= (0x1 << RegisterBitNumber);
-		WRITE_REGISTER_ULONG(&AwGpioRegisters->PnDrv[RegisterNumber], PinValue);
-
-		//
-		//The third step set pull register (defaule mode pull up/down disable(0)) 
-		//Calculate the control register number and bit number
-		//
+		SunxiGpioAddPinConfig(&PinConfig, PinNumber, 0x07, 0x1, 0x1);
+	}
 
-		RegisterNumber = PinNumber / 16;
-		RegisterBitNumber = (PinNumber % 16) * 2;
-		PinValue = READ_REGISTER_ULONG(&AwGpioRegisters->PnPul[RegisterNumber]);
-		PinValue &= ~(0x3 << RegisterBitNumber);
-		PinValue |= (0x1 << (RegisterBitNumber ));
-		WRITE_REGISTER_ULONG(&AwGpioRegisters->PnPul[RegisterNumber], PinValue);
+	SunxiGpioApplyPinConfig(GpioBank, &PinConfig);
 
-	}
     return STATUS_SUCCESS;
 }
 
@@ -2663,15 +3069,15 @@ Environment:
     // register values should be read.
     //
     // N.B. In case of sunxigpio, the LevelRegister holds the value for input
-    //      as well as output pins. Thus the same register is read in either
-    //      case.
+    //      as well as output pins. Output pins are served from the shadow
+    //      of the last value written, which saves the register read.
     //
 
     if (ReadParameters->Flags.WriteConfiguredPins == FALSE) {
         PinValue = READ_REGISTER_ULONG(&sunxigpioRegisters->PnDat);
 
     } else {
-        PinValue = READ_REGISTER_ULONG(&sunxigpioRegisters->PnDat);
+        PinValue = SunxiGpioGetOutputShadow(GpioBank);
     }
 
     *ReadParameters->PinValues = PinValue;
@@ -2743,10 +3149,11 @@ Environment:
     sunxigpioRegisters = GpioBank->Registers;
 
     //
-    // Read the current level register value.
+    // Start from the shadow of the output latch rather than reading the
+    // level register back.
     //
 
-    PinValue = READ_REGISTER_ULONG(&sunxigpioRegisters->PnDat);
+    PinValue = SunxiGpioGetOutputShadow(GpioBank);
 
     //
     // Set the bits specified in the set mask and clear the ones specified
@@ -2760,40 +3167,595 @@ Environment:
     // Write the updated value to the register.
     //
 
+    GpioBank->OutputShadow = PinValue;
     WRITE_REGISTER_ULONG(&sunxigpioRegisters->PnDat, PinValue);
 
     return STATUS_SUCCESS;
 }
 
 //
-// ------------------------------------------------------- Power mgmt handlers
+// ------------------------------------------------------ Interrupt statistics
 //
 
 VOID
-SunxiGpioSaveBankHardwareContext (
-    _In_ PVOID Context,
-    _In_ PGPIO_SAVE_RESTORE_BANK_HARDWARE_CONTEXT_PARAMETERS SaveParameters
+SunxiGpioInitializeInterruptStatistics (
+    _In_ WDFDEVICE Device,
+    _Inout_ PSUNXI_GPIO_CONTEXT GpioContext
     )
 
 /*++
 
 Routine Description:
 
-    This routine saves the hardware context for the GPIO controller.
+    This routine initializes the interrupt statistics and reads the storm
+    throttling policy from the device parameters.
 
 Arguments:
 
-    Context - Supplies a pointer to the GPIO client driver's device extension.
+    Device - Supplies a handle to the framework device object.
 
-    SaveRestoreParameters - Supplies a pointer to a structure containing
-        parameters for the save operation:
+    GpioContext - Supplies a pointer to the GPIO client driver's device
+        extension.
 
-        BankId - Supplies the ID for the GPIO bank.
+Return Value:
 
-        State - Target F-state the bank will be transitioned into.
+    None.
 
-        Flags - Supplies flags for the save operation:
-            CriticalTransition - TRUE if this is due to a critical transition.
+--*/
+
+{
+    ULONG Index;
+    WDFKEY Key;
+    ULONG Value;
+    NTSTATUS Status;
+    DECLARE_CONST_UNICODE_STRING(ThresholdName, L"InterruptStormThreshold");
+    DECLARE_CONST_UNICODE_STRING(BackoffName, L"InterruptStormBackoffMs");
+
+    KeQueryPerformanceCounter(&GpioContext->PerfFrequency);
+    KeInitializeDpc(&GpioContext->ThrottleDpc, SunxiGpioThrottleDpc, GpioContext);
+    KeInitializeDpc(&GpioContext->ReleaseDpc, SunxiGpioReleaseDpc, GpioContext);
+    KeInitializeTimer(&GpioContext->ThrottleTimer);
+    KeInitializeSpinLock(&GpioContext->ThrottleLock);
+
+    GpioContext->StormThreshold = SUNXI_GPIO_STORM_THRESHOLD;
+    GpioContext->StormBackoffMs = SUNXI_GPIO_STORM_BACKOFF_MS;
+
+    Status = WdfDeviceOpenRegistryKey(Device,
+                                      PLUGPLAY_REGKEY_DEVICE,
+                                      KEY_READ,
+                                      WDF_NO_OBJECT_ATTRIBUTES,
+                                      &Key);
+
+    if (NT_SUCCESS(Status)) {
+        if (NT_SUCCESS(WdfRegistryQueryULong(Key, &ThresholdName, &Value))) {
+            GpioContext->StormThreshold = Value;
+        }
+
+        if (NT_SUCCESS(WdfRegistryQueryULong(Key, &BackoffName, &Value)) &&
+            (Value != 0)) {
+
+            GpioContext->StormBackoffMs = Value;
+        }
+
+        WdfRegistryClose(Key);
+    }
+
+    //
+    // No interrupt is connected yet, the banks' copies need no lock.
+    //
+
+    for (Index = 0; Index < SUNXI_GPIO_TOTAL_BANKS; Index += 1) {
+        GpioContext->Banks[Index].StormThreshold = GpioContext->StormThreshold;
+        GpioContext->Banks[Index].StormBackoffMs = GpioContext->StormBackoffMs;
+    }
+
+    DbgPrint_I("interrupt storm threshold %d/s, back-off %dms.",
+               GpioContext->StormThreshold,
+               GpioContext->StormBackoffMs);
+}
+
+VOID
+SunxiGpioCountInterrupts (
+    _In_ PSUNXI_GPIO_CONTEXT GpioContext,
+    _Inout_ PSUNXI_GPIO_BANK GpioBank,
+    _In_ ULONG ActiveMask
+    )
+
+/*++
+
+Routine Description:
+
+    This routine counts the active interrupts of a bank, updates the rate
+    estimate and masks pins that exceed the storm threshold.
+
+    N.B. This routine is called at DIRQL with the bank's interrupt lock
+         held.
+
+Arguments:
+
+    GpioContext - Supplies a pointer to the GPIO client driver's device
+        extension.
+
+    GpioBank - Supplies the bank.
+
+    ActiveMask - Supplies the active interrupts that are enabled.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+    LONGLONG Elapsed;
+    LARGE_INTEGER Now;
+    ULONG PinNumber;
+    ULONG PinValue;
+    ULONG Rate;
+    PSUNXI_GPIO_PIN_STATISTICS PinStatistics;
+
+    Now = KeQueryPerformanceCounter(NULL);
+    GpioBank->ActiveTimestamp = Now;
+
+    //
+    // Turn the counts of the elapsed window into rates.
+    //
+
+    Elapsed = Now.QuadPart - GpioBank->WindowStart.QuadPart;
+    if (Elapsed >= GpioContext->PerfFrequency.QuadPart) {
+        for (PinNumber = 0; PinNumber < SUNXI_GPIO_PINS_PER_BANK; PinNumber += 1) {
+            PinStatistics = &GpioBank->PinStatistics[PinNumber];
+            Rate = (ULONG)((GpioBank->WindowCount[PinNumber] *
+                            GpioContext->PerfFrequency.QuadPart) / Elapsed);
+
+            PinStatistics->Rate = Rate;
+            if (Rate > PinStatistics->PeakRate) {
+                PinStatistics->PeakRate = Rate;
+            }
+
+            GpioBank->WindowCount[PinNumber] = 0;
+            GpioBank->StormCount[PinNumber] = 0;
+        }
+
+        GpioBank->WindowStart = Now;
+    }
+
+    ActiveMask &= ~GpioBank->ThrottledMask;
+    for (PinNumber = 0; ActiveMask != 0; PinNumber += 1, ActiveMask >>= 1) {
+        if ((ActiveMask & 1) == 0) {
+            continue;
+        }
+
+        GpioBank->PinStatistics[PinNumber].InterruptCount += 1;
+        GpioBank->WindowCount[PinNumber] += 1;
+        GpioBank->StormCount[PinNumber] += 1;
+
+        if ((GpioBank->StormThreshold == 0) ||
+            (GpioBank->StormCount[PinNumber] <= GpioBank->StormThreshold)) {
+
+            continue;
+        }
+
+        //
+        // Storm: mask the pin and let the release DPC unmask it once the
+        // back-off expires. The pin is only unmasked again if the class
+        // extension still has it enabled by then.
+        //
+
+        PinValue = READ_REGISTER_ULONG(&GpioBank->IntRegisters->PnIntCtl);
+        if (PinValue & (1 << PinNumber)) {
+            GpioBank->ThrottleResumeMask |= (1 << PinNumber);
+            PinValue &= ~(1 << PinNumber);
+            SunxiGpioWriteRegister(&GpioBank->IntSavedContext.PnIntCtl,
+                                   &GpioBank->IntRegisters->PnIntCtl,
+                                   PinValue);
+        }
+
+        GpioBank->ThrottledMask |= (1 << PinNumber);
+        GpioBank->ThrottleExpiry[PinNumber] = Now.QuadPart +
+            (GpioContext->PerfFrequency.QuadPart * GpioBank->StormBackoffMs) / 1000;
+
+        GpioBank->PinStatistics[PinNumber].ThrottleCount += 1;
+        GpioBank->StormCount[PinNumber] = 0;
+
+        KeInsertQueueDpc(&GpioContext->ThrottleDpc, NULL, NULL);
+    }
+}
+
+VOID
+SunxiGpioRecordInterruptLatency (
+    _In_ PSUNXI_GPIO_CONTEXT GpioContext,
+    _Inout_ PSUNXI_GPIO_BANK GpioBank,
+    _In_ ULONG ClearMask
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds the time since the active interrupts were queried to
+    the latency histogram of every pin being cleared.
+
+    N.B. This routine is called at DIRQL with the bank's interrupt lock
+         held.
+
+Arguments:
+
+    GpioContext - Supplies a pointer to the GPIO client driver's device
+        extension.
+
+    GpioBank - Supplies the bank.
+
+    ClearMask - Supplies the interrupts being cleared.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+    ULONG Bucket;
+    ULONG LatencyUs;
+    LARGE_INTEGER Now;
+    ULONG PinNumber;
+    ULONG Value;
+    PSUNXI_GPIO_PIN_STATISTICS PinStatistics;
+
+    if (GpioBank->ActiveTimestamp.QuadPart == 0) {
+        return;
+    }
+
+    Now = KeQueryPerformanceCounter(NULL);
+    LatencyUs = (ULONG)(((Now.QuadPart - GpioBank->ActiveTimestamp.QuadPart) * 1000000) /
+                        GpioContext->PerfFrequency.QuadPart);
+
+    Bucket = 0;
+    Value = LatencyUs >> SUNXI_GPIO_LATENCY_BASE_SHIFT;
+    while ((Value != 0) && (Bucket < SUNXI_GPIO_LATENCY_BUCKETS - 1)) {
+        Value >>= 1;
+        Bucket += 1;
+    }
+
+    for (PinNumber = 0; ClearMask != 0; PinNumber += 1, ClearMask >>= 1) {
+        if ((ClearMask & 1) == 0) {
+            continue;
+        }
+
+        PinStatistics = &GpioBank->PinStatistics[PinNumber];
+        PinStatistics->LatencyBuckets[Bucket] += 1;
+        if (LatencyUs > PinStatistics->MaxLatencyUs) {
+            PinStatistics->MaxLatencyUs = LatencyUs;
+        }
+    }
+}
+
+VOID
+SunxiGpioThrottleDpc (
+    _In_ PKDPC Dpc,
+    _In_opt_ PVOID DeferredContext,
+    _In_opt_ PVOID SystemArgument1,
+    _In_opt_ PVOID SystemArgument2
+    )
+
+/*++
+
+Routine Description:
+
+    This routine arms the back-off timer after a pin has been throttled.
+    The timer cannot be set from DIRQL. It is set for the earliest back-off
+    to expire, not for the newly throttled pin's, which would delay the
+    release of the pins throttled before it.
+
+Arguments:
+
+    DeferredContext - Supplies a pointer to the GPIO client driver's device
+        extension.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+    SunxiGpioReleaseDpc(Dpc, DeferredContext, SystemArgument1, SystemArgument2);
+}
+
+VOID
+SunxiGpioReleaseDpc (
+    _In_ PKDPC Dpc,
+    _In_opt_ PVOID DeferredContext,
+    _In_opt_ PVOID SystemArgument1,
+    _In_opt_ PVOID SystemArgument2
+    )
+
+/*++
+
+Routine Description:
+
+    This routine unmasks the throttled pins whose back-off has expired and
+    re-arms the timer for the others.
+
+Arguments:
+
+    DeferredContext - Supplies a pointer to the GPIO client driver's device
+        extension.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+    BANK_ID BankId;
+    LARGE_INTEGER DueTime;
+    LONGLONG NextExpiry;
+    LARGE_INTEGER Now;
+    ULONG PinNumber;
+    ULONG PinValue;
+    ULONG ReleaseMask;
+    PSUNXI_GPIO_BANK GpioBank;
+    PSUNXI_GPIO_CONTEXT GpioContext;
+
+    UNREFERENCED_PARAMETER(Dpc);
+    UNREFERENCED_PARAMETER(SystemArgument1);
+    UNREFERENCED_PARAMETER(SystemArgument2);
+
+    GpioContext = (PSUNXI_GPIO_CONTEXT)DeferredContext;
+    NextExpiry = 0;
+
+    for (BankId = 0; BankId < GpioContext->TotalBanks; BankId += 1) {
+        GpioBank = &GpioContext->Banks[BankId];
+        if (GpioBank->IsIntBank != TRUE) {
+            continue;
+        }
+
+        GPIO_CLX_AcquireInterruptLock(GpioContext, BankId);
+
+        Now = KeQueryPerformanceCounter(NULL);
+        ReleaseMask = 0;
+        for (PinNumber = 0; PinNumber < SUNXI_GPIO_PINS_PER_BANK; PinNumber += 1) {
+            if ((GpioBank->ThrottledMask & (1 << PinNumber)) == 0) {
+                continue;
+            }
+
+            if (GpioBank->ThrottleExpiry[PinNumber] <= Now.QuadPart) {
+                ReleaseMask |= (1 << PinNumber);
+
+            } else if ((NextExpiry == 0) ||
+                       (GpioBank->ThrottleExpiry[PinNumber] < NextExpiry)) {
+
+                NextExpiry = GpioBank->ThrottleExpiry[PinNumber];
+            }
+        }
+
+        GpioBank->ThrottledMask &= ~ReleaseMask;
+        ReleaseMask &= GpioBank->ThrottleResumeMask;
+        GpioBank->ThrottleResumeMask &= ~ReleaseMask;
+
+        if (ReleaseMask != 0) {
+            PinValue = READ_REGISTER_ULONG(&GpioBank->IntRegisters->PnIntCtl);
+            PinValue |= ReleaseMask;
+            SunxiGpioWriteRegister(&GpioBank->IntSavedContext.PnIntCtl,
+                                   &GpioBank->IntRegisters->PnIntCtl,
+                                   PinValue);
+        }
+
+        GPIO_CLX_ReleaseInterruptLock(GpioContext, BankId);
+    }
+
+    KeAcquireSpinLockAtDpcLevel(&GpioContext->ThrottleLock);
+    if ((NextExpiry != 0) && (GpioContext->Stopping == FALSE)) {
+        Now = KeQueryPerformanceCounter(NULL);
+        DueTime.QuadPart = -(((NextExpiry - Now.QuadPart) * 10000000) /
+                             GpioContext->PerfFrequency.QuadPart) - 1;
+
+        KeSetTimer(&GpioContext->ThrottleTimer, DueTime, &GpioContext->ReleaseDpc);
+    }
+
+    KeReleaseSpinLockFromDpcLevel(&GpioContext->ThrottleLock);
+}
+
+_Must_inspect_result_
+_IRQL_requires_(PASSIVE_LEVEL)
+NTSTATUS
+SunxiGpioControllerSpecificFunction (
+    _In_ PVOID Context,
+    _In_ PGPIO_CLIENT_CONTROLLER_SPECIFIC_FUNCTION_PARAMETERS Parameters
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements the controller specific functions described in
+    sunxigpioioctl.h: querying and resetting the interrupt statistics of a
+    bank and setting the storm throttling policy.
+
+Arguments:
+
+    Context - Supplies a pointer to the GPIO client driver's device extension.
+
+    Parameters - Supplies the input and output buffers of the request.
+
+Return Value:
+
+    NTSTATUS code.
+
+--*/
+
+{
+    BANK_ID BankId;
+    PSUNXI_GPIO_BANK GpioBank;
+    PSUNXI_GPIO_CONTEXT GpioContext;
+    PSUNXI_GPIO_FUNCTION_INPUT Input;
+    PSUNXI_GPIO_BANK_STATISTICS Output;
+    NTSTATUS Status;
+    ULONG StormBackoffMs;
+    ULONG StormThreshold;
+
+	FunctionEnter();
+
+    GpioContext = (PSUNXI_GPIO_CONTEXT)Context;
+    Parameters->BytesWritten = 0;
+
+    if (Parameters->InputBufferLength < sizeof(SUNXI_GPIO_FUNCTION_INPUT)) {
+        Status = STATUS_INVALID_PARAMETER;
+        goto ControllerSpecificFunctionEnd;
+    }
+
+    Input = (PSUNXI_GPIO_FUNCTION_INPUT)Parameters->InputBuffer;
+
+    if (Input->Function == SUNXI_GPIO_FUNCTION_SET_STORM_POLICY) {
+        StormThreshold = Input->StormThreshold;
+        StormBackoffMs = Input->StormBackoffMs;
+        if (StormBackoffMs == 0) {
+            StormBackoffMs = GpioContext->StormBackoffMs;
+        }
+
+        GpioContext->StormThreshold = StormThreshold;
+        GpioContext->StormBackoffMs = StormBackoffMs;
+
+        //
+        // The ISR reads the bank's copy with the bank's interrupt lock held.
+        //
+
+        for (BankId = 0; BankId < GpioContext->TotalBanks; BankId += 1) {
+            GpioBank = &GpioContext->Banks[BankId];
+            if (GpioBank->IsIntBank != TRUE) {
+                continue;
+            }
+
+            GPIO_CLX_AcquireInterruptLock(Context, BankId);
+            GpioBank->StormThreshold = StormThreshold;
+            GpioBank->StormBackoffMs = StormBackoffMs;
+            GPIO_CLX_ReleaseInterruptLock(Context, BankId);
+        }
+
+        Status = STATUS_SUCCESS;
+        goto ControllerSpecificFunctionEnd;
+    }
+
+    if ((Input->BankId >= GpioContext->TotalBanks) ||
+        (GpioContext->Banks[Input->BankId].IsIntBank != TRUE)) {
+
+        Status = STATUS_INVALID_PARAMETER;
+        goto ControllerSpecificFunctionEnd;
+    }
+
+    GpioBank = &GpioContext->Banks[Input->BankId];
+
+    switch (Input->Function) {
+    case SUNXI_GPIO_FUNCTION_QUERY_INTERRUPT_STATISTICS:
+        if (Parameters->OutputBufferLength < sizeof(SUNXI_GPIO_BANK_STATISTICS)) {
+            Status = STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        Output = (PSUNXI_GPIO_BANK_STATISTICS)Parameters->OutputBuffer;
+
+        GPIO_CLX_AcquireInterruptLock(Context, (BANK_ID)Input->BankId);
+
+        Output->BankId = Input->BankId;
+        Output->StormThreshold = GpioBank->StormThreshold;
+        Output->StormBackoffMs = GpioBank->StormBackoffMs;
+        Output->ThrottledMask = GpioBank->ThrottledMask;
+        RtlCopyMemory(Output->Pins,
+                      GpioBank->PinStatistics,
+                      sizeof(Output->Pins));
+
+        GPIO_CLX_ReleaseInterruptLock(Context, (BANK_ID)Input->BankId);
+
+        Parameters->BytesWritten = sizeof(SUNXI_GPIO_BANK_STATISTICS);
+        Status = STATUS_SUCCESS;
+        break;
+
+    case SUNXI_GPIO_FUNCTION_RESET_INTERRUPT_STATISTICS:
+        GPIO_CLX_AcquireInterruptLock(Context, (BANK_ID)Input->BankId);
+
+        RtlZeroMemory(GpioBank->PinStatistics, sizeof(GpioBank->PinStatistics));
+        RtlZeroMemory(GpioBank->WindowCount, sizeof(GpioBank->WindowCount));
+
+        GPIO_CLX_ReleaseInterruptLock(Context, (BANK_ID)Input->BankId);
+
+        Status = STATUS_SUCCESS;
+        break;
+
+    default:
+        Status = STATUS_NOT_SUPPORTED;
+        break;
+    }
+
+ControllerSpecificFunctionEnd:
+	FunctionExit(Status);
+    return Status;
+}
+
+//
+// ------------------------------------------------------- Power mgmt handlers
+//
+
+VOID
+SunxiGpioRestoreRegister (
+    _In_ PULONG Register,
+    _In_ ULONG Value,
+    _In_ BOOLEAN Force
+    )
+
+/*++
+
+Routine Description:
+
+    This routine restores a register unless the hardware already holds the
+    saved value, as a bank that kept its context does.
+
+Arguments:
+
+    Register - Supplies the register address.
+
+    Value - Supplies the saved value.
+
+    Force - Supplies TRUE to write the register regardless.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+    if ((Force != FALSE) || (READ_REGISTER_ULONG(Register) != Value)) {
+        WRITE_REGISTER_ULONG(Register, Value);
+    }
+}
+
+VOID
+SunxiGpioSaveBankHardwareContext (
+    _In_ PVOID Context,
+    _In_ PGPIO_SAVE_RESTORE_BANK_HARDWARE_CONTEXT_PARAMETERS SaveParameters
+    )
+
+/*++
+
+Routine Description:
+
+    This routine saves the hardware context for the GPIO controller.
+
+Arguments:
+
+    Context - Supplies a pointer to the GPIO client driver's device extension.
+
+    SaveRestoreParameters - Supplies a pointer to a structure containing
+        parameters for the save operation:
+
+        BankId - Supplies the ID for the GPIO bank.
+
+        State - Target F-state the bank will be transitioned into.
+
+        Flags - Supplies flags for the save operation:
+            CriticalTransition - TRUE if this is due to a critical transition.
 
 Return Value:
 
@@ -2817,8 +3779,11 @@ Return Value:
     GpioBank = &GpioContext->Banks[SaveParameters->BankId];
     sunxigpioRegisters = GpioBank->Registers;
 	IntGpioRegisters = GpioBank->IntRegisters;
+
     //
-    // Copy the contents of the registers into memory.
+    // Copy the contents of the registers into memory. They are read on
+    // every save, other drivers program the pin functions of their own
+    // pins directly.
     //
 
     SourceAddress = &sunxigpioRegisters->PnCfg[0];
@@ -2841,8 +3806,15 @@ Return Value:
 			SourceAddress += 1;
 			DestinationAddress += 1;
 		}
+
+		//
+		// Status bits are write-one-to-clear and are not tracked.
+		//
+
+		GpioBank->IntSavedContext.PnIntSta = 0;
 	}
 
+    GpioBank->ContextValid = TRUE;
     return;
 }
 
@@ -2882,9 +3854,11 @@ Return Value:
 
     PSUNXI_GPIO_BANK GpioBank;
     PSUNXI_GPIO_CONTEXT GpioContext;
+    ULONG Index;
     ULONG PinValue;
     PSUNXI_GPIO_REGISTERS GpioRegisters;
 	PSUNXI_GPIO_INT_REGISTERS IntGpioRegisters;
+	BOOLEAN Force;
 
 	FunctionEnter();
 	GpioContext = (PSUNXI_GPIO_CONTEXT) Context;
@@ -2892,63 +3866,69 @@ Return Value:
 	GpioRegisters = GpioBank->Registers;
 	IntGpioRegisters = GpioBank->IntRegisters;
 	//
-	// Restore the level register.
+	// Restore the level register. The shadow is kept across the power
+	// transition and is the authoritative output state if it was loaded.
 	//
 
-	PinValue = GpioBank->SavedContext.PnDat;
-	WRITE_REGISTER_ULONG(&GpioRegisters->PnDat, PinValue);
+	if (GpioBank->OutputShadowValid == FALSE) {
+		GpioBank->OutputShadow = GpioBank->SavedContext.PnDat;
+		GpioBank->OutputShadowValid = TRUE;
+	}
 
 	//
-	// Restore the mode, polarity and enable registers.
+	// Only registers that do not already hold the saved value are written,
+	// unless the saved context was never read from the hardware.
 	//
 
-	PinValue = GpioBank->SavedContext.PnCfg[0];
-	WRITE_REGISTER_ULONG(&GpioRegisters->PnCfg[0], PinValue);
-
-	PinValue = GpioBank->SavedContext.PnCfg[1];
-	WRITE_REGISTER_ULONG(&GpioRegisters->PnCfg[1], PinValue);
-
-	PinValue = GpioBank->SavedContext.PnCfg[2];
-	WRITE_REGISTER_ULONG(&GpioRegisters->PnCfg[2], PinValue);
+	Force = (GpioBank->ContextValid == FALSE);
 
-	PinValue = GpioBank->SavedContext.PnCfg[3];
-	WRITE_REGISTER_ULONG(&GpioRegisters->PnCfg[3], PinValue);
+	PinValue = GpioBank->OutputShadow;
+	SunxiGpioRestoreRegister(&GpioRegisters->PnDat,
+							 PinValue,
+							 Force);
 
-	PinValue = GpioBank->SavedContext.PnDrv[0];
-	WRITE_REGISTER_ULONG(&GpioRegisters->PnDrv[0], PinValue);
+	//
+	// Restore the mode, polarity and enable registers.
+	//
 
-	PinValue = GpioBank->SavedContext.PnDrv[1];
-	WRITE_REGISTER_ULONG(&GpioRegisters->PnDrv[1], PinValue);
+	for (Index = 0; Index < 4; Index += 1) {
+		SunxiGpioRestoreRegister(&GpioRegisters->PnCfg[Index],
+								 GpioBank->SavedContext.PnCfg[Index],
+								 Force);
+	}
 
-	PinValue = GpioBank->SavedContext.PnPul[0];
-	WRITE_REGISTER_ULONG(&GpioRegisters->PnPul[0], PinValue);
+	for (Index = 0; Index < 2; Index += 1) {
+		SunxiGpioRestoreRegister(&GpioRegisters->PnDrv[Index],
+								 GpioBank->SavedContext.PnDrv[Index],
+								 Force);
+	}
 
-	PinValue = GpioBank->SavedContext.PnPul[1];
-	WRITE_REGISTER_ULONG(&GpioRegisters->PnPul[1], PinValue);
+	for (Index = 0; Index < 2; Index += 1) {
+		SunxiGpioRestoreRegister(&GpioRegisters->PnPul[Index],
+								 GpioBank->SavedContext.PnPul[Index],
+								 Force);
+	}
 
 	if (GpioBank->IsIntBank == TRUE) {
 
+		for (Index = 0; Index < 4; Index += 1) {
+			SunxiGpioRestoreRegister(&IntGpioRegisters->PnIntCfg[Index],
+									 GpioBank->IntSavedContext.PnIntCfg[Index],
+									 Force);
+		}
 
-		PinValue = GpioBank->IntSavedContext.PnIntCfg[0];
-		WRITE_REGISTER_ULONG(&IntGpioRegisters->PnIntCfg[0], PinValue);
-
-		PinValue = GpioBank->IntSavedContext.PnIntCfg[1];
-		WRITE_REGISTER_ULONG(&IntGpioRegisters->PnIntCfg[1], PinValue);
-
-		PinValue = GpioBank->IntSavedContext.PnIntCfg[2];
-		WRITE_REGISTER_ULONG(&IntGpioRegisters->PnIntCfg[2], PinValue);
-
-		PinValue = GpioBank->IntSavedContext.PnIntCfg[3];
-		WRITE_REGISTER_ULONG(&IntGpioRegisters->PnIntCfg[3], PinValue);
-
-		PinValue = GpioBank->IntSavedContext.PnIntDeb;
-		WRITE_REGISTER_ULONG(&IntGpioRegisters->PnIntDeb, PinValue);
+		SunxiGpioRestoreRegister(&IntGpioRegisters->PnIntDeb,
+								 GpioBank->IntSavedContext.PnIntDeb,
+								 Force);
 
-		PinValue = GpioBank->IntSavedContext.PnIntCtl;
-		WRITE_REGISTER_ULONG(&IntGpioRegisters->PnIntCtl, PinValue);
+		SunxiGpioRestoreRegister(&IntGpioRegisters->PnIntCtl,
+								 GpioBank->IntSavedContext.PnIntCtl,
+								 Force);
 
-		PinValue = GpioBank->IntSavedContext.PnIntSta;
-		WRITE_REGISTER_ULONG(&IntGpioRegisters->PnIntSta, PinValue);
+		//
+		// Status bits are write-one-to-clear, writing them back could only
+		// clear interrupts latched since the context was saved.
+		//
 	}
 
     return;
@@ -0,0 +1,96 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+    sunxigpioioctl.h
+
+Abstract:
+
+    Controller specific functions of the sunxi GPIO controller. They are
+    sent as IOCTL_GPIO_CONTROLLER_SPECIFIC_FUNCTION on a GPIO connection,
+    the input buffer is a SUNXI_GPIO_FUNCTION_INPUT.
+
+        SUNXI_GPIO_FUNCTION_QUERY_INTERRUPT_STATISTICS - returns the
+            SUNXI_GPIO_BANK_STATISTICS of BankId.
+
+        SUNXI_GPIO_FUNCTION_RESET_INTERRUPT_STATISTICS - clears the
+            counters of BankId.
+
+        SUNXI_GPIO_FUNCTION_SET_STORM_POLICY - sets the storm threshold
+            (interrupts per second, 0 disables throttling) and back-off of
+            the whole controller.
+
+Environment:
+
+    Kernel and user mode
+
+--*/
+
+#ifndef _SUNXIGPIOIOCTL_H_
+#define _SUNXIGPIOIOCTL_H_
+
+#define SUNXI_GPIO_FUNCTION_QUERY_INTERRUPT_STATISTICS	(1)
+#define SUNXI_GPIO_FUNCTION_RESET_INTERRUPT_STATISTICS	(2)
+#define SUNXI_GPIO_FUNCTION_SET_STORM_POLICY			(3)
+
+//
+// Interrupt latency, from the class extension querying the active
+// interrupts to it clearing them. Bucket 0 counts latencies under 4us,
+// every following bucket doubles the bound, the last one is open ended.
+//
+
+#define SUNXI_GPIO_LATENCY_BUCKETS		(8)
+#define SUNXI_GPIO_LATENCY_BASE_SHIFT	(2)
+
+typedef struct _SUNXI_GPIO_FUNCTION_INPUT {
+	ULONG					Function;
+	ULONG					BankId;
+	ULONG					StormThreshold;
+	ULONG					StormBackoffMs;
+} SUNXI_GPIO_FUNCTION_INPUT, *PSUNXI_GPIO_FUNCTION_INPUT;
+
+typedef struct _SUNXI_GPIO_PIN_STATISTICS {
+	ULONG					InterruptCount;
+
+	// Interrupts per second over the last complete window, and the
+	// highest rate seen.
+	ULONG					Rate;
+	ULONG					PeakRate;
+
+	// Number of times the pin was masked for exceeding the threshold.
+	ULONG					ThrottleCount;
+
+	ULONG					MaxLatencyUs;
+	ULONG					LatencyBuckets[SUNXI_GPIO_LATENCY_BUCKETS];
+} SUNXI_GPIO_PIN_STATISTICS, *PSUNXI_GPIO_PIN_STATISTICS;
+
+typedef struct _SUNXI_GPIO_BANK_STATISTICS {
+	ULONG					BankId;
+	ULONG					StormThreshold;
+	ULONG					StormBackoffMs;
+
+	// Pins currently masked by the storm throttling.
+	ULONG					ThrottledMask;
+
+	SUNXI_GPIO_PIN_STATISTICS	Pins[32];
+} SUNXI_GPIO_BANK_STATISTICS, *PSUNXI_GPIO_BANK_STATISTICS;
+
+#endif
@@ -0,0 +1,474 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	gpioconnect.c
+
+Abstract:
+
+	Randomized comparison of the batched SunxiGpioConnectIoPins and
+	SunxiGpioDisconnectIoPins of sunxigpio.c, run on the GPIO model
+	(gpiomodel.c), with the per-pin read-modify-write algorithm the
+	driver used before, replayed on a copy of the same registers.
+
+	Every round starts from random configuration, drive and pull
+	registers and connects a random pin table for input or output, with
+	random pull and drive strength, or disconnects one, with or without
+	preserving the configuration. Tables have 1 to 40 entries, may repeat
+	pins and may hold a pin beyond the bank, which ends the table. The
+	nine port registers must end up identical and the interrupt
+	registers untouched. Every so often the bank loses power and is
+	restored, which must bring back the same registers.
+
+	The batched algorithm must never need more register accesses than
+	the per-pin one, nor more than one read and one write per register.
+
+	Build and use on any host with a C compiler:
+
+		cc -O2 -I../../../../tools/host -I.. -o gpioconnect gpioconnect.c gpiomodel.c ../sunxigpio.c -lpthread
+		gpioconnect [rounds [seed]]
+
+Environment:
+
+	user mode
+
+--*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "gpiomodel.h"
+
+#define MAX_TABLE               40
+#define RESTORE_INTERVAL        64
+
+typedef struct _PER_PIN {
+    ULONG Registers[GPIO_MODEL_PORT_REGISTERS];
+    ULONG Reads;
+    ULONG Writes;
+} PER_PIN, *PPER_PIN;
+
+static const USHORT g_DriveStrengths[] = {0, 25, 33, 50, 75, 100};
+static const ULONG g_PinCounts[] = {32, 22, 13};
+
+static int g_Failures;
+static ULONG g_Seed = 0x2545f491;
+
+static ULONG
+Random (
+    VOID
+    )
+{
+    g_Seed ^= g_Seed << 13;
+    g_Seed ^= g_Seed >> 17;
+    g_Seed ^= g_Seed << 5;
+    return g_Seed;
+}
+
+static ULONG
+PerPinRead (
+    _Inout_ PPER_PIN State,
+    _In_ ULONG Index
+    )
+{
+    State->Reads += 1;
+    return State->Registers[Index];
+}
+
+static VOID
+PerPinWrite (
+    _Inout_ PPER_PIN State,
+    _In_ ULONG Index,
+    _In_ ULONG Value
+    )
+{
+    State->Writes += 1;
+    State->Registers[Index] = Value;
+}
+
+static VOID
+PerPinConnect (
+    _Inout_ PPER_PIN State,
+    _In_ ULONG NumberOfPins,
+    _In_ PGPIO_CONNECT_IO_PINS_PARAMETERS Parameters
+    )
+
+/*++
+
+Routine Description:
+
+    This routine replays the connect algorithm before the pin tables were
+    batched: one read-modify-write of the configuration, drive and pull
+    register of every pin, stopping at the first invalid pin.
+
+--*/
+
+{
+    ULONG Index;
+    PIN_NUMBER PinNumber;
+    ULONG PinValue;
+    ULONG RegisterBitNumber;
+    ULONG RegisterNumber;
+    ULONG Value;
+
+    for (Index = 0; Index < Parameters->PinCount; Index += 1) {
+        PinNumber = Parameters->PinNumberTable[Index];
+        if (PinNumber >= NumberOfPins) {
+            return;
+        }
+
+        RegisterNumber = PinNumber / 8;
+        RegisterBitNumber = PinNumber % 8;
+        PinValue = PerPinRead(State, GPIO_MODEL_PNCFG0 + RegisterNumber);
+        PinValue &= ~(0xf << (RegisterBitNumber * 4));
+        if (Parameters->ConnectMode == ConnectModeOutput) {
+            PinValue |= (1 << (RegisterBitNumber * 4));
+        }
+
+        PerPinWrite(State, GPIO_MODEL_PNCFG0 + RegisterNumber, PinValue);
+
+        RegisterNumber = PinNumber / 16;
+        RegisterBitNumber = PinNumber % 16;
+        PinValue = PerPinRead(State, GPIO_MODEL_PNDRV0 + RegisterNumber);
+        Value = 0x1;
+        if (Parameters->ConnectMode == ConnectModeOutput) {
+            switch (Parameters->DriveStrength) {
+            case 25:
+                Value = 0x0;
+                break;
+
+            case 75:
+                Value = 0x3;
+                break;
+
+            case 100:
+                Value = 0x4;
+                break;
+
+            default:
+                Value = 0x1;
+                break;
+            }
+        }
+
+        PinValue &= ~(0x03 << (RegisterBitNumber * 2));
+        PinValue |= Value << (RegisterBitNumber * 2);
+        PerPinWrite(State, GPIO_MODEL_PNDRV0 + RegisterNumber, PinValue);
+
+        PinValue = PerPinRead(State, GPIO_MODEL_PNPUL0 + RegisterNumber);
+        Value = 0x0;
+        if (Parameters->ConnectMode == ConnectModeOutput) {
+            Value = Parameters->PullConfiguration;
+        }
+
+        PinValue &= ~(0x03 << (RegisterBitNumber * 2));
+        PinValue |= Value << (RegisterBitNumber * 2);
+        PerPinWrite(State, GPIO_MODEL_PNPUL0 + RegisterNumber, PinValue);
+    }
+}
+
+static VOID
+PerPinDisconnect (
+    _Inout_ PPER_PIN State,
+    _In_ ULONG NumberOfPins,
+    _In_ PPIN_NUMBER PinNumberTable,
+    _In_ ULONG PinCount,
+    _In_ BOOLEAN PreserveConfiguration
+    )
+
+/*++
+
+Routine Description:
+
+    This routine replays the disconnect algorithm before the pin tables
+    were batched: every pin back to disabled (7), drive level 1 and pull
+    1, one read-modify-write per register and pin.
+
+--*/
+
+{
+    ULONG Index;
+    PIN_NUMBER PinNumber;
+    ULONG PinValue;
+    ULONG RegisterBitNumber;
+    ULONG RegisterNumber;
+
+    if (PreserveConfiguration != FALSE) {
+        return;
+    }
+
+    for (Index = 0; Index < PinCount; Index += 1) {
+        PinNumber = PinNumberTable[Index];
+        if (PinNumber >= NumberOfPins) {
+            return;
+        }
+
+        RegisterNumber = PinNumber / 8;
+        RegisterBitNumber = (PinNumber % 8) * 4;
+        PinValue = PerPinRead(State, GPIO_MODEL_PNCFG0 + RegisterNumber);
+        PinValue &= ~(0xf << RegisterBitNumber);
+        PinValue |= (0x07 << RegisterBitNumber);
+        PerPinWrite(State, GPIO_MODEL_PNCFG0 + RegisterNumber, PinValue);
+
+        RegisterNumber = PinNumber / 16;
+        RegisterBitNumber = (PinNumber % 16) * 2;
+        PinValue = PerPinRead(State, GPIO_MODEL_PNDRV0 + RegisterNumber);
+        PinValue &= ~(0x3 << RegisterBitNumber);
+        PinValue |= (0x1 << RegisterBitNumber);
+        PerPinWrite(State, GPIO_MODEL_PNDRV0 + RegisterNumber, PinValue);
+
+        PinValue = PerPinRead(State, GPIO_MODEL_PNPUL0 + RegisterNumber);
+        PinValue &= ~(0x3 << RegisterBitNumber);
+        PinValue |= (0x1 << RegisterBitNumber);
+        PerPinWrite(State, GPIO_MODEL_PNPUL0 + RegisterNumber, PinValue);
+    }
+}
+
+static VOID
+PowerCycle (
+    VOID
+    )
+{
+    (VOID)GpioModelStop(TRUE);
+    GpioModelPowerLoss();
+    (VOID)GpioModelStart(TRUE);
+}
+
+static VOID
+Report (
+    _In_ ULONG Round,
+    _In_ const char *Operation,
+    _In_ PPIN_NUMBER PinNumberTable,
+    _In_ ULONG PinCount,
+    _In_ PULONG Initial,
+    _In_ PPER_PIN Expected
+    )
+{
+    ULONG Index;
+
+    g_Failures += 1;
+    if (g_Failures > 5) {
+        return;
+    }
+
+    printf("FAIL round %lu: %s of", (unsigned long)Round, Operation);
+    for (Index = 0; Index < PinCount; Index += 1) {
+        printf(" %lu", (unsigned long)PinNumberTable[Index]);
+    }
+
+    printf("\n  %-8s %-10s %-10s %-10s\n", "register", "initial", "per-pin", "batched");
+    for (Index = 0; Index < GPIO_MODEL_PORT_REGISTERS; Index += 1) {
+        printf("  %-8lu 0x%08lx 0x%08lx 0x%08lx%s\n",
+               (unsigned long)Index,
+               (unsigned long)Initial[Index],
+               (unsigned long)Expected->Registers[Index],
+               (unsigned long)g_GpioModel.Registers[Index],
+               (Expected->Registers[Index] != g_GpioModel.Registers[Index]) ? " <" : "");
+    }
+}
+
+static VOID
+RunRounds (
+    _In_ ULONG NumberOfPins,
+    _In_ ULONG Rounds,
+    _Inout_ PULONG BatchedAccesses,
+    _Inout_ PULONG PerPinAccesses
+    )
+{
+    GPIO_CONNECT_IO_PINS_PARAMETERS Connect;
+    ULONG Index;
+    ULONG Initial[GPIO_MODEL_PORT_REGISTERS];
+    ULONG Interrupts[GPIO_MODEL_INT_REGISTERS];
+    const char *Operation;
+    PER_PIN PerPin;
+    ULONG PinCount;
+    PIN_NUMBER PinNumberTable[MAX_TABLE];
+    BOOLEAN Preserve;
+    ULONG Round;
+    ULONG Selector;
+
+    if (!NT_SUCCESS(GpioModelReset(NumberOfPins))) {
+        printf("FAIL: controller with %lu pins not started\n", (unsigned long)NumberOfPins);
+        g_Failures += 1;
+        return;
+    }
+
+    for (Round = 0; Round < Rounds; Round += 1) {
+
+        //
+        // Random starting registers, except on the rounds that check the
+        // driver's saved copy of them. Those start from the registers the
+        // driver restored after a power loss, which it knows about.
+        //
+
+        if ((Round % RESTORE_INTERVAL) == 0) {
+            PowerCycle();
+
+        } else {
+            for (Index = 0; Index < GPIO_MODEL_PORT_REGISTERS; Index += 1) {
+                if (Index != GPIO_MODEL_PNDAT) {
+                    g_GpioModel.Registers[Index] = Random();
+                }
+            }
+
+            for (Index = 0; Index < GPIO_MODEL_INT_REGISTERS; Index += 1) {
+                g_GpioModel.Registers[GPIO_MODEL_PORT_REGISTERS + Index] = Random() & 0x7fffffff;
+            }
+        }
+
+        memcpy(Initial, g_GpioModel.Registers, sizeof(Initial));
+        memcpy(Interrupts,
+               &g_GpioModel.Registers[GPIO_MODEL_PORT_REGISTERS],
+               sizeof(Interrupts));
+
+        PinCount = 1 + Random() % MAX_TABLE;
+        for (Index = 0; Index < PinCount; Index += 1) {
+            PinNumberTable[Index] = Random() % NumberOfPins;
+            if ((Random() % 64) == 0) {
+                PinNumberTable[Index] = NumberOfPins + Random() % 8;
+            }
+        }
+
+        memset(&PerPin, 0, sizeof(PerPin));
+        memcpy(PerPin.Registers, Initial, sizeof(PerPin.Registers));
+        GpioModelClearCounters();
+
+        Selector = Random() % 3;
+        if (Selector < 2) {
+            memset(&Connect, 0, sizeof(Connect));
+            Connect.PinNumberTable = PinNumberTable;
+            Connect.PinCount = PinCount;
+            Connect.ConnectMode = (Selector == 0) ? ConnectModeInput : ConnectModeOutput;
+            Connect.PullConfiguration = (UCHAR)(Random() % 3);
+            Connect.DriveStrength =
+                g_DriveStrengths[Random() % (sizeof(g_DriveStrengths) / sizeof(g_DriveStrengths[0]))];
+
+            Operation = (Selector == 0) ? "input connect" : "output connect";
+            PerPinConnect(&PerPin, NumberOfPins, &Connect);
+            (VOID)GpioModelConnect(Connect.ConnectMode,
+                                   PinNumberTable,
+                                   PinCount,
+                                   Connect.PullConfiguration,
+                                   Connect.DriveStrength);
+
+        } else {
+            Preserve = ((Random() % 8) == 0);
+            Operation = Preserve ? "preserving disconnect" : "disconnect";
+            PerPinDisconnect(&PerPin, NumberOfPins, PinNumberTable, PinCount, Preserve);
+            (VOID)GpioModelDisconnect(PinNumberTable, PinCount, Preserve);
+        }
+
+        *BatchedAccesses += GpioModelMmioReads() + GpioModelMmioWrites();
+        *PerPinAccesses += PerPin.Reads + PerPin.Writes;
+
+        if ((memcmp(PerPin.Registers, g_GpioModel.Registers, sizeof(PerPin.Registers)) != 0) ||
+            (memcmp(Interrupts,
+                    &g_GpioModel.Registers[GPIO_MODEL_PORT_REGISTERS],
+                    sizeof(Interrupts)) != 0)) {
+
+            Report(Round, Operation, PinNumberTable, PinCount, Initial, &PerPin);
+            continue;
+        }
+
+        if ((GpioModelMmioReads() + GpioModelMmioWrites() > PerPin.Reads + PerPin.Writes) ||
+            (GpioModelMmioReads() > 8) || (GpioModelMmioWrites() > 8)) {
+
+            printf("FAIL round %lu: %s took %lu reads and %lu writes, per-pin %lu\n",
+                   (unsigned long)Round,
+                   Operation,
+                   (unsigned long)GpioModelMmioReads(),
+                   (unsigned long)GpioModelMmioWrites(),
+                   (unsigned long)(PerPin.Reads + PerPin.Writes));
+
+            g_Failures += 1;
+        }
+
+        //
+        // The driver's saved copy of the registers must have followed.
+        //
+
+        if ((Round % RESTORE_INTERVAL) == 0) {
+            memcpy(Initial, g_GpioModel.Registers, sizeof(Initial));
+            PowerCycle();
+            for (Index = 0; Index < GPIO_MODEL_PORT_REGISTERS; Index += 1) {
+                if ((Index != GPIO_MODEL_PNDAT) &&
+                    (g_GpioModel.Registers[Index] != Initial[Index])) {
+
+                    printf("FAIL round %lu: register %lu restored as 0x%08lx, was 0x%08lx\n",
+                           (unsigned long)Round,
+                           (unsigned long)Index,
+                           (unsigned long)g_GpioModel.Registers[Index],
+                           (unsigned long)Initial[Index]);
+
+                    g_Failures += 1;
+                }
+            }
+        }
+    }
+
+    GpioModelRelease();
+}
+
+int
+main (
+    int argc,
+    char **argv
+    )
+{
+    ULONG Batched;
+    ULONG Index;
+    ULONG PerPin;
+    ULONG Rounds;
+
+    Rounds = 20000;
+    if (argc > 1) {
+        Rounds = strtoul(argv[1], NULL, 0);
+    }
+
+    if (argc > 2) {
+        g_Seed = strtoul(argv[2], NULL, 0);
+    }
+
+    if ((Rounds == 0) || (g_Seed == 0)) {
+        fprintf(stderr, "usage: gpioconnect [rounds [seed]]\n");
+        return 2;
+    }
+
+    printf("%lu rounds per bank size, seed 0x%08lx\n\n", (unsigned long)Rounds, (unsigned long)g_Seed);
+    printf("%-6s %16s %16s\n", "pins", "batched mmio", "per-pin mmio");
+    for (Index = 0; Index < sizeof(g_PinCounts) / sizeof(g_PinCounts[0]); Index += 1) {
+        Batched = 0;
+        PerPin = 0;
+        RunRounds(g_PinCounts[Index], Rounds, &Batched, &PerPin);
+        printf("%-6lu %16.2f %16.2f\n",
+               (unsigned long)g_PinCounts[Index],
+               (double)Batched / Rounds,
+               (double)PerPin / Rounds);
+    }
+
+    if (g_Failures != 0) {
+        printf("%d check(s) failed\n", g_Failures);
+        return 1;
+    }
+
+    printf("all checks passed\n");
+    return 0;
+}
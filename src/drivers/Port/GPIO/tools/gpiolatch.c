@@ -0,0 +1,445 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	gpiolatch.c
+
+Abstract:
+
+	Checks and benchmarks the PnDat output latch shadow of sunxigpio.c on
+	the GPIO model (gpiomodel.c).
+
+		latch       the first write loads the shadow with one read,
+		            every later write is a single store, reads of
+		            write-configured pins come from the shadow and
+		            the latch survives a save/restore with and
+		            without a loss of power
+		concurrent  writer threads, each owning a nibble of output
+		            pins, write through the class extension's bank
+		            serialization while another thread raises,
+		            services, masks and unmasks interrupts on the
+		            same bank. Every writer must read back its own
+		            pins, the final latch must be the union of the
+		            writers' last values and PnDat must only have
+		            been read once.
+		benchmark   register accesses and host time per write, the
+		            shadowed write against the read-modify-write the
+		            driver did before, replayed on the model
+
+	On hardware every register access is an uncached bus cycle, the
+	access counts are what the comparison is about. The host time only
+	shows that nothing else was added.
+
+	Build and use on any host with a C compiler:
+
+		cc -O2 -I../../../../tools/host -I.. -o gpiolatch gpiolatch.c gpiomodel.c ../sunxigpio.c -lpthread
+		gpiolatch [writes]
+
+Environment:
+
+	user mode
+
+--*/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "gpiomodel.h"
+
+#define WRITER_THREADS          4
+#define WRITER_PINS             4
+#define WRITER_OPERATIONS       200000
+#define OUTPUT_MASK             0x0000ffff
+#define INPUT_LEVELS            0x5aa50000
+#define INTERRUPT_PIN           24
+
+typedef struct _WRITER {
+    pthread_t Thread;
+    ULONG Index;
+    ULONG Mask;
+    ULONG Value;
+    ULONG Writes;
+    ULONG Reads;
+    ULONG Mismatches;
+} WRITER, *PWRITER;
+
+static int g_Failures;
+static volatile int g_WritersDone;
+
+static VOID
+Check (
+    _In_ BOOLEAN Condition,
+    _In_ const char *Case,
+    _In_ const char *What
+    )
+{
+    if (!Condition) {
+        printf("FAIL %s: %s\n", Case, What);
+        g_Failures += 1;
+    }
+}
+
+static ULONG
+Random (
+    _Inout_ PULONG State
+    )
+{
+    ULONG Value;
+
+    Value = *State;
+    Value ^= Value << 13;
+    Value ^= Value >> 17;
+    Value ^= Value << 5;
+    *State = Value;
+    return Value;
+}
+
+static LONGLONG
+NowNs (
+    VOID
+    )
+{
+    struct timespec Time;
+
+    clock_gettime(CLOCK_MONOTONIC, &Time);
+    return (LONGLONG)Time.tv_sec * 1000000000 + Time.tv_nsec;
+}
+
+static VOID
+ConnectPorts (
+    VOID
+    )
+{
+    PIN_NUMBER Inputs[16];
+    PIN_NUMBER Outputs[16];
+    ULONG Index;
+
+    for (Index = 0; Index < 16; Index += 1) {
+        Outputs[Index] = Index;
+        Inputs[Index] = 16 + Index;
+    }
+
+    Check(NT_SUCCESS(GpioModelConnect(ConnectModeOutput, Outputs, 16, 0, 50)),
+          "setup", "outputs connected");
+
+    Check(NT_SUCCESS(GpioModelConnect(ConnectModeInput, Inputs, 16, 0, 0)),
+          "setup", "inputs connected");
+
+    g_GpioModel.InputLevels = INPUT_LEVELS;
+}
+
+static ULONG
+Latch (
+    VOID
+    )
+{
+    return g_GpioModel.Registers[GPIO_MODEL_PNDAT] & OUTPUT_MASK;
+}
+
+static VOID
+TestLatch (
+    VOID
+    )
+{
+    ULONG Expected;
+    ULONG Index;
+    ULONG State;
+    ULONG Set;
+    ULONG Clear;
+    ULONG Value;
+
+    Check(NT_SUCCESS(GpioModelReset(32)), "latch", "controller started");
+    ConnectPorts();
+    GpioModelClearCounters();
+
+    Check(NT_SUCCESS(GpioModelWrite(0x00ff, 0)), "latch", "first write");
+    Check(g_GpioModel.Reads[GPIO_MODEL_PNDAT] == 1, "latch", "first write loads the shadow");
+    Check(g_GpioModel.Writes[GPIO_MODEL_PNDAT] == 1, "latch", "first write stores once");
+    Check(Latch() == 0x00ff, "latch", "first write value");
+
+    GpioModelClearCounters();
+    Expected = 0x00ff;
+    State = 0x1234567;
+    for (Index = 0; Index < 1000; Index += 1) {
+        Set = Random(&State) & OUTPUT_MASK;
+        Clear = Random(&State) & OUTPUT_MASK;
+        (VOID)GpioModelWrite(Set, Clear);
+        Expected = (Expected | Set) & ~Clear;
+        if (Latch() != Expected) {
+            break;
+        }
+    }
+
+    Check(Latch() == Expected, "latch", "every write reaches the latch");
+    Check(g_GpioModel.Reads[GPIO_MODEL_PNDAT] == 0, "latch", "later writes do not read PnDat");
+    Check(GpioModelMmioWrites() == Index, "latch", "one store per write");
+
+    GpioModelClearCounters();
+    Value = GpioModelRead(TRUE);
+    Check((Value & OUTPUT_MASK) == Expected, "latch", "write-configured read returns the latch");
+    Check(GpioModelMmioReads() == 0, "latch", "write-configured read served from the shadow");
+
+    Value = GpioModelRead(FALSE);
+    Check((Value & ~OUTPUT_MASK) == INPUT_LEVELS, "latch", "input read returns the levels");
+    Check(g_GpioModel.Reads[GPIO_MODEL_PNDAT] == 1, "latch", "input read reads PnDat");
+
+    //
+    // A save/restore that kept the context, then one that lost it.
+    //
+
+    Check(NT_SUCCESS(GpioModelStop(TRUE)), "latch", "stop");
+    Check(NT_SUCCESS(GpioModelStart(TRUE)), "latch", "start");
+    Check(Latch() == Expected, "latch", "latch kept across a restore");
+
+    Check(NT_SUCCESS(GpioModelStop(TRUE)), "latch", "stop");
+    GpioModelPowerLoss();
+    Check(NT_SUCCESS(GpioModelStart(TRUE)), "latch", "start");
+    Check(Latch() == Expected, "latch", "latch restored after a power loss");
+
+    GpioModelClearCounters();
+    (VOID)GpioModelWrite(0x8000, 0x0001);
+    Expected = (Expected | 0x8000) & ~0x0001;
+    Check(Latch() == Expected, "latch", "write after the restore");
+    Check(g_GpioModel.Reads[GPIO_MODEL_PNDAT] == 0, "latch", "shadow still valid after the restore");
+
+    GpioModelRelease();
+}
+
+static VOID *
+WriterThread (
+    _In_ VOID *Argument
+    )
+{
+    ULONG Clear;
+    ULONG Index;
+    ULONG Set;
+    ULONG State;
+    PWRITER Writer;
+
+    Writer = (PWRITER)Argument;
+    State = 0x9e3779b9 * (Writer->Index + 1);
+    for (Index = 0; Index < WRITER_OPERATIONS; Index += 1) {
+        Set = Random(&State) & Writer->Mask;
+        Clear = Random(&State) & Writer->Mask & ~Set;
+        (VOID)GpioModelWrite(Set, Clear);
+        Writer->Value = (Writer->Value | Set) & ~Clear;
+        Writer->Writes += 1;
+
+        if ((Index % 7) == 0) {
+            Writer->Reads += 1;
+            if ((GpioModelRead(TRUE) & Writer->Mask) != Writer->Value) {
+                Writer->Mismatches += 1;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static VOID *
+InterruptThread (
+    _In_ VOID *Argument
+    )
+{
+    PULONG Serviced;
+
+    Serviced = (PULONG)Argument;
+    while (__atomic_load_n(&g_WritersDone, __ATOMIC_SEQ_CST) == 0) {
+        GpioModelAssert(1 << INTERRUPT_PIN);
+        if (GpioModelInterrupt() != 0) {
+            *Serviced += 1;
+        }
+
+        GpioModelMask(1 << INTERRUPT_PIN);
+        GpioModelUnmask(INTERRUPT_PIN);
+    }
+
+    return NULL;
+}
+
+static VOID
+TestConcurrent (
+    VOID
+    )
+{
+    pthread_t Interrupts;
+    ULONG Index;
+    ULONG Mask;
+    ULONG Mismatches;
+    ULONG Reads;
+    ULONG Serviced;
+    ULONG Value;
+    ULONG Writes;
+    WRITER Writers[WRITER_THREADS];
+
+    Check(NT_SUCCESS(GpioModelReset(32)), "concurrent", "controller started");
+    ConnectPorts();
+    Check(NT_SUCCESS(GpioModelEnableInterrupt(INTERRUPT_PIN, Latched, InterruptActiveHigh)),
+          "concurrent", "interrupt enabled");
+
+    GpioModelClearCounters();
+
+    g_WritersDone = 0;
+    Serviced = 0;
+    pthread_create(&Interrupts, NULL, InterruptThread, &Serviced);
+
+    memset(Writers, 0, sizeof(Writers));
+    for (Index = 0; Index < WRITER_THREADS; Index += 1) {
+        Writers[Index].Index = Index;
+        Writers[Index].Mask = ((1 << WRITER_PINS) - 1) << (Index * WRITER_PINS);
+        pthread_create(&Writers[Index].Thread, NULL, WriterThread, &Writers[Index]);
+    }
+
+    Mask = 0;
+    Value = 0;
+    Writes = 0;
+    Reads = 0;
+    Mismatches = 0;
+    for (Index = 0; Index < WRITER_THREADS; Index += 1) {
+        pthread_join(Writers[Index].Thread, NULL);
+        Mask |= Writers[Index].Mask;
+        Value |= Writers[Index].Value;
+        Writes += Writers[Index].Writes;
+        Reads += Writers[Index].Reads;
+        Mismatches += Writers[Index].Mismatches;
+    }
+
+    __atomic_store_n(&g_WritersDone, 1, __ATOMIC_SEQ_CST);
+    pthread_join(Interrupts, NULL);
+
+    printf("concurrent: %lu writes, %lu reads by %d writers, %lu interrupts serviced\n",
+           (unsigned long)Writes,
+           (unsigned long)Reads,
+           WRITER_THREADS,
+           (unsigned long)Serviced);
+
+    Check(Mismatches == 0, "concurrent", "every writer read back its own pins");
+    Check((g_GpioModel.Registers[GPIO_MODEL_PNDAT] & Mask) == Value,
+          "concurrent", "latch is the union of the writers' values");
+
+    Check((GpioModelRead(TRUE) & Mask) == Value, "concurrent", "shadow matches the latch");
+    Check(g_GpioModel.Writes[GPIO_MODEL_PNDAT] == Writes, "concurrent", "one PnDat store per write");
+    Check(g_GpioModel.Reads[GPIO_MODEL_PNDAT] == 1, "concurrent", "PnDat read once, to load the shadow");
+    Check(Serviced != 0, "concurrent", "interrupts serviced meanwhile");
+
+    GpioModelRelease();
+}
+
+static VOID
+Benchmark (
+    _In_ ULONG Count
+    )
+{
+    volatile ULONG *Register;
+    ULONG Index;
+    LONGLONG Legacy;
+    ULONG LegacyReads;
+    ULONG LegacyWrites;
+    LONGLONG Shadowed;
+    ULONG ShadowedReads;
+    ULONG ShadowedWrites;
+    ULONG Value;
+
+    Check(NT_SUCCESS(GpioModelReset(32)), "benchmark", "controller started");
+    ConnectPorts();
+    Register = &g_GpioModel.PortBlock[GPIO_MODEL_PNDAT];
+
+    //
+    // The driver before the shadow: read PnDat, modify, write it back.
+    //
+
+    GpioModelClearCounters();
+    Legacy = NowNs();
+    for (Index = 0; Index < Count; Index += 1) {
+        Value = READ_REGISTER_ULONG(Register);
+        Value |= (1 << (Index & 15));
+        Value &= ~(1 << ((Index + 8) & 15));
+        WRITE_REGISTER_ULONG(Register, Value);
+    }
+
+    Legacy = NowNs() - Legacy;
+    LegacyReads = GpioModelMmioReads();
+    LegacyWrites = GpioModelMmioWrites();
+
+    GpioModelClearCounters();
+    Shadowed = NowNs();
+    for (Index = 0; Index < Count; Index += 1) {
+        (VOID)GpioModelWrite(1 << (Index & 15), 1 << ((Index + 8) & 15));
+    }
+
+    Shadowed = NowNs() - Shadowed;
+    ShadowedReads = GpioModelMmioReads();
+    ShadowedWrites = GpioModelMmioWrites();
+
+    printf("\nper write, %lu writes\n\n", (unsigned long)Count);
+    printf("%-10s %8s %8s %8s %8s\n", "case", "reads", "writes", "mmio", "ns");
+    printf("%-10s %8.2f %8.2f %8.2f %8.1f\n",
+           "legacy",
+           (double)LegacyReads / Count,
+           (double)LegacyWrites / Count,
+           (double)(LegacyReads + LegacyWrites) / Count,
+           (double)Legacy / Count);
+
+    printf("%-10s %8.2f %8.2f %8.2f %8.1f\n",
+           "shadowed",
+           (double)ShadowedReads / Count,
+           (double)ShadowedWrites / Count,
+           (double)(ShadowedReads + ShadowedWrites) / Count,
+           (double)Shadowed / Count);
+
+    Check(ShadowedReads <= 1, "benchmark", "shadowed writes do not read PnDat");
+    Check(ShadowedReads + ShadowedWrites < LegacyReads + LegacyWrites,
+          "benchmark", "shadowed write is cheaper than the read-modify-write");
+
+    GpioModelRelease();
+}
+
+int
+main (
+    int argc,
+    char **argv
+    )
+{
+    ULONG Count;
+
+    Count = 1000000;
+    if (argc > 1) {
+        Count = strtoul(argv[1], NULL, 0);
+        if (Count == 0) {
+            fprintf(stderr, "usage: gpiolatch [writes]\n");
+            return 2;
+        }
+    }
+
+    TestLatch();
+    TestConcurrent();
+    Benchmark(Count);
+
+    if (g_Failures != 0) {
+        printf("%d check(s) failed\n", g_Failures);
+        return 1;
+    }
+
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,1192 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	gpiomodel.c
+
+Abstract:
+
+	Host model of a sunxi GPIO port and of the GPIO class extension, see
+	gpiomodel.h.
+
+Environment:
+
+	user mode
+
+--*/
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+#include <acpiioct.h>
+
+#include "gpiomodel.h"
+
+#define GPIO_MODEL_PORT_BASE            0x01c20800
+#define GPIO_MODEL_INT_BASE             0x01c20a00
+#define GPIO_MODEL_RESOURCES            3
+
+#define GPIO_MODEL_FUNCTION_OUTPUT      1
+#define GPIO_MODEL_FUNCTION_EINT        6
+
+GPIO_MODEL g_GpioModel;
+
+DRIVER_INITIALIZE DriverEntry;
+
+//
+// The bus serializes register accesses, the passive bank lock the I/O
+// callbacks and the interrupt lock the interrupt callbacks. The model
+// lock protects the DPC and timer queues.
+//
+
+static pthread_mutex_t g_GpioModelBusLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t g_GpioModelIoLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t g_GpioModelInterruptLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t g_GpioModelLock = PTHREAD_MUTEX_INITIALIZER;
+
+static CM_PARTIAL_RESOURCE_DESCRIPTOR g_GpioModelResources[GPIO_MODEL_RESOURCES];
+
+//
+// ------------------------------------------------------------------ Registers
+//
+
+static ULONG
+GpioModelIndex (
+    _In_ volatile ULONG *Register
+    )
+{
+    if ((Register >= &g_GpioModel.PortBlock[0]) &&
+        (Register < &g_GpioModel.PortBlock[GPIO_MODEL_PORT_REGISTERS])) {
+
+        return (ULONG)(Register - &g_GpioModel.PortBlock[0]);
+    }
+
+    assert((Register >= &g_GpioModel.IntBlock[0]) &&
+           (Register < &g_GpioModel.IntBlock[GPIO_MODEL_INT_REGISTERS]));
+
+    return GPIO_MODEL_PORT_REGISTERS + (ULONG)(Register - &g_GpioModel.IntBlock[0]);
+}
+
+static ULONG
+GpioModelFunctionMask (
+    _In_ ULONG Function
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the pins whose function select is Function.
+
+--*/
+
+{
+    ULONG Mask;
+    ULONG PinNumber;
+    ULONG Value;
+
+    Mask = 0;
+    for (PinNumber = 0; PinNumber < 32; PinNumber += 1) {
+        Value = g_GpioModel.Registers[GPIO_MODEL_PNCFG0 + PinNumber / 8];
+        if (((Value >> ((PinNumber % 8) * 4)) & 0xf) == Function) {
+            Mask |= (1 << PinNumber);
+        }
+    }
+
+    return Mask;
+}
+
+ULONG
+READ_REGISTER_ULONG (
+    _In_ volatile ULONG *Register
+    )
+{
+    ULONG Index;
+    ULONG OutputMask;
+    ULONG Value;
+
+    Index = GpioModelIndex(Register);
+    __sync_fetch_and_add(&g_GpioModel.Reads[Index], 1);
+
+    pthread_mutex_lock(&g_GpioModelBusLock);
+    Value = g_GpioModel.Registers[Index];
+    if (Index == GPIO_MODEL_PNDAT) {
+        OutputMask = GpioModelFunctionMask(GPIO_MODEL_FUNCTION_OUTPUT);
+        Value = (Value & OutputMask) | (g_GpioModel.InputLevels & ~OutputMask);
+    }
+
+    pthread_mutex_unlock(&g_GpioModelBusLock);
+    return Value;
+}
+
+VOID
+WRITE_REGISTER_ULONG (
+    _In_ volatile ULONG *Register,
+    _In_ ULONG Value
+    )
+{
+    ULONG Index;
+
+    Index = GpioModelIndex(Register);
+    __sync_fetch_and_add(&g_GpioModel.Writes[Index], 1);
+
+    pthread_mutex_lock(&g_GpioModelBusLock);
+    if (Index == GPIO_MODEL_PNINTSTA) {
+        g_GpioModel.Registers[Index] &= ~Value;
+
+    } else {
+        g_GpioModel.Registers[Index] = Value;
+    }
+
+    pthread_mutex_unlock(&g_GpioModelBusLock);
+}
+
+VOID
+GpioModelPowerLoss (
+    VOID
+    )
+{
+    ULONG Index;
+
+    pthread_mutex_lock(&g_GpioModelBusLock);
+    for (Index = 0; Index < GPIO_MODEL_REGISTERS; Index += 1) {
+        g_GpioModel.Registers[Index] = 0;
+    }
+
+    for (Index = 0; Index < 4; Index += 1) {
+        g_GpioModel.Registers[GPIO_MODEL_PNCFG0 + Index] = 0x77777777;
+    }
+
+    for (Index = 0; Index < 2; Index += 1) {
+        g_GpioModel.Registers[GPIO_MODEL_PNDRV0 + Index] = 0x55555555;
+    }
+
+    pthread_mutex_unlock(&g_GpioModelBusLock);
+}
+
+VOID
+GpioModelAssert (
+    _In_ ULONG PinMask
+    )
+{
+    pthread_mutex_lock(&g_GpioModelBusLock);
+    g_GpioModel.Registers[GPIO_MODEL_PNINTSTA] |=
+        PinMask & GpioModelFunctionMask(GPIO_MODEL_FUNCTION_EINT);
+
+    pthread_mutex_unlock(&g_GpioModelBusLock);
+}
+
+VOID
+GpioModelClearCounters (
+    VOID
+    )
+{
+    memset(g_GpioModel.Reads, 0, sizeof(g_GpioModel.Reads));
+    memset(g_GpioModel.Writes, 0, sizeof(g_GpioModel.Writes));
+}
+
+ULONG
+GpioModelMmioReads (
+    VOID
+    )
+{
+    ULONG Count;
+    ULONG Index;
+
+    Count = 0;
+    for (Index = 0; Index < GPIO_MODEL_REGISTERS; Index += 1) {
+        Count += g_GpioModel.Reads[Index];
+    }
+
+    return Count;
+}
+
+ULONG
+GpioModelMmioWrites (
+    VOID
+    )
+{
+    ULONG Count;
+    ULONG Index;
+
+    Count = 0;
+    for (Index = 0; Index < GPIO_MODEL_REGISTERS; Index += 1) {
+        Count += g_GpioModel.Writes[Index];
+    }
+
+    return Count;
+}
+
+//
+// ------------------------------------------------------------ Time and DPCs
+//
+
+LARGE_INTEGER
+KeQueryPerformanceCounter (
+    _Out_opt_ PLARGE_INTEGER PerformanceFrequency
+    )
+{
+    LARGE_INTEGER Now;
+
+    if (PerformanceFrequency != NULL) {
+        PerformanceFrequency->QuadPart = GPIO_MODEL_PERF_FREQUENCY;
+    }
+
+    Now.QuadPart = __atomic_load_n(&g_GpioModel.Now, __ATOMIC_SEQ_CST);
+    return Now;
+}
+
+VOID
+KeInitializeDpc (
+    _Out_ PKDPC Dpc,
+    _In_ PKDEFERRED_ROUTINE DeferredRoutine,
+    _In_opt_ PVOID DeferredContext
+    )
+{
+    Dpc->DeferredRoutine = DeferredRoutine;
+    Dpc->DeferredContext = DeferredContext;
+    Dpc->Inserted = FALSE;
+}
+
+BOOLEAN
+KeInsertQueueDpc (
+    _Inout_ PKDPC Dpc,
+    _In_opt_ PVOID SystemArgument1,
+    _In_opt_ PVOID SystemArgument2
+    )
+{
+    BOOLEAN Inserted;
+
+    UNREFERENCED_PARAMETER(SystemArgument1);
+    UNREFERENCED_PARAMETER(SystemArgument2);
+
+    pthread_mutex_lock(&g_GpioModelLock);
+    Inserted = FALSE;
+    if (Dpc->Inserted == FALSE) {
+        assert(g_GpioModel.DpcCount < GPIO_MODEL_MAX_DPCS);
+        g_GpioModel.Dpcs[g_GpioModel.DpcCount] = Dpc;
+        g_GpioModel.DpcCount += 1;
+        Dpc->Inserted = TRUE;
+        Inserted = TRUE;
+    }
+
+    pthread_mutex_unlock(&g_GpioModelLock);
+    return Inserted;
+}
+
+VOID
+GpioModelRunDpcs (
+    VOID
+    )
+{
+    PKDPC Dpc;
+
+    for (;;) {
+        pthread_mutex_lock(&g_GpioModelLock);
+        if (g_GpioModel.DpcCount == 0) {
+            pthread_mutex_unlock(&g_GpioModelLock);
+            break;
+        }
+
+        Dpc = g_GpioModel.Dpcs[0];
+        g_GpioModel.DpcCount -= 1;
+        memmove(&g_GpioModel.Dpcs[0],
+                &g_GpioModel.Dpcs[1],
+                g_GpioModel.DpcCount * sizeof(PKDPC));
+
+        Dpc->Inserted = FALSE;
+        g_GpioModel.DpcsRun += 1;
+        pthread_mutex_unlock(&g_GpioModelLock);
+
+        Dpc->DeferredRoutine(Dpc, Dpc->DeferredContext, NULL, NULL);
+    }
+}
+
+VOID
+KeFlushQueuedDpcs (
+    VOID
+    )
+{
+    GpioModelRunDpcs();
+}
+
+VOID
+KeInitializeTimer (
+    _Out_ PKTIMER Timer
+    )
+{
+    memset(Timer, 0, sizeof(*Timer));
+}
+
+static BOOLEAN
+GpioModelRemoveTimer (
+    _Inout_ PKTIMER Timer
+    )
+{
+    ULONG Index;
+
+    for (Index = 0; Index < g_GpioModel.TimerCount; Index += 1) {
+        if (g_GpioModel.Timers[Index] == Timer) {
+            g_GpioModel.TimerCount -= 1;
+            g_GpioModel.Timers[Index] = g_GpioModel.Timers[g_GpioModel.TimerCount];
+            Timer->Inserted = FALSE;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+BOOLEAN
+KeSetTimer (
+    _Inout_ PKTIMER Timer,
+    _In_ LARGE_INTEGER DueTime,
+    _In_opt_ PKDPC Dpc
+    )
+{
+    BOOLEAN Inserted;
+
+    //
+    // One tick of the performance counter is 100ns, relative due times
+    // are negative.
+    //
+
+    pthread_mutex_lock(&g_GpioModelLock);
+    Inserted = GpioModelRemoveTimer(Timer);
+    if (DueTime.QuadPart < 0) {
+        Timer->DueTime = g_GpioModel.Now - DueTime.QuadPart;
+
+    } else {
+        Timer->DueTime = DueTime.QuadPart;
+    }
+
+    Timer->Dpc = Dpc;
+    Timer->Inserted = TRUE;
+    assert(g_GpioModel.TimerCount < GPIO_MODEL_MAX_TIMERS);
+    g_GpioModel.Timers[g_GpioModel.TimerCount] = Timer;
+    g_GpioModel.TimerCount += 1;
+    pthread_mutex_unlock(&g_GpioModelLock);
+    return Inserted;
+}
+
+BOOLEAN
+KeCancelTimer (
+    _Inout_ PKTIMER Timer
+    )
+{
+    BOOLEAN Inserted;
+
+    pthread_mutex_lock(&g_GpioModelLock);
+    Inserted = GpioModelRemoveTimer(Timer);
+    pthread_mutex_unlock(&g_GpioModelLock);
+    return Inserted;
+}
+
+VOID
+GpioModelAdvance (
+    _In_ ULONG Microseconds
+    )
+
+/*++
+
+Routine Description:
+
+    This routine moves the virtual time forward, running the DPCs of the
+    timers that expire on the way at their due time.
+
+--*/
+
+{
+    PKTIMER Expired;
+    ULONG Index;
+    LONGLONG Target;
+
+    Target = g_GpioModel.Now + (LONGLONG)Microseconds * (GPIO_MODEL_PERF_FREQUENCY / 1000000);
+    for (;;) {
+        GpioModelRunDpcs();
+
+        pthread_mutex_lock(&g_GpioModelLock);
+        Expired = NULL;
+        for (Index = 0; Index < g_GpioModel.TimerCount; Index += 1) {
+            if ((g_GpioModel.Timers[Index]->DueTime <= Target) &&
+                ((Expired == NULL) ||
+                 (g_GpioModel.Timers[Index]->DueTime < Expired->DueTime))) {
+
+                Expired = g_GpioModel.Timers[Index];
+            }
+        }
+
+        if (Expired == NULL) {
+            __atomic_store_n(&g_GpioModel.Now, Target, __ATOMIC_SEQ_CST);
+            pthread_mutex_unlock(&g_GpioModelLock);
+            break;
+        }
+
+        GpioModelRemoveTimer(Expired);
+        if (Expired->DueTime > g_GpioModel.Now) {
+            __atomic_store_n(&g_GpioModel.Now, Expired->DueTime, __ATOMIC_SEQ_CST);
+        }
+
+        pthread_mutex_unlock(&g_GpioModelLock);
+        if (Expired->Dpc != NULL) {
+            KeInsertQueueDpc(Expired->Dpc, NULL, NULL);
+        }
+    }
+}
+
+VOID
+KeInitializeSpinLock (
+    _Out_ PKSPIN_LOCK SpinLock
+    )
+{
+    *SpinLock = 0;
+}
+
+VOID
+KeAcquireSpinLockAtDpcLevel (
+    _Inout_ PKSPIN_LOCK SpinLock
+    )
+{
+    while (__atomic_exchange_n(SpinLock, 1, __ATOMIC_ACQUIRE) != 0) {
+        sched_yield();
+    }
+}
+
+VOID
+KeReleaseSpinLockFromDpcLevel (
+    _Inout_ PKSPIN_LOCK SpinLock
+    )
+{
+    __atomic_store_n(SpinLock, 0, __ATOMIC_RELEASE);
+}
+
+VOID
+KeAcquireSpinLock (
+    _Inout_ PKSPIN_LOCK SpinLock,
+    _Out_ PKIRQL OldIrql
+    )
+{
+    *OldIrql = PASSIVE_LEVEL;
+    KeAcquireSpinLockAtDpcLevel(SpinLock);
+}
+
+VOID
+KeReleaseSpinLock (
+    _Inout_ PKSPIN_LOCK SpinLock,
+    _In_ KIRQL NewIrql
+    )
+{
+    UNREFERENCED_PARAMETER(NewIrql);
+
+    KeReleaseSpinLockFromDpcLevel(SpinLock);
+}
+
+VOID
+KeInitializeEvent (
+    _Out_ PKEVENT Event,
+    _In_ EVENT_TYPE Type,
+    _In_ BOOLEAN State
+    )
+{
+    UNREFERENCED_PARAMETER(Type);
+
+    Event->State = State;
+}
+
+NTSTATUS
+KeWaitForSingleObject (
+    _In_ PVOID Object,
+    _In_ KWAIT_REASON WaitReason,
+    _In_ KPROCESSOR_MODE WaitMode,
+    _In_ BOOLEAN Alertable,
+    _In_opt_ PLARGE_INTEGER Timeout
+    )
+{
+    UNREFERENCED_PARAMETER(Object);
+    UNREFERENCED_PARAMETER(WaitReason);
+    UNREFERENCED_PARAMETER(WaitMode);
+    UNREFERENCED_PARAMETER(Alertable);
+    UNREFERENCED_PARAMETER(Timeout);
+
+    return STATUS_SUCCESS;
+}
+
+//
+// ---------------------------------------------------- ACPI, memory, registry
+//
+
+PIRP
+IoBuildDeviceIoControlRequest (
+    _In_ ULONG IoControlCode,
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _In_opt_ PVOID InputBuffer,
+    _In_ ULONG InputBufferLength,
+    _Out_opt_ PVOID OutputBuffer,
+    _In_ ULONG OutputBufferLength,
+    _In_ BOOLEAN InternalDeviceIoControl,
+    _In_opt_ PKEVENT Event,
+    _Out_ PIO_STATUS_BLOCK IoStatusBlock
+    )
+{
+    static IRP Irp;
+
+    UNREFERENCED_PARAMETER(DeviceObject);
+    UNREFERENCED_PARAMETER(InternalDeviceIoControl);
+    UNREFERENCED_PARAMETER(Event);
+
+    Irp.IoControlCode = IoControlCode;
+    Irp.InputBuffer = InputBuffer;
+    Irp.InputBufferLength = InputBufferLength;
+    Irp.OutputBuffer = OutputBuffer;
+    Irp.OutputBufferLength = OutputBufferLength;
+    Irp.IoStatus = IoStatusBlock;
+    return &Irp;
+}
+
+NTSTATUS
+IoCallDriver (
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _Inout_ PIRP Irp
+    )
+
+/*++
+
+Routine Description:
+
+    This routine answers the IDOI method the driver evaluates: the length
+    of a port block and the bank count, then the pin count and interrupt
+    capability of every pair of banks.
+
+--*/
+
+{
+    struct {
+        ACPI_EVAL_OUTPUT_BUFFER Buffer;
+        ULONG Data[7];
+    } Output;
+
+    UNREFERENCED_PARAMETER(DeviceObject);
+
+    assert(Irp->IoControlCode == IOCTL_ACPI_EVAL_METHOD);
+    assert(Irp->OutputBufferLength >= sizeof(Output));
+
+    memset(&Output, 0, sizeof(Output));
+    Output.Buffer.Signature = ACPI_EVAL_OUTPUT_BUFFER_SIGNATURE;
+    Output.Buffer.Count = 1;
+    Output.Data[0] = (GPIO_MODEL_PORT_REGISTERS * sizeof(ULONG)) | (1 << 16);
+    Output.Data[1] = g_GpioModel.PinCount | (1 << 8);
+    memcpy(Irp->OutputBuffer, &Output, sizeof(Output));
+
+    Irp->IoStatus->Status = STATUS_SUCCESS;
+    Irp->IoStatus->Information = sizeof(Output);
+    return STATUS_SUCCESS;
+}
+
+PVOID
+ExAllocatePoolWithTag (
+    _In_ POOL_TYPE PoolType,
+    _In_ SIZE_T NumberOfBytes,
+    _In_ ULONG Tag
+    )
+{
+    UNREFERENCED_PARAMETER(PoolType);
+    UNREFERENCED_PARAMETER(Tag);
+
+    return calloc(1, NumberOfBytes);
+}
+
+PVOID
+MmMapIoSpace (
+    _In_ PHYSICAL_ADDRESS PhysicalAddress,
+    _In_ SIZE_T NumberOfBytes,
+    _In_ MEMORY_CACHING_TYPE CacheType
+    )
+{
+    UNREFERENCED_PARAMETER(CacheType);
+
+    if ((PhysicalAddress.QuadPart == GPIO_MODEL_PORT_BASE) &&
+        (NumberOfBytes <= sizeof(g_GpioModel.PortBlock))) {
+
+        return g_GpioModel.PortBlock;
+    }
+
+    if ((PhysicalAddress.QuadPart == GPIO_MODEL_INT_BASE) &&
+        (NumberOfBytes <= sizeof(g_GpioModel.IntBlock))) {
+
+        return g_GpioModel.IntBlock;
+    }
+
+    return NULL;
+}
+
+VOID
+MmUnmapIoSpace (
+    _In_ PVOID BaseAddress,
+    _In_ SIZE_T NumberOfBytes
+    )
+{
+    UNREFERENCED_PARAMETER(BaseAddress);
+    UNREFERENCED_PARAMETER(NumberOfBytes);
+}
+
+ULONG
+WdfCmResourceListGetCount (
+    _In_ WDFCMRESLIST List
+    )
+{
+    UNREFERENCED_PARAMETER(List);
+
+    return GPIO_MODEL_RESOURCES;
+}
+
+PCM_PARTIAL_RESOURCE_DESCRIPTOR
+WdfCmResourceListGetDescriptor (
+    _In_ WDFCMRESLIST List,
+    _In_ ULONG Index
+    )
+{
+    UNREFERENCED_PARAMETER(List);
+
+    return &g_GpioModelResources[Index];
+}
+
+NTSTATUS
+WdfDeviceOpenRegistryKey (
+    _In_ WDFDEVICE Device,
+    _In_ ULONG DeviceInstanceKeyType,
+    _In_ ULONG DesiredAccess,
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES KeyAttributes,
+    _Out_ WDFKEY *Key
+    )
+{
+    UNREFERENCED_PARAMETER(Device);
+    UNREFERENCED_PARAMETER(DeviceInstanceKeyType);
+    UNREFERENCED_PARAMETER(DesiredAccess);
+    UNREFERENCED_PARAMETER(KeyAttributes);
+
+    *Key = (WDFKEY)&g_GpioModel;
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+WdfRegistryQueryULong (
+    _In_ WDFKEY Key,
+    _In_ PCUNICODE_STRING ValueName,
+    _Out_ PULONG Value
+    )
+{
+    UNREFERENCED_PARAMETER(Key);
+
+    if ((wcscmp(ValueName->Buffer, L"InterruptStormThreshold") == 0) &&
+        (g_GpioModel.StormThresholdPresent != FALSE)) {
+
+        *Value = g_GpioModel.StormThreshold;
+        return STATUS_SUCCESS;
+    }
+
+    if ((wcscmp(ValueName->Buffer, L"InterruptStormBackoffMs") == 0) &&
+        (g_GpioModel.StormBackoffPresent != FALSE)) {
+
+        *Value = g_GpioModel.StormBackoffMs;
+        return STATUS_SUCCESS;
+    }
+
+    return STATUS_OBJECT_NAME_NOT_FOUND;
+}
+
+VOID
+WdfRegistryClose (
+    _In_ WDFKEY Key
+    )
+{
+    UNREFERENCED_PARAMETER(Key);
+}
+
+//
+// ---------------------------------------------------- Framework and GpioClx
+//
+
+NTSTATUS
+WdfDriverCreate (
+    _In_ PDRIVER_OBJECT DriverObject,
+    _In_ PUNICODE_STRING RegistryPath,
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES DriverAttributes,
+    _In_ PWDF_DRIVER_CONFIG DriverConfig,
+    _Out_opt_ WDFDRIVER *Driver
+    )
+{
+    UNREFERENCED_PARAMETER(DriverObject);
+    UNREFERENCED_PARAMETER(RegistryPath);
+    UNREFERENCED_PARAMETER(DriverAttributes);
+    UNREFERENCED_PARAMETER(DriverConfig);
+
+    if (Driver != NULL) {
+        *Driver = (WDFDRIVER)&g_GpioModel;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+WdfDeviceCreate (
+    _Inout_ PWDFDEVICE_INIT *DeviceInit,
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES DeviceAttributes,
+    _Out_ WDFDEVICE *Device
+    )
+{
+    UNREFERENCED_PARAMETER(DeviceInit);
+    UNREFERENCED_PARAMETER(DeviceAttributes);
+
+    *Device = (WDFDEVICE)&g_GpioModel;
+    return STATUS_SUCCESS;
+}
+
+VOID
+WdfControlFinishInitializing (
+    _In_ WDFDEVICE Device
+    )
+{
+    UNREFERENCED_PARAMETER(Device);
+}
+
+PDEVICE_OBJECT
+WdfDeviceWdmGetPhysicalDevice (
+    _In_ WDFDEVICE Device
+    )
+{
+    UNREFERENCED_PARAMETER(Device);
+
+    return (PDEVICE_OBJECT)&g_GpioModel;
+}
+
+NTSTATUS
+GPIO_CLX_RegisterClient (
+    _In_ WDFDRIVER Driver,
+    _In_ PGPIO_CLIENT_REGISTRATION_PACKET RegistrationPacket,
+    _In_ PUNICODE_STRING RegistryPath
+    )
+{
+    UNREFERENCED_PARAMETER(Driver);
+    UNREFERENCED_PARAMETER(RegistryPath);
+
+    g_GpioModel.Client = *RegistrationPacket;
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+GPIO_CLX_UnregisterClient (
+    _In_ WDFDRIVER Driver
+    )
+{
+    UNREFERENCED_PARAMETER(Driver);
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+GPIO_CLX_ProcessAddDevicePreDeviceCreate (
+    _In_ WDFDRIVER Driver,
+    _Inout_ PWDFDEVICE_INIT DeviceInit,
+    _Out_ PWDF_OBJECT_ATTRIBUTES FdoAttributes
+    )
+{
+    UNREFERENCED_PARAMETER(Driver);
+    UNREFERENCED_PARAMETER(DeviceInit);
+
+    memset(FdoAttributes, 0, sizeof(*FdoAttributes));
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+GPIO_CLX_ProcessAddDevicePostDeviceCreate (
+    _In_ WDFDRIVER Driver,
+    _In_ WDFDEVICE Device
+    )
+{
+    UNREFERENCED_PARAMETER(Driver);
+    UNREFERENCED_PARAMETER(Device);
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+GPIO_CLX_AcquireInterruptLock (
+    _In_ PVOID Context,
+    _In_ BANK_ID BankId
+    )
+{
+    UNREFERENCED_PARAMETER(Context);
+
+    assert(BankId == 0);
+    pthread_mutex_lock(&g_GpioModelInterruptLock);
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+GPIO_CLX_ReleaseInterruptLock (
+    _In_ PVOID Context,
+    _In_ BANK_ID BankId
+    )
+{
+    UNREFERENCED_PARAMETER(Context);
+
+    assert(BankId == 0);
+    pthread_mutex_unlock(&g_GpioModelInterruptLock);
+    return STATUS_SUCCESS;
+}
+
+//
+// ---------------------------------------------------------- Client requests
+//
+
+VOID
+GpioModelRelease (
+    VOID
+    )
+{
+    if (g_GpioModel.Context != NULL) {
+        (VOID)g_GpioModel.Client.CLIENT_ReleaseController((WDFDEVICE)&g_GpioModel,
+                                                          g_GpioModel.Context);
+
+        free(g_GpioModel.Context);
+        g_GpioModel.Context = NULL;
+    }
+}
+
+NTSTATUS
+GpioModelReset (
+    _In_ ULONG PinCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine releases the previous client, resets the port and brings
+    a new client up the way the class extension does: DriverEntry, prepare
+    with the port and interrupt blocks, basic information and a first start.
+    The device parameters are kept.
+
+--*/
+
+{
+    CLIENT_CONTROLLER_BASIC_INFORMATION Information;
+    GPIO_MODEL Parameters;
+    NTSTATUS Status;
+
+    GpioModelRelease();
+
+    Parameters = g_GpioModel;
+    memset(&g_GpioModel, 0, sizeof(g_GpioModel));
+    g_GpioModel.StormThresholdPresent = Parameters.StormThresholdPresent;
+    g_GpioModel.StormThreshold = Parameters.StormThreshold;
+    g_GpioModel.StormBackoffPresent = Parameters.StormBackoffPresent;
+    g_GpioModel.StormBackoffMs = Parameters.StormBackoffMs;
+    g_GpioModel.PinCount = PinCount;
+    g_GpioModel.Now = GPIO_MODEL_PERF_FREQUENCY;
+    GpioModelPowerLoss();
+
+    memset(g_GpioModelResources, 0, sizeof(g_GpioModelResources));
+    g_GpioModelResources[0].Type = CmResourceTypeMemory;
+    g_GpioModelResources[0].u.Memory.Start.QuadPart = GPIO_MODEL_PORT_BASE;
+    g_GpioModelResources[0].u.Memory.Length = sizeof(g_GpioModel.PortBlock);
+    g_GpioModelResources[1].Type = CmResourceTypeMemory;
+    g_GpioModelResources[1].u.Memory.Start.QuadPart = GPIO_MODEL_INT_BASE;
+    g_GpioModelResources[1].u.Memory.Length = sizeof(g_GpioModel.IntBlock);
+    g_GpioModelResources[2].Type = CmResourceTypeInterrupt;
+
+    Status = DriverEntry(NULL, NULL);
+    if (!NT_SUCCESS(Status)) {
+        return Status;
+    }
+
+    g_GpioModel.Context = calloc(1, g_GpioModel.Client.ControllerContextSize);
+    Status = g_GpioModel.Client.CLIENT_PrepareController((WDFDEVICE)&g_GpioModel,
+                                                         g_GpioModel.Context,
+                                                         NULL,
+                                                         NULL);
+
+    if (!NT_SUCCESS(Status)) {
+        return Status;
+    }
+
+    Status = g_GpioModel.Client.CLIENT_QueryControllerBasicInformation(g_GpioModel.Context,
+                                                                       &Information);
+
+    if (!NT_SUCCESS(Status)) {
+        return Status;
+    }
+
+    if ((Information.TotalPins != PinCount) ||
+        (Information.Flags.FormatIoRequestsAsMasks == 0)) {
+
+        return STATUS_UNSUCCESSFUL;
+    }
+
+    return GpioModelStart(FALSE);
+}
+
+NTSTATUS
+GpioModelStop (
+    _In_ BOOLEAN SaveContext
+    )
+{
+    return g_GpioModel.Client.CLIENT_StopController(g_GpioModel.Context,
+                                                    SaveContext,
+                                                    WdfPowerDeviceD3);
+}
+
+NTSTATUS
+GpioModelStart (
+    _In_ BOOLEAN RestoreContext
+    )
+{
+    return g_GpioModel.Client.CLIENT_StartController(g_GpioModel.Context,
+                                                     RestoreContext,
+                                                     WdfPowerDeviceD3);
+}
+
+NTSTATUS
+GpioModelConnect (
+    _In_ GPIO_CONNECT_IO_PINS_MODE ConnectMode,
+    _In_ PPIN_NUMBER PinNumberTable,
+    _In_ ULONG PinCount,
+    _In_ UCHAR PullConfiguration,
+    _In_ USHORT DriveStrength
+    )
+{
+    GPIO_CONNECT_IO_PINS_PARAMETERS Parameters;
+    NTSTATUS Status;
+
+    memset(&Parameters, 0, sizeof(Parameters));
+    Parameters.PinNumberTable = PinNumberTable;
+    Parameters.PinCount = PinCount;
+    Parameters.ConnectMode = ConnectMode;
+    Parameters.PullConfiguration = PullConfiguration;
+    Parameters.DriveStrength = DriveStrength;
+
+    pthread_mutex_lock(&g_GpioModelIoLock);
+    Status = g_GpioModel.Client.CLIENT_ConnectIoPins(g_GpioModel.Context, &Parameters);
+    pthread_mutex_unlock(&g_GpioModelIoLock);
+    return Status;
+}
+
+NTSTATUS
+GpioModelDisconnect (
+    _In_ PPIN_NUMBER PinNumberTable,
+    _In_ ULONG PinCount,
+    _In_ BOOLEAN PreserveConfiguration
+    )
+{
+    GPIO_DISCONNECT_IO_PINS_PARAMETERS Parameters;
+    NTSTATUS Status;
+
+    memset(&Parameters, 0, sizeof(Parameters));
+    Parameters.PinNumberTable = PinNumberTable;
+    Parameters.PinCount = PinCount;
+    Parameters.DisconnectFlags.PreserveConfiguration = (PreserveConfiguration != FALSE);
+
+    pthread_mutex_lock(&g_GpioModelIoLock);
+    Status = g_GpioModel.Client.CLIENT_DisconnectIoPins(g_GpioModel.Context, &Parameters);
+    pthread_mutex_unlock(&g_GpioModelIoLock);
+    return Status;
+}
+
+NTSTATUS
+GpioModelWrite (
+    _In_ ULONG SetMask,
+    _In_ ULONG ClearMask
+    )
+{
+    GPIO_WRITE_PINS_MASK_PARAMETERS Parameters;
+    NTSTATUS Status;
+
+    memset(&Parameters, 0, sizeof(Parameters));
+    Parameters.SetMask = SetMask;
+    Parameters.ClearMask = ClearMask;
+
+    pthread_mutex_lock(&g_GpioModelIoLock);
+    Status = g_GpioModel.Client.CLIENT_WriteGpioPinsUsingMask(g_GpioModel.Context, &Parameters);
+    pthread_mutex_unlock(&g_GpioModelIoLock);
+    return Status;
+}
+
+ULONG
+GpioModelRead (
+    _In_ BOOLEAN WriteConfiguredPins
+    )
+{
+    GPIO_READ_PINS_MASK_PARAMETERS Parameters;
+    ULONG64 PinValues;
+
+    memset(&Parameters, 0, sizeof(Parameters));
+    PinValues = 0;
+    Parameters.PinValues = &PinValues;
+    Parameters.Flags.WriteConfiguredPins = (WriteConfiguredPins != FALSE);
+
+    pthread_mutex_lock(&g_GpioModelIoLock);
+    (VOID)g_GpioModel.Client.CLIENT_ReadGpioPinsUsingMask(g_GpioModel.Context, &Parameters);
+    pthread_mutex_unlock(&g_GpioModelIoLock);
+    return (ULONG)PinValues;
+}
+
+NTSTATUS
+GpioModelEnableInterrupt (
+    _In_ PIN_NUMBER PinNumber,
+    _In_ KINTERRUPT_MODE InterruptMode,
+    _In_ KINTERRUPT_POLARITY Polarity
+    )
+{
+    GPIO_ENABLE_INTERRUPT_PARAMETERS Parameters;
+    NTSTATUS Status;
+
+    memset(&Parameters, 0, sizeof(Parameters));
+    Parameters.PinNumber = PinNumber;
+    Parameters.InterruptMode = InterruptMode;
+    Parameters.Polarity = Polarity;
+
+    pthread_mutex_lock(&g_GpioModelIoLock);
+    Status = g_GpioModel.Client.CLIENT_EnableInterrupt(g_GpioModel.Context, &Parameters);
+    pthread_mutex_unlock(&g_GpioModelIoLock);
+    return Status;
+}
+
+NTSTATUS
+GpioModelDisableInterrupt (
+    _In_ PIN_NUMBER PinNumber
+    )
+{
+    GPIO_DISABLE_INTERRUPT_PARAMETERS Parameters;
+    NTSTATUS Status;
+
+    memset(&Parameters, 0, sizeof(Parameters));
+    Parameters.PinNumber = PinNumber;
+
+    pthread_mutex_lock(&g_GpioModelIoLock);
+    Status = g_GpioModel.Client.CLIENT_DisableInterrupt(g_GpioModel.Context, &Parameters);
+    pthread_mutex_unlock(&g_GpioModelIoLock);
+    return Status;
+}
+
+VOID
+GpioModelMask (
+    _In_ ULONG PinMask
+    )
+{
+    GPIO_MASK_INTERRUPT_PARAMETERS Parameters;
+
+    memset(&Parameters, 0, sizeof(Parameters));
+    Parameters.PinMask = PinMask;
+
+    GPIO_CLX_AcquireInterruptLock(g_GpioModel.Context, 0);
+    (VOID)g_GpioModel.Client.CLIENT_MaskInterrupts(g_GpioModel.Context, &Parameters);
+    GPIO_CLX_ReleaseInterruptLock(g_GpioModel.Context, 0);
+}
+
+VOID
+GpioModelUnmask (
+    _In_ PIN_NUMBER PinNumber
+    )
+{
+    GPIO_ENABLE_INTERRUPT_PARAMETERS Parameters;
+
+    memset(&Parameters, 0, sizeof(Parameters));
+    Parameters.PinNumber = PinNumber;
+    Parameters.InterruptMode = Latched;
+    Parameters.Polarity = InterruptActiveHigh;
+
+    GPIO_CLX_AcquireInterruptLock(g_GpioModel.Context, 0);
+    (VOID)g_GpioModel.Client.CLIENT_UnmaskInterrupt(g_GpioModel.Context, &Parameters);
+    GPIO_CLX_ReleaseInterruptLock(g_GpioModel.Context, 0);
+}
+
+ULONG
+GpioModelInterrupt (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine services the bank interrupt like the class extension ISR:
+    with the interrupt lock held it queries the enabled and active
+    interrupts and clears the active ones that are enabled.
+
+Return Value:
+
+    The interrupts serviced.
+
+--*/
+
+{
+    GPIO_QUERY_ACTIVE_INTERRUPTS_PARAMETERS Active;
+    GPIO_CLEAR_ACTIVE_INTERRUPTS_PARAMETERS Clear;
+    GPIO_QUERY_ENABLED_INTERRUPTS_PARAMETERS Enabled;
+    ULONG Serviced;
+
+    memset(&Enabled, 0, sizeof(Enabled));
+    memset(&Active, 0, sizeof(Active));
+    memset(&Clear, 0, sizeof(Clear));
+
+    GPIO_CLX_AcquireInterruptLock(g_GpioModel.Context, 0);
+
+    (VOID)g_GpioModel.Client.CLIENT_QueryEnabledInterrupts(g_GpioModel.Context, &Enabled);
+    Active.EnabledMask = Enabled.EnabledMask;
+    (VOID)g_GpioModel.Client.CLIENT_QueryActiveInterrupts(g_GpioModel.Context, &Active);
+
+    Serviced = (ULONG)(Active.ActiveMask & Enabled.EnabledMask);
+    if (Serviced != 0) {
+        Clear.ClearActiveMask = Serviced;
+        (VOID)g_GpioModel.Client.CLIENT_ClearActiveInterrupts(g_GpioModel.Context, &Clear);
+    }
+
+    GPIO_CLX_ReleaseInterruptLock(g_GpioModel.Context, 0);
+    return Serviced;
+}
+
+NTSTATUS
+GpioModelControllerFunction (
+    _In_ PSUNXI_GPIO_FUNCTION_INPUT Input,
+    _Out_opt_ PVOID OutputBuffer,
+    _In_ SIZE_T OutputBufferLength,
+    _Out_opt_ PULONG_PTR BytesWritten
+    )
+{
+    GPIO_CLIENT_CONTROLLER_SPECIFIC_FUNCTION_PARAMETERS Parameters;
+    NTSTATUS Status;
+
+    memset(&Parameters, 0, sizeof(Parameters));
+    Parameters.InputBuffer = Input;
+    Parameters.InputBufferLength = sizeof(*Input);
+    Parameters.OutputBuffer = OutputBuffer;
+    Parameters.OutputBufferLength = OutputBufferLength;
+
+    Status = g_GpioModel.Client.CLIENT_ControllerSpecificFunction(g_GpioModel.Context,
+                                                                  &Parameters);
+
+    if (BytesWritten != NULL) {
+        *BytesWritten = Parameters.BytesWritten;
+    }
+
+    return Status;
+}
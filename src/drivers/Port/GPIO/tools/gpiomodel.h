@@ -0,0 +1,260 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	gpiomodel.h
+
+Abstract:
+
+	Host model of one sunxi GPIO port and of the parts of the GPIO class
+	extension sunxigpio.c relies on, used to run the unmodified driver in
+	user mode. READ_REGISTER_ULONG and WRITE_REGISTER_ULONG accesses to
+	the port and interrupt blocks are routed to the model, which counts
+	them and behaves like the hardware for the bits the driver relies on:
+
+		PnDat     output pins read back the output latch, the others
+		          the level driven onto them (InputLevels).
+		PnIntSta  write-1-to-clear. A pin configured as external
+		          interrupt (function 6) latches its status when
+		          GpioModelAssert raises it.
+
+	The other registers keep the value written. GpioModelPowerLoss puts
+	every register back to its reset value.
+
+	DriverEntry hands the registration packet to the model, which then
+	calls the client like the class extension does: the I/O callbacks
+	(connect, disconnect, read, write) are serialized by a passive bank
+	lock, the interrupt callbacks run under the interrupt lock the driver
+	also takes with GPIO_CLX_AcquireInterruptLock. The controller has a
+	single bank, as PrepareController only maps bank 0.
+
+	Time is virtual. KeQueryPerformanceCounter returns GpioModelNow and
+	DPCs and timers only run from GpioModelAdvance and GpioModelRunDpcs.
+
+Environment:
+
+	user mode
+
+--*/
+
+#ifndef _GPIOMODEL_H_
+#define _GPIOMODEL_H_
+
+#include <ntddk.h>
+#include <wdf.h>
+#include <gpioclx.h>
+
+#include "sunxigpioioctl.h"
+
+#define GPIO_MODEL_PORT_REGISTERS       9
+#define GPIO_MODEL_INT_REGISTERS        7
+#define GPIO_MODEL_REGISTERS            (GPIO_MODEL_PORT_REGISTERS + GPIO_MODEL_INT_REGISTERS)
+#define GPIO_MODEL_PERF_FREQUENCY       10000000
+#define GPIO_MODEL_MAX_DPCS             8
+#define GPIO_MODEL_MAX_TIMERS           4
+
+//
+// Index of each register in the content and counter arrays.
+//
+
+#define GPIO_MODEL_PNCFG0               0
+#define GPIO_MODEL_PNDAT                4
+#define GPIO_MODEL_PNDRV0               5
+#define GPIO_MODEL_PNPUL0               7
+#define GPIO_MODEL_PNINTCFG0            9
+#define GPIO_MODEL_PNINTCTL             13
+#define GPIO_MODEL_PNINTSTA             14
+#define GPIO_MODEL_PNINTDEB             15
+
+typedef struct _GPIO_MODEL {
+
+    //
+    // The blocks handed to the driver by MmMapIoSpace, their contents are
+    // never used, only the addresses.
+    //
+
+    ULONG PortBlock[GPIO_MODEL_PORT_REGISTERS];
+    ULONG IntBlock[GPIO_MODEL_INT_REGISTERS];
+
+    //
+    // Register contents, PnDat holds the output latch.
+    //
+
+    ULONG Registers[GPIO_MODEL_REGISTERS];
+    ULONG InputLevels;
+    ULONG PinCount;
+
+    //
+    // MMIO counters, updated atomically.
+    //
+
+    ULONG Reads[GPIO_MODEL_REGISTERS];
+    ULONG Writes[GPIO_MODEL_REGISTERS];
+
+    //
+    // The client driver as registered by DriverEntry.
+    //
+
+    GPIO_CLIENT_REGISTRATION_PACKET Client;
+    PVOID Context;
+
+    //
+    // Device parameters, a value is only present if its flag is set.
+    //
+
+    BOOLEAN StormThresholdPresent;
+    ULONG StormThreshold;
+    BOOLEAN StormBackoffPresent;
+    ULONG StormBackoffMs;
+
+    //
+    // Virtual time in performance counter ticks, queued DPCs and armed
+    // timers.
+    //
+
+    LONGLONG Now;
+    PKDPC Dpcs[GPIO_MODEL_MAX_DPCS];
+    ULONG DpcCount;
+    PKTIMER Timers[GPIO_MODEL_MAX_TIMERS];
+    ULONG TimerCount;
+    ULONG DpcsRun;
+} GPIO_MODEL, *PGPIO_MODEL;
+
+extern GPIO_MODEL g_GpioModel;
+
+NTSTATUS
+GpioModelReset (
+    _In_ ULONG PinCount
+    );
+
+VOID
+GpioModelClearCounters (
+    VOID
+    );
+
+ULONG
+GpioModelMmioReads (
+    VOID
+    );
+
+ULONG
+GpioModelMmioWrites (
+    VOID
+    );
+
+VOID
+GpioModelPowerLoss (
+    VOID
+    );
+
+NTSTATUS
+GpioModelStop (
+    _In_ BOOLEAN SaveContext
+    );
+
+NTSTATUS
+GpioModelStart (
+    _In_ BOOLEAN RestoreContext
+    );
+
+NTSTATUS
+GpioModelConnect (
+    _In_ GPIO_CONNECT_IO_PINS_MODE ConnectMode,
+    _In_ PPIN_NUMBER PinNumberTable,
+    _In_ ULONG PinCount,
+    _In_ UCHAR PullConfiguration,
+    _In_ USHORT DriveStrength
+    );
+
+NTSTATUS
+GpioModelDisconnect (
+    _In_ PPIN_NUMBER PinNumberTable,
+    _In_ ULONG PinCount,
+    _In_ BOOLEAN PreserveConfiguration
+    );
+
+NTSTATUS
+GpioModelWrite (
+    _In_ ULONG SetMask,
+    _In_ ULONG ClearMask
+    );
+
+ULONG
+GpioModelRead (
+    _In_ BOOLEAN WriteConfiguredPins
+    );
+
+NTSTATUS
+GpioModelEnableInterrupt (
+    _In_ PIN_NUMBER PinNumber,
+    _In_ KINTERRUPT_MODE InterruptMode,
+    _In_ KINTERRUPT_POLARITY Polarity
+    );
+
+NTSTATUS
+GpioModelDisableInterrupt (
+    _In_ PIN_NUMBER PinNumber
+    );
+
+VOID
+GpioModelMask (
+    _In_ ULONG PinMask
+    );
+
+VOID
+GpioModelUnmask (
+    _In_ PIN_NUMBER PinNumber
+    );
+
+VOID
+GpioModelAssert (
+    _In_ ULONG PinMask
+    );
+
+ULONG
+GpioModelInterrupt (
+    VOID
+    );
+
+NTSTATUS
+GpioModelControllerFunction (
+    _In_ PSUNXI_GPIO_FUNCTION_INPUT Input,
+    _Out_opt_ PVOID OutputBuffer,
+    _In_ SIZE_T OutputBufferLength,
+    _Out_opt_ PULONG_PTR BytesWritten
+    );
+
+VOID
+GpioModelRunDpcs (
+    VOID
+    );
+
+VOID
+GpioModelAdvance (
+    _In_ ULONG Microseconds
+    );
+
+VOID
+GpioModelRelease (
+    VOID
+    );
+
+#endif // _GPIOMODEL_H_
@@ -0,0 +1,232 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	gpiorestore.c
+
+Abstract:
+
+	Checks the bank context save and restore of sunxigpio.c on the GPIO
+	model (gpiomodel.c). The bank is configured with outputs, inputs and
+	an enabled interrupt, then stopped and started again. Prints the
+	register accesses of each save and restore:
+
+		kept        the bank kept its context, the restore reads
+		            every register and writes none of them
+		changed     registers another driver changed while the bank
+		            ran, such as a pin function muxed by the
+		            Ethernet MAC, are saved and kept, nothing is
+		            written back
+		power loss  the bank lost its context, every register is
+		            restored to its value at the stop, the changed
+		            ones included
+		status      an interrupt latched in the write-one-to-clear
+		            status register before the stop is still
+		            pending after the start, the status register is
+		            never written
+
+	Build and use on any host with a C compiler:
+
+		cc -O2 -I../../../../tools/host -I.. -o gpiorestore gpiorestore.c gpiomodel.c ../sunxigpio.c -lpthread
+		gpiorestore
+
+Environment:
+
+	user mode
+
+--*/
+
+#include <stdio.h>
+
+#include "gpiomodel.h"
+
+#define INTERRUPT_PIN           20
+
+static int g_Failures;
+static ULONG g_SaveReads;
+
+static VOID
+Check (
+    _In_ BOOLEAN Condition,
+    _In_ const char *Case,
+    _In_ const char *What
+    )
+{
+    if (!Condition) {
+        printf("FAIL %s: %s\n", Case, What);
+        g_Failures += 1;
+    }
+}
+
+static VOID
+Configure (
+    VOID
+    )
+{
+    PIN_NUMBER Inputs[8];
+    PIN_NUMBER Outputs[8];
+    ULONG Index;
+
+    for (Index = 0; Index < 8; Index += 1) {
+        Outputs[Index] = Index;
+        Inputs[Index] = 8 + Index;
+    }
+
+    Check(NT_SUCCESS(GpioModelConnect(ConnectModeOutput, Outputs, 8, 1, 75)),
+          "setup", "outputs connected");
+
+    Check(NT_SUCCESS(GpioModelConnect(ConnectModeInput, Inputs, 8, 0, 0)),
+          "setup", "inputs connected");
+
+    Check(NT_SUCCESS(GpioModelEnableInterrupt(INTERRUPT_PIN, Latched, InterruptActiveHigh)),
+          "setup", "interrupt enabled");
+
+    Check(NT_SUCCESS(GpioModelWrite(0xa5, 0)), "setup", "outputs written");
+}
+
+static BOOLEAN
+SameRegisters (
+    _In_ PULONG Expected
+    )
+{
+    ULONG Index;
+
+    for (Index = 0; Index < GPIO_MODEL_REGISTERS; Index += 1) {
+        if ((Index != GPIO_MODEL_PNINTSTA) &&
+            (g_GpioModel.Registers[Index] != Expected[Index])) {
+
+            printf("  register %2lu is 0x%08lx, expected 0x%08lx\n",
+                   (unsigned long)Index,
+                   (unsigned long)g_GpioModel.Registers[Index],
+                   (unsigned long)Expected[Index]);
+
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static VOID
+Restart (
+    _In_ BOOLEAN PowerLoss
+    )
+{
+    GpioModelClearCounters();
+    Check(NT_SUCCESS(GpioModelStop(TRUE)), "restart", "stopped");
+    g_SaveReads = GpioModelMmioReads();
+    if (PowerLoss != FALSE) {
+        GpioModelPowerLoss();
+    }
+
+    GpioModelClearCounters();
+    Check(NT_SUCCESS(GpioModelStart(TRUE)), "restart", "started");
+}
+
+static VOID
+Report (
+    _In_ const char *Case
+    )
+{
+    printf("%-36s save %2lu reads, restore %2lu reads, %2lu writes\n",
+           Case,
+           (unsigned long)g_SaveReads,
+           (unsigned long)GpioModelMmioReads(),
+           (unsigned long)GpioModelMmioWrites());
+}
+
+static VOID
+TestRestore (
+    VOID
+    )
+{
+    ULONG Changed[GPIO_MODEL_REGISTERS];
+    ULONG Configured[GPIO_MODEL_REGISTERS];
+
+    Check(NT_SUCCESS(GpioModelReset(32)), "setup", "controller started");
+    Configure();
+    memcpy(Configured, g_GpioModel.Registers, sizeof(Configured));
+
+    //
+    // Every stop reads the context again.
+    //
+
+    Restart(FALSE);
+    Check(GpioModelMmioWrites() == 0, "kept", "nothing written");
+    Check(SameRegisters(Configured), "kept", "registers unchanged");
+    Report("bank kept its context:");
+
+    Restart(FALSE);
+    Check(GpioModelMmioWrites() == 0, "kept", "nothing written the second time");
+
+    //
+    // Another driver muxes pins of the bank, and sets registers back to
+    // their reset values, while the bank runs.
+    //
+
+    g_GpioModel.Registers[GPIO_MODEL_PNPUL0 + 1] = 0x00000055;
+    g_GpioModel.Registers[GPIO_MODEL_PNCFG0 + 3] = 0x11111122;
+    g_GpioModel.Registers[GPIO_MODEL_PNINTCFG0 + 3] = 0x00000010;
+    g_GpioModel.Registers[GPIO_MODEL_PNDRV0] = 0x55555555;
+    memcpy(Changed, g_GpioModel.Registers, sizeof(Changed));
+
+    Restart(FALSE);
+    Check(SameRegisters(Changed), "changed", "changes kept");
+    Check(GpioModelMmioWrites() == 0, "changed", "nothing written back");
+    Report("registers changed by another driver:");
+
+    Restart(TRUE);
+    Check(SameRegisters(Changed), "power loss", "registers restored with the changes");
+    Check(g_GpioModel.Writes[GPIO_MODEL_PNCFG0 + 3] == 1, "power loss", "muxed configuration written");
+    Check(g_GpioModel.Writes[GPIO_MODEL_PNINTSTA] == 0, "power loss", "status not written");
+    Report("bank lost its context:");
+
+    //
+    // An interrupt raised while the bank is being stopped stays pending.
+    //
+
+    GpioModelAssert(1 << INTERRUPT_PIN);
+    Restart(FALSE);
+    Check(g_GpioModel.Writes[GPIO_MODEL_PNINTSTA] == 0, "status", "status not written");
+    Check((g_GpioModel.Registers[GPIO_MODEL_PNINTSTA] & (1 << INTERRUPT_PIN)) != 0,
+          "status", "interrupt still pending");
+
+    Check(GpioModelInterrupt() == (1 << INTERRUPT_PIN), "status", "interrupt serviced after the start");
+    Check(g_GpioModel.Registers[GPIO_MODEL_PNINTSTA] == 0, "status", "status cleared by the ISR");
+
+    GpioModelRelease();
+}
+
+int
+main (
+    VOID
+    )
+{
+    TestRestore();
+
+    if (g_Failures != 0) {
+        printf("%d check(s) failed\n", g_Failures);
+        return 1;
+    }
+
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,638 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	gpiostorm.c
+
+Abstract:
+
+	Simulates interrupt bursts on the GPIO model (gpiomodel.c) and checks
+	the storm throttling of sunxigpio.c against its policy, a threshold
+	in interrupts per second and a back-off in milliseconds. Time is
+	virtual and moves in 100us ticks, every tick raises the interrupts
+	that are due and runs the ISR once.
+
+		registry    the policy read from the device parameters. A
+		            steady source and a short burst under the threshold
+		            are never throttled. A storm is masked after at
+		            most threshold + 1 interrupts, stays masked for the
+		            back-off and is serviced again once it expires.
+		ioctl       SET_STORM_POLICY takes effect on the next storm, a
+		            zero back-off keeps the current one and a zero
+		            threshold turns the throttling off
+		disable     a pin disabled while throttled is not unmasked when
+		            its back-off expires
+		staggered   two pins throttled at different times are each
+		            released after their own back-off
+		stop        the controller is stopped while one pin waits for
+		            its back-off and another was just throttled. No
+		            timer is left armed and no register is written
+		            until it starts again, which releases both.
+		policy      the policy is changed while another thread queries
+		            it and a third one services a storm. Every query
+		            must return a threshold and a back-off that were
+		            set together.
+
+	The statistics the driver keeps must agree with what the simulation
+	saw: interrupt and throttle counts, and the rate of a steady source.
+
+	Build and use on any host with a C compiler:
+
+		cc -O2 -I../../../../tools/host -I.. -o gpiostorm gpiostorm.c gpiomodel.c ../sunxigpio.c -lpthread
+		gpiostorm
+
+Environment:
+
+	user mode
+
+--*/
+
+#include <pthread.h>
+#include <stdio.h>
+
+#include "gpiomodel.h"
+
+#define TICK_US                 100
+#define MAX_SOURCES             4
+#define POLICY_CHANGES          200000
+
+#define STORM_PIN               20
+#define STEADY_PIN              21
+#define BURST_PIN               22
+#define SECOND_STORM_PIN        23
+
+//
+// An interrupt source raising its pin every PeriodUs from StartUs until
+// StopUs, or Count times if Count is not zero.
+//
+
+typedef struct _SOURCE {
+    PIN_NUMBER Pin;
+    ULONG PeriodUs;
+    ULONG StartUs;
+    ULONG StopUs;
+    ULONG Count;
+
+    //
+    // What the simulation saw.
+    //
+
+    ULONG NextUs;
+    ULONG Generated;
+    ULONG Serviced;
+    ULONG Throttles;
+    ULONG MaskedSinceUs;
+    ULONG MinMaskedUs;
+    ULONG MaxMaskedUs;
+    ULONG ServicedSinceUnmask;
+    ULONG MaxServicedPerRun;
+    ULONG ServicedWhileMasked;
+    BOOLEAN Masked;
+} SOURCE, *PSOURCE;
+
+typedef struct _POLICY_RACE {
+    volatile int Done;
+    ULONG Queries;
+    ULONG Torn;
+    ULONG Serviced;
+} POLICY_RACE, *PPOLICY_RACE;
+
+static int g_Failures;
+static ULONG g_NowUs;
+
+static VOID
+Check (
+    _In_ BOOLEAN Condition,
+    _In_ const char *Case,
+    _In_ const char *What
+    )
+{
+    if (!Condition) {
+        printf("FAIL %s: %s\n", Case, What);
+        g_Failures += 1;
+    }
+}
+
+static VOID
+InitializeSource (
+    _Out_ PSOURCE Source,
+    _In_ PIN_NUMBER Pin,
+    _In_ ULONG PeriodUs,
+    _In_ ULONG StartUs,
+    _In_ ULONG StopUs,
+    _In_ ULONG Count
+    )
+{
+    memset(Source, 0, sizeof(*Source));
+    Source->Pin = Pin;
+    Source->PeriodUs = PeriodUs;
+    Source->StartUs = g_NowUs + StartUs;
+    Source->StopUs = (StopUs == MAXULONG) ? MAXULONG : g_NowUs + StopUs;
+    Source->Count = Count;
+    Source->NextUs = Source->StartUs;
+    Source->MinMaskedUs = MAXULONG;
+}
+
+static BOOLEAN
+Enabled (
+    _In_ PIN_NUMBER Pin
+    )
+{
+    return (g_GpioModel.Registers[GPIO_MODEL_PNINTCTL] & (1 << Pin)) != 0;
+}
+
+static VOID
+Simulate (
+    _Inout_ PSOURCE Sources,
+    _In_ ULONG SourceCount,
+    _In_ ULONG DurationUs
+    )
+
+/*++
+
+Routine Description:
+
+    This routine runs the sources for the given time. A pin the ISR leaves
+    disabled was throttled, the simulation never masks or disables a pin
+    itself while it runs.
+
+--*/
+
+{
+    ULONG Asserted;
+    ULONG EnabledBefore;
+    ULONG EndUs;
+    ULONG Index;
+    ULONG Mask;
+    ULONG MaskedUs;
+    PSOURCE Source;
+    ULONG Serviced;
+
+    EndUs = g_NowUs + DurationUs;
+    while (g_NowUs < EndUs) {
+        Asserted = 0;
+        for (Index = 0; Index < SourceCount; Index += 1) {
+            Source = &Sources[Index];
+            if ((g_NowUs >= Source->NextUs) &&
+                (g_NowUs < Source->StopUs) &&
+                ((Source->Count == 0) || (Source->Generated < Source->Count))) {
+
+                Asserted |= 1 << Source->Pin;
+                Source->Generated += 1;
+                Source->NextUs += Source->PeriodUs;
+            }
+        }
+
+        GpioModelAssert(Asserted);
+        EnabledBefore = g_GpioModel.Registers[GPIO_MODEL_PNINTCTL];
+        Serviced = GpioModelInterrupt();
+
+        for (Index = 0; Index < SourceCount; Index += 1) {
+            Source = &Sources[Index];
+            Mask = 1 << Source->Pin;
+            if ((Serviced & Mask) != 0) {
+                Source->Serviced += 1;
+                Source->ServicedSinceUnmask += 1;
+                if ((EnabledBefore & Mask) == 0) {
+                    Source->ServicedWhileMasked += 1;
+                }
+            }
+
+            if ((Source->Masked == FALSE) && !Enabled(Source->Pin)) {
+                Source->Masked = TRUE;
+                Source->Throttles += 1;
+                Source->MaskedSinceUs = g_NowUs;
+                if (Source->ServicedSinceUnmask > Source->MaxServicedPerRun) {
+                    Source->MaxServicedPerRun = Source->ServicedSinceUnmask;
+                }
+            }
+        }
+
+        //
+        // The back-off timer runs during the tick, a pin it releases is
+        // seen at the end of the tick.
+        //
+
+        GpioModelAdvance(TICK_US);
+        g_NowUs += TICK_US;
+
+        for (Index = 0; Index < SourceCount; Index += 1) {
+            Source = &Sources[Index];
+            if ((Source->Masked != FALSE) && Enabled(Source->Pin)) {
+                Source->Masked = FALSE;
+                Source->ServicedSinceUnmask = 0;
+                MaskedUs = g_NowUs - Source->MaskedSinceUs;
+                if (MaskedUs < Source->MinMaskedUs) {
+                    Source->MinMaskedUs = MaskedUs;
+                }
+
+                if (MaskedUs > Source->MaxMaskedUs) {
+                    Source->MaxMaskedUs = MaskedUs;
+                }
+            }
+        }
+    }
+}
+
+static NTSTATUS
+SetPolicy (
+    _In_ ULONG Threshold,
+    _In_ ULONG BackoffMs
+    )
+{
+    SUNXI_GPIO_FUNCTION_INPUT Input;
+
+    memset(&Input, 0, sizeof(Input));
+    Input.Function = SUNXI_GPIO_FUNCTION_SET_STORM_POLICY;
+    Input.StormThreshold = Threshold;
+    Input.StormBackoffMs = BackoffMs;
+    return GpioModelControllerFunction(&Input, NULL, 0, NULL);
+}
+
+static NTSTATUS
+Query (
+    _Out_ PSUNXI_GPIO_BANK_STATISTICS Statistics
+    )
+{
+    SUNXI_GPIO_FUNCTION_INPUT Input;
+
+    memset(&Input, 0, sizeof(Input));
+    Input.Function = SUNXI_GPIO_FUNCTION_QUERY_INTERRUPT_STATISTICS;
+    Input.BankId = 0;
+    return GpioModelControllerFunction(&Input, Statistics, sizeof(*Statistics), NULL);
+}
+
+static VOID
+CheckStorm (
+    _In_ const char *Case,
+    _In_ PSOURCE Source,
+    _In_ ULONG Threshold,
+    _In_ ULONG BackoffMs
+    )
+{
+    Check(Source->Throttles != 0, Case, "storm throttled");
+    Check(Source->ServicedWhileMasked == 0, Case, "nothing serviced while masked");
+
+    //
+    // A run ends with the interrupt that crossed the threshold, it may start
+    // with the one latched while the pin was masked.
+    //
+
+    Check(Source->MaxServicedPerRun <= Threshold + 2, Case, "masked after threshold + 1 interrupts");
+    Check(Source->MinMaskedUs >= BackoffMs * 1000, Case, "masked for the back-off");
+    Check(Source->MaxMaskedUs <= BackoffMs * 1000 + TICK_US, Case, "unmasked when the back-off expires");
+    Check(!Source->Masked, Case, "unmasked after the storm");
+}
+
+static VOID
+CheckAllServiced (
+    _In_ const char *Case,
+    _In_ PSOURCE Source
+    )
+{
+    Check(Source->Throttles == 0, Case, "not throttled");
+    Check(Source->Serviced == Source->Generated, Case, "every interrupt serviced");
+}
+
+static VOID
+Report (
+    _In_ const char *Case,
+    _In_ PSOURCE Source
+    )
+{
+    printf("%-10s pin %2lu %6lu raised %6lu serviced %3lu throttled, masked %lu-%luus\n",
+           Case,
+           (unsigned long)Source->Pin,
+           (unsigned long)Source->Generated,
+           (unsigned long)Source->Serviced,
+           (unsigned long)Source->Throttles,
+           (unsigned long)((Source->Throttles != 0) ? Source->MinMaskedUs : 0),
+           (unsigned long)Source->MaxMaskedUs);
+}
+
+static VOID
+Start (
+    _In_ ULONG Threshold,
+    _In_ ULONG BackoffMs
+    )
+{
+    PIN_NUMBER Pin;
+
+    g_GpioModel.StormThresholdPresent = TRUE;
+    g_GpioModel.StormThreshold = Threshold;
+    g_GpioModel.StormBackoffPresent = TRUE;
+    g_GpioModel.StormBackoffMs = BackoffMs;
+    g_NowUs = 0;
+
+    Check(NT_SUCCESS(GpioModelReset(32)), "setup", "controller started");
+    for (Pin = STORM_PIN; Pin <= SECOND_STORM_PIN; Pin += 1) {
+        Check(NT_SUCCESS(GpioModelEnableInterrupt(Pin, Latched, InterruptActiveHigh)),
+              "setup", "interrupt enabled");
+    }
+}
+
+static VOID
+TestRegistry (
+    VOID
+    )
+{
+    ULONG Index;
+    SOURCE Sources[3];
+    SUNXI_GPIO_BANK_STATISTICS Statistics;
+
+    Start(200, 100);
+
+    InitializeSource(&Sources[0], STEADY_PIN, 20000, 0, 2500000, 0);
+    InitializeSource(&Sources[1], BURST_PIN, 1000, 100000, MAXULONG, 150);
+    InitializeSource(&Sources[2], STORM_PIN, 500, 200000, 2200000, 0);
+    Simulate(Sources, 3, 2500000);
+
+    Report("registry", &Sources[0]);
+    Report("registry", &Sources[1]);
+    Report("registry", &Sources[2]);
+    CheckAllServiced("registry steady", &Sources[0]);
+    CheckAllServiced("registry burst", &Sources[1]);
+    CheckStorm("registry storm", &Sources[2], 200, 100);
+
+    Check(NT_SUCCESS(Query(&Statistics)), "registry", "statistics queried");
+    Check((Statistics.StormThreshold == 200) && (Statistics.StormBackoffMs == 100),
+          "registry", "policy from the device parameters");
+
+    Check(Statistics.ThrottledMask == 0, "registry", "nothing throttled in the end");
+    for (Index = 0; Index < 3; Index += 1) {
+        Check(Statistics.Pins[Sources[Index].Pin].InterruptCount == Sources[Index].Serviced,
+              "registry", "interrupt count");
+
+        Check(Statistics.Pins[Sources[Index].Pin].ThrottleCount == Sources[Index].Throttles,
+              "registry", "throttle count");
+    }
+
+    Check((Statistics.Pins[STEADY_PIN].Rate >= 45) && (Statistics.Pins[STEADY_PIN].Rate <= 55),
+          "registry", "steady rate");
+
+    //
+    // The storm covers the second window and is serviced at about 1000/s,
+    // 201 interrupts every 200ms.
+    //
+
+    printf("registry   storm peak rate %lu/s\n", (unsigned long)Statistics.Pins[STORM_PIN].PeakRate);
+    Check((Statistics.Pins[STORM_PIN].PeakRate >= 900) && (Statistics.Pins[STORM_PIN].PeakRate <= 1100),
+          "registry", "storm peak rate");
+
+    GpioModelRelease();
+}
+
+static VOID
+TestIoctl (
+    VOID
+    )
+{
+    SOURCE Source;
+    SUNXI_GPIO_BANK_STATISTICS Statistics;
+
+    Start(200, 100);
+
+    Check(NT_SUCCESS(SetPolicy(20, 10)), "ioctl", "policy set");
+    InitializeSource(&Source, STORM_PIN, 500, 0, 200000, 0);
+    Simulate(&Source, 1, 250000);
+    Report("ioctl", &Source);
+    CheckStorm("ioctl storm", &Source, 20, 10);
+
+    Check(NT_SUCCESS(SetPolicy(50, 0)), "ioctl", "threshold set");
+    Check(NT_SUCCESS(Query(&Statistics)), "ioctl", "statistics queried");
+    Check((Statistics.StormThreshold == 50) && (Statistics.StormBackoffMs == 10),
+          "ioctl", "zero back-off keeps the current one");
+
+    InitializeSource(&Source, STORM_PIN, 500, 0, 200000, 0);
+    Simulate(&Source, 1, 250000);
+    Report("ioctl", &Source);
+    CheckStorm("ioctl threshold", &Source, 50, 10);
+
+    Check(NT_SUCCESS(SetPolicy(0, 0)), "ioctl", "throttling turned off");
+    InitializeSource(&Source, STORM_PIN, 500, 0, 200000, 0);
+    Simulate(&Source, 1, 250000);
+    Report("ioctl", &Source);
+    CheckAllServiced("ioctl off", &Source);
+
+    GpioModelRelease();
+}
+
+static VOID
+TestDisable (
+    VOID
+    )
+{
+    SOURCE Source;
+    SUNXI_GPIO_BANK_STATISTICS Statistics;
+
+    Start(20, 50);
+
+    InitializeSource(&Source, STORM_PIN, 500, 0, MAXULONG, 0);
+    Simulate(&Source, 1, 20000);
+    Check(Source.Masked != FALSE, "disable", "storm throttled");
+
+    Check(NT_SUCCESS(GpioModelDisableInterrupt(STORM_PIN)), "disable", "interrupt disabled");
+    Simulate(&Source, 1, 100000);
+    Check(!Enabled(STORM_PIN), "disable", "still disabled after the back-off");
+    Check(Source.ServicedWhileMasked == 0, "disable", "nothing serviced");
+
+    Check(NT_SUCCESS(Query(&Statistics)), "disable", "statistics queried");
+    Check(Statistics.ThrottledMask == 0, "disable", "no longer throttled");
+
+    Check(NT_SUCCESS(GpioModelEnableInterrupt(STORM_PIN, Latched, InterruptActiveHigh)),
+          "disable", "interrupt enabled again");
+
+    GpioModelAssert(1 << STORM_PIN);
+    Check(GpioModelInterrupt() == (1 << STORM_PIN), "disable", "serviced once enabled");
+
+    GpioModelRelease();
+}
+
+static VOID
+TestStaggered (
+    VOID
+    )
+{
+    SOURCE Sources[2];
+
+    Start(20, 50);
+
+    InitializeSource(&Sources[0], STORM_PIN, 500, 0, 300000, 0);
+    InitializeSource(&Sources[1], SECOND_STORM_PIN, 500, 30000, 330000, 0);
+    Simulate(Sources, 2, 400000);
+
+    Report("staggered", &Sources[0]);
+    Report("staggered", &Sources[1]);
+    CheckStorm("staggered first", &Sources[0], 20, 50);
+    CheckStorm("staggered second", &Sources[1], 20, 50);
+
+    GpioModelRelease();
+}
+
+static VOID
+TestStop (
+    VOID
+    )
+{
+    ULONG Index;
+    SOURCE Source;
+
+    Start(20, 50);
+
+    InitializeSource(&Source, STORM_PIN, 500, 0, MAXULONG, 0);
+    Simulate(&Source, 1, 20000);
+    Check(Source.Masked != FALSE, "stop", "storm throttled");
+
+    //
+    // The second pin is throttled by the ISR alone, its throttle DPC is
+    // still queued when the controller stops.
+    //
+
+    for (Index = 0; (Index < 100) && Enabled(SECOND_STORM_PIN); Index += 1) {
+        GpioModelAssert(1 << SECOND_STORM_PIN);
+        (VOID)GpioModelInterrupt();
+    }
+
+    Check(!Enabled(SECOND_STORM_PIN), "stop", "second storm throttled");
+    Check(g_GpioModel.DpcCount != 0, "stop", "throttle DPC queued");
+
+    Check(NT_SUCCESS(GpioModelStop(TRUE)), "stop", "controller stopped");
+    Check(g_GpioModel.DpcCount == 0, "stop", "DPCs flushed");
+    Check(g_GpioModel.TimerCount == 0, "stop", "no back-off timer armed");
+
+    GpioModelClearCounters();
+    GpioModelAdvance(200000);
+    printf("stop       %lu register writes while stopped\n",
+           (unsigned long)GpioModelMmioWrites());
+
+    Check(GpioModelMmioWrites() == 0, "stop", "no register written while stopped");
+    Check(!Enabled(STORM_PIN) && !Enabled(SECOND_STORM_PIN), "stop", "still masked while stopped");
+
+    Check(NT_SUCCESS(GpioModelStart(TRUE)), "stop", "controller started again");
+    GpioModelAdvance(TICK_US);
+    Check(Enabled(STORM_PIN) && Enabled(SECOND_STORM_PIN), "stop", "expired back-offs released on start");
+    Check(g_GpioModel.TimerCount == 0, "stop", "nothing left to release");
+
+    GpioModelRelease();
+}
+
+static VOID *
+PolicyQueryThread (
+    _In_ VOID *Argument
+    )
+{
+    PPOLICY_RACE Race;
+    SUNXI_GPIO_BANK_STATISTICS Statistics;
+
+    Race = (PPOLICY_RACE)Argument;
+    while (__atomic_load_n(&Race->Done, __ATOMIC_SEQ_CST) == 0) {
+        if (!NT_SUCCESS(Query(&Statistics))) {
+            continue;
+        }
+
+        Race->Queries += 1;
+        if (Statistics.StormThreshold != Statistics.StormBackoffMs) {
+            Race->Torn += 1;
+        }
+    }
+
+    return NULL;
+}
+
+static VOID *
+PolicyStormThread (
+    _In_ VOID *Argument
+    )
+{
+    PPOLICY_RACE Race;
+
+    Race = (PPOLICY_RACE)Argument;
+    while (__atomic_load_n(&Race->Done, __ATOMIC_SEQ_CST) == 0) {
+        GpioModelAssert(1 << STORM_PIN);
+        if (GpioModelInterrupt() != 0) {
+            Race->Serviced += 1;
+        }
+    }
+
+    return NULL;
+}
+
+static VOID
+TestPolicyRace (
+    VOID
+    )
+{
+    ULONG Index;
+    pthread_t Querier;
+    POLICY_RACE Race;
+    pthread_t Storm;
+    ULONG Value;
+
+    //
+    // The policies set always have equal threshold and back-off.
+    //
+
+    Start(1000, 1000);
+    memset(&Race, 0, sizeof(Race));
+    pthread_create(&Querier, NULL, PolicyQueryThread, &Race);
+    pthread_create(&Storm, NULL, PolicyStormThread, &Race);
+
+    for (Index = 0; Index < POLICY_CHANGES; Index += 1) {
+        Value = ((Index & 1) != 0) ? 10 : 1000;
+        (VOID)SetPolicy(Value, Value);
+    }
+
+    __atomic_store_n(&Race.Done, 1, __ATOMIC_SEQ_CST);
+    pthread_join(Querier, NULL);
+    pthread_join(Storm, NULL);
+
+    printf("policy     %lu changes, %lu queries, %lu torn, %lu serviced\n",
+           (unsigned long)POLICY_CHANGES,
+           (unsigned long)Race.Queries,
+           (unsigned long)Race.Torn,
+           (unsigned long)Race.Serviced);
+
+    Check(Race.Queries != 0, "policy", "queried while changing");
+    Check(Race.Torn == 0, "policy", "threshold and back-off set together");
+
+    GpioModelRelease();
+}
+
+int
+main (
+    VOID
+    )
+{
+    TestRegistry();
+    TestIoctl();
+    TestDisable();
+    TestStaggered();
+    TestStop();
+    TestPolicyRace();
+
+    if (g_Failures != 0) {
+        printf("%d check(s) failed\n", g_Failures);
+        return 1;
+    }
+
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,78 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	SPBCx.h
+
+Abstract:
+
+	Host stand-in for the SPB framework extension header. The
+	sequence positions are in the order g_TransferSettings in
+	controller.cpp is indexed by.
+
+Environment:
+
+	user mode
+
+--*/
+
+#ifndef _HOST_SPBCX_H_
+#define _HOST_SPBCX_H_
+
+#include "wdf.h"
+#include "spb.h"
+
+typedef struct SPBTARGET__      *SPBTARGET;
+typedef WDFREQUEST              SPBREQUEST;
+
+typedef enum _SPB_REQUEST_TYPE
+{
+    SpbRequestTypeUndefined = 0,
+    SpbRequestTypeRead,
+    SpbRequestTypeWrite,
+    SpbRequestTypeSequence,
+    SpbRequestTypeLockController,
+    SpbRequestTypeUnlockController,
+    SpbRequestTypeLockConnection,
+    SpbRequestTypeUnlockConnection,
+    SpbRequestTypeOther,
+    SpbRequestTypeMax
+} SPB_REQUEST_TYPE;
+
+typedef enum _SPB_REQUEST_SEQUENCE_POSITION
+{
+    SpbRequestSequencePositionInvalid = 0,
+    SpbRequestSequencePositionSingle,
+    SpbRequestSequencePositionFirst,
+    SpbRequestSequencePositionContinue,
+    SpbRequestSequencePositionLast,
+    SpbRequestSequencePositionMax
+} SPB_REQUEST_SEQUENCE_POSITION;
+
+typedef NTSTATUS EVT_SPB_TARGET_CONNECT(WDFDEVICE, SPBTARGET);
+typedef VOID EVT_SPB_CONTROLLER_LOCK(WDFDEVICE, SPBTARGET, SPBREQUEST);
+typedef VOID EVT_SPB_CONTROLLER_UNLOCK(WDFDEVICE, SPBTARGET, SPBREQUEST);
+typedef VOID EVT_SPB_CONTROLLER_READ(WDFDEVICE, SPBTARGET, SPBREQUEST, size_t);
+typedef VOID EVT_SPB_CONTROLLER_WRITE(WDFDEVICE, SPBTARGET, SPBREQUEST, size_t);
+typedef VOID EVT_SPB_CONTROLLER_SEQUENCE(WDFDEVICE, SPBTARGET, SPBREQUEST, ULONG);
+typedef VOID EVT_SPB_CONTROLLER_OTHER(WDFDEVICE, SPBTARGET, SPBREQUEST, size_t, size_t, ULONG);
+
+#endif // _HOST_SPBCX_H_
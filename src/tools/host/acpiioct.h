@@ -0,0 +1,80 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	acpiioct.h
+
+Abstract:
+
+	Host stand-in for the ACPI method evaluation definitions. The GPIO
+	model (Port/GPIO/tools/gpiomodel.c) answers IOCTL_ACPI_EVAL_METHOD
+	with the bank layout.
+
+Environment:
+
+	user mode
+
+--*/
+
+#ifndef _HOST_ACPIIOCT_H_
+#define _HOST_ACPIIOCT_H_
+
+#include "ntddk.h"
+
+#define IOCTL_ACPI_EVAL_METHOD                  0x0032c004
+
+#define ACPI_EVAL_INPUT_BUFFER_SIGNATURE        'BieA'
+#define ACPI_EVAL_OUTPUT_BUFFER_SIGNATURE       'BoeA'
+
+#define ACPI_METHOD_ARGUMENT_INTEGER            0x0
+#define ACPI_METHOD_ARGUMENT_STRING             0x1
+#define ACPI_METHOD_ARGUMENT_BUFFER             0x2
+
+typedef struct _ACPI_EVAL_INPUT_BUFFER
+{
+    ULONG Signature;
+    union
+    {
+        UCHAR MethodName[4];
+        ULONG MethodNameAsUlong;
+    };
+} ACPI_EVAL_INPUT_BUFFER, *PACPI_EVAL_INPUT_BUFFER;
+
+typedef struct _ACPI_METHOD_ARGUMENT
+{
+    USHORT Type;
+    USHORT DataLength;
+    union
+    {
+        ULONG Argument;
+        UCHAR Data[4];
+    };
+} ACPI_METHOD_ARGUMENT, *PACPI_METHOD_ARGUMENT;
+
+typedef struct _ACPI_EVAL_OUTPUT_BUFFER
+{
+    ULONG Signature;
+    ULONG Length;
+    ULONG Count;
+    ACPI_METHOD_ARGUMENT Argument[1];
+} ACPI_EVAL_OUTPUT_BUFFER, *PACPI_EVAL_OUTPUT_BUFFER;
+
+#endif // _HOST_ACPIIOCT_H_
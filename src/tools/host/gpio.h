@@ -0,0 +1,45 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	gpio.h
+
+Abstract:
+
+	Host stand-in for gpio.h, the pin IOCTLs SetGpioLevel formats.
+
+Environment:
+
+	user mode
+
+--*/
+
+#ifndef _HOST_GPIO_H_
+#define _HOST_GPIO_H_
+
+#include "ntddk.h"
+
+#define IOCTL_GPIO_READ_PINS \
+    CTL_CODE(FILE_DEVICE_GPIO, 0, METHOD_BUFFERED, FILE_READ_ACCESS)
+#define IOCTL_GPIO_WRITE_PINS \
+    CTL_CODE(FILE_DEVICE_GPIO, 1, METHOD_BUFFERED, FILE_READ_ACCESS | FILE_WRITE_ACCESS)
+
+#endif // _HOST_GPIO_H_
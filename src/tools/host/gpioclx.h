@@ -0,0 +1,389 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	gpioclx.h
+
+Abstract:
+
+	Host stand-in for the GPIO class extension interface. The callback
+	types and parameter blocks follow the WDK header for the fields
+	sunxigpio.c uses. GPIO_CLX_RegisterClient hands the registration
+	packet to the GPIO model (Port/GPIO/tools/gpiomodel.c), which then
+	calls the client the way the class extension does.
+
+Environment:
+
+	user mode
+
+--*/
+
+#ifndef _HOST_GPIOCLX_H_
+#define _HOST_GPIOCLX_H_
+
+#include "wdf.h"
+
+typedef ULONG PIN_NUMBER, *PPIN_NUMBER;
+typedef USHORT BANK_ID, *PBANK_ID;
+
+#define GPIO_CLIENT_VERSION                                     (0x0002)
+#define GPIO_CONTROLLER_BASIC_INFORMATION_VERSION               (1)
+#define GPIO_BANK_POWER_INFORMATION_OUTPUT_VERSION              (1)
+#define GPIO_BANK_INTERRUPT_BINDING_INFORMATION_OUTPUT_VERSION  (1)
+
+//
+// Controller information.
+//
+
+typedef struct _CLIENT_CONTROLLER_BASIC_INFORMATION
+{
+    USHORT Version;
+    USHORT Size;
+    USHORT TotalPins;
+    USHORT NumberOfPinsPerBank;
+    union
+    {
+        struct
+        {
+            ULONG MemoryMappedController : 1;
+            ULONG ActiveInterruptsAutoClearOnRead : 1;
+            ULONG FormatIoRequestsAsMasks : 1;
+            ULONG DeviceIdlePowerMgmtSupported : 1;
+            ULONG BankIdlePowerMgmtSupported : 1;
+            ULONG EmulateDebouncing : 1;
+            ULONG EmulateActiveBoth : 1;
+            ULONG Reserved : 25;
+        };
+        ULONG AsULONG;
+    } Flags;
+    ULONG64 IdleTimeout;
+} CLIENT_CONTROLLER_BASIC_INFORMATION, *PCLIENT_CONTROLLER_BASIC_INFORMATION;
+
+typedef enum _CLIENT_CONTROLLER_QUERY_SET_REQUEST_TYPE
+{
+    QueryBankPowerInformation,
+    QueryBankInterruptBindingInformation
+} CLIENT_CONTROLLER_QUERY_SET_REQUEST_TYPE;
+
+typedef struct _CLIENT_CONTROLLER_QUERY_SET_INFORMATION_INPUT
+{
+    CLIENT_CONTROLLER_QUERY_SET_REQUEST_TYPE RequestType;
+    union
+    {
+        struct
+        {
+            BANK_ID BankId;
+        } BankPowerInformation;
+
+        struct
+        {
+            WDFCMRESLIST ResourcesTranslated;
+            WDFCMRESLIST ResourcesRaw;
+            USHORT TotalBanks;
+        } BankInterruptBinding;
+    };
+} CLIENT_CONTROLLER_QUERY_SET_INFORMATION_INPUT,
+    *PCLIENT_CONTROLLER_QUERY_SET_INFORMATION_INPUT;
+
+typedef struct _CLIENT_CONTROLLER_QUERY_SET_INFORMATION_OUTPUT
+{
+    USHORT Version;
+    USHORT Size;
+    union
+    {
+        struct
+        {
+            BOOLEAN F1StateSupported;
+            PO_FX_COMPONENT_IDLE_STATE F1IdleStateParameters;
+        } BankPowerInformation;
+
+        struct
+        {
+            ULONG ResourceMapping[1];
+        } BankInterruptBinding;
+    };
+} CLIENT_CONTROLLER_QUERY_SET_INFORMATION_OUTPUT,
+    *PCLIENT_CONTROLLER_QUERY_SET_INFORMATION_OUTPUT;
+
+//
+// Interrupt parameters.
+//
+
+typedef struct _GPIO_ENABLE_INTERRUPT_PARAMETERS
+{
+    BANK_ID BankId;
+    PIN_NUMBER PinNumber;
+    ULONG Flags;
+    KINTERRUPT_MODE InterruptMode;
+    KINTERRUPT_POLARITY Polarity;
+    UCHAR PullConfiguration;
+    USHORT DebounceTimeout;
+    PVOID VendorData;
+    ULONG VendorDataLength;
+} GPIO_ENABLE_INTERRUPT_PARAMETERS, *PGPIO_ENABLE_INTERRUPT_PARAMETERS;
+
+typedef struct _GPIO_DISABLE_INTERRUPT_PARAMETERS
+{
+    BANK_ID BankId;
+    PIN_NUMBER PinNumber;
+    ULONG Flags;
+} GPIO_DISABLE_INTERRUPT_PARAMETERS, *PGPIO_DISABLE_INTERRUPT_PARAMETERS;
+
+typedef struct _GPIO_MASK_INTERRUPT_PARAMETERS
+{
+    BANK_ID BankId;
+    ULONG64 PinMask;
+    ULONG64 FailedMask;
+} GPIO_MASK_INTERRUPT_PARAMETERS, *PGPIO_MASK_INTERRUPT_PARAMETERS;
+
+typedef struct _GPIO_QUERY_ACTIVE_INTERRUPTS_PARAMETERS
+{
+    BANK_ID BankId;
+    ULONG64 EnabledMask;
+    ULONG64 ActiveMask;
+} GPIO_QUERY_ACTIVE_INTERRUPTS_PARAMETERS, *PGPIO_QUERY_ACTIVE_INTERRUPTS_PARAMETERS;
+
+typedef struct _GPIO_QUERY_ENABLED_INTERRUPTS_PARAMETERS
+{
+    BANK_ID BankId;
+    ULONG64 EnabledMask;
+} GPIO_QUERY_ENABLED_INTERRUPTS_PARAMETERS, *PGPIO_QUERY_ENABLED_INTERRUPTS_PARAMETERS;
+
+typedef struct _GPIO_CLEAR_ACTIVE_INTERRUPTS_PARAMETERS
+{
+    BANK_ID BankId;
+    ULONG64 ClearActiveMask;
+    ULONG64 FailedClearMask;
+} GPIO_CLEAR_ACTIVE_INTERRUPTS_PARAMETERS, *PGPIO_CLEAR_ACTIVE_INTERRUPTS_PARAMETERS;
+
+typedef struct _GPIO_RECONFIGURE_INTERRUPTS_PARAMETERS
+{
+    BANK_ID BankId;
+    PIN_NUMBER PinNumber;
+    KINTERRUPT_MODE InterruptMode;
+    KINTERRUPT_POLARITY Polarity;
+    ULONG Flags;
+} GPIO_RECONFIGURE_INTERRUPTS_PARAMETERS, *PGPIO_RECONFIGURE_INTERRUPTS_PARAMETERS;
+
+//
+// I/O parameters.
+//
+
+typedef enum _GPIO_CONNECT_IO_PINS_MODE
+{
+    ConnectModeInvalid,
+    ConnectModeInput,
+    ConnectModeOutput,
+    ConnectModeMaximum
+} GPIO_CONNECT_IO_PINS_MODE;
+
+typedef struct _GPIO_CONNECT_IO_PINS_PARAMETERS
+{
+    BANK_ID BankId;
+    PPIN_NUMBER PinNumberTable;
+    ULONG PinCount;
+    GPIO_CONNECT_IO_PINS_MODE ConnectMode;
+    UCHAR PullConfiguration;
+    USHORT DebounceTimeout;
+    USHORT DriveStrength;
+    PVOID VendorData;
+    ULONG VendorDataLength;
+    ULONG ConnectFlags;
+} GPIO_CONNECT_IO_PINS_PARAMETERS, *PGPIO_CONNECT_IO_PINS_PARAMETERS;
+
+typedef struct _GPIO_DISCONNECT_IO_PINS_PARAMETERS
+{
+    BANK_ID BankId;
+    PPIN_NUMBER PinNumberTable;
+    ULONG PinCount;
+    GPIO_CONNECT_IO_PINS_MODE DisconnectMode;
+    union
+    {
+        struct
+        {
+            ULONG PreserveConfiguration : 1;
+            ULONG Reserved : 31;
+        };
+        ULONG AsULONG;
+    } DisconnectFlags;
+} GPIO_DISCONNECT_IO_PINS_PARAMETERS, *PGPIO_DISCONNECT_IO_PINS_PARAMETERS;
+
+typedef struct _GPIO_READ_PINS_MASK_PARAMETERS
+{
+    BANK_ID BankId;
+    PULONG64 PinValues;
+    union
+    {
+        struct
+        {
+            ULONG WriteConfiguredPins : 1;
+            ULONG Reserved : 31;
+        };
+        ULONG AsULONG;
+    } Flags;
+} GPIO_READ_PINS_MASK_PARAMETERS, *PGPIO_READ_PINS_MASK_PARAMETERS;
+
+typedef struct _GPIO_WRITE_PINS_MASK_PARAMETERS
+{
+    BANK_ID BankId;
+    ULONG64 SetMask;
+    ULONG64 ClearMask;
+    ULONG Flags;
+} GPIO_WRITE_PINS_MASK_PARAMETERS, *PGPIO_WRITE_PINS_MASK_PARAMETERS;
+
+typedef struct _GPIO_SAVE_RESTORE_BANK_HARDWARE_CONTEXT_PARAMETERS
+{
+    BANK_ID BankId;
+    WDF_POWER_DEVICE_STATE State;
+    ULONG Flags;
+} GPIO_SAVE_RESTORE_BANK_HARDWARE_CONTEXT_PARAMETERS,
+    *PGPIO_SAVE_RESTORE_BANK_HARDWARE_CONTEXT_PARAMETERS;
+
+typedef struct _GPIO_CLIENT_CONTROLLER_SPECIFIC_FUNCTION_PARAMETERS
+{
+    PVOID InputBuffer;
+    PVOID OutputBuffer;
+    SIZE_T InputBufferLength;
+    SIZE_T OutputBufferLength;
+    ULONG_PTR BytesWritten;
+} GPIO_CLIENT_CONTROLLER_SPECIFIC_FUNCTION_PARAMETERS,
+    *PGPIO_CLIENT_CONTROLLER_SPECIFIC_FUNCTION_PARAMETERS;
+
+//
+// Client callbacks.
+//
+
+typedef NTSTATUS GPIO_CLIENT_PREPARE_CONTROLLER (
+    _In_ WDFDEVICE Device, _In_ PVOID Context,
+    _In_ WDFCMRESLIST ResourcesRaw, _In_ WDFCMRESLIST ResourcesTranslated);
+typedef NTSTATUS GPIO_CLIENT_RELEASE_CONTROLLER (
+    _In_ WDFDEVICE Device, _In_ PVOID Context);
+typedef NTSTATUS GPIO_CLIENT_QUERY_CONTROLLER_BASIC_INFORMATION (
+    _In_ PVOID Context, _Out_ PCLIENT_CONTROLLER_BASIC_INFORMATION ControllerInformation);
+typedef NTSTATUS GPIO_CLIENT_QUERY_SET_CONTROLLER_INFORMATION (
+    _In_ PVOID Context, _In_ PCLIENT_CONTROLLER_QUERY_SET_INFORMATION_INPUT InputBuffer,
+    _Out_opt_ PCLIENT_CONTROLLER_QUERY_SET_INFORMATION_OUTPUT OutputBuffer);
+typedef NTSTATUS GPIO_CLIENT_START_CONTROLLER (
+    _In_ PVOID Context, _In_ BOOLEAN RestoreContext,
+    _In_ WDF_POWER_DEVICE_STATE PreviousPowerState);
+typedef NTSTATUS GPIO_CLIENT_STOP_CONTROLLER (
+    _In_ PVOID Context, _In_ BOOLEAN SaveContext,
+    _In_ WDF_POWER_DEVICE_STATE TargetState);
+typedef NTSTATUS GPIO_CLIENT_ENABLE_INTERRUPT (
+    _In_ PVOID Context, _In_ PGPIO_ENABLE_INTERRUPT_PARAMETERS EnableParameters);
+typedef NTSTATUS GPIO_CLIENT_DISABLE_INTERRUPT (
+    _In_ PVOID Context, _In_ PGPIO_DISABLE_INTERRUPT_PARAMETERS DisableParameters);
+typedef NTSTATUS GPIO_CLIENT_MASK_INTERRUPTS (
+    _In_ PVOID Context, _In_ PGPIO_MASK_INTERRUPT_PARAMETERS MaskParameters);
+typedef NTSTATUS GPIO_CLIENT_UNMASK_INTERRUPT (
+    _In_ PVOID Context, _In_ PGPIO_ENABLE_INTERRUPT_PARAMETERS UnmaskParameters);
+typedef NTSTATUS GPIO_CLIENT_RECONFIGURE_INTERRUPT (
+    _In_ PVOID Context, _In_ PGPIO_RECONFIGURE_INTERRUPTS_PARAMETERS ReconfigureParameters);
+typedef NTSTATUS GPIO_CLIENT_QUERY_ACTIVE_INTERRUPTS (
+    _In_ PVOID Context, _In_ PGPIO_QUERY_ACTIVE_INTERRUPTS_PARAMETERS QueryActiveParameters);
+typedef NTSTATUS GPIO_CLIENT_CLEAR_ACTIVE_INTERRUPTS (
+    _In_ PVOID Context, _In_ PGPIO_CLEAR_ACTIVE_INTERRUPTS_PARAMETERS ClearParameters);
+typedef NTSTATUS GPIO_CLIENT_QUERY_ENABLED_INTERRUPTS (
+    _In_ PVOID Context, _In_ PGPIO_QUERY_ENABLED_INTERRUPTS_PARAMETERS QueryEnabledParameters);
+typedef NTSTATUS GPIO_CLIENT_CONNECT_IO_PINS (
+    _In_ PVOID Context, _In_ PGPIO_CONNECT_IO_PINS_PARAMETERS ConnectParameters);
+typedef NTSTATUS GPIO_CLIENT_DISCONNECT_IO_PINS (
+    _In_ PVOID Context, _In_ PGPIO_DISCONNECT_IO_PINS_PARAMETERS DisconnectParameters);
+typedef NTSTATUS GPIO_CLIENT_READ_PINS_MASK (
+    _In_ PVOID Context, _In_ PGPIO_READ_PINS_MASK_PARAMETERS ReadParameters);
+typedef NTSTATUS GPIO_CLIENT_WRITE_PINS_MASK (
+    _In_ PVOID Context, _In_ PGPIO_WRITE_PINS_MASK_PARAMETERS WriteParameters);
+typedef VOID GPIO_CLIENT_SAVE_BANK_HARDWARE_CONTEXT (
+    _In_ PVOID Context,
+    _In_ PGPIO_SAVE_RESTORE_BANK_HARDWARE_CONTEXT_PARAMETERS SaveParameters);
+typedef VOID GPIO_CLIENT_RESTORE_BANK_HARDWARE_CONTEXT (
+    _In_ PVOID Context,
+    _In_ PGPIO_SAVE_RESTORE_BANK_HARDWARE_CONTEXT_PARAMETERS RestoreParameters);
+typedef NTSTATUS GPIO_CLIENT_CONTROLLER_SPECIFIC_FUNCTION (
+    _In_ PVOID Context,
+    _In_ PGPIO_CLIENT_CONTROLLER_SPECIFIC_FUNCTION_PARAMETERS Parameters);
+
+typedef struct _GPIO_CLIENT_REGISTRATION_PACKET
+{
+    USHORT Version;
+    USHORT Size;
+    ULONG Flags;
+    ULONG ControllerContextSize;
+    ULONG64 Reserved;
+    GPIO_CLIENT_PREPARE_CONTROLLER *CLIENT_PrepareController;
+    GPIO_CLIENT_RELEASE_CONTROLLER *CLIENT_ReleaseController;
+    GPIO_CLIENT_START_CONTROLLER *CLIENT_StartController;
+    GPIO_CLIENT_STOP_CONTROLLER *CLIENT_StopController;
+    GPIO_CLIENT_QUERY_CONTROLLER_BASIC_INFORMATION *CLIENT_QueryControllerBasicInformation;
+    GPIO_CLIENT_QUERY_SET_CONTROLLER_INFORMATION *CLIENT_QuerySetControllerInformation;
+    GPIO_CLIENT_ENABLE_INTERRUPT *CLIENT_EnableInterrupt;
+    GPIO_CLIENT_DISABLE_INTERRUPT *CLIENT_DisableInterrupt;
+    GPIO_CLIENT_UNMASK_INTERRUPT *CLIENT_UnmaskInterrupt;
+    GPIO_CLIENT_MASK_INTERRUPTS *CLIENT_MaskInterrupts;
+    GPIO_CLIENT_QUERY_ACTIVE_INTERRUPTS *CLIENT_QueryActiveInterrupts;
+    GPIO_CLIENT_CLEAR_ACTIVE_INTERRUPTS *CLIENT_ClearActiveInterrupts;
+    GPIO_CLIENT_CONNECT_IO_PINS *CLIENT_ConnectIoPins;
+    GPIO_CLIENT_DISCONNECT_IO_PINS *CLIENT_DisconnectIoPins;
+    GPIO_CLIENT_READ_PINS_MASK *CLIENT_ReadGpioPinsUsingMask;
+    GPIO_CLIENT_WRITE_PINS_MASK *CLIENT_WriteGpioPinsUsingMask;
+    GPIO_CLIENT_SAVE_BANK_HARDWARE_CONTEXT *CLIENT_SaveBankHardwareContext;
+    GPIO_CLIENT_RESTORE_BANK_HARDWARE_CONTEXT *CLIENT_RestoreBankHardwareContext;
+    GPIO_CLIENT_RECONFIGURE_INTERRUPT *CLIENT_ReconfigureInterrupt;
+    GPIO_CLIENT_QUERY_ENABLED_INTERRUPTS *CLIENT_QueryEnabledInterrupts;
+    GPIO_CLIENT_CONTROLLER_SPECIFIC_FUNCTION *CLIENT_ControllerSpecificFunction;
+} GPIO_CLIENT_REGISTRATION_PACKET, *PGPIO_CLIENT_REGISTRATION_PACKET;
+
+//
+// Class extension routines.
+//
+
+NTSTATUS
+GPIO_CLX_RegisterClient(
+    _In_ WDFDRIVER Driver,
+    _In_ PGPIO_CLIENT_REGISTRATION_PACKET RegistrationPacket,
+    _In_ PUNICODE_STRING RegistryPath);
+
+NTSTATUS
+GPIO_CLX_UnregisterClient(
+    _In_ WDFDRIVER Driver);
+
+NTSTATUS
+GPIO_CLX_ProcessAddDevicePreDeviceCreate(
+    _In_ WDFDRIVER Driver,
+    _Inout_ PWDFDEVICE_INIT DeviceInit,
+    _Out_ PWDF_OBJECT_ATTRIBUTES FdoAttributes);
+
+NTSTATUS
+GPIO_CLX_ProcessAddDevicePostDeviceCreate(
+    _In_ WDFDRIVER Driver,
+    _In_ WDFDEVICE Device);
+
+NTSTATUS
+GPIO_CLX_AcquireInterruptLock(
+    _In_ PVOID Context,
+    _In_ BANK_ID BankId);
+
+NTSTATUS
+GPIO_CLX_ReleaseInterruptLock(
+    _In_ PVOID Context,
+    _In_ BANK_ID BankId);
+
+#endif // _HOST_GPIOCLX_H_
@@ -0,0 +1,76 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	hidport.h
+
+Abstract:
+
+	Host stand-in, the HID device attributes, descriptor and transfer
+	packet.
+
+Environment:
+
+	user mode
+
+--*/
+
+#ifndef _HOST_HIDPORT_H_
+#define _HOST_HIDPORT_H_
+
+#include "ntddk.h"
+
+typedef struct _HID_DEVICE_ATTRIBUTES
+{
+    ULONG Size;
+    USHORT VendorID;
+    USHORT ProductID;
+    USHORT VersionNumber;
+    USHORT Reserved[11];
+} HID_DEVICE_ATTRIBUTES, *PHID_DEVICE_ATTRIBUTES;
+
+#include <pshpack1.h>
+
+typedef struct _HID_DESCRIPTOR
+{
+    UCHAR bLength;
+    UCHAR bDescriptorType;
+    USHORT bcdHID;
+    UCHAR bCountry;
+    UCHAR bNumDescriptors;
+
+    struct _HID_DESCRIPTOR_DESC_LIST
+    {
+        UCHAR bReportType;
+        USHORT wReportLength;
+    } DescriptorList[1];
+} HID_DESCRIPTOR, *PHID_DESCRIPTOR;
+
+#include <poppack.h>
+
+typedef struct _HID_XFER_PACKET
+{
+    PUCHAR reportBuffer;
+    ULONG reportBufferLen;
+    UCHAR reportId;
+} HID_XFER_PACKET, *PHID_XFER_PACKET;
+
+#endif // _HOST_HIDPORT_H_
@@ -0,0 +1,48 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	minwindef.h
+
+Abstract:
+
+	Host stand-in for the Windows base types the sunxicir Common.h
+	and HidInject.h use.
+
+Environment:
+
+	user mode
+
+--*/
+
+#ifndef _HOST_MINWINDEF_H_
+#define _HOST_MINWINDEF_H_
+
+#include "ntddk.h"
+
+typedef uint32_t            DWORD;
+typedef uint16_t            WORD;
+typedef int                 BOOL;
+
+#define FAR
+#define DUMMYUNIONNAME
+
+#endif // _HOST_MINWINDEF_H_
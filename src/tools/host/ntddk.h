@@ -0,0 +1,705 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	ntddk.h
+
+Abstract:
+
+	The subset of the kernel headers the drivers need to build their
+	host tools as user mode programs with gcc or clang, every tool
+	passes this directory with -I. Only what the tools use is
+	declared, the kernel routines are implemented by the model each
+	tool links:
+
+		Bus/Spb/i2c         the TWI model (tools/twimodel.cpp)
+		Port/GPIO           the GPIO model (tools/gpiomodel.c), which
+		                    also stands in for the class extension
+		Hid/sunxicir        keystate.cpp implements the registry
+		                    routines of the keymap, injectbench.cpp
+		                    the request, memory and spin lock ones
+		                    of the injection channel
+		Hid/vhfhid          the fake VHF of tools/vhfbatch.c
+		Hid/Button          the LRADC model (tools/buttonsim.c)
+		Hid/TouchScreen/Silead
+		                    the fake I2C target and file system of
+		                    tools/gslcfgload.c
+		Hid/TouchScreen/Gt9xx
+		                    the fake panel of tools/gt9xxsim.c
+
+	The other headers in this directory stand in for wdm.h, wdf.h,
+	SPBCx.h, spb.h, reshub.h, gpioclx.h, acpiioct.h, minwindef.h,
+	portcls.h, hidport.h, vhf.h, gpio.h, usbdi.h, usbdlib.h, wdfusb.h,
+	ntdef.h, ntstrsafe.h, the Trace.h and Public.h of the touch screen
+	drivers and the WPP generated controller.tmh and Keymap.tmh.
+
+Environment:
+
+	user mode
+
+--*/
+
+#ifndef _HOST_NTDDK_H_
+#define _HOST_NTDDK_H_
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <wchar.h>
+
+//
+// The drivers rely on MSVC accepting multi-character pool tags, pointer
+// truncation of vendor data, any pointer converted to a PVOID *, sizes
+// passed to %d and its own pragmas.
+//
+
+#pragma GCC diagnostic ignored "-Wunknown-pragmas"
+#pragma GCC diagnostic ignored "-Wmultichar"
+#pragma GCC diagnostic ignored "-Wformat"
+#ifndef __cplusplus
+#pragma GCC diagnostic ignored "-Wpointer-to-int-cast"
+#pragma GCC diagnostic ignored "-Wincompatible-pointer-types"
+#endif
+
+//
+// Basic types, sized like LLP64 Windows.
+//
+
+#define VOID                void
+#define CONST               const
+#define IN
+#define OUT
+typedef void                *PVOID, *HANDLE, **PHANDLE;
+typedef char                CHAR, *PCHAR;
+typedef unsigned char       UCHAR, *PUCHAR, BYTE;
+typedef short               SHORT;
+typedef unsigned short      USHORT, *PUSHORT;
+typedef int32_t             LONG, *PLONG;
+typedef uint32_t            ULONG, *PULONG;
+typedef int64_t             LONGLONG, *PLONGLONG;
+typedef uint64_t            ULONGLONG;
+typedef uint64_t            ULONG64, *PULONG64;
+typedef unsigned int        UINT;
+typedef uint8_t             UINT8;
+typedef uint16_t            UINT16;
+typedef uint32_t            UINT32;
+typedef uint64_t            UINT64;
+typedef uintptr_t           ULONG_PTR, *PULONG_PTR;
+typedef size_t              SIZE_T;
+typedef UCHAR               BOOLEAN, *PBOOLEAN;
+typedef LONG                NTSTATUS;
+typedef wchar_t             WCHAR, *PWCH, *PWSTR;
+typedef const WCHAR         *PCWSTR;
+typedef ULONG               ACCESS_MASK;
+
+#define TRUE                1
+#define FALSE               0
+#define MAXUSHORT           0xffff
+#define MAXULONG            0xffffffff
+
+//Windows 10, as the drivers are built for
+#define _WIN32_WINNT        0x0A00
+#define WINVER              0x0A00
+
+typedef union _LARGE_INTEGER
+{
+    struct
+    {
+        ULONG LowPart;
+        LONG HighPart;
+    };
+    struct
+    {
+        ULONG LowPart;
+        LONG HighPart;
+    } u;
+    LONGLONG QuadPart;
+} LARGE_INTEGER, *PLARGE_INTEGER, PHYSICAL_ADDRESS;
+
+typedef struct _GUID
+{
+    ULONG Data1;
+    USHORT Data2;
+    USHORT Data3;
+    UCHAR Data4[8];
+} GUID;
+typedef const GUID *LPCGUID;
+
+#define DEFINE_GUID(name, l, w1, w2, b1, b2, b3, b4, b5, b6, b7, b8) \
+    static const GUID name = { l, w1, w2, { b1, b2, b3, b4, b5, b6, b7, b8 } }
+
+typedef struct _UNICODE_STRING
+{
+    USHORT Length;
+    USHORT MaximumLength;
+    PWCH Buffer;
+} UNICODE_STRING, *PUNICODE_STRING;
+typedef const UNICODE_STRING *PCUNICODE_STRING;
+
+#define DECLARE_CONST_UNICODE_STRING(_var, _string) \
+    const UNICODE_STRING _var = {sizeof(_string) - sizeof(WCHAR), sizeof(_string), (PWCH)_string}
+
+#define DECLARE_UNICODE_STRING_SIZE(_var, _size) \
+    WCHAR _var ## _buffer[_size]; \
+    UNICODE_STRING _var = { 0, (_size) * sizeof(WCHAR), _var ## _buffer }
+
+//
+// Status codes.
+//
+
+#define NT_SUCCESS(Status)              (((NTSTATUS)(Status)) >= 0)
+
+#define STATUS_SUCCESS                  ((NTSTATUS)0x00000000L)
+#define STATUS_PENDING                  ((NTSTATUS)0x00000103L)
+#define STATUS_BUFFER_OVERFLOW          ((NTSTATUS)0x80000005L)
+#define STATUS_NO_MORE_ENTRIES          ((NTSTATUS)0x8000001AL)
+#define STATUS_DEVICE_BUSY              ((NTSTATUS)0x80000011L)
+#define STATUS_UNSUCCESSFUL             ((NTSTATUS)0xC0000001L)
+#define STATUS_NOT_IMPLEMENTED          ((NTSTATUS)0xC0000002L)
+#define STATUS_INVALID_PARAMETER        ((NTSTATUS)0xC000000DL)
+#define STATUS_NO_SUCH_DEVICE           ((NTSTATUS)0xC000000EL)
+#define STATUS_END_OF_FILE              ((NTSTATUS)0xC0000011L)
+#define STATUS_INFO_LENGTH_MISMATCH     ((NTSTATUS)0xC0000004L)
+#define STATUS_BUFFER_TOO_SMALL         ((NTSTATUS)0xC0000023L)
+#define STATUS_OBJECT_NAME_NOT_FOUND    ((NTSTATUS)0xC0000034L)
+#define STATUS_INVALID_IMAGE_FORMAT     ((NTSTATUS)0xC000007BL)
+#define STATUS_INSUFFICIENT_RESOURCES   ((NTSTATUS)0xC000009AL)
+#define STATUS_IO_TIMEOUT               ((NTSTATUS)0xC00000B5L)
+#define STATUS_DEVICE_DATA_ERROR        ((NTSTATUS)0xC000009CL)
+#define STATUS_DEVICE_NOT_CONNECTED     ((NTSTATUS)0xC000009DL)
+#define STATUS_NOT_SUPPORTED            ((NTSTATUS)0xC00000BBL)
+#define STATUS_INVALID_DEVICE_STATE     ((NTSTATUS)0xC0000184L)
+#define STATUS_IO_DEVICE_ERROR          ((NTSTATUS)0xC0000185L)
+#define STATUS_CANCELLED                ((NTSTATUS)0xC0000120L)
+#define STATUS_INVALID_BUFFER_SIZE      ((NTSTATUS)0xC0000206L)
+#define STATUS_NOT_FOUND                ((NTSTATUS)0xC0000225L)
+#define STATUS_DEVICE_REMOVED           ((NTSTATUS)0xC00002B6L)
+#define STATUS_FILE_TOO_LARGE           ((NTSTATUS)0xC0000904L)
+
+//
+// Compiler and annotation helpers.
+//
+
+#ifdef __cplusplus
+#define EXTERN_C_START                  extern "C" {
+#define EXTERN_C_END                    }
+#else
+#define EXTERN_C_START
+#define EXTERN_C_END
+#endif
+
+#define FORCEINLINE                     static inline
+#define _inline                         static inline
+#define __inline                        static inline
+#define __declspec(x)
+#define __pragma(x)
+#define UNREFERENCED_PARAMETER(P)       ((void)(P))
+#define FIELD_OFFSET(type, field)       offsetof(type, field)
+#define ARRAYSIZE(a)                    (sizeof(a) / sizeof((a)[0]))
+#define C_ASSERT(e)                     _Static_assert(e, #e)
+#define PAGED_CODE()                    ((void)0)
+
+#ifndef min
+#define min(a, b)                       (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef max
+#define max(a, b)                       (((a) > (b)) ? (a) : (b))
+#endif
+
+#define _In_
+#define _In_opt_
+#define _Out_
+#define _Out_opt_
+#define _Inout_
+#define _Inout_opt_
+#define _Must_inspect_result_
+#define _Out_writes_(x)
+#define _Out_writes_bytes_(x)
+#define _In_reads_(x)
+#define _In_reads_opt_(x)
+#define _In_reads_bytes_(x)
+#define _In_range_(o, x)
+#define _Use_decl_annotations_
+#define _IRQL_requires_(x)
+#define _IRQL_requires_same_
+#define __drv_functionClass(x)
+
+#define NT_ASSERT(e)                    assert(e)
+#define NT_ASSERTMSG(m, e)              assert((m) && (e))
+
+//
+// Debug output, dropped unless a tool wants to see it.
+//
+
+#define DPFLTR_IHVDRIVER_ID             77
+#define DPFLTR_ERROR_LEVEL              0
+#define DPFLTR_WARNING_LEVEL            1
+#define DPFLTR_TRACE_LEVEL              2
+#define DPFLTR_INFO_LEVEL               3
+
+#define DbgPrint(...)                   ((void)0)
+#define DbgPrintEx(...)                 ((void)0)
+#define KdPrintEx(_x_)                  ((void)0)
+#define KdPrint(_x_)                    ((void)0)
+
+//
+// Synchronization and time.
+//
+
+#define __nop()                         __asm__ __volatile__("" ::: "memory")
+#define KeMemoryBarrier()               __sync_synchronize()
+
+#define InterlockedIncrement(p)         __sync_add_and_fetch((p), 1)
+#define InterlockedDecrement(p)         __sync_sub_and_fetch((p), 1)
+#define InterlockedOr(p, v)             __sync_fetch_and_or((p), (v))
+#define InterlockedAnd(p, v)            __sync_fetch_and_and((p), (v))
+#define InterlockedExchange(p, v)       __sync_lock_test_and_set((p), (v))
+#define InterlockedCompareExchange(p, v, c) __sync_val_compare_and_swap((p), (c), (v))
+
+LARGE_INTEGER
+KeQueryPerformanceCounter(
+    _Out_opt_ PLARGE_INTEGER PerformanceFrequency);
+
+VOID
+KeStallExecutionProcessor(
+    _In_  ULONG MicroSeconds);
+
+#define RtlZeroMemory(d, n)             memset((d), 0, (n))
+#define RtlCopyMemory(d, s, n)          memcpy((d), (s), (n))
+#define RtlMoveMemory(d, s, n)          memmove((d), (s), (n))
+#define RtlEqualMemory(a, b, n)         (memcmp((a), (b), (n)) == 0)
+
+VOID
+RtlInitUnicodeString(
+    _Out_ PUNICODE_STRING DestinationString,
+    _In_opt_ PCWSTR SourceString);
+
+#define RtlInitEmptyUnicodeString(_ucStr, _buf, _bufSize) \
+    ((_ucStr)->Buffer = (_buf), (_ucStr)->Length = 0, (_ucStr)->MaximumLength = (USHORT)(_bufSize))
+
+VOID
+KeQuerySystemTime(
+    _Out_ PLARGE_INTEGER CurrentTime);
+
+//
+// Registry value types.
+//
+
+#define REG_BINARY                      3
+#define REG_DWORD                       4
+
+//
+// I/O control codes.
+//
+
+#define FILE_DEVICE_CONTROLLER          0x00000004
+#define FILE_DEVICE_GPIO                0x00000056
+#define METHOD_BUFFERED                 0
+#define METHOD_OUT_DIRECT               2
+#define FILE_ANY_ACCESS                 0
+#define FILE_READ_ACCESS                0x0001
+#define FILE_WRITE_ACCESS               0x0002
+
+#define GENERIC_READ                    0x80000000L
+#define GENERIC_WRITE                   0x40000000L
+#define FILE_GENERIC_READ               0x00120089L
+#define FILE_GENERIC_WRITE              0x00120116L
+#define FILE_OPEN                       0x00000001
+#define FILE_ATTRIBUTE_NORMAL           0x00000080
+
+#define CTL_CODE(DeviceType, Function, Method, Access) \
+    (((DeviceType) << 16) | ((Access) << 14) | ((Function) << 2) | (Method))
+
+//
+// Memory descriptor lists, only a system address and a length.
+//
+
+typedef struct _MDL
+{
+    struct _MDL *Next;
+    PVOID MappedSystemVa;
+    ULONG ByteCount;
+} MDL, *PMDL;
+
+typedef enum _MM_PAGE_PRIORITY
+{
+    LowPagePriority,
+    NormalPagePriority = 16,
+    HighPagePriority = 32
+} MM_PAGE_PRIORITY;
+
+#define MmGetMdlByteCount(Mdl)                          ((Mdl)->ByteCount)
+#define MmGetSystemAddressForMdlSafe(Mdl, Priority)     ((Mdl)->MappedSystemVa)
+
+//
+// Register access, routed to the model.
+//
+
+ULONG
+READ_REGISTER_ULONG(
+    _In_ volatile ULONG *Register);
+
+VOID
+WRITE_REGISTER_ULONG(
+    _In_ volatile ULONG *Register,
+    _In_ ULONG Value);
+
+//
+// DPCs, timers and events. A timer keeps its absolute due time in ticks
+// of the performance counter.
+//
+
+typedef struct _KDPC *PKDPC;
+
+typedef
+VOID
+KDEFERRED_ROUTINE(
+    _In_ PKDPC Dpc,
+    _In_opt_ PVOID DeferredContext,
+    _In_opt_ PVOID SystemArgument1,
+    _In_opt_ PVOID SystemArgument2);
+
+typedef KDEFERRED_ROUTINE *PKDEFERRED_ROUTINE;
+
+typedef struct _KDPC
+{
+    PKDEFERRED_ROUTINE DeferredRoutine;
+    PVOID DeferredContext;
+    BOOLEAN Inserted;
+} KDPC;
+
+typedef struct _KTIMER
+{
+    LONGLONG DueTime;
+    PKDPC Dpc;
+    BOOLEAN Inserted;
+} KTIMER, *PKTIMER;
+
+typedef UCHAR KIRQL, *PKIRQL;
+#define PASSIVE_LEVEL                   0
+#define DISPATCH_LEVEL                  2
+
+typedef LONG KSPIN_LOCK, *PKSPIN_LOCK;
+
+typedef enum _EVENT_TYPE
+{
+    NotificationEvent,
+    SynchronizationEvent
+} EVENT_TYPE;
+
+typedef struct _KEVENT
+{
+    LONG State;
+} KEVENT, *PKEVENT;
+
+typedef enum _KWAIT_REASON
+{
+    Executive
+} KWAIT_REASON;
+
+typedef enum _MODE
+{
+    KernelMode,
+    UserMode
+} KPROCESSOR_MODE;
+
+VOID
+KeInitializeDpc(
+    _Out_ PKDPC Dpc,
+    _In_ PKDEFERRED_ROUTINE DeferredRoutine,
+    _In_opt_ PVOID DeferredContext);
+
+BOOLEAN
+KeInsertQueueDpc(
+    _Inout_ PKDPC Dpc,
+    _In_opt_ PVOID SystemArgument1,
+    _In_opt_ PVOID SystemArgument2);
+
+VOID
+KeFlushQueuedDpcs(
+    VOID);
+
+VOID
+KeInitializeTimer(
+    _Out_ PKTIMER Timer);
+
+BOOLEAN
+KeSetTimer(
+    _Inout_ PKTIMER Timer,
+    _In_ LARGE_INTEGER DueTime,
+    _In_opt_ PKDPC Dpc);
+
+BOOLEAN
+KeCancelTimer(
+    _Inout_ PKTIMER Timer);
+
+VOID
+KeInitializeSpinLock(
+    _Out_ PKSPIN_LOCK SpinLock);
+
+VOID
+KeAcquireSpinLock(
+    _Inout_ PKSPIN_LOCK SpinLock,
+    _Out_ PKIRQL OldIrql);
+
+VOID
+KeReleaseSpinLock(
+    _Inout_ PKSPIN_LOCK SpinLock,
+    _In_ KIRQL NewIrql);
+
+VOID
+KeAcquireSpinLockAtDpcLevel(
+    _Inout_ PKSPIN_LOCK SpinLock);
+
+VOID
+KeReleaseSpinLockFromDpcLevel(
+    _Inout_ PKSPIN_LOCK SpinLock);
+
+VOID
+KeInitializeEvent(
+    _Out_ PKEVENT Event,
+    _In_ EVENT_TYPE Type,
+    _In_ BOOLEAN State);
+
+NTSTATUS
+KeWaitForSingleObject(
+    _In_ PVOID Object,
+    _In_ KWAIT_REASON WaitReason,
+    _In_ KPROCESSOR_MODE WaitMode,
+    _In_ BOOLEAN Alertable,
+    _In_opt_ PLARGE_INTEGER Timeout);
+
+//
+// Driver and device objects, only passed through.
+//
+
+typedef struct _DRIVER_OBJECT *PDRIVER_OBJECT;
+typedef struct _DEVICE_OBJECT *PDEVICE_OBJECT;
+
+typedef
+NTSTATUS
+DRIVER_INITIALIZE(
+    _In_ PDRIVER_OBJECT DriverObject,
+    _In_ PUNICODE_STRING RegistryPath);
+
+typedef struct _IO_STATUS_BLOCK
+{
+    NTSTATUS Status;
+    ULONG_PTR Information;
+} IO_STATUS_BLOCK, *PIO_STATUS_BLOCK;
+
+typedef struct _IRP
+{
+    ULONG IoControlCode;
+    PVOID InputBuffer;
+    ULONG InputBufferLength;
+    PVOID OutputBuffer;
+    ULONG OutputBufferLength;
+    PIO_STATUS_BLOCK IoStatus;
+} IRP, *PIRP;
+
+PIRP
+IoBuildDeviceIoControlRequest(
+    _In_ ULONG IoControlCode,
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _In_opt_ PVOID InputBuffer,
+    _In_ ULONG InputBufferLength,
+    _Out_opt_ PVOID OutputBuffer,
+    _In_ ULONG OutputBufferLength,
+    _In_ BOOLEAN InternalDeviceIoControl,
+    _In_opt_ PKEVENT Event,
+    _Out_ PIO_STATUS_BLOCK IoStatusBlock);
+
+NTSTATUS
+IoCallDriver(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _Inout_ PIRP Irp);
+
+//
+// Memory.
+//
+
+typedef enum _POOL_TYPE
+{
+    NonPagedPool,
+    PagedPool
+} POOL_TYPE;
+
+typedef enum _MEMORY_CACHING_TYPE
+{
+    MmNonCached,
+    MmCached
+} MEMORY_CACHING_TYPE;
+
+PVOID
+ExAllocatePoolWithTag(
+    _In_ POOL_TYPE PoolType,
+    _In_ SIZE_T NumberOfBytes,
+    _In_ ULONG Tag);
+
+VOID
+ExFreePoolWithTag(
+    _In_ PVOID P,
+    _In_ ULONG Tag);
+
+#define ExAllocatePool(t, n)            ExAllocatePoolWithTag((t), (n), 0)
+#define ExFreePool(p)                   ExFreePoolWithTag((p), 0)
+
+PVOID
+MmMapIoSpace(
+    _In_ PHYSICAL_ADDRESS PhysicalAddress,
+    _In_ SIZE_T NumberOfBytes,
+    _In_ MEMORY_CACHING_TYPE CacheType);
+
+VOID
+MmUnmapIoSpace(
+    _In_ PVOID BaseAddress,
+    _In_ SIZE_T NumberOfBytes);
+
+//
+// Files, served from the file system of the tool.
+//
+
+typedef struct _OBJECT_ATTRIBUTES
+{
+    PUNICODE_STRING ObjectName;
+} OBJECT_ATTRIBUTES, *POBJECT_ATTRIBUTES;
+
+#define OBJ_CASE_INSENSITIVE            0x00000040L
+#define OBJ_KERNEL_HANDLE               0x00000200L
+
+#define InitializeObjectAttributes(p, n, a, r, s) \
+    ((p)->ObjectName = (n), (void)(a), (void)(r), (void)(s))
+
+typedef struct _FILE_STANDARD_INFORMATION
+{
+    LARGE_INTEGER AllocationSize;
+    LARGE_INTEGER EndOfFile;
+    ULONG NumberOfLinks;
+    BOOLEAN DeletePending;
+    BOOLEAN Directory;
+} FILE_STANDARD_INFORMATION;
+
+typedef enum _FILE_INFORMATION_CLASS
+{
+    FileStandardInformation = 5
+} FILE_INFORMATION_CLASS;
+
+#define FILE_READ_DATA                  0x0001
+#define FILE_SHARE_READ                 0x00000001
+#define FILE_SYNCHRONOUS_IO_NONALERT    0x00000020
+
+NTSTATUS
+ZwOpenFile(
+    _Out_ PHANDLE FileHandle,
+    _In_ ACCESS_MASK DesiredAccess,
+    _In_ POBJECT_ATTRIBUTES ObjectAttributes,
+    _Out_ PIO_STATUS_BLOCK IoStatusBlock,
+    _In_ ULONG ShareAccess,
+    _In_ ULONG OpenOptions);
+
+NTSTATUS
+ZwQueryInformationFile(
+    _In_ HANDLE FileHandle,
+    _Out_ PIO_STATUS_BLOCK IoStatusBlock,
+    _Out_ PVOID FileInformation,
+    _In_ ULONG Length,
+    _In_ FILE_INFORMATION_CLASS FileInformationClass);
+
+NTSTATUS
+ZwReadFile(
+    _In_ HANDLE FileHandle,
+    _In_opt_ HANDLE Event,
+    _In_opt_ PVOID ApcRoutine,
+    _In_opt_ PVOID ApcContext,
+    _Out_ PIO_STATUS_BLOCK IoStatusBlock,
+    _Out_ PVOID Buffer,
+    _In_ ULONG Length,
+    _In_opt_ PLARGE_INTEGER ByteOffset,
+    _In_opt_ PULONG Key);
+
+NTSTATUS
+ZwClose(
+    _In_ HANDLE Handle);
+
+//
+// Hardware resources.
+//
+
+#define CmResourceTypeNull              0
+#define CmResourceTypePort              1
+#define CmResourceTypeInterrupt         2
+#define CmResourceTypeMemory            3
+#define CmResourceTypeConnection        132
+
+#define CM_RESOURCE_CONNECTION_CLASS_GPIO       1
+#define CM_RESOURCE_CONNECTION_CLASS_SERIAL     2
+#define CM_RESOURCE_CONNECTION_TYPE_SERIAL_I2C  1
+#define CM_RESOURCE_CONNECTION_TYPE_SERIAL_SPI  2
+
+typedef struct _CM_PARTIAL_RESOURCE_DESCRIPTOR
+{
+    UCHAR Type;
+    union
+    {
+        struct
+        {
+            PHYSICAL_ADDRESS Start;
+            ULONG Length;
+        } Memory;
+
+        struct
+        {
+            UCHAR Class;
+            UCHAR Type;
+            ULONG IdLowPart;
+            ULONG IdHighPart;
+        } Connection;
+    } u;
+} CM_PARTIAL_RESOURCE_DESCRIPTOR, *PCM_PARTIAL_RESOURCE_DESCRIPTOR;
+
+//
+// Interrupts and power.
+//
+
+typedef enum _KINTERRUPT_MODE
+{
+    LevelSensitive,
+    Latched
+} KINTERRUPT_MODE;
+
+typedef enum _KINTERRUPT_POLARITY
+{
+    InterruptPolarityUnknown,
+    InterruptActiveHigh,
+    InterruptActiveLow,
+    InterruptActiveBoth
+} KINTERRUPT_POLARITY;
+
+typedef struct _PO_FX_COMPONENT_IDLE_STATE
+{
+    ULONGLONG TransitionLatency;
+    ULONGLONG ResidencyRequirement;
+    ULONG NominalPower;
+} PO_FX_COMPONENT_IDLE_STATE, *PPO_FX_COMPONENT_IDLE_STATE;
+
+#endif // _HOST_NTDDK_H_
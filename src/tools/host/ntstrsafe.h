@@ -0,0 +1,51 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	ntstrsafe.h
+
+Abstract:
+
+	Host stand-in, the counted string routines the Silead loader
+	uses, implemented by its tools/gslcfgload.c.
+
+Environment:
+
+	user mode
+
+--*/
+
+#ifndef _HOST_NTSTRSAFE_H_
+#define _HOST_NTSTRSAFE_H_
+
+#include "ntddk.h"
+
+NTSTATUS
+RtlUnicodeStringCat(
+    _Inout_ PUNICODE_STRING DestinationString,
+    _In_ PCUNICODE_STRING SourceString);
+
+NTSTATUS
+RtlUnicodeStringCatString(
+    _Inout_ PUNICODE_STRING DestinationString,
+    _In_ PCWSTR pszSrc);
+
+#endif // _HOST_NTSTRSAFE_H_
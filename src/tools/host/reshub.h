@@ -0,0 +1,75 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	reshub.h
+
+Abstract:
+
+	Host stand-in for the resource hub header, the serial bus
+	descriptor the sunxii2c internal.h embeds and the path the Gt9xx
+	driver opens its I2C target by. The fake panel does not look at
+	the path, it is left empty.
+
+Environment:
+
+	user mode
+
+--*/
+
+#ifndef _HOST_RESHUB_H_
+#define _HOST_RESHUB_H_
+
+#include "ntddk.h"
+
+#include "pshpack1.h"
+
+typedef struct _PNP_SERIAL_BUS_DESCRIPTOR
+{
+    UCHAR Tag;
+    USHORT Length;
+    UCHAR RevisionId;
+    UCHAR ResourceSourceIndex;
+    UCHAR SerialBusType;
+    UCHAR GeneralFlags;
+    USHORT TypeSpecificFlags;
+    UCHAR TypeSpecificRevisionId;
+    USHORT TypeDataLength;
+} PNP_SERIAL_BUS_DESCRIPTOR, *PPNP_SERIAL_BUS_DESCRIPTOR;
+
+#include "poppack.h"
+
+#define RESOURCE_HUB_PATH_SIZE          64
+
+static inline NTSTATUS
+RESOURCE_HUB_CREATE_PATH_FROM_ID(
+    _Out_ PUNICODE_STRING RhPath,
+    _In_ ULONG IdLowPart,
+    _In_ ULONG IdHighPart)
+{
+    UNREFERENCED_PARAMETER(IdLowPart);
+    UNREFERENCED_PARAMETER(IdHighPart);
+
+    RhPath->Length = 0;
+    return STATUS_SUCCESS;
+}
+
+#endif // _HOST_RESHUB_H_
@@ -0,0 +1,60 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	spb.h
+
+Abstract:
+
+	Host stand-in for spb.h, the transfer direction SPBCx.h uses and the
+	transfer list types spbclient.h embeds.
+
+Environment:
+
+	user mode
+
+--*/
+
+#ifndef _HOST_SPB_H_
+#define _HOST_SPB_H_
+
+#include "ntddk.h"
+
+typedef enum _SPB_TRANSFER_DIRECTION
+{
+    SpbTransferDirectionNone = 0,
+    SpbTransferDirectionFromDevice,
+    SpbTransferDirectionToDevice,
+    SpbTransferDirectionMax
+} SPB_TRANSFER_DIRECTION;
+
+typedef struct _SPB_TRANSFER_LIST_ENTRY
+{
+    SPB_TRANSFER_DIRECTION Direction;
+    ULONG DelayInUs;
+    PVOID Buffer;
+    ULONG BufferCb;
+} SPB_TRANSFER_LIST_ENTRY;
+
+#define SPB_TRANSFER_LIST_AND_ENTRIES(n) \
+    struct { ULONG Size; ULONG TransferCount; SPB_TRANSFER_LIST_ENTRY Transfers[n]; }
+
+#endif // _HOST_SPB_H_
@@ -0,0 +1,97 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	vhf.h
+
+Abstract:
+
+	Host stand-in for the virtual HID framework header. Only the
+	configuration fields HidInjectorKd.c sets are declared, the
+	routines are implemented by the fake VHF of vhfbatch.c.
+
+Environment:
+
+	user mode
+
+--*/
+
+#ifndef _HOST_VHF_H_
+#define _HOST_VHF_H_
+
+#include "hidport.h"
+
+typedef PVOID VHFHANDLE, *PVHFHANDLE;
+typedef PVOID VHFOPERATIONHANDLE;
+
+typedef VOID EVT_VHF_READY_FOR_NEXT_READ_REPORT(
+    _In_  PVOID VhfClientContext);
+typedef EVT_VHF_READY_FOR_NEXT_READ_REPORT *PEVT_VHF_READY_FOR_NEXT_READ_REPORT;
+
+typedef VOID EVT_VHF_ASYNC_OPERATION(
+    _In_  PVOID VhfClientContext,
+    _In_  VHFOPERATIONHANDLE VhfOperationHandle,
+    _In_opt_ PVOID VhfOperationContext,
+    _In_  PHID_XFER_PACKET HidTransferPacket);
+typedef EVT_VHF_ASYNC_OPERATION *PEVT_VHF_ASYNC_OPERATION;
+
+typedef struct _VHF_CONFIG
+{
+    PVOID VhfClientContext;
+    ULONG OperationContextSize;
+    PDEVICE_OBJECT DeviceObject;
+    USHORT ReportDescriptorLength;
+    PUCHAR ReportDescriptor;
+    PEVT_VHF_READY_FOR_NEXT_READ_REPORT EvtVhfReadyForNextReadReport;
+    PEVT_VHF_ASYNC_OPERATION EvtVhfAsyncOperationGetFeature;
+} VHF_CONFIG, *PVHF_CONFIG;
+
+#define VHF_CONFIG_INIT(c, d, l, r) \
+    (memset((c), 0, sizeof(*(c))), \
+     (c)->DeviceObject = (d), \
+     (c)->ReportDescriptorLength = (l), \
+     (c)->ReportDescriptor = (r))
+
+NTSTATUS
+VhfCreate(
+    _In_  PVHF_CONFIG VhfConfig,
+    _Out_ PVHFHANDLE VhfHandle);
+
+NTSTATUS
+VhfStart(
+    _In_  VHFHANDLE VhfHandle);
+
+VOID
+VhfDelete(
+    _In_  VHFHANDLE VhfHandle,
+    _In_  BOOLEAN Wait);
+
+NTSTATUS
+VhfReadReportSubmit(
+    _In_  VHFHANDLE VhfHandle,
+    _In_  PHID_XFER_PACKET HidTransferPacket);
+
+NTSTATUS
+VhfAsyncOperationComplete(
+    _In_  VHFOPERATIONHANDLE VhfOperationHandle,
+    _In_  NTSTATUS CompletionStatus);
+
+#endif // _HOST_VHF_H_
@@ -0,0 +1,591 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	wdf.h
+
+Abstract:
+
+	Host stand-in for the framework header. Handles are opaque
+	pointers, the framework routines the drivers call are
+	implemented by the model of each tool, see ntddk.h.
+
+Environment:
+
+	user mode
+
+--*/
+
+#ifndef _HOST_WDF_H_
+#define _HOST_WDF_H_
+
+#include "ntddk.h"
+
+typedef PVOID                   WDFOBJECT;
+typedef struct WDFDRIVER__      *WDFDRIVER;
+typedef struct WDFDEVICE__      *WDFDEVICE;
+typedef struct WDFINTERRUPT__   *WDFINTERRUPT;
+typedef struct WDFSPINLOCK__    *WDFSPINLOCK;
+typedef struct WDFTIMER__       *WDFTIMER;
+typedef struct WDFREQUEST__     *WDFREQUEST;
+typedef struct WDFQUEUE__       *WDFQUEUE;
+typedef struct WDFCMRESLIST__   *WDFCMRESLIST;
+typedef struct WDFKEY__         *WDFKEY;
+typedef struct WDFMEMORY__      *WDFMEMORY;
+typedef struct WDFIOTARGET__    *WDFIOTARGET;
+typedef PVOID                   WDFCONTEXT;
+typedef struct WDFDEVICE_INIT   *PWDFDEVICE_INIT;
+
+typedef enum _WDF_POWER_DEVICE_STATE
+{
+    WdfPowerDeviceInvalid = 0,
+    WdfPowerDeviceD0,
+    WdfPowerDeviceD1,
+    WdfPowerDeviceD2,
+    WdfPowerDeviceD3,
+    WdfPowerDeviceD3Final,
+    WdfPowerDevicePrepareForHibernation,
+    WdfPowerDeviceMaximum
+} WDF_POWER_DEVICE_STATE;
+
+typedef struct _WDF_OBJECT_ATTRIBUTES
+{
+    ULONG Size;
+    WDFOBJECT ParentObject;
+    size_t ContextSize;
+} WDF_OBJECT_ATTRIBUTES, *PWDF_OBJECT_ATTRIBUTES;
+
+#define WDF_OBJECT_ATTRIBUTES_INIT(a)   (memset((a), 0, sizeof(*(a))), (a)->Size = sizeof(*(a)))
+#define WDF_OBJECT_ATTRIBUTES_INIT_CONTEXT_TYPE(a, _contexttype) \
+    (WDF_OBJECT_ATTRIBUTES_INIT(a), (a)->ContextSize = sizeof(_contexttype))
+#define WDF_NO_OBJECT_ATTRIBUTES        NULL
+#define WDF_NO_HANDLE                   NULL
+
+//
+// Contexts are found through the worker, a model that creates objects
+// keeps each context right behind its handle.
+//
+
+PVOID
+WdfObjectGetTypedContextWorker(
+    _In_ WDFOBJECT Handle);
+
+#define WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(_contexttype, _castingfunction) \
+    static inline _contexttype *_castingfunction(WDFOBJECT Handle) \
+    { \
+        return (_contexttype *)WdfObjectGetTypedContextWorker(Handle); \
+    }
+
+typedef
+NTSTATUS
+EVT_WDF_DRIVER_DEVICE_ADD(
+    _In_ WDFDRIVER Driver,
+    _Inout_ PWDFDEVICE_INIT DeviceInit);
+
+typedef
+VOID
+EVT_WDF_DRIVER_UNLOAD(
+    _In_ WDFDRIVER Driver);
+
+typedef struct _WDF_DRIVER_CONFIG
+{
+    ULONG Size;
+    EVT_WDF_DRIVER_DEVICE_ADD *EvtDriverDeviceAdd;
+    EVT_WDF_DRIVER_UNLOAD *EvtDriverUnload;
+    ULONG DriverInitFlags;
+    ULONG DriverPoolTag;
+} WDF_DRIVER_CONFIG, *PWDF_DRIVER_CONFIG;
+
+FORCEINLINE
+VOID
+WDF_DRIVER_CONFIG_INIT(
+    _Out_ PWDF_DRIVER_CONFIG Config,
+    _In_opt_ EVT_WDF_DRIVER_DEVICE_ADD *EvtDriverDeviceAdd)
+{
+    memset(Config, 0, sizeof(*Config));
+    Config->Size = sizeof(*Config);
+    Config->EvtDriverDeviceAdd = EvtDriverDeviceAdd;
+}
+
+NTSTATUS
+WdfDriverCreate(
+    _In_ PDRIVER_OBJECT DriverObject,
+    _In_ PUNICODE_STRING RegistryPath,
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES DriverAttributes,
+    _In_ PWDF_DRIVER_CONFIG DriverConfig,
+    _Out_opt_ WDFDRIVER *Driver);
+
+NTSTATUS
+WdfDeviceCreate(
+    _Inout_ PWDFDEVICE_INIT *DeviceInit,
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES DeviceAttributes,
+    _Out_ WDFDEVICE *Device);
+
+WDFDRIVER
+WdfDeviceGetDriver(
+    _In_ WDFDEVICE Device);
+
+PWSTR
+WdfDriverGetRegistryPath(
+    _In_ WDFDRIVER Driver);
+
+VOID
+WdfControlFinishInitializing(
+    _In_ WDFDEVICE Device);
+
+PDEVICE_OBJECT
+WdfDeviceWdmGetPhysicalDevice(
+    _In_ WDFDEVICE Device);
+
+PDEVICE_OBJECT
+WdfDeviceWdmGetDeviceObject(
+    _In_ WDFDEVICE Device);
+
+VOID
+WdfFdoInitSetFilter(
+    _In_ PWDFDEVICE_INIT DeviceInit);
+
+//
+// Registry.
+//
+
+#define PLUGPLAY_REGKEY_DEVICE          1
+#define KEY_READ                        0x20019
+
+NTSTATUS
+WdfDeviceOpenRegistryKey(
+    _In_ WDFDEVICE Device,
+    _In_ ULONG DeviceInstanceKeyType,
+    _In_ ULONG DesiredAccess,
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES KeyAttributes,
+    _Out_ WDFKEY *Key);
+
+NTSTATUS
+WdfRegistryOpenKey(
+    _In_opt_ WDFKEY ParentKey,
+    _In_ PCUNICODE_STRING KeyName,
+    _In_ ACCESS_MASK DesiredAccess,
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES KeyAttributes,
+    _Out_ WDFKEY *Key);
+
+NTSTATUS
+WdfRegistryQueryMemory(
+    _In_ WDFKEY Key,
+    _In_ PCUNICODE_STRING ValueName,
+    _In_ POOL_TYPE PoolType,
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES MemoryAttributes,
+    _Out_ WDFMEMORY *Memory,
+    _Out_opt_ PULONG ValueType);
+
+NTSTATUS
+WdfRegistryQueryULong(
+    _In_ WDFKEY Key,
+    _In_ PCUNICODE_STRING ValueName,
+    _Out_ PULONG Value);
+
+NTSTATUS
+WdfRegistryQueryValue(
+    _In_ WDFKEY Key,
+    _In_ PCUNICODE_STRING ValueName,
+    _In_ ULONG ValueLength,
+    _Out_opt_ PVOID Value,
+    _Out_opt_ PULONG ValueLengthQueried,
+    _Out_opt_ PULONG ValueType);
+
+NTSTATUS
+WdfRegistryQueryUnicodeString(
+    _In_ WDFKEY Key,
+    _In_ PCUNICODE_STRING ValueName,
+    _Out_opt_ PUSHORT ValueByteLength,
+    _Inout_opt_ PUNICODE_STRING Value);
+
+VOID
+WdfRegistryClose(
+    _In_ WDFKEY Key);
+
+//
+// Requests sent to an I/O target.
+//
+
+typedef struct _WDF_REQUEST_COMPLETION_PARAMS
+{
+    IO_STATUS_BLOCK IoStatus;
+} WDF_REQUEST_COMPLETION_PARAMS, *PWDF_REQUEST_COMPLETION_PARAMS;
+
+typedef
+VOID
+EVT_WDF_REQUEST_COMPLETION_ROUTINE(
+    _In_ WDFREQUEST Request,
+    _In_ WDFIOTARGET Target,
+    _In_ PWDF_REQUEST_COMPLETION_PARAMS Params,
+    _In_ WDFCONTEXT Context);
+typedef EVT_WDF_REQUEST_COMPLETION_ROUTINE *PFN_WDF_REQUEST_COMPLETION_ROUTINE;
+
+#define WDF_REQUEST_REUSE_NO_FLAGS      0
+
+typedef struct _WDF_REQUEST_REUSE_PARAMS
+{
+    ULONG Flags;
+    NTSTATUS Status;
+} WDF_REQUEST_REUSE_PARAMS, *PWDF_REQUEST_REUSE_PARAMS;
+
+#define WDF_REQUEST_REUSE_PARAMS_INIT(p, f, s) ((p)->Flags = (f), (p)->Status = (s))
+
+typedef struct _WDFMEMORY_OFFSET
+{
+    size_t BufferOffset;
+    size_t BufferLength;
+} WDFMEMORY_OFFSET, *PWDFMEMORY_OFFSET;
+
+typedef struct _WDF_REQUEST_SEND_OPTIONS
+{
+    ULONG Flags;
+    LONGLONG Timeout;
+} WDF_REQUEST_SEND_OPTIONS, *PWDF_REQUEST_SEND_OPTIONS;
+
+#define WDF_NO_SEND_OPTIONS                 NULL
+#define WDF_REQUEST_SEND_OPTION_TIMEOUT     0x00000001
+#define WDF_REQUEST_SEND_OPTION_SYNCHRONOUS 0x00000002
+
+#define WDF_REQUEST_SEND_OPTIONS_INIT(o, f) \
+    (memset((o), 0, sizeof(WDF_REQUEST_SEND_OPTIONS)), (o)->Flags = (f))
+#define WDF_REQUEST_SEND_OPTIONS_SET_TIMEOUT(o, t) \
+    ((o)->Flags |= WDF_REQUEST_SEND_OPTION_TIMEOUT, (o)->Timeout = (t))
+
+typedef struct _WDF_IO_TARGET_OPEN_PARAMS
+{
+    PCUNICODE_STRING TargetDeviceName;
+    ACCESS_MASK DesiredAccess;
+    ULONG ShareAccess;
+    ULONG CreateDisposition;
+    ULONG FileAttributes;
+} WDF_IO_TARGET_OPEN_PARAMS, *PWDF_IO_TARGET_OPEN_PARAMS;
+
+#define WDF_IO_TARGET_OPEN_PARAMS_INIT_OPEN_BY_NAME(p, n, a) \
+    (memset((p), 0, sizeof(WDF_IO_TARGET_OPEN_PARAMS)), \
+     (p)->TargetDeviceName = (n), (p)->DesiredAccess = (a))
+
+NTSTATUS
+WdfIoTargetCreate(
+    _In_ WDFDEVICE Device,
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES Attributes,
+    _Out_ WDFIOTARGET *IoTarget);
+
+NTSTATUS
+WdfIoTargetOpen(
+    _In_ WDFIOTARGET IoTarget,
+    _In_ PWDF_IO_TARGET_OPEN_PARAMS OpenParams);
+
+VOID
+WdfIoTargetClose(
+    _In_ WDFIOTARGET IoTarget);
+
+NTSTATUS
+WdfRequestCreate(
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES RequestAttributes,
+    _In_opt_ WDFIOTARGET IoTarget,
+    _Out_ WDFREQUEST *Request);
+
+NTSTATUS
+WdfRequestReuse(
+    _In_ WDFREQUEST Request,
+    _In_ PWDF_REQUEST_REUSE_PARAMS ReuseParams);
+
+NTSTATUS
+WdfIoTargetFormatRequestForWrite(
+    _In_ WDFIOTARGET IoTarget,
+    _In_ WDFREQUEST Request,
+    _In_opt_ WDFMEMORY InputBuffer,
+    _In_opt_ PWDFMEMORY_OFFSET InputBufferOffset,
+    _In_opt_ PLONGLONG DeviceOffset);
+
+NTSTATUS
+WdfIoTargetFormatRequestForIoctl(
+    _In_ WDFIOTARGET IoTarget,
+    _In_ WDFREQUEST Request,
+    _In_ ULONG IoctlCode,
+    _In_opt_ WDFMEMORY InputBuffer,
+    _In_opt_ PLONGLONG InputBufferOffset,
+    _In_opt_ WDFMEMORY OutputBuffer,
+    _In_opt_ PLONGLONG OutputBufferOffset);
+
+NTSTATUS
+WdfRequestAllocateTimer(
+    _In_ WDFREQUEST Request);
+
+VOID
+WdfRequestSetCompletionRoutine(
+    _In_ WDFREQUEST Request,
+    _In_opt_ PFN_WDF_REQUEST_COMPLETION_ROUTINE CompletionRoutine,
+    _In_opt_ WDFCONTEXT CompletionContext);
+
+BOOLEAN
+WdfRequestSend(
+    _In_ WDFREQUEST Request,
+    _In_ WDFIOTARGET Target,
+    _In_opt_ PWDF_REQUEST_SEND_OPTIONS Options);
+
+NTSTATUS
+WdfRequestGetStatus(
+    _In_ WDFREQUEST Request);
+
+//
+// Memory objects.
+//
+
+NTSTATUS
+WdfMemoryCreate(
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES Attributes,
+    _In_ POOL_TYPE PoolType,
+    _In_opt_ ULONG PoolTag,
+    _In_ size_t BufferSize,
+    _Out_ WDFMEMORY *Memory,
+    _Out_opt_ PVOID *Buffer);
+
+NTSTATUS
+WdfMemoryCreatePreallocated(
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES Attributes,
+    _In_ PVOID Buffer,
+    _In_ size_t BufferSize,
+    _Out_ WDFMEMORY *Memory);
+
+PVOID
+WdfMemoryGetBuffer(
+    _In_ WDFMEMORY Memory,
+    _Out_opt_ size_t *BufferSize);
+
+VOID
+WdfObjectDelete(
+    _In_ WDFOBJECT Object);
+
+//
+// Resource lists.
+//
+
+ULONG
+WdfCmResourceListGetCount(
+    _In_ WDFCMRESLIST List);
+
+PCM_PARTIAL_RESOURCE_DESCRIPTOR
+WdfCmResourceListGetDescriptor(
+    _In_ WDFCMRESLIST List,
+    _In_ ULONG Index);
+
+//
+// Event callback types used by device.h.
+//
+
+typedef NTSTATUS EVT_WDF_DEVICE_PREPARE_HARDWARE(WDFDEVICE, WDFCMRESLIST, WDFCMRESLIST);
+typedef NTSTATUS EVT_WDF_DEVICE_RELEASE_HARDWARE(WDFDEVICE, WDFCMRESLIST);
+typedef NTSTATUS EVT_WDF_DEVICE_D0_ENTRY(WDFDEVICE, WDF_POWER_DEVICE_STATE);
+typedef NTSTATUS EVT_WDF_DEVICE_D0_EXIT(WDFDEVICE, WDF_POWER_DEVICE_STATE);
+typedef NTSTATUS EVT_WDF_DEVICE_SELF_MANAGED_IO_INIT(WDFDEVICE);
+typedef VOID EVT_WDF_DEVICE_SELF_MANAGED_IO_CLEANUP(WDFDEVICE);
+typedef BOOLEAN EVT_WDF_INTERRUPT_ISR(WDFINTERRUPT, ULONG);
+typedef VOID EVT_WDF_INTERRUPT_DPC(WDFINTERRUPT, WDFOBJECT);
+typedef VOID EVT_WDF_REQUEST_CANCEL(WDFREQUEST);
+typedef VOID EVT_WDF_TIMER(WDFTIMER);
+typedef VOID EVT_WDF_IO_IN_CALLER_CONTEXT(WDFDEVICE, WDFREQUEST);
+typedef VOID EVT_WDF_IO_QUEUE_IO_WRITE(WDFQUEUE, WDFREQUEST, size_t);
+typedef VOID EVT_WDF_IO_QUEUE_IO_INTERNAL_DEVICE_CONTROL(WDFQUEUE, WDFREQUEST, size_t, size_t, ULONG);
+typedef VOID EVT_WDF_IO_QUEUE_IO_CANCELED_ON_QUEUE(WDFQUEUE, WDFREQUEST);
+typedef VOID EVT_WDF_OBJECT_CONTEXT_CLEANUP(WDFOBJECT);
+typedef EVT_WDF_REQUEST_CANCEL *PFN_WDF_REQUEST_CANCEL;
+
+typedef struct _WDF_PNPPOWER_EVENT_CALLBACKS
+{
+    ULONG Size;
+    EVT_WDF_DEVICE_D0_ENTRY *EvtDeviceD0Entry;
+    EVT_WDF_DEVICE_D0_EXIT *EvtDeviceD0Exit;
+    EVT_WDF_DEVICE_PREPARE_HARDWARE *EvtDevicePrepareHardware;
+    EVT_WDF_DEVICE_RELEASE_HARDWARE *EvtDeviceReleaseHardware;
+    EVT_WDF_DEVICE_SELF_MANAGED_IO_INIT *EvtDeviceSelfManagedIoInit;
+    EVT_WDF_DEVICE_SELF_MANAGED_IO_CLEANUP *EvtDeviceSelfManagedIoCleanup;
+} WDF_PNPPOWER_EVENT_CALLBACKS, *PWDF_PNPPOWER_EVENT_CALLBACKS;
+
+#define WDF_PNPPOWER_EVENT_CALLBACKS_INIT(c) (memset((c), 0, sizeof(*(c))), (c)->Size = sizeof(*(c)))
+
+VOID
+WdfDeviceInitSetPnpPowerEventCallbacks(
+    _In_ PWDFDEVICE_INIT DeviceInit,
+    _In_ PWDF_PNPPOWER_EVENT_CALLBACKS PnpPowerEventCallbacks);
+
+//
+// Queues and the requests they present.
+//
+
+typedef enum _WDF_IO_QUEUE_DISPATCH_TYPE
+{
+    WdfIoQueueDispatchInvalid = 0,
+    WdfIoQueueDispatchSequential,
+    WdfIoQueueDispatchParallel,
+    WdfIoQueueDispatchManual
+} WDF_IO_QUEUE_DISPATCH_TYPE;
+
+typedef struct _WDF_IO_QUEUE_CONFIG
+{
+    ULONG Size;
+    WDF_IO_QUEUE_DISPATCH_TYPE DispatchType;
+    EVT_WDF_IO_QUEUE_IO_WRITE *EvtIoWrite;
+} WDF_IO_QUEUE_CONFIG, *PWDF_IO_QUEUE_CONFIG;
+
+#define WDF_IO_QUEUE_CONFIG_INIT(c, t) \
+    (memset((c), 0, sizeof(*(c))), (c)->Size = sizeof(*(c)), (c)->DispatchType = (t))
+
+NTSTATUS
+WdfIoQueueCreate(
+    _In_ WDFDEVICE Device,
+    _In_ PWDF_IO_QUEUE_CONFIG Config,
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES QueueAttributes,
+    _Out_opt_ WDFQUEUE *Queue);
+
+NTSTATUS
+WdfIoQueueRetrieveNextRequest(
+    _In_ WDFQUEUE Queue,
+    _Out_ WDFREQUEST *OutRequest);
+
+WDFQUEUE
+WdfRequestGetIoQueue(
+    _In_ WDFREQUEST Request);
+
+NTSTATUS
+WdfRequestRetrieveInputMemory(
+    _In_ WDFREQUEST Request,
+    _Out_ WDFMEMORY *Memory);
+
+NTSTATUS
+WdfRequestRetrieveOutputBuffer(
+    _In_ WDFREQUEST Request,
+    _In_ size_t MinimumRequiredSize,
+    _Out_ PVOID *Buffer,
+    _Out_opt_ size_t *Length);
+
+NTSTATUS
+WdfRequestMarkCancelableEx(
+    _In_ WDFREQUEST Request,
+    _In_ PFN_WDF_REQUEST_CANCEL EvtRequestCancel);
+
+VOID
+WdfRequestCompleteWithInformation(
+    _In_ WDFREQUEST Request,
+    _In_ NTSTATUS Status,
+    _In_ ULONG_PTR Information);
+
+#define WdfRequestComplete(Request, Status) \
+    WdfRequestCompleteWithInformation((Request), (Status), 0)
+
+//
+// Relative timeouts are negative multiples of 100 ns, absolute ones
+// positive.
+//
+
+#define WDF_REL_TIMEOUT_IN_US(Time)     (-((LONGLONG)(Time) * 10))
+#define WDF_REL_TIMEOUT_IN_MS(Time)     (-((LONGLONG)(Time) * 10000))
+#define WDF_REL_TIMEOUT_IN_SEC(Time)    (-((LONGLONG)(Time) * 10000000))
+#define WDF_ABS_TIMEOUT_IN_SEC(Time)    ((LONGLONG)(Time) * 10000000)
+
+typedef struct _WDF_TIMER_CONFIG
+{
+    ULONG Size;
+    EVT_WDF_TIMER *EvtTimerFunc;
+    ULONG Period;
+    BOOLEAN AutomaticSerialization;
+} WDF_TIMER_CONFIG, *PWDF_TIMER_CONFIG;
+
+#define WDF_TIMER_CONFIG_INIT(c, f) \
+    (memset((c), 0, sizeof(*(c))), (c)->Size = sizeof(*(c)), \
+     (c)->EvtTimerFunc = (f), (c)->AutomaticSerialization = TRUE)
+
+NTSTATUS
+WdfTimerCreate(
+    _In_ PWDF_TIMER_CONFIG Config,
+    _In_ PWDF_OBJECT_ATTRIBUTES Attributes,
+    _Out_ WDFTIMER *Timer);
+
+WDFOBJECT
+WdfTimerGetParentObject(
+    _In_ WDFTIMER Timer);
+
+BOOLEAN
+WdfTimerStart(
+    _In_ WDFTIMER Timer,
+    _In_ LONGLONG DueTime);
+
+BOOLEAN
+WdfTimerStop(
+    _In_ WDFTIMER Timer,
+    _In_ BOOLEAN Wait);
+
+typedef struct _WDF_INTERRUPT_CONFIG
+{
+    ULONG Size;
+    EVT_WDF_INTERRUPT_ISR *EvtInterruptIsr;
+    EVT_WDF_INTERRUPT_DPC *EvtInterruptDpc;
+    BOOLEAN PassiveHandling;
+    PCM_PARTIAL_RESOURCE_DESCRIPTOR InterruptRaw;
+    PCM_PARTIAL_RESOURCE_DESCRIPTOR InterruptTranslated;
+} WDF_INTERRUPT_CONFIG, *PWDF_INTERRUPT_CONFIG;
+
+#define WDF_INTERRUPT_CONFIG_INIT(c, isr, dpc) \
+    (memset((c), 0, sizeof(*(c))), (c)->Size = sizeof(*(c)), \
+     (c)->EvtInterruptIsr = (isr), (c)->EvtInterruptDpc = (dpc))
+
+NTSTATUS
+WdfInterruptCreate(
+    _In_ WDFDEVICE Device,
+    _In_ PWDF_INTERRUPT_CONFIG Configuration,
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES Attributes,
+    _Out_ WDFINTERRUPT *Interrupt);
+
+BOOLEAN
+WdfInterruptQueueDpcForIsr(
+    _In_ WDFINTERRUPT Interrupt);
+
+WDFDEVICE
+WdfInterruptGetDevice(
+    _In_ WDFINTERRUPT Interrupt);
+
+VOID
+WdfInterruptAcquireLock(
+    _In_ WDFINTERRUPT Interrupt);
+
+VOID
+WdfInterruptReleaseLock(
+    _In_ WDFINTERRUPT Interrupt);
+
+NTSTATUS
+WdfSpinLockCreate(
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES SpinLockAttributes,
+    _Out_ WDFSPINLOCK *SpinLock);
+
+VOID
+WdfSpinLockAcquire(
+    _In_ WDFSPINLOCK SpinLock);
+
+VOID
+WdfSpinLockRelease(
+    _In_ WDFSPINLOCK SpinLock);
+
+NTSTATUS
+WdfRequestUnmarkCancelable(
+    _In_ WDFREQUEST Request);
+
+#endif // _HOST_WDF_H_
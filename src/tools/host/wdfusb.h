@@ -0,0 +1,40 @@
+/** @file
+*
+*  Copyright (c) 2007-2016, Allwinner Technology Co., Ltd. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+**/
+
+/*++
+
+Module Name:
+
+	wdfusb.h
+
+Abstract:
+
+	Host stand-in for wdfusb.h, nothing of it is used.
+
+Environment:
+
+	user mode
+
+--*/
+
+#ifndef _HOST_WDFUSB_H_
+#define _HOST_WDFUSB_H_
+
+#include "ntddk.h"
+
+#endif // _HOST_WDFUSB_H_